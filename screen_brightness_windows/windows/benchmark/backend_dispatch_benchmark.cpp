@@ -0,0 +1,133 @@
+// Cost of dispatching brightness calls through MonitorBackend, against the backend bound at compile time, next to
+// the whole application brightness path they are part of.
+//
+// usage: backend_dispatch_benchmark [iterations]
+//
+// All variants drive the same fake display. "concrete" and "virtual" set a brightness and read it back straight
+// from the backend, once through FakeMonitorBackend, which is final, and once through MonitorBackend, so the
+// difference is the dispatch a backend template parameter would save. "client" sets the application brightness and
+// reads it back through BrightnessClient, as the plugin does. The variants alternate over several passes so that
+// none gets a warmer cache.
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include "screen_brightness_windows/brightness_service.h"
+#include "screen_brightness_windows/fake_monitor_backend.h"
+
+namespace
+{
+	using screen_brightness::BrightnessClient;
+	using screen_brightness::BrightnessService;
+	using screen_brightness::DisplayHandle;
+	using screen_brightness::FakeMonitorBackend;
+	using screen_brightness::MonitorBackend;
+	using screen_brightness::MonitorStatus;
+
+	using Clock = std::chrono::steady_clock;
+
+	constexpr int kPassCount = 5;
+
+	// Returns the time per round in nanoseconds, or a negative value on failure.
+	template <typename Round>
+	double RunPass(const long iterations, Round round)
+	{
+		long sum = 0;
+		const auto start = Clock::now();
+		for (long iteration = 0; iteration < iterations; ++iteration)
+		{
+			long brightness = 0;
+			if (!round(iteration % 101, brightness))
+			{
+				return -1;
+			}
+
+			sum += brightness;
+		}
+
+		const double elapsed = std::chrono::duration<double, std::nano>(Clock::now() - start).count();
+
+		// keeps the reads from being optimised away
+		return sum < 0 ? -1 : elapsed / static_cast<double>(iterations);
+	}
+
+	// A round straight on the backend, dispatched statically for FakeMonitorBackend.
+	template <typename Backend>
+	double RunBackendPass(Backend& backend, const DisplayHandle display, const long iterations)
+	{
+		return RunPass(iterations, [&backend, display](const long value, long& brightness)
+			{
+				long minimum = 0;
+				long maximum = 0;
+				return backend.SetScreenBrightness(display, value) == MonitorStatus::kOk &&
+					backend.GetScreenBrightness(display, minimum, brightness, maximum) == MonitorStatus::kOk;
+			});
+	}
+
+	double RunClientPass(BrightnessClient& client, const long iterations)
+	{
+		return RunPass(iterations, [&client](const long value, long& brightness)
+			{
+				double application_brightness = 0;
+				if (client.SetApplicationScreenBrightness(static_cast<double>(value) / 100) != MonitorStatus::kOk ||
+					client.GetApplicationScreenBrightness(application_brightness) != MonitorStatus::kOk)
+				{
+					return false;
+				}
+
+				brightness = static_cast<long>(application_brightness * 100);
+				return true;
+			});
+	}
+
+	void PrintSamples(const char* name, const std::vector<double>& samples)
+	{
+		std::printf("%-9s best=%.1fns median=%.1fns worst=%.1fns per set+get\n", name, samples.front(), samples[samples.size() / 2],
+			samples.back());
+	}
+}
+
+int main(int argc, char** argv)
+{
+	const long iterations = argc > 1 ? std::max(1L, std::strtol(argv[1], nullptr, 10)) : 2000000;
+
+	auto owned_backend = std::make_unique<FakeMonitorBackend>();
+	FakeMonitorBackend& backend = *owned_backend;
+	MonitorBackend& virtual_backend = backend;
+	const DisplayHandle display = backend.AddDisplay({ "fake", 0, 50, 100 });
+
+	// without bus threads, so that the client path runs inline like the others
+	BrightnessClient client(std::make_shared<BrightnessService>(std::move(owned_backend), screen_brightness::Clock::Steady(),
+		std::chrono::milliseconds(0), false));
+	client.SetDisplay(display);
+	client.Initialize();
+
+	std::vector<double> concrete_samples, virtual_samples, client_samples;
+	for (int pass = 0; pass < kPassCount; ++pass)
+	{
+		concrete_samples.push_back(RunBackendPass(backend, display, iterations));
+		virtual_samples.push_back(RunBackendPass(virtual_backend, display, iterations));
+		client_samples.push_back(RunClientPass(client, iterations));
+		if (concrete_samples.back() < 0 || virtual_samples.back() < 0 || client_samples.back() < 0)
+		{
+			std::fprintf(stderr, "backend_dispatch_benchmark: brightness call failed\n");
+			return 1;
+		}
+	}
+
+	std::sort(concrete_samples.begin(), concrete_samples.end());
+	std::sort(virtual_samples.begin(), virtual_samples.end());
+	std::sort(client_samples.begin(), client_samples.end());
+	PrintSamples("concrete", concrete_samples);
+	PrintSamples("virtual", virtual_samples);
+	PrintSamples("client", client_samples);
+	const double dispatch = virtual_samples[kPassCount / 2] - concrete_samples[kPassCount / 2];
+	std::printf("virtual/concrete=%.2f dispatch/client=%.3f\n", virtual_samples[kPassCount / 2] / concrete_samples[kPassCount / 2],
+		dispatch / client_samples[kPassCount / 2]);
+	return 0;
+}
@@ -0,0 +1,194 @@
+// Throughput and latency of the brightness broker with many concurrent clients, each with its own connection.
+//
+// usage: broker_benchmark [clients] [iterations] [interval_ms]
+//
+// The broker runs on a thread of this process over a fake display, so the numbers are the cost of the socket round
+// trip, the scheduling and the coalescing. A non-zero interval spaces the bus commands like DDC/CI does.
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <unistd.h>
+
+#include "screen_brightness_windows/broker_monitor_backend.h"
+#include "screen_brightness_windows/broker_server.h"
+#include "screen_brightness_windows/fake_monitor_backend.h"
+
+namespace
+{
+	using screen_brightness::BrokerMonitorBackend;
+	using screen_brightness::DisplayHandle;
+	using screen_brightness::MonitorStatus;
+
+	using Clock = std::chrono::steady_clock;
+
+	double Percentile(std::vector<double>& samples, const double percentile)
+	{
+		std::sort(samples.begin(), samples.end());
+		const size_t index = static_cast<size_t>(percentile * static_cast<double>(samples.size() - 1));
+		return samples[index];
+	}
+
+	void PrintSamples(const char* name, std::vector<double> samples, const double seconds)
+	{
+		double total = 0;
+		for (const double sample : samples)
+		{
+			total += sample;
+		}
+
+		std::printf("%-9s n=%zu mean=%.1fus p50=%.1fus p99=%.1fus max=%.1fus throughput=%.0f/s\n", name, samples.size(),
+			total / static_cast<double>(samples.size()), Percentile(samples, 0.5), Percentile(samples, 0.99),
+			Percentile(samples, 1.0), static_cast<double>(samples.size()) / seconds);
+	}
+
+	std::vector<std::unique_ptr<BrokerMonitorBackend>> ConnectClients(const std::string& path, const long count)
+	{
+		std::vector<std::unique_ptr<BrokerMonitorBackend>> clients;
+		for (long index = 0; index < count; ++index)
+		{
+			clients.push_back(std::make_unique<BrokerMonitorBackend>(path, screen_brightness::Clock::Steady()));
+			if (clients.back()->Connect() != MonitorStatus::kOk)
+			{
+				std::fprintf(stderr, "broker_benchmark: cannot connect to %s\n", path.c_str());
+				std::exit(1);
+			}
+		}
+
+		return clients;
+	}
+
+	// Every client alternates a read and a write, waiting for each response.
+	void RunRoundTrips(std::vector<std::unique_ptr<BrokerMonitorBackend>>& clients, const DisplayHandle display, const long iterations)
+	{
+		std::vector<std::vector<double>> get_samples(clients.size()), set_samples(clients.size());
+		std::atomic<long> failure_count{ 0 };
+		std::vector<std::thread> threads;
+		const auto start = Clock::now();
+		for (size_t index = 0; index < clients.size(); ++index)
+		{
+			threads.emplace_back([&, index]
+				{
+					BrokerMonitorBackend& client = *clients[index];
+					get_samples[index].reserve(iterations);
+					set_samples[index].reserve(iterations);
+					for (long iteration = 0; iteration < iterations; ++iteration)
+					{
+						long minimum = 0, brightness = 0, maximum = 0;
+						auto call_start = Clock::now();
+						if (client.GetScreenBrightness(display, minimum, brightness, maximum) != MonitorStatus::kOk)
+						{
+							++failure_count;
+						}
+
+						get_samples[index].push_back(std::chrono::duration<double, std::micro>(Clock::now() - call_start).count());
+						call_start = Clock::now();
+						// writes racing with other clients may be superseded, which is not a failure
+						const MonitorStatus status = client.SetScreenBrightness(display, (iteration * 7 + static_cast<long>(index)) % 101);
+						if (status != MonitorStatus::kOk && status != MonitorStatus::kPreempted)
+						{
+							++failure_count;
+						}
+
+						set_samples[index].push_back(std::chrono::duration<double, std::micro>(Clock::now() - call_start).count());
+					}
+				});
+		}
+
+		for (std::thread& thread : threads)
+		{
+			thread.join();
+		}
+
+		const double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+		std::vector<double> all_get_samples, all_set_samples;
+		for (size_t index = 0; index < clients.size(); ++index)
+		{
+			all_get_samples.insert(all_get_samples.end(), get_samples[index].begin(), get_samples[index].end());
+			all_set_samples.insert(all_set_samples.end(), set_samples[index].begin(), set_samples[index].end());
+		}
+
+		PrintSamples("get", all_get_samples, seconds);
+		PrintSamples("set", all_set_samples, seconds);
+		if (failure_count > 0)
+		{
+			std::printf("failures=%ld\n", failure_count.load());
+		}
+	}
+
+	// Every client sends its writes without waiting, as an animation would.
+	void RunPipelined(std::vector<std::unique_ptr<BrokerMonitorBackend>>& clients, const DisplayHandle display, const long iterations)
+	{
+		std::atomic<long> completed_count{ 0 };
+		std::atomic<long> applied_count{ 0 };
+		std::vector<std::thread> threads;
+		const auto start = Clock::now();
+		for (size_t index = 0; index < clients.size(); ++index)
+		{
+			threads.emplace_back([&, index]
+				{
+					for (long iteration = 0; iteration < iterations; ++iteration)
+					{
+						clients[index]->SetScreenBrightnessAsync(display, (iteration + static_cast<long>(index)) % 101, [&](const MonitorStatus status)
+							{
+								applied_count += status == MonitorStatus::kOk ? 1 : 0;
+								++completed_count;
+							});
+					}
+				});
+		}
+
+		for (std::thread& thread : threads)
+		{
+			thread.join();
+		}
+
+		const long total = static_cast<long>(clients.size()) * iterations;
+		while (completed_count < total)
+		{
+			std::this_thread::sleep_for(std::chrono::microseconds(100));
+		}
+
+		const double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+		std::printf("pipelined writes=%ld applied=%ld time=%.3fs throughput=%.0f/s\n", total, applied_count.load(), seconds,
+			static_cast<double>(total) / seconds);
+	}
+}
+
+int main(int argc, char** argv)
+{
+	const long client_count = argc > 1 ? std::max(1L, std::strtol(argv[1], nullptr, 10)) : 100;
+	const long iterations = argc > 2 ? std::max(1L, std::strtol(argv[2], nullptr, 10)) : 200;
+	const long interval = argc > 3 ? std::max(0L, std::strtol(argv[3], nullptr, 10)) : 0;
+	const std::string path = "/tmp/screen_brightness_broker_benchmark_" + std::to_string(getpid()) + ".sock";
+
+	screen_brightness::FakeMonitorBackend backend;
+	const DisplayHandle display = backend.AddDisplay({ "fake0", 0, 50, 100 });
+	screen_brightness::BrokerServer server(backend, screen_brightness::Clock::Steady(), std::chrono::milliseconds(interval), true);
+	if (server.Listen(path) != MonitorStatus::kOk)
+	{
+		std::fprintf(stderr, "broker_benchmark: cannot listen on %s\n", path.c_str());
+		return 1;
+	}
+
+	server.Start();
+	auto clients = ConnectClients(path, client_count);
+	std::printf("clients=%ld iterations=%ld interval=%ldms\n", client_count, iterations, interval);
+	RunRoundTrips(clients, display, iterations);
+	RunPipelined(clients, display, iterations);
+
+	const screen_brightness::BrokerServerMetrics metrics = server.metrics();
+	std::printf("broker    requests=%llu shared_reads=%llu coalesced_writes=%llu bus_writes=%ld\n",
+		static_cast<unsigned long long>(metrics.request_count), static_cast<unsigned long long>(metrics.shared_read_count),
+		static_cast<unsigned long long>(metrics.coalesced_write_count), backend.set_count());
+	clients.clear();
+	server.Stop();
+	return 0;
+}
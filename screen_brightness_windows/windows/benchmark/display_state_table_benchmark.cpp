@@ -0,0 +1,139 @@
+// Read throughput of the display state table with concurrent readers, against the same state behind a mutex.
+//
+// usage: display_state_table_benchmark [milliseconds per run] [write period in microseconds]
+//
+// One writer publishes a new state every write period, 0 for as fast as it can, while 1, 2, 4 and 8 readers read
+// the state in a loop. Readers of the table only retry while a write is in flight, so their throughput should scale
+// with the reader count; readers of the mutex contend with each other.
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "screen_brightness_windows/display_state_table.h"
+
+namespace
+{
+	using screen_brightness::DisplayHandle;
+	using screen_brightness::DisplayStateTable;
+	using screen_brightness::PublishedDisplayState;
+
+	using Clock = std::chrono::steady_clock;
+
+	constexpr DisplayHandle kDisplay = 1;
+
+	PublishedDisplayState MakeState(const long value)
+	{
+		PublishedDisplayState state;
+		state.display = kDisplay;
+		state.current = value;
+		state.target = value;
+		state.minimum = 0;
+		state.maximum = 100;
+		state.system = 50;
+		return state;
+	}
+
+	// The baseline: a copy of the state under a lock.
+	class LockedState final
+	{
+	public:
+		void Publish(const PublishedDisplayState& state)
+		{
+			std::lock_guard<std::mutex> lock(mutex_);
+			state_ = state;
+		}
+
+		bool Read(DisplayHandle, PublishedDisplayState& state)
+		{
+			std::lock_guard<std::mutex> lock(mutex_);
+			state = state_;
+			return true;
+		}
+
+	private:
+		std::mutex mutex_;
+
+		PublishedDisplayState state_;
+	};
+
+	// Returns the reads per second of all readers together.
+	template <typename Table>
+	double Run(Table& table, const int reader_count, const std::chrono::milliseconds duration, const std::chrono::microseconds write_period)
+	{
+		std::atomic<bool> is_running{ true };
+		std::atomic<long long> read_count{ 0 };
+		std::atomic<long> torn_count{ 0 };
+		std::vector<std::thread> readers;
+		for (int reader = 0; reader < reader_count; ++reader)
+		{
+			readers.emplace_back([&table, &is_running, &read_count, &torn_count]
+				{
+					long long reads = 0;
+					PublishedDisplayState state;
+					while (is_running.load(std::memory_order_relaxed))
+					{
+						if (!table.Read(kDisplay, state) || state.current != state.target)
+						{
+							torn_count.fetch_add(1, std::memory_order_relaxed);
+						}
+
+						++reads;
+					}
+
+					read_count.fetch_add(reads, std::memory_order_relaxed);
+				});
+		}
+
+		const auto start = Clock::now();
+		long value = 0;
+		while (Clock::now() - start < duration)
+		{
+			table.Publish(MakeState(++value % 101));
+			if (write_period.count() > 0)
+			{
+				std::this_thread::sleep_for(write_period);
+			}
+		}
+
+		is_running.store(false, std::memory_order_relaxed);
+		for (std::thread& reader : readers)
+		{
+			reader.join();
+		}
+
+		const double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+		if (torn_count.load() != 0)
+		{
+			std::fprintf(stderr, "display_state_table_benchmark: %ld inconsistent reads\n", torn_count.load());
+		}
+
+		return static_cast<double>(read_count.load()) / seconds;
+	}
+}
+
+int main(int argc, char** argv)
+{
+	const std::chrono::milliseconds duration(argc > 1 ? std::max(1L, std::strtol(argv[1], nullptr, 10)) : 500);
+	const std::chrono::microseconds write_period(argc > 2 ? std::max(0L, std::strtol(argv[2], nullptr, 10)) : 1000);
+	std::printf("write period %lldus, %u hardware threads\n", static_cast<long long>(write_period.count()), std::thread::hardware_concurrency());
+
+	for (const int reader_count : { 1, 2, 4, 8 })
+	{
+		DisplayStateTable table;
+		LockedState locked_state;
+		table.Publish(MakeState(0));
+		locked_state.Publish(MakeState(0));
+		const double table_rate = Run(table, reader_count, duration, write_period);
+		const double locked_rate = Run(locked_state, reader_count, duration, write_period);
+		std::printf("readers=%d seqlock=%.1fM reads/s (%.1fns/read/reader) mutex=%.1fM reads/s (%.1fns/read/reader)\n", reader_count,
+			table_rate / 1e6, 1e9 * reader_count / table_rate, locked_rate / 1e6, 1e9 * reader_count / locked_rate);
+	}
+
+	return 0;
+}
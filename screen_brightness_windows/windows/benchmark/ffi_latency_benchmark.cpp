@@ -0,0 +1,129 @@
+// Latency of the dart:ffi C ABI against a stand-in for the plugin, whose platform thread is a plain task thread.
+//
+// usage: ffi_latency_benchmark [iterations]
+//
+// A cached read is an atomic load, so it is timed in batches. A write is timed from the call until its subscription
+// callback and its completion callback run on the platform thread; this is the native part of what a Dart caller
+// waits for, without the hop from a NativeCallable.listener to the isolate.
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+#include "ffi_test_host.h"
+
+namespace
+{
+	using Clock = std::chrono::steady_clock;
+
+	constexpr long kBatchSize = 64;
+
+	struct Timestamps
+	{
+		std::atomic<std::int64_t> changed{ 0 };
+
+		std::atomic<std::int64_t> completed{ 0 };
+
+		std::atomic<std::int32_t> status{ SCREEN_BRIGHTNESS_FFI_OK };
+	};
+
+	std::int64_t Now()
+	{
+		return std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now().time_since_epoch()).count();
+	}
+
+	void OnChanged(double, void* user_data)
+	{
+		static_cast<Timestamps*>(user_data)->changed.store(Now(), std::memory_order_release);
+	}
+
+	void OnCompleted(std::int64_t, const std::int32_t status, void* user_data)
+	{
+		auto* timestamps = static_cast<Timestamps*>(user_data);
+		timestamps->status.store(status, std::memory_order_relaxed);
+		timestamps->completed.store(Now(), std::memory_order_release);
+	}
+
+	double Percentile(std::vector<double>& samples, const double percentile)
+	{
+		std::sort(samples.begin(), samples.end());
+		const size_t index = static_cast<size_t>(percentile * static_cast<double>(samples.size() - 1));
+		return samples[index];
+	}
+
+	void Print(const char* name, std::vector<double>& samples, const char* unit)
+	{
+		std::printf("%-16s n=%zu p50=%.2f%s p99=%.2f%s p999=%.2f%s max=%.2f%s\n", name, samples.size(), Percentile(samples, 0.5), unit,
+			Percentile(samples, 0.99), unit, Percentile(samples, 0.999), unit, Percentile(samples, 1.0), unit);
+	}
+}
+
+int main(int argc, char** argv)
+{
+	const long iterations = argc > 1 ? std::max(kBatchSize, std::strtol(argv[1], nullptr, 10)) : 100000;
+	if (ScreenBrightnessFfiTestHostStart(0.5, 0) != SCREEN_BRIGHTNESS_FFI_OK)
+	{
+		std::fprintf(stderr, "ffi_latency_benchmark: cannot start the host\n");
+		return 1;
+	}
+
+	std::vector<double> read_samples;
+	double sum = 0;
+	for (long batch = 0; batch < iterations; batch += kBatchSize)
+	{
+		const auto start = Clock::now();
+		for (long iteration = 0; iteration < kBatchSize; ++iteration)
+		{
+			sum += ScreenBrightnessFfiGetCachedBrightness();
+		}
+
+		read_samples.push_back(std::chrono::duration<double, std::nano>(Clock::now() - start).count() / kBatchSize);
+	}
+
+	Timestamps timestamps;
+	const std::int64_t subscription_id = ScreenBrightnessFfiSubscribe(OnChanged, &timestamps);
+	std::vector<double> changed_samples, completed_samples;
+	const long write_count = std::max(1L, iterations / 10);
+	for (long iteration = 0; iteration < write_count; ++iteration)
+	{
+		timestamps.changed.store(0, std::memory_order_relaxed);
+		timestamps.completed.store(0, std::memory_order_relaxed);
+		const std::int64_t start = Now();
+
+		// alternates so that every write changes the brightness and is reported
+		(void)ScreenBrightnessFfiSetBrightnessAsync(iteration % 2 == 0 ? 0.2 : 0.8, OnCompleted, &timestamps);
+		std::int64_t completed = 0;
+		while ((completed = timestamps.completed.load(std::memory_order_acquire)) == 0)
+		{
+		}
+
+		if (timestamps.status.load(std::memory_order_relaxed) != SCREEN_BRIGHTNESS_FFI_OK)
+		{
+			std::fprintf(stderr, "ffi_latency_benchmark: write failed: %s\n",
+				ScreenBrightnessFfiGetStatusMessage(timestamps.status.load(std::memory_order_relaxed)));
+			ScreenBrightnessFfiTestHostStop();
+			return 1;
+		}
+
+		changed_samples.push_back(static_cast<double>(timestamps.changed.load(std::memory_order_acquire) - start) / 1000);
+		completed_samples.push_back(static_cast<double>(completed - start) / 1000);
+	}
+
+	ScreenBrightnessFfiUnsubscribe(subscription_id);
+	ScreenBrightnessFfiTestHostStop();
+
+	// keeps the reads from being optimised away
+	if (sum < -static_cast<double>(iterations))
+	{
+		return 1;
+	}
+
+	Print("cached read", read_samples, "ns");
+	Print("write->notify", changed_samples, "us");
+	Print("write->complete", completed_samples, "us");
+	return 0;
+}
@@ -0,0 +1,65 @@
+// Throughput of MccsCapabilities::Parse over a real-world capability string and a large synthetic one.
+//
+// usage: mccs_capabilities_benchmark [iterations]
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+
+#include "screen_brightness_windows/mccs_capabilities.h"
+
+namespace
+{
+	using screen_brightness::MccsCapabilities;
+
+	// Every VCP code, every fourth with a value list, which is more than any monitor lists.
+	std::string CreateLargeCapabilities()
+	{
+		std::string capabilities = "(prot(monitor)type(lcd)model(synthetic)cmds(01 02 03 07 0C E3 F3)vcp(";
+		char token[8];
+		for (int code = 0; code < 256; ++code)
+		{
+			std::snprintf(token, sizeof(token), "%02X", code);
+			capabilities += token;
+			if (code % 4 == 0)
+			{
+				capabilities += "(01 02 03 04)";
+			}
+
+			capabilities += ' ';
+		}
+
+		return capabilities + ")mccs_ver(2.2))";
+	}
+
+	void RunBenchmark(const char* name, const std::string& capabilities, const long iterations)
+	{
+		using Clock = std::chrono::steady_clock;
+
+		MccsCapabilities table;
+		size_t code_count = 0;
+		const auto start = Clock::now();
+		for (long iteration = 0; iteration < iterations; ++iteration)
+		{
+			table.Parse(capabilities);
+			code_count += table.code_count();
+		}
+
+		const double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+		const double bytes = static_cast<double>(capabilities.size()) * static_cast<double>(iterations);
+		std::printf("%-10s bytes=%zu codes=%zu parse=%.0fns throughput=%.1fMB/s\n", name, capabilities.size(),
+			code_count / static_cast<size_t>(iterations), seconds * 1e9 / static_cast<double>(iterations), bytes / seconds / 1e6);
+	}
+}
+
+int main(int argc, char** argv)
+{
+	const long iterations = argc > 1 ? std::max(1L, std::strtol(argv[1], nullptr, 10)) : 100000;
+	RunBenchmark("real", "(prot(monitor)type(LCD)model(U2720Q)cmds(01 02 03 07 0C E3 F3)vcp(02 04 05 08 10 12 14(05 08 0B 0C) 16 18 1A "
+		"52 60( 0F 10 11 12) AA(01 02 04) AC AE B2 B6 C6 C8 C9 CC(02 03 04 05 06 09 0A 0D 0E) D6(01 04 05) DC(00 03 05) DF E0 E1 "
+		"E2(00 1D 02 04 0E 12 14) F0(0C) F1 F2 FD)mswhql(1)asset_eep(40)mccs_ver(2.1))", iterations);
+	RunBenchmark("synthetic", CreateLargeCapabilities(), iterations / 10 + 1);
+	return 0;
+}
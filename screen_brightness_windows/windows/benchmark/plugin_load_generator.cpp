@@ -0,0 +1,390 @@
+// Load on the plugin through its channels, the way a Flutter app drives it, with the plugin built on Linux over the
+// test-only shim of the Flutter client wrapper and the Windows APIs in test/shim.
+//
+// usage: plugin_load_generator [mix] [calls per second] [milliseconds per mix] [display count] [DDC/CI latency in ms]
+//
+// mix is one of
+//   slider-drag            setApplicationScreenBrightness along a drag, as a Slider's onChanged sends it
+//   lifecycle-storm        minimize, restore, deactivate and activate messages on the top-level window between
+//                          brightness changes, with auto reset on
+//   multi-display-presets  the window moving between the displays, with a preset applied on each
+//   all                    each of them in turn, the default
+//
+// Every call is encoded with the standard method codec and goes through the messenger into the plugin's
+// HandleMethodCall, whose reply is decoded; every window message goes through the runner's top-level window
+// procedure into the plugin's delegate. All four event channels are listened to. Calls are issued at the rate, or as
+// fast as the plugin returns once it falls behind. Each mix reports the calls per second it achieved, the time from
+// a call until its reply, and the events Dart received per second. The fake monitors answer every DDC/CI call after
+// the latency, and the scheduler paces writes as for a real monitor, so the brightness calls show what the platform
+// thread waits for.
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <unistd.h>
+
+#include <fake_flutter_engine.h>
+#include <fake_windows.h>
+#include <flutter/plugin_registrar.h>
+
+#include "screen_brightness_windows/screen_brightness_windows_plugin_c_api.h"
+
+namespace
+{
+	using Clock = std::chrono::steady_clock;
+
+	using flutter::EncodableMap;
+	using flutter::EncodableValue;
+
+	constexpr const char* kMethodChannel = "github.com/aaassseee/screen_brightness";
+
+	constexpr const char* kEventChannels[] = {
+		"github.com/aaassseee/screen_brightness/system_brightness_changed",
+		"github.com/aaassseee/screen_brightness/application_brightness_changed",
+		"github.com/aaassseee/screen_brightness/display_topology_changed",
+		"github.com/aaassseee/screen_brightness/stall_warning",
+	};
+
+	constexpr const char* kMixes[] = { "slider-drag", "lifecycle-storm", "multi-display-presets" };
+
+	struct Options
+	{
+		std::string mix = "all";
+
+		double rate = 100;
+
+		std::chrono::milliseconds duration{ 2000 };
+
+		int display_count = 2;
+
+		std::chrono::milliseconds latency{ 0 };
+	};
+
+	constexpr const char* kEventNames[] = { "system", "application", "topology", "stall" };
+
+	constexpr size_t kEventChannelCount = sizeof(kEventChannels) / sizeof(kEventChannels[0]);
+
+	struct Counters
+	{
+		std::atomic<long> events[kEventChannelCount] = {};
+
+		// events Dart could not decode, or errors
+		std::atomic<long> bad_events{ 0 };
+	};
+
+	double Percentile(std::vector<double>& samples, const double percentile)
+	{
+		std::sort(samples.begin(), samples.end());
+		const size_t index = static_cast<size_t>(percentile * static_cast<double>(samples.size() - 1));
+		return samples[index];
+	}
+
+	// The app: a top-level window with the engine's view, the plugin registered with the engine, and Dart listening to
+	// every event channel.
+	class LoadGenerator final
+	{
+	public:
+		explicit LoadGenerator(const Options& options) : options_(options)
+		{
+			for (int index = 0; index < options.display_count; ++index)
+			{
+				fake_windows::MonitorConfig config;
+				config.rect = RECT{ index * 1920, 0, (index + 1) * 1920, 1080 };
+				config.latency = options.latency;
+				displays_.push_back(fake_windows::AddMonitor(config));
+			}
+
+			window_ = fake_windows::CreateTopLevelWindow(displays_.front());
+			engine_ = std::make_unique<fake_flutter::FakeFlutterEngine>(window_);
+			ScreenBrightnessWindowsPluginCApiRegisterWithRegistrar(engine_->GetRegistrarForPlugin("ScreenBrightnessWindowsPluginCApi"));
+			for (size_t index = 0; index < kEventChannelCount; ++index)
+			{
+				const fake_flutter::Envelope reply = engine_->Listen(kEventChannels[index], [this, index](const fake_flutter::Envelope& event)
+					{
+						++counters_.events[index];
+						if (!event.is_present || event.is_error)
+						{
+							++counters_.bad_events;
+						}
+					});
+				if (!reply.is_present || reply.is_error)
+				{
+					std::fprintf(stderr, "plugin_load_generator: cannot listen to %s\n", kEventChannels[index]);
+				}
+			}
+
+			(void)fake_windows::DispatchMessages();
+		}
+
+		~LoadGenerator()
+		{
+			for (const char* channel : kEventChannels)
+			{
+				(void)engine_->Cancel(channel);
+			}
+
+			engine_.reset();
+			fake_windows::DestroyWindow(window_);
+		}
+
+		void Run(const std::string& mix)
+		{
+			// each mix starts from the system brightness
+			(void)Call("resetApplicationScreenBrightness");
+			(void)fake_windows::DispatchMessages();
+
+			std::vector<double> call_latencies;
+			std::vector<double> message_latencies;
+			long error_count = 0;
+			long start_events[kEventChannelCount] = {};
+			for (size_t index = 0; index < kEventChannelCount; ++index)
+			{
+				start_events[index] = counters_.events[index].load();
+			}
+
+			const long start_off_thread = static_cast<long>(engine_->messenger().off_platform_thread_message_count());
+			const Clock::duration period = std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(1.0 / options_.rate));
+			const Clock::time_point start = Clock::now();
+			Clock::time_point next_time = start;
+			for (long step = 0; Clock::now() - start < options_.duration; ++step)
+			{
+				std::this_thread::sleep_until(next_time);
+				next_time = std::max(next_time + period, Clock::now());
+				if (mix == "slider-drag")
+				{
+					RunSliderDragStep(step, call_latencies, error_count);
+				}
+				else if (mix == "lifecycle-storm")
+				{
+					RunLifecycleStormStep(step, call_latencies, message_latencies, error_count);
+				}
+				else
+				{
+					RunMultiDisplayPresetsStep(step, call_latencies, message_latencies, error_count);
+				}
+
+				(void)fake_windows::DispatchMessages();
+			}
+
+			const double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+			long events[kEventChannelCount] = {};
+			long event_count = 0;
+			for (size_t index = 0; index < kEventChannelCount; ++index)
+			{
+				events[index] = counters_.events[index].load() - start_events[index];
+				event_count += events[index];
+			}
+
+			std::printf("%-22s calls=%zu %.1f/s errors=%ld events=%ld %.1f/s (", mix.c_str(), call_latencies.size(),
+				static_cast<double>(call_latencies.size()) / seconds, error_count, event_count, static_cast<double>(event_count) / seconds);
+			for (size_t index = 0; index < kEventChannelCount; ++index)
+			{
+				std::printf("%s%s=%ld", index == 0 ? "" : " ", kEventNames[index], events[index]);
+			}
+
+			std::printf(")");
+			if (const long off_thread = static_cast<long>(engine_->messenger().off_platform_thread_message_count()) - start_off_thread; off_thread > 0)
+			{
+				std::printf(" off_platform_thread_events=%ld", off_thread);
+			}
+
+			std::printf("\n");
+			Print("  method call", call_latencies);
+			Print("  window message", message_latencies);
+		}
+
+		[[nodiscard]] long bad_event_count() const { return counters_.bad_events.load(); }
+
+	private:
+		Options options_;
+
+		std::vector<HMONITOR> displays_;
+
+		HWND window_ = nullptr;
+
+		std::unique_ptr<fake_flutter::FakeFlutterEngine> engine_;
+
+		Counters counters_;
+
+		size_t display_index_ = 0;
+
+		static void Print(const char* name, std::vector<double>& samples)
+		{
+			if (samples.empty())
+			{
+				return;
+			}
+
+			std::printf("%-22s n=%zu p50=%.3fms p99=%.3fms p999=%.3fms max=%.3fms\n", name, samples.size(), Percentile(samples, 0.5),
+				Percentile(samples, 0.99), Percentile(samples, 0.999), Percentile(samples, 1.0));
+		}
+
+		// Returns the milliseconds from the call until its reply.
+		double Call(const char* method, const EncodableValue& arguments = EncodableValue(), bool* is_error = nullptr)
+		{
+			const Clock::time_point start = Clock::now();
+			const fake_flutter::Envelope reply = engine_->InvokeMethod(kMethodChannel, method, arguments);
+			const double milliseconds = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+			if (is_error != nullptr)
+			{
+				*is_error = !reply.is_present || reply.is_error;
+			}
+
+			return milliseconds;
+		}
+
+		void CallAndRecord(const char* method, const EncodableValue& arguments, std::vector<double>& latencies, long& error_count)
+		{
+			bool is_error = false;
+			latencies.push_back(Call(method, arguments, &is_error));
+			error_count += is_error ? 1 : 0;
+		}
+
+		// Returns the milliseconds the top-level window procedure took to handle the message.
+		double SendWindowMessage(const UINT message, const WPARAM wparam)
+		{
+			fake_windows::PostWindowMessage(window_, message, wparam, 0);
+			const Clock::time_point start = Clock::now();
+			(void)fake_windows::DispatchMessages();
+			return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+		}
+
+		static EncodableValue Brightness(const double brightness)
+		{
+			return EncodableValue(EncodableMap{ { EncodableValue("brightness"), EncodableValue(brightness) } });
+		}
+
+		// A drag from one end of the slider to the other and back, 100 steps each way.
+		void RunSliderDragStep(const long step, std::vector<double>& call_latencies, long& error_count)
+		{
+			const long position = step % 200;
+			const double brightness = (position < 100 ? position : 200 - position) / 100.0;
+			CallAndRecord("setApplicationScreenBrightness", Brightness(brightness), call_latencies, error_count);
+		}
+
+		void RunLifecycleStormStep(const long step, std::vector<double>& call_latencies, std::vector<double>& message_latencies, long& error_count)
+		{
+			switch (step % 6)
+			{
+			case 0:
+				CallAndRecord("setAutoReset", EncodableValue(EncodableMap{ { EncodableValue("isAutoReset"), EncodableValue(true) } }), call_latencies, error_count);
+				break;
+			case 1:
+				CallAndRecord("setApplicationScreenBrightness", Brightness(step % 12 == 1 ? 0.2 : 0.9), call_latencies, error_count);
+				break;
+			case 2:
+				message_latencies.push_back(SendWindowMessage(WM_SIZE, SIZE_MINIMIZED));
+				break;
+			case 3:
+				message_latencies.push_back(SendWindowMessage(WM_SIZE, SIZE_RESTORED));
+				break;
+			case 4:
+				message_latencies.push_back(SendWindowMessage(WM_ACTIVATEAPP, 0));
+				break;
+			default:
+				message_latencies.push_back(SendWindowMessage(WM_ACTIVATEAPP, 1));
+				break;
+			}
+		}
+
+		void RunMultiDisplayPresetsStep(const long step, std::vector<double>& call_latencies, std::vector<double>& message_latencies, long& error_count)
+		{
+			constexpr double kPresets[] = { 0.25, 0.5, 0.75, 1.0 };
+			switch (step % 4)
+			{
+			case 0:
+			{
+				display_index_ = (display_index_ + 1) % displays_.size();
+				fake_windows::MoveWindowToMonitor(window_, displays_[display_index_]);
+				const Clock::time_point start = Clock::now();
+				(void)fake_windows::DispatchMessages();
+				message_latencies.push_back(std::chrono::duration<double, std::milli>(Clock::now() - start).count());
+				break;
+			}
+			case 1:
+				CallAndRecord("setApplicationScreenBrightness", Brightness(kPresets[(step / 4) % 4]), call_latencies, error_count);
+				break;
+			case 2:
+				CallAndRecord("getApplicationScreenBrightness", EncodableValue(), call_latencies, error_count);
+				break;
+			default:
+				CallAndRecord("getSystemScreenBrightness", EncodableValue(), call_latencies, error_count);
+				break;
+			}
+		}
+	};
+}
+
+int main(int argc, char** argv)
+{
+	Options options;
+	options.mix = argc > 1 ? argv[1] : "all";
+	options.rate = argc > 2 ? std::max(1.0, std::strtod(argv[2], nullptr)) : 100;
+	options.duration = std::chrono::milliseconds(argc > 3 ? std::max(1L, std::strtol(argv[3], nullptr, 10)) : 2000);
+	options.display_count = argc > 4 ? static_cast<int>(std::clamp(std::strtol(argv[4], nullptr, 10), 1L, 16L)) : 2;
+	options.latency = std::chrono::milliseconds(argc > 5 ? std::max(0L, std::strtol(argv[5], nullptr, 10)) : 0);
+
+	std::vector<std::string> mixes;
+	if (options.mix == "all")
+	{
+		mixes.assign(std::begin(kMixes), std::end(kMixes));
+	}
+	else if (std::find_if(std::begin(kMixes), std::end(kMixes), [&options](const char* mix) { return options.mix == mix; }) != std::end(kMixes))
+	{
+		mixes.push_back(options.mix);
+	}
+	else
+	{
+		std::fprintf(stderr, "plugin_load_generator: unknown mix %s\n", options.mix.c_str());
+		return 1;
+	}
+
+	// the restore journal of this run stays out of the user's
+	char state_directory[] = "/tmp/plugin_load_generator_XXXXXX";
+	if (mkdtemp(state_directory) == nullptr)
+	{
+		std::fprintf(stderr, "plugin_load_generator: cannot create a state directory\n");
+		return 1;
+	}
+
+	setenv("XDG_STATE_HOME", state_directory, 1);
+
+	// the plugin logs every stall, which the stall_warning events count
+	std::cout.setstate(std::ios::failbit);
+	std::printf("rate=%.0f/s duration=%lldms displays=%d latency=%lldms\n", options.rate, static_cast<long long>(options.duration.count()),
+		options.display_count, static_cast<long long>(options.latency.count()));
+
+	long bad_event_count = 0;
+	{
+		LoadGenerator generator(options);
+		for (const std::string& mix : mixes)
+		{
+			generator.Run(mix);
+		}
+
+		bad_event_count = generator.bad_event_count();
+	}
+
+	flutter::PluginRegistrarManager::GetInstance()->Reset();
+	fake_windows::Reset();
+	const std::string journal = std::string(state_directory) + "/screen_brightness_restore.journal";
+	std::remove(journal.c_str());
+	rmdir(state_directory);
+	if (bad_event_count > 0)
+	{
+		std::fprintf(stderr, "plugin_load_generator: %ld events were errors or could not be decoded\n", bad_event_count);
+		return 1;
+	}
+
+	return 0;
+}
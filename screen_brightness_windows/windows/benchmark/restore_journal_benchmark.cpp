@@ -0,0 +1,96 @@
+// Cost of journaling a brightness override, which is done on every override write, e.g. each step of an animation.
+//
+// usage: restore_journal_benchmark [iterations] [journal]
+//
+// Updates go to a memory mapped file without a flush, so they should take well under a microsecond. Calls are timed
+// in batches, as a clock read costs about as much as an update; the percentiles are of the per-call time within a
+// batch.
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+#include "screen_brightness_windows/restore_journal.h"
+
+namespace
+{
+	using screen_brightness::DisplayIdentity;
+	using screen_brightness::MonitorStatus;
+	using screen_brightness::RestoreJournal;
+
+	using Clock = std::chrono::steady_clock;
+
+	constexpr long kBatchSize = 64;
+
+	constexpr std::uint64_t kDisplayCount = 4;
+
+	double Percentile(std::vector<double>& samples, const double percentile)
+	{
+		std::sort(samples.begin(), samples.end());
+		const size_t index = static_cast<size_t>(percentile * static_cast<double>(samples.size() - 1));
+		return samples[index];
+	}
+
+	template <typename Update>
+	void Measure(const char* name, const long iterations, Update update)
+	{
+		std::vector<double> samples;
+		samples.reserve(static_cast<size_t>(iterations / kBatchSize + 1));
+		const auto start = Clock::now();
+		for (long batch = 0; batch < iterations; batch += kBatchSize)
+		{
+			const auto batch_start = Clock::now();
+			for (long iteration = batch; iteration < batch + kBatchSize; ++iteration)
+			{
+				update(iteration);
+			}
+
+			samples.push_back(std::chrono::duration<double, std::nano>(Clock::now() - batch_start).count() / kBatchSize);
+		}
+
+		const double total = std::chrono::duration<double, std::nano>(Clock::now() - start).count();
+		std::printf("%-14s n=%zu mean=%.1fns p50=%.1fns p99=%.1fns p999=%.1fns max=%.1fns\n", name, samples.size() * kBatchSize,
+			total / static_cast<double>(samples.size() * kBatchSize), Percentile(samples, 0.5), Percentile(samples, 0.99),
+			Percentile(samples, 0.999), Percentile(samples, 1.0));
+	}
+}
+
+int main(int argc, char** argv)
+{
+	const long iterations = argc > 1 ? std::max(kBatchSize, std::strtol(argv[1], nullptr, 10)) : 1000000;
+	const std::string path = argc > 2 ? argv[2] : "restore_journal_benchmark.journal";
+	RestoreJournal journal;
+	if (journal.Open(path) != MonitorStatus::kOk)
+	{
+		std::fprintf(stderr, "restore_journal_benchmark: cannot open %s\n", path.c_str());
+		return 1;
+	}
+
+	// identities which share a probe sequence, the worst case of the slot lookup
+	auto identity = [](const long iteration)
+		{
+			return DisplayIdentity{ (static_cast<std::uint64_t>(iteration) % kDisplayCount + 1) * RestoreJournal::kSlotCount };
+		};
+
+	Measure("record", iterations, [&journal, &identity](const long iteration)
+		{
+			journal.Record(identity(iteration), iteration % 101, 50);
+		});
+	Measure("record+clear", iterations, [&journal, &identity](const long iteration)
+		{
+			journal.Record(identity(iteration), iteration % 101, 50);
+			journal.Clear(identity(iteration));
+		});
+
+	journal.Close();
+	if (argc <= 2)
+	{
+		std::remove(path.c_str());
+	}
+
+	return 0;
+}
@@ -0,0 +1,205 @@
+// Replays a recorded monitor trace through the bus scheduler on a simulated clock, as a deterministic regression
+// benchmark for displays whose timing cannot be reproduced otherwise.
+//
+// usage: trace_replay_benchmark [trace]
+//
+// Every display call of the trace is submitted at its recorded start, brightness writes as coalescing animation
+// steps and reads as polls, and takes its recorded time on the bus. The simulated numbers only change with the
+// scheduling, so they can be compared across builds. Without a trace, a synthetic one of a slow display driven by a
+// 60 Hz animation is used.
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <map>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "screen_brightness_windows/ddc_scheduler.h"
+#include "screen_brightness_windows/monitor_trace.h"
+
+namespace
+{
+	using screen_brightness::DdcPriority;
+	using screen_brightness::DdcScheduler;
+	using screen_brightness::DisplayHandle;
+	using screen_brightness::ManualClock;
+	using screen_brightness::MonitorStatus;
+	using screen_brightness::MonitorTraceCall;
+	using screen_brightness::MonitorTraceRecord;
+	using screen_brightness::ReplayMonitorBackend;
+
+	using std::chrono::milliseconds;
+
+	double ToMilliseconds(const screen_brightness::Clock::duration duration)
+	{
+		return std::chrono::duration<double, std::milli>(duration).count();
+	}
+
+	double Percentile(std::vector<double> samples, const double percentile)
+	{
+		if (samples.empty())
+		{
+			return 0;
+		}
+
+		std::sort(samples.begin(), samples.end());
+		return samples[static_cast<size_t>(percentile * static_cast<double>(samples.size() - 1))];
+	}
+
+	// Ten seconds of a 60 Hz animation on a monitor answering in 30 to 200 ms, which fails one command in fifty, with
+	// a poll every second.
+	std::vector<MonitorTraceRecord> CreateSlowDisplayTrace()
+	{
+		std::mt19937 random(20261019);
+		std::uniform_int_distribution<int> latency(30, 200);
+		std::uniform_int_distribution<int> failure(0, 49);
+		std::vector<MonitorTraceRecord> records;
+		for (int frame = 0; frame < 600; ++frame)
+		{
+			MonitorTraceRecord record;
+			record.display = 1;
+			record.start = std::chrono::microseconds(frame * 16667);
+			record.duration = milliseconds(latency(random));
+			if (frame % 60 == 0)
+			{
+				record.call = MonitorTraceCall::kGetScreenBrightness;
+				record.status = failure(random) == 0 ? MonitorStatus::kGetBrightnessFailed : MonitorStatus::kOk;
+				record.values[1] = frame / 6;
+				record.values[2] = 100;
+				records.push_back(record);
+				record.start += std::chrono::microseconds(1);
+			}
+
+			record.call = MonitorTraceCall::kSetScreenBrightness;
+			record.status = failure(random) == 0 ? MonitorStatus::kSetBrightnessFailed : MonitorStatus::kOk;
+			record.values[0] = frame / 6;
+			records.push_back(record);
+		}
+
+		return records;
+	}
+
+	void SubmitRecord(DdcScheduler& scheduler, ReplayMonitorBackend& backend, const MonitorTraceRecord& record,
+		ManualClock& clock, std::vector<double>& latencies)
+	{
+		const auto submit_time = clock.Now();
+		auto completion = [&clock, &latencies, submit_time](const MonitorStatus status)
+			{
+				if (status != MonitorStatus::kPreempted)
+				{
+					latencies.push_back(ToMilliseconds(clock.Now() - submit_time));
+				}
+			};
+
+		const DisplayHandle display = record.display;
+		long minimum = 0, brightness = 0, maximum = 0;
+		unsigned long current_value = 0, maximum_value = 0;
+		switch (record.call)
+		{
+		case MonitorTraceCall::kGetScreenBrightness:
+			scheduler.Submit(DdcPriority::kBackgroundPoll, screen_brightness::kDdcBrightnessRead,
+				[&backend, display, minimum, brightness, maximum]() mutable { return backend.GetScreenBrightness(display, minimum, brightness, maximum); }, completion);
+			break;
+
+		case MonitorTraceCall::kSetScreenBrightness:
+			scheduler.Submit(DdcPriority::kAnimationStep, screen_brightness::kDdcBrightnessWrite,
+				[&backend, display, value = static_cast<long>(record.values[0])] { return backend.SetScreenBrightness(display, value); }, completion);
+			break;
+
+		case MonitorTraceCall::kGetVcpFeature:
+			scheduler.Submit(DdcPriority::kUserWrite, screen_brightness::kDdcNoCoalescing,
+				[&backend, display, code = record.code, current_value, maximum_value]() mutable { return backend.GetVcpFeature(display, code, current_value, maximum_value); },
+				completion);
+			break;
+
+		case MonitorTraceCall::kSetVcpFeature:
+			scheduler.Submit(DdcPriority::kUserWrite, screen_brightness::GetVcpWriteCoalescingKey(record.code),
+				[&backend, display, code = record.code, value = static_cast<unsigned long>(record.values[0])] { return backend.SetVcpFeature(display, code, value); },
+				completion);
+			break;
+
+		case MonitorTraceCall::kGetCapabilitiesString:
+			scheduler.Submit(DdcPriority::kUserWrite, screen_brightness::kDdcNoCoalescing,
+				[&backend, display] { std::string capabilities; return backend.GetCapabilitiesString(display, capabilities); }, completion);
+			break;
+
+		default:
+			break;
+		}
+	}
+
+	// Replays the calls of one display, whose bus is independent of the others.
+	void ReplayDisplay(const DisplayHandle display, const std::vector<MonitorTraceRecord>& records)
+	{
+		ManualClock clock;
+		ReplayMonitorBackend backend(records, clock);
+		DdcScheduler scheduler(clock, DdcScheduler::kMccsMinimumCommandInterval);
+		std::vector<double> latencies;
+		const auto origin = clock.Now();
+		auto recorded_end = origin;
+		const auto wall_start = std::chrono::steady_clock::now();
+		for (const MonitorTraceRecord& record : records)
+		{
+			// the bus works through its queue until the next call comes in
+			while (clock.Now() - origin < record.start && scheduler.RunNext())
+			{
+			}
+
+			clock.SleepUntil(origin + record.start);
+			SubmitRecord(scheduler, backend, record, clock, latencies);
+			recorded_end = std::max(recorded_end, origin + record.start + record.duration);
+		}
+
+		scheduler.RunUntilIdle();
+		const double wall_time = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - wall_start).count();
+		const screen_brightness::DdcSchedulerMetrics metrics = scheduler.metrics();
+		std::printf("display %llu calls=%zu recorded=%.1fms replayed=%.1fms\n", static_cast<unsigned long long>(display), records.size(),
+			ToMilliseconds(recorded_end - origin), ToMilliseconds(clock.Now() - origin));
+		std::printf("  bus commands=%llu preempted=%llu shed=%llu max_queue_depth=%zu\n",
+			static_cast<unsigned long long>(metrics.executed_count), static_cast<unsigned long long>(metrics.preempted_count),
+			static_cast<unsigned long long>(metrics.shed_count), metrics.maximum_queue_depth);
+		std::printf("  latency p50=%.1fms p99=%.1fms max=%.1fms\n", Percentile(latencies, 0.5), Percentile(latencies, 0.99),
+			Percentile(latencies, 1.0));
+		std::printf("  host time=%.0fus per call=%.2fus\n", wall_time, wall_time / static_cast<double>(records.size()));
+	}
+}
+
+int main(int argc, char** argv)
+{
+	std::vector<MonitorTraceRecord> records;
+	if (argc > 1)
+	{
+		if (screen_brightness::LoadMonitorTrace(argv[1], records) != MonitorStatus::kOk)
+		{
+			std::fprintf(stderr, "trace_replay_benchmark: cannot read %s\n", argv[1]);
+			return 1;
+		}
+	}
+	else
+	{
+		records = CreateSlowDisplayTrace();
+	}
+
+	std::map<DisplayHandle, std::vector<MonitorTraceRecord>> displays;
+	for (const MonitorTraceRecord& record : records)
+	{
+		if (record.call != MonitorTraceCall::kEnumerateDisplays && record.call != MonitorTraceCall::kGetPrimaryDisplay &&
+			record.call != MonitorTraceCall::kGetEdid)
+		{
+			displays[record.display].push_back(record);
+		}
+	}
+
+	for (auto& [display, display_records] : displays)
+	{
+		// records are stored as their calls finished
+		std::stable_sort(display_records.begin(), display_records.end(),
+			[](const MonitorTraceRecord& first, const MonitorTraceRecord& second) { return first.start < second.start; });
+		ReplayDisplay(display, display_records);
+	}
+
+	return 0;
+}
@@ -0,0 +1,125 @@
+#ifndef FLUTTER_PLUGIN_SCREEN_BRIGHTNESS_WINDOWS_PLUGIN_AMBIENT_BRIGHTNESS_H
+#define FLUTTER_PLUGIN_SCREEN_BRIGHTNESS_WINDOWS_PLUGIN_AMBIENT_BRIGHTNESS_H
+
+#include <chrono>
+#include <cstdint>
+#include <vector>
+
+#include "ambient_light.h"
+#include "brightness_service.h"
+#include "clock.h"
+
+namespace screen_brightness
+{
+	struct AmbientBrightnessPoint
+	{
+		double lux = 0;
+
+		// application brightness, 0.0 to 1.0
+		double brightness = 0;
+	};
+
+	struct AmbientBrightnessConfig
+	{
+		// Response curve by increasing lux. Between the points the brightness is interpolated linearly in log lux, as
+		// the eye perceives light, and beyond them it stays at the first or last point.
+		std::vector<AmbientBrightnessPoint> curve = { { 0, 0.1 }, { 10, 0.25 }, { 100, 0.5 }, { 1000, 0.8 }, { 10000, 1.0 } };
+
+		// time for the smoothed illuminance to cover 63% of a step of the light
+		Clock::duration time_constant = std::chrono::seconds(2);
+
+		// Relative change of the smoothed illuminance from the one last applied that is needed to apply it again. It
+		// takes more to darken, so that a passing shadow does not dim the display.
+		double brightening_threshold = 0.1;
+
+		double darkening_threshold = 0.2;
+
+		// smallest change worth a write, as every write is a DDC/CI command
+		double deadband = 0.01;
+
+		Clock::duration poll_interval = std::chrono::milliseconds(250);
+	};
+
+	struct AmbientBrightnessCounters
+	{
+		std::uint64_t poll_count = 0;
+
+		// readings of the source, and the samples in them
+		std::uint64_t reading_count = 0;
+
+		std::uint64_t sample_count = 0;
+
+		std::uint64_t write_count = 0;
+
+		std::uint64_t failed_write_count = 0;
+
+		// CPU time the polls took on their thread, writes included
+		std::chrono::nanoseconds cpu_time{};
+	};
+
+	// Sets the client's application brightness from the ambient light, without any per sample traffic leaving native
+	// code: the illuminance is smoothed with an exponential moving average, filtered by hysteresis, mapped through
+	// the response curve, and written like a setApplicationScreenBrightness call once it moved beyond the deadband.
+	// While enabled the controller owns the client's override; disabling resets it if the controller set it.
+	//
+	// Used on the client's thread.
+	class AmbientBrightnessController final
+	{
+	public:
+		AmbientBrightnessController(BrightnessClient& client, AmbientLightSource& source, Clock& clock);
+
+		AmbientBrightnessController(const AmbientBrightnessController&) = delete;
+
+		AmbientBrightnessController& operator=(const AmbientBrightnessController&) = delete;
+
+		[[nodiscard]] bool is_enabled() const { return is_enabled_; }
+
+		[[nodiscard]] const AmbientBrightnessConfig& config() const { return config_; }
+
+		// Replaces the configuration and starts over with the next reading.
+		void SetConfig(const AmbientBrightnessConfig& config);
+
+		void SetEnabled(bool is_enabled);
+
+		// Reads the sensor, applies a change, and returns when to poll next, or Clock::time_point::max() while
+		// disabled.
+		Clock::time_point Poll();
+
+		[[nodiscard]] const AmbientBrightnessCounters& counters() const { return counters_; }
+
+		// -1 before the first reading.
+		[[nodiscard]] double smoothed_lux() const { return smoothed_lux_; }
+
+		// The brightness the curve gives for the illuminance.
+		[[nodiscard]] static double MapIlluminance(const std::vector<AmbientBrightnessPoint>& curve, double lux);
+
+	private:
+		BrightnessClient& client_;
+
+		AmbientLightSource& source_;
+
+		Clock& clock_;
+
+		AmbientBrightnessConfig config_;
+
+		bool is_enabled_ = false;
+
+		Clock::time_point last_reading_time_{};
+
+		double smoothed_lux_ = -1;
+
+		// illuminance and brightness of the last write, -1 before the first
+		double applied_lux_ = -1;
+
+		double applied_brightness_ = -1;
+
+		// the client's override after the last write, to tell it from one set by someone else
+		double written_override_ = -1;
+
+		AmbientBrightnessCounters counters_;
+
+		void Reset();
+	};
+}
+
+#endif
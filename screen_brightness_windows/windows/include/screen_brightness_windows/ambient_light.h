@@ -0,0 +1,24 @@
+#ifndef FLUTTER_PLUGIN_SCREEN_BRIGHTNESS_WINDOWS_PLUGIN_AMBIENT_LIGHT_H
+#define FLUTTER_PLUGIN_SCREEN_BRIGHTNESS_WINDOWS_PLUGIN_AMBIENT_LIGHT_H
+
+#include <cstdint>
+
+namespace screen_brightness
+{
+	// Illuminance at the device from an ambient light sensor. Sources are polled, like InputActivitySource, so that
+	// the sensor's samples never leave native code.
+	class AmbientLightSource
+	{
+	public:
+		virtual ~AmbientLightSource() = default;
+
+		// The illuminance in lux: the mean of the samples since the last read for a buffered sensor, or the current
+		// value. Returns false when there is no new reading.
+		[[nodiscard]] virtual bool ReadIlluminance(double& lux) = 0;
+
+		// Samples read so far.
+		[[nodiscard]] virtual std::uint64_t sample_count() const = 0;
+	};
+}
+
+#endif
@@ -0,0 +1,196 @@
+#ifndef FLUTTER_PLUGIN_SCREEN_BRIGHTNESS_WINDOWS_PLUGIN_BRIGHTNESS_BRIDGE_H
+#define FLUTTER_PLUGIN_SCREEN_BRIGHTNESS_WINDOWS_PLUGIN_BRIGHTNESS_BRIDGE_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "brightness_service.h"
+#include "content_adaptive_dimmer.h"
+#include "luminance_histogram.h"
+
+namespace screen_brightness
+{
+	// Access to one engine's BrightnessClient from any thread, for the C ABI which Dart calls through dart:ffi
+	// without a platform channel round trip.
+	//
+	// The client belongs to the platform thread, so writes are queued for it: wake is called from the requesting
+	// thread, and the platform thread then calls RunPendingTasks. Only the latest queued write is applied, as a UI
+	// setting the brightness every frame only cares about the last value; the ones it replaces complete with
+	// MonitorStatus::kPreempted. The application brightness is cached on every change, so reading it takes an atomic
+	// load.
+	//
+	// The platform thread does not wait for the monitor: RunPendingTasks queues a write on the display's scheduler, and
+	// wake is called again once it has completed, timed out or been cancelled, for RunPendingTasks to complete it and
+	// apply the next one. A thread of the bridge wakes the platform thread at deadlines. Writes are applied one at a
+	// time. The bridge must be owned by a std::shared_ptr.
+	//
+	// The bridge can outlive the client, as the C ABI holds it: it shares the client's service, and wake is only
+	// called under the lock Close takes, so that it is never called once Close has returned.
+	class BrightnessBridge final : public std::enable_shared_from_this<BrightnessBridge>
+	{
+	public:
+		// Returned by SubmitFrame for a frame which cannot be analysed.
+		static constexpr std::int64_t kInvalidFrame = -2;
+
+		using WakeCallback = std::function<void()>;
+
+		// Called on the platform thread, or on the requesting thread for a preempted write.
+		using CompletionCallback = std::function<void(std::int64_t request_id, MonitorStatus status)>;
+
+		// Called on the platform thread with every change of the application brightness, under a lock which
+		// Subscribe and Unsubscribe take, so a callback must not call them.
+		using BrightnessChangedCallback = std::function<void(double brightness)>;
+
+		// Called on the platform thread.
+		BrightnessBridge(BrightnessClient& client, WakeCallback wake);
+
+		BrightnessBridge(const BrightnessBridge&) = delete;
+
+		BrightnessBridge& operator=(const BrightnessBridge&) = delete;
+
+		~BrightnessBridge();
+
+		// The bridge the C ABI uses: the earliest installed one still installed, or null.
+		[[nodiscard]] static std::shared_ptr<BrightnessBridge> GetInstalled();
+
+		// cached_brightness() of the installed bridge, or -1 without one, in a single atomic load.
+		[[nodiscard]] static double GetInstalledCachedBrightness();
+
+		static void Install(std::shared_ptr<BrightnessBridge> bridge);
+
+		static void Uninstall(const BrightnessBridge* bridge);
+
+		// The state table of the client's service, which lives as long as the bridge.
+		[[nodiscard]] const DisplayStateTable& display_state_table() const { return service_->display_state_table(); }
+
+		// The application brightness last reported by the client, -1 before the first report.
+		[[nodiscard]] double cached_brightness() const { return cached_brightness_.load(std::memory_order_acquire); }
+
+		// Queues the write and returns its request id, which the completion gets. Ids are unique in the process.
+		std::int64_t SetApplicationScreenBrightnessAsync(double brightness, CompletionCallback completion);
+
+		// As above, except that the write fails with MonitorStatus::kTimedOut once the deadline, of
+		// std::chrono::steady_clock, has passed: before it is applied, or while it waits for a hung monitor.
+		std::int64_t SetApplicationScreenBrightnessAsync(double brightness, Clock::time_point deadline, CompletionCallback completion);
+
+		// As above, for a write requested on the platform thread, e.g. by a method call: it can be cancelled by the
+		// caller's operation id as well, and completes on the platform thread even when replaced or cancelled from
+		// another thread.
+		std::int64_t SetApplicationScreenBrightnessAsync(double brightness, Clock::time_point deadline, std::int64_t operation_id,
+			CompletionCallback completion);
+
+		// Cancels the write with the request id or operation id: a queued one completes with MonitorStatus::kCancelled on
+		// the calling thread, and one being applied stops being waited for. Returns false if the write has completed.
+		bool Cancel(std::int64_t id);
+
+		// Replaces the configuration of content adaptive dimming, which starts over with the next frame.
+		void SetContentAdaptiveDimming(const ContentAdaptiveDimmingConfig& config);
+
+		// Analyses the frame on the calling thread without copying it, and queues a write of the brightness the
+		// ContentAdaptiveDimmer derives, as SetApplicationScreenBrightnessAsync does. Returns the request id, 0 while
+		// the brightness stays within the deadband, or kInvalidFrame; the completion is only called for a write.
+		std::int64_t SubmitFrame(const FrameView& frame, Clock::time_point time, CompletionCallback completion);
+
+		// Returns the subscription id.
+		std::int64_t Subscribe(BrightnessChangedCallback callback);
+
+		void Unsubscribe(std::int64_t subscription_id);
+
+		// Completes the write being applied once it is done, and starts the queued one. Called on the platform thread.
+		void RunPendingTasks();
+
+		// Called on the platform thread when the application brightness changes.
+		void OnBrightnessChanged(double brightness);
+
+		// Stops applying writes, when the client goes away. The queued write and later ones complete as if replaced,
+		// with MonitorStatus::kPreempted, one being applied is cancelled, and subscriptions end.
+		void Close();
+
+	private:
+		struct PendingWrite
+		{
+			std::int64_t request_id = 0;
+
+			// registered with the OperationRegistry while applied
+			std::int64_t operation_id = 0;
+
+			double brightness = 0;
+
+			Clock::time_point deadline = OperationContext::kNoDeadline;
+
+			// completed on the platform thread when replaced or cancelled
+			bool is_platform_completion = false;
+
+			CompletionCallback completion;
+		};
+
+		// only used on the platform thread, before Close
+		BrightnessClient& client_;
+
+		std::shared_ptr<BrightnessService> service_;
+
+		// called under mutex_
+		WakeCallback wake_;
+
+		std::atomic<double> cached_brightness_{ -1 };
+
+		std::mutex mutex_;
+
+		bool has_pending_write_ = false;
+
+		bool is_closed_ = false;
+
+		PendingWrite pending_write_;
+
+		// replaced or cancelled writes which RunPendingTasks completes
+		std::vector<std::pair<PendingWrite, MonitorStatus>> dropped_writes_;
+
+		// the platform thread waits to be woken for the applied write: by its completion, cancellation or deadline
+		bool is_waiting_ = false;
+
+		Clock::time_point waiting_deadline_ = OperationContext::kNoDeadline;
+
+		std::condition_variable deadline_condition_;
+
+		// started with the first write which has a deadline
+		std::thread deadline_thread_;
+
+		// the write being applied, of the platform thread
+		PendingWrite applied_write_;
+
+		std::shared_ptr<OperationContext> applied_context_;
+
+		std::shared_ptr<BrightnessClient::ApplicationBrightnessWrite> applied_;
+
+		std::mutex dimmer_mutex_;
+
+		ContentAdaptiveDimmer dimmer_;
+
+		std::mutex subscriptions_mutex_;
+
+		std::map<std::int64_t, BrightnessChangedCallback> subscriptions_;
+
+		std::int64_t Queue(PendingWrite write);
+
+		// Starts the write, and completes it unless it waits for the monitor.
+		void Apply(PendingWrite write, std::shared_ptr<OperationContext> context);
+
+		// Completes the applied write if it is done. Returns false while it still runs.
+		bool CompleteAppliedWrite();
+
+		// Wakes the platform thread for the applied write, once.
+		void WakeForAppliedWrite();
+
+		void RunDeadlines();
+	};
+}
+
+#endif
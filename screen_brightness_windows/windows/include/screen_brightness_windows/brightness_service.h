@@ -0,0 +1,381 @@
+#ifndef FLUTTER_PLUGIN_SCREEN_BRIGHTNESS_WINDOWS_PLUGIN_BRIGHTNESS_SERVICE_H
+#define FLUTTER_PLUGIN_SCREEN_BRIGHTNESS_WINDOWS_PLUGIN_BRIGHTNESS_SERVICE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <vector>
+
+#include "clock.h"
+#include "display_state_table.h"
+#include "display_topology.h"
+#include "monitor_backend.h"
+#include "operation_context.h"
+#include "restore_journal.h"
+#include "scheduled_monitor_backend.h"
+#include "shared_lease_table.h"
+#include "vcp_feature_controller.h"
+
+namespace screen_brightness
+{
+	class BrightnessClient;
+
+	// Outcome of restoring one display when an engine closes.
+	struct DisplayRestoreResult
+	{
+		DisplayHandle display = 0;
+
+		// false when the write was still running at the deadline, with MonitorStatus::kTimedOut; a write which had not
+		// started then is withdrawn, and completed with MonitorStatus::kTimedOut
+		bool is_completed = false;
+
+		MonitorStatus status = MonitorStatus::kOk;
+	};
+
+	// Display state and hardware access shared by every Flutter engine of the process. Each engine's plugin is a
+	// BrightnessClient with its own application brightness override; the service arbitrates between them.
+	//
+	// The system brightness of a display is captured once, when the first client looks at it, so an engine starting
+	// while another one overrides the display does not take the override for the system brightness. A display shows
+	// the override of the client which most recently applied one and is not paused, or the system brightness when
+	// there is none, so pausing one engine does not undo the override of another.
+	//
+	// With a lease table open, the same goes for other processes: brightness is only written while holding the
+	// display's lease, which an explicit change takes over and a restore does not, and the system brightness and
+	// current value published by the lease holder are used instead of reading the hardware.
+	//
+	// Clients are called on the platform thread, which all engines of a process share.
+	class BrightnessService final
+	{
+	public:
+		using Factory = std::function<std::unique_ptr<BrightnessService>()>;
+
+		// Returns the service of the process, creating it with create when no client holds it. The service lives as
+		// long as its clients.
+		[[nodiscard]] static std::shared_ptr<BrightnessService> Acquire(const Factory& create);
+
+		BrightnessService(std::unique_ptr<MonitorBackend> backend, Clock& clock, Clock::duration minimum_command_interval, bool is_threaded);
+
+		BrightnessService(const BrightnessService&) = delete;
+
+		BrightnessService& operator=(const BrightnessService&) = delete;
+
+		// Waits for the commands still running on the display buses, e.g. restores which outlived their deadline.
+		~BrightnessService();
+
+		[[nodiscard]] MonitorBackend& backend() { return *backend_; }
+
+		[[nodiscard]] ScheduledMonitorBackend& scheduled_backend() { return scheduled_backend_; }
+
+		[[nodiscard]] const DisplayTopology& display_topology() const { return display_topology_; }
+
+		[[nodiscard]] VcpFeatureController& vcp_feature_controller() { return vcp_feature_controller_; }
+
+		[[nodiscard]] size_t client_count() const { return clients_.size(); }
+
+		// Coordinates with the other processes which have the table open.
+		[[nodiscard]] MonitorStatus OpenLeaseTable(const std::string& name);
+
+		[[nodiscard]] const SharedLeaseTable& lease_table() const { return lease_table_; }
+
+		[[nodiscard]] MonitorStatus OpenRestoreJournal(const std::string& path);
+
+		[[nodiscard]] const RestoreJournal& restore_journal() const { return restore_journal_; }
+
+		// State of the displays clients look at, updated whenever a client is told of a change.
+		[[nodiscard]] const DisplayStateTable& display_state_table() const { return display_state_table_; }
+
+		// Operations of every engine which can be cancelled by id, from any thread.
+		[[nodiscard]] OperationRegistry& operation_registry() { return operation_registry_; }
+
+		// Restores the system brightness of the attached displays which processes that have exited left overridden,
+		// unless another process overrides them now. Called before the first client looks at a display, as it would
+		// take the leftover override for the system brightness.
+		std::vector<DisplayRestoreResult> RecoverRestoreJournal();
+
+		// Re-enumerates the displays and sends the difference to every client. Engines all see the same change, so
+		// only the first of them to ask gets a delta. A display which came back with another handle keeps its state,
+		// and its clients follow it to the new handle.
+		[[nodiscard]] MonitorStatus UpdateDisplayTopology();
+
+	private:
+		friend class BrightnessClient;
+
+		// applied_brightness after a write which timed out or was cancelled once the monitor may have had it: the
+		// display shows either value until the next write, so closing and pausing write it again.
+		static constexpr long kUnknownBrightness = -2;
+
+		struct DisplayState
+		{
+			long minimum_brightness = -1;
+
+			long system_brightness = -1;
+
+			long maximum_brightness = -1;
+
+			// last value the process wrote, -1 before the first, or kUnknownBrightness
+			long applied_brightness = -1;
+
+			// sequence of the write applied_brightness comes from
+			std::uint64_t applied_write = 0;
+
+			// clients with an applied override, the one shown last
+			std::vector<BrightnessClient*> overrides;
+		};
+
+		// A brightness write with the lease changes around it, prepared on the platform thread.
+		struct BrightnessWrite
+		{
+			DisplayHandle display = 0;
+
+			// numbers the writes in the order they reach the schedulers
+			std::uint64_t sequence = 0;
+
+			long brightness = -1;
+
+			long system_brightness = -1;
+
+			bool has_lease = false;
+
+			// the display is in the topology, so it can be journaled
+			bool has_identity = false;
+
+			DisplayIdentity identity;
+
+			// an override rather than the system brightness
+			bool is_overriding = false;
+
+			// a restore to the system brightness, after which the lease is given up
+			bool is_releasing = false;
+		};
+
+		std::unique_ptr<MonitorBackend> backend_;
+
+		ScheduledMonitorBackend scheduled_backend_;
+
+		DisplayTopology display_topology_;
+
+		VcpFeatureController vcp_feature_controller_;
+
+		SharedLeaseTable lease_table_;
+
+		RestoreJournal restore_journal_;
+
+		DisplayStateTable display_state_table_;
+
+		OperationRegistry operation_registry_;
+
+		std::vector<BrightnessClient*> clients_;
+
+		std::map<DisplayHandle, DisplayState> displays_;
+
+		std::uint64_t write_count_ = 0;
+
+		// Probes the display the first time, and again while probing fails.
+		[[nodiscard]] MonitorStatus GetDisplayState(DisplayHandle display, DisplayState*& state);
+
+		// Re-reads the system brightness, which only the hardware knows while no client overrides the display.
+		[[nodiscard]] MonitorStatus ProbeDisplay(DisplayHandle display, DisplayState& state);
+
+		// The override shown last, or the system brightness.
+		[[nodiscard]] static long GetShownBrightness(const DisplayState& state);
+
+		// Writes the brightness the display should show now. A restore is skipped when another process has taken the
+		// display's lease, and releases the lease once the system brightness is back.
+		[[nodiscard]] MonitorStatus ApplyBrightness(DisplayHandle display, DisplayState& state, bool is_restoring = false);
+
+		// Takes the lease for the write. Returns false when there is nothing to write: the brightness is not known yet,
+		// or another process has taken over the display being restored.
+		[[nodiscard]] bool PrepareWrite(DisplayHandle display, const DisplayState& state, bool is_restoring, BrightnessWrite& write);
+
+		// Writes, journals and publishes the value.
+		[[nodiscard]] MonitorStatus ExecuteWrite(const BrightnessWrite& write);
+
+		// Records the outcome of the write in applied_brightness, unless a later write has been recorded: its value
+		// once written, kUnknownBrightness once it timed out or was cancelled. Publishes the state on a change.
+		void RecordWrite(DisplayHandle display, DisplayState& state, const BrightnessWrite& write, MonitorStatus status);
+
+		// The journal and lease changes before and after the display takes the write. They only use the journal and the
+		// lease table, so any thread may call them.
+		void BeginWrite(const BrightnessWrite& write);
+
+		void CompleteWrite(const BrightnessWrite& write);
+
+		// The value published by a live lease holder in another process.
+		[[nodiscard]] bool ReadLeaseEntry(DisplayHandle display, SharedLeaseEntry& entry) const;
+
+		// Writes what the display shows next if the client was the one shown, or if its value is unknown. Returns true if
+		// the client was the one shown.
+		bool RemoveOverride(DisplayHandle display, const BrightnessClient& client);
+
+		void NotifySystemScreenBrightnessChanged(DisplayHandle display, const DisplayState& state);
+
+		void PublishDisplayState(DisplayHandle display, const DisplayState& state);
+	};
+
+	// One engine's view of the shared brightness state, and the brightness API of the core for the plugin, sbctl and
+	// tests alike. Destroying the client drops its override.
+	class BrightnessClient final
+	{
+	public:
+		using BrightnessChangedCallback = std::function<void(double brightness)>;
+
+		using DisplayTopologyChangedCallback = std::function<void(const DisplayTopologyDelta& delta)>;
+
+		// An application brightness write which StartApplicationScreenBrightnessWrite has queued on the display's
+		// scheduler, until FinishApplicationScreenBrightnessWrite.
+		class ApplicationBrightnessWrite final
+		{
+		public:
+			// Whether the scheduler has completed the write, or it did not need the monitor.
+			[[nodiscard]] bool is_completed() const;
+
+		private:
+			friend class BrightnessClient;
+
+			mutable std::mutex mutex_;
+
+			// set by the scheduler's thread
+			std::optional<MonitorStatus> status_;
+
+			// in the display's range
+			long brightness_ = -1;
+
+			bool is_queued_ = false;
+
+			BrightnessService::BrightnessWrite write_;
+
+			std::uint64_t command_sequence_ = 0;
+
+			// what a failed write rolls back to
+			long previous_brightness_ = -1;
+
+			bool was_overriding_ = false;
+
+			std::ptrdiff_t previous_index_ = 0;
+
+			std::uint64_t generation_ = 0;
+		};
+
+		explicit BrightnessClient(std::shared_ptr<BrightnessService> service);
+
+		BrightnessClient(const BrightnessClient&) = delete;
+
+		BrightnessClient& operator=(const BrightnessClient&) = delete;
+
+		~BrightnessClient();
+
+		[[nodiscard]] BrightnessService& service() { return *service_; }
+
+		[[nodiscard]] const std::shared_ptr<BrightnessService>& shared_service() const { return service_; }
+
+		[[nodiscard]] DisplayHandle display() const { return display_; }
+
+		void SetDisplay(DisplayHandle display) { display_ = display; }
+
+		// Captures the system brightness of the display unless another client already has.
+		void Initialize();
+
+		// Moves the client to another display, carrying its override over as a percentage.
+		[[nodiscard]] MonitorStatus MigrateDisplay(DisplayHandle display);
+
+		// Called for changes made by any client on the client's display.
+		void SetSystemScreenBrightnessChangedCallback(BrightnessChangedCallback callback);
+
+		void SetApplicationScreenBrightnessChangedCallback(BrightnessChangedCallback callback);
+
+		void SetDisplayTopologyChangedCallback(DisplayTopologyChangedCallback callback);
+
+		[[nodiscard]] bool HasSystemScreenBrightness() const;
+
+		[[nodiscard]] double GetSystemScreenBrightness() const;
+
+		[[nodiscard]] MonitorStatus SetSystemScreenBrightness(double brightness);
+
+		[[nodiscard]] MonitorStatus GetApplicationScreenBrightness(double& brightness);
+
+		// While paused the override is kept and applied on resume.
+		[[nodiscard]] MonitorStatus SetApplicationScreenBrightness(double brightness);
+
+		// SetApplicationScreenBrightness for a caller which must not block the platform thread on the monitor: the write
+		// is queued on the display's scheduler, whose thread calls on_completed once it has completed, and
+		// FinishApplicationScreenBrightnessWrite then applies the outcome on the platform thread. Without worker threads
+		// the write runs before the call returns, as does one which does not need the monitor; on_completed is not called
+		// for the latter.
+		[[nodiscard]] std::shared_ptr<ApplicationBrightnessWrite> StartApplicationScreenBrightnessWrite(double brightness, std::function<void()> on_completed);
+
+		// Applies the outcome of the write, or gives it up with give_up_status, kTimedOut or kCancelled, if it has not
+		// completed: a write still queued is withdrawn, and one already running completes in the background and leaves
+		// the display's brightness unknown. A failed write restores the previous override unless it has been changed
+		// since. Returns the status of the write.
+		MonitorStatus FinishApplicationScreenBrightnessWrite(ApplicationBrightnessWrite& write, MonitorStatus give_up_status);
+
+		[[nodiscard]] MonitorStatus ResetApplicationScreenBrightness();
+
+		[[nodiscard]] bool HasApplicationScreenBrightnessChanged() const { return application_screen_brightness_ != -1; }
+
+		// The override this client has set, without asking the monitor, or -1 without one.
+		[[nodiscard]] double GetApplicationScreenBrightnessOverride() const;
+
+		[[nodiscard]] bool is_auto_reset() const { return is_auto_reset_; }
+
+		void SetAutoReset(bool is_auto_reset) { is_auto_reset_ = is_auto_reset; }
+
+		[[nodiscard]] bool is_animate() const { return is_animate_; }
+
+		void SetAnimate(bool is_animate) { is_animate_ = is_animate; }
+
+		void OnApplicationPause();
+
+		// Pauses the client for its window closing, and restores every display the process changed which does not
+		// show what it should any more: the client's display, and displays whose restore failed before. The writes are
+		// queued on each display's scheduler, so with a threaded service they run in parallel, and the call returns
+		// within timeout of real time. Writes still queued then are withdrawn, and writes still running finish on
+		// their scheduler's thread, which the service waits for when destroyed; both are reported as
+		// MonitorStatus::kTimedOut.
+		std::vector<DisplayRestoreResult> OnApplicationClose(Clock::duration timeout);
+
+		void OnApplicationResume();
+
+	private:
+		friend class BrightnessService;
+
+		std::shared_ptr<BrightnessService> service_;
+
+		DisplayHandle display_ = 0;
+
+		BrightnessChangedCallback system_screen_brightness_changed_callback_;
+
+		BrightnessChangedCallback application_screen_brightness_changed_callback_;
+
+		DisplayTopologyChangedCallback display_topology_changed_callback_;
+
+		// in the display's range
+		long application_screen_brightness_ = -1;
+
+		bool is_auto_reset_ = true;
+
+		bool is_animate_ = true;
+
+		bool is_paused_ = false;
+
+		// restored on close already, until resumed
+		bool is_closed_ = false;
+
+		// changes with every change of the override, so that a write completing late only rolls back its own
+		std::uint64_t override_generation_ = 0;
+
+		// Sets the override and shows it unless paused, keeping what a failed write rolls back to.
+		void BeginOverride(BrightnessService::DisplayState& state, long brightness, ApplicationBrightnessWrite& write);
+
+		void RollBackOverride(BrightnessService::DisplayState& state, const ApplicationBrightnessWrite& write);
+
+		void HandleApplicationScreenBrightnessChanged(const BrightnessService::DisplayState& state, long brightness) const;
+	};
+}
+
+#endif
@@ -0,0 +1,163 @@
+#ifndef FLUTTER_PLUGIN_SCREEN_BRIGHTNESS_WINDOWS_PLUGIN_BROKER_MONITOR_BACKEND_H
+#define FLUTTER_PLUGIN_SCREEN_BRIGHTNESS_WINDOWS_PLUGIN_BROKER_MONITOR_BACKEND_H
+
+#include <array>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "broker_protocol.h"
+#include "clock.h"
+#include "monitor_backend.h"
+
+namespace screen_brightness
+{
+	// Monitor access through a BrokerServer, falling back to direct access when no broker runs.
+	//
+	// Any number of threads may call at once: requests are pipelined on the one connection and a reader thread hands
+	// each response to its caller. When the broker cannot be reached, or goes away, calls go to the backend made by
+	// the fallback factory instead, and the broker is tried again at most every kReconnectInterval. The display
+	// handles of the broker and of the fallback agree as long as both enumerate the displays the same way, which the
+	// sysfs and Dxva2 backends do.
+	class BrokerMonitorBackend final : public MonitorBackend
+	{
+	public:
+		using FallbackFactory = std::function<std::unique_ptr<MonitorBackend>()>;
+
+		using Completion = std::function<void(MonitorStatus status)>;
+
+		using BrightnessCompletion = std::function<void(MonitorStatus status, long minimum_brightness, long brightness, long maximum_brightness)>;
+
+		using BrightnessChangedCallback = std::function<void(DisplayHandle display, long brightness)>;
+
+		// Requests on the wire at once; further callers wait for a response.
+		static constexpr std::size_t kMaximumInFlight = 64;
+
+		static constexpr Clock::duration kReconnectInterval = std::chrono::seconds(1);
+
+		// Without a fallback factory, calls fail with MonitorStatus::kBrokerFailed while the broker is unreachable.
+		BrokerMonitorBackend(std::string path, Clock& clock, FallbackFactory create_fallback = nullptr);
+
+		BrokerMonitorBackend(const BrokerMonitorBackend&) = delete;
+
+		BrokerMonitorBackend& operator=(const BrokerMonitorBackend&) = delete;
+
+		~BrokerMonitorBackend() override;
+
+		[[nodiscard]] MonitorStatus Connect();
+
+		void Disconnect();
+
+		[[nodiscard]] bool is_connected() const;
+
+		// Whether calls currently go to the fallback backend.
+		[[nodiscard]] bool is_using_fallback() const;
+
+		// Called on the reader thread for the brightness writes of other clients of the broker.
+		[[nodiscard]] MonitorStatus SetBrightnessChangedCallback(BrightnessChangedCallback callback);
+
+		// Pipelined forms, which return once the request is sent. Completions run on the reader thread, or inline on
+		// the fallback.
+		void GetScreenBrightnessAsync(DisplayHandle display, BrightnessCompletion completion);
+
+		void SetScreenBrightnessAsync(DisplayHandle display, long screen_brightness, Completion completion);
+
+		MonitorStatus EnumerateDisplays(std::vector<DisplayInfo>& displays) override;
+
+		DisplayHandle GetPrimaryDisplay() override;
+
+		MonitorStatus GetScreenBrightness(DisplayHandle display, long& minimum_screen_brightness, long& screen_brightness, long& maximum_screen_brightness) override;
+
+		MonitorStatus SetScreenBrightness(DisplayHandle display, long screen_brightness) override;
+
+		MonitorStatus GetVcpFeature(DisplayHandle display, VcpCode code, unsigned long& current_value, unsigned long& maximum_value) override;
+
+		MonitorStatus SetVcpFeature(DisplayHandle display, VcpCode code, unsigned long value) override;
+
+		MonitorStatus GetCapabilitiesString(DisplayHandle display, std::string& capabilities) override;
+
+		MonitorStatus GetEdid(DisplayHandle display, std::vector<std::uint8_t>& edid) override;
+
+	private:
+		struct Connection;
+
+		// Reads the payload of a response into the caller's variables.
+		using ResponseParser = bool (*)(BrokerFrameReader& reader, void* outputs);
+
+		using ResponseCompletion = std::function<void(MonitorStatus status, BrokerFrameReader& reader)>;
+
+		struct PendingCall
+		{
+			// 0 while the slot is free
+			std::uint32_t id = 0;
+
+			bool is_done = false;
+
+			MonitorStatus status = MonitorStatus::kOk;
+
+			ResponseParser parse = nullptr;
+
+			void* outputs = nullptr;
+
+			// set for pipelined calls, which nobody waits for
+			ResponseCompletion completion;
+		};
+
+		const std::string path_;
+
+		Clock& clock_;
+
+		const FallbackFactory create_fallback_;
+
+		mutable std::mutex mutex_;
+
+		std::condition_variable condition_;
+
+		std::shared_ptr<Connection> connection_;
+
+		std::thread reader_;
+
+		std::uint32_t next_id_ = 1;
+
+		std::array<PendingCall, kMaximumInFlight> calls_;
+
+		Clock::time_point next_connect_time_{};
+
+		BrightnessChangedCallback brightness_changed_callback_;
+
+		std::unique_ptr<MonitorBackend> fallback_;
+
+		std::mutex fallback_mutex_;
+
+		// Connects when due for another attempt. Requires the lock.
+		[[nodiscard]] bool EnsureConnected(std::unique_lock<std::mutex>& lock);
+
+		// Sends a request and waits for its response. Returns MonitorStatus::kBrokerFailed without a broker.
+		[[nodiscard]] MonitorStatus Call(BrokerMessageType type, const BrokerRequest& request, ResponseParser parse, void* outputs);
+
+		// Returns false without a broker, leaving the completion to the caller.
+		[[nodiscard]] bool Submit(BrokerMessageType type, const BrokerRequest& request, ResponseCompletion completion);
+
+		// Takes a free call slot and sends the request. Returns the slot, or nullptr without a broker. Requires the lock.
+		PendingCall* Send(std::unique_lock<std::mutex>& lock, BrokerMessageType type, const BrokerRequest& request, ResponseParser parse,
+			void* outputs, ResponseCompletion completion);
+
+		void RunReader(std::shared_ptr<Connection> connection);
+
+		void Dispatch(const BrokerFrameHeader& header, BrokerFrameReader& reader);
+
+		// Marks the connection lost and fails the calls waiting on it. Requires the lock.
+		void DropConnection(std::unique_lock<std::mutex>& lock);
+
+		// nullptr without a fallback factory
+		MonitorBackend* GetFallback();
+	};
+}
+
+#endif
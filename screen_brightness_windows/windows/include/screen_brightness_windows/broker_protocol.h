@@ -0,0 +1,149 @@
+#ifndef FLUTTER_PLUGIN_SCREEN_BRIGHTNESS_WINDOWS_PLUGIN_BROKER_PROTOCOL_H
+#define FLUTTER_PLUGIN_SCREEN_BRIGHTNESS_WINDOWS_PLUGIN_BROKER_PROTOCOL_H
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <vector>
+
+#include "monitor_backend.h"
+
+namespace screen_brightness
+{
+	// Wire format between BrokerServer and BrokerMonitorBackend. Every message is a frame of a BrokerFrameHeader and
+	// a payload of header.size bytes, in host byte order as both ends are on the same machine.
+	//
+	// Clients pipeline requests: they send the next one without waiting for the previous response, and match
+	// responses to requests by id, as the broker answers them in the order the bus completes them. A response has the
+	// type of its request and carries the MonitorStatus of the operation.
+	enum class BrokerMessageType : std::uint8_t
+	{
+		kEnumerateDisplays = 1,
+		kGetPrimaryDisplay,
+		kGetScreenBrightness,
+		kSetScreenBrightness,
+		kGetVcpFeature,
+		kSetVcpFeature,
+		kGetCapabilitiesString,
+		kGetEdid,
+		// asks for kBrightnessChanged notifications of the writes of other clients
+		kSubscribe,
+		// sent by the broker with id 0
+		kBrightnessChanged,
+	};
+
+	struct BrokerFrameHeader
+	{
+		std::uint32_t size = 0;
+
+		std::uint32_t id = 0;
+
+		BrokerMessageType type = BrokerMessageType::kEnumerateDisplays;
+
+		// MonitorStatus of a response, 0 in a request
+		std::uint8_t status = 0;
+
+		std::uint16_t reserved = 0;
+	};
+
+	// The payload of every request; operations ignore the fields they do not use. Fixed size requests are encoded
+	// without allocating, so the brightness path stays allocation free through the broker too.
+	struct BrokerRequest
+	{
+		std::uint64_t display = 0;
+
+		std::int64_t value = 0;
+
+		VcpCode code = 0;
+
+		std::uint8_t reserved[7] = {};
+	};
+
+	constexpr std::size_t kBrokerHeaderSize = sizeof(BrokerFrameHeader);
+
+	// Far more than the longest capability string or EDID; anything larger is a corrupt stream.
+	constexpr std::uint32_t kBrokerMaximumPayloadSize = 1 << 20;
+
+	static_assert(kBrokerHeaderSize == 12 && sizeof(BrokerRequest) == 24, "the broker frame layout has no padding");
+
+	using BrokerRequestFrame = std::array<std::uint8_t, kBrokerHeaderSize + sizeof(BrokerRequest)>;
+
+	void EncodeBrokerRequest(std::uint32_t id, BrokerMessageType type, const BrokerRequest& request, BrokerRequestFrame& frame);
+
+	// Returns false for a header whose payload would be larger than kBrokerMaximumPayloadSize.
+	[[nodiscard]] bool DecodeBrokerFrameHeader(const std::uint8_t* data, BrokerFrameHeader& header);
+
+	// $XDG_RUNTIME_DIR/screen_brightness.sock, or a per-user path in /tmp without a runtime directory.
+	[[nodiscard]] std::string GetDefaultBrokerSocketPath();
+
+	// Appends a frame to a buffer, which may already hold other frames.
+	class BrokerFrameWriter final
+	{
+	public:
+		BrokerFrameWriter(std::vector<std::uint8_t>& buffer, std::uint32_t id, BrokerMessageType type, MonitorStatus status);
+
+		template <typename T>
+		void Write(const T value)
+		{
+			static_assert(std::is_trivially_copyable_v<T>, "only plain values are written");
+			const auto* bytes = reinterpret_cast<const std::uint8_t*>(&value);
+			buffer_.insert(buffer_.end(), bytes, bytes + sizeof(T));
+		}
+
+		// Length prefixed.
+		void WriteBytes(const std::uint8_t* data, std::size_t size);
+
+		void WriteString(std::string_view text);
+
+		// Fills in the payload size.
+		void Finish();
+
+	private:
+		std::vector<std::uint8_t>& buffer_;
+
+		const std::size_t start_;
+	};
+
+	// Reads the payload of a frame. Reading past its end fails and leaves the value unchanged.
+	class BrokerFrameReader final
+	{
+	public:
+		BrokerFrameReader(const std::uint8_t* data, std::size_t size) : data_(data), size_(size)
+		{
+		}
+
+		template <typename T>
+		[[nodiscard]] bool Read(T& value)
+		{
+			static_assert(std::is_trivially_copyable_v<T>, "only plain values are read");
+			if (size_ - position_ < sizeof(T))
+			{
+				return false;
+			}
+
+			std::memcpy(&value, data_ + position_, sizeof(T));
+			position_ += sizeof(T);
+			return true;
+		}
+
+		[[nodiscard]] bool ReadBytes(std::vector<std::uint8_t>& bytes);
+
+		[[nodiscard]] bool ReadString(std::string& text);
+
+	private:
+		const std::uint8_t* data_;
+
+		std::size_t size_;
+
+		std::size_t position_ = 0;
+
+		// Returns the start of the next length prefixed field, or nullptr.
+		[[nodiscard]] const std::uint8_t* ReadField(std::uint32_t& size);
+	};
+}
+
+#endif
@@ -0,0 +1,134 @@
+#ifndef FLUTTER_PLUGIN_SCREEN_BRIGHTNESS_WINDOWS_PLUGIN_BROKER_SERVER_H
+#define FLUTTER_PLUGIN_SCREEN_BRIGHTNESS_WINDOWS_PLUGIN_BROKER_SERVER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "broker_protocol.h"
+#include "clock.h"
+#include "monitor_backend.h"
+#include "scheduled_monitor_backend.h"
+
+namespace screen_brightness
+{
+	struct BrokerServerMetrics
+	{
+		std::size_t connection_count = 0;
+
+		std::uint64_t request_count = 0;
+
+		// reads answered by a read another client had already queued
+		std::uint64_t shared_read_count = 0;
+
+		// writes superseded by a later write of any client before reaching the bus
+		std::uint64_t coalesced_write_count = 0;
+
+		std::uint64_t notification_count = 0;
+	};
+
+	// Owns the displays for a fleet of processes, which reach it over a Unix domain socket with BrokerMonitorBackend.
+	//
+	// Requests of all clients go through one DdcScheduler per display, so a write supersedes the queued writes of
+	// every client and a read joins a read another client has queued. A superseded write completes with
+	// MonitorStatus::kPreempted, as it would in process. Successful brightness writes are sent as kBrightnessChanged
+	// to the other subscribed clients.
+	//
+	// Without is_threaded, the loop runs the queued commands itself once it has read the requests at hand, which
+	// makes coalescing deterministic for tests.
+	class BrokerServer final
+	{
+	public:
+		BrokerServer(MonitorBackend& backend, Clock& clock, Clock::duration minimum_command_interval, bool is_threaded);
+
+		BrokerServer(const BrokerServer&) = delete;
+
+		BrokerServer& operator=(const BrokerServer&) = delete;
+
+		~BrokerServer();
+
+		// Binds the socket, replacing a stale one left by a broker which has exited.
+		[[nodiscard]] MonitorStatus Listen(const std::string& path);
+
+		// Waits up to timeout for requests, and handles the requests at hand.
+		void RunOnce(Clock::duration timeout);
+
+		// Runs the loop until Stop.
+		void Run();
+
+		// Runs the loop on a thread.
+		void Start();
+
+		// Returns from Run and closes the socket and every connection.
+		void Stop();
+
+		[[nodiscard]] ScheduledMonitorBackend& scheduled_backend() { return scheduled_backend_; }
+
+		[[nodiscard]] BrokerServerMetrics metrics() const;
+
+	private:
+		struct Connection;
+
+		struct PendingRead;
+
+		MonitorBackend& backend_;
+
+		ScheduledMonitorBackend scheduled_backend_;
+
+		const bool is_threaded_;
+
+		std::string path_;
+
+		int listen_socket_ = -1;
+
+		// written to wake the loop up for Stop
+		int wake_pipe_[2] = { -1, -1 };
+
+		std::thread thread_;
+
+		mutable std::mutex mutex_;
+
+		bool is_stopping_ = false;
+
+		// only used by the loop
+		std::vector<std::shared_ptr<Connection>> connections_;
+
+		std::set<DisplayHandle> busy_displays_;
+
+		// displays which may have a scheduler
+		std::set<DisplayHandle> known_displays_;
+
+		// guarded by mutex_, as completions run on the scheduler threads
+		std::vector<std::shared_ptr<Connection>> subscribers_;
+
+		std::map<DisplayHandle, std::shared_ptr<PendingRead>> pending_reads_;
+
+		BrokerServerMetrics metrics_;
+
+		void Accept();
+
+		// Re-enumerates the displays for a handle not seen yet.
+		[[nodiscard]] bool IsKnownDisplay(DisplayHandle display);
+
+		// Returns false once the connection is closed.
+		bool Receive(const std::shared_ptr<Connection>& connection);
+
+		void Handle(const std::shared_ptr<Connection>& connection, const BrokerFrameHeader& header, const BrokerRequest& request);
+
+		void HandleGetScreenBrightness(const std::shared_ptr<Connection>& connection, std::uint32_t id, DisplayHandle display);
+
+		void HandleWrite(const std::shared_ptr<Connection>& connection, const BrokerFrameHeader& header, const BrokerRequest& request);
+
+		void Notify(const Connection& origin, DisplayHandle display, long brightness);
+
+		void CloseConnections();
+	};
+}
+
+#endif
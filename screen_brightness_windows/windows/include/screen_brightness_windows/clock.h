@@ -0,0 +1,44 @@
+#ifndef FLUTTER_PLUGIN_SCREEN_BRIGHTNESS_WINDOWS_PLUGIN_CLOCK_H
+#define FLUTTER_PLUGIN_SCREEN_BRIGHTNESS_WINDOWS_PLUGIN_CLOCK_H
+
+#include <chrono>
+#include <mutex>
+
+namespace screen_brightness
+{
+	// Time source for everything that paces hardware access, so that timing can be simulated in tests.
+	class Clock
+	{
+	public:
+		using duration = std::chrono::steady_clock::duration;
+
+		using time_point = std::chrono::steady_clock::time_point;
+
+		virtual ~Clock() = default;
+
+		[[nodiscard]] virtual time_point Now() = 0;
+
+		virtual void SleepUntil(time_point time) = 0;
+
+		// Process wide std::chrono::steady_clock.
+		static Clock& Steady();
+	};
+
+	// Simulated clock: sleeping advances the time instead of blocking.
+	class ManualClock final : public Clock
+	{
+	public:
+		[[nodiscard]] time_point Now() override;
+
+		void SleepUntil(time_point time) override;
+
+		void Advance(duration duration);
+
+	private:
+		std::mutex mutex_;
+
+		time_point now_{};
+	};
+}
+
+#endif
@@ -0,0 +1,70 @@
+#ifndef FLUTTER_PLUGIN_SCREEN_BRIGHTNESS_WINDOWS_PLUGIN_CONTENT_ADAPTIVE_DIMMER_H
+#define FLUTTER_PLUGIN_SCREEN_BRIGHTNESS_WINDOWS_PLUGIN_CONTENT_ADAPTIVE_DIMMER_H
+
+#include <chrono>
+#include <cstddef>
+
+#include "clock.h"
+#include "luminance_histogram.h"
+
+namespace screen_brightness
+{
+	struct ContentAdaptiveDimmingConfig
+	{
+		// application brightness for dark content, and for content of maximum_luma
+		double maximum_brightness = 1.0;
+
+		double minimum_brightness = 0.6;
+
+		// mean luma, 0.0 to 1.0, above which the brightness is lowered, and at which it reaches minimum_brightness
+		double knee = 0.5;
+
+		double maximum_luma = 0.9;
+
+		// time for the brightness to cover 63% of a step of the content
+		Clock::duration time_constant = std::chrono::milliseconds(500);
+
+		// smallest change worth a write, as every write is a DDC/CI command
+		double deadband = 0.01;
+
+		// of the rows of a frame, the ones analysed
+		std::size_t row_step = 4;
+	};
+
+	// Derives the application brightness from what the screen shows: bright content, e.g. a white document, is dimmed
+	// so that it does not glare, while dark content keeps the full brightness. The target follows the frames through
+	// an exponential moving average, so a single bright frame or a cut between scenes does not make the screen flicker.
+	class ContentAdaptiveDimmer final
+	{
+	public:
+		explicit ContentAdaptiveDimmer(const ContentAdaptiveDimmingConfig& config = {});
+
+		[[nodiscard]] const ContentAdaptiveDimmingConfig& config() const { return config_; }
+
+		// Replaces the configuration and starts over with the next frame.
+		void SetConfig(const ContentAdaptiveDimmingConfig& config);
+
+		// The brightness for the frame on its own.
+		[[nodiscard]] double GetFrameTarget(const LuminanceHistogram& histogram) const;
+
+		// Adds the frame shown at the time. Returns true with the smoothed brightness once it has moved by more than
+		// the deadband from the last one returned, which the caller then applies. The first frame is taken as is.
+		bool Update(const LuminanceHistogram& histogram, Clock::time_point time, double& brightness);
+
+		// -1 before the first frame.
+		[[nodiscard]] double smoothed_brightness() const { return smoothed_brightness_; }
+
+	private:
+		ContentAdaptiveDimmingConfig config_;
+
+		bool has_frame_ = false;
+
+		Clock::time_point last_frame_time_{};
+
+		double smoothed_brightness_ = -1;
+
+		double applied_brightness_ = -1;
+	};
+}
+
+#endif
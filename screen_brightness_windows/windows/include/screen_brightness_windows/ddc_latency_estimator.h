@@ -0,0 +1,66 @@
+#ifndef FLUTTER_PLUGIN_SCREEN_BRIGHTNESS_WINDOWS_PLUGIN_DDC_LATENCY_ESTIMATOR_H
+#define FLUTTER_PLUGIN_SCREEN_BRIGHTNESS_WINDOWS_PLUGIN_DDC_LATENCY_ESTIMATOR_H
+
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+
+#include "clock.h"
+
+namespace screen_brightness
+{
+	struct DdcLatencyEstimate
+	{
+		std::uint64_t sample_count = 0;
+
+		// exponentially weighted moving average and mean deviation, as TCP estimates round trip times
+		Clock::duration smoothed{};
+
+		Clock::duration deviation{};
+
+		// over the last kWindowSize samples
+		Clock::duration p50{};
+
+		Clock::duration p90{};
+
+		Clock::duration p99{};
+
+		// What the next command is expected to take: the larger of the average, which follows a step change within a
+		// few samples, and the 90th percentile, which covers a slow tail. kInitialLatency before the first sample.
+		Clock::duration expected{};
+	};
+
+	// Online estimate of how long one DDC/CI command of a display takes. Monitors range from about 30 ms to more than
+	// 200 ms per command, and the same monitor slows down while it is busy, e.g. changing input or waking up.
+	class DdcLatencyEstimator final
+	{
+	public:
+		static constexpr std::size_t kWindowSize = 64;
+
+		// Assumed until the first command has been timed.
+		static constexpr Clock::duration kInitialLatency = std::chrono::milliseconds(50);
+
+		// Longer samples are clamped: the command has timed out, or it was a multi-part transfer such as the
+		// capability string, which says nothing about the next single command.
+		static constexpr Clock::duration kMaximumSample = std::chrono::milliseconds(500);
+
+		void AddSample(Clock::duration latency);
+
+		[[nodiscard]] std::uint64_t sample_count() const { return sample_count_; }
+
+		// Percentiles are nearest rank over the window.
+		[[nodiscard]] DdcLatencyEstimate GetEstimate() const;
+
+	private:
+		std::array<Clock::duration, kWindowSize> window_{};
+
+		std::uint64_t sample_count_ = 0;
+
+		Clock::duration smoothed_{};
+
+		Clock::duration deviation_{};
+	};
+}
+
+#endif
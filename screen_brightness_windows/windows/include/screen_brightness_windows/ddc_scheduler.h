@@ -0,0 +1,268 @@
+#ifndef FLUTTER_PLUGIN_SCREEN_BRIGHTNESS_WINDOWS_PLUGIN_DDC_SCHEDULER_H
+#define FLUTTER_PLUGIN_SCREEN_BRIGHTNESS_WINDOWS_PLUGIN_DDC_SCHEDULER_H
+
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <optional>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "clock.h"
+#include "ddc_latency_estimator.h"
+#include "monitor_backend.h"
+
+namespace screen_brightness
+{
+	// Lower values run first.
+	enum class DdcPriority
+	{
+		kUserWrite,
+		kAnimationStep,
+		kBackgroundPoll,
+	};
+
+	// Commands with the same non-zero coalescing key supersede each other while queued.
+	enum DdcCoalescingKey : std::uint32_t
+	{
+		kDdcNoCoalescing = 0,
+		kDdcBrightnessRead = 1,
+		kDdcBrightnessWrite = 2,
+		// ORed with the VCP code, see GetVcpWriteCoalescingKey
+		kDdcVcpWrite = 0x100,
+	};
+
+	// Writes of the same VCP feature supersede each other; luminance writes also supersede brightness writes.
+	[[nodiscard]] constexpr std::uint32_t GetVcpWriteCoalescingKey(const VcpCode code)
+	{
+		return code == kVcpLuminance ? kDdcBrightnessWrite : kDdcVcpWrite | code;
+	}
+
+	struct DdcSchedulerMetrics
+	{
+		std::size_t queue_depth = 0;
+
+		std::size_t maximum_queue_depth = 0;
+
+		std::uint64_t executed_count = 0;
+
+		std::uint64_t preempted_count = 0;
+
+		// low priority commands dropped because the bus already had more work queued than kMaximumBacklog
+		std::uint64_t shed_count = 0;
+
+		// time between submitting a command and starting it, over all executed commands
+		Clock::duration total_wait_time{};
+
+		Clock::duration maximum_wait_time{};
+
+		// time from starting a command to its completion
+		DdcLatencyEstimate latency;
+	};
+
+	// How fast work should be offered to a bus, derived from its latency estimate.
+	struct DdcPacing
+	{
+		// Time one command holds the bus: its expected latency plus the delay the monitor needs after it. Animation
+		// steps closer together than this only supersede each other in the queue, so a ramp should step at this rate.
+		Clock::duration command_period{};
+
+		// Polling the display for outside changes at this interval takes at most 1/kPollBusShare of the bus.
+		Clock::duration poll_interval{};
+	};
+
+	// Serialises the commands of one DDC/CI bus. Monitors NAK commands that follow each other faster than the MCCS
+	// minimum delays, so consecutive commands are spaced by at least the minimum command interval. Queued commands run
+	// by priority (user write, animation step, background poll) and then in submission order.
+	//
+	// The latency of every command feeds a DdcLatencyEstimator, from which the scheduler derives its pacing. Producers
+	// of animation steps and polls pace themselves with it, and the scheduler sheds lower priority commands which would
+	// queue more than kMaximumBacklog of bus time, so a slow monitor never builds up a backlog.
+	class DdcScheduler final
+	{
+	public:
+		using Operation = std::function<MonitorStatus()>;
+
+		using Completion = std::function<void(MonitorStatus status)>;
+
+		// Minimum delay after a DDC/CI write before the monitor accepts the next command.
+		static constexpr Clock::duration kMccsMinimumCommandInterval = std::chrono::milliseconds(50);
+
+		// Queued bus time beyond which animation steps and polls are shed.
+		static constexpr Clock::duration kMaximumBacklog = std::chrono::seconds(1);
+
+		static constexpr int kPollBusShare = 20;
+
+		static constexpr Clock::duration kMinimumPollInterval = std::chrono::seconds(1);
+
+		DdcScheduler(Clock& clock, Clock::duration minimum_command_interval);
+
+		DdcScheduler(const DdcScheduler&) = delete;
+
+		DdcScheduler& operator=(const DdcScheduler&) = delete;
+
+		~DdcScheduler();
+
+		// Queues a command. Queued commands with the same coalescing key and the same or a lower priority are preempted:
+		// they are dropped and complete with MonitorStatus::kPreempted. An animation step or poll which supersedes
+		// nothing also completes with kPreempted, without running, when the queue is already kMaximumBacklog long.
+		// Returns the sequence of the command, which identifies it while queued.
+		std::uint64_t Submit(DdcPriority priority, std::uint32_t coalescing_key, Operation operation, Completion completion = nullptr);
+
+		// Removes a queued command without running or completing it. Returns false once it has started or completed.
+		bool Withdraw(std::uint64_t sequence);
+
+		// Submits a command and waits for its completion, running the queue inline when there is no worker thread.
+		//
+		// Under an OperationContext the command is not submitted once the context has timed out or been cancelled, and
+		// the wait ends at its deadline or cancellation: a command still queued is withdrawn and never runs, and Run
+		// returns MonitorStatus::kTimedOut or kCancelled. A command which already started is waited for, as its
+		// operation may refer to the caller's stack.
+		[[nodiscard]] MonitorStatus Run(DdcPriority priority, std::uint32_t coalescing_key, Operation operation);
+
+		// Run, except that a command which already started is not waited for either when the context times out or is
+		// cancelled: it completes in the background. The operation must own everything it refers to but the backend.
+		[[nodiscard]] MonitorStatus RunDetachable(DdcPriority priority, std::uint32_t coalescing_key, Operation operation);
+
+		// RunDetachable without allocating: a copy of the function object runs in one of the scheduler's run slots, and
+		// is moved back into function once it completed, with the results it holds. Slots are reused, so only a caller
+		// waiting while all of them are in use adds one. Under the same rules as RunDetachable, the function object
+		// may only refer to the backend.
+		template <typename Function>
+		[[nodiscard]] MonitorStatus RunInPlace(const DdcPriority priority, const std::uint32_t coalescing_key, Function& function)
+		{
+			return RunInSlot(priority, coalescing_key, function, true);
+		}
+
+		// Runs the most urgent queued command once the bus is free. Returns false if nothing was queued.
+		bool RunNext();
+
+		void RunUntilIdle();
+
+		// Runs queued commands on a worker thread until Stop, which finishes the queue first.
+		void Start();
+
+		void Stop();
+
+		[[nodiscard]] Clock::duration minimum_command_interval() const;
+
+		void SetMinimumCommandInterval(Clock::duration minimum_command_interval);
+
+		[[nodiscard]] DdcSchedulerMetrics metrics() const;
+
+		[[nodiscard]] DdcPacing pacing() const;
+
+	private:
+		static constexpr std::size_t kRunSlotSize = 64;
+
+		// A command's function object and outcome, kept in place while its caller waits.
+		struct RunSlot
+		{
+			alignas(std::max_align_t) unsigned char storage[kRunSlotSize];
+
+			MonitorStatus (*invoke)(void* storage) = nullptr;
+
+			void (*destroy)(void* storage) = nullptr;
+
+			// set under the lock once the command completed, was preempted or shed
+			std::optional<MonitorStatus> status;
+
+			// the caller stopped waiting, so the slot is recycled on completion
+			bool is_abandoned = false;
+		};
+
+		struct Command
+		{
+			DdcPriority priority;
+
+			std::uint32_t coalescing_key;
+
+			std::uint64_t sequence;
+
+			Clock::time_point submit_time;
+
+			Operation operation;
+
+			Completion completion;
+
+			// instead of operation and completion
+			RunSlot* slot = nullptr;
+		};
+
+		Clock& clock_;
+
+		mutable std::mutex mutex_;
+
+		std::condition_variable condition_;
+
+		// signalled when a slot command completes
+		std::condition_variable slot_condition_;
+
+		std::vector<std::unique_ptr<RunSlot>> slots_;
+
+		std::vector<RunSlot*> free_slots_;
+
+		std::vector<Command> queue_;
+
+		std::uint64_t next_sequence_ = 0;
+
+		Clock::duration minimum_command_interval_;
+
+		std::optional<Clock::time_point> last_command_end_;
+
+		DdcSchedulerMetrics metrics_;
+
+		DdcLatencyEstimator latency_estimator_;
+
+		std::thread worker_;
+
+		bool is_stopping_ = false;
+
+		void RunWorker();
+
+		std::uint64_t SubmitCommand(DdcPriority priority, std::uint32_t coalescing_key, Operation operation, Completion completion, RunSlot* slot = nullptr);
+
+		template <typename Function>
+		[[nodiscard]] MonitorStatus RunInSlot(const DdcPriority priority, const std::uint32_t coalescing_key, Function& function, const bool is_detachable)
+		{
+			static_assert(sizeof(Function) <= kRunSlotSize && alignof(Function) <= alignof(std::max_align_t), "function object too large for a run slot");
+
+			RunSlot* const slot = AcquireSlot();
+			new (slot->storage) Function(std::move(function));
+			slot->invoke = [](void* storage) { return (*std::launder(static_cast<Function*>(storage)))(); };
+			slot->destroy = [](void* storage) { std::launder(static_cast<Function*>(storage))->~Function(); };
+			bool is_detached = false;
+			const MonitorStatus status = RunAndWait(priority, coalescing_key, *slot, is_detachable, is_detached);
+			if (!is_detached)
+			{
+				function = std::move(*std::launder(reinterpret_cast<Function*>(slot->storage)));
+				ReleaseSlot(slot);
+			}
+
+			return status;
+		}
+
+		// Takes a free slot, or adds one.
+		[[nodiscard]] RunSlot* AcquireSlot();
+
+		// Destroys the slot's function object and frees the slot.
+		void ReleaseSlot(RunSlot* slot);
+
+		// Requires the lock. Completes a slot command, recycling the slot if its caller stopped waiting.
+		void CompleteSlot(RunSlot& slot, MonitorStatus status);
+
+		// Runs the slot's command and waits for it as Run does. With is_detachable, a command which already started when
+		// the wait ended is left to the scheduler and is_detached is set; the caller must not touch the slot then.
+		[[nodiscard]] MonitorStatus RunAndWait(DdcPriority priority, std::uint32_t coalescing_key, RunSlot& slot, bool is_detachable, bool& is_detached);
+
+		// Requires the lock.
+		[[nodiscard]] DdcPacing GetPacing() const;
+	};
+}
+
+#endif
@@ -0,0 +1,42 @@
+#ifndef FLUTTER_PLUGIN_SCREEN_BRIGHTNESS_WINDOWS_PLUGIN_DISPLAY_IDENTITY_H
+#define FLUTTER_PLUGIN_SCREEN_BRIGHTNESS_WINDOWS_PLUGIN_DISPLAY_IDENTITY_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+#include "edid.h"
+
+namespace screen_brightness
+{
+	// Identity of a physical display which survives reboots, dock changes and port swaps, unlike its handle. Caches and
+	// preferences about a display are keyed on it.
+	struct DisplayIdentity
+	{
+		std::uint64_t value = 0;
+
+		[[nodiscard]] bool operator==(const DisplayIdentity& other) const { return value == other.value; }
+
+		[[nodiscard]] bool operator!=(const DisplayIdentity& other) const { return value != other.value; }
+	};
+
+	struct DisplayIdentityHash
+	{
+		// the identity already is a hash
+		std::size_t operator()(const DisplayIdentity& identity) const { return static_cast<std::size_t>(identity.value); }
+	};
+
+	// Hashes the manufacturer, product code, serial number and descriptor strings of the EDID. Many monitors have no
+	// serial (0, or the 0x01010101 placeholder) and no serial string, which makes identical models indistinguishable;
+	// for those the device id is mixed in, so they stay apart at the cost of following their port.
+	[[nodiscard]] DisplayIdentity GetDisplayIdentity(const Edid& edid, std::string_view id);
+
+	// Identity of a display without EDID, from its device id.
+	[[nodiscard]] DisplayIdentity GetDisplayIdentity(std::string_view id);
+
+	// 16 hex digits.
+	[[nodiscard]] std::string ToString(DisplayIdentity identity);
+}
+
+#endif
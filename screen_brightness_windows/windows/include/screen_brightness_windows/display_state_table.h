@@ -0,0 +1,115 @@
+#ifndef FLUTTER_PLUGIN_SCREEN_BRIGHTNESS_WINDOWS_PLUGIN_DISPLAY_STATE_TABLE_H
+#define FLUTTER_PLUGIN_SCREEN_BRIGHTNESS_WINDOWS_PLUGIN_DISPLAY_STATE_TABLE_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+
+#include "monitor_backend.h"
+
+namespace screen_brightness
+{
+	// Brightness state of one display, in the display's range; -1 while not known.
+	struct PublishedDisplayState
+	{
+		DisplayHandle display = 0;
+
+		// last value the process wrote, or the system brightness before the first write
+		long current = -1;
+
+		// the value the display should show: the override shown, or the system brightness
+		long target = -1;
+
+		long minimum = -1;
+
+		long maximum = -1;
+
+		long system = -1;
+
+		// process id of the process whose override the display shows, 0 while it shows the system brightness
+		std::uint32_t owner = 0;
+
+		// number of times the state has been published, so a reader can tell whether it has changed
+		std::uint64_t generation = 0;
+	};
+
+	// The brightness state of every display the process knows, for readers on any thread which cannot afford a lock,
+	// a system call or a platform channel message, e.g. a Dart isolate reading it through dart:ffi every frame.
+	//
+	// The table has a fixed layout which screen_brightness_ffi.h mirrors, so it can be read in place. Each slot is
+	// guarded by a sequence counter which is odd while the slot is being written: a reader reads the counter, the
+	// values and the counter again, and retries unless both reads return the same even value. Writers are serialised
+	// by a mutex; readers never block them.
+	class DisplayStateTable final
+	{
+	public:
+		static constexpr std::uint32_t kLayoutVersion = 1;
+
+		static constexpr std::size_t kSlotCount = 16;
+
+		struct Slot
+		{
+			// odd while the slot is being written, twice the generation otherwise
+			std::atomic<std::uint64_t> sequence{ 0 };
+
+			// 0 while the slot is free
+			std::atomic<std::uint64_t> display{ 0 };
+
+			std::atomic<std::int64_t> current{ -1 };
+
+			std::atomic<std::int64_t> target{ -1 };
+
+			std::atomic<std::int64_t> minimum{ -1 };
+
+			std::atomic<std::int64_t> maximum{ -1 };
+
+			std::atomic<std::int64_t> system{ -1 };
+
+			std::atomic<std::uint64_t> owner{ 0 };
+		};
+
+		struct Layout
+		{
+			std::uint32_t layout_version = kLayoutVersion;
+
+			std::uint32_t slot_count = kSlotCount;
+
+			// incremented after every change of any slot
+			std::atomic<std::uint64_t> generation{ 0 };
+
+			Slot slots[kSlotCount];
+		};
+
+		DisplayStateTable() = default;
+
+		DisplayStateTable(const DisplayStateTable&) = delete;
+
+		DisplayStateTable& operator=(const DisplayStateTable&) = delete;
+
+		[[nodiscard]] const Layout& layout() const { return layout_; }
+
+		[[nodiscard]] std::uint64_t generation() const { return layout_.generation.load(std::memory_order_acquire); }
+
+		// Writes the state of state.display, taking a free slot for a new display. Returns false if the table is full.
+		bool Publish(const PublishedDisplayState& state);
+
+		// Frees the display's slot once the display has gone, as its handle may be reused.
+		void Remove(DisplayHandle display);
+
+		// Returns false for a display which is not in the table.
+		[[nodiscard]] bool Read(DisplayHandle display, PublishedDisplayState& state) const;
+
+		// Reads the slot, whose display is 0 while it is free.
+		static void ReadSlot(const Slot& slot, PublishedDisplayState& state);
+
+	private:
+		Layout layout_;
+
+		std::mutex mutex_;
+
+		void WriteSlot(Slot& slot, const PublishedDisplayState& state);
+	};
+}
+
+#endif
@@ -0,0 +1,78 @@
+#ifndef FLUTTER_PLUGIN_SCREEN_BRIGHTNESS_WINDOWS_PLUGIN_DISPLAY_TOPOLOGY_H
+#define FLUTTER_PLUGIN_SCREEN_BRIGHTNESS_WINDOWS_PLUGIN_DISPLAY_TOPOLOGY_H
+
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "display_identity.h"
+#include "monitor_backend.h"
+
+namespace screen_brightness
+{
+	struct DisplayHandleChange
+	{
+		DisplayHandle previous = 0;
+
+		DisplayHandle current = 0;
+	};
+
+	struct DisplayTopologyDelta
+	{
+		std::vector<DisplayInfo> added;
+
+		std::vector<DisplayInfo> removed;
+
+		// retained displays which came back with another handle, e.g. after a mode change; the application does not
+		// see these, so they do not count towards empty()
+		std::vector<DisplayHandleChange> handle_changes;
+
+		[[nodiscard]] bool empty() const { return added.empty() && removed.empty(); }
+	};
+
+	// Known displays. Displays are diffed by stable id, so on a topology change only the delta is processed: removed
+	// displays are dropped, added displays are identified by their EDID and retained displays keep their identity with
+	// a refreshed handle. An index maps identities to the current displays. Brightness is not read here: the service
+	// reads a display's range once a client uses it, so a topology change costs no DDC/CI traffic.
+	class DisplayTopology final
+	{
+	public:
+		struct Display
+		{
+			DisplayInfo info;
+
+			// empty when the backend has no EDID for the display
+			std::vector<std::uint8_t> edid;
+		};
+
+		explicit DisplayTopology(MonitorBackend& backend);
+
+		// Re-enumerates the displays and applies the difference to the known displays.
+		[[nodiscard]] MonitorStatus Update(DisplayTopologyDelta& delta);
+
+		[[nodiscard]] const std::vector<Display>& displays() const { return displays_; }
+
+		[[nodiscard]] const Display* Find(const std::string& id) const;
+
+		[[nodiscard]] const Display* FindByHandle(DisplayHandle handle) const;
+
+		// O(1) lookup of the display currently attached with the identity.
+		[[nodiscard]] const Display* FindByIdentity(DisplayIdentity identity) const;
+
+	private:
+		MonitorBackend& backend_;
+
+		// sorted by id
+		std::vector<Display> displays_;
+
+		// identity to index into displays_
+		std::unordered_map<DisplayIdentity, size_t, DisplayIdentityHash> identity_index_;
+
+		void Identify(Display& display);
+
+		void UpdateIdentityIndex();
+	};
+}
+
+#endif
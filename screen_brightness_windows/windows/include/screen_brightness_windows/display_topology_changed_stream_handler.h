@@ -0,0 +1,16 @@
+#ifndef FLUTTER_PLUGIN_SCREEN_BRIGHTNESS_WINDOWS_PLUGIN_DISPLAY_TOPOLOGY_CHANGED_STREAM_HANDLER_H
+#define FLUTTER_PLUGIN_SCREEN_BRIGHTNESS_WINDOWS_PLUGIN_DISPLAY_TOPOLOGY_CHANGED_STREAM_HANDLER_H
+
+#include "base_stream_handler.h"
+#include "display_topology.h"
+
+namespace screen_brightness
+{
+	class DisplayTopologyChangedStreamHandler final : public BaseStreamHandler<flutter::EncodableValue>
+	{
+	public:
+		void AddDisplayTopologyDeltaToEventSink(const DisplayTopologyDelta& delta) const;
+	};
+}
+
+#endif
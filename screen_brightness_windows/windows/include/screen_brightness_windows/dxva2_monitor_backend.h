@@ -0,0 +1,37 @@
+#ifndef FLUTTER_PLUGIN_SCREEN_BRIGHTNESS_WINDOWS_PLUGIN_DXVA2_MONITOR_BACKEND_H
+#define FLUTTER_PLUGIN_SCREEN_BRIGHTNESS_WINDOWS_PLUGIN_DXVA2_MONITOR_BACKEND_H
+
+// This must be included before many other Windows headers.
+#include <Windows.h>
+
+#include "monitor_backend.h"
+
+namespace screen_brightness
+{
+	// Monitor backend over the DDC/CI high level monitor configuration API. Display handles are HMONITOR.
+	class Dxva2MonitorBackend final : public MonitorBackend
+	{
+	public:
+		static DisplayHandle ToDisplayHandle(HMONITOR monitor) { return reinterpret_cast<DisplayHandle>(monitor); }
+
+		static HMONITOR ToMonitor(DisplayHandle display) { return reinterpret_cast<HMONITOR>(display); }
+
+		MonitorStatus EnumerateDisplays(std::vector<DisplayInfo>& displays) override;
+
+		DisplayHandle GetPrimaryDisplay() override;
+
+		MonitorStatus GetScreenBrightness(DisplayHandle display, long& minimum_screen_brightness, long& screen_brightness, long& maximum_screen_brightness) override;
+
+		MonitorStatus SetScreenBrightness(DisplayHandle display, long screen_brightness) override;
+
+		MonitorStatus GetVcpFeature(DisplayHandle display, VcpCode code, unsigned long& current_value, unsigned long& maximum_value) override;
+
+		MonitorStatus SetVcpFeature(DisplayHandle display, VcpCode code, unsigned long value) override;
+
+		MonitorStatus GetCapabilitiesString(DisplayHandle display, std::string& capabilities) override;
+
+		MonitorStatus GetEdid(DisplayHandle display, std::vector<std::uint8_t>& edid) override;
+	};
+}
+
+#endif
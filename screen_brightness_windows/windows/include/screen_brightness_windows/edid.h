@@ -0,0 +1,77 @@
+#ifndef FLUTTER_PLUGIN_SCREEN_BRIGHTNESS_WINDOWS_PLUGIN_EDID_H
+#define FLUTTER_PLUGIN_SCREEN_BRIGHTNESS_WINDOWS_PLUGIN_EDID_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+
+namespace screen_brightness
+{
+	// Identification fields of an EDID (VESA Enhanced Extended Display Identification Data) base block. The descriptor
+	// strings are views into the parsed blob, which must outlive the Edid.
+	class Edid final
+	{
+	public:
+		static constexpr std::size_t kBlockSize = 128;
+
+		// Returns false if the data is shorter than a block or has no EDID header. A wrong checksum is accepted, as
+		// KVM switches and overridden EDIDs often leave it stale, and reported by is_checksum_valid.
+		bool Parse(const std::uint8_t* data, std::size_t size);
+
+		// Three letter PNP id, e.g. "DEL".
+		[[nodiscard]] std::string_view manufacturer_id() const { return { manufacturer_id_, 3 }; }
+
+		[[nodiscard]] std::uint16_t product_code() const { return product_code_; }
+
+		// 0 when the monitor has none.
+		[[nodiscard]] std::uint32_t serial_number() const { return serial_number_; }
+
+		// 0 when unknown; the week is also 0 when the year is a model year.
+		[[nodiscard]] int manufacture_week() const { return manufacture_week_; }
+
+		[[nodiscard]] int manufacture_year() const { return manufacture_year_; }
+
+		[[nodiscard]] std::string_view monitor_name() const { return monitor_name_; }
+
+		[[nodiscard]] std::string_view serial_string() const { return serial_string_; }
+
+		[[nodiscard]] std::string_view text() const { return text_; }
+
+		// From the preferred detailed timing when it has one, otherwise from the centimetre sizes. 0 for projectors
+		// and unknown sizes.
+		[[nodiscard]] int width_millimeters() const { return width_millimeters_; }
+
+		[[nodiscard]] int height_millimeters() const { return height_millimeters_; }
+
+		[[nodiscard]] int extension_count() const { return extension_count_; }
+
+		[[nodiscard]] bool is_checksum_valid() const { return is_checksum_valid_; }
+
+	private:
+		char manufacturer_id_[3] = { '?', '?', '?' };
+
+		std::uint16_t product_code_ = 0;
+
+		std::uint32_t serial_number_ = 0;
+
+		int manufacture_week_ = 0;
+
+		int manufacture_year_ = 0;
+
+		std::string_view monitor_name_;
+
+		std::string_view serial_string_;
+
+		std::string_view text_;
+
+		int width_millimeters_ = 0;
+
+		int height_millimeters_ = 0;
+
+		int extension_count_ = 0;
+
+		bool is_checksum_valid_ = false;
+	};
+}
+
+#endif
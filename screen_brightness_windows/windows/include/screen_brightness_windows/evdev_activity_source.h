@@ -0,0 +1,66 @@
+#ifndef FLUTTER_PLUGIN_SCREEN_BRIGHTNESS_WINDOWS_PLUGIN_EVDEV_ACTIVITY_SOURCE_H
+#define FLUTTER_PLUGIN_SCREEN_BRIGHTNESS_WINDOWS_PLUGIN_EVDEV_ACTIVITY_SOURCE_H
+
+#include <chrono>
+#include <cstddef>
+#include <string>
+#include <vector>
+
+#include "input_activity.h"
+
+namespace screen_brightness
+{
+	// The last input of every Linux input device, from the evdev character devices under root (/dev/input/event*).
+	//
+	// The devices are opened without blocking and asked for CLOCK_MONOTONIC timestamps; each poll drains what they
+	// queued since the last one and takes the newest event which is not a synchronization report. Devices are looked
+	// for again every kRescanInterval, so that a keyboard plugged in later counts, and dropped once removed.
+	//
+	// Reading evdev devices needs access to them, usually membership of the input group. Without any device every
+	// poll reports input, so that a missing permission never dims the display.
+	class EvdevActivitySource final : public InputActivitySource
+	{
+	public:
+		static constexpr Clock::duration kRescanInterval = std::chrono::seconds(5);
+
+		explicit EvdevActivitySource(Clock& clock, std::string root = "/dev/input");
+
+		EvdevActivitySource(const EvdevActivitySource&) = delete;
+
+		EvdevActivitySource& operator=(const EvdevActivitySource&) = delete;
+
+		~EvdevActivitySource() override;
+
+		[[nodiscard]] bool is_open() const { return !devices_.empty(); }
+
+		[[nodiscard]] std::size_t device_count() const { return devices_.size(); }
+
+		[[nodiscard]] Clock::time_point GetLastInputTime() override;
+
+	private:
+		struct Device
+		{
+			std::string name;
+
+			int file = -1;
+		};
+
+		Clock& clock_;
+
+		std::string root_;
+
+		std::vector<Device> devices_;
+
+		Clock::time_point last_scan_time_{};
+
+		Clock::time_point last_input_time_{};
+
+		// Opens the event devices which are not open yet.
+		void Scan(Clock::time_point now);
+
+		// Reads the device's queue; returns false once the device is gone.
+		[[nodiscard]] bool Drain(const Device& device, Clock::time_point now);
+	};
+}
+
+#endif
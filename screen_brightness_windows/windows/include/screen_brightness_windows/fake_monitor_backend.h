@@ -0,0 +1,95 @@
+#ifndef FLUTTER_PLUGIN_SCREEN_BRIGHTNESS_WINDOWS_PLUGIN_FAKE_MONITOR_BACKEND_H
+#define FLUTTER_PLUGIN_SCREEN_BRIGHTNESS_WINDOWS_PLUGIN_FAKE_MONITOR_BACKEND_H
+
+#include <map>
+#include <string>
+#include <vector>
+
+#include "monitor_backend.h"
+
+namespace screen_brightness
+{
+	// In-memory monitor backend for tests, benchmarks and `sbctl --backend=fake`.
+	class FakeMonitorBackend final : public MonitorBackend
+	{
+	public:
+		struct VcpFeature
+		{
+			unsigned long current_value = 0;
+
+			unsigned long maximum_value = 0;
+		};
+
+		struct Display
+		{
+			// also used as the stable id of the display
+			std::string name;
+
+			long minimum_brightness = 0;
+
+			long brightness = 0;
+
+			long maximum_brightness = 100;
+
+			bool is_failing = false;
+
+			// VCP features besides luminance, which is backed by the brightness fields
+			std::map<VcpCode, VcpFeature> vcp_features;
+
+			// empty for a monitor that does not answer capability requests
+			std::string capabilities;
+
+			// empty for a display without EDID
+			std::vector<std::uint8_t> edid;
+		};
+
+		DisplayHandle AddDisplay(Display display);
+
+		void RemoveDisplay(DisplayHandle display);
+
+		[[nodiscard]] Display& GetDisplay(DisplayHandle display);
+
+		[[nodiscard]] long get_count() const { return get_count_; }
+
+		[[nodiscard]] long set_count() const { return set_count_; }
+
+		[[nodiscard]] long vcp_get_count() const { return vcp_get_count_; }
+
+		[[nodiscard]] long vcp_set_count() const { return vcp_set_count_; }
+
+		[[nodiscard]] long capabilities_count() const { return capabilities_count_; }
+
+		MonitorStatus EnumerateDisplays(std::vector<DisplayInfo>& displays) override;
+
+		DisplayHandle GetPrimaryDisplay() override;
+
+		MonitorStatus GetScreenBrightness(DisplayHandle display, long& minimum_screen_brightness, long& screen_brightness, long& maximum_screen_brightness) override;
+
+		MonitorStatus SetScreenBrightness(DisplayHandle display, long screen_brightness) override;
+
+		MonitorStatus GetVcpFeature(DisplayHandle display, VcpCode code, unsigned long& current_value, unsigned long& maximum_value) override;
+
+		MonitorStatus SetVcpFeature(DisplayHandle display, VcpCode code, unsigned long value) override;
+
+		MonitorStatus GetCapabilitiesString(DisplayHandle display, std::string& capabilities) override;
+
+		MonitorStatus GetEdid(DisplayHandle display, std::vector<std::uint8_t>& edid) override;
+
+	private:
+		std::map<DisplayHandle, Display> displays_;
+
+		DisplayHandle next_display_ = 1;
+
+		long get_count_ = 0;
+
+		long set_count_ = 0;
+
+		long vcp_get_count_ = 0;
+
+		long vcp_set_count_ = 0;
+
+		long capabilities_count_ = 0;
+	};
+}
+
+#endif
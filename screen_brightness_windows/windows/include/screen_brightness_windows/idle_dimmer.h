@@ -0,0 +1,126 @@
+#ifndef FLUTTER_PLUGIN_SCREEN_BRIGHTNESS_WINDOWS_PLUGIN_IDLE_DIMMER_H
+#define FLUTTER_PLUGIN_SCREEN_BRIGHTNESS_WINDOWS_PLUGIN_IDLE_DIMMER_H
+
+#include <chrono>
+
+#include "brightness_service.h"
+#include "clock.h"
+#include "input_activity.h"
+
+namespace screen_brightness
+{
+	struct IdleDimmingConfig
+	{
+		// time without input after which the display is dimmed
+		Clock::duration idle_timeout = std::chrono::seconds(60);
+
+		// application brightness while idle, 0.0 to 1.0; a display already darker is left alone
+		double dimmed_brightness = 0.1;
+
+		Clock::duration dim_duration = std::chrono::seconds(1);
+
+		// the first input brightens the display again quickly
+		Clock::duration restore_duration = std::chrono::milliseconds(250);
+
+		// how often input is looked for while dimmed
+		Clock::duration input_poll_interval = std::chrono::milliseconds(250);
+	};
+
+	enum class IdleState
+	{
+		kActive,
+		kDimming,
+		kDimmed,
+		kRestoring,
+	};
+
+	[[nodiscard]] const char* GetIdleStateName(IdleState state);
+
+	// Dims the client's display after a time without input, and restores what it showed on the next input, each with
+	// a linear ramp. The input source is only polled at the times Poll returns, which are the idle deadline while
+	// active, so input events cost nothing and the display is only written on a change of state and for ramp steps.
+	// Ramps step at the display's DDC/CI command period, as closer steps would only replace each other in its queue;
+	// each step writes where the ramp is due at the end of its period, so a slow monitor takes fewer, larger steps.
+	//
+	// An application brightness set by anyone else while dimmed wins: the dimmer neither overwrites nor restores it,
+	// and waits for the next input and timeout.
+	//
+	// Used on the client's thread.
+	class IdleDimmer final
+	{
+	public:
+		// Steps closer together than a frame are not seen.
+		static constexpr Clock::duration kMinimumStepPeriod = std::chrono::milliseconds(16);
+
+		IdleDimmer(BrightnessClient& client, InputActivitySource& input, Clock& clock);
+
+		IdleDimmer(const IdleDimmer&) = delete;
+
+		IdleDimmer& operator=(const IdleDimmer&) = delete;
+
+		[[nodiscard]] bool is_enabled() const { return is_enabled_; }
+
+		[[nodiscard]] IdleState state() const { return state_; }
+
+		[[nodiscard]] const IdleDimmingConfig& config() const { return config_; }
+
+		// Applies to the next dimming; the idle time counts from now at the earliest.
+		void SetConfig(const IdleDimmingConfig& config);
+
+		// Disabling restores the display at once.
+		void SetEnabled(bool is_enabled);
+
+		// Advances the state machine and returns when to poll next, or Clock::time_point::max() while disabled.
+		Clock::time_point Poll();
+
+	private:
+		BrightnessClient& client_;
+
+		InputActivitySource& input_;
+
+		Clock& clock_;
+
+		IdleDimmingConfig config_;
+
+		bool is_enabled_ = false;
+
+		IdleState state_ = IdleState::kActive;
+
+		// input before this does not keep the display active, so that enabling or giving way starts a new timeout
+		Clock::time_point active_since_{};
+
+		// the last input when dimming started; input after it restores
+		Clock::time_point idle_input_time_{};
+
+		// the override to restore, -1 for none
+		double restore_brightness_ = -1;
+
+		// of the current ramp, which the steps interpolate
+		double ramp_from_ = 0;
+
+		double ramp_to_ = 0;
+
+		Clock::time_point ramp_start_{};
+
+		Clock::duration ramp_duration_{};
+
+		Clock::duration step_period_{};
+
+		// the override as it was after the last write, to notice writes of others
+		double written_brightness_ = -1;
+
+		void StartRamp(IdleState state, double from, double to, Clock::time_point now, Clock::duration duration);
+
+		// Writes the next step; returns false when the ramp has ended.
+		bool StepRamp(Clock::time_point now);
+
+		// Writes the brightness to restore, or resets the override.
+		void Restore();
+
+		void BecomeActive(Clock::time_point now);
+
+		[[nodiscard]] double GetShownBrightness() const;
+	};
+}
+
+#endif
@@ -0,0 +1,99 @@
+#ifndef FLUTTER_PLUGIN_SCREEN_BRIGHTNESS_WINDOWS_PLUGIN_IIO_AMBIENT_LIGHT_SOURCE_H
+#define FLUTTER_PLUGIN_SCREEN_BRIGHTNESS_WINDOWS_PLUGIN_IIO_AMBIENT_LIGHT_SOURCE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+#include "ambient_light.h"
+
+namespace screen_brightness
+{
+	// Ambient light sensor of the Linux Industrial I/O subsystem (/sys/bus/iio/devices), the first device, by name,
+	// with an illuminance channel.
+	//
+	// When the device has a buffer which can be enabled, e.g. a triggered one, the source enables the illuminance
+	// scan element and the buffer, and drains the samples from the device's character device under device_root
+	// without blocking. Otherwise it reads in_illuminance_input, or in_illuminance_raw with its scale and offset, on
+	// every read. Paths are built once so reading does not allocate.
+	class IioAmbientLightSource final : public AmbientLightSource
+	{
+	public:
+		explicit IioAmbientLightSource(std::string root = "/sys/bus/iio/devices", std::string device_root = "/dev");
+
+		IioAmbientLightSource(const IioAmbientLightSource&) = delete;
+
+		IioAmbientLightSource& operator=(const IioAmbientLightSource&) = delete;
+
+		// Disables the buffer again if the source enabled it.
+		~IioAmbientLightSource() override;
+
+		[[nodiscard]] bool is_open() const { return !device_name_.empty(); }
+
+		[[nodiscard]] bool is_buffered() const { return buffer_file_ >= 0; }
+
+		// e.g. iio:device0, empty without a sensor
+		[[nodiscard]] const std::string& device_name() const { return device_name_; }
+
+		[[nodiscard]] bool ReadIlluminance(double& lux) override;
+
+		[[nodiscard]] std::uint64_t sample_count() const override { return sample_count_; }
+
+	private:
+		// Layout of the illuminance sample in a buffer record, from the scan element's type, e.g. le:u16/16>>0.
+		struct ScanElement
+		{
+			std::size_t offset = 0;
+
+			std::size_t storage_bytes = 0;
+
+			unsigned bits = 0;
+
+			unsigned shift = 0;
+
+			bool is_signed = false;
+
+			bool is_big_endian = false;
+		};
+
+		std::string root_;
+
+		std::string device_root_;
+
+		std::string device_name_;
+
+		// in_illuminance_input, or in_illuminance_raw unless is_processed_
+		std::string value_path_;
+
+		bool is_processed_ = false;
+
+		double scale_ = 1;
+
+		double offset_ = 0;
+
+		std::string buffer_enable_path_;
+
+		std::string scan_element_enable_path_;
+
+		int buffer_file_ = -1;
+
+		ScanElement scan_element_;
+
+		std::size_t record_size_ = 0;
+
+		std::uint64_t sample_count_ = 0;
+
+		[[nodiscard]] bool OpenDevice(const std::string& name);
+
+		// Lays out the enabled scan elements as the kernel does, each aligned to its storage size.
+		[[nodiscard]] bool ReadScanLayout(const std::string& scan_elements_path, const std::string& channel);
+
+		[[nodiscard]] bool EnableBuffer(const std::string& channel);
+
+		[[nodiscard]] bool ReadBuffer(double& lux);
+
+		[[nodiscard]] double DecodeSample(const unsigned char* record) const;
+	};
+}
+
+#endif
@@ -0,0 +1,31 @@
+#ifndef FLUTTER_PLUGIN_SCREEN_BRIGHTNESS_WINDOWS_PLUGIN_INPUT_ACTIVITY_H
+#define FLUTTER_PLUGIN_SCREEN_BRIGHTNESS_WINDOWS_PLUGIN_INPUT_ACTIVITY_H
+
+#include "clock.h"
+
+namespace screen_brightness
+{
+	// When the user last gave input, on a Clock's time line. Sources are polled, so that input events themselves cost
+	// nothing.
+	class InputActivitySource
+	{
+	public:
+		virtual ~InputActivitySource() = default;
+
+		[[nodiscard]] virtual Clock::time_point GetLastInputTime() = 0;
+	};
+
+	// Synthetic input for tests.
+	class ManualInputActivitySource final : public InputActivitySource
+	{
+	public:
+		[[nodiscard]] Clock::time_point GetLastInputTime() override { return last_input_time_; }
+
+		void OnInput(Clock::time_point time) { last_input_time_ = time; }
+
+	private:
+		Clock::time_point last_input_time_{};
+	};
+}
+
+#endif
@@ -0,0 +1,27 @@
+#ifndef FLUTTER_PLUGIN_SCREEN_BRIGHTNESS_WINDOWS_PLUGIN_LAST_INPUT_INFO_ACTIVITY_SOURCE_H
+#define FLUTTER_PLUGIN_SCREEN_BRIGHTNESS_WINDOWS_PLUGIN_LAST_INPUT_INFO_ACTIVITY_SOURCE_H
+
+// This must be included before many other Windows headers.
+#include <Windows.h>
+
+#include "input_activity.h"
+
+namespace screen_brightness
+{
+	// The last input of the session, keyboard and mouse of every application, from GetLastInputInfo.
+	class LastInputInfoActivitySource final : public InputActivitySource
+	{
+	public:
+		explicit LastInputInfoActivitySource(Clock& clock) : clock_(clock)
+		{
+		}
+
+		// The current time when the system cannot tell, so that a failure never dims the display.
+		[[nodiscard]] Clock::time_point GetLastInputTime() override;
+
+	private:
+		Clock& clock_;
+	};
+}
+
+#endif
@@ -0,0 +1,70 @@
+#ifndef FLUTTER_PLUGIN_SCREEN_BRIGHTNESS_WINDOWS_PLUGIN_LUMINANCE_HISTOGRAM_H
+#define FLUTTER_PLUGIN_SCREEN_BRIGHTNESS_WINDOWS_PLUGIN_LUMINANCE_HISTOGRAM_H
+
+#include <cstddef>
+#include <cstdint>
+
+namespace screen_brightness
+{
+	enum class PixelFormat
+	{
+		kRgba8,
+		kBgra8,
+	};
+
+	// A frame buffer owned by the caller, read in place.
+	struct FrameView
+	{
+		const std::uint8_t* pixels = nullptr;
+
+		std::size_t width = 0;
+
+		std::size_t height = 0;
+
+		// bytes from one row to the next, at least width * 4
+		std::size_t stride = 0;
+
+		PixelFormat format = PixelFormat::kRgba8;
+	};
+
+	// Histogram of the BT.709 luma of a frame, 0 to 255, ignoring alpha.
+	struct LuminanceHistogram
+	{
+		static constexpr std::size_t kBinCount = 256;
+
+		std::uint32_t bins[kBinCount] = {};
+
+		std::uint64_t sample_count = 0;
+
+		// 0.0 for black to 1.0 for white, 0 without samples
+		[[nodiscard]] double GetMean() const;
+
+		// The luma below which the fraction of the samples is, 0.0 to 1.0.
+		[[nodiscard]] double GetPercentile(double fraction) const;
+	};
+
+	// Implementations of the luma conversion, which is where the time goes.
+	enum class LuminanceKernel
+	{
+		kScalar,
+		kSse2,
+		kAvx2,
+		kNeon,
+	};
+
+	[[nodiscard]] const char* GetLuminanceKernelName(LuminanceKernel kernel);
+
+	// Whether the kernel is compiled in and the processor supports it.
+	[[nodiscard]] bool IsLuminanceKernelSupported(LuminanceKernel kernel);
+
+	// The fastest supported kernel, detected once.
+	[[nodiscard]] LuminanceKernel GetBestLuminanceKernel();
+
+	// Computes the histogram of every row_step-th row, starting with the first. All pixels of a sampled row count, so
+	// that the kernels read memory sequentially; a 4K frame at row_step 4 is 540 rows of 3840 pixels. Returns false for
+	// an invalid frame or kernel, leaving the histogram empty. Does not allocate.
+	bool ComputeLuminanceHistogram(const FrameView& frame, std::size_t row_step, LuminanceHistogram& histogram,
+		LuminanceKernel kernel = GetBestLuminanceKernel());
+}
+
+#endif
@@ -0,0 +1,95 @@
+#ifndef FLUTTER_PLUGIN_SCREEN_BRIGHTNESS_WINDOWS_PLUGIN_MCCS_CAPABILITIES_H
+#define FLUTTER_PLUGIN_SCREEN_BRIGHTNESS_WINDOWS_PLUGIN_MCCS_CAPABILITIES_H
+
+#include <array>
+#include <bitset>
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+#include <vector>
+
+#include "monitor_backend.h"
+
+namespace screen_brightness
+{
+	// Allowed values of one non-continuous VCP feature, pointing into MccsCapabilities.
+	struct VcpValueList
+	{
+		const std::uint8_t* data = nullptr;
+
+		std::size_t size = 0;
+
+		[[nodiscard]] const std::uint8_t* begin() const { return data; }
+
+		[[nodiscard]] const std::uint8_t* end() const { return data + size; }
+
+		[[nodiscard]] bool empty() const { return size == 0; }
+	};
+
+	// Table of the VCP features in an MCCS capability string, e.g.
+	// "(prot(monitor)type(lcd)vcp(02 04 10 12 14(05 08 0B) 60(0F 11)))".
+	//
+	// Parsing is a single pass over the string without a token list: supported codes are a bitset, the allowed values
+	// of all codes share one flat array indexed per code, and the text fields are views into the parsed string, which
+	// must outlive the table. Re-parsing into the same table does not allocate once its value array is large enough.
+	//
+	// Capability strings from the field are often malformed, so parsing is best effort: missing outer or closing
+	// parentheses, codes without separating spaces, tag case, spaces before '(', nested value groups, repeated vcp
+	// sections and trailing garbage are all accepted. Tokens which cannot be read are skipped.
+	class MccsCapabilities final
+	{
+	public:
+		// Returns false if the string has no vcp section; the text fields may still have been found.
+		bool Parse(std::string_view capabilities);
+
+		[[nodiscard]] bool IsSupported(const VcpCode code) const { return supported_codes_[code]; }
+
+		[[nodiscard]] const std::bitset<256>& supported_codes() const { return supported_codes_; }
+
+		[[nodiscard]] std::size_t code_count() const { return supported_codes_.count(); }
+
+		// Empty for continuous features and for codes which are not supported.
+		[[nodiscard]] VcpValueList GetAllowedValues(VcpCode code) const;
+
+		// True if the monitor lists the code and either lists the value or has no value list for the code.
+		[[nodiscard]] bool IsAllowed(VcpCode code, unsigned long value) const;
+
+		[[nodiscard]] std::string_view protocol() const { return protocol_; }
+
+		[[nodiscard]] std::string_view type() const { return type_; }
+
+		[[nodiscard]] std::string_view model() const { return model_; }
+
+		[[nodiscard]] std::string_view mccs_version() const { return mccs_version_; }
+
+	private:
+		struct ValueRange
+		{
+			std::uint32_t offset = 0;
+
+			std::uint16_t size = 0;
+		};
+
+		std::bitset<256> supported_codes_;
+
+		std::array<ValueRange, 256> value_ranges_{};
+
+		std::vector<std::uint8_t> values_;
+
+		std::string_view protocol_;
+
+		std::string_view type_;
+
+		std::string_view model_;
+
+		std::string_view mccs_version_;
+
+		void Clear();
+
+		void ParseVcpList(std::string_view list);
+
+		void ParseValueList(VcpCode code, std::string_view list);
+	};
+}
+
+#endif
@@ -0,0 +1,95 @@
+#ifndef FLUTTER_PLUGIN_SCREEN_BRIGHTNESS_WINDOWS_PLUGIN_MONITOR_BACKEND_H
+#define FLUTTER_PLUGIN_SCREEN_BRIGHTNESS_WINDOWS_PLUGIN_MONITOR_BACKEND_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "display_identity.h"
+
+namespace screen_brightness
+{
+	// Opaque handle of a display, e.g. a HMONITOR on Windows. 0 is never a valid display.
+	using DisplayHandle = std::uintptr_t;
+
+	// Result of a hardware operation. Hardware failures are routine (flaky DDC/CI links, displays unplugged mid call), so
+	// they are reported as values instead of exceptions.
+	enum class MonitorStatus
+	{
+		kOk,
+		kEnumerateMonitorsFailed,
+		kGetNumberOfMonitorsFailed,
+		kNoMonitors,
+		kGetPhysicalMonitorsFailed,
+		kGetBrightnessFailed,
+		kSetBrightnessFailed,
+		kPreempted,
+		kGetVcpFeatureFailed,
+		kSetVcpFeatureFailed,
+		kGetCapabilitiesFailed,
+		kUnsupported,
+		kGetEdidFailed,
+		kSharedMemoryFailed,
+		kBrokerFailed,
+		kTraceFailed,
+		kTimedOut,
+		kJournalFailed,
+		kCancelled,
+	};
+
+	[[nodiscard]] const char* GetMonitorStatusMessage(MonitorStatus status);
+
+	// MCCS (VESA Monitor Control Command Set) VCP feature code.
+	using VcpCode = std::uint8_t;
+
+	constexpr VcpCode kVcpLuminance = 0x10;
+
+	constexpr VcpCode kVcpContrast = 0x12;
+
+	constexpr VcpCode kVcpColorPreset = 0x14;
+
+	constexpr VcpCode kVcpInputSource = 0x60;
+
+	struct DisplayInfo
+	{
+		DisplayHandle handle = 0;
+
+		// Stable identity of the display. Unlike the handle it survives re-enumeration, e.g. after a dock change.
+		std::string id;
+
+		std::string name;
+
+		// Filled in by DisplayTopology from the EDID; backends leave it empty.
+		DisplayIdentity identity;
+	};
+
+	// Hardware access used by BrightnessService. GetScreenBrightness and SetScreenBrightness are called on every brightness
+	// change and must neither allocate nor throw.
+	class MonitorBackend
+	{
+	public:
+		virtual ~MonitorBackend() = default;
+
+		[[nodiscard]] virtual MonitorStatus EnumerateDisplays(std::vector<DisplayInfo>& displays) = 0;
+
+		virtual DisplayHandle GetPrimaryDisplay() = 0;
+
+		[[nodiscard]] virtual MonitorStatus GetScreenBrightness(DisplayHandle display, long& minimum_screen_brightness, long& screen_brightness, long& maximum_screen_brightness) = 0;
+
+		[[nodiscard]] virtual MonitorStatus SetScreenBrightness(DisplayHandle display, long screen_brightness) = 0;
+
+		// Generic VCP feature access. Backends without DDC/CI return MonitorStatus::kUnsupported for codes they cannot
+		// map.
+		[[nodiscard]] virtual MonitorStatus GetVcpFeature(DisplayHandle display, VcpCode code, unsigned long& current_value, unsigned long& maximum_value) = 0;
+
+		[[nodiscard]] virtual MonitorStatus SetVcpFeature(DisplayHandle display, VcpCode code, unsigned long value) = 0;
+
+		// Reads the MCCS capability string, which takes the monitor up to a few seconds to answer.
+		[[nodiscard]] virtual MonitorStatus GetCapabilitiesString(DisplayHandle display, std::string& capabilities) = 0;
+
+		// Reads the EDID of the display, including its extension blocks when available.
+		[[nodiscard]] virtual MonitorStatus GetEdid(DisplayHandle display, std::vector<std::uint8_t>& edid) = 0;
+	};
+}
+
+#endif
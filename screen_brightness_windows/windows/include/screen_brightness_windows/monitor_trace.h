@@ -0,0 +1,198 @@
+#ifndef FLUTTER_PLUGIN_SCREEN_BRIGHTNESS_WINDOWS_PLUGIN_MONITOR_TRACE_H
+#define FLUTTER_PLUGIN_SCREEN_BRIGHTNESS_WINDOWS_PLUGIN_MONITOR_TRACE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "clock.h"
+#include "monitor_backend.h"
+
+namespace screen_brightness
+{
+	enum class MonitorTraceCall : std::uint8_t
+	{
+		kEnumerateDisplays = 1,
+		kGetPrimaryDisplay,
+		kGetScreenBrightness,
+		kSetScreenBrightness,
+		kGetVcpFeature,
+		kSetVcpFeature,
+		kGetCapabilitiesString,
+		kGetEdid,
+	};
+
+	// One backend call of a trace.
+	struct MonitorTraceRecord
+	{
+		MonitorTraceCall call = MonitorTraceCall::kEnumerateDisplays;
+
+		MonitorStatus status = MonitorStatus::kOk;
+
+		// from the start of the recording to the start of the call
+		Clock::duration start{};
+
+		Clock::duration duration{};
+
+		// the display called, or the result of GetPrimaryDisplay
+		DisplayHandle display = 0;
+
+		VcpCode code = 0;
+
+		// minimum, current and maximum value of a read, or the value of a write in the first
+		std::int64_t values[3] = {};
+
+		// capability string
+		std::string text;
+
+		// EDID
+		std::vector<std::uint8_t> bytes;
+
+		std::vector<DisplayInfo> displays;
+	};
+
+	// Reads a trace written by RecordingMonitorBackend. A record cut short by a crash ends the trace; anything else
+	// which is not a trace fails with MonitorStatus::kTraceFailed.
+	[[nodiscard]] MonitorStatus LoadMonitorTrace(const std::string& path, std::vector<MonitorTraceRecord>& records);
+
+	[[nodiscard]] MonitorStatus DecodeMonitorTrace(const std::vector<std::uint8_t>& trace, std::vector<MonitorTraceRecord>& records);
+
+	// Forwards to another backend and logs every call, with its arguments, results and timing, to a trace file.
+	//
+	// Records are a few bytes each: integers are varints and start times are deltas. They are buffered and written
+	// once kBufferSize is reached and on Close, so brightness calls neither allocate nor wait for the disk. Calls may
+	// come from several threads.
+	class RecordingMonitorBackend final : public MonitorBackend
+	{
+	public:
+		static constexpr std::size_t kBufferSize = 64 * 1024;
+
+		RecordingMonitorBackend(MonitorBackend& backend, Clock& clock);
+
+		RecordingMonitorBackend(const RecordingMonitorBackend&) = delete;
+
+		RecordingMonitorBackend& operator=(const RecordingMonitorBackend&) = delete;
+
+		~RecordingMonitorBackend() override;
+
+		// Starts a trace at the path, replacing any file there. Calls before Open are forwarded only.
+		[[nodiscard]] MonitorStatus Open(const std::string& path);
+
+		// Writes the buffered records to the file.
+		[[nodiscard]] MonitorStatus Flush();
+
+		void Close();
+
+		[[nodiscard]] std::size_t record_count() const;
+
+		MonitorStatus EnumerateDisplays(std::vector<DisplayInfo>& displays) override;
+
+		DisplayHandle GetPrimaryDisplay() override;
+
+		MonitorStatus GetScreenBrightness(DisplayHandle display, long& minimum_screen_brightness, long& screen_brightness, long& maximum_screen_brightness) override;
+
+		MonitorStatus SetScreenBrightness(DisplayHandle display, long screen_brightness) override;
+
+		MonitorStatus GetVcpFeature(DisplayHandle display, VcpCode code, unsigned long& current_value, unsigned long& maximum_value) override;
+
+		MonitorStatus SetVcpFeature(DisplayHandle display, VcpCode code, unsigned long value) override;
+
+		MonitorStatus GetCapabilitiesString(DisplayHandle display, std::string& capabilities) override;
+
+		MonitorStatus GetEdid(DisplayHandle display, std::vector<std::uint8_t>& edid) override;
+
+	private:
+		MonitorBackend& backend_;
+
+		Clock& clock_;
+
+		mutable std::mutex mutex_;
+
+		std::FILE* file_ = nullptr;
+
+		std::vector<std::uint8_t> buffer_;
+
+		Clock::time_point start_time_{};
+
+		Clock::duration previous_start_{};
+
+		std::size_t record_count_ = 0;
+
+		// Times and encodes the record if a trace is open, and writes the buffer out once it is full.
+		void Append(MonitorTraceRecord& record, Clock::time_point start);
+
+		// Requires the lock.
+		[[nodiscard]] bool WriteBuffer();
+	};
+
+	// Answers backend calls from a trace, each taking as long on the clock as the recorded call did.
+	//
+	// Calls are matched to the records of the same operation, display and VCP code in recorded order, so a session
+	// which makes the same calls replays the same results and timings, also when the calls of several displays
+	// interleave differently. The values of writes are not compared. Once the records of a call are used up the last
+	// one is repeated; a call which was never recorded fails. Both count as unmatched.
+	class ReplayMonitorBackend final : public MonitorBackend
+	{
+	public:
+		ReplayMonitorBackend(std::vector<MonitorTraceRecord> records, Clock& clock);
+
+		[[nodiscard]] const std::vector<MonitorTraceRecord>& records() const { return records_; }
+
+		[[nodiscard]] std::size_t unmatched_count() const;
+
+		MonitorStatus EnumerateDisplays(std::vector<DisplayInfo>& displays) override;
+
+		DisplayHandle GetPrimaryDisplay() override;
+
+		MonitorStatus GetScreenBrightness(DisplayHandle display, long& minimum_screen_brightness, long& screen_brightness, long& maximum_screen_brightness) override;
+
+		MonitorStatus SetScreenBrightness(DisplayHandle display, long screen_brightness) override;
+
+		MonitorStatus GetVcpFeature(DisplayHandle display, VcpCode code, unsigned long& current_value, unsigned long& maximum_value) override;
+
+		MonitorStatus SetVcpFeature(DisplayHandle display, VcpCode code, unsigned long value) override;
+
+		MonitorStatus GetCapabilitiesString(DisplayHandle display, std::string& capabilities) override;
+
+		MonitorStatus GetEdid(DisplayHandle display, std::vector<std::uint8_t>& edid) override;
+
+	private:
+		struct Key
+		{
+			MonitorTraceCall call;
+
+			DisplayHandle display;
+
+			VcpCode code;
+
+			bool operator<(const Key& other) const;
+		};
+
+		// indices of the records of one key, in recorded order
+		struct Queue
+		{
+			std::vector<std::size_t> records;
+
+			std::size_t next = 0;
+		};
+
+		const std::vector<MonitorTraceRecord> records_;
+
+		Clock& clock_;
+
+		mutable std::mutex mutex_;
+
+		std::map<Key, Queue> queues_;
+
+		std::size_t unmatched_count_ = 0;
+
+		// Takes the next record of the call and waits out its duration. nullptr for a call never recorded.
+		const MonitorTraceRecord* Replay(MonitorTraceCall call, DisplayHandle display, VcpCode code);
+	};
+}
+
+#endif
@@ -0,0 +1,96 @@
+#ifndef FLUTTER_PLUGIN_SCREEN_BRIGHTNESS_WINDOWS_PLUGIN_OPERATION_CONTEXT_H
+#define FLUTTER_PLUGIN_SCREEN_BRIGHTNESS_WINDOWS_PLUGIN_OPERATION_CONTEXT_H
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+
+#include "clock.h"
+#include "monitor_backend.h"
+
+namespace screen_brightness
+{
+	// The deadline and cancellation of one caller's operation, e.g. a method call. While a Scope installs it on a
+	// thread, the DdcScheduler commands the thread waits for stop waiting at the deadline or on cancellation: a command
+	// still queued is dropped, so the hardware never sees it, and the operation fails with MonitorStatus::kTimedOut or
+	// kCancelled. Deadlines are of real time, std::chrono::steady_clock, as they bound real waits.
+	class OperationContext final
+	{
+	public:
+		// Installs the context on the calling thread for its lifetime.
+		class Scope final
+		{
+		public:
+			explicit Scope(OperationContext& context);
+
+			Scope(const Scope&) = delete;
+
+			Scope& operator=(const Scope&) = delete;
+
+			~Scope();
+
+		private:
+			OperationContext* previous_;
+		};
+
+		static constexpr Clock::time_point kNoDeadline = Clock::time_point::max();
+
+		OperationContext(std::int64_t id, Clock::time_point deadline);
+
+		OperationContext(const OperationContext&) = delete;
+
+		OperationContext& operator=(const OperationContext&) = delete;
+
+		// The context installed on the calling thread, or null.
+		[[nodiscard]] static OperationContext* Current();
+
+		[[nodiscard]] std::int64_t id() const { return id_; }
+
+		[[nodiscard]] Clock::time_point deadline() const { return deadline_; }
+
+		[[nodiscard]] bool is_cancelled() const { return is_cancelled_.load(std::memory_order_acquire); }
+
+		// Any thread may cancel.
+		void Cancel();
+
+		// kOk while the operation may go on, otherwise kCancelled or kTimedOut.
+		[[nodiscard]] MonitorStatus GetStatus() const;
+
+		// Called once by Cancel, for a waiter to wake up; null to stop.
+		void SetCancelCallback(std::function<void()> callback);
+
+	private:
+		const std::int64_t id_;
+
+		const Clock::time_point deadline_;
+
+		std::atomic<bool> is_cancelled_{ false };
+
+		std::mutex mutex_;
+
+		std::function<void()> cancel_callback_;
+	};
+
+	// The running operations of a process by id, so that another thread can cancel them. Ids are the callers'; every
+	// running operation with the id is cancelled.
+	class OperationRegistry final
+	{
+	public:
+		[[nodiscard]] std::shared_ptr<OperationContext> Begin(std::int64_t id, Clock::time_point deadline);
+
+		void End(const OperationContext& context);
+
+		// Returns false when no running operation has the id.
+		bool Cancel(std::int64_t id);
+
+	private:
+		std::mutex mutex_;
+
+		std::multimap<std::int64_t, std::shared_ptr<OperationContext>> operations_;
+	};
+}
+
+#endif
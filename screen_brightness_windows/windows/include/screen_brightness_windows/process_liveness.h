@@ -0,0 +1,42 @@
+#ifndef FLUTTER_PLUGIN_SCREEN_BRIGHTNESS_WINDOWS_PLUGIN_PROCESS_LIVENESS_H
+#define FLUTTER_PLUGIN_SCREEN_BRIGHTNESS_WINDOWS_PLUGIN_PROCESS_LIVENESS_H
+
+#include <cstdint>
+
+namespace screen_brightness
+{
+	// A process as recorded in shared state which outlives it. The start token is derived from the process's start
+	// time, and on Linux the boot id, so that a process which has been given the id of an exited one is told apart
+	// from it.
+	struct ProcessIdentity
+	{
+		std::uint32_t id = 0;
+
+		// never 0, not even in its low 16 bits, for a process whose start time could be read; 0 when it could not
+		std::uint32_t start_token = 0;
+
+		// Packed into one word, the id in the high half.
+		[[nodiscard]] std::uint64_t ToWord() const { return static_cast<std::uint64_t>(id) << 32 | start_token; }
+
+		[[nodiscard]] static ProcessIdentity FromWord(const std::uint64_t word)
+		{
+			return ProcessIdentity{ static_cast<std::uint32_t>(word >> 32), static_cast<std::uint32_t>(word) };
+		}
+
+		friend bool operator==(const ProcessIdentity& a, const ProcessIdentity& b) { return a.id == b.id && a.start_token == b.start_token; }
+
+		friend bool operator!=(const ProcessIdentity& a, const ProcessIdentity& b) { return !(a == b); }
+	};
+
+	// Id of the calling process.
+	[[nodiscard]] std::uint32_t GetOwnProcessId();
+
+	[[nodiscard]] ProcessIdentity GetOwnProcessIdentity();
+
+	// False only when the process has verifiably exited: no process has its id, or the one which has was started
+	// later. Only the bits of start_token_mask are compared, for records which keep part of the token; a process
+	// whose start time cannot be read, or a record without a token, is taken to be alive as long as the id exists.
+	[[nodiscard]] bool IsProcessAlive(ProcessIdentity process, std::uint32_t start_token_mask = 0xffffffff);
+}
+
+#endif
@@ -0,0 +1,108 @@
+#ifndef FLUTTER_PLUGIN_SCREEN_BRIGHTNESS_WINDOWS_PLUGIN_RESTORE_JOURNAL_H
+#define FLUTTER_PLUGIN_SCREEN_BRIGHTNESS_WINDOWS_PLUGIN_RESTORE_JOURNAL_H
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <string>
+
+#include "display_identity.h"
+#include "monitor_backend.h"
+#include "process_liveness.h"
+
+namespace screen_brightness
+{
+	struct RestoreJournalEntry
+	{
+		DisplayIdentity identity;
+
+		// process id of the process overriding the display, 0 when there is nothing to restore
+		std::uint32_t owner = 0;
+
+		// tells the owner apart from a later process given its id
+		std::uint32_t owner_start_token = 0;
+
+		// the override shown, and the system brightness to restore
+		long value = -1;
+
+		long system_value = -1;
+	};
+
+	// Record of the displays a process overrides, kept in a memory mapped file so that it outlives the process. An
+	// entry is written before an override reaches the display and cleared once the system brightness is back, so an
+	// entry whose owner has exited is an override a crash, a kill or a hung restore has left on the display. Owners are
+	// recorded with their start token, as the file outlives process ids and reboots.
+	//
+	// Updates are plain atomic stores into the mapping and are never flushed: the page cache keeps them when the
+	// process dies, and the operating system writes them back in its own time, so only a power cut within that time
+	// loses an entry. Like the lease table, the file is a fixed array of slots shared by every process of the user, an
+	// all zero file is an empty journal, and values are written under a per-slot sequence counter. Writers of a slot
+	// take turns, and a slot is only taken from a writer which has exited. Once every slot has a display, the slot of
+	// a display with nothing to restore is given to the next one.
+	class RestoreJournal final
+	{
+	public:
+		static constexpr std::size_t kSlotCount = 32;
+
+		using RestoreCallback = std::function<bool(const RestoreJournalEntry& entry)>;
+
+		// A file of the user which survives reboots, as an override does on a monitor keeping its brightness.
+		[[nodiscard]] static std::string GetDefaultPath();
+
+		RestoreJournal() = default;
+
+		RestoreJournal(const RestoreJournal&) = delete;
+
+		RestoreJournal& operator=(const RestoreJournal&) = delete;
+
+		~RestoreJournal();
+
+		// Maps the file, creating it if needed. Entries are recorded as owned by process.
+		[[nodiscard]] MonitorStatus Open(const std::string& path, ProcessIdentity process = GetOwnProcessIdentity());
+
+		void Close();
+
+		[[nodiscard]] bool is_open() const { return journal_ != nullptr; }
+
+		[[nodiscard]] std::uint32_t process_id() const { return process_.id; }
+
+		// Makes this process the owner of the display's entry. Called for every override write, so it neither
+		// allocates nor blocks. Returns false if the journal is closed or full, or another live process has been
+		// writing the entry for longer than a write takes.
+		bool Record(DisplayIdentity identity, long value, long system_value);
+
+		// Forgets the entry once the system brightness is restored, unless another process has recorded an override
+		// since.
+		void Clear(DisplayIdentity identity);
+
+		// Returns false for a display which has never been recorded.
+		[[nodiscard]] bool Read(DisplayIdentity identity, RestoreJournalEntry& entry) const;
+
+		// Calls restore for each entry left by a process which has exited, and clears the entries it returns true
+		// for. Entries are claimed while being restored, so processes recovering at the same time do not restore a
+		// display twice. Returns the number of entries cleared.
+		size_t Recover(const RestoreCallback& restore);
+
+	private:
+		struct Journal;
+
+		struct Slot;
+
+		Journal* journal_ = nullptr;
+
+		ProcessIdentity process_;
+
+#ifdef _WIN32
+		void* mapping_ = nullptr;
+#endif
+
+		[[nodiscard]] Slot* FindSlot(DisplayIdentity identity, bool is_claiming) const;
+
+		// Gives a slot whose display has nothing to restore to the key, once every slot has a display.
+		[[nodiscard]] Slot* ReclaimSlot(std::uint64_t key) const;
+
+		[[nodiscard]] static bool ReadSlot(const Slot& slot, RestoreJournalEntry& entry);
+	};
+}
+
+#endif
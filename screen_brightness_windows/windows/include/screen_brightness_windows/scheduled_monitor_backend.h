@@ -0,0 +1,73 @@
+#ifndef FLUTTER_PLUGIN_SCREEN_BRIGHTNESS_WINDOWS_PLUGIN_SCHEDULED_MONITOR_BACKEND_H
+#define FLUTTER_PLUGIN_SCREEN_BRIGHTNESS_WINDOWS_PLUGIN_SCHEDULED_MONITOR_BACKEND_H
+
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+
+#include "clock.h"
+#include "ddc_scheduler.h"
+#include "monitor_backend.h"
+
+namespace screen_brightness
+{
+	// Routes the brightness operations of another backend through one DdcScheduler per display bus. Operations called
+	// through the MonitorBackend interface run at user priority and wait for their turn; lower priority work is
+	// submitted to GetScheduler directly.
+	class ScheduledMonitorBackend final : public MonitorBackend
+	{
+	public:
+		// With is_threaded, every bus runs its commands on its own worker thread.
+		ScheduledMonitorBackend(MonitorBackend& backend, Clock& clock, Clock::duration minimum_command_interval, bool is_threaded);
+
+		[[nodiscard]] MonitorBackend& backend() { return backend_; }
+
+		[[nodiscard]] Clock& clock() { return clock_; }
+
+		[[nodiscard]] bool is_threaded() const { return is_threaded_; }
+
+		DdcScheduler& GetScheduler(DisplayHandle display);
+
+		// Withdraws a command submitted to the display's scheduler, see DdcScheduler::Withdraw. Returns false as well once
+		// the scheduler has been removed, which runs its queue.
+		bool Withdraw(DisplayHandle display, std::uint64_t sequence);
+
+		// Finishes the queued commands of a display which is gone and drops its scheduler.
+		void RemoveScheduler(DisplayHandle display);
+
+		// Finishes the queued commands of every display and drops the schedulers, waiting for their worker threads.
+		void RemoveSchedulers();
+
+		MonitorStatus EnumerateDisplays(std::vector<DisplayInfo>& displays) override;
+
+		DisplayHandle GetPrimaryDisplay() override;
+
+		MonitorStatus GetScreenBrightness(DisplayHandle display, long& minimum_screen_brightness, long& screen_brightness, long& maximum_screen_brightness) override;
+
+		MonitorStatus SetScreenBrightness(DisplayHandle display, long screen_brightness) override;
+
+		MonitorStatus GetVcpFeature(DisplayHandle display, VcpCode code, unsigned long& current_value, unsigned long& maximum_value) override;
+
+		MonitorStatus SetVcpFeature(DisplayHandle display, VcpCode code, unsigned long value) override;
+
+		MonitorStatus GetCapabilitiesString(DisplayHandle display, std::string& capabilities) override;
+
+		MonitorStatus GetEdid(DisplayHandle display, std::vector<std::uint8_t>& edid) override;
+
+	private:
+		MonitorBackend& backend_;
+
+		Clock& clock_;
+
+		const Clock::duration minimum_command_interval_;
+
+		const bool is_threaded_;
+
+		std::mutex mutex_;
+
+		std::map<DisplayHandle, std::unique_ptr<DdcScheduler>> schedulers_;
+	};
+}
+
+#endif
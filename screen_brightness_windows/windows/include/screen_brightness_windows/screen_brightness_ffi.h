@@ -0,0 +1,179 @@
+#ifndef FLUTTER_PLUGIN_SCREEN_BRIGHTNESS_WINDOWS_PLUGIN_FFI_H_
+#define FLUTTER_PLUGIN_SCREEN_BRIGHTNESS_WINDOWS_PLUGIN_FFI_H_
+
+/*
+ * C ABI of the plugin for dart:ffi, next to the method channel, for callers which cannot afford a platform channel
+ * round trip, e.g. reading the brightness every frame. The functions may be called from any thread and act on the
+ * first engine's plugin which is still registered; without one they return SCREEN_BRIGHTNESS_FFI_UNAVAILABLE.
+ *
+ * Callbacks are called on the platform thread, or on the calling thread for a write replaced by a newer one. From
+ * Dart, pass the native function of a NativeCallable.listener, which forwards the call to the isolate's event loop
+ * like a send port does. Brightness values are 0.0 to 1.0; statuses are SCREEN_BRIGHTNESS_FFI_OK or a failure which
+ * ScreenBrightnessFfiGetStatusMessage describes.
+ *
+ * Experimental: there are no Dart bindings for it in screen_brightness yet, and it may change in a minor version.
+ */
+
+#include <stdint.h>
+
+#if defined(_WIN32)
+#ifdef SCREEN_BRIGHTNESS_FFI_IMPL
+#define SCREEN_BRIGHTNESS_FFI_EXPORT __declspec(dllexport)
+#else
+#define SCREEN_BRIGHTNESS_FFI_EXPORT __declspec(dllimport)
+#endif
+#else
+#define SCREEN_BRIGHTNESS_FFI_EXPORT __attribute__((visibility("default")))
+#endif
+
+#if defined(__cplusplus)
+extern "C" {
+#endif
+
+	/* Incremented on every incompatible change of this ABI. */
+#define SCREEN_BRIGHTNESS_FFI_VERSION 1
+
+#define SCREEN_BRIGHTNESS_FFI_OK 0
+
+	/* No engine has registered the plugin. */
+#define SCREEN_BRIGHTNESS_FFI_UNAVAILABLE (-1)
+
+	/* A frame without pixels, with a stride shorter than its rows or of an unknown format. */
+#define SCREEN_BRIGHTNESS_FFI_INVALID_FRAME (-2)
+
+	/* A write replaced by a newer one before it was applied. */
+#define SCREEN_BRIGHTNESS_FFI_PREEMPTED 7
+
+	/* A write whose deadline passed before the monitor took it. */
+#define SCREEN_BRIGHTNESS_FFI_TIMED_OUT 16
+
+	/* A write cancelled with ScreenBrightnessFfiCancel. */
+#define SCREEN_BRIGHTNESS_FFI_CANCELLED 18
+
+	/* Number of displays the state table has room for. */
+#define SCREEN_BRIGHTNESS_FFI_STATE_TABLE_SLOT_COUNT 16
+
+	/* Brightness state of one display, in the display's range; -1 while not known. A slot whose display is 0 is free. */
+	typedef struct
+	{
+		/* odd while the slot is being written */
+		uint64_t sequence;
+
+		uint64_t display;
+
+		/* last value written, and the value the display should show */
+		int64_t current;
+
+		int64_t target;
+
+		int64_t minimum;
+
+		int64_t maximum;
+
+		int64_t system;
+
+		/* process id of the process whose override is shown, 0 for the system brightness */
+		uint64_t owner;
+	} ScreenBrightnessFfiDisplayState;
+
+	/* Published by the plugin on every change, for readers which poll without a call: read a slot's sequence, then its
+	 * values, then the sequence again, and retry unless both reads return the same even value. generation changes
+	 * after every change of any slot. */
+	typedef struct
+	{
+		uint32_t layout_version;
+
+		uint32_t slot_count;
+
+		uint64_t generation;
+
+		ScreenBrightnessFfiDisplayState slots[SCREEN_BRIGHTNESS_FFI_STATE_TABLE_SLOT_COUNT];
+	} ScreenBrightnessFfiStateTable;
+
+	/* Byte order of the 4 bytes of a pixel; alpha is ignored. */
+#define SCREEN_BRIGHTNESS_FFI_PIXEL_FORMAT_RGBA8 0
+
+#define SCREEN_BRIGHTNESS_FFI_PIXEL_FORMAT_BGRA8 1
+
+	/* Content adaptive dimming lowers the application brightness from maximum_brightness, while the mean luma of the
+	 * submitted frames is up to knee, to minimum_brightness, from maximum_luma on. Luma and brightness are 0.0 to 1.0. */
+	typedef struct
+	{
+		double maximum_brightness;
+
+		double minimum_brightness;
+
+		double knee;
+
+		double maximum_luma;
+
+		/* time for the brightness to cover 63% of a change of the content */
+		double time_constant_ms;
+
+		/* smallest change of the brightness which is written */
+		double deadband;
+
+		/* 1 to analyse every row of a frame, 2 for every other row, and so on */
+		uint32_t row_step;
+	} ScreenBrightnessFfiContentAdaptiveDimmingConfig;
+
+	typedef void (*ScreenBrightnessFfiCompletionCallback)(int64_t request_id, int32_t status, void* user_data);
+
+	typedef void (*ScreenBrightnessFfiBrightnessCallback)(double brightness, void* user_data);
+
+	SCREEN_BRIGHTNESS_FFI_EXPORT int32_t ScreenBrightnessFfiGetVersion(void);
+
+	SCREEN_BRIGHTNESS_FFI_EXPORT const char* ScreenBrightnessFfiGetStatusMessage(int32_t status);
+
+	/* The application brightness as last applied or reported, without asking the monitor; -1 while not known or
+	 * without an engine. Safe as a leaf call. */
+	SCREEN_BRIGHTNESS_FFI_EXPORT double ScreenBrightnessFfiGetCachedBrightness(void);
+
+	/* Queues an application brightness write and returns its request id, which is passed to the callback with the
+	 * outcome, or SCREEN_BRIGHTNESS_FFI_UNAVAILABLE without calling it. Only the latest queued write is applied. */
+	SCREEN_BRIGHTNESS_FFI_EXPORT int64_t ScreenBrightnessFfiSetBrightnessAsync(double brightness,
+		ScreenBrightnessFfiCompletionCallback callback, void* user_data);
+
+	/* As ScreenBrightnessFfiSetBrightnessAsync, except that the write completes with SCREEN_BRIGHTNESS_FFI_TIMED_OUT
+	 * when it has not been applied within timeout_ms, e.g. because the monitor hangs. A write the monitor has started
+	 * then still finishes in the background. */
+	SCREEN_BRIGHTNESS_FFI_EXPORT int64_t ScreenBrightnessFfiSetBrightnessWithTimeoutAsync(double brightness, int64_t timeout_ms,
+		ScreenBrightnessFfiCompletionCallback callback, void* user_data);
+
+	/* Cancels a write: a queued one completes with SCREEN_BRIGHTNESS_FFI_CANCELLED on the calling thread, and one
+	 * waiting for the monitor completes with it on the platform thread. Returns 1 if the write had not completed, 0 if
+	 * it had, or SCREEN_BRIGHTNESS_FFI_UNAVAILABLE. */
+	SCREEN_BRIGHTNESS_FFI_EXPORT int32_t ScreenBrightnessFfiCancel(int64_t request_id);
+
+	/* Calls the callback with every change of the application brightness until unsubscribed. Returns the subscription
+	 * id, or SCREEN_BRIGHTNESS_FFI_UNAVAILABLE. The callback is never called once ScreenBrightnessFfiUnsubscribe has
+	 * returned; it must not subscribe or unsubscribe itself. Subscriptions end with the engine. */
+	SCREEN_BRIGHTNESS_FFI_EXPORT int64_t ScreenBrightnessFfiSubscribe(ScreenBrightnessFfiBrightnessCallback callback, void* user_data);
+
+	SCREEN_BRIGHTNESS_FFI_EXPORT void ScreenBrightnessFfiUnsubscribe(int64_t subscription_id);
+
+	/* The state table of the process, valid until the engine is destroyed, or null without an engine. */
+	SCREEN_BRIGHTNESS_FFI_EXPORT const ScreenBrightnessFfiStateTable* ScreenBrightnessFfiGetStateTable(void);
+
+	/* Copies a consistent snapshot of the slot, with its sequence even. Returns SCREEN_BRIGHTNESS_FFI_UNAVAILABLE for
+	 * a free slot, an index out of range or without an engine. Takes no lock. */
+	SCREEN_BRIGHTNESS_FFI_EXPORT int32_t ScreenBrightnessFfiReadDisplayState(uint32_t slot_index, ScreenBrightnessFfiDisplayState* state);
+
+	/* Replaces the configuration of content adaptive dimming. Returns SCREEN_BRIGHTNESS_FFI_UNAVAILABLE without an
+	 * engine or configuration. */
+	SCREEN_BRIGHTNESS_FFI_EXPORT int32_t ScreenBrightnessFfiConfigureContentAdaptiveDimming(
+		const ScreenBrightnessFfiContentAdaptiveDimmingConfig* config);
+
+	/* Analyses a frame shown at timestamp_us, of any monotonic clock, on the calling thread without copying it, and
+	 * queues a write of the dimmed brightness as ScreenBrightnessFfiSetBrightnessAsync does. The pixels are only read
+	 * during the call, so the address of a Uint8List may be passed in a leaf call. Returns the request id of the write,
+	 * 0 while the brightness stays within the deadband, SCREEN_BRIGHTNESS_FFI_INVALID_FRAME or
+	 * SCREEN_BRIGHTNESS_FFI_UNAVAILABLE; the callback is only called for a write. */
+	SCREEN_BRIGHTNESS_FFI_EXPORT int64_t ScreenBrightnessFfiSubmitFrame(const uint8_t* pixels, uint32_t width, uint32_t height,
+		uint32_t stride, int32_t pixel_format, int64_t timestamp_us, ScreenBrightnessFfiCompletionCallback callback, void* user_data);
+
+#if defined(__cplusplus)
+}  // extern "C"
+#endif
+
+#endif  // FLUTTER_PLUGIN_SCREEN_BRIGHTNESS_WINDOWS_PLUGIN_FFI_H_
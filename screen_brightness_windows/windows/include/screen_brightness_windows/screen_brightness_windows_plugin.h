@@ -10,18 +10,36 @@
 #include <flutter/plugin_registrar_windows.h>
 #include <flutter/standard_method_codec.h>
 
+#include <algorithm>
+#include <cmath>
+#include <iostream>
 #include <map>
 #include <memory>
 #include <sstream>
-#include <highlevelmonitorconfigurationapi.h>
 
+#include "brightness_bridge.h"
+#include "brightness_service.h"
+#include "display_topology_changed_stream_handler.h"
+#include "dxva2_monitor_backend.h"
+#include "idle_dimmer.h"
+#include "last_input_info_activity_source.h"
+#include "operation_context.h"
 #include "screen_brightness_changed_stream_handler.h"
+#include "stall_detector.h"
+#include "stall_warning_stream_handler.h"
 
 namespace screen_brightness
 {
 	class ScreenBrightnessWindowsPlugin final : public flutter::Plugin
 	{
 	public:
+		// How long closing the window may wait for the displays to be restored. Monitors answer a DDC/CI write in
+		// 30 to 200 ms, a hung one never.
+		static constexpr Clock::duration kCloseRestoreTimeout = std::chrono::milliseconds(500);
+
+		// Of the timer on the top-level window which polls idle_dimmer_.
+		static constexpr UINT_PTR kIdleDimmingTimerId = 0x53424944;
+
 		static void RegisterWithRegistrar(flutter::PluginRegistrarWindows* registrar);
 
 		ScreenBrightnessWindowsPlugin(flutter::PluginRegistrarWindows* registrar);
@@ -39,39 +57,54 @@ namespace screen_brightness
 
 		ScreenBrightnessChangedStreamHandler* application_screen_brightness_changed_stream_handler_ = nullptr;
 
-		long minimum_screen_brightness_ = -1;
+		DisplayTopologyChangedStreamHandler* display_topology_changed_stream_handler_ = nullptr;
+
+		StallWarningStreamHandler* stall_warning_stream_handler_ = nullptr;
 
-		long maximum_screen_brightness_ = -1;
+		// shared with the plugins of the other engines in the process
+		BrightnessClient client_;
 
-		long system_screen_brightness_ = -1;
+		// posted to the top-level window when the C ABI has queued a write for client_
+		UINT bridge_message_ = 0;
 
-		long application_screen_brightness_ = -1;
+		// the C ABI's access to client_
+		std::shared_ptr<BrightnessBridge> bridge_;
 
-		bool is_auto_reset_ = true;
+		// times the method calls and window messages, which run on the thread rendering the UI
+		StallDetector stall_detector_;
 
-		bool is_animate_ = true;
+		LastInputInfoActivitySource input_activity_source_;
 
-		// Called when a method is called on this plugin's channel from Dart.
+		// polled from a timer, so that input costs nothing
+		IdleDimmer idle_dimmer_;
+
+		// Called when a method is called on this plugin's channel from Dart. A call with an operationId or a deadlineMs
+		// runs under an OperationContext, and fails with "-12" once timed out or "-13" once cancelled. Such a call of
+		// setApplicationScreenBrightness is queued with bridge_ and replied to once the monitor has the write, so that a
+		// cancel method call can reach it; any other runs to completion on the platform thread, and only another thread
+		// can cancel it, through ScreenBrightnessFfiCancel.
 		void HandleMethodCall(const flutter::MethodCall<flutter::EncodableValue>& method_call,
 			std::unique_ptr<flutter::MethodResult<flutter::EncodableValue>> result);
 
+		void DispatchMethodCall(const flutter::MethodCall<flutter::EncodableValue>& method_call,
+			std::unique_ptr<flutter::MethodResult<flutter::EncodableValue>> result);
+
 		void HandleGetSystemScreenBrightnessMethodCall(std::unique_ptr<flutter::MethodResult<flutter::EncodableValue>> result) const;
 
 		void HandleSetSystemScreenBrightnessMethodCall(
 			const flutter::MethodCall<flutter::EncodableValue>& call,
 			std::unique_ptr<flutter::MethodResult<flutter::EncodableValue>> result);
 
-		void HandleSystemScreenBrightnessChanged(long brightness);
-
 		void HandleGetApplicationScreenBrightnessMethodCall(std::unique_ptr<flutter::MethodResult<flutter::EncodableValue>> result);
 
 		void HandleSetApplicationScreenBrightnessMethodCall(
 			const flutter::MethodCall<flutter::EncodableValue>& call,
 			std::unique_ptr<flutter::MethodResult<flutter::EncodableValue>> result);
 
-		void HandleResetApplicationScreenBrightnessMethodCall(std::unique_ptr<flutter::MethodResult<flutter::EncodableValue>> result);
+		void QueueSetApplicationScreenBrightnessMethodCall(const flutter::MethodCall<flutter::EncodableValue>& call, std::int64_t operation_id,
+			Clock::time_point deadline, std::unique_ptr<flutter::MethodResult<flutter::EncodableValue>> result);
 
-		void HandleApplicationScreenBrightnessChanged(long brightness);
+		void HandleResetApplicationScreenBrightnessMethodCall(std::unique_ptr<flutter::MethodResult<flutter::EncodableValue>> result);
 
 		void HandleHasApplicationScreenBrightnessChangedMethodCall(std::unique_ptr<flutter::MethodResult<flutter::EncodableValue>> result) const;
 
@@ -87,19 +120,43 @@ namespace screen_brightness
 
 		void HandleCanChangeSystemBrightnessMethodCall(std::unique_ptr<flutter::MethodResult<flutter::EncodableValue>> result);
 
-		std::optional<LRESULT> HandleWindowProc(HWND hWnd, UINT message, WPARAM wParam, LPARAM lParam);
+		void HandleGetVcpFeatureMethodCall(const flutter::MethodCall<flutter::EncodableValue>& call,
+			std::unique_ptr<flutter::MethodResult<flutter::EncodableValue>> result);
+
+		void HandleSetVcpFeatureMethodCall(const flutter::MethodCall<flutter::EncodableValue>& call,
+			std::unique_ptr<flutter::MethodResult<flutter::EncodableValue>> result);
+
+		void HandleGetCapabilitiesStringMethodCall(std::unique_ptr<flutter::MethodResult<flutter::EncodableValue>> result);
+
+		void HandleGetSupportedVcpFeaturesMethodCall(std::unique_ptr<flutter::MethodResult<flutter::EncodableValue>> result);
+
+		void HandleGetDiagnosticsMethodCall(std::unique_ptr<flutter::MethodResult<flutter::EncodableValue>> result);
+
+		void HandleSetStallBudgetMethodCall(const flutter::MethodCall<flutter::EncodableValue>& call,
+			std::unique_ptr<flutter::MethodResult<flutter::EncodableValue>> result);
 
-		void GetScreenBrightness(long& minimum_screen_brightness, long& screen_brightness, long& maximum_screen_brightness);
+		void HandleSetIdleDimmingMethodCall(const flutter::MethodCall<flutter::EncodableValue>& call,
+			std::unique_ptr<flutter::MethodResult<flutter::EncodableValue>> result);
+
+		void HandleCancelMethodCall(const flutter::MethodCall<flutter::EncodableValue>& call,
+			std::unique_ptr<flutter::MethodResult<flutter::EncodableValue>> result);
 
-		void SetScreenBrightness(long screen_brightness);
+		void HandleStall(const StallRecord& stall);
+
+		// Polls the idle dimmer and sets the timer to when it wants to be polled again.
+		void PollIdleDimmer();
+
+		std::optional<LRESULT> HandleWindowProc(HWND hWnd, UINT message, WPARAM wParam, LPARAM lParam);
 
-		[[nodiscard]] double GetScreenBrightnessPercentage(long screen_brightness) const;
+		// Migrates the application brightness when the window has moved to another monitor.
+		void UpdateDisplay();
 
-		[[nodiscard]] long GetScreenBrightnessValueByPercentage(double percentage) const;
+		void UpdateDisplayTopology();
 
-		void OnApplicationPause();
+		// Restores the displays in parallel within kCloseRestoreTimeout, logging those which did not complete.
+		void RestoreOnClose();
 
-		void OnApplicationResume();
+		[[nodiscard]] static std::shared_ptr<BrightnessService> AcquireBrightnessService();
 	};
 }
 
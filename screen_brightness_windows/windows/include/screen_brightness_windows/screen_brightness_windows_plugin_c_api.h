@@ -3,6 +3,8 @@
 
 #include <flutter_plugin_registrar.h>
 
+#include "screen_brightness_ffi.h"
+
 #ifdef FLUTTER_PLUGIN_IMPL
 #define FLUTTER_PLUGIN_EXPORT __declspec(dllexport)
 #else
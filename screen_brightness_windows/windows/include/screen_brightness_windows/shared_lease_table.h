@@ -0,0 +1,117 @@
+#ifndef FLUTTER_PLUGIN_SCREEN_BRIGHTNESS_WINDOWS_PLUGIN_SHARED_LEASE_TABLE_H
+#define FLUTTER_PLUGIN_SCREEN_BRIGHTNESS_WINDOWS_PLUGIN_SHARED_LEASE_TABLE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+#include "display_identity.h"
+#include "monitor_backend.h"
+#include "process_liveness.h"
+
+namespace screen_brightness
+{
+	struct SharedLeaseEntry
+	{
+		// process id of the lease holder, 0 when nobody holds the lease
+		std::uint32_t owner = 0;
+
+		// false when the holder has exited without releasing the lease, or the process id now belongs to another
+		// process
+		bool is_owner_alive = false;
+
+		// last brightness the holder applied, and the system brightness it will restore
+		long value = -1;
+
+		long system_value = -1;
+
+		// number of values published for the display, 0 before the first
+		std::uint64_t generation = 0;
+	};
+
+	// Brightness ownership of the displays, shared by every process using the plugin, so that applications do not
+	// restore the system brightness over each other's overrides.
+	//
+	// A process takes a display's lease before writing its brightness and publishes the value it applied. Restoring
+	// the brightness is only done while still holding the lease, and other processes read the published value instead
+	// of the hardware. A lease is held until released or until its holder exits. Holders are recorded with their start
+	// token, so a process which has been given an exited holder's id does not hold its leases.
+	//
+	// The table is a fixed array of slots in a named shared memory segment (shm_open on Linux, a page file backed
+	// mapping on Windows). An all zero segment is an empty table, so whichever process creates it needs no set up.
+	// Slots are claimed and leases changed by compare and swap, and values are published under a per-slot sequence
+	// counter which readers retry on. Once every slot has a display, the slot of a display whose lease is free or whose
+	// holder has exited is given to the next display; only that takes a lock, which a process that dies holding it
+	// leaves to the next.
+	class SharedLeaseTable final
+	{
+	public:
+		static constexpr std::size_t kSlotCount = 32;
+
+		static constexpr const char* kDefaultName = "screen_brightness_leases";
+
+		SharedLeaseTable() = default;
+
+		SharedLeaseTable(const SharedLeaseTable&) = delete;
+
+		SharedLeaseTable& operator=(const SharedLeaseTable&) = delete;
+
+		~SharedLeaseTable();
+
+		// Opens the segment with the name, creating it if no process has. Leases are held as process.
+		[[nodiscard]] MonitorStatus Open(const std::string& name, ProcessIdentity process = GetOwnProcessIdentity());
+
+		void Close();
+
+		[[nodiscard]] bool is_open() const { return segment_ != nullptr; }
+
+		// Deletes the name, so that the next Open creates a new segment; processes which have it open keep using the
+		// old one. Windows deletes a segment with its last handle, so this does nothing there.
+		static void Remove(const std::string& name);
+
+		// The owner recorded for this process's leases.
+		[[nodiscard]] std::uint32_t process_id() const { return process_.id; }
+
+		// Takes the lease, from another process too: the write of a user is never held back. Returns false if the
+		// table is closed or full, or a live holder has been publishing for longer than a publish takes.
+		bool Acquire(DisplayIdentity identity);
+
+		// Takes the lease only if nobody holds it or its holder has exited.
+		bool TryAcquire(DisplayIdentity identity);
+
+		void Release(DisplayIdentity identity);
+
+		[[nodiscard]] bool IsHeld(DisplayIdentity identity) const;
+
+		// Returns false, publishing nothing, without the lease. A value left half published by a holder which has
+		// exited is overwritten.
+		bool Publish(DisplayIdentity identity, long value, long system_value);
+
+		// Returns false for a display which has never had a lease.
+		[[nodiscard]] bool Read(DisplayIdentity identity, SharedLeaseEntry& entry) const;
+
+	private:
+		struct Segment;
+
+		struct Slot;
+
+		Segment* segment_ = nullptr;
+
+		ProcessIdentity process_;
+
+#ifdef _WIN32
+		void* mapping_ = nullptr;
+#endif
+
+		[[nodiscard]] Slot* FindSlot(DisplayIdentity identity, bool is_claiming) const;
+
+		// Gives the slot of a display nobody holds to the display with the key, with the lease held by this process.
+		[[nodiscard]] Slot* ReclaimSlot(std::uint64_t key) const;
+
+		[[nodiscard]] bool IsOwnLease(std::uint64_t lease) const;
+
+		[[nodiscard]] bool IsOwnerAlive(std::uint64_t lease) const;
+	};
+}
+
+#endif
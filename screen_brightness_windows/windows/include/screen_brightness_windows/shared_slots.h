@@ -0,0 +1,104 @@
+#ifndef FLUTTER_PLUGIN_SCREEN_BRIGHTNESS_WINDOWS_PLUGIN_SHARED_SLOTS_H
+#define FLUTTER_PLUGIN_SCREEN_BRIGHTNESS_WINDOWS_PLUGIN_SHARED_SLOTS_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <thread>
+
+#include "display_identity.h"
+#include "process_liveness.h"
+
+// Internal to the tables processes share through a mapping, SharedLeaseTable and RestoreJournal: a fixed array of
+// slots keyed by display identity, each with an atomic key, 0 while free, and values written under a sequence counter
+// which is odd while they change.
+namespace screen_brightness
+{
+	// a process only holds a slot for a few stores, so waiting longer than this many yields for it gives up
+	constexpr int kSharedSlotAttemptCount = 1000;
+
+	inline std::uint64_t GetSharedSlotKey(const DisplayIdentity identity)
+	{
+		// 0 marks a free slot
+		return identity.value == 0 ? 1 : identity.value;
+	}
+
+	// Open addressing from the key. A probe stops at the first free slot, which is claimed for the key when
+	// is_claiming, so a slot's key never goes back to 0. Returns nullptr if the key has no slot, or every slot has
+	// another key.
+	template <typename Slot, std::size_t kSlotCount>
+	Slot* FindSharedSlot(Slot (&slots)[kSlotCount], const std::uint64_t key, const bool is_claiming)
+	{
+		for (std::size_t probe = 0; probe < kSlotCount; ++probe)
+		{
+			Slot& slot = slots[(key + probe) % kSlotCount];
+			std::uint64_t slot_key = slot.key.load(std::memory_order_acquire);
+			if (slot_key == 0 && is_claiming)
+			{
+				// on failure slot_key is the key another process has just claimed the slot for
+				slot.key.compare_exchange_strong(slot_key, key, std::memory_order_acq_rel);
+				if (slot_key == 0)
+				{
+					return &slot;
+				}
+			}
+
+			if (slot_key == key)
+			{
+				return &slot;
+			}
+
+			if (slot_key == 0)
+			{
+				return nullptr;
+			}
+		}
+
+		return nullptr;
+	}
+
+	// Takes a lock word holding the identity word of its holder, 0 when free, from a holder which has exited too.
+	// Returns false when a live holder keeps it for too long, e.g. one which is stopped.
+	inline bool LockSharedWord(std::atomic<std::uint64_t>& lock, const std::uint64_t own_word)
+	{
+		std::uint64_t holder = lock.load(std::memory_order_relaxed);
+		for (int attempt = 0;;)
+		{
+			if (holder != 0 && IsProcessAlive(ProcessIdentity::FromWord(holder)))
+			{
+				if (++attempt >= kSharedSlotAttemptCount)
+				{
+					return false;
+				}
+
+				std::this_thread::yield();
+				holder = lock.load(std::memory_order_relaxed);
+				continue;
+			}
+
+			if (lock.compare_exchange_weak(holder, own_word, std::memory_order_acquire, std::memory_order_relaxed))
+			{
+				return true;
+			}
+		}
+	}
+
+	// Runs write with the slot's sequence odd, for readers to retry on. The caller must be the slot's only writer; a
+	// sequence left odd by one which died half way through is taken up where it left off.
+	template <typename Slot, typename Write>
+	void WriteSharedSlot(Slot& slot, Write write)
+	{
+		std::uint64_t sequence = slot.sequence.load(std::memory_order_relaxed);
+		if ((sequence & 1) != 0)
+		{
+			--sequence;
+		}
+
+		slot.sequence.store(sequence + 1, std::memory_order_relaxed);
+		std::atomic_thread_fence(std::memory_order_release);
+		write(slot);
+		slot.sequence.store(sequence + 2, std::memory_order_release);
+	}
+}
+
+#endif
@@ -0,0 +1,57 @@
+#ifndef FLUTTER_PLUGIN_SCREEN_BRIGHTNESS_WINDOWS_PLUGIN_SMALL_BUFFER_H
+#define FLUTTER_PLUGIN_SCREEN_BRIGHTNESS_WINDOWS_PLUGIN_SMALL_BUFFER_H
+
+#include <cstddef>
+#include <memory>
+#include <new>
+#include <type_traits>
+
+namespace screen_brightness
+{
+	// Buffer of trivial elements which keeps up to N elements inline and only goes to the heap beyond that.
+	template <typename T, std::size_t N>
+	class SmallBuffer final
+	{
+		static_assert(std::is_trivial_v<T>, "SmallBuffer only holds trivial types");
+
+	public:
+		SmallBuffer() = default;
+
+		SmallBuffer(const SmallBuffer&) = delete;
+
+		SmallBuffer& operator=(const SmallBuffer&) = delete;
+
+		// Makes room for size elements, discarding the previous content. Returns nullptr if the heap allocation fails.
+		T* Resize(const std::size_t size)
+		{
+			heap_.reset();
+			size_ = 0;
+			if (size > N)
+			{
+				heap_.reset(new (std::nothrow) T[size]);
+				if (heap_ == nullptr)
+				{
+					return nullptr;
+				}
+			}
+
+			size_ = size;
+			return data();
+		}
+
+		[[nodiscard]] T* data() { return heap_ != nullptr ? heap_.get() : inline_; }
+
+		[[nodiscard]] std::size_t size() const { return size_; }
+
+		[[nodiscard]] bool is_inline() const { return heap_ == nullptr; }
+
+	private:
+		T inline_[N]{};
+
+		std::unique_ptr<T[]> heap_;
+
+		std::size_t size_ = 0;
+	};
+}
+
+#endif
@@ -0,0 +1,123 @@
+#ifndef FLUTTER_PLUGIN_SCREEN_BRIGHTNESS_WINDOWS_PLUGIN_STALL_DETECTOR_H
+#define FLUTTER_PLUGIN_SCREEN_BRIGHTNESS_WINDOWS_PLUGIN_STALL_DETECTOR_H
+
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <map>
+#include <string>
+#include <string_view>
+
+#include "clock.h"
+#include "monitor_backend.h"
+
+namespace screen_brightness
+{
+	// An operation which held the platform thread for longer than the budget.
+	struct StallRecord
+	{
+		// e.g. the method name, or the window message
+		std::string operation;
+
+		DisplayHandle display = 0;
+
+		// the entry point the operation ran in
+		std::string call_site;
+
+		Clock::duration duration{};
+
+		// when the operation ended
+		Clock::time_point time{};
+	};
+
+	struct StallStatistics
+	{
+		size_t operation_count = 0;
+
+		size_t stall_count = 0;
+
+		Clock::duration longest_duration{};
+	};
+
+	// Measures how long the plugin's entry points hold the platform thread, which also renders the Flutter UI, so
+	// that brightness operations which cost frames can be told apart from other causes. Every measured operation
+	// counts towards the statistics of its display; one over the budget is also recorded and reported.
+	//
+	// Used on the platform thread only.
+	class StallDetector final
+	{
+	public:
+		// A frame at 60 Hz.
+		static constexpr Clock::duration kDefaultBudget = std::chrono::milliseconds(16);
+
+		static constexpr size_t kRecentStallCount = 32;
+
+		using StallCallback = std::function<void(const StallRecord& stall)>;
+
+		// Measures from its creation to its destruction.
+		class Scope final
+		{
+		public:
+			Scope(StallDetector& detector, std::string_view operation, DisplayHandle display, const char* call_site);
+
+			Scope(const Scope&) = delete;
+
+			Scope& operator=(const Scope&) = delete;
+
+			~Scope();
+
+		private:
+			StallDetector& detector_;
+
+			// not copied unless the operation stalls, so measuring does not allocate
+			std::string_view operation_;
+
+			DisplayHandle display_;
+
+			const char* call_site_;
+
+			Clock::time_point start_;
+		};
+
+		explicit StallDetector(Clock& clock, Clock::duration budget = kDefaultBudget);
+
+		StallDetector(const StallDetector&) = delete;
+
+		StallDetector& operator=(const StallDetector&) = delete;
+
+		[[nodiscard]] Clock::duration budget() const { return budget_; }
+
+		void SetBudget(Clock::duration budget) { budget_ = budget; }
+
+		// Called after each stall is recorded.
+		void SetStallCallback(StallCallback callback);
+
+		// The operation must outlive the scope.
+		[[nodiscard]] Scope Measure(std::string_view operation, DisplayHandle display, const char* call_site);
+
+		[[nodiscard]] const StallStatistics& statistics() const { return statistics_; }
+
+		// Statistics of the operations on the display, empty for a display without any.
+		[[nodiscard]] StallStatistics GetStatistics(DisplayHandle display) const;
+
+		// The latest stalls, oldest first.
+		[[nodiscard]] const std::deque<StallRecord>& recent_stalls() const { return recent_stalls_; }
+
+	private:
+		Clock& clock_;
+
+		Clock::duration budget_;
+
+		StallCallback stall_callback_;
+
+		StallStatistics statistics_;
+
+		std::map<DisplayHandle, StallStatistics> display_statistics_;
+
+		std::deque<StallRecord> recent_stalls_;
+
+		void Finish(std::string_view operation, DisplayHandle display, const char* call_site, Clock::time_point start);
+	};
+}
+
+#endif
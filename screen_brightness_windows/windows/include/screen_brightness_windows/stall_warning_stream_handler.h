@@ -0,0 +1,18 @@
+#ifndef FLUTTER_PLUGIN_SCREEN_BRIGHTNESS_WINDOWS_PLUGIN_STALL_WARNING_STREAM_HANDLER_H
+#define FLUTTER_PLUGIN_SCREEN_BRIGHTNESS_WINDOWS_PLUGIN_STALL_WARNING_STREAM_HANDLER_H
+
+#include <string>
+
+#include "base_stream_handler.h"
+#include "stall_detector.h"
+
+namespace screen_brightness
+{
+	class StallWarningStreamHandler final : public BaseStreamHandler<flutter::EncodableValue>
+	{
+	public:
+		void AddStallToEventSink(const StallRecord& stall, const std::string& display_id, Clock::duration budget) const;
+	};
+}
+
+#endif
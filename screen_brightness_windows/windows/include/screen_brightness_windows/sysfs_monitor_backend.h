@@ -0,0 +1,58 @@
+#ifndef FLUTTER_PLUGIN_SCREEN_BRIGHTNESS_WINDOWS_PLUGIN_SYSFS_MONITOR_BACKEND_H
+#define FLUTTER_PLUGIN_SCREEN_BRIGHTNESS_WINDOWS_PLUGIN_SYSFS_MONITOR_BACKEND_H
+
+#include <string>
+#include <vector>
+
+#include "monitor_backend.h"
+
+namespace screen_brightness
+{
+	// Monitor backend over the Linux backlight class (/sys/class/backlight). Display handles are 1-based indices into
+	// the devices found on construction, sorted by name.
+	class SysfsMonitorBackend final : public MonitorBackend
+	{
+	public:
+		explicit SysfsMonitorBackend(std::string root = "/sys/class/backlight");
+
+		MonitorStatus EnumerateDisplays(std::vector<DisplayInfo>& displays) override;
+
+		DisplayHandle GetPrimaryDisplay() override;
+
+		MonitorStatus GetScreenBrightness(DisplayHandle display, long& minimum_screen_brightness, long& screen_brightness, long& maximum_screen_brightness) override;
+
+		MonitorStatus SetScreenBrightness(DisplayHandle display, long screen_brightness) override;
+
+		MonitorStatus GetVcpFeature(DisplayHandle display, VcpCode code, unsigned long& current_value, unsigned long& maximum_value) override;
+
+		MonitorStatus SetVcpFeature(DisplayHandle display, VcpCode code, unsigned long value) override;
+
+		MonitorStatus GetCapabilitiesString(DisplayHandle display, std::string& capabilities) override;
+
+		MonitorStatus GetEdid(DisplayHandle display, std::vector<std::uint8_t>& edid) override;
+
+	private:
+		// Attribute paths are built once so reading and writing brightness does not allocate.
+		struct Device
+		{
+			std::string name;
+
+			std::string brightness_path;
+
+			std::string actual_brightness_path;
+
+			std::string maximum_brightness_path;
+
+			// a backlight driven by the GPU links to its DRM connector, which has the panel EDID
+			std::string edid_path;
+		};
+
+		std::string root_;
+
+		std::vector<Device> devices_;
+
+		[[nodiscard]] const Device* FindDevice(DisplayHandle display) const;
+	};
+}
+
+#endif
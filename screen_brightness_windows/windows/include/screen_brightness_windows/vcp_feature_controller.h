@@ -0,0 +1,71 @@
+#ifndef FLUTTER_PLUGIN_SCREEN_BRIGHTNESS_WINDOWS_PLUGIN_VCP_FEATURE_CONTROLLER_H
+#define FLUTTER_PLUGIN_SCREEN_BRIGHTNESS_WINDOWS_PLUGIN_VCP_FEATURE_CONTROLLER_H
+
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "display_identity.h"
+#include "display_topology.h"
+#include "mccs_capabilities.h"
+#include "monitor_backend.h"
+#include "scheduled_monitor_backend.h"
+
+namespace screen_brightness
+{
+	struct VcpFeatureValue
+	{
+		VcpCode code = 0;
+
+		MonitorStatus status = MonitorStatus::kUnsupported;
+
+		unsigned long current_value = 0;
+
+		unsigned long maximum_value = 0;
+	};
+
+	// Generic VCP feature access (contrast, colour preset, input source, ...) over the same per-bus schedulers as the
+	// brightness path, so other features no longer need their own physical monitor handles competing for the bus.
+	class VcpFeatureController final
+	{
+	public:
+		// Cached data is keyed on the display identity from the topology, so it is kept for a display which is
+		// unplugged and comes back.
+		VcpFeatureController(ScheduledMonitorBackend& backend, const DisplayTopology& topology);
+
+		// Reads the codes in one scheduling slot of the display's bus: no other command runs between them, and they are
+		// spaced by the minimum command interval. A code the monitor rejects only fails its own value.
+		[[nodiscard]] MonitorStatus GetVcpFeatures(DisplayHandle display, const std::vector<VcpCode>& codes, std::vector<VcpFeatureValue>& features);
+
+		[[nodiscard]] MonitorStatus SetVcpFeature(DisplayHandle display, VcpCode code, unsigned long value);
+
+		// Requests the capability string once per physical display; failures are not cached, so the next call asks
+		// again.
+		[[nodiscard]] MonitorStatus GetCapabilitiesString(DisplayHandle display, std::string& capabilities);
+
+		// The parsed capability string of the display, valid as long as the controller.
+		[[nodiscard]] MonitorStatus GetCapabilities(DisplayHandle display, const MccsCapabilities*& capabilities);
+
+	private:
+		struct CachedCapabilities
+		{
+			std::string text;
+
+			// views into text
+			MccsCapabilities table;
+		};
+
+		ScheduledMonitorBackend& backend_;
+
+		const DisplayTopology& topology_;
+
+		// map nodes do not move, so the tables keep pointing at their own text
+		std::unordered_map<DisplayIdentity, CachedCapabilities, DisplayIdentityHash> capabilities_;
+
+		[[nodiscard]] DisplayIdentity GetIdentity(DisplayHandle display) const;
+
+		[[nodiscard]] MonitorStatus FindCapabilities(DisplayHandle display, const CachedCapabilities*& capabilities);
+	};
+}
+
+#endif
@@ -0,0 +1,173 @@
+#include "../include/screen_brightness_windows/ambient_brightness.h"
+
+#include <algorithm>
+#include <cmath>
+
+#ifdef _WIN32
+#include <Windows.h>
+#else
+#include <time.h>
+#endif
+
+namespace screen_brightness
+{
+	namespace
+	{
+		std::chrono::nanoseconds GetThreadCpuTime()
+		{
+#ifdef _WIN32
+			FILETIME creation_time, exit_time, kernel_time, user_time;
+			if (!GetThreadTimes(GetCurrentThread(), &creation_time, &exit_time, &kernel_time, &user_time))
+			{
+				return {};
+			}
+
+			// 100 ns units
+			const auto to_ticks = [](const FILETIME& time) { return static_cast<std::uint64_t>(time.dwHighDateTime) << 32 | time.dwLowDateTime; };
+			return std::chrono::nanoseconds((to_ticks(kernel_time) + to_ticks(user_time)) * 100);
+#else
+			timespec time{};
+			if (clock_gettime(CLOCK_THREAD_CPUTIME_ID, &time) != 0)
+			{
+				return {};
+			}
+
+			return std::chrono::seconds(time.tv_sec) + std::chrono::nanoseconds(time.tv_nsec);
+#endif
+		}
+
+		// lux below one is as dark as one for the eye's log response
+		double ToLogLux(const double lux)
+		{
+			return std::log10(std::max(lux, 1.0));
+		}
+	}
+
+	AmbientBrightnessController::AmbientBrightnessController(BrightnessClient& client, AmbientLightSource& source, Clock& clock) :
+		client_(client), source_(source), clock_(clock)
+	{
+	}
+
+	void AmbientBrightnessController::SetConfig(const AmbientBrightnessConfig& config)
+	{
+		config_ = config;
+		Reset();
+	}
+
+	void AmbientBrightnessController::SetEnabled(const bool is_enabled)
+	{
+		if (is_enabled == is_enabled_)
+		{
+			return;
+		}
+
+		is_enabled_ = is_enabled;
+		if (!is_enabled_ && written_override_ >= 0 && client_.GetApplicationScreenBrightnessOverride() == written_override_)
+		{
+			(void)client_.ResetApplicationScreenBrightness();
+		}
+
+		Reset();
+	}
+
+	Clock::time_point AmbientBrightnessController::Poll()
+	{
+		if (!is_enabled_)
+		{
+			return Clock::time_point::max();
+		}
+
+		const std::chrono::nanoseconds cpu_start = GetThreadCpuTime();
+		const Clock::time_point now = clock_.Now();
+		++counters_.poll_count;
+
+		const std::uint64_t previous_sample_count = source_.sample_count();
+		double lux = 0;
+		if (source_.ReadIlluminance(lux) && lux >= 0)
+		{
+			++counters_.reading_count;
+			counters_.sample_count += source_.sample_count() - previous_sample_count;
+			if (smoothed_lux_ < 0 || config_.time_constant <= Clock::duration::zero())
+			{
+				smoothed_lux_ = lux;
+			}
+			else
+			{
+				const double elapsed = std::chrono::duration<double>(now - last_reading_time_).count();
+				const double weight = 1 - std::exp(-elapsed / std::chrono::duration<double>(config_.time_constant).count());
+				smoothed_lux_ += (lux - smoothed_lux_) * weight;
+			}
+
+			last_reading_time_ = now;
+
+			// someone else set the application brightness since the last write, so it is applied again
+			if (written_override_ >= 0 && client_.GetApplicationScreenBrightnessOverride() != written_override_)
+			{
+				applied_lux_ = -1;
+				applied_brightness_ = -1;
+			}
+
+			const double change = applied_lux_ < 0 ? 1 : (smoothed_lux_ - applied_lux_) / std::max(applied_lux_, 1.0);
+			const bool is_beyond_threshold = applied_lux_ < 0 || change >= config_.brightening_threshold || -change >= config_.darkening_threshold;
+			const double brightness = MapIlluminance(config_.curve, smoothed_lux_);
+			if (is_beyond_threshold && (applied_brightness_ < 0 || std::abs(brightness - applied_brightness_) >= config_.deadband))
+			{
+				if (client_.SetApplicationScreenBrightness(brightness) == MonitorStatus::kOk)
+				{
+					++counters_.write_count;
+					applied_lux_ = smoothed_lux_;
+					applied_brightness_ = brightness;
+					written_override_ = client_.GetApplicationScreenBrightnessOverride();
+				}
+				else
+				{
+					// the next poll tries again
+					++counters_.failed_write_count;
+				}
+			}
+		}
+
+		counters_.cpu_time += GetThreadCpuTime() - cpu_start;
+		return now + config_.poll_interval;
+	}
+
+	double AmbientBrightnessController::MapIlluminance(const std::vector<AmbientBrightnessPoint>& curve, const double lux)
+	{
+		if (curve.empty())
+		{
+			return 1;
+		}
+
+		if (lux <= curve.front().lux)
+		{
+			return curve.front().brightness;
+		}
+
+		for (size_t index = 1; index < curve.size(); ++index)
+		{
+			const AmbientBrightnessPoint& upper = curve[index];
+			if (lux > upper.lux)
+			{
+				continue;
+			}
+
+			const AmbientBrightnessPoint& lower = curve[index - 1];
+			const double span = ToLogLux(upper.lux) - ToLogLux(lower.lux);
+			const double fraction = span <= 0 ? 1 : (ToLogLux(lux) - ToLogLux(lower.lux)) / span;
+			return lower.brightness + (upper.brightness - lower.brightness) * fraction;
+		}
+
+		return curve.back().brightness;
+	}
+
+	void AmbientBrightnessController::Reset()
+	{
+		smoothed_lux_ = -1;
+		applied_lux_ = -1;
+		applied_brightness_ = -1;
+		if (!is_enabled_)
+		{
+			written_override_ = -1;
+		}
+	}
+}
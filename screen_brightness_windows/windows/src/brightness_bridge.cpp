@@ -0,0 +1,445 @@
+#include "../include/screen_brightness_windows/brightness_bridge.h"
+
+#include <algorithm>
+#include <utility>
+#include <vector>
+
+namespace screen_brightness
+{
+	namespace
+	{
+		std::mutex installed_mutex;
+
+		std::vector<std::shared_ptr<BrightnessBridge>> installed_bridges;
+
+		// cached brightness of installed_bridges.front(), updated under installed_mutex
+		std::atomic<double> installed_cached_brightness{ -1 };
+
+		void PublishInstalledCachedBrightness()
+		{
+			installed_cached_brightness.store(installed_bridges.empty() ? -1 : installed_bridges.front()->cached_brightness(),
+				std::memory_order_release);
+		}
+
+		// shared by the bridges, so that an id of a bridge which has gone never reaches another
+		std::atomic<std::int64_t> next_id{ 1 };
+	}
+
+	BrightnessBridge::BrightnessBridge(BrightnessClient& client, WakeCallback wake) : client_(client), service_(client.shared_service()),
+		wake_(std::move(wake))
+	{
+		// the display shows the system brightness until the engine overrides it
+		if (client_.HasSystemScreenBrightness())
+		{
+			cached_brightness_.store(client_.GetSystemScreenBrightness(), std::memory_order_release);
+		}
+	}
+
+	BrightnessBridge::~BrightnessBridge()
+	{
+		{
+			std::lock_guard<std::mutex> lock(mutex_);
+			is_closed_ = true;
+		}
+
+		deadline_condition_.notify_all();
+		if (deadline_thread_.joinable())
+		{
+			deadline_thread_.join();
+		}
+	}
+
+	std::shared_ptr<BrightnessBridge> BrightnessBridge::GetInstalled()
+	{
+		std::lock_guard<std::mutex> lock(installed_mutex);
+		return installed_bridges.empty() ? nullptr : installed_bridges.front();
+	}
+
+	double BrightnessBridge::GetInstalledCachedBrightness()
+	{
+		return installed_cached_brightness.load(std::memory_order_acquire);
+	}
+
+	void BrightnessBridge::Install(std::shared_ptr<BrightnessBridge> bridge)
+	{
+		std::lock_guard<std::mutex> lock(installed_mutex);
+		installed_bridges.push_back(std::move(bridge));
+		PublishInstalledCachedBrightness();
+	}
+
+	void BrightnessBridge::Uninstall(const BrightnessBridge* bridge)
+	{
+		std::lock_guard<std::mutex> lock(installed_mutex);
+		installed_bridges.erase(std::remove_if(installed_bridges.begin(), installed_bridges.end(),
+			[bridge](const std::shared_ptr<BrightnessBridge>& installed_bridge) { return installed_bridge.get() == bridge; }),
+			installed_bridges.end());
+		PublishInstalledCachedBrightness();
+	}
+
+	std::int64_t BrightnessBridge::SetApplicationScreenBrightnessAsync(const double brightness, CompletionCallback completion)
+	{
+		return SetApplicationScreenBrightnessAsync(brightness, OperationContext::kNoDeadline, std::move(completion));
+	}
+
+	std::int64_t BrightnessBridge::SetApplicationScreenBrightnessAsync(const double brightness, const Clock::time_point deadline, CompletionCallback completion)
+	{
+		const std::int64_t request_id = next_id.fetch_add(1, std::memory_order_relaxed);
+		return Queue(PendingWrite{ request_id, request_id, brightness, deadline, false, std::move(completion) });
+	}
+
+	std::int64_t BrightnessBridge::SetApplicationScreenBrightnessAsync(const double brightness, const Clock::time_point deadline, const std::int64_t operation_id,
+		CompletionCallback completion)
+	{
+		const std::int64_t request_id = next_id.fetch_add(1, std::memory_order_relaxed);
+		return Queue(PendingWrite{ request_id, operation_id, brightness, deadline, true, std::move(completion) });
+	}
+
+	std::int64_t BrightnessBridge::Queue(PendingWrite write)
+	{
+		const std::int64_t request_id = write.request_id;
+		PendingWrite replaced_write;
+		{
+			std::unique_lock<std::mutex> lock(mutex_);
+			if (is_closed_)
+			{
+				lock.unlock();
+				if (write.completion)
+				{
+					write.completion(request_id, MonitorStatus::kPreempted);
+				}
+
+				return request_id;
+			}
+
+			// the platform thread has been woken for the replaced write already
+			const bool is_replacing = has_pending_write_;
+			std::swap(pending_write_, write);
+			has_pending_write_ = true;
+			if (!is_replacing)
+			{
+				wake_();
+				return request_id;
+			}
+
+			if (write.is_platform_completion)
+			{
+				dropped_writes_.emplace_back(std::move(write), MonitorStatus::kPreempted);
+				wake_();
+				return request_id;
+			}
+
+			replaced_write = std::move(write);
+		}
+
+		if (replaced_write.completion)
+		{
+			replaced_write.completion(replaced_write.request_id, MonitorStatus::kPreempted);
+		}
+
+		return request_id;
+	}
+
+	bool BrightnessBridge::Cancel(const std::int64_t id)
+	{
+		PendingWrite write;
+		bool is_queued = false;
+		{
+			std::lock_guard<std::mutex> lock(mutex_);
+			is_queued = has_pending_write_ && (pending_write_.request_id == id || pending_write_.operation_id == id);
+			if (is_queued)
+			{
+				write = std::move(pending_write_);
+				has_pending_write_ = false;
+				if (write.is_platform_completion)
+				{
+					dropped_writes_.emplace_back(std::move(write), MonitorStatus::kCancelled);
+					wake_();
+					return true;
+				}
+			}
+		}
+
+		// the platform thread may be applying it; cancelling it takes the lock to wake the platform thread
+		if (!is_queued)
+		{
+			return service_->operation_registry().Cancel(id);
+		}
+
+		if (write.completion)
+		{
+			write.completion(write.request_id, MonitorStatus::kCancelled);
+		}
+
+		return true;
+	}
+
+	void BrightnessBridge::SetContentAdaptiveDimming(const ContentAdaptiveDimmingConfig& config)
+	{
+		std::lock_guard<std::mutex> lock(dimmer_mutex_);
+		dimmer_.SetConfig(config);
+	}
+
+	std::int64_t BrightnessBridge::SubmitFrame(const FrameView& frame, const Clock::time_point time, CompletionCallback completion)
+	{
+		std::size_t row_step = 0;
+		{
+			std::lock_guard<std::mutex> lock(dimmer_mutex_);
+			row_step = dimmer_.config().row_step;
+		}
+
+		// analysed without the lock, which frames of other threads only wait for to update the dimmer
+		LuminanceHistogram histogram;
+		if (!ComputeLuminanceHistogram(frame, row_step, histogram))
+		{
+			return kInvalidFrame;
+		}
+
+		double brightness = 0;
+		{
+			std::lock_guard<std::mutex> lock(dimmer_mutex_);
+			if (!dimmer_.Update(histogram, time, brightness))
+			{
+				return 0;
+			}
+		}
+
+		return SetApplicationScreenBrightnessAsync(brightness, std::move(completion));
+	}
+
+	std::int64_t BrightnessBridge::Subscribe(BrightnessChangedCallback callback)
+	{
+		const std::int64_t subscription_id = next_id.fetch_add(1, std::memory_order_relaxed);
+		std::lock_guard<std::mutex> lock(subscriptions_mutex_);
+		subscriptions_.emplace(subscription_id, std::move(callback));
+		return subscription_id;
+	}
+
+	void BrightnessBridge::Unsubscribe(const std::int64_t subscription_id)
+	{
+		std::lock_guard<std::mutex> lock(subscriptions_mutex_);
+		subscriptions_.erase(subscription_id);
+	}
+
+	void BrightnessBridge::RunPendingTasks()
+	{
+		std::vector<std::pair<PendingWrite, MonitorStatus>> dropped_writes;
+		{
+			std::lock_guard<std::mutex> lock(mutex_);
+			dropped_writes.swap(dropped_writes_);
+		}
+
+		for (const auto& [write, status] : dropped_writes)
+		{
+			if (write.completion)
+			{
+				write.completion(write.request_id, status);
+			}
+		}
+
+		// one write at a time, so that a failed one rolls back to what the display showed
+		if (applied_ != nullptr && !CompleteAppliedWrite())
+		{
+			return;
+		}
+
+		PendingWrite write;
+		std::shared_ptr<OperationContext> context;
+		{
+			std::lock_guard<std::mutex> lock(mutex_);
+			if (!has_pending_write_)
+			{
+				return;
+			}
+
+			write = std::move(pending_write_);
+			has_pending_write_ = false;
+
+			// registered under the lock, so that Cancel finds the write either queued or applied
+			context = service_->operation_registry().Begin(write.operation_id, write.deadline);
+		}
+
+		Apply(std::move(write), std::move(context));
+	}
+
+	void BrightnessBridge::Apply(PendingWrite write, std::shared_ptr<OperationContext> context)
+	{
+		// the platform thread only got to the write after its deadline
+		if (const MonitorStatus status = context->GetStatus(); status != MonitorStatus::kOk)
+		{
+			service_->operation_registry().End(*context);
+			if (write.completion)
+			{
+				write.completion(write.request_id, status);
+			}
+
+			return;
+		}
+
+		std::shared_ptr<BrightnessClient::ApplicationBrightnessWrite> applied;
+		{
+			const OperationContext::Scope scope(*context);
+			applied = client_.StartApplicationScreenBrightnessWrite(write.brightness, [bridge = weak_from_this()]
+				{
+					if (const std::shared_ptr<BrightnessBridge> locked_bridge = bridge.lock())
+					{
+						locked_bridge->WakeForAppliedWrite();
+					}
+				});
+		}
+
+		applied_write_ = std::move(write);
+		applied_context_ = std::move(context);
+		applied_ = std::move(applied);
+		{
+			// the scheduler wakes the platform thread once the write completes after this
+			std::lock_guard<std::mutex> lock(mutex_);
+			if (!applied_->is_completed())
+			{
+				is_waiting_ = true;
+				waiting_deadline_ = applied_write_.deadline;
+				if (waiting_deadline_ != OperationContext::kNoDeadline && !deadline_thread_.joinable())
+				{
+					deadline_thread_ = std::thread([this] { RunDeadlines(); });
+				}
+
+				deadline_condition_.notify_all();
+			}
+		}
+
+		// set once the write is applied, as the scheduler sets its own while the display is probed; a cancellation
+		// before it is seen below
+		applied_context_->SetCancelCallback([bridge = weak_from_this()]
+			{
+				if (const std::shared_ptr<BrightnessBridge> locked_bridge = bridge.lock())
+				{
+					locked_bridge->WakeForAppliedWrite();
+				}
+			});
+		(void)CompleteAppliedWrite();
+	}
+
+	bool BrightnessBridge::CompleteAppliedWrite()
+	{
+		const MonitorStatus context_status = applied_context_->GetStatus();
+		if (!applied_->is_completed() && context_status == MonitorStatus::kOk)
+		{
+			return false;
+		}
+
+		{
+			std::lock_guard<std::mutex> lock(mutex_);
+			is_waiting_ = false;
+			waiting_deadline_ = OperationContext::kNoDeadline;
+		}
+
+		// the client reports the new brightness through OnBrightnessChanged
+		applied_context_->SetCancelCallback(nullptr);
+		const MonitorStatus status = client_.FinishApplicationScreenBrightnessWrite(*applied_, context_status);
+		service_->operation_registry().End(*applied_context_);
+		const PendingWrite write = std::move(applied_write_);
+		applied_.reset();
+		applied_context_.reset();
+		if (write.completion)
+		{
+			write.completion(write.request_id, status);
+		}
+
+		return true;
+	}
+
+	void BrightnessBridge::WakeForAppliedWrite()
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+		if (!is_waiting_ || is_closed_)
+		{
+			return;
+		}
+
+		is_waiting_ = false;
+		wake_();
+	}
+
+	void BrightnessBridge::RunDeadlines()
+	{
+		std::unique_lock<std::mutex> lock(mutex_);
+		while (!is_closed_)
+		{
+			if (!is_waiting_ || waiting_deadline_ == OperationContext::kNoDeadline)
+			{
+				deadline_condition_.wait(lock);
+			}
+			else if (std::chrono::steady_clock::now() < waiting_deadline_)
+			{
+				deadline_condition_.wait_until(lock, waiting_deadline_);
+			}
+			else
+			{
+				is_waiting_ = false;
+				wake_();
+			}
+		}
+	}
+
+	void BrightnessBridge::OnBrightnessChanged(const double brightness)
+	{
+		cached_brightness_.store(brightness, std::memory_order_release);
+		{
+			std::lock_guard<std::mutex> lock(installed_mutex);
+			if (!installed_bridges.empty() && installed_bridges.front().get() == this)
+			{
+				PublishInstalledCachedBrightness();
+			}
+		}
+
+		// held while calling, so that a callback is never called after Unsubscribe has returned
+		std::lock_guard<std::mutex> lock(subscriptions_mutex_);
+		for (const auto& [subscription_id, callback] : subscriptions_)
+		{
+			callback(brightness);
+		}
+	}
+
+	void BrightnessBridge::Close()
+	{
+		PendingWrite write;
+		bool has_write = false;
+		std::vector<std::pair<PendingWrite, MonitorStatus>> dropped_writes;
+		{
+			std::lock_guard<std::mutex> lock(mutex_);
+			is_closed_ = true;
+			has_write = has_pending_write_;
+			write = std::move(pending_write_);
+			has_pending_write_ = false;
+			dropped_writes.swap(dropped_writes_);
+		}
+
+		deadline_condition_.notify_all();
+		if (deadline_thread_.joinable())
+		{
+			deadline_thread_.join();
+		}
+
+		for (const auto& [dropped_write, status] : dropped_writes)
+		{
+			if (dropped_write.completion)
+			{
+				dropped_write.completion(dropped_write.request_id, status);
+			}
+		}
+
+		if (has_write && write.completion)
+		{
+			write.completion(write.request_id, MonitorStatus::kPreempted);
+		}
+
+		// the write being applied is not waited for
+		if (applied_ != nullptr)
+		{
+			applied_context_->Cancel();
+			(void)CompleteAppliedWrite();
+		}
+
+		std::lock_guard<std::mutex> lock(subscriptions_mutex_);
+		subscriptions_.clear();
+	}
+}
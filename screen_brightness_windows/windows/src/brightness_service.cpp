@@ -0,0 +1,953 @@
+#include "../include/screen_brightness_windows/brightness_service.h"
+
+#include <algorithm>
+#include <condition_variable>
+#include <iostream>
+#include <mutex>
+#include <utility>
+
+#include "../include/screen_brightness_windows/process_liveness.h"
+
+namespace screen_brightness
+{
+	namespace
+	{
+		double GetPercentage(const long minimum, const long maximum, const long brightness)
+		{
+			if (brightness < 0 || maximum <= minimum)
+			{
+				return 0;
+			}
+
+			return static_cast<double>(brightness - minimum) / (maximum - minimum);
+		}
+
+		long GetValueByPercentage(const long minimum, const long maximum, const double percentage)
+		{
+			return static_cast<long>((percentage * (maximum - minimum)) + minimum);
+		}
+
+		// Results of the restore writes of a closing client, shared with the completions of the writes.
+		struct RestoreProgress
+		{
+			std::mutex mutex;
+
+			std::condition_variable condition;
+
+			std::vector<DisplayRestoreResult> results;
+
+			size_t remaining_count = 0;
+		};
+	}
+
+	std::shared_ptr<BrightnessService> BrightnessService::Acquire(const Factory& create)
+	{
+		static std::mutex mutex;
+		static std::weak_ptr<BrightnessService> instance;
+
+		std::lock_guard<std::mutex> lock(mutex);
+		if (std::shared_ptr<BrightnessService> service = instance.lock())
+		{
+			return service;
+		}
+
+		std::shared_ptr<BrightnessService> service = create();
+		instance = service;
+		return service;
+	}
+
+	BrightnessService::BrightnessService(std::unique_ptr<MonitorBackend> backend, Clock& clock, const Clock::duration minimum_command_interval, const bool is_threaded) :
+		backend_(std::move(backend)),
+		scheduled_backend_(*backend_, clock, minimum_command_interval, is_threaded),
+		display_topology_(scheduled_backend_),
+		vcp_feature_controller_(scheduled_backend_, display_topology_)
+	{
+		// the initial enumeration is not a change, so its delta is not reported
+		DisplayTopologyDelta delta;
+		if (const MonitorStatus status = display_topology_.Update(delta); status != MonitorStatus::kOk)
+		{
+			std::cout << GetMonitorStatusMessage(status) << std::endl;
+		}
+	}
+
+	BrightnessService::~BrightnessService()
+	{
+		// commands which outlived their callers refer to the journal and the lease table
+		scheduled_backend_.RemoveSchedulers();
+	}
+
+	MonitorStatus BrightnessService::OpenLeaseTable(const std::string& name)
+	{
+		return lease_table_.Open(name);
+	}
+
+	MonitorStatus BrightnessService::OpenRestoreJournal(const std::string& path)
+	{
+		return restore_journal_.Open(path);
+	}
+
+	std::vector<DisplayRestoreResult> BrightnessService::RecoverRestoreJournal()
+	{
+		std::vector<DisplayRestoreResult> results;
+		restore_journal_.Recover([this, &results](const RestoreJournalEntry& entry)
+			{
+				// a display which is not attached is restored by a later recovery
+				const DisplayTopology::Display* topology_display = display_topology_.FindByIdentity(entry.identity);
+				if (topology_display == nullptr)
+				{
+					return false;
+				}
+
+				// another process overriding the display now restores it itself
+				const DisplayHandle display = topology_display->info.handle;
+				if (SharedLeaseEntry lease_entry; entry.system_value < 0 || ReadLeaseEntry(display, lease_entry))
+				{
+					results.push_back(DisplayRestoreResult{ display, true, MonitorStatus::kOk });
+					return true;
+				}
+
+				const MonitorStatus status = scheduled_backend_.SetScreenBrightness(display, entry.system_value);
+				results.push_back(DisplayRestoreResult{ display, true, status });
+				return status == MonitorStatus::kOk;
+			});
+		return results;
+	}
+
+	MonitorStatus BrightnessService::UpdateDisplayTopology()
+	{
+		DisplayTopologyDelta delta;
+		if (const MonitorStatus status = display_topology_.Update(delta); status != MonitorStatus::kOk)
+		{
+			return status;
+		}
+
+		// a display which came back with another handle keeps its state and clients; all are taken out before any is
+		// put back, as handles may have been swapped between displays
+		std::vector<std::map<DisplayHandle, DisplayState>::node_type> moved_states;
+		for (const DisplayHandleChange& change : delta.handle_changes)
+		{
+			scheduled_backend_.RemoveScheduler(change.previous);
+			display_state_table_.Remove(change.previous);
+			if (auto state = displays_.extract(change.previous); !state.empty())
+			{
+				state.key() = change.current;
+				moved_states.push_back(std::move(state));
+			}
+		}
+
+		for (BrightnessClient* client : clients_)
+		{
+			const auto change = std::find_if(delta.handle_changes.begin(), delta.handle_changes.end(),
+				[client](const DisplayHandleChange& handle_change) { return handle_change.previous == client->display_; });
+			if (change != delta.handle_changes.end())
+			{
+				client->display_ = change->current;
+			}
+		}
+
+		// a handle of a removed display may be reused for another one
+		for (const DisplayInfo& display : delta.removed)
+		{
+			scheduled_backend_.RemoveScheduler(display.handle);
+			displays_.erase(display.handle);
+			display_state_table_.Remove(display.handle);
+		}
+
+		for (auto& state : moved_states)
+		{
+			const DisplayHandle display = state.key();
+			displays_.erase(display);
+			const auto position = displays_.insert(std::move(state)).position;
+			if (position->second.system_brightness != -1)
+			{
+				PublishDisplayState(display, position->second);
+			}
+		}
+
+		if (delta.empty())
+		{
+			return MonitorStatus::kOk;
+		}
+
+		for (const BrightnessClient* client : clients_)
+		{
+			if (client->display_topology_changed_callback_)
+			{
+				client->display_topology_changed_callback_(delta);
+			}
+		}
+
+		return MonitorStatus::kOk;
+	}
+
+	MonitorStatus BrightnessService::GetDisplayState(const DisplayHandle display, DisplayState*& state)
+	{
+		state = &displays_[display];
+		if (state->system_brightness != -1)
+		{
+			return MonitorStatus::kOk;
+		}
+
+		return ProbeDisplay(display, *state);
+	}
+
+	MonitorStatus BrightnessService::ProbeDisplay(const DisplayHandle display, DisplayState& state)
+	{
+		long minimum_brightness = -1;
+		long brightness = -1;
+		long maximum_brightness = -1;
+		if (const MonitorStatus status = scheduled_backend_.GetScreenBrightness(display, minimum_brightness, brightness, maximum_brightness);
+			status != MonitorStatus::kOk)
+		{
+			return status;
+		}
+
+		// while another process overrides the display, the hardware shows its override
+		if (SharedLeaseEntry entry; ReadLeaseEntry(display, entry) && entry.system_value >= 0)
+		{
+			brightness = entry.system_value;
+		}
+
+		state.minimum_brightness = minimum_brightness;
+		state.system_brightness = brightness;
+		state.maximum_brightness = maximum_brightness;
+		PublishDisplayState(display, state);
+		return MonitorStatus::kOk;
+	}
+
+	long BrightnessService::GetShownBrightness(const DisplayState& state)
+	{
+		return state.overrides.empty() ? state.system_brightness : state.overrides.back()->application_screen_brightness_;
+	}
+
+	MonitorStatus BrightnessService::ApplyBrightness(const DisplayHandle display, DisplayState& state, const bool is_restoring)
+	{
+		BrightnessWrite write;
+		if (!PrepareWrite(display, state, is_restoring, write))
+		{
+			return MonitorStatus::kOk;
+		}
+
+		const MonitorStatus status = ExecuteWrite(write);
+		RecordWrite(display, state, write, status);
+		return status;
+	}
+
+	bool BrightnessService::PrepareWrite(const DisplayHandle display, const DisplayState& state, const bool is_restoring, BrightnessWrite& write)
+	{
+		write.display = display;
+		write.sequence = ++write_count_;
+		write.brightness = GetShownBrightness(state);
+		write.system_brightness = state.system_brightness;
+		if (write.brightness < 0)
+		{
+			return false;
+		}
+
+		const DisplayTopology::Display* topology_display = lease_table_.is_open() || restore_journal_.is_open() ?
+			display_topology_.FindByHandle(display) : nullptr;
+		write.has_identity = topology_display != nullptr;
+		write.identity = write.has_identity ? topology_display->info.identity : DisplayIdentity{};
+		write.is_overriding = !state.overrides.empty();
+		if (write.has_identity && lease_table_.is_open())
+		{
+			write.has_lease = true;
+			write.is_releasing = is_restoring && state.overrides.empty();
+			if (is_restoring && !lease_table_.IsHeld(write.identity))
+			{
+				return false;
+			}
+
+			lease_table_.Acquire(write.identity);
+		}
+
+		return true;
+	}
+
+	MonitorStatus BrightnessService::ExecuteWrite(const BrightnessWrite& write)
+	{
+		BeginWrite(write);
+		if (const MonitorStatus status = scheduled_backend_.SetScreenBrightness(write.display, write.brightness); status != MonitorStatus::kOk)
+		{
+			return status;
+		}
+
+		CompleteWrite(write);
+		return MonitorStatus::kOk;
+	}
+
+	void BrightnessService::RecordWrite(const DisplayHandle display, DisplayState& state, const BrightnessWrite& write, const MonitorStatus status)
+	{
+		// a later write reached the scheduler after this one, so the monitor had it last
+		if (write.sequence < state.applied_write)
+		{
+			return;
+		}
+
+		if (status == MonitorStatus::kOk)
+		{
+			state.applied_brightness = write.brightness;
+		}
+		else if (status == MonitorStatus::kTimedOut || status == MonitorStatus::kCancelled)
+		{
+			// the write may still be running, detached from its caller
+			state.applied_brightness = kUnknownBrightness;
+		}
+		else
+		{
+			return;
+		}
+
+		state.applied_write = write.sequence;
+		PublishDisplayState(display, state);
+	}
+
+	void BrightnessService::BeginWrite(const BrightnessWrite& write)
+	{
+		// journaled first, so that a crash during the write still restores the display
+		if (write.has_identity && write.is_overriding)
+		{
+			restore_journal_.Record(write.identity, write.brightness, write.system_brightness);
+		}
+	}
+
+	void BrightnessService::CompleteWrite(const BrightnessWrite& write)
+	{
+		if (write.has_identity && !write.is_overriding)
+		{
+			restore_journal_.Clear(write.identity);
+		}
+
+		if (write.has_lease)
+		{
+			lease_table_.Publish(write.identity, write.brightness, write.system_brightness);
+			if (write.is_releasing)
+			{
+				lease_table_.Release(write.identity);
+			}
+		}
+	}
+
+	bool BrightnessService::ReadLeaseEntry(const DisplayHandle display, SharedLeaseEntry& entry) const
+	{
+		const DisplayTopology::Display* topology_display = lease_table_.is_open() ? display_topology_.FindByHandle(display) : nullptr;
+		return topology_display != nullptr && lease_table_.Read(topology_display->info.identity, entry) && entry.generation != 0 &&
+			entry.is_owner_alive && entry.owner != lease_table_.process_id();
+	}
+
+	bool BrightnessService::RemoveOverride(const DisplayHandle display, const BrightnessClient& client)
+	{
+		const auto state = displays_.find(display);
+		if (state == displays_.end())
+		{
+			return false;
+		}
+
+		std::vector<BrightnessClient*>& overrides = state->second.overrides;
+		const auto iterator = std::find(overrides.begin(), overrides.end(), &client);
+		bool is_shown = false;
+		if (iterator != overrides.end())
+		{
+			is_shown = iterator + 1 == overrides.end();
+			overrides.erase(iterator);
+		}
+
+		if (is_shown || state->second.applied_brightness == kUnknownBrightness)
+		{
+			if (const MonitorStatus status = ApplyBrightness(display, state->second, true); status != MonitorStatus::kOk)
+			{
+				std::cout << GetMonitorStatusMessage(status) << std::endl;
+			}
+		}
+
+		return is_shown;
+	}
+
+	void BrightnessService::NotifySystemScreenBrightnessChanged(const DisplayHandle display, const DisplayState& state)
+	{
+		if (state.system_brightness == -1)
+		{
+			return;
+		}
+
+		PublishDisplayState(display, state);
+		const double brightness = GetPercentage(state.minimum_brightness, state.maximum_brightness, state.system_brightness);
+		for (const BrightnessClient* client : clients_)
+		{
+			if (client->display_ != display)
+			{
+				continue;
+			}
+
+			if (client->system_screen_brightness_changed_callback_)
+			{
+				client->system_screen_brightness_changed_callback_(brightness);
+			}
+
+			// clients without an override show the system brightness
+			if (client->application_screen_brightness_ == -1)
+			{
+				client->HandleApplicationScreenBrightnessChanged(state, state.system_brightness);
+			}
+		}
+	}
+
+	void BrightnessService::PublishDisplayState(const DisplayHandle display, const DisplayState& state)
+	{
+		PublishedDisplayState published_state;
+		published_state.display = display;
+		published_state.current = state.applied_brightness >= 0 ? state.applied_brightness : state.system_brightness;
+		published_state.target = GetShownBrightness(state);
+		published_state.minimum = state.minimum_brightness;
+		published_state.maximum = state.maximum_brightness;
+		published_state.system = state.system_brightness;
+		if (!state.overrides.empty())
+		{
+			published_state.owner = GetOwnProcessId();
+		}
+		else if (SharedLeaseEntry entry; ReadLeaseEntry(display, entry))
+		{
+			published_state.owner = entry.owner;
+		}
+
+		// a full table leaves the displays beyond it unpublished, which readers see as unknown
+		display_state_table_.Publish(published_state);
+	}
+
+	bool BrightnessClient::ApplicationBrightnessWrite::is_completed() const
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+		return status_.has_value();
+	}
+
+	BrightnessClient::BrightnessClient(std::shared_ptr<BrightnessService> service) : service_(std::move(service))
+	{
+		service_->clients_.push_back(this);
+	}
+
+	BrightnessClient::~BrightnessClient()
+	{
+		service_->RemoveOverride(display_, *this);
+		std::vector<BrightnessClient*>& clients = service_->clients_;
+		clients.erase(std::remove(clients.begin(), clients.end(), this), clients.end());
+	}
+
+	void BrightnessClient::Initialize()
+	{
+		BrightnessService::DisplayState* state = nullptr;
+		if (const MonitorStatus status = service_->GetDisplayState(display_, state); status != MonitorStatus::kOk)
+		{
+			std::cout << GetMonitorStatusMessage(status) << std::endl;
+		}
+	}
+
+	MonitorStatus BrightnessClient::MigrateDisplay(const DisplayHandle display)
+	{
+		if (display == display_)
+		{
+			return MonitorStatus::kOk;
+		}
+
+		// the previous display may be gone already, which must not keep the client on it
+		double application_screen_brightness = 0;
+		const bool has_application_screen_brightness = application_screen_brightness_ != -1;
+		if (const auto previous_state = service_->displays_.find(display_); has_application_screen_brightness && previous_state != service_->displays_.end())
+		{
+			application_screen_brightness = GetPercentage(previous_state->second.minimum_brightness, previous_state->second.maximum_brightness,
+				application_screen_brightness_);
+		}
+
+		service_->RemoveOverride(display_, *this);
+		display_ = display;
+		application_screen_brightness_ = -1;
+		++override_generation_;
+
+		BrightnessService::DisplayState* state = nullptr;
+		if (const MonitorStatus status = service_->GetDisplayState(display, state); status != MonitorStatus::kOk)
+		{
+			return status;
+		}
+
+		if (system_screen_brightness_changed_callback_)
+		{
+			system_screen_brightness_changed_callback_(GetPercentage(state->minimum_brightness, state->maximum_brightness, state->system_brightness));
+		}
+
+		if (!has_application_screen_brightness)
+		{
+			HandleApplicationScreenBrightnessChanged(*state, state->system_brightness);
+			return MonitorStatus::kOk;
+		}
+
+		// brightness ranges differ between displays
+		application_screen_brightness_ = GetValueByPercentage(state->minimum_brightness, state->maximum_brightness, application_screen_brightness);
+		if (is_paused_)
+		{
+			return MonitorStatus::kOk;
+		}
+
+		state->overrides.push_back(this);
+		return service_->ApplyBrightness(display, *state);
+	}
+
+	void BrightnessClient::SetSystemScreenBrightnessChangedCallback(BrightnessChangedCallback callback)
+	{
+		system_screen_brightness_changed_callback_ = std::move(callback);
+	}
+
+	void BrightnessClient::SetApplicationScreenBrightnessChangedCallback(BrightnessChangedCallback callback)
+	{
+		application_screen_brightness_changed_callback_ = std::move(callback);
+	}
+
+	void BrightnessClient::SetDisplayTopologyChangedCallback(DisplayTopologyChangedCallback callback)
+	{
+		display_topology_changed_callback_ = std::move(callback);
+	}
+
+	bool BrightnessClient::HasSystemScreenBrightness() const
+	{
+		const auto state = service_->displays_.find(display_);
+		return state != service_->displays_.end() && state->second.system_brightness != -1;
+	}
+
+	double BrightnessClient::GetSystemScreenBrightness() const
+	{
+		const auto state = service_->displays_.find(display_);
+		if (state == service_->displays_.end())
+		{
+			return 0;
+		}
+
+		return GetPercentage(state->second.minimum_brightness, state->second.maximum_brightness, state->second.system_brightness);
+	}
+
+	MonitorStatus BrightnessClient::SetSystemScreenBrightness(const double brightness)
+	{
+		BrightnessService::DisplayState* state = nullptr;
+		if (const MonitorStatus status = service_->GetDisplayState(display_, state); status != MonitorStatus::kOk)
+		{
+			return status;
+		}
+
+		state->system_brightness = GetValueByPercentage(state->minimum_brightness, state->maximum_brightness, brightness);
+		MonitorStatus status = MonitorStatus::kOk;
+		if (state->overrides.empty())
+		{
+			status = service_->ApplyBrightness(display_, *state);
+		}
+
+		service_->NotifySystemScreenBrightnessChanged(display_, *state);
+		return status;
+	}
+
+	MonitorStatus BrightnessClient::GetApplicationScreenBrightness(double& brightness)
+	{
+		BrightnessService::DisplayState* state = nullptr;
+		if (const MonitorStatus status = service_->GetDisplayState(display_, state); status != MonitorStatus::kOk)
+		{
+			return status;
+		}
+
+		// the value another process has applied is known without asking the monitor
+		if (SharedLeaseEntry entry; service_->ReadLeaseEntry(display_, entry))
+		{
+			brightness = GetPercentage(state->minimum_brightness, state->maximum_brightness, entry.value);
+			return MonitorStatus::kOk;
+		}
+
+		long minimum_brightness = -1;
+		long screen_brightness = -1;
+		long maximum_brightness = -1;
+		const MonitorStatus status = service_->scheduled_backend_.GetScreenBrightness(display_, minimum_brightness, screen_brightness, maximum_brightness);
+		if (status == MonitorStatus::kOk)
+		{
+			brightness = GetPercentage(minimum_brightness, maximum_brightness, screen_brightness);
+		}
+
+		return status;
+	}
+
+	double BrightnessClient::GetApplicationScreenBrightnessOverride() const
+	{
+		const auto state = service_->displays_.find(display_);
+		if (application_screen_brightness_ == -1 || state == service_->displays_.end())
+		{
+			return -1;
+		}
+
+		return GetPercentage(state->second.minimum_brightness, state->second.maximum_brightness, application_screen_brightness_);
+	}
+
+	MonitorStatus BrightnessClient::SetApplicationScreenBrightness(const double brightness)
+	{
+		BrightnessService::DisplayState* state = nullptr;
+		if (const MonitorStatus status = service_->GetDisplayState(display_, state); status != MonitorStatus::kOk)
+		{
+			return status;
+		}
+
+		const long brightness_value = GetValueByPercentage(state->minimum_brightness, state->maximum_brightness, brightness);
+		ApplicationBrightnessWrite write;
+		BeginOverride(*state, brightness_value, write);
+		if (!is_paused_)
+		{
+			// a failed write leaves everything as it was
+			if (const MonitorStatus status = service_->ApplyBrightness(display_, *state); status != MonitorStatus::kOk)
+			{
+				RollBackOverride(*state, write);
+				return status;
+			}
+		}
+
+		HandleApplicationScreenBrightnessChanged(*state, brightness_value);
+		return MonitorStatus::kOk;
+	}
+
+	std::shared_ptr<BrightnessClient::ApplicationBrightnessWrite> BrightnessClient::StartApplicationScreenBrightnessWrite(const double brightness,
+		std::function<void()> on_completed)
+	{
+		auto write = std::make_shared<ApplicationBrightnessWrite>();
+		write->write_.display = display_;
+		BrightnessService::DisplayState* state = nullptr;
+		if (const MonitorStatus status = service_->GetDisplayState(display_, state); status != MonitorStatus::kOk)
+		{
+			write->status_ = status;
+			return write;
+		}
+
+		BeginOverride(*state, GetValueByPercentage(state->minimum_brightness, state->maximum_brightness, brightness), *write);
+		if (is_paused_ || !service_->PrepareWrite(display_, *state, false, write->write_))
+		{
+			write->status_ = MonitorStatus::kOk;
+			return write;
+		}
+
+		service_->BeginWrite(write->write_);
+		write->is_queued_ = true;
+		DdcScheduler& scheduler = service_->scheduled_backend_.GetScheduler(display_);
+		write->command_sequence_ = scheduler.Submit(DdcPriority::kUserWrite, kDdcBrightnessWrite,
+			[backend = &service_->backend(), display = display_, value = write->write_.brightness]
+			{
+				return backend->SetScreenBrightness(display, value);
+			},
+			[service = service_.get(), write, on_completed = std::move(on_completed)](const MonitorStatus status)
+			{
+				if (status == MonitorStatus::kOk)
+				{
+					service->CompleteWrite(write->write_);
+				}
+
+				{
+					std::lock_guard<std::mutex> lock(write->mutex_);
+					write->status_ = status;
+				}
+
+				if (on_completed)
+				{
+					on_completed();
+				}
+			});
+
+		// without worker threads the write runs here
+		if (!service_->scheduled_backend_.is_threaded())
+		{
+			scheduler.RunUntilIdle();
+		}
+
+		return write;
+	}
+
+	MonitorStatus BrightnessClient::FinishApplicationScreenBrightnessWrite(ApplicationBrightnessWrite& write, const MonitorStatus give_up_status)
+	{
+		std::optional<MonitorStatus> status;
+		{
+			std::lock_guard<std::mutex> lock(write.mutex_);
+			status = write.status_;
+		}
+
+		// a write which has not started by now never does
+		bool is_withdrawn = false;
+		if (!status.has_value())
+		{
+			is_withdrawn = service_->scheduled_backend_.Withdraw(write.write_.display, write.command_sequence_);
+			status = give_up_status;
+		}
+
+		// without an override begun, the display's state could not be read
+		const auto state = service_->displays_.find(write.write_.display);
+		if (write.brightness_ == -1 || state == service_->displays_.end())
+		{
+			return *status;
+		}
+
+		if (write.is_queued_ && !is_withdrawn)
+		{
+			service_->RecordWrite(write.write_.display, state->second, write.write_, *status);
+		}
+
+		if (*status != MonitorStatus::kOk)
+		{
+			RollBackOverride(state->second, write);
+			return *status;
+		}
+
+		// a later change has been reported already
+		if (write.generation_ == override_generation_)
+		{
+			HandleApplicationScreenBrightnessChanged(state->second, write.brightness_);
+		}
+
+		return MonitorStatus::kOk;
+	}
+
+	MonitorStatus BrightnessClient::ResetApplicationScreenBrightness()
+	{
+		BrightnessService::DisplayState* state = nullptr;
+		if (const MonitorStatus status = service_->GetDisplayState(display_, state); status != MonitorStatus::kOk)
+		{
+			return status;
+		}
+
+		service_->RemoveOverride(display_, *this);
+		application_screen_brightness_ = -1;
+		++override_generation_;
+		HandleApplicationScreenBrightnessChanged(*state, state->system_brightness);
+		return MonitorStatus::kOk;
+	}
+
+	void BrightnessClient::OnApplicationPause()
+	{
+		is_paused_ = true;
+		service_->RemoveOverride(display_, *this);
+	}
+
+	std::vector<DisplayRestoreResult> BrightnessClient::OnApplicationClose(const Clock::duration timeout)
+	{
+		// WM_DESTROY follows WM_CLOSE, and must not wait for a hung write again
+		if (is_closed_)
+		{
+			return {};
+		}
+
+		is_paused_ = true;
+		is_closed_ = true;
+		if (const auto state = service_->displays_.find(display_); state != service_->displays_.end())
+		{
+			std::vector<BrightnessClient*>& overrides = state->second.overrides;
+			overrides.erase(std::remove(overrides.begin(), overrides.end(), this), overrides.end());
+		}
+
+		std::vector<BrightnessService::BrightnessWrite> writes;
+		std::vector<size_t> write_results;
+		auto progress = std::make_shared<RestoreProgress>();
+		for (const auto& [display, state] : service_->displays_)
+		{
+			// displays which show what they should, including the overrides of other clients, are left alone
+			if (state.applied_brightness == -1 || state.applied_brightness == BrightnessService::GetShownBrightness(state))
+			{
+				continue;
+			}
+
+			BrightnessService::BrightnessWrite write;
+			if (!service_->PrepareWrite(display, state, true, write))
+			{
+				progress->results.push_back(DisplayRestoreResult{ display, true, MonitorStatus::kOk });
+				continue;
+			}
+
+			write_results.push_back(progress->results.size());
+			progress->results.push_back(DisplayRestoreResult{ display, false, MonitorStatus::kTimedOut });
+			writes.push_back(write);
+		}
+
+		// queued like user writes, so a restore supersedes a queued write to the display
+		const auto deadline = std::chrono::steady_clock::now() + timeout;
+		std::vector<std::pair<DdcScheduler*, std::uint64_t>> commands;
+		progress->remaining_count = writes.size();
+		for (size_t index = 0; index < writes.size(); ++index)
+		{
+			const BrightnessService::BrightnessWrite& write = writes[index];
+			service_->BeginWrite(write);
+			DdcScheduler& scheduler = service_->scheduled_backend_.GetScheduler(write.display);
+			const std::uint64_t sequence = scheduler.Submit(DdcPriority::kUserWrite, kDdcBrightnessWrite,
+				[backend = &service_->backend(), display = write.display, brightness = write.brightness]
+				{
+					return backend->SetScreenBrightness(display, brightness);
+				},
+				[service = service_.get(), progress, write, result_index = write_results[index]](const MonitorStatus status)
+				{
+					if (status == MonitorStatus::kOk)
+					{
+						service->CompleteWrite(write);
+					}
+
+					std::lock_guard<std::mutex> lock(progress->mutex);
+					progress->results[result_index] = DisplayRestoreResult{ write.display, true, status };
+					--progress->remaining_count;
+					progress->condition.notify_all();
+				});
+			commands.emplace_back(&scheduler, sequence);
+		}
+
+		// without worker threads the writes run here, one after the other, as long as there is time
+		if (!service_->scheduled_backend_.is_threaded())
+		{
+			for (const auto& command : commands)
+			{
+				while (std::chrono::steady_clock::now() < deadline && command.first->RunNext())
+				{
+				}
+			}
+		}
+
+		std::vector<DisplayRestoreResult> results;
+		{
+			std::unique_lock<std::mutex> lock(progress->mutex);
+			progress->condition.wait_until(lock, deadline, [&progress] { return progress->remaining_count == 0; });
+		}
+
+		// a write which has not started by now never does
+		for (size_t index = 0; index < commands.size(); ++index)
+		{
+			if (commands[index].first->Withdraw(commands[index].second))
+			{
+				std::lock_guard<std::mutex> lock(progress->mutex);
+				progress->results[write_results[index]] = DisplayRestoreResult{ writes[index].display, true, MonitorStatus::kTimedOut };
+				--progress->remaining_count;
+			}
+		}
+
+		{
+			std::lock_guard<std::mutex> lock(progress->mutex);
+			results = progress->results;
+		}
+
+		for (size_t index = 0; index < writes.size(); ++index)
+		{
+			const DisplayRestoreResult& result = results[write_results[index]];
+			const auto state = service_->displays_.find(result.display);
+			if (result.status == MonitorStatus::kOk && state != service_->displays_.end())
+			{
+				service_->RecordWrite(result.display, state->second, writes[index], result.status);
+			}
+		}
+
+		return results;
+	}
+
+	void BrightnessClient::OnApplicationResume()
+	{
+		is_paused_ = false;
+		is_closed_ = false;
+		BrightnessService::DisplayState* state = nullptr;
+		MonitorStatus status = service_->GetDisplayState(display_, state);
+		if (status != MonitorStatus::kOk)
+		{
+			std::cout << GetMonitorStatusMessage(status) << std::endl;
+			return;
+		}
+
+		// the user may have changed the brightness while no engine was overriding it
+		if (state->overrides.empty())
+		{
+			status = service_->ProbeDisplay(display_, *state);
+			if (status != MonitorStatus::kOk)
+			{
+				std::cout << GetMonitorStatusMessage(status) << std::endl;
+				return;
+			}
+
+			service_->NotifySystemScreenBrightnessChanged(display_, *state);
+		}
+
+		if (application_screen_brightness_ == -1)
+		{
+			return;
+		}
+
+		std::vector<BrightnessClient*>& overrides = state->overrides;
+		overrides.erase(std::remove(overrides.begin(), overrides.end(), this), overrides.end());
+		overrides.push_back(this);
+		++override_generation_;
+		status = service_->ApplyBrightness(display_, *state);
+		if (status != MonitorStatus::kOk)
+		{
+			std::cout << GetMonitorStatusMessage(status) << std::endl;
+		}
+	}
+
+	void BrightnessClient::BeginOverride(BrightnessService::DisplayState& state, const long brightness, ApplicationBrightnessWrite& write)
+	{
+		write.brightness_ = brightness;
+		write.previous_brightness_ = application_screen_brightness_;
+		write.generation_ = ++override_generation_;
+		application_screen_brightness_ = brightness;
+		if (is_paused_)
+		{
+			return;
+		}
+
+		// the most recent override is shown
+		std::vector<BrightnessClient*>& overrides = state.overrides;
+		const auto previous_position = std::find(overrides.begin(), overrides.end(), this);
+		write.was_overriding_ = previous_position != overrides.end();
+		write.previous_index_ = previous_position - overrides.begin();
+		if (write.was_overriding_)
+		{
+			std::rotate(previous_position, previous_position + 1, overrides.end());
+		}
+		else
+		{
+			overrides.push_back(this);
+		}
+	}
+
+	void BrightnessClient::RollBackOverride(BrightnessService::DisplayState& state, const ApplicationBrightnessWrite& write)
+	{
+		if (write.generation_ != override_generation_)
+		{
+			return;
+		}
+
+		// the override the write replaced is the latest again, so its own write can roll back in turn
+		--override_generation_;
+		application_screen_brightness_ = write.previous_brightness_;
+
+		// paused meanwhile, which removed the override
+		std::vector<BrightnessClient*>& overrides = state.overrides;
+		const auto position = std::find(overrides.begin(), overrides.end(), this);
+		if (position == overrides.end())
+		{
+			return;
+		}
+
+		if (!write.was_overriding_)
+		{
+			overrides.erase(position);
+			return;
+		}
+
+		// back where it was, under the overrides applied since
+		const auto previous_position = overrides.begin() + std::min<std::ptrdiff_t>(write.previous_index_, overrides.end() - overrides.begin() - 1);
+		if (previous_position < position)
+		{
+			std::rotate(previous_position, position, position + 1);
+		}
+		else
+		{
+			std::rotate(position, position + 1, previous_position + 1);
+		}
+	}
+
+	void BrightnessClient::HandleApplicationScreenBrightnessChanged(const BrightnessService::DisplayState& state, const long brightness) const
+	{
+		service_->PublishDisplayState(display_, state);
+		if (!application_screen_brightness_changed_callback_)
+		{
+			return;
+		}
+
+		application_screen_brightness_changed_callback_(GetPercentage(state.minimum_brightness, state.maximum_brightness, brightness));
+	}
+}
@@ -0,0 +1,648 @@
+#include "../include/screen_brightness_windows/broker_monitor_backend.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <utility>
+
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+namespace screen_brightness
+{
+	namespace
+	{
+		struct BrightnessOutputs
+		{
+			long& minimum_brightness;
+
+			long& brightness;
+
+			long& maximum_brightness;
+		};
+
+		struct VcpFeatureOutputs
+		{
+			unsigned long& current_value;
+
+			unsigned long& maximum_value;
+		};
+
+		bool ParseBrightness(BrokerFrameReader& reader, void* outputs)
+		{
+			std::int64_t minimum_brightness = 0;
+			std::int64_t brightness = 0;
+			std::int64_t maximum_brightness = 0;
+			if (!reader.Read(minimum_brightness) || !reader.Read(brightness) || !reader.Read(maximum_brightness))
+			{
+				return false;
+			}
+
+			auto& brightness_outputs = *static_cast<BrightnessOutputs*>(outputs);
+			brightness_outputs.minimum_brightness = static_cast<long>(minimum_brightness);
+			brightness_outputs.brightness = static_cast<long>(brightness);
+			brightness_outputs.maximum_brightness = static_cast<long>(maximum_brightness);
+			return true;
+		}
+
+		bool ParseVcpFeature(BrokerFrameReader& reader, void* outputs)
+		{
+			std::uint64_t current_value = 0;
+			std::uint64_t maximum_value = 0;
+			if (!reader.Read(current_value) || !reader.Read(maximum_value))
+			{
+				return false;
+			}
+
+			auto& feature_outputs = *static_cast<VcpFeatureOutputs*>(outputs);
+			feature_outputs.current_value = static_cast<unsigned long>(current_value);
+			feature_outputs.maximum_value = static_cast<unsigned long>(maximum_value);
+			return true;
+		}
+
+		bool ParseDisplays(BrokerFrameReader& reader, void* outputs)
+		{
+			auto& displays = *static_cast<std::vector<DisplayInfo>*>(outputs);
+			std::uint32_t count = 0;
+			if (!reader.Read(count))
+			{
+				return false;
+			}
+
+			displays.clear();
+			for (std::uint32_t index = 0; index < count; ++index)
+			{
+				std::uint64_t handle = 0;
+				DisplayInfo info;
+				if (!reader.Read(handle) || !reader.ReadString(info.id) || !reader.ReadString(info.name))
+				{
+					return false;
+				}
+
+				info.handle = static_cast<DisplayHandle>(handle);
+				displays.push_back(std::move(info));
+			}
+
+			return true;
+		}
+
+		bool ParseDisplayHandle(BrokerFrameReader& reader, void* outputs)
+		{
+			std::uint64_t handle = 0;
+			if (!reader.Read(handle))
+			{
+				return false;
+			}
+
+			*static_cast<DisplayHandle*>(outputs) = static_cast<DisplayHandle>(handle);
+			return true;
+		}
+
+		bool ParseString(BrokerFrameReader& reader, void* outputs)
+		{
+			return reader.ReadString(*static_cast<std::string*>(outputs));
+		}
+
+		bool ParseBytes(BrokerFrameReader& reader, void* outputs)
+		{
+			return reader.ReadBytes(*static_cast<std::vector<std::uint8_t>*>(outputs));
+		}
+
+		bool SendAll(const int socket, const std::uint8_t* data, std::size_t size)
+		{
+			while (size > 0)
+			{
+				const ssize_t sent = send(socket, data, size, MSG_NOSIGNAL);
+				if (sent < 0)
+				{
+					if (errno == EINTR)
+					{
+						continue;
+					}
+
+					return false;
+				}
+
+				data += sent;
+				size -= static_cast<std::size_t>(sent);
+			}
+
+			return true;
+		}
+
+		BrokerRequest MakeRequest(const DisplayHandle display, const std::int64_t value = 0, const VcpCode code = 0)
+		{
+			BrokerRequest request;
+			request.display = display;
+			request.value = value;
+			request.code = code;
+			return request;
+		}
+	}
+
+	struct BrokerMonitorBackend::Connection
+	{
+		explicit Connection(const int socket) : socket(socket)
+		{
+		}
+
+		Connection(const Connection&) = delete;
+
+		Connection& operator=(const Connection&) = delete;
+
+		~Connection()
+		{
+			close(socket);
+		}
+
+		// closed with the last reference, so a sender never writes to a reused descriptor
+		const int socket;
+
+		// serialises whole frames
+		std::mutex send_mutex;
+	};
+
+	BrokerMonitorBackend::BrokerMonitorBackend(std::string path, Clock& clock, FallbackFactory create_fallback) :
+		path_(std::move(path)), clock_(clock), create_fallback_(std::move(create_fallback))
+	{
+	}
+
+	BrokerMonitorBackend::~BrokerMonitorBackend()
+	{
+		Disconnect();
+	}
+
+	MonitorStatus BrokerMonitorBackend::Connect()
+	{
+		std::thread previous_reader;
+		{
+			std::lock_guard<std::mutex> lock(mutex_);
+			if (connection_ != nullptr)
+			{
+				return MonitorStatus::kOk;
+			}
+
+			previous_reader = std::move(reader_);
+		}
+
+		// the reader of a lost connection has dropped it and is exiting
+		if (previous_reader.joinable())
+		{
+			previous_reader.join();
+		}
+
+		sockaddr_un address{};
+		address.sun_family = AF_UNIX;
+		const int socket = path_.size() < sizeof(address.sun_path) ? ::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0) : -1;
+		if (socket != -1)
+		{
+			path_.copy(address.sun_path, path_.size());
+		}
+
+		if (socket == -1 || connect(socket, reinterpret_cast<const sockaddr*>(&address), sizeof(address)) != 0)
+		{
+			if (socket != -1)
+			{
+				close(socket);
+			}
+
+			std::lock_guard<std::mutex> lock(mutex_);
+			next_connect_time_ = clock_.Now() + kReconnectInterval;
+			return MonitorStatus::kBrokerFailed;
+		}
+
+		auto connection = std::make_shared<Connection>(socket);
+		bool is_subscribing;
+		{
+			std::lock_guard<std::mutex> lock(mutex_);
+			if (connection_ != nullptr)
+			{
+				// another caller has connected meanwhile
+				return MonitorStatus::kOk;
+			}
+
+			connection_ = connection;
+			reader_ = std::thread([this, connection] { RunReader(connection); });
+			is_subscribing = brightness_changed_callback_ != nullptr;
+		}
+
+		if (is_subscribing)
+		{
+			(void)Submit(BrokerMessageType::kSubscribe, BrokerRequest{}, nullptr);
+		}
+
+		return MonitorStatus::kOk;
+	}
+
+	void BrokerMonitorBackend::Disconnect()
+	{
+		std::thread reader;
+		{
+			std::lock_guard<std::mutex> lock(mutex_);
+			if (connection_ != nullptr)
+			{
+				shutdown(connection_->socket, SHUT_RDWR);
+			}
+
+			reader = std::move(reader_);
+		}
+
+		// the reader drops the connection as it sees the end of it
+		if (reader.joinable())
+		{
+			reader.join();
+		}
+	}
+
+	bool BrokerMonitorBackend::is_connected() const
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+		return connection_ != nullptr;
+	}
+
+	bool BrokerMonitorBackend::is_using_fallback() const
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+		return connection_ == nullptr && create_fallback_ != nullptr;
+	}
+
+	MonitorStatus BrokerMonitorBackend::SetBrightnessChangedCallback(BrightnessChangedCallback callback)
+	{
+		{
+			std::lock_guard<std::mutex> lock(mutex_);
+			brightness_changed_callback_ = std::move(callback);
+		}
+
+		// subscribing again after a reconnect is up to Connect
+		return Call(BrokerMessageType::kSubscribe, BrokerRequest{}, nullptr, nullptr);
+	}
+
+	void BrokerMonitorBackend::GetScreenBrightnessAsync(const DisplayHandle display, BrightnessCompletion completion)
+	{
+		if (Submit(BrokerMessageType::kGetScreenBrightness, MakeRequest(display), [completion](MonitorStatus status, BrokerFrameReader& reader)
+			{
+				long minimum_brightness = 0;
+				long brightness = 0;
+				long maximum_brightness = 0;
+				BrightnessOutputs outputs{ minimum_brightness, brightness, maximum_brightness };
+				if (status == MonitorStatus::kOk && !ParseBrightness(reader, &outputs))
+				{
+					status = MonitorStatus::kBrokerFailed;
+				}
+
+				completion(status, minimum_brightness, brightness, maximum_brightness);
+			}))
+		{
+			return;
+		}
+
+		long minimum_brightness = 0;
+		long brightness = 0;
+		long maximum_brightness = 0;
+		MonitorBackend* fallback = GetFallback();
+		const MonitorStatus status = fallback == nullptr ? MonitorStatus::kBrokerFailed :
+			fallback->GetScreenBrightness(display, minimum_brightness, brightness, maximum_brightness);
+		completion(status, minimum_brightness, brightness, maximum_brightness);
+	}
+
+	void BrokerMonitorBackend::SetScreenBrightnessAsync(const DisplayHandle display, const long screen_brightness, Completion completion)
+	{
+		if (Submit(BrokerMessageType::kSetScreenBrightness, MakeRequest(display, screen_brightness), [completion](const MonitorStatus status, BrokerFrameReader&)
+			{
+				completion(status);
+			}))
+		{
+			return;
+		}
+
+		MonitorBackend* fallback = GetFallback();
+		completion(fallback == nullptr ? MonitorStatus::kBrokerFailed : fallback->SetScreenBrightness(display, screen_brightness));
+	}
+
+	MonitorStatus BrokerMonitorBackend::EnumerateDisplays(std::vector<DisplayInfo>& displays)
+	{
+		const MonitorStatus status = Call(BrokerMessageType::kEnumerateDisplays, BrokerRequest{}, ParseDisplays, &displays);
+		MonitorBackend* fallback = status == MonitorStatus::kBrokerFailed ? GetFallback() : nullptr;
+		return fallback == nullptr ? status : fallback->EnumerateDisplays(displays);
+	}
+
+	DisplayHandle BrokerMonitorBackend::GetPrimaryDisplay()
+	{
+		DisplayHandle display = 0;
+		if (Call(BrokerMessageType::kGetPrimaryDisplay, BrokerRequest{}, ParseDisplayHandle, &display) != MonitorStatus::kBrokerFailed)
+		{
+			return display;
+		}
+
+		MonitorBackend* fallback = GetFallback();
+		return fallback == nullptr ? 0 : fallback->GetPrimaryDisplay();
+	}
+
+	MonitorStatus BrokerMonitorBackend::GetScreenBrightness(const DisplayHandle display, long& minimum_screen_brightness, long& screen_brightness, long& maximum_screen_brightness)
+	{
+		BrightnessOutputs outputs{ minimum_screen_brightness, screen_brightness, maximum_screen_brightness };
+		const MonitorStatus status = Call(BrokerMessageType::kGetScreenBrightness, MakeRequest(display), ParseBrightness, &outputs);
+		MonitorBackend* fallback = status == MonitorStatus::kBrokerFailed ? GetFallback() : nullptr;
+		return fallback == nullptr ? status :
+			fallback->GetScreenBrightness(display, minimum_screen_brightness, screen_brightness, maximum_screen_brightness);
+	}
+
+	MonitorStatus BrokerMonitorBackend::SetScreenBrightness(const DisplayHandle display, const long screen_brightness)
+	{
+		const MonitorStatus status = Call(BrokerMessageType::kSetScreenBrightness, MakeRequest(display, screen_brightness), nullptr, nullptr);
+		MonitorBackend* fallback = status == MonitorStatus::kBrokerFailed ? GetFallback() : nullptr;
+		return fallback == nullptr ? status : fallback->SetScreenBrightness(display, screen_brightness);
+	}
+
+	MonitorStatus BrokerMonitorBackend::GetVcpFeature(const DisplayHandle display, const VcpCode code, unsigned long& current_value, unsigned long& maximum_value)
+	{
+		VcpFeatureOutputs outputs{ current_value, maximum_value };
+		const MonitorStatus status = Call(BrokerMessageType::kGetVcpFeature, MakeRequest(display, 0, code), ParseVcpFeature, &outputs);
+		MonitorBackend* fallback = status == MonitorStatus::kBrokerFailed ? GetFallback() : nullptr;
+		return fallback == nullptr ? status : fallback->GetVcpFeature(display, code, current_value, maximum_value);
+	}
+
+	MonitorStatus BrokerMonitorBackend::SetVcpFeature(const DisplayHandle display, const VcpCode code, const unsigned long value)
+	{
+		const MonitorStatus status = Call(BrokerMessageType::kSetVcpFeature, MakeRequest(display, static_cast<std::int64_t>(value), code), nullptr, nullptr);
+		MonitorBackend* fallback = status == MonitorStatus::kBrokerFailed ? GetFallback() : nullptr;
+		return fallback == nullptr ? status : fallback->SetVcpFeature(display, code, value);
+	}
+
+	MonitorStatus BrokerMonitorBackend::GetCapabilitiesString(const DisplayHandle display, std::string& capabilities)
+	{
+		const MonitorStatus status = Call(BrokerMessageType::kGetCapabilitiesString, MakeRequest(display), ParseString, &capabilities);
+		MonitorBackend* fallback = status == MonitorStatus::kBrokerFailed ? GetFallback() : nullptr;
+		return fallback == nullptr ? status : fallback->GetCapabilitiesString(display, capabilities);
+	}
+
+	MonitorStatus BrokerMonitorBackend::GetEdid(const DisplayHandle display, std::vector<std::uint8_t>& edid)
+	{
+		const MonitorStatus status = Call(BrokerMessageType::kGetEdid, MakeRequest(display), ParseBytes, &edid);
+		MonitorBackend* fallback = status == MonitorStatus::kBrokerFailed ? GetFallback() : nullptr;
+		return fallback == nullptr ? status : fallback->GetEdid(display, edid);
+	}
+
+	bool BrokerMonitorBackend::EnsureConnected(std::unique_lock<std::mutex>& lock)
+	{
+		if (connection_ != nullptr)
+		{
+			return true;
+		}
+
+		if (clock_.Now() < next_connect_time_)
+		{
+			return false;
+		}
+
+		lock.unlock();
+		(void)Connect();
+		lock.lock();
+		return connection_ != nullptr;
+	}
+
+	MonitorStatus BrokerMonitorBackend::Call(const BrokerMessageType type, const BrokerRequest& request, const ResponseParser parse, void* outputs)
+	{
+		std::unique_lock<std::mutex> lock(mutex_);
+		if (!EnsureConnected(lock))
+		{
+			return MonitorStatus::kBrokerFailed;
+		}
+
+		PendingCall* call = Send(lock, type, request, parse, outputs, nullptr);
+		if (call == nullptr)
+		{
+			return MonitorStatus::kBrokerFailed;
+		}
+
+		condition_.wait(lock, [call] { return call->is_done; });
+		const MonitorStatus status = call->status;
+		call->id = 0;
+		condition_.notify_all();
+		return status;
+	}
+
+	bool BrokerMonitorBackend::Submit(const BrokerMessageType type, const BrokerRequest& request, ResponseCompletion completion)
+	{
+		std::unique_lock<std::mutex> lock(mutex_);
+		if (!EnsureConnected(lock))
+		{
+			return false;
+		}
+
+		// a call nobody waits for needs a completion to free its slot
+		if (completion == nullptr)
+		{
+			completion = [](MonitorStatus, BrokerFrameReader&) {};
+		}
+
+		return Send(lock, type, request, nullptr, nullptr, std::move(completion)) != nullptr;
+	}
+
+	BrokerMonitorBackend::PendingCall* BrokerMonitorBackend::Send(std::unique_lock<std::mutex>& lock, const BrokerMessageType type,
+		const BrokerRequest& request, const ResponseParser parse, void* outputs, ResponseCompletion completion)
+	{
+		PendingCall* call = nullptr;
+		condition_.wait(lock, [this, &call]
+			{
+				const auto free_call = std::find_if(calls_.begin(), calls_.end(), [](const PendingCall& pending_call) { return pending_call.id == 0; });
+				call = free_call == calls_.end() ? nullptr : &*free_call;
+				return connection_ == nullptr || call != nullptr;
+			});
+		if (connection_ == nullptr)
+		{
+			return nullptr;
+		}
+
+		// 0 marks a free slot and a notification
+		call->id = next_id_++;
+		if (next_id_ == 0)
+		{
+			next_id_ = 1;
+		}
+
+		call->is_done = false;
+		call->status = MonitorStatus::kOk;
+		call->parse = parse;
+		call->outputs = outputs;
+		call->completion = std::move(completion);
+
+		BrokerRequestFrame frame;
+		EncodeBrokerRequest(call->id, type, request, frame);
+		const std::shared_ptr<Connection> connection = connection_;
+		lock.unlock();
+		bool is_sent;
+		{
+			std::lock_guard<std::mutex> send_lock(connection->send_mutex);
+			is_sent = SendAll(connection->socket, frame.data(), frame.size());
+		}
+
+		lock.lock();
+		if (!is_sent && connection_ == connection)
+		{
+			// fails the call along with every other one on the connection
+			DropConnection(lock);
+		}
+
+		return call;
+	}
+
+	void BrokerMonitorBackend::RunReader(const std::shared_ptr<Connection> connection)
+	{
+		// sized so that steady traffic never reallocates
+		std::vector<std::uint8_t> input;
+		input.reserve(64 * 1024);
+		std::uint8_t buffer[16384];
+		bool is_valid = true;
+		while (is_valid)
+		{
+			const ssize_t size = recv(connection->socket, buffer, sizeof(buffer), 0);
+			if (size < 0 && errno == EINTR)
+			{
+				continue;
+			}
+
+			if (size <= 0)
+			{
+				break;
+			}
+
+			input.insert(input.end(), buffer, buffer + size);
+			std::size_t position = 0;
+			while (input.size() - position >= kBrokerHeaderSize)
+			{
+				BrokerFrameHeader header;
+				if (!DecodeBrokerFrameHeader(input.data() + position, header))
+				{
+					is_valid = false;
+					break;
+				}
+
+				if (input.size() - position - kBrokerHeaderSize < header.size)
+				{
+					break;
+				}
+
+				BrokerFrameReader reader(input.data() + position + kBrokerHeaderSize, header.size);
+				position += kBrokerHeaderSize + header.size;
+				Dispatch(header, reader);
+			}
+
+			input.erase(input.begin(), input.begin() + static_cast<std::ptrdiff_t>(position));
+		}
+
+		std::unique_lock<std::mutex> lock(mutex_);
+		if (connection_ == connection)
+		{
+			DropConnection(lock);
+		}
+	}
+
+	void BrokerMonitorBackend::Dispatch(const BrokerFrameHeader& header, BrokerFrameReader& reader)
+	{
+		std::unique_lock<std::mutex> lock(mutex_);
+		if (header.type == BrokerMessageType::kBrightnessChanged)
+		{
+			std::uint64_t display = 0;
+			std::int64_t brightness = 0;
+			if (brightness_changed_callback_ == nullptr || !reader.Read(display) || !reader.Read(brightness))
+			{
+				return;
+			}
+
+			const BrightnessChangedCallback callback = brightness_changed_callback_;
+			lock.unlock();
+			callback(static_cast<DisplayHandle>(display), static_cast<long>(brightness));
+			return;
+		}
+
+		const auto call = std::find_if(calls_.begin(), calls_.end(), [&header](const PendingCall& pending_call)
+			{
+				return pending_call.id == header.id && !pending_call.is_done;
+			});
+		if (header.id == 0 || call == calls_.end())
+		{
+			return;
+		}
+
+		auto status = static_cast<MonitorStatus>(header.status);
+		if (call->completion != nullptr)
+		{
+			ResponseCompletion completion = std::move(call->completion);
+			call->completion = nullptr;
+			call->id = 0;
+			lock.unlock();
+			condition_.notify_all();
+			completion(status, reader);
+			return;
+		}
+
+		// the caller is blocked in Call, so its variables are safe to write
+		if (status == MonitorStatus::kOk && call->parse != nullptr && !call->parse(reader, call->outputs))
+		{
+			status = MonitorStatus::kBrokerFailed;
+		}
+
+		call->status = status;
+		call->is_done = true;
+		lock.unlock();
+		condition_.notify_all();
+	}
+
+	void BrokerMonitorBackend::DropConnection(std::unique_lock<std::mutex>& lock)
+	{
+		if (connection_ != nullptr)
+		{
+			shutdown(connection_->socket, SHUT_RDWR);
+			connection_.reset();
+		}
+
+		// a broker which has just restarted is tried again straight away
+		next_connect_time_ = clock_.Now();
+		std::vector<ResponseCompletion> completions;
+		for (PendingCall& call : calls_)
+		{
+			if (call.id == 0 || call.is_done)
+			{
+				continue;
+			}
+
+			if (call.completion != nullptr)
+			{
+				completions.push_back(std::move(call.completion));
+				call.completion = nullptr;
+				call.id = 0;
+				continue;
+			}
+
+			call.status = MonitorStatus::kBrokerFailed;
+			call.is_done = true;
+		}
+
+		condition_.notify_all();
+		if (completions.empty())
+		{
+			return;
+		}
+
+		lock.unlock();
+		BrokerFrameReader empty_reader(nullptr, 0);
+		for (const ResponseCompletion& completion : completions)
+		{
+			completion(MonitorStatus::kBrokerFailed, empty_reader);
+		}
+
+		lock.lock();
+	}
+
+	MonitorBackend* BrokerMonitorBackend::GetFallback()
+	{
+		std::lock_guard<std::mutex> lock(fallback_mutex_);
+		if (fallback_ == nullptr && create_fallback_ != nullptr)
+		{
+			fallback_ = create_fallback_();
+		}
+
+		return fallback_.get();
+	}
+}
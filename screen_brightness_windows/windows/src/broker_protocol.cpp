@@ -0,0 +1,103 @@
+#include "../include/screen_brightness_windows/broker_protocol.h"
+
+#include <cstdlib>
+
+#include <unistd.h>
+
+namespace screen_brightness
+{
+	void EncodeBrokerRequest(const std::uint32_t id, const BrokerMessageType type, const BrokerRequest& request, BrokerRequestFrame& frame)
+	{
+		BrokerFrameHeader header;
+		header.size = sizeof(BrokerRequest);
+		header.id = id;
+		header.type = type;
+		std::memcpy(frame.data(), &header, kBrokerHeaderSize);
+		std::memcpy(frame.data() + kBrokerHeaderSize, &request, sizeof(BrokerRequest));
+	}
+
+	bool DecodeBrokerFrameHeader(const std::uint8_t* data, BrokerFrameHeader& header)
+	{
+		std::memcpy(&header, data, kBrokerHeaderSize);
+		return header.size <= kBrokerMaximumPayloadSize;
+	}
+
+	std::string GetDefaultBrokerSocketPath()
+	{
+		const char* runtime_directory = std::getenv("XDG_RUNTIME_DIR");
+		if (runtime_directory != nullptr && *runtime_directory != '\0')
+		{
+			return std::string(runtime_directory) + "/screen_brightness.sock";
+		}
+
+		return "/tmp/screen_brightness-" + std::to_string(getuid()) + ".sock";
+	}
+
+	BrokerFrameWriter::BrokerFrameWriter(std::vector<std::uint8_t>& buffer, const std::uint32_t id, const BrokerMessageType type, const MonitorStatus status) :
+		buffer_(buffer), start_(buffer.size())
+	{
+		BrokerFrameHeader header;
+		header.id = id;
+		header.type = type;
+		header.status = static_cast<std::uint8_t>(status);
+		const auto* bytes = reinterpret_cast<const std::uint8_t*>(&header);
+		buffer_.insert(buffer_.end(), bytes, bytes + kBrokerHeaderSize);
+	}
+
+	void BrokerFrameWriter::WriteBytes(const std::uint8_t* data, const std::size_t size)
+	{
+		Write(static_cast<std::uint32_t>(size));
+		buffer_.insert(buffer_.end(), data, data + size);
+	}
+
+	void BrokerFrameWriter::WriteString(const std::string_view text)
+	{
+		WriteBytes(reinterpret_cast<const std::uint8_t*>(text.data()), text.size());
+	}
+
+	void BrokerFrameWriter::Finish()
+	{
+		const auto size = static_cast<std::uint32_t>(buffer_.size() - start_ - kBrokerHeaderSize);
+		std::memcpy(buffer_.data() + start_, &size, sizeof(size));
+	}
+
+	bool BrokerFrameReader::ReadBytes(std::vector<std::uint8_t>& bytes)
+	{
+		std::uint32_t size = 0;
+		const std::uint8_t* data = ReadField(size);
+		if (data == nullptr)
+		{
+			return false;
+		}
+
+		bytes.assign(data, data + size);
+		return true;
+	}
+
+	bool BrokerFrameReader::ReadString(std::string& text)
+	{
+		std::uint32_t size = 0;
+		const std::uint8_t* data = ReadField(size);
+		if (data == nullptr)
+		{
+			return false;
+		}
+
+		text.assign(reinterpret_cast<const char*>(data), size);
+		return true;
+	}
+
+	const std::uint8_t* BrokerFrameReader::ReadField(std::uint32_t& size)
+	{
+		const std::size_t position = position_;
+		if (!Read(size) || size_ - position_ < size)
+		{
+			position_ = position;
+			return nullptr;
+		}
+
+		const std::uint8_t* data = data_ + position_;
+		position_ += size;
+		return data;
+	}
+}
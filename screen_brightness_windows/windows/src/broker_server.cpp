@@ -0,0 +1,673 @@
+#include "../include/screen_brightness_windows/broker_server.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <utility>
+
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+namespace screen_brightness
+{
+	namespace
+	{
+		// a client which stops reading is dropped instead of stalling the bus threads
+		constexpr timeval kSendTimeout{ 1, 0 };
+
+		bool SendAll(const int socket, const std::uint8_t* data, std::size_t size)
+		{
+			while (size > 0)
+			{
+				const ssize_t sent = send(socket, data, size, MSG_NOSIGNAL);
+				if (sent < 0)
+				{
+					if (errno == EINTR)
+					{
+						continue;
+					}
+
+					return false;
+				}
+
+				data += sent;
+				size -= static_cast<std::size_t>(sent);
+			}
+
+			return true;
+		}
+
+		bool ToSocketAddress(const std::string& path, sockaddr_un& address)
+		{
+			address = sockaddr_un{};
+			address.sun_family = AF_UNIX;
+			if (path.empty() || path.size() >= sizeof(address.sun_path))
+			{
+				return false;
+			}
+
+			path.copy(address.sun_path, path.size());
+			return true;
+		}
+
+		// The status of a bus operation on a display the backend does not know, or MonitorStatus::kOk for messages
+		// which do not go over a bus.
+		MonitorStatus GetUnknownDisplayStatus(const BrokerMessageType type)
+		{
+			switch (type)
+			{
+			case BrokerMessageType::kGetScreenBrightness:
+				return MonitorStatus::kGetBrightnessFailed;
+
+			case BrokerMessageType::kSetScreenBrightness:
+				return MonitorStatus::kSetBrightnessFailed;
+
+			case BrokerMessageType::kGetVcpFeature:
+				return MonitorStatus::kGetVcpFeatureFailed;
+
+			case BrokerMessageType::kSetVcpFeature:
+				return MonitorStatus::kSetVcpFeatureFailed;
+
+			case BrokerMessageType::kGetCapabilitiesString:
+				return MonitorStatus::kGetCapabilitiesFailed;
+
+			default:
+				return MonitorStatus::kOk;
+			}
+		}
+	}
+
+	struct BrokerServer::Connection
+	{
+		explicit Connection(const int socket) : socket(socket)
+		{
+		}
+
+		Connection(const Connection&) = delete;
+
+		Connection& operator=(const Connection&) = delete;
+
+		~Connection()
+		{
+			close(socket);
+		}
+
+		// Called by the loop and by the scheduler threads; one frame is sent as a whole.
+		void Send(const std::vector<std::uint8_t>& frame)
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			if (is_closed)
+			{
+				return;
+			}
+
+			if (!SendAll(socket, frame.data(), frame.size()))
+			{
+				is_closed = true;
+				shutdown(socket, SHUT_RDWR);
+			}
+		}
+
+		void Close()
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			is_closed = true;
+			shutdown(socket, SHUT_RDWR);
+		}
+
+		[[nodiscard]] bool IsClosed()
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			return is_closed;
+		}
+
+		// closed only with the last reference, so a late completion never writes to a reused descriptor
+		const int socket;
+
+		// bytes received but not yet a whole frame, only used by the loop
+		std::vector<std::uint8_t> input;
+
+		std::mutex mutex;
+
+		bool is_closed = false;
+	};
+
+	struct BrokerServer::PendingRead
+	{
+		std::vector<std::pair<std::shared_ptr<Connection>, std::uint32_t>> waiters;
+
+		long minimum_brightness = 0;
+
+		long brightness = 0;
+
+		long maximum_brightness = 0;
+	};
+
+	BrokerServer::BrokerServer(MonitorBackend& backend, Clock& clock, const Clock::duration minimum_command_interval, const bool is_threaded) :
+		backend_(backend), scheduled_backend_(backend, clock, minimum_command_interval, is_threaded), is_threaded_(is_threaded)
+	{
+	}
+
+	BrokerServer::~BrokerServer()
+	{
+		Stop();
+	}
+
+	MonitorStatus BrokerServer::Listen(const std::string& path)
+	{
+		sockaddr_un address;
+		if (listen_socket_ != -1 || !ToSocketAddress(path, address))
+		{
+			return MonitorStatus::kBrokerFailed;
+		}
+
+		const int listen_socket = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+		if (listen_socket == -1)
+		{
+			return MonitorStatus::kBrokerFailed;
+		}
+
+		// a socket nobody accepts on is left over from a broker which has exited
+		if (connect(listen_socket, reinterpret_cast<const sockaddr*>(&address), sizeof(address)) == 0)
+		{
+			close(listen_socket);
+			return MonitorStatus::kBrokerFailed;
+		}
+
+		unlink(path.c_str());
+		if (bind(listen_socket, reinterpret_cast<const sockaddr*>(&address), sizeof(address)) != 0 ||
+			listen(listen_socket, SOMAXCONN) != 0 || pipe2(wake_pipe_, O_CLOEXEC) != 0)
+		{
+			close(listen_socket);
+			return MonitorStatus::kBrokerFailed;
+		}
+
+		listen_socket_ = listen_socket;
+		path_ = path;
+		return MonitorStatus::kOk;
+	}
+
+	void BrokerServer::RunOnce(const Clock::duration timeout)
+	{
+		if (listen_socket_ == -1)
+		{
+			return;
+		}
+
+		std::vector<pollfd> sockets;
+		sockets.reserve(connections_.size() + 2);
+		sockets.push_back({ wake_pipe_[0], POLLIN, 0 });
+		sockets.push_back({ listen_socket_, POLLIN, 0 });
+		for (const std::shared_ptr<Connection>& connection : connections_)
+		{
+			sockets.push_back({ connection->socket, POLLIN, 0 });
+		}
+
+		const int timeout_milliseconds = timeout == Clock::duration::max() ? -1 :
+			static_cast<int>(std::chrono::ceil<std::chrono::milliseconds>(timeout).count());
+		if (poll(sockets.data(), sockets.size(), timeout_milliseconds) <= 0)
+		{
+			return;
+		}
+
+		if (sockets[0].revents != 0)
+		{
+			char buffer[16];
+			(void)!read(wake_pipe_[0], buffer, sizeof(buffer));
+		}
+
+		// connections accepted now are polled from the next round on
+		const std::size_t connection_count = connections_.size();
+		if (sockets[1].revents != 0)
+		{
+			Accept();
+		}
+
+		for (std::size_t index = 0; index < connection_count; ++index)
+		{
+			if (sockets[index + 2].revents != 0 && !Receive(connections_[index]))
+			{
+				connections_[index]->Close();
+			}
+		}
+
+		const auto closed = std::remove_if(connections_.begin(), connections_.end(), [](const std::shared_ptr<Connection>& connection)
+			{
+				return connection->IsClosed();
+			});
+		if (closed != connections_.end())
+		{
+			connections_.erase(closed, connections_.end());
+			std::lock_guard<std::mutex> lock(mutex_);
+			subscribers_.erase(std::remove_if(subscribers_.begin(), subscribers_.end(), [](const std::shared_ptr<Connection>& connection)
+				{
+					return connection->IsClosed();
+				}), subscribers_.end());
+			metrics_.connection_count = connections_.size();
+		}
+
+		if (!is_threaded_)
+		{
+			for (const DisplayHandle display : busy_displays_)
+			{
+				scheduled_backend_.GetScheduler(display).RunUntilIdle();
+			}
+		}
+
+		busy_displays_.clear();
+	}
+
+	void BrokerServer::Run()
+	{
+		while (true)
+		{
+			{
+				std::lock_guard<std::mutex> lock(mutex_);
+				if (is_stopping_)
+				{
+					return;
+				}
+			}
+
+			RunOnce(Clock::duration::max());
+		}
+	}
+
+	void BrokerServer::Start()
+	{
+		if (!thread_.joinable())
+		{
+			thread_ = std::thread([this] { Run(); });
+		}
+	}
+
+	void BrokerServer::Stop()
+	{
+		{
+			std::lock_guard<std::mutex> lock(mutex_);
+			is_stopping_ = true;
+		}
+
+		if (wake_pipe_[1] != -1)
+		{
+			(void)!write(wake_pipe_[1], "", 1);
+		}
+
+		if (thread_.joinable())
+		{
+			thread_.join();
+		}
+
+		CloseConnections();
+		if (listen_socket_ != -1)
+		{
+			close(listen_socket_);
+			unlink(path_.c_str());
+			listen_socket_ = -1;
+		}
+
+		for (int& pipe_end : wake_pipe_)
+		{
+			if (pipe_end != -1)
+			{
+				close(pipe_end);
+				pipe_end = -1;
+			}
+		}
+	}
+
+	BrokerServerMetrics BrokerServer::metrics() const
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+		return metrics_;
+	}
+
+	void BrokerServer::Accept()
+	{
+		const int socket = accept4(listen_socket_, nullptr, nullptr, SOCK_CLOEXEC);
+		if (socket == -1)
+		{
+			return;
+		}
+
+		setsockopt(socket, SOL_SOCKET, SO_SNDTIMEO, &kSendTimeout, sizeof(kSendTimeout));
+		connections_.push_back(std::make_shared<Connection>(socket));
+		std::lock_guard<std::mutex> lock(mutex_);
+		metrics_.connection_count = connections_.size();
+	}
+
+	bool BrokerServer::Receive(const std::shared_ptr<Connection>& connection)
+	{
+		std::uint8_t buffer[16384];
+		const ssize_t size = recv(connection->socket, buffer, sizeof(buffer), MSG_DONTWAIT);
+		if (size < 0)
+		{
+			return errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR;
+		}
+
+		if (size == 0)
+		{
+			return false;
+		}
+
+		std::vector<std::uint8_t>& input = connection->input;
+		input.insert(input.end(), buffer, buffer + size);
+		std::size_t position = 0;
+		while (input.size() - position >= kBrokerHeaderSize)
+		{
+			BrokerFrameHeader header;
+			if (!DecodeBrokerFrameHeader(input.data() + position, header) || header.size != sizeof(BrokerRequest))
+			{
+				// not a client of this protocol version
+				return false;
+			}
+
+			if (input.size() - position - kBrokerHeaderSize < header.size)
+			{
+				break;
+			}
+
+			BrokerRequest request;
+			std::memcpy(&request, input.data() + position + kBrokerHeaderSize, sizeof(request));
+			position += kBrokerHeaderSize + header.size;
+			Handle(connection, header, request);
+		}
+
+		input.erase(input.begin(), input.begin() + static_cast<std::ptrdiff_t>(position));
+		return !connection->IsClosed();
+	}
+
+	void BrokerServer::Handle(const std::shared_ptr<Connection>& connection, const BrokerFrameHeader& header, const BrokerRequest& request)
+	{
+		{
+			std::lock_guard<std::mutex> lock(mutex_);
+			++metrics_.request_count;
+		}
+
+		const DisplayHandle display = static_cast<DisplayHandle>(request.display);
+		std::vector<std::uint8_t> frame;
+		const MonitorStatus unknown_display_status = GetUnknownDisplayStatus(header.type);
+		if (unknown_display_status != MonitorStatus::kOk && !IsKnownDisplay(display))
+		{
+			// no scheduler, nor its thread, for handles made up by a client
+			BrokerFrameWriter writer(frame, header.id, header.type, unknown_display_status);
+			writer.Finish();
+			connection->Send(frame);
+			return;
+		}
+
+		switch (header.type)
+		{
+		case BrokerMessageType::kEnumerateDisplays:
+		{
+			std::vector<DisplayInfo> displays;
+			const MonitorStatus status = scheduled_backend_.EnumerateDisplays(displays);
+			BrokerFrameWriter writer(frame, header.id, header.type, status);
+			writer.Write(static_cast<std::uint32_t>(displays.size()));
+			for (const DisplayInfo& info : displays)
+			{
+				writer.Write(static_cast<std::uint64_t>(info.handle));
+				writer.WriteString(info.id);
+				writer.WriteString(info.name);
+			}
+
+			writer.Finish();
+			break;
+		}
+
+		case BrokerMessageType::kGetPrimaryDisplay:
+		{
+			BrokerFrameWriter writer(frame, header.id, header.type, MonitorStatus::kOk);
+			writer.Write(static_cast<std::uint64_t>(scheduled_backend_.GetPrimaryDisplay()));
+			writer.Finish();
+			break;
+		}
+
+		case BrokerMessageType::kGetEdid:
+		{
+			std::vector<std::uint8_t> edid;
+			const MonitorStatus status = scheduled_backend_.GetEdid(display, edid);
+			BrokerFrameWriter writer(frame, header.id, header.type, status);
+			writer.WriteBytes(edid.data(), edid.size());
+			writer.Finish();
+			break;
+		}
+
+		case BrokerMessageType::kGetScreenBrightness:
+			HandleGetScreenBrightness(connection, header.id, display);
+			return;
+
+		case BrokerMessageType::kSetScreenBrightness:
+		case BrokerMessageType::kSetVcpFeature:
+			HandleWrite(connection, header, request);
+			return;
+
+		case BrokerMessageType::kGetVcpFeature:
+		case BrokerMessageType::kGetCapabilitiesString:
+		{
+			struct Result
+			{
+				unsigned long current_value = 0;
+
+				unsigned long maximum_value = 0;
+
+				std::string capabilities;
+			};
+
+			// the capability string takes the monitor seconds, so queued brightness changes go first
+			const bool is_capabilities = header.type == BrokerMessageType::kGetCapabilitiesString;
+			const auto result = std::make_shared<Result>();
+			busy_displays_.insert(display);
+			scheduled_backend_.GetScheduler(display).Submit(is_capabilities ? DdcPriority::kBackgroundPoll : DdcPriority::kUserWrite,
+				kDdcNoCoalescing, [this, display, code = request.code, is_capabilities, result]
+				{
+					return is_capabilities ? backend_.GetCapabilitiesString(display, result->capabilities) :
+						backend_.GetVcpFeature(display, code, result->current_value, result->maximum_value);
+				}, [connection, header, is_capabilities, result](const MonitorStatus status)
+				{
+					std::vector<std::uint8_t> response;
+					BrokerFrameWriter writer(response, header.id, header.type, status);
+					if (is_capabilities)
+					{
+						writer.WriteString(result->capabilities);
+					}
+					else
+					{
+						writer.Write(static_cast<std::uint64_t>(result->current_value));
+						writer.Write(static_cast<std::uint64_t>(result->maximum_value));
+					}
+
+					writer.Finish();
+					connection->Send(response);
+				});
+			return;
+		}
+
+		case BrokerMessageType::kSubscribe:
+		{
+			{
+				std::lock_guard<std::mutex> lock(mutex_);
+				if (std::find(subscribers_.begin(), subscribers_.end(), connection) == subscribers_.end())
+				{
+					subscribers_.push_back(connection);
+				}
+			}
+
+			BrokerFrameWriter writer(frame, header.id, header.type, MonitorStatus::kOk);
+			writer.Finish();
+			break;
+		}
+
+		default:
+		{
+			BrokerFrameWriter writer(frame, header.id, header.type, MonitorStatus::kUnsupported);
+			writer.Finish();
+			break;
+		}
+		}
+
+		connection->Send(frame);
+	}
+
+	void BrokerServer::HandleGetScreenBrightness(const std::shared_ptr<Connection>& connection, const std::uint32_t id, const DisplayHandle display)
+	{
+		std::shared_ptr<PendingRead> read;
+		{
+			std::lock_guard<std::mutex> lock(mutex_);
+			std::shared_ptr<PendingRead>& pending_read = pending_reads_[display];
+			if (pending_read != nullptr)
+			{
+				// the queued read has not started, so its value is no older than this request
+				pending_read->waiters.emplace_back(connection, id);
+				++metrics_.shared_read_count;
+				return;
+			}
+
+			pending_read = std::make_shared<PendingRead>();
+			pending_read->waiters.emplace_back(connection, id);
+			read = pending_read;
+		}
+
+		busy_displays_.insert(display);
+		scheduled_backend_.GetScheduler(display).Submit(DdcPriority::kUserWrite, kDdcNoCoalescing, [this, display, read]
+			{
+				{
+					// later requests queue a read of their own
+					std::lock_guard<std::mutex> lock(mutex_);
+					pending_reads_.erase(display);
+				}
+
+				return backend_.GetScreenBrightness(display, read->minimum_brightness, read->brightness, read->maximum_brightness);
+			}, [this, display, read](const MonitorStatus status)
+			{
+				{
+					// a read which never ran still has its entry
+					std::lock_guard<std::mutex> lock(mutex_);
+					const auto iterator = pending_reads_.find(display);
+					if (iterator != pending_reads_.end() && iterator->second == read)
+					{
+						pending_reads_.erase(iterator);
+					}
+				}
+
+				std::vector<std::uint8_t> response;
+				for (const auto& [connection, id] : read->waiters)
+				{
+					response.clear();
+					BrokerFrameWriter writer(response, id, BrokerMessageType::kGetScreenBrightness, status);
+					writer.Write(static_cast<std::int64_t>(read->minimum_brightness));
+					writer.Write(static_cast<std::int64_t>(read->brightness));
+					writer.Write(static_cast<std::int64_t>(read->maximum_brightness));
+					writer.Finish();
+					connection->Send(response);
+				}
+			});
+	}
+
+	void BrokerServer::HandleWrite(const std::shared_ptr<Connection>& connection, const BrokerFrameHeader& header, const BrokerRequest& request)
+	{
+		const DisplayHandle display = static_cast<DisplayHandle>(request.display);
+		const bool is_vcp_feature = header.type == BrokerMessageType::kSetVcpFeature;
+		const bool is_brightness = !is_vcp_feature || request.code == kVcpLuminance;
+		busy_displays_.insert(display);
+		scheduled_backend_.GetScheduler(display).Submit(DdcPriority::kUserWrite,
+			is_vcp_feature ? GetVcpWriteCoalescingKey(request.code) : kDdcBrightnessWrite, [this, display, is_vcp_feature, request]
+			{
+				return is_vcp_feature ? backend_.SetVcpFeature(display, request.code, static_cast<unsigned long>(request.value)) :
+					backend_.SetScreenBrightness(display, static_cast<long>(request.value));
+			}, [this, connection, header, display, is_brightness, value = static_cast<long>(request.value)](const MonitorStatus status)
+			{
+				if (status == MonitorStatus::kPreempted)
+				{
+					std::lock_guard<std::mutex> lock(mutex_);
+					++metrics_.coalesced_write_count;
+				}
+
+				std::vector<std::uint8_t> response;
+				BrokerFrameWriter writer(response, header.id, header.type, status);
+				writer.Finish();
+				connection->Send(response);
+				if (status == MonitorStatus::kOk && is_brightness)
+				{
+					Notify(*connection, display, value);
+				}
+			});
+	}
+
+	void BrokerServer::Notify(const Connection& origin, const DisplayHandle display, const long brightness)
+	{
+		std::vector<std::shared_ptr<Connection>> subscribers;
+		{
+			std::lock_guard<std::mutex> lock(mutex_);
+			for (const std::shared_ptr<Connection>& subscriber : subscribers_)
+			{
+				if (subscriber.get() != &origin)
+				{
+					subscribers.push_back(subscriber);
+				}
+			}
+
+			metrics_.notification_count += subscribers.size();
+		}
+
+		if (subscribers.empty())
+		{
+			return;
+		}
+
+		std::vector<std::uint8_t> frame;
+		BrokerFrameWriter writer(frame, 0, BrokerMessageType::kBrightnessChanged, MonitorStatus::kOk);
+		writer.Write(static_cast<std::uint64_t>(display));
+		writer.Write(static_cast<std::int64_t>(brightness));
+		writer.Finish();
+		for (const std::shared_ptr<Connection>& subscriber : subscribers)
+		{
+			subscriber->Send(frame);
+		}
+	}
+
+	void BrokerServer::CloseConnections()
+	{
+		for (const std::shared_ptr<Connection>& connection : connections_)
+		{
+			connection->Close();
+		}
+
+		connections_.clear();
+		{
+			std::lock_guard<std::mutex> lock(mutex_);
+			subscribers_.clear();
+			metrics_.connection_count = 0;
+		}
+
+		// finish the queued commands while the server they complete into still exists
+		for (const DisplayHandle display : known_displays_)
+		{
+			scheduled_backend_.RemoveScheduler(display);
+		}
+	}
+
+	bool BrokerServer::IsKnownDisplay(const DisplayHandle display)
+	{
+		if (known_displays_.count(display) != 0)
+		{
+			return true;
+		}
+
+		std::vector<DisplayInfo> displays;
+		if (display == 0 || scheduled_backend_.EnumerateDisplays(displays) != MonitorStatus::kOk)
+		{
+			return false;
+		}
+
+		for (const DisplayInfo& info : displays)
+		{
+			known_displays_.insert(info.handle);
+		}
+
+		return known_displays_.count(display) != 0;
+	}
+}
@@ -0,0 +1,50 @@
+#include "../include/screen_brightness_windows/clock.h"
+
+#include <thread>
+
+namespace screen_brightness
+{
+	namespace
+	{
+		class SteadyClock final : public Clock
+		{
+		public:
+			time_point Now() override
+			{
+				return std::chrono::steady_clock::now();
+			}
+
+			void SleepUntil(const time_point time) override
+			{
+				std::this_thread::sleep_until(time);
+			}
+		};
+	}
+
+	Clock& Clock::Steady()
+	{
+		static SteadyClock clock;
+		return clock;
+	}
+
+	Clock::time_point ManualClock::Now()
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+		return now_;
+	}
+
+	void ManualClock::SleepUntil(const time_point time)
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+		if (time > now_)
+		{
+			now_ = time;
+		}
+	}
+
+	void ManualClock::Advance(const duration duration)
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+		now_ += duration;
+	}
+}
@@ -0,0 +1,69 @@
+#include "../include/screen_brightness_windows/content_adaptive_dimmer.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace screen_brightness
+{
+	ContentAdaptiveDimmer::ContentAdaptiveDimmer(const ContentAdaptiveDimmingConfig& config) : config_(config)
+	{
+	}
+
+	void ContentAdaptiveDimmer::SetConfig(const ContentAdaptiveDimmingConfig& config)
+	{
+		config_ = config;
+		has_frame_ = false;
+		smoothed_brightness_ = -1;
+		applied_brightness_ = -1;
+	}
+
+	double ContentAdaptiveDimmer::GetFrameTarget(const LuminanceHistogram& histogram) const
+	{
+		const double range = config_.maximum_luma - config_.knee;
+		const double mean = histogram.GetMean();
+		double dimming = 0;
+		if (range <= 0)
+		{
+			dimming = mean > config_.knee ? 1 : 0;
+		}
+		else
+		{
+			dimming = std::clamp((mean - config_.knee) / range, 0.0, 1.0);
+		}
+
+		return std::clamp(config_.maximum_brightness - (config_.maximum_brightness - config_.minimum_brightness) * dimming, 0.0, 1.0);
+	}
+
+	bool ContentAdaptiveDimmer::Update(const LuminanceHistogram& histogram, const Clock::time_point time, double& brightness)
+	{
+		if (histogram.sample_count == 0)
+		{
+			return false;
+		}
+
+		const double target = GetFrameTarget(histogram);
+		if (!has_frame_)
+		{
+			smoothed_brightness_ = target;
+		}
+		else if (time > last_frame_time_)
+		{
+			// the weight of the frame depends on the time since the last one, so the result does not depend on the frame rate
+			const double elapsed = std::chrono::duration<double>(time - last_frame_time_).count();
+			const double time_constant = std::chrono::duration<double>(config_.time_constant).count();
+			const double weight = time_constant > 0 ? 1 - std::exp(-elapsed / time_constant) : 1;
+			smoothed_brightness_ += (target - smoothed_brightness_) * weight;
+		}
+
+		has_frame_ = true;
+		last_frame_time_ = std::max(last_frame_time_, time);
+		if (applied_brightness_ >= 0 && std::abs(smoothed_brightness_ - applied_brightness_) <= config_.deadband)
+		{
+			return false;
+		}
+
+		applied_brightness_ = smoothed_brightness_;
+		brightness = smoothed_brightness_;
+		return true;
+	}
+}
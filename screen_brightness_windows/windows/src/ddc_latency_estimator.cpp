@@ -0,0 +1,57 @@
+#include "../include/screen_brightness_windows/ddc_latency_estimator.h"
+
+#include <algorithm>
+
+namespace screen_brightness
+{
+	namespace
+	{
+		Clock::duration GetPercentile(const Clock::duration* sorted, const std::size_t size, const std::size_t percent)
+		{
+			// nearest rank: the smallest sample which at least percent of the samples do not exceed
+			const std::size_t rank = std::max<std::size_t>(1, (percent * size + 99) / 100);
+			return sorted[rank - 1];
+		}
+	}
+
+	void DdcLatencyEstimator::AddSample(Clock::duration latency)
+	{
+		latency = std::clamp(latency, Clock::duration::zero(), kMaximumSample);
+		window_[sample_count_ % kWindowSize] = latency;
+		if (sample_count_++ == 0)
+		{
+			smoothed_ = latency;
+			deviation_ = latency / 2;
+			return;
+		}
+
+		// gains of 1/8 and 1/4, see RFC 6298
+		const Clock::duration error = latency - smoothed_;
+		deviation_ += ((error < Clock::duration::zero() ? -error : error) - deviation_) / 4;
+		smoothed_ += error / 8;
+	}
+
+	DdcLatencyEstimate DdcLatencyEstimator::GetEstimate() const
+	{
+		DdcLatencyEstimate estimate;
+		estimate.sample_count = sample_count_;
+		if (sample_count_ == 0)
+		{
+			estimate.expected = kInitialLatency;
+			return estimate;
+		}
+
+		const std::size_t size = static_cast<std::size_t>(std::min<std::uint64_t>(sample_count_, kWindowSize));
+		std::array<Clock::duration, kWindowSize> sorted;
+		std::copy_n(window_.begin(), size, sorted.begin());
+		std::sort(sorted.begin(), sorted.begin() + size);
+
+		estimate.smoothed = smoothed_;
+		estimate.deviation = deviation_;
+		estimate.p50 = GetPercentile(sorted.data(), size, 50);
+		estimate.p90 = GetPercentile(sorted.data(), size, 90);
+		estimate.p99 = GetPercentile(sorted.data(), size, 99);
+		estimate.expected = std::max(estimate.smoothed, estimate.p90);
+		return estimate;
+	}
+}
@@ -0,0 +1,416 @@
+#include "../include/screen_brightness_windows/ddc_scheduler.h"
+
+#include <algorithm>
+#include <memory>
+#include <utility>
+
+#include "../include/screen_brightness_windows/operation_context.h"
+
+namespace screen_brightness
+{
+	DdcScheduler::DdcScheduler(Clock& clock, const Clock::duration minimum_command_interval) :
+		clock_(clock), minimum_command_interval_(minimum_command_interval)
+	{
+	}
+
+	DdcScheduler::~DdcScheduler()
+	{
+		Stop();
+
+		// the commands of callers which stopped waiting are never run now
+		for (const Command& command : queue_)
+		{
+			if (command.slot != nullptr && command.slot->is_abandoned)
+			{
+				command.slot->destroy(command.slot->storage);
+			}
+		}
+	}
+
+	std::uint64_t DdcScheduler::Submit(const DdcPriority priority, const std::uint32_t coalescing_key, Operation operation, Completion completion)
+	{
+		return SubmitCommand(priority, coalescing_key, std::move(operation), std::move(completion));
+	}
+
+	std::uint64_t DdcScheduler::SubmitCommand(const DdcPriority priority, const std::uint32_t coalescing_key, Operation operation, Completion completion, RunSlot* const slot)
+	{
+		std::vector<Command> preempted_commands;
+		std::size_t preempted_count = 0;
+		bool has_completed_slot = false;
+		bool shed_command = false;
+		std::uint64_t sequence;
+		{
+			std::lock_guard<std::mutex> lock(mutex_);
+			if (coalescing_key != kDdcNoCoalescing)
+			{
+				// compacted in order; preempted slot commands complete in place, the others outside the lock
+				auto kept = queue_.begin();
+				for (auto queued = queue_.begin(); queued != queue_.end(); ++queued)
+				{
+					if (queued->coalescing_key != coalescing_key || queued->priority < priority)
+					{
+						if (kept != queued)
+						{
+							*kept = std::move(*queued);
+						}
+
+						++kept;
+						continue;
+					}
+
+					++preempted_count;
+					if (queued->slot != nullptr)
+					{
+						CompleteSlot(*queued->slot, MonitorStatus::kPreempted);
+						has_completed_slot = true;
+					}
+					else if (queued->completion)
+					{
+						preempted_commands.push_back(std::move(*queued));
+					}
+				}
+
+				queue_.erase(kept, queue_.end());
+				metrics_.preempted_count += preempted_count;
+			}
+
+			// a command which replaces another one does not make the queue longer
+			if (priority != DdcPriority::kUserWrite && preempted_count == 0 &&
+				GetPacing().command_period * static_cast<Clock::duration::rep>(queue_.size() + 1) > kMaximumBacklog)
+			{
+				++metrics_.shed_count;
+				shed_command = true;
+			}
+
+			sequence = next_sequence_++;
+			if (!shed_command)
+			{
+				queue_.push_back(Command{ priority, coalescing_key, sequence, clock_.Now(), std::move(operation), std::move(completion), slot });
+				metrics_.queue_depth = queue_.size();
+				metrics_.maximum_queue_depth = std::max(metrics_.maximum_queue_depth, queue_.size());
+			}
+			else if (slot != nullptr)
+			{
+				CompleteSlot(*slot, MonitorStatus::kPreempted);
+			}
+		}
+
+		if (has_completed_slot)
+		{
+			slot_condition_.notify_all();
+		}
+
+		if (shed_command)
+		{
+			if (completion)
+			{
+				completion(MonitorStatus::kPreempted);
+			}
+
+			return sequence;
+		}
+
+		condition_.notify_all();
+		for (const Command& command : preempted_commands)
+		{
+			command.completion(MonitorStatus::kPreempted);
+		}
+
+		return sequence;
+	}
+
+	bool DdcScheduler::Withdraw(const std::uint64_t sequence)
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+		const auto command = std::find_if(queue_.begin(), queue_.end(), [sequence](const Command& queued) { return queued.sequence == sequence; });
+		if (command == queue_.end())
+		{
+			return false;
+		}
+
+		queue_.erase(command);
+		metrics_.queue_depth = queue_.size();
+		return true;
+	}
+
+	MonitorStatus DdcScheduler::Run(const DdcPriority priority, const std::uint32_t coalescing_key, Operation operation)
+	{
+		return RunInSlot(priority, coalescing_key, operation, false);
+	}
+
+	MonitorStatus DdcScheduler::RunDetachable(const DdcPriority priority, const std::uint32_t coalescing_key, Operation operation)
+	{
+		return RunInSlot(priority, coalescing_key, operation, true);
+	}
+
+	DdcScheduler::RunSlot* DdcScheduler::AcquireSlot()
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+		if (free_slots_.empty())
+		{
+			slots_.push_back(std::make_unique<RunSlot>());
+			// a slot is only ever freed into the list, so it never grows past this
+			free_slots_.reserve(slots_.size());
+			return slots_.back().get();
+		}
+
+		RunSlot* const slot = free_slots_.back();
+		free_slots_.pop_back();
+		return slot;
+	}
+
+	void DdcScheduler::ReleaseSlot(RunSlot* const slot)
+	{
+		slot->destroy(slot->storage);
+		slot->status.reset();
+		std::lock_guard<std::mutex> lock(mutex_);
+		free_slots_.push_back(slot);
+	}
+
+	void DdcScheduler::CompleteSlot(RunSlot& slot, const MonitorStatus status)
+	{
+		if (!slot.is_abandoned)
+		{
+			slot.status = status;
+			return;
+		}
+
+		slot.destroy(slot.storage);
+		slot.status.reset();
+		slot.is_abandoned = false;
+		free_slots_.push_back(&slot);
+	}
+
+	MonitorStatus DdcScheduler::RunAndWait(const DdcPriority priority, const std::uint32_t coalescing_key, RunSlot& slot, const bool is_detachable, bool& is_detached)
+	{
+		OperationContext* const context = OperationContext::Current();
+		if (context != nullptr)
+		{
+			if (const MonitorStatus status = context->GetStatus(); status != MonitorStatus::kOk)
+			{
+				return status;
+			}
+		}
+
+		const std::uint64_t sequence = SubmitCommand(priority, coalescing_key, nullptr, nullptr, &slot);
+		std::unique_lock<std::mutex> lock(mutex_);
+		if (!worker_.joinable())
+		{
+			while (!slot.status.has_value())
+			{
+				lock.unlock();
+				if (context != nullptr)
+				{
+					if (const MonitorStatus status = context->GetStatus(); status != MonitorStatus::kOk && Withdraw(sequence))
+					{
+						return status;
+					}
+				}
+
+				RunNext();
+				lock.lock();
+			}
+
+			return *slot.status;
+		}
+
+		if (context != nullptr)
+		{
+			lock.unlock();
+			context->SetCancelCallback([this]
+				{
+					{
+						std::lock_guard<std::mutex> lock(mutex_);
+					}
+
+					slot_condition_.notify_all();
+				});
+			lock.lock();
+			const auto is_done = [&slot, context] { return slot.status.has_value() || context->is_cancelled(); };
+			if (context->deadline() == OperationContext::kNoDeadline)
+			{
+				slot_condition_.wait(lock, is_done);
+			}
+			else
+			{
+				slot_condition_.wait_until(lock, context->deadline(), is_done);
+			}
+
+			const bool is_completed = slot.status.has_value();
+			lock.unlock();
+			context->SetCancelCallback(nullptr);
+			if (!is_completed)
+			{
+				const MonitorStatus status = context->is_cancelled() ? MonitorStatus::kCancelled : MonitorStatus::kTimedOut;
+				if (Withdraw(sequence))
+				{
+					return status;
+				}
+
+				lock.lock();
+				if (is_detachable && !slot.status.has_value())
+				{
+					slot.is_abandoned = true;
+					is_detached = true;
+					return status;
+				}
+			}
+			else
+			{
+				lock.lock();
+			}
+		}
+
+		slot_condition_.wait(lock, [&slot] { return slot.status.has_value(); });
+		return *slot.status;
+	}
+
+	bool DdcScheduler::RunNext()
+	{
+		std::unique_lock<std::mutex> lock(mutex_);
+		if (queue_.empty())
+		{
+			return false;
+		}
+
+		// wait for the bus outside the lock, so more urgent commands can still be queued meanwhile
+		if (last_command_end_.has_value())
+		{
+			const Clock::time_point bus_free_time = *last_command_end_ + minimum_command_interval_;
+			lock.unlock();
+			if (clock_.Now() < bus_free_time)
+			{
+				clock_.SleepUntil(bus_free_time);
+			}
+
+			lock.lock();
+			if (queue_.empty())
+			{
+				return false;
+			}
+		}
+
+		const auto next = std::min_element(queue_.begin(), queue_.end(), [](const Command& a, const Command& b)
+			{
+				return a.priority != b.priority ? a.priority < b.priority : a.sequence < b.sequence;
+			});
+		Command command = std::move(*next);
+		queue_.erase(next);
+
+		const Clock::time_point start_time = clock_.Now();
+		const Clock::duration wait_time = start_time - command.submit_time;
+		metrics_.queue_depth = queue_.size();
+		metrics_.total_wait_time += wait_time;
+		metrics_.maximum_wait_time = std::max(metrics_.maximum_wait_time, wait_time);
+		lock.unlock();
+
+		const MonitorStatus status = command.slot != nullptr ? command.slot->invoke(command.slot->storage) : command.operation();
+
+		lock.lock();
+		last_command_end_ = clock_.Now();
+		latency_estimator_.AddSample(*last_command_end_ - start_time);
+		++metrics_.executed_count;
+		if (command.slot != nullptr)
+		{
+			CompleteSlot(*command.slot, status);
+			lock.unlock();
+			slot_condition_.notify_all();
+			return true;
+		}
+
+		lock.unlock();
+
+		if (command.completion)
+		{
+			command.completion(status);
+		}
+
+		return true;
+	}
+
+	void DdcScheduler::RunUntilIdle()
+	{
+		while (RunNext())
+		{
+		}
+	}
+
+	void DdcScheduler::Start()
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+		if (worker_.joinable())
+		{
+			return;
+		}
+
+		is_stopping_ = false;
+		worker_ = std::thread(&DdcScheduler::RunWorker, this);
+	}
+
+	void DdcScheduler::Stop()
+	{
+		std::thread worker;
+		{
+			std::lock_guard<std::mutex> lock(mutex_);
+			is_stopping_ = true;
+			worker = std::move(worker_);
+		}
+
+		condition_.notify_all();
+		if (worker.joinable())
+		{
+			worker.join();
+		}
+	}
+
+	Clock::duration DdcScheduler::minimum_command_interval() const
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+		return minimum_command_interval_;
+	}
+
+	void DdcScheduler::SetMinimumCommandInterval(const Clock::duration minimum_command_interval)
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+		minimum_command_interval_ = minimum_command_interval;
+	}
+
+	DdcSchedulerMetrics DdcScheduler::metrics() const
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+		DdcSchedulerMetrics metrics = metrics_;
+		metrics.latency = latency_estimator_.GetEstimate();
+		return metrics;
+	}
+
+	DdcPacing DdcScheduler::pacing() const
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+		return GetPacing();
+	}
+
+	void DdcScheduler::RunWorker()
+	{
+		while (true)
+		{
+			{
+				std::unique_lock<std::mutex> lock(mutex_);
+				condition_.wait(lock, [this] { return is_stopping_ || !queue_.empty(); });
+				if (queue_.empty())
+				{
+					return;
+				}
+			}
+
+			RunNext();
+		}
+	}
+
+	DdcPacing DdcScheduler::GetPacing() const
+	{
+		DdcPacing pacing;
+		pacing.command_period = latency_estimator_.GetEstimate().expected + minimum_command_interval_;
+		pacing.poll_interval = std::max(kMinimumPollInterval, pacing.command_period * kPollBusShare);
+		return pacing;
+	}
+}
@@ -0,0 +1,63 @@
+#include "../include/screen_brightness_windows/display_identity.h"
+
+#include <cstdio>
+
+namespace screen_brightness
+{
+	namespace
+	{
+		// 64 bit FNV-1a
+		constexpr std::uint64_t kOffsetBasis = 0xcbf29ce484222325ULL;
+
+		constexpr std::uint64_t kPrime = 0x100000001b3ULL;
+
+		std::uint64_t Hash(std::uint64_t hash, const std::string_view bytes)
+		{
+			for (const char byte : bytes)
+			{
+				hash = (hash ^ static_cast<std::uint8_t>(byte)) * kPrime;
+			}
+
+			// the length separates adjacent fields
+			return (hash ^ bytes.size()) * kPrime;
+		}
+
+		std::uint64_t Hash(std::uint64_t hash, std::uint64_t value)
+		{
+			for (int index = 0; index < 8; ++index, value >>= 8)
+			{
+				hash = (hash ^ (value & 0xff)) * kPrime;
+			}
+
+			return hash;
+		}
+	}
+
+	DisplayIdentity GetDisplayIdentity(const Edid& edid, const std::string_view id)
+	{
+		std::uint64_t hash = Hash(kOffsetBasis, edid.manufacturer_id());
+		hash = Hash(hash, edid.product_code());
+		hash = Hash(hash, edid.serial_number());
+		hash = Hash(hash, edid.serial_string());
+		hash = Hash(hash, edid.monitor_name());
+		const bool has_serial = (edid.serial_number() != 0 && edid.serial_number() != 0x01010101) || !edid.serial_string().empty();
+		if (!has_serial)
+		{
+			hash = Hash(hash, id);
+		}
+
+		return DisplayIdentity{ hash };
+	}
+
+	DisplayIdentity GetDisplayIdentity(const std::string_view id)
+	{
+		return DisplayIdentity{ Hash(Hash(kOffsetBasis, std::string_view("id")), id) };
+	}
+
+	std::string ToString(const DisplayIdentity identity)
+	{
+		char text[17];
+		std::snprintf(text, sizeof(text), "%016llx", static_cast<unsigned long long>(identity.value));
+		return text;
+	}
+}
@@ -0,0 +1,123 @@
+#include "../include/screen_brightness_windows/display_state_table.h"
+
+#include <thread>
+
+namespace screen_brightness
+{
+	static_assert(std::atomic<std::uint64_t>::is_always_lock_free && std::atomic<std::int64_t>::is_always_lock_free,
+		"readers in other languages read the slots as plain integers");
+
+	namespace
+	{
+		// readers spin this often before yielding to a writer which has been preempted half way through
+		constexpr int kSpinCount = 64;
+	}
+
+	bool DisplayStateTable::Publish(const PublishedDisplayState& state)
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+		Slot* free_slot = nullptr;
+		for (Slot& slot : layout_.slots)
+		{
+			const std::uint64_t display = slot.display.load(std::memory_order_relaxed);
+			if (display == state.display)
+			{
+				WriteSlot(slot, state);
+				return true;
+			}
+
+			if (display == 0 && free_slot == nullptr)
+			{
+				free_slot = &slot;
+			}
+		}
+
+		if (free_slot == nullptr)
+		{
+			return false;
+		}
+
+		WriteSlot(*free_slot, state);
+		return true;
+	}
+
+	void DisplayStateTable::Remove(const DisplayHandle display)
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+		for (Slot& slot : layout_.slots)
+		{
+			if (slot.display.load(std::memory_order_relaxed) == display)
+			{
+				WriteSlot(slot, PublishedDisplayState{});
+				return;
+			}
+		}
+	}
+
+	bool DisplayStateTable::Read(const DisplayHandle display, PublishedDisplayState& state) const
+	{
+		for (const Slot& slot : layout_.slots)
+		{
+			// the display may move to another slot in between, which the full read below notices
+			if (slot.display.load(std::memory_order_relaxed) != display)
+			{
+				continue;
+			}
+
+			ReadSlot(slot, state);
+			if (state.display == display)
+			{
+				return true;
+			}
+		}
+
+		return false;
+	}
+
+	void DisplayStateTable::ReadSlot(const Slot& slot, PublishedDisplayState& state)
+	{
+		for (int attempt = 0;; ++attempt)
+		{
+			const std::uint64_t sequence = slot.sequence.load(std::memory_order_acquire);
+			if ((sequence & 1) != 0)
+			{
+				if (attempt >= kSpinCount)
+				{
+					std::this_thread::yield();
+				}
+
+				continue;
+			}
+
+			state.display = static_cast<DisplayHandle>(slot.display.load(std::memory_order_relaxed));
+			state.current = static_cast<long>(slot.current.load(std::memory_order_relaxed));
+			state.target = static_cast<long>(slot.target.load(std::memory_order_relaxed));
+			state.minimum = static_cast<long>(slot.minimum.load(std::memory_order_relaxed));
+			state.maximum = static_cast<long>(slot.maximum.load(std::memory_order_relaxed));
+			state.system = static_cast<long>(slot.system.load(std::memory_order_relaxed));
+			state.owner = static_cast<std::uint32_t>(slot.owner.load(std::memory_order_relaxed));
+			std::atomic_thread_fence(std::memory_order_acquire);
+			if (slot.sequence.load(std::memory_order_relaxed) == sequence)
+			{
+				state.generation = sequence / 2;
+				return;
+			}
+		}
+	}
+
+	void DisplayStateTable::WriteSlot(Slot& slot, const PublishedDisplayState& state)
+	{
+		const std::uint64_t sequence = slot.sequence.load(std::memory_order_relaxed);
+		slot.sequence.store(sequence + 1, std::memory_order_relaxed);
+		std::atomic_thread_fence(std::memory_order_release);
+		slot.display.store(static_cast<std::uint64_t>(state.display), std::memory_order_relaxed);
+		slot.current.store(state.current, std::memory_order_relaxed);
+		slot.target.store(state.target, std::memory_order_relaxed);
+		slot.minimum.store(state.minimum, std::memory_order_relaxed);
+		slot.maximum.store(state.maximum, std::memory_order_relaxed);
+		slot.system.store(state.system, std::memory_order_relaxed);
+		slot.owner.store(state.owner, std::memory_order_relaxed);
+		slot.sequence.store(sequence + 2, std::memory_order_release);
+		layout_.generation.fetch_add(1, std::memory_order_release);
+	}
+}
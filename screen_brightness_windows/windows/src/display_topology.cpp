@@ -0,0 +1,133 @@
+#include "../include/screen_brightness_windows/display_topology.h"
+
+#include <algorithm>
+#include <utility>
+
+namespace screen_brightness
+{
+	namespace
+	{
+		bool CompareId(const DisplayInfo& a, const DisplayInfo& b)
+		{
+			return a.id < b.id;
+		}
+	}
+
+	DisplayTopology::DisplayTopology(MonitorBackend& backend) : backend_(backend)
+	{
+	}
+
+	MonitorStatus DisplayTopology::Update(DisplayTopologyDelta& delta)
+	{
+		std::vector<DisplayInfo> displays;
+		if (const MonitorStatus status = backend_.EnumerateDisplays(displays); status != MonitorStatus::kOk)
+		{
+			return status;
+		}
+
+		std::sort(displays.begin(), displays.end(), CompareId);
+		delta = DisplayTopologyDelta();
+
+		// merge of two lists sorted by id
+		std::vector<Display> next_displays;
+		next_displays.reserve(displays.size());
+		std::vector<size_t> added_displays;
+		auto previous = displays_.begin();
+		for (DisplayInfo& info : displays)
+		{
+			for (; previous != displays_.end() && previous->info.id < info.id; ++previous)
+			{
+				delta.removed.push_back(std::move(previous->info));
+			}
+
+			if (previous != displays_.end() && previous->info.id == info.id)
+			{
+				if (previous->info.handle != info.handle)
+				{
+					delta.handle_changes.push_back(DisplayHandleChange{ previous->info.handle, info.handle });
+				}
+
+				info.identity = previous->info.identity;
+				previous->info = std::move(info);
+				next_displays.push_back(std::move(*previous));
+				++previous;
+				continue;
+			}
+
+			Display display;
+			display.info = std::move(info);
+			Identify(display);
+			added_displays.push_back(next_displays.size());
+			next_displays.push_back(std::move(display));
+		}
+
+		for (; previous != displays_.end(); ++previous)
+		{
+			delta.removed.push_back(std::move(previous->info));
+		}
+
+		displays_ = std::move(next_displays);
+		UpdateIdentityIndex();
+		for (const size_t index : added_displays)
+		{
+			delta.added.push_back(displays_[index].info);
+		}
+
+		return MonitorStatus::kOk;
+	}
+
+	const DisplayTopology::Display* DisplayTopology::Find(const std::string& id) const
+	{
+		const auto iterator = std::lower_bound(displays_.begin(), displays_.end(), id,
+			[](const Display& display, const std::string& value) { return display.info.id < value; });
+		if (iterator == displays_.end() || iterator->info.id != id)
+		{
+			return nullptr;
+		}
+
+		return &*iterator;
+	}
+
+	const DisplayTopology::Display* DisplayTopology::FindByHandle(const DisplayHandle handle) const
+	{
+		const auto iterator = std::find_if(displays_.begin(), displays_.end(),
+			[handle](const Display& display) { return display.info.handle == handle; });
+		return iterator == displays_.end() ? nullptr : &*iterator;
+	}
+
+	const DisplayTopology::Display* DisplayTopology::FindByIdentity(const DisplayIdentity identity) const
+	{
+		const auto iterator = identity_index_.find(identity);
+		return iterator == identity_index_.end() ? nullptr : &displays_[iterator->second];
+	}
+
+	void DisplayTopology::Identify(Display& display)
+	{
+		Edid edid;
+		if (backend_.GetEdid(display.info.handle, display.edid) == MonitorStatus::kOk && edid.Parse(display.edid.data(), display.edid.size()))
+		{
+			display.info.identity = GetDisplayIdentity(edid, display.info.id);
+			return;
+		}
+
+		display.edid.clear();
+		display.info.identity = GetDisplayIdentity(display.info.id);
+	}
+
+	void DisplayTopology::UpdateIdentityIndex()
+	{
+		identity_index_.clear();
+		for (size_t index = 0; index < displays_.size(); ++index)
+		{
+			DisplayInfo& info = displays_[index].info;
+
+			// identical EDIDs, e.g. cloned by a splitter, are told apart by their device id
+			if (identity_index_.count(info.identity) != 0)
+			{
+				info.identity.value ^= GetDisplayIdentity(info.id).value;
+			}
+
+			identity_index_.emplace(info.identity, index);
+		}
+	}
+}
@@ -0,0 +1,34 @@
+#include "../include/screen_brightness_windows/display_topology_changed_stream_handler.h"
+
+namespace screen_brightness
+{
+	namespace
+	{
+		flutter::EncodableList ToEncodableList(const std::vector<DisplayInfo>& displays)
+		{
+			flutter::EncodableList list;
+			for (const DisplayInfo& display : displays)
+			{
+				list.emplace_back(flutter::EncodableMap{
+					{ flutter::EncodableValue("id"), flutter::EncodableValue(display.id) },
+					{ flutter::EncodableValue("name"), flutter::EncodableValue(display.name) },
+					{ flutter::EncodableValue("identity"), flutter::EncodableValue(ToString(display.identity)) },
+				});
+			}
+
+			return list;
+		}
+	}
+
+	void DisplayTopologyChangedStreamHandler::AddDisplayTopologyDeltaToEventSink(const DisplayTopologyDelta& delta) const
+	{
+		if (sink_ == nullptr) {
+			return;
+		}
+
+		sink_->Success(flutter::EncodableMap{
+			{ flutter::EncodableValue("added"), flutter::EncodableValue(ToEncodableList(delta.added)) },
+			{ flutter::EncodableValue("removed"), flutter::EncodableValue(ToEncodableList(delta.removed)) },
+		});
+	}
+}
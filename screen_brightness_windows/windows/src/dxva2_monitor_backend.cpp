@@ -0,0 +1,266 @@
+#include "../include/screen_brightness_windows/dxva2_monitor_backend.h"
+
+#include <highlevelmonitorconfigurationapi.h>
+#include <lowlevelmonitorconfigurationapi.h>
+
+#include <algorithm>
+#include <cstring>
+#include <utility>
+
+#include "../include/screen_brightness_windows/small_buffer.h"
+
+#pragma comment(lib, "Advapi32.lib")
+#pragma comment(lib, "Dxva2.lib")
+
+namespace screen_brightness
+{
+	namespace
+	{
+		// Owns the physical monitors behind a HMONITOR and destroys them on every exit path. A HMONITOR rarely maps to
+		// more than a few physical monitors, so those are kept inline and the brightness path does not allocate.
+		class PhysicalMonitors final
+		{
+		public:
+			PhysicalMonitors() = default;
+
+			PhysicalMonitors(const PhysicalMonitors&) = delete;
+
+			PhysicalMonitors& operator=(const PhysicalMonitors&) = delete;
+
+			~PhysicalMonitors()
+			{
+				if (physical_monitor_array_size_ > 0)
+				{
+					DestroyPhysicalMonitors(physical_monitor_array_size_, physical_monitors_.data());
+				}
+			}
+
+			MonitorStatus Acquire(HMONITOR monitor_handler)
+			{
+				DWORD physical_monitor_array_size = 0;
+				if (!GetNumberOfPhysicalMonitorsFromHMONITOR(monitor_handler, &physical_monitor_array_size))
+				{
+					return MonitorStatus::kGetNumberOfMonitorsFailed;
+				}
+
+				if (physical_monitor_array_size == 0 || physical_monitors_.Resize(physical_monitor_array_size) == nullptr)
+				{
+					return MonitorStatus::kNoMonitors;
+				}
+
+				if (!GetPhysicalMonitorsFromHMONITOR(monitor_handler, physical_monitor_array_size, physical_monitors_.data()))
+				{
+					return MonitorStatus::kGetPhysicalMonitorsFailed;
+				}
+
+				physical_monitor_array_size_ = physical_monitor_array_size;
+				return MonitorStatus::kOk;
+			}
+
+			[[nodiscard]] HANDLE front() { return physical_monitors_.data()->hPhysicalMonitor; }
+
+		private:
+			SmallBuffer<PHYSICAL_MONITOR, 4> physical_monitors_;
+
+			DWORD physical_monitor_array_size_ = 0;
+		};
+
+		// Device interface path of the monitor on an adapter output, e.g.
+		// \\?\DISPLAY#DEL4123#5&1b2c3d4&0&UID4353#{e6f07b5f-ee97-4a90-b076-33f57bf4eaa7}.
+		bool GetDeviceInterfaceName(const char* device, std::string& name)
+		{
+			DISPLAY_DEVICEA display_device{};
+			display_device.cb = sizeof(display_device);
+			if (!EnumDisplayDevicesA(device, 0, &display_device, EDD_GET_DEVICE_INTERFACE_NAME) || display_device.DeviceID[0] == '\0')
+			{
+				return false;
+			}
+
+			name = display_device.DeviceID;
+			return true;
+		}
+
+		BOOL CALLBACK EnumerateDisplayProc(HMONITOR monitor, HDC, LPRECT, LPARAM data)
+		{
+			auto& displays = *reinterpret_cast<std::vector<DisplayInfo>*>(data);
+
+			MONITORINFOEXA monitor_info{};
+			monitor_info.cbSize = sizeof(monitor_info);
+			DisplayInfo display;
+			display.handle = Dxva2MonitorBackend::ToDisplayHandle(monitor);
+			if (GetMonitorInfoA(monitor, &monitor_info))
+			{
+				display.name = monitor_info.szDevice;
+				display.id = monitor_info.szDevice;
+			}
+
+			// the device interface path of the monitor identifies it independently of the adapter output numbering
+			if (!display.name.empty())
+			{
+				GetDeviceInterfaceName(monitor_info.szDevice, display.id);
+			}
+
+			displays.push_back(std::move(display));
+			return TRUE;
+		}
+	}
+
+	MonitorStatus Dxva2MonitorBackend::EnumerateDisplays(std::vector<DisplayInfo>& displays)
+	{
+		displays.clear();
+		if (!EnumDisplayMonitors(nullptr, nullptr, EnumerateDisplayProc, reinterpret_cast<LPARAM>(&displays)))
+		{
+			return MonitorStatus::kEnumerateMonitorsFailed;
+		}
+
+		return MonitorStatus::kOk;
+	}
+
+	DisplayHandle Dxva2MonitorBackend::GetPrimaryDisplay()
+	{
+		return ToDisplayHandle(MonitorFromPoint(POINT{ 0, 0 }, MONITOR_DEFAULTTOPRIMARY));
+	}
+
+	MonitorStatus Dxva2MonitorBackend::GetScreenBrightness(const DisplayHandle display, long& minimum_screen_brightness, long& screen_brightness, long& maximum_screen_brightness)
+	{
+		PhysicalMonitors physical_monitors;
+		if (const MonitorStatus status = physical_monitors.Acquire(ToMonitor(display)); status != MonitorStatus::kOk)
+		{
+			return status;
+		}
+
+		DWORD minimum_brightness = 0, brightness = 0, maximum_brightness = 0;
+		if (!GetMonitorBrightness(physical_monitors.front(), &minimum_brightness, &brightness, &maximum_brightness))
+		{
+			return MonitorStatus::kGetBrightnessFailed;
+		}
+
+		minimum_screen_brightness = minimum_brightness;
+		screen_brightness = brightness;
+		maximum_screen_brightness = maximum_brightness;
+		return MonitorStatus::kOk;
+	}
+
+	MonitorStatus Dxva2MonitorBackend::SetScreenBrightness(const DisplayHandle display, const long screen_brightness)
+	{
+		PhysicalMonitors physical_monitors;
+		if (const MonitorStatus status = physical_monitors.Acquire(ToMonitor(display)); status != MonitorStatus::kOk)
+		{
+			return status;
+		}
+
+		if (!SetMonitorBrightness(physical_monitors.front(), screen_brightness))
+		{
+			return MonitorStatus::kSetBrightnessFailed;
+		}
+
+		return MonitorStatus::kOk;
+	}
+
+	MonitorStatus Dxva2MonitorBackend::GetVcpFeature(const DisplayHandle display, const VcpCode code, unsigned long& current_value, unsigned long& maximum_value)
+	{
+		PhysicalMonitors physical_monitors;
+		if (const MonitorStatus status = physical_monitors.Acquire(ToMonitor(display)); status != MonitorStatus::kOk)
+		{
+			return status;
+		}
+
+		DWORD current = 0, maximum = 0;
+		if (!GetVCPFeatureAndVCPFeatureReply(physical_monitors.front(), code, nullptr, &current, &maximum))
+		{
+			return MonitorStatus::kGetVcpFeatureFailed;
+		}
+
+		current_value = current;
+		maximum_value = maximum;
+		return MonitorStatus::kOk;
+	}
+
+	MonitorStatus Dxva2MonitorBackend::SetVcpFeature(const DisplayHandle display, const VcpCode code, const unsigned long value)
+	{
+		PhysicalMonitors physical_monitors;
+		if (const MonitorStatus status = physical_monitors.Acquire(ToMonitor(display)); status != MonitorStatus::kOk)
+		{
+			return status;
+		}
+
+		if (!SetVCPFeature(physical_monitors.front(), code, value))
+		{
+			return MonitorStatus::kSetVcpFeatureFailed;
+		}
+
+		return MonitorStatus::kOk;
+	}
+
+	MonitorStatus Dxva2MonitorBackend::GetCapabilitiesString(const DisplayHandle display, std::string& capabilities)
+	{
+		PhysicalMonitors physical_monitors;
+		if (const MonitorStatus status = physical_monitors.Acquire(ToMonitor(display)); status != MonitorStatus::kOk)
+		{
+			return status;
+		}
+
+		DWORD length = 0;
+		if (!GetCapabilitiesStringLength(physical_monitors.front(), &length) || length == 0)
+		{
+			return MonitorStatus::kGetCapabilitiesFailed;
+		}
+
+		// the length includes the terminating null character
+		capabilities.assign(length, '\0');
+		if (!CapabilitiesRequestAndCapabilitiesReply(physical_monitors.front(), capabilities.data(), length))
+		{
+			capabilities.clear();
+			return MonitorStatus::kGetCapabilitiesFailed;
+		}
+
+		capabilities.resize(std::strlen(capabilities.c_str()));
+		return MonitorStatus::kOk;
+	}
+
+	MonitorStatus Dxva2MonitorBackend::GetEdid(const DisplayHandle display, std::vector<std::uint8_t>& edid)
+	{
+		MONITORINFOEXA monitor_info{};
+		monitor_info.cbSize = sizeof(monitor_info);
+		if (!GetMonitorInfoA(ToMonitor(display), &monitor_info))
+		{
+			return MonitorStatus::kNoMonitors;
+		}
+
+		// the interface path \\?\DISPLAY#DEL4123#5&1b2c3d4&0&UID4353#{guid} names the device instance
+		// DISPLAY\DEL4123\5&1b2c3d4&0&UID4353, whose device parameters hold the EDID the monitor reported
+		constexpr char kInterfacePrefix[] = "\\\\?\\";
+		constexpr size_t kInterfacePrefixSize = sizeof(kInterfacePrefix) - 1;
+		std::string interface_name;
+		if (!GetDeviceInterfaceName(monitor_info.szDevice, interface_name) || interface_name.rfind(kInterfacePrefix, 0) != 0)
+		{
+			return MonitorStatus::kGetEdidFailed;
+		}
+
+		const size_t class_start = interface_name.rfind("#{");
+		if (class_start == std::string::npos || class_start < kInterfacePrefixSize)
+		{
+			return MonitorStatus::kGetEdidFailed;
+		}
+
+		std::string instance = interface_name.substr(kInterfacePrefixSize, class_start - kInterfacePrefixSize);
+		std::replace(instance.begin(), instance.end(), '#', '\\');
+		const std::string key = "SYSTEM\\CurrentControlSet\\Enum\\" + instance + "\\Device Parameters";
+
+		DWORD size = 0;
+		if (RegGetValueA(HKEY_LOCAL_MACHINE, key.c_str(), "EDID", RRF_RT_REG_BINARY, nullptr, nullptr, &size) != ERROR_SUCCESS || size == 0)
+		{
+			return MonitorStatus::kGetEdidFailed;
+		}
+
+		edid.resize(size);
+		if (RegGetValueA(HKEY_LOCAL_MACHINE, key.c_str(), "EDID", RRF_RT_REG_BINARY, nullptr, edid.data(), &size) != ERROR_SUCCESS)
+		{
+			edid.clear();
+			return MonitorStatus::kGetEdidFailed;
+		}
+
+		edid.resize(size);
+		return MonitorStatus::kOk;
+	}
+}
@@ -0,0 +1,125 @@
+#include "../include/screen_brightness_windows/edid.h"
+
+#include <algorithm>
+
+namespace screen_brightness
+{
+	namespace
+	{
+		constexpr std::uint8_t kHeader[] = { 0x00, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0x00 };
+
+		constexpr std::size_t kDescriptorOffset = 54;
+
+		constexpr std::size_t kDescriptorSize = 18;
+
+		constexpr std::size_t kDescriptorCount = 4;
+
+		constexpr std::uint8_t kMonitorSerialTag = 0xff;
+
+		constexpr std::uint8_t kTextTag = 0xfe;
+
+		constexpr std::uint8_t kMonitorNameTag = 0xfc;
+
+		char GetManufacturerLetter(const int value)
+		{
+			return value >= 1 && value <= 26 ? static_cast<char>('A' + value - 1) : '?';
+		}
+
+		// Display descriptor text is up to 13 characters, ended by a line feed and padded with spaces.
+		std::string_view GetDescriptorText(const std::uint8_t* descriptor)
+		{
+			const char* text = reinterpret_cast<const char*>(descriptor + 5);
+			std::size_t size = 0;
+			while (size < 13 && text[size] != '\n' && text[size] != '\0')
+			{
+				++size;
+			}
+
+			while (size > 0 && text[size - 1] == ' ')
+			{
+				--size;
+			}
+
+			return { text, size };
+		}
+	}
+
+	bool Edid::Parse(const std::uint8_t* data, const std::size_t size)
+	{
+		*this = Edid();
+		if (data == nullptr || size < kBlockSize || !std::equal(std::begin(kHeader), std::end(kHeader), data))
+		{
+			return false;
+		}
+
+		std::uint8_t checksum = 0;
+		for (std::size_t index = 0; index < kBlockSize; ++index)
+		{
+			checksum = static_cast<std::uint8_t>(checksum + data[index]);
+		}
+
+		is_checksum_valid_ = checksum == 0;
+
+		// three 5 bit letters, big endian
+		const int manufacturer = (data[8] << 8) | data[9];
+		manufacturer_id_[0] = GetManufacturerLetter((manufacturer >> 10) & 0x1f);
+		manufacturer_id_[1] = GetManufacturerLetter((manufacturer >> 5) & 0x1f);
+		manufacturer_id_[2] = GetManufacturerLetter(manufacturer & 0x1f);
+		product_code_ = static_cast<std::uint16_t>(data[10] | (data[11] << 8));
+		serial_number_ = static_cast<std::uint32_t>(data[12]) | (static_cast<std::uint32_t>(data[13]) << 8) |
+			(static_cast<std::uint32_t>(data[14]) << 16) | (static_cast<std::uint32_t>(data[15]) << 24);
+
+		// week 0xff marks the year as a model year
+		manufacture_week_ = data[16] <= 54 ? data[16] : 0;
+		manufacture_year_ = data[17] == 0 ? 0 : 1990 + data[17];
+		width_millimeters_ = data[21] * 10;
+		height_millimeters_ = data[22] * 10;
+		extension_count_ = data[126];
+
+		for (std::size_t index = 0; index < kDescriptorCount; ++index)
+		{
+			const std::uint8_t* descriptor = data + kDescriptorOffset + index * kDescriptorSize;
+
+			// a non-zero pixel clock makes it a detailed timing, the first of which is the preferred one
+			if (descriptor[0] != 0 || descriptor[1] != 0)
+			{
+				const int width = descriptor[12] | ((descriptor[14] & 0xf0) << 4);
+				const int height = descriptor[13] | ((descriptor[14] & 0x0f) << 8);
+				if (index == 0 && width != 0 && height != 0)
+				{
+					width_millimeters_ = width;
+					height_millimeters_ = height;
+				}
+
+				continue;
+			}
+
+			// the first descriptor of each kind wins
+			std::string_view* text = nullptr;
+			switch (descriptor[3])
+			{
+			case kMonitorNameTag:
+				text = &monitor_name_;
+				break;
+
+			case kMonitorSerialTag:
+				text = &serial_string_;
+				break;
+
+			case kTextTag:
+				text = &text_;
+				break;
+
+			default:
+				break;
+			}
+
+			if (text != nullptr && text->empty())
+			{
+				*text = GetDescriptorText(descriptor);
+			}
+		}
+
+		return true;
+	}
+}
@@ -0,0 +1,152 @@
+#include "../include/screen_brightness_windows/evdev_activity_source.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <ctime>
+#include <utility>
+
+#include <dirent.h>
+#include <fcntl.h>
+#include <linux/input.h>
+#include <sys/ioctl.h>
+#include <unistd.h>
+
+namespace screen_brightness
+{
+	namespace
+	{
+		constexpr const char kEventPrefix[] = "event";
+
+		std::chrono::nanoseconds GetMonotonicTime()
+		{
+			timespec time{};
+			clock_gettime(CLOCK_MONOTONIC, &time);
+			return std::chrono::seconds(time.tv_sec) + std::chrono::nanoseconds(time.tv_nsec);
+		}
+	}
+
+	EvdevActivitySource::EvdevActivitySource(Clock& clock, std::string root) : clock_(clock), root_(std::move(root))
+	{
+		// starting counts as input, so the display is not dimmed at once
+		const Clock::time_point now = clock_.Now();
+		last_input_time_ = now;
+		Scan(now);
+	}
+
+	EvdevActivitySource::~EvdevActivitySource()
+	{
+		for (const Device& device : devices_)
+		{
+			close(device.file);
+		}
+	}
+
+	Clock::time_point EvdevActivitySource::GetLastInputTime()
+	{
+		const Clock::time_point now = clock_.Now();
+		if (now - last_scan_time_ >= kRescanInterval)
+		{
+			Scan(now);
+		}
+
+		for (auto device = devices_.begin(); device != devices_.end();)
+		{
+			if (Drain(*device, now))
+			{
+				++device;
+				continue;
+			}
+
+			close(device->file);
+			device = devices_.erase(device);
+		}
+
+		return devices_.empty() ? now : last_input_time_;
+	}
+
+	void EvdevActivitySource::Scan(const Clock::time_point now)
+	{
+		last_scan_time_ = now;
+		DIR* directory = opendir(root_.c_str());
+		if (directory == nullptr)
+		{
+			return;
+		}
+
+		while (const dirent* entry = readdir(directory))
+		{
+			if (std::strncmp(entry->d_name, kEventPrefix, sizeof(kEventPrefix) - 1) != 0 ||
+				std::any_of(devices_.begin(), devices_.end(), [entry](const Device& device) { return device.name == entry->d_name; }))
+			{
+				continue;
+			}
+
+			const int file = open((root_ + "/" + entry->d_name).c_str(), O_RDONLY | O_NONBLOCK | O_CLOEXEC);
+			if (file < 0)
+			{
+				continue;
+			}
+
+			// without it the timestamps are CLOCK_REALTIME ones, which Drain takes as now
+			const int clock_id = CLOCK_MONOTONIC;
+			(void)ioctl(file, EVIOCSCLOCKID, &clock_id);
+			devices_.push_back(Device{ entry->d_name, file });
+		}
+
+		closedir(directory);
+	}
+
+	bool EvdevActivitySource::Drain(const Device& device, const Clock::time_point now)
+	{
+		// whole events only; the kernel never returns part of one
+		input_event events[64];
+		std::chrono::nanoseconds newest_time{ -1 };
+		while (true)
+		{
+			const ssize_t size = read(device.file, events, sizeof(events));
+			if (size < 0)
+			{
+				if (errno == EINTR)
+				{
+					continue;
+				}
+
+				if (errno != EAGAIN)
+				{
+					return false;
+				}
+
+				break;
+			}
+
+			const size_t count = static_cast<size_t>(size) / sizeof(input_event);
+			for (size_t index = 0; index < count; ++index)
+			{
+				const input_event& event = events[index];
+				if (event.type == EV_SYN)
+				{
+					continue;
+				}
+
+				newest_time = std::max<std::chrono::nanoseconds>(newest_time,
+					std::chrono::seconds(event.input_event_sec) + std::chrono::microseconds(event.input_event_usec));
+			}
+
+			if (static_cast<size_t>(size) < sizeof(events))
+			{
+				break;
+			}
+		}
+
+		if (newest_time.count() < 0)
+		{
+			return true;
+		}
+
+		// from the monotonic clock onto the clock's time line; timestamps ahead of it count as now
+		const auto age = std::max(GetMonotonicTime() - newest_time, std::chrono::nanoseconds::zero());
+		last_input_time_ = std::max(last_input_time_, now - std::chrono::duration_cast<Clock::duration>(age));
+		return true;
+	}
+}
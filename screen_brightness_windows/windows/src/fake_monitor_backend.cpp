@@ -0,0 +1,179 @@
+#include "../include/screen_brightness_windows/fake_monitor_backend.h"
+
+#include <utility>
+
+namespace screen_brightness
+{
+	DisplayHandle FakeMonitorBackend::AddDisplay(Display display)
+	{
+		const DisplayHandle handle = next_display_++;
+		displays_.emplace(handle, std::move(display));
+		return handle;
+	}
+
+	void FakeMonitorBackend::RemoveDisplay(const DisplayHandle display)
+	{
+		displays_.erase(display);
+	}
+
+	FakeMonitorBackend::Display& FakeMonitorBackend::GetDisplay(const DisplayHandle display)
+	{
+		return displays_.at(display);
+	}
+
+	MonitorStatus FakeMonitorBackend::EnumerateDisplays(std::vector<DisplayInfo>& displays)
+	{
+		displays.clear();
+		for (const auto& [handle, display] : displays_)
+		{
+			displays.push_back(DisplayInfo{ handle, display.name, display.name });
+		}
+
+		return MonitorStatus::kOk;
+	}
+
+	DisplayHandle FakeMonitorBackend::GetPrimaryDisplay()
+	{
+		return displays_.empty() ? 0 : displays_.begin()->first;
+	}
+
+	MonitorStatus FakeMonitorBackend::GetScreenBrightness(const DisplayHandle display, long& minimum_screen_brightness, long& screen_brightness, long& maximum_screen_brightness)
+	{
+		++get_count_;
+		const auto iterator = displays_.find(display);
+		if (iterator == displays_.end())
+		{
+			return MonitorStatus::kNoMonitors;
+		}
+
+		const Display& fake_display = iterator->second;
+		if (fake_display.is_failing)
+		{
+			return MonitorStatus::kGetBrightnessFailed;
+		}
+
+		minimum_screen_brightness = fake_display.minimum_brightness;
+		screen_brightness = fake_display.brightness;
+		maximum_screen_brightness = fake_display.maximum_brightness;
+		return MonitorStatus::kOk;
+	}
+
+	MonitorStatus FakeMonitorBackend::SetScreenBrightness(const DisplayHandle display, const long screen_brightness)
+	{
+		++set_count_;
+		const auto iterator = displays_.find(display);
+		if (iterator == displays_.end())
+		{
+			return MonitorStatus::kNoMonitors;
+		}
+
+		Display& fake_display = iterator->second;
+		if (fake_display.is_failing)
+		{
+			return MonitorStatus::kSetBrightnessFailed;
+		}
+
+		fake_display.brightness = screen_brightness;
+		return MonitorStatus::kOk;
+	}
+
+	MonitorStatus FakeMonitorBackend::GetVcpFeature(const DisplayHandle display, const VcpCode code, unsigned long& current_value, unsigned long& maximum_value)
+	{
+		++vcp_get_count_;
+		const auto iterator = displays_.find(display);
+		if (iterator == displays_.end())
+		{
+			return MonitorStatus::kNoMonitors;
+		}
+
+		const Display& fake_display = iterator->second;
+		if (fake_display.is_failing)
+		{
+			return MonitorStatus::kGetVcpFeatureFailed;
+		}
+
+		if (code == kVcpLuminance)
+		{
+			current_value = static_cast<unsigned long>(fake_display.brightness);
+			maximum_value = static_cast<unsigned long>(fake_display.maximum_brightness);
+			return MonitorStatus::kOk;
+		}
+
+		const auto feature = fake_display.vcp_features.find(code);
+		if (feature == fake_display.vcp_features.end())
+		{
+			return MonitorStatus::kUnsupported;
+		}
+
+		current_value = feature->second.current_value;
+		maximum_value = feature->second.maximum_value;
+		return MonitorStatus::kOk;
+	}
+
+	MonitorStatus FakeMonitorBackend::SetVcpFeature(const DisplayHandle display, const VcpCode code, const unsigned long value)
+	{
+		++vcp_set_count_;
+		const auto iterator = displays_.find(display);
+		if (iterator == displays_.end())
+		{
+			return MonitorStatus::kNoMonitors;
+		}
+
+		Display& fake_display = iterator->second;
+		if (fake_display.is_failing)
+		{
+			return MonitorStatus::kSetVcpFeatureFailed;
+		}
+
+		if (code == kVcpLuminance)
+		{
+			fake_display.brightness = static_cast<long>(value);
+			return MonitorStatus::kOk;
+		}
+
+		const auto feature = fake_display.vcp_features.find(code);
+		if (feature == fake_display.vcp_features.end())
+		{
+			return MonitorStatus::kUnsupported;
+		}
+
+		feature->second.current_value = value;
+		return MonitorStatus::kOk;
+	}
+
+	MonitorStatus FakeMonitorBackend::GetCapabilitiesString(const DisplayHandle display, std::string& capabilities)
+	{
+		++capabilities_count_;
+		const auto iterator = displays_.find(display);
+		if (iterator == displays_.end())
+		{
+			return MonitorStatus::kNoMonitors;
+		}
+
+		const Display& fake_display = iterator->second;
+		if (fake_display.is_failing || fake_display.capabilities.empty())
+		{
+			return MonitorStatus::kGetCapabilitiesFailed;
+		}
+
+		capabilities = fake_display.capabilities;
+		return MonitorStatus::kOk;
+	}
+
+	MonitorStatus FakeMonitorBackend::GetEdid(const DisplayHandle display, std::vector<std::uint8_t>& edid)
+	{
+		const auto iterator = displays_.find(display);
+		if (iterator == displays_.end())
+		{
+			return MonitorStatus::kNoMonitors;
+		}
+
+		if (iterator->second.edid.empty())
+		{
+			return MonitorStatus::kUnsupported;
+		}
+
+		edid = iterator->second.edid;
+		return MonitorStatus::kOk;
+	}
+}
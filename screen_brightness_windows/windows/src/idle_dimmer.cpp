@@ -0,0 +1,176 @@
+#include "../include/screen_brightness_windows/idle_dimmer.h"
+
+#include <algorithm>
+#include <chrono>
+
+namespace screen_brightness
+{
+	const char* GetIdleStateName(const IdleState state)
+	{
+		switch (state)
+		{
+		case IdleState::kActive:
+			return "active";
+		case IdleState::kDimming:
+			return "dimming";
+		case IdleState::kDimmed:
+			return "dimmed";
+		case IdleState::kRestoring:
+			return "restoring";
+		default:
+			return "unknown";
+		}
+	}
+
+	IdleDimmer::IdleDimmer(BrightnessClient& client, InputActivitySource& input, Clock& clock) : client_(client), input_(input), clock_(clock)
+	{
+	}
+
+	void IdleDimmer::SetConfig(const IdleDimmingConfig& config)
+	{
+		config_ = config;
+		active_since_ = clock_.Now();
+	}
+
+	void IdleDimmer::SetEnabled(const bool is_enabled)
+	{
+		if (is_enabled == is_enabled_)
+		{
+			return;
+		}
+
+		is_enabled_ = is_enabled;
+		if (is_enabled_)
+		{
+			BecomeActive(clock_.Now());
+			return;
+		}
+
+		if (state_ != IdleState::kActive && client_.GetApplicationScreenBrightnessOverride() == written_brightness_)
+		{
+			Restore();
+		}
+
+		state_ = IdleState::kActive;
+	}
+
+	Clock::time_point IdleDimmer::Poll()
+	{
+		if (!is_enabled_)
+		{
+			return Clock::time_point::max();
+		}
+
+		const Clock::time_point now = clock_.Now();
+		const Clock::time_point last_input_time = input_.GetLastInputTime();
+		if (state_ == IdleState::kActive)
+		{
+			const Clock::time_point idle_deadline = std::max(last_input_time, active_since_) + config_.idle_timeout;
+			if (now < idle_deadline)
+			{
+				return idle_deadline;
+			}
+
+			// already as dark as it would be dimmed, so the next timeout looks again
+			const double shown_brightness = GetShownBrightness();
+			if (shown_brightness < 0 || shown_brightness <= config_.dimmed_brightness)
+			{
+				BecomeActive(now);
+				return now + config_.idle_timeout;
+			}
+
+			restore_brightness_ = client_.GetApplicationScreenBrightnessOverride();
+			written_brightness_ = restore_brightness_;
+			idle_input_time_ = last_input_time;
+			StartRamp(IdleState::kDimming, shown_brightness, config_.dimmed_brightness, now, config_.dim_duration);
+		}
+		else if (client_.GetApplicationScreenBrightnessOverride() != written_brightness_)
+		{
+			BecomeActive(now);
+			return now + config_.idle_timeout;
+		}
+		else if (last_input_time > idle_input_time_ && state_ != IdleState::kRestoring)
+		{
+			const double restore_brightness = restore_brightness_ >= 0 ? restore_brightness_ : client_.GetSystemScreenBrightness();
+			StartRamp(IdleState::kRestoring, GetShownBrightness(), restore_brightness, now, config_.restore_duration);
+		}
+
+		if (state_ == IdleState::kDimmed)
+		{
+			return now + config_.input_poll_interval;
+		}
+
+		if (StepRamp(now))
+		{
+			return now + step_period_;
+		}
+
+		if (state_ == IdleState::kDimming)
+		{
+			state_ = IdleState::kDimmed;
+			return now + config_.input_poll_interval;
+		}
+
+		BecomeActive(now);
+		return now + config_.idle_timeout;
+	}
+
+	void IdleDimmer::StartRamp(const IdleState state, const double from, const double to, const Clock::time_point now, const Clock::duration duration)
+	{
+		state_ = state;
+		ramp_from_ = from;
+		ramp_to_ = to;
+		ramp_start_ = now;
+		ramp_duration_ = duration;
+	}
+
+	bool IdleDimmer::StepRamp(const Clock::time_point now)
+	{
+		// the monitor may have slowed down or sped up since the last step
+		step_period_ = std::max(kMinimumStepPeriod, client_.service().scheduled_backend().GetScheduler(client_.display()).pacing().command_period);
+		const Clock::duration step_end = now - ramp_start_ + step_period_;
+		const double fraction = step_end >= ramp_duration_ ? 1 :
+			std::chrono::duration<double>(step_end) / std::chrono::duration<double>(ramp_duration_);
+		if (state_ == IdleState::kRestoring && fraction >= 1)
+		{
+			Restore();
+			return false;
+		}
+
+		// a failed step leaves the override as it was, and the next step tries again
+		(void)client_.SetApplicationScreenBrightness(fraction >= 1 ? ramp_to_ : ramp_from_ + (ramp_to_ - ramp_from_) * fraction);
+		written_brightness_ = client_.GetApplicationScreenBrightnessOverride();
+		return fraction < 1;
+	}
+
+	void IdleDimmer::Restore()
+	{
+		if (restore_brightness_ >= 0)
+		{
+			(void)client_.SetApplicationScreenBrightness(restore_brightness_);
+		}
+		else
+		{
+			(void)client_.ResetApplicationScreenBrightness();
+		}
+
+		written_brightness_ = client_.GetApplicationScreenBrightnessOverride();
+	}
+
+	void IdleDimmer::BecomeActive(const Clock::time_point now)
+	{
+		state_ = IdleState::kActive;
+		active_since_ = now;
+	}
+
+	double IdleDimmer::GetShownBrightness() const
+	{
+		const double override_brightness = client_.GetApplicationScreenBrightnessOverride();
+		if (override_brightness >= 0)
+		{
+			return override_brightness;
+		}
+
+		return client_.HasSystemScreenBrightness() ? client_.GetSystemScreenBrightness() : -1;
+	}
+}
@@ -0,0 +1,394 @@
+#include "../include/screen_brightness_windows/iio_ambient_light_source.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <utility>
+#include <vector>
+
+#include <dirent.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+namespace screen_brightness
+{
+	namespace
+	{
+		// Channels of the illuminance, with and without an index.
+		constexpr const char* kChannels[] = { "in_illuminance", "in_illuminance0" };
+
+		// Reads a sysfs attribute into a stack buffer; sysfs attributes are read in one go.
+		bool ReadText(const std::string& path, char* buffer, const size_t capacity)
+		{
+			const int file = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+			if (file < 0)
+			{
+				return false;
+			}
+
+			const ssize_t size = read(file, buffer, capacity - 1);
+			close(file);
+			if (size <= 0)
+			{
+				return false;
+			}
+
+			buffer[size] = '\0';
+			return true;
+		}
+
+		bool ReadNumber(const std::string& path, double& value)
+		{
+			char buffer[64];
+			if (!ReadText(path, buffer, sizeof(buffer)))
+			{
+				return false;
+			}
+
+			char* end = nullptr;
+			value = std::strtod(buffer, &end);
+			return end != buffer;
+		}
+
+		bool WriteText(const std::string& path, const char* text)
+		{
+			const int file = open(path.c_str(), O_WRONLY | O_CLOEXEC);
+			if (file < 0)
+			{
+				return false;
+			}
+
+			const ssize_t size = static_cast<ssize_t>(std::strlen(text));
+			const bool is_written = write(file, text, size) == size;
+			close(file);
+			return is_written;
+		}
+
+		bool Exists(const std::string& path)
+		{
+			return access(path.c_str(), F_OK) == 0;
+		}
+
+		std::vector<std::string> ListDirectory(const std::string& path)
+		{
+			std::vector<std::string> names;
+			DIR* directory = opendir(path.c_str());
+			if (directory == nullptr)
+			{
+				return names;
+			}
+
+			while (const dirent* entry = readdir(directory))
+			{
+				if (entry->d_name[0] != '.')
+				{
+					names.emplace_back(entry->d_name);
+				}
+			}
+
+			closedir(directory);
+			std::sort(names.begin(), names.end());
+			return names;
+		}
+
+		size_t AlignUp(const size_t offset, const size_t alignment)
+		{
+			return alignment == 0 ? offset : (offset + alignment - 1) / alignment * alignment;
+		}
+	}
+
+	IioAmbientLightSource::IioAmbientLightSource(std::string root, std::string device_root) :
+		root_(std::move(root)), device_root_(std::move(device_root))
+	{
+		for (const std::string& name : ListDirectory(root_))
+		{
+			if (OpenDevice(name))
+			{
+				return;
+			}
+		}
+	}
+
+	IioAmbientLightSource::~IioAmbientLightSource()
+	{
+		if (buffer_file_ < 0)
+		{
+			return;
+		}
+
+		close(buffer_file_);
+		(void)WriteText(buffer_enable_path_, "0");
+		(void)WriteText(scan_element_enable_path_, "0");
+	}
+
+	bool IioAmbientLightSource::ReadIlluminance(double& lux)
+	{
+		if (buffer_file_ >= 0)
+		{
+			return ReadBuffer(lux);
+		}
+
+		double value = 0;
+		if (!is_open() || !ReadNumber(value_path_, value))
+		{
+			return false;
+		}
+
+		lux = is_processed_ ? value : (value + offset_) * scale_;
+		++sample_count_;
+		return true;
+	}
+
+	bool IioAmbientLightSource::OpenDevice(const std::string& name)
+	{
+		const std::string device_path = root_ + "/" + name;
+		for (const char* channel : kChannels)
+		{
+			const std::string channel_path = device_path + "/" + channel;
+			if (Exists(channel_path + "_input"))
+			{
+				value_path_ = channel_path + "_input";
+				is_processed_ = true;
+			}
+			else if (Exists(channel_path + "_raw"))
+			{
+				value_path_ = channel_path + "_raw";
+				is_processed_ = false;
+				if (!ReadNumber(channel_path + "_scale", scale_))
+				{
+					scale_ = 1;
+				}
+
+				if (!ReadNumber(channel_path + "_offset", offset_))
+				{
+					offset_ = 0;
+				}
+			}
+			else
+			{
+				continue;
+			}
+
+			device_name_ = name;
+
+			// the buffer has raw samples, so a processed channel is polled
+			if (!is_processed_)
+			{
+				(void)EnableBuffer(channel);
+			}
+
+			return true;
+		}
+
+		return false;
+	}
+
+	bool IioAmbientLightSource::ReadScanLayout(const std::string& scan_elements_path, const std::string& channel)
+	{
+		struct Element
+		{
+			long index = 0;
+
+			std::string name;
+
+			ScanElement layout;
+		};
+
+		std::vector<Element> elements;
+		for (const std::string& file : ListDirectory(scan_elements_path))
+		{
+			double is_enabled = 0;
+			if (file.size() <= 3 || file.compare(file.size() - 3, 3, "_en") != 0 || !ReadNumber(scan_elements_path + "/" + file, is_enabled) ||
+				is_enabled == 0)
+			{
+				continue;
+			}
+
+			Element element;
+			element.name = file.substr(0, file.size() - 3);
+			double index = 0;
+			char type[64];
+			if (!ReadNumber(scan_elements_path + "/" + element.name + "_index", index) ||
+				!ReadText(scan_elements_path + "/" + element.name + "_type", type, sizeof(type)))
+			{
+				return false;
+			}
+
+			// [be|le]:[s|u]bits/storagebits[Xrepeat]>>shift
+			element.index = static_cast<long>(index);
+			const char* cursor = type;
+			if (std::strncmp(cursor, "be:", 3) != 0 && std::strncmp(cursor, "le:", 3) != 0)
+			{
+				return false;
+			}
+
+			element.layout.is_big_endian = cursor[0] == 'b';
+			cursor += 3;
+			element.layout.is_signed = *cursor == 's';
+			if (*cursor != 's' && *cursor != 'u')
+			{
+				return false;
+			}
+
+			char* end = nullptr;
+			element.layout.bits = static_cast<unsigned>(std::strtoul(cursor + 1, &end, 10));
+			if (*end != '/')
+			{
+				return false;
+			}
+
+			const unsigned long storage_bits = std::strtoul(end + 1, &end, 10);
+			unsigned long repeat = 1;
+			if (*end == 'X')
+			{
+				repeat = std::max(1UL, std::strtoul(end + 1, &end, 10));
+			}
+
+			if (std::strncmp(end, ">>", 2) == 0)
+			{
+				element.layout.shift = static_cast<unsigned>(std::strtoul(end + 2, &end, 10));
+			}
+
+			element.layout.storage_bytes = storage_bits / 8 * repeat;
+			if (storage_bits % 8 != 0 || storage_bits == 0 || storage_bits > 64 || element.layout.bits > storage_bits)
+			{
+				return false;
+			}
+
+			elements.push_back(std::move(element));
+		}
+
+		std::sort(elements.begin(), elements.end(), [](const Element& a, const Element& b) { return a.index < b.index; });
+		size_t offset = 0;
+		size_t alignment = 1;
+		bool has_channel = false;
+		for (Element& element : elements)
+		{
+			const size_t element_alignment = element.layout.storage_bytes;
+			offset = AlignUp(offset, element_alignment);
+			element.layout.offset = offset;
+			offset += element.layout.storage_bytes;
+			alignment = std::max(alignment, element_alignment);
+			if (element.name == channel)
+			{
+				// only the first of repeated values is used
+				scan_element_ = element.layout;
+				scan_element_.storage_bytes = std::min<size_t>(scan_element_.storage_bytes, 8);
+				has_channel = true;
+			}
+		}
+
+		record_size_ = AlignUp(offset, alignment);
+		return has_channel && record_size_ > 0;
+	}
+
+	bool IioAmbientLightSource::EnableBuffer(const std::string& channel)
+	{
+		const std::string device_path = root_ + "/" + device_name_;
+		const std::string scan_elements_path = device_path + "/scan_elements";
+		const std::string scan_element_enable_path = scan_elements_path + "/" + channel + "_en";
+		const std::string buffer_enable_path = device_path + "/buffer/enable";
+		double is_enabled = 0;
+		if (!Exists(scan_element_enable_path) || !ReadNumber(buffer_enable_path, is_enabled))
+		{
+			return false;
+		}
+
+		// a buffer which is running already belongs to another reader
+		if (is_enabled != 0 || !WriteText(scan_element_enable_path, "1"))
+		{
+			return false;
+		}
+
+		// without a trigger or a hardware FIFO the kernel refuses to enable the buffer
+		if (!ReadScanLayout(scan_elements_path, channel) || !WriteText(buffer_enable_path, "1"))
+		{
+			(void)WriteText(scan_element_enable_path, "0");
+			return false;
+		}
+
+		buffer_file_ = open((device_root_ + "/" + device_name_).c_str(), O_RDONLY | O_NONBLOCK | O_CLOEXEC);
+		if (buffer_file_ < 0)
+		{
+			(void)WriteText(buffer_enable_path, "0");
+			(void)WriteText(scan_element_enable_path, "0");
+			return false;
+		}
+
+		buffer_enable_path_ = buffer_enable_path;
+		scan_element_enable_path_ = scan_element_enable_path;
+		return true;
+	}
+
+	bool IioAmbientLightSource::ReadBuffer(double& lux)
+	{
+		// whole records only; the kernel never returns part of one
+		unsigned char buffer[512];
+		const size_t capacity = sizeof(buffer) / record_size_ * record_size_;
+		if (capacity == 0)
+		{
+			return false;
+		}
+
+		double total = 0;
+		std::uint64_t count = 0;
+		while (true)
+		{
+			const ssize_t size = read(buffer_file_, buffer, capacity);
+			if (size <= 0)
+			{
+				break;
+			}
+
+			for (size_t offset = 0; offset + record_size_ <= static_cast<size_t>(size); offset += record_size_)
+			{
+				total += DecodeSample(buffer + offset);
+				++count;
+			}
+
+			if (static_cast<size_t>(size) < capacity)
+			{
+				break;
+			}
+		}
+
+		if (count == 0)
+		{
+			return false;
+		}
+
+		sample_count_ += count;
+		lux = total / static_cast<double>(count);
+		return true;
+	}
+
+	double IioAmbientLightSource::DecodeSample(const unsigned char* record) const
+	{
+		const unsigned char* bytes = record + scan_element_.offset;
+		std::uint64_t value = 0;
+		for (size_t index = 0; index < scan_element_.storage_bytes; ++index)
+		{
+			const size_t byte = scan_element_.is_big_endian ? index : scan_element_.storage_bytes - 1 - index;
+			value = value << 8 | bytes[byte];
+		}
+
+		value >>= scan_element_.shift;
+		const unsigned bits = scan_element_.bits;
+		if (bits < 64)
+		{
+			value &= (std::uint64_t{ 1 } << bits) - 1;
+		}
+
+		double sample = static_cast<double>(value);
+		if (scan_element_.is_signed && bits > 0 && bits < 64 && (value >> (bits - 1)) != 0)
+		{
+			sample -= static_cast<double>(std::uint64_t{ 1 } << bits);
+		}
+		else if (scan_element_.is_signed && bits == 64)
+		{
+			sample = static_cast<double>(static_cast<std::int64_t>(value));
+		}
+
+		return (sample + offset_) * scale_;
+	}
+}
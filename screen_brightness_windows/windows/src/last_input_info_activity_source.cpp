@@ -0,0 +1,21 @@
+#include "../include/screen_brightness_windows/last_input_info_activity_source.h"
+
+#include <chrono>
+
+namespace screen_brightness
+{
+	Clock::time_point LastInputInfoActivitySource::GetLastInputTime()
+	{
+		const Clock::time_point now = clock_.Now();
+		LASTINPUTINFO info{};
+		info.cbSize = sizeof(info);
+		if (!GetLastInputInfo(&info))
+		{
+			return now;
+		}
+
+		// both are tick counts, which wrap around after 49.7 days; the unsigned difference does not
+		const DWORD idle_milliseconds = GetTickCount() - info.dwTime;
+		return now - std::chrono::milliseconds(idle_milliseconds);
+	}
+}
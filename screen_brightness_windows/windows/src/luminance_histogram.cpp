@@ -0,0 +1,320 @@
+#include "../include/screen_brightness_windows/luminance_histogram.h"
+
+#include <algorithm>
+
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)
+#define SCREEN_BRIGHTNESS_HAS_X86_KERNELS
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+#endif
+
+#if defined(__ARM_NEON) || defined(_M_ARM64)
+#define SCREEN_BRIGHTNESS_HAS_NEON_KERNEL
+#include <arm_neon.h>
+#endif
+
+// the AVX2 kernel is compiled for AVX2 on its own, and only called once the processor is known to support it
+#if defined(SCREEN_BRIGHTNESS_HAS_X86_KERNELS) && (defined(__GNUC__) || defined(__clang__))
+#define SCREEN_BRIGHTNESS_TARGET_AVX2 __attribute__((target("avx2")))
+#else
+#define SCREEN_BRIGHTNESS_TARGET_AVX2
+#endif
+
+namespace screen_brightness
+{
+	namespace
+	{
+		// pixels converted at a time, so that the luma of a chunk stays in the L1 cache
+		constexpr std::size_t kChunkSize = 1024;
+
+		// BT.709 in 8 bit fixed point, summing to 256 so that white stays 255
+		struct LumaWeights
+		{
+			std::uint8_t first;
+
+			std::uint8_t second;
+
+			std::uint8_t third;
+		};
+
+		constexpr LumaWeights kRgbaWeights{ 54, 183, 19 };
+
+		constexpr LumaWeights kBgraWeights{ 19, 183, 54 };
+
+		using ConvertFunction = void (*)(const std::uint8_t* pixels, std::size_t count, LumaWeights weights, std::uint8_t* luma);
+
+		void ConvertScalar(const std::uint8_t* pixels, const std::size_t count, const LumaWeights weights, std::uint8_t* luma)
+		{
+			for (std::size_t index = 0; index < count; ++index)
+			{
+				const std::uint8_t* pixel = pixels + index * 4;
+				luma[index] = static_cast<std::uint8_t>((weights.first * pixel[0] + weights.second * pixel[1] + weights.third * pixel[2]) >> 8);
+			}
+		}
+
+#ifdef SCREEN_BRIGHTNESS_HAS_X86_KERNELS
+		// Weighted sums of 4 pixels: the 16 bit channels are multiplied and added in pairs, then the pairs of each
+		// pixel are added.
+		__m128i SumSse2(const std::uint8_t* pixels, const __m128i weights)
+		{
+			const __m128i zero = _mm_setzero_si128();
+			const __m128i value = _mm_loadu_si128(reinterpret_cast<const __m128i*>(pixels));
+			const __m128 low = _mm_castsi128_ps(_mm_madd_epi16(_mm_unpacklo_epi8(value, zero), weights));
+			const __m128 high = _mm_castsi128_ps(_mm_madd_epi16(_mm_unpackhi_epi8(value, zero), weights));
+			const __m128i first_pairs = _mm_castps_si128(_mm_shuffle_ps(low, high, _MM_SHUFFLE(2, 0, 2, 0)));
+			const __m128i second_pairs = _mm_castps_si128(_mm_shuffle_ps(low, high, _MM_SHUFFLE(3, 1, 3, 1)));
+			return _mm_srli_epi32(_mm_add_epi32(first_pairs, second_pairs), 8);
+		}
+
+		void ConvertSse2(const std::uint8_t* pixels, const std::size_t count, const LumaWeights weights, std::uint8_t* luma)
+		{
+			const __m128i packed_weights = _mm_setr_epi16(weights.first, weights.second, weights.third, 0, weights.first, weights.second, weights.third, 0);
+			std::size_t index = 0;
+			for (; index + 16 <= count; index += 16)
+			{
+				const std::uint8_t* block = pixels + index * 4;
+				const __m128i first = _mm_packs_epi32(SumSse2(block, packed_weights), SumSse2(block + 16, packed_weights));
+				const __m128i second = _mm_packs_epi32(SumSse2(block + 32, packed_weights), SumSse2(block + 48, packed_weights));
+				_mm_storeu_si128(reinterpret_cast<__m128i*>(luma + index), _mm_packus_epi16(first, second));
+			}
+
+			ConvertScalar(pixels + index * 4, count - index, weights, luma + index);
+		}
+
+		// As SumSse2, for 8 pixels; the 128 bit lanes keep the pixels in order.
+		SCREEN_BRIGHTNESS_TARGET_AVX2 __m256i SumAvx2(const std::uint8_t* pixels, const __m256i weights)
+		{
+			const __m256i zero = _mm256_setzero_si256();
+			const __m256i value = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(pixels));
+			const __m256 low = _mm256_castsi256_ps(_mm256_madd_epi16(_mm256_unpacklo_epi8(value, zero), weights));
+			const __m256 high = _mm256_castsi256_ps(_mm256_madd_epi16(_mm256_unpackhi_epi8(value, zero), weights));
+			const __m256i first_pairs = _mm256_castps_si256(_mm256_shuffle_ps(low, high, _MM_SHUFFLE(2, 0, 2, 0)));
+			const __m256i second_pairs = _mm256_castps_si256(_mm256_shuffle_ps(low, high, _MM_SHUFFLE(3, 1, 3, 1)));
+			return _mm256_srli_epi32(_mm256_add_epi32(first_pairs, second_pairs), 8);
+		}
+
+		SCREEN_BRIGHTNESS_TARGET_AVX2 void ConvertAvx2(const std::uint8_t* pixels, const std::size_t count, const LumaWeights weights, std::uint8_t* luma)
+		{
+			const __m256i packed_weights = _mm256_setr_epi16(weights.first, weights.second, weights.third, 0, weights.first, weights.second, weights.third, 0,
+				weights.first, weights.second, weights.third, 0, weights.first, weights.second, weights.third, 0);
+
+			// packing works within the lanes, which leaves groups of 4 pixels interleaved
+			const __m256i order = _mm256_setr_epi32(0, 4, 1, 5, 2, 6, 3, 7);
+			std::size_t index = 0;
+			for (; index + 32 <= count; index += 32)
+			{
+				const std::uint8_t* block = pixels + index * 4;
+				const __m256i first = _mm256_packs_epi32(SumAvx2(block, packed_weights), SumAvx2(block + 32, packed_weights));
+				const __m256i second = _mm256_packs_epi32(SumAvx2(block + 64, packed_weights), SumAvx2(block + 96, packed_weights));
+				const __m256i packed = _mm256_permutevar8x32_epi32(_mm256_packus_epi16(first, second), order);
+				_mm256_storeu_si256(reinterpret_cast<__m256i*>(luma + index), packed);
+			}
+
+			ConvertSse2(pixels + index * 4, count - index, weights, luma + index);
+		}
+
+		bool IsAvx2Supported()
+		{
+#if defined(__GNUC__) || defined(__clang__)
+			return __builtin_cpu_supports("avx2");
+#else
+			int registers[4] = {};
+			__cpuid(registers, 0);
+			if (registers[0] < 7)
+			{
+				return false;
+			}
+
+			// the operating system must save the AVX registers too
+			__cpuid(registers, 1);
+			const bool has_os_avx = (registers[2] & (1 << 27)) != 0 && (registers[2] & (1 << 28)) != 0 && (_xgetbv(0) & 0x6) == 0x6;
+			__cpuidex(registers, 7, 0);
+			return has_os_avx && (registers[1] & (1 << 5)) != 0;
+#endif
+		}
+#endif
+
+#ifdef SCREEN_BRIGHTNESS_HAS_NEON_KERNEL
+		void ConvertNeon(const std::uint8_t* pixels, const std::size_t count, const LumaWeights weights, std::uint8_t* luma)
+		{
+			const uint8x8_t first_weight = vdup_n_u8(weights.first);
+			const uint8x8_t second_weight = vdup_n_u8(weights.second);
+			const uint8x8_t third_weight = vdup_n_u8(weights.third);
+			std::size_t index = 0;
+			for (; index + 16 <= count; index += 16)
+			{
+				// loads 16 pixels with their channels deinterleaved
+				const uint8x16x4_t value = vld4q_u8(pixels + index * 4);
+				uint16x8_t low = vmull_u8(vget_low_u8(value.val[0]), first_weight);
+				low = vmlal_u8(low, vget_low_u8(value.val[1]), second_weight);
+				low = vmlal_u8(low, vget_low_u8(value.val[2]), third_weight);
+				uint16x8_t high = vmull_u8(vget_high_u8(value.val[0]), first_weight);
+				high = vmlal_u8(high, vget_high_u8(value.val[1]), second_weight);
+				high = vmlal_u8(high, vget_high_u8(value.val[2]), third_weight);
+				vst1q_u8(luma + index, vcombine_u8(vshrn_n_u16(low, 8), vshrn_n_u16(high, 8)));
+			}
+
+			ConvertScalar(pixels + index * 4, count - index, weights, luma + index);
+		}
+#endif
+
+		ConvertFunction GetConvertFunction(const LuminanceKernel kernel)
+		{
+			switch (kernel)
+			{
+			case LuminanceKernel::kScalar:
+				return ConvertScalar;
+#ifdef SCREEN_BRIGHTNESS_HAS_X86_KERNELS
+			case LuminanceKernel::kSse2:
+				return ConvertSse2;
+			case LuminanceKernel::kAvx2:
+				return IsLuminanceKernelSupported(kernel) ? ConvertAvx2 : nullptr;
+#endif
+#ifdef SCREEN_BRIGHTNESS_HAS_NEON_KERNEL
+			case LuminanceKernel::kNeon:
+				return ConvertNeon;
+#endif
+			default:
+				return nullptr;
+			}
+		}
+	}
+
+	double LuminanceHistogram::GetMean() const
+	{
+		if (sample_count == 0)
+		{
+			return 0;
+		}
+
+		std::uint64_t sum = 0;
+		for (std::size_t bin = 0; bin < kBinCount; ++bin)
+		{
+			sum += bin * bins[bin];
+		}
+
+		return static_cast<double>(sum) / static_cast<double>(sample_count) / (kBinCount - 1);
+	}
+
+	double LuminanceHistogram::GetPercentile(const double fraction) const
+	{
+		const double threshold = std::clamp(fraction, 0.0, 1.0) * static_cast<double>(sample_count);
+		std::uint64_t cumulative_count = 0;
+		for (std::size_t bin = 0; bin < kBinCount; ++bin)
+		{
+			cumulative_count += bins[bin];
+			if (cumulative_count > 0 && static_cast<double>(cumulative_count) >= threshold)
+			{
+				return static_cast<double>(bin) / (kBinCount - 1);
+			}
+		}
+
+		return 0;
+	}
+
+	const char* GetLuminanceKernelName(const LuminanceKernel kernel)
+	{
+		switch (kernel)
+		{
+		case LuminanceKernel::kScalar:
+			return "scalar";
+		case LuminanceKernel::kSse2:
+			return "sse2";
+		case LuminanceKernel::kAvx2:
+			return "avx2";
+		case LuminanceKernel::kNeon:
+			return "neon";
+		default:
+			return "unknown";
+		}
+	}
+
+	bool IsLuminanceKernelSupported(const LuminanceKernel kernel)
+	{
+		switch (kernel)
+		{
+		case LuminanceKernel::kScalar:
+			return true;
+#ifdef SCREEN_BRIGHTNESS_HAS_X86_KERNELS
+		case LuminanceKernel::kSse2:
+			return true;
+		case LuminanceKernel::kAvx2:
+		{
+			static const bool is_supported = IsAvx2Supported();
+			return is_supported;
+		}
+#endif
+#ifdef SCREEN_BRIGHTNESS_HAS_NEON_KERNEL
+		case LuminanceKernel::kNeon:
+			return true;
+#endif
+		default:
+			return false;
+		}
+	}
+
+	LuminanceKernel GetBestLuminanceKernel()
+	{
+		static const LuminanceKernel kernel = []
+			{
+				for (const LuminanceKernel candidate : { LuminanceKernel::kAvx2, LuminanceKernel::kNeon, LuminanceKernel::kSse2 })
+				{
+					if (IsLuminanceKernelSupported(candidate))
+					{
+						return candidate;
+					}
+				}
+
+				return LuminanceKernel::kScalar;
+			}();
+		return kernel;
+	}
+
+	bool ComputeLuminanceHistogram(const FrameView& frame, const std::size_t row_step, LuminanceHistogram& histogram, const LuminanceKernel kernel)
+	{
+		histogram = LuminanceHistogram{};
+		const ConvertFunction convert = GetConvertFunction(kernel);
+		if (convert == nullptr || frame.pixels == nullptr || frame.width == 0 || frame.height == 0 || frame.stride < frame.width * 4 || row_step == 0)
+		{
+			return false;
+		}
+
+		// counted into 4 histograms in turn, so that runs of equal luma do not wait on the same counter
+		std::uint32_t partial_bins[4][LuminanceHistogram::kBinCount] = {};
+		std::uint8_t luma[kChunkSize];
+		const LumaWeights weights = frame.format == PixelFormat::kBgra8 ? kBgraWeights : kRgbaWeights;
+		for (std::size_t row = 0; row < frame.height; row += row_step)
+		{
+			const std::uint8_t* pixels = frame.pixels + row * frame.stride;
+			for (std::size_t column = 0; column < frame.width; column += kChunkSize)
+			{
+				const std::size_t count = std::min(kChunkSize, frame.width - column);
+				convert(pixels + column * 4, count, weights, luma);
+				std::size_t index = 0;
+				for (; index + 4 <= count; index += 4)
+				{
+					++partial_bins[0][luma[index]];
+					++partial_bins[1][luma[index + 1]];
+					++partial_bins[2][luma[index + 2]];
+					++partial_bins[3][luma[index + 3]];
+				}
+
+				for (; index < count; ++index)
+				{
+					++partial_bins[0][luma[index]];
+				}
+			}
+
+			histogram.sample_count += frame.width;
+		}
+
+		for (std::size_t bin = 0; bin < LuminanceHistogram::kBinCount; ++bin)
+		{
+			histogram.bins[bin] = partial_bins[0][bin] + partial_bins[1][bin] + partial_bins[2][bin] + partial_bins[3][bin];
+		}
+
+		return true;
+	}
+}
@@ -0,0 +1,269 @@
+#include "../include/screen_brightness_windows/mccs_capabilities.h"
+
+#include <algorithm>
+#include <limits>
+
+namespace screen_brightness
+{
+	namespace
+	{
+		bool IsHexDigit(const char character)
+		{
+			return (character >= '0' && character <= '9') || (character >= 'a' && character <= 'f') || (character >= 'A' && character <= 'F');
+		}
+
+		int GetHexDigitValue(const char character)
+		{
+			if (character <= '9')
+			{
+				return character - '0';
+			}
+
+			return (character | 0x20) - 'a' + 10;
+		}
+
+		bool IsTagCharacter(const char character)
+		{
+			return (character >= 'a' && character <= 'z') || (character >= 'A' && character <= 'Z') || (character >= '0' && character <= '9') ||
+				character == '_';
+		}
+
+		bool IsSpace(const char character)
+		{
+			return character == ' ' || character == '\t' || character == '\r' || character == '\n';
+		}
+
+		bool EqualsIgnoreCase(const std::string_view text, const std::string_view lowercase)
+		{
+			return text.size() == lowercase.size() && std::equal(text.begin(), text.end(), lowercase.begin(), [](const char a, const char b)
+				{
+					return (a >= 'A' && a <= 'Z' ? a | 0x20 : a) == b;
+				});
+		}
+
+		// Returns the position of the ')' closing the '(' at position, or the end of the text for a truncated string.
+		size_t FindGroupEnd(const std::string_view text, size_t position)
+		{
+			size_t depth = 0;
+			for (; position < text.size(); ++position)
+			{
+				if (text[position] == '(')
+				{
+					++depth;
+				}
+				else if (text[position] == ')' && --depth == 0)
+				{
+					return position;
+				}
+			}
+
+			return text.size();
+		}
+
+		// Reads the hex digits at position. A run of two digit tokens written without spaces in between is split
+		// into pairs; a single digit value is read as is. Other odd runs are malformed and yield nothing.
+		template <typename Callback>
+		size_t ReadHexRun(const std::string_view text, size_t position, const bool is_single_digit_allowed, Callback callback)
+		{
+			// some vendors write C style hex literals
+			if (text[position] == '0' && position + 2 < text.size() && (text[position + 1] | 0x20) == 'x' && IsHexDigit(text[position + 2]))
+			{
+				position += 2;
+			}
+
+			const size_t start = position;
+			while (position < text.size() && IsHexDigit(text[position]))
+			{
+				++position;
+			}
+
+			const size_t length = position - start;
+			if (length == 1 && is_single_digit_allowed)
+			{
+				callback(static_cast<std::uint8_t>(GetHexDigitValue(text[start])));
+			}
+			else if (length % 2 == 0)
+			{
+				for (size_t index = start; index < position; index += 2)
+				{
+					callback(static_cast<std::uint8_t>((GetHexDigitValue(text[index]) << 4) | GetHexDigitValue(text[index + 1])));
+				}
+			}
+
+			return position;
+		}
+	}
+
+	bool MccsCapabilities::Parse(const std::string_view capabilities)
+	{
+		Clear();
+
+		// every value takes at least one character, so the value array never grows while parsing
+		values_.reserve(capabilities.size());
+
+		bool has_vcp_list = false;
+		size_t position = 0;
+		while (position < capabilities.size())
+		{
+			// outer parentheses, stray characters and closing parentheses of truncated groups are skipped
+			if (!IsTagCharacter(capabilities[position]))
+			{
+				++position;
+				continue;
+			}
+
+			const size_t tag_start = position;
+			while (position < capabilities.size() && IsTagCharacter(capabilities[position]))
+			{
+				++position;
+			}
+
+			const std::string_view tag = capabilities.substr(tag_start, position - tag_start);
+			while (position < capabilities.size() && IsSpace(capabilities[position]))
+			{
+				++position;
+			}
+
+			if (position == capabilities.size() || capabilities[position] != '(')
+			{
+				continue;
+			}
+
+			const size_t group_end = FindGroupEnd(capabilities, position);
+			const std::string_view content = capabilities.substr(position + 1, group_end - position - 1);
+			position = std::min(group_end + 1, capabilities.size());
+
+			// other sections, such as vcpname or cmds, may contain anything and are not looked into
+			if (EqualsIgnoreCase(tag, "vcp"))
+			{
+				ParseVcpList(content);
+				has_vcp_list = true;
+			}
+			else if (EqualsIgnoreCase(tag, "prot") && protocol_.empty())
+			{
+				protocol_ = content;
+			}
+			else if (EqualsIgnoreCase(tag, "type") && type_.empty())
+			{
+				type_ = content;
+			}
+			else if (EqualsIgnoreCase(tag, "model") && model_.empty())
+			{
+				model_ = content;
+			}
+			else if (EqualsIgnoreCase(tag, "mccs_ver") && mccs_version_.empty())
+			{
+				mccs_version_ = content;
+			}
+		}
+
+		return has_vcp_list;
+	}
+
+	VcpValueList MccsCapabilities::GetAllowedValues(const VcpCode code) const
+	{
+		const ValueRange& range = value_ranges_[code];
+		if (range.size == 0)
+		{
+			return {};
+		}
+
+		return VcpValueList{ values_.data() + range.offset, range.size };
+	}
+
+	bool MccsCapabilities::IsAllowed(const VcpCode code, const unsigned long value) const
+	{
+		if (!IsSupported(code))
+		{
+			return false;
+		}
+
+		const VcpValueList values = GetAllowedValues(code);
+		return values.empty() || std::find(values.begin(), values.end(), value) != values.end();
+	}
+
+	void MccsCapabilities::Clear()
+	{
+		supported_codes_.reset();
+		value_ranges_.fill(ValueRange{});
+		values_.clear();
+		protocol_ = {};
+		type_ = {};
+		model_ = {};
+		mccs_version_ = {};
+	}
+
+	void MccsCapabilities::ParseVcpList(const std::string_view list)
+	{
+		// a value list belongs to the code right before it
+		int last_code = -1;
+		size_t position = 0;
+		while (position < list.size())
+		{
+			const char character = list[position];
+			if (IsHexDigit(character))
+			{
+				last_code = -1;
+				position = ReadHexRun(list, position, false, [this, &last_code](const std::uint8_t code)
+					{
+						supported_codes_[code] = true;
+						last_code = code;
+					});
+				continue;
+			}
+
+			if (character == '(')
+			{
+				const size_t group_end = FindGroupEnd(list, position);
+				if (last_code != -1)
+				{
+					ParseValueList(static_cast<VcpCode>(last_code), list.substr(position + 1, group_end - position - 1));
+				}
+
+				last_code = -1;
+				position = std::min(group_end + 1, list.size());
+				continue;
+			}
+
+			if (!IsSpace(character))
+			{
+				last_code = -1;
+			}
+
+			++position;
+		}
+	}
+
+	void MccsCapabilities::ParseValueList(const VcpCode code, const std::string_view list)
+	{
+		// a code listed twice keeps its first value list
+		ValueRange& range = value_ranges_[code];
+		if (range.size != 0)
+		{
+			return;
+		}
+
+		const size_t offset = values_.size();
+		size_t position = 0;
+		while (position < list.size())
+		{
+			if (IsHexDigit(list[position]))
+			{
+				position = ReadHexRun(list, position, true, [this, offset](const std::uint8_t value)
+					{
+						if (values_.size() - offset < std::numeric_limits<std::uint16_t>::max())
+						{
+							values_.push_back(value);
+						}
+					});
+				continue;
+			}
+
+			// nested groups, as some vendors describe sub-values, are not part of the value list
+			position = list[position] == '(' ? std::min(FindGroupEnd(list, position) + 1, list.size()) : position + 1;
+		}
+
+		range.offset = static_cast<std::uint32_t>(offset);
+		range.size = static_cast<std::uint16_t>(values_.size() - offset);
+	}
+}
@@ -0,0 +1,69 @@
+#include "../include/screen_brightness_windows/monitor_backend.h"
+
+namespace screen_brightness
+{
+	const char* GetMonitorStatusMessage(const MonitorStatus status)
+	{
+		switch (status)
+		{
+		case MonitorStatus::kOk:
+			return "Success";
+
+		case MonitorStatus::kEnumerateMonitorsFailed:
+			return "Problem enumerating monitors";
+
+		case MonitorStatus::kGetNumberOfMonitorsFailed:
+			return "Problem getting numbers of monitor";
+
+		case MonitorStatus::kNoMonitors:
+			return "No monitors";
+
+		case MonitorStatus::kGetPhysicalMonitorsFailed:
+			return "Problem getting physical monitors";
+
+		case MonitorStatus::kGetBrightnessFailed:
+			return "Problem getting monitor brightness";
+
+		case MonitorStatus::kSetBrightnessFailed:
+			return "Problem setting monitor brightness";
+
+		case MonitorStatus::kPreempted:
+			return "Superseded by a newer request";
+
+		case MonitorStatus::kGetVcpFeatureFailed:
+			return "Problem getting monitor VCP feature";
+
+		case MonitorStatus::kSetVcpFeatureFailed:
+			return "Problem setting monitor VCP feature";
+
+		case MonitorStatus::kGetCapabilitiesFailed:
+			return "Problem getting monitor capabilities";
+
+		case MonitorStatus::kUnsupported:
+			return "Not supported by the monitor";
+
+		case MonitorStatus::kGetEdidFailed:
+			return "Problem getting monitor EDID";
+
+		case MonitorStatus::kSharedMemoryFailed:
+			return "Problem opening the shared brightness lease table";
+
+		case MonitorStatus::kBrokerFailed:
+			return "Problem talking to the brightness broker";
+
+		case MonitorStatus::kTraceFailed:
+			return "Problem reading or writing the monitor trace";
+
+		case MonitorStatus::kTimedOut:
+			return "Not completed in time";
+
+		case MonitorStatus::kJournalFailed:
+			return "Problem opening the brightness restore journal";
+
+		case MonitorStatus::kCancelled:
+			return "Cancelled";
+		}
+
+		return "Unknown monitor error";
+	}
+}
@@ -0,0 +1,719 @@
+#include "../include/screen_brightness_windows/monitor_trace.h"
+
+#include <algorithm>
+#include <chrono>
+#include <tuple>
+#include <utility>
+
+namespace screen_brightness
+{
+	namespace
+	{
+		// "SBTRACE" and the format version
+		constexpr std::uint8_t kTraceHeader[] = { 'S', 'B', 'T', 'R', 'A', 'C', 'E', 1 };
+
+		std::int64_t ToNanoseconds(const Clock::duration duration)
+		{
+			return std::chrono::duration_cast<std::chrono::nanoseconds>(duration).count();
+		}
+
+		Clock::duration FromNanoseconds(const std::int64_t nanoseconds)
+		{
+			return std::chrono::duration_cast<Clock::duration>(std::chrono::nanoseconds(nanoseconds));
+		}
+
+		void WriteVarint(std::vector<std::uint8_t>& output, std::uint64_t value)
+		{
+			while (value >= 0x80)
+			{
+				output.push_back(static_cast<std::uint8_t>(value | 0x80));
+				value >>= 7;
+			}
+
+			output.push_back(static_cast<std::uint8_t>(value));
+		}
+
+		// zigzag encoded, so that small negative values stay short
+		void WriteSigned(std::vector<std::uint8_t>& output, const std::int64_t value)
+		{
+			WriteVarint(output, (static_cast<std::uint64_t>(value) << 1) ^ static_cast<std::uint64_t>(value >> 63));
+		}
+
+		template <typename Container>
+		void WriteSequence(std::vector<std::uint8_t>& output, const Container& sequence)
+		{
+			WriteVarint(output, sequence.size());
+			output.insert(output.end(), sequence.begin(), sequence.end());
+		}
+
+		class TraceReader
+		{
+		public:
+			TraceReader(const std::uint8_t* data, const std::size_t size) : data_(data), size_(size)
+			{
+			}
+
+			[[nodiscard]] bool is_at_end() const { return offset_ == size_; }
+
+			// Whether a read ran past the end of the data.
+			[[nodiscard]] bool is_truncated() const { return is_truncated_; }
+
+			bool ReadByte(std::uint8_t& value)
+			{
+				if (offset_ == size_)
+				{
+					is_truncated_ = true;
+					return false;
+				}
+
+				value = data_[offset_++];
+				return true;
+			}
+
+			bool ReadVarint(std::uint64_t& value)
+			{
+				value = 0;
+				for (unsigned shift = 0; shift < 64; shift += 7)
+				{
+					std::uint8_t byte = 0;
+					if (!ReadByte(byte))
+					{
+						return false;
+					}
+
+					value |= static_cast<std::uint64_t>(byte & 0x7f) << shift;
+					if ((byte & 0x80) == 0)
+					{
+						return true;
+					}
+				}
+
+				return false;
+			}
+
+			bool ReadSigned(std::int64_t& value)
+			{
+				std::uint64_t encoded = 0;
+				if (!ReadVarint(encoded))
+				{
+					return false;
+				}
+
+				value = static_cast<std::int64_t>(encoded >> 1) ^ -static_cast<std::int64_t>(encoded & 1);
+				return true;
+			}
+
+			template <typename Container>
+			bool ReadSequence(Container& sequence)
+			{
+				std::uint64_t size = 0;
+				if (!ReadVarint(size))
+				{
+					return false;
+				}
+
+				if (size > size_ - offset_)
+				{
+					is_truncated_ = true;
+					return false;
+				}
+
+				sequence.assign(data_ + offset_, data_ + offset_ + size);
+				offset_ += static_cast<std::size_t>(size);
+				return true;
+			}
+
+		private:
+			const std::uint8_t* data_;
+
+			const std::size_t size_;
+
+			std::size_t offset_ = 0;
+
+			bool is_truncated_ = false;
+		};
+
+		void EncodeRecord(const MonitorTraceRecord& record, const Clock::duration previous_start, std::vector<std::uint8_t>& output)
+		{
+			const bool is_ok = record.status == MonitorStatus::kOk;
+			output.push_back(static_cast<std::uint8_t>(record.call));
+			output.push_back(static_cast<std::uint8_t>(record.status));
+			// calls from several threads are recorded as they finish, so a start may precede the previous one
+			WriteSigned(output, ToNanoseconds(record.start - previous_start));
+			WriteVarint(output, static_cast<std::uint64_t>(ToNanoseconds(record.duration)));
+			switch (record.call)
+			{
+			case MonitorTraceCall::kEnumerateDisplays:
+				if (is_ok)
+				{
+					WriteVarint(output, record.displays.size());
+					for (const DisplayInfo& display : record.displays)
+					{
+						WriteVarint(output, display.handle);
+						WriteSequence(output, display.id);
+						WriteSequence(output, display.name);
+					}
+				}
+
+				break;
+
+			case MonitorTraceCall::kGetPrimaryDisplay:
+				WriteVarint(output, record.display);
+				break;
+
+			case MonitorTraceCall::kGetScreenBrightness:
+				WriteVarint(output, record.display);
+				if (is_ok)
+				{
+					WriteSigned(output, record.values[0]);
+					WriteSigned(output, record.values[1]);
+					WriteSigned(output, record.values[2]);
+				}
+
+				break;
+
+			case MonitorTraceCall::kSetScreenBrightness:
+				WriteVarint(output, record.display);
+				WriteSigned(output, record.values[0]);
+				break;
+
+			case MonitorTraceCall::kGetVcpFeature:
+				WriteVarint(output, record.display);
+				output.push_back(record.code);
+				if (is_ok)
+				{
+					WriteVarint(output, static_cast<std::uint64_t>(record.values[0]));
+					WriteVarint(output, static_cast<std::uint64_t>(record.values[1]));
+				}
+
+				break;
+
+			case MonitorTraceCall::kSetVcpFeature:
+				WriteVarint(output, record.display);
+				output.push_back(record.code);
+				WriteVarint(output, static_cast<std::uint64_t>(record.values[0]));
+				break;
+
+			case MonitorTraceCall::kGetCapabilitiesString:
+				WriteVarint(output, record.display);
+				if (is_ok)
+				{
+					WriteSequence(output, record.text);
+				}
+
+				break;
+
+			case MonitorTraceCall::kGetEdid:
+				WriteVarint(output, record.display);
+				if (is_ok)
+				{
+					WriteSequence(output, record.bytes);
+				}
+
+				break;
+			}
+		}
+
+		// Returns false at the end of the data and for a record which is not valid.
+		bool DecodeRecord(TraceReader& reader, Clock::duration& previous_start, MonitorTraceRecord& record)
+		{
+			std::uint8_t call = 0, status = 0;
+			std::int64_t start = 0;
+			std::uint64_t duration = 0, display = 0;
+			if (!reader.ReadByte(call) || !reader.ReadByte(status) || !reader.ReadSigned(start) || !reader.ReadVarint(duration))
+			{
+				return false;
+			}
+
+			if (call < static_cast<std::uint8_t>(MonitorTraceCall::kEnumerateDisplays) || call > static_cast<std::uint8_t>(MonitorTraceCall::kGetEdid) ||
+				status > static_cast<std::uint8_t>(MonitorStatus::kCancelled))
+			{
+				return false;
+			}
+
+			record.call = static_cast<MonitorTraceCall>(call);
+			record.status = static_cast<MonitorStatus>(status);
+			record.start = previous_start + FromNanoseconds(start);
+			record.duration = FromNanoseconds(static_cast<std::int64_t>(duration));
+			previous_start = record.start;
+			const bool is_ok = record.status == MonitorStatus::kOk;
+			if (record.call == MonitorTraceCall::kEnumerateDisplays)
+			{
+				std::uint64_t count = 0;
+				if (is_ok && !reader.ReadVarint(count))
+				{
+					return false;
+				}
+
+				for (std::uint64_t index = 0; index < count; ++index)
+				{
+					DisplayInfo info;
+					if (!reader.ReadVarint(display) || !reader.ReadSequence(info.id) || !reader.ReadSequence(info.name))
+					{
+						return false;
+					}
+
+					info.handle = static_cast<DisplayHandle>(display);
+					record.displays.push_back(std::move(info));
+				}
+
+				return true;
+			}
+
+			if (!reader.ReadVarint(display))
+			{
+				return false;
+			}
+
+			record.display = static_cast<DisplayHandle>(display);
+			std::uint64_t value = 0;
+			switch (record.call)
+			{
+			case MonitorTraceCall::kGetScreenBrightness:
+				return !is_ok || (reader.ReadSigned(record.values[0]) && reader.ReadSigned(record.values[1]) && reader.ReadSigned(record.values[2]));
+
+			case MonitorTraceCall::kSetScreenBrightness:
+				return reader.ReadSigned(record.values[0]);
+
+			case MonitorTraceCall::kGetVcpFeature:
+				if (!reader.ReadByte(record.code))
+				{
+					return false;
+				}
+
+				for (int index = 0; is_ok && index < 2; ++index)
+				{
+					if (!reader.ReadVarint(value))
+					{
+						return false;
+					}
+
+					record.values[index] = static_cast<std::int64_t>(value);
+				}
+
+				return true;
+
+			case MonitorTraceCall::kSetVcpFeature:
+				if (!reader.ReadByte(record.code) || !reader.ReadVarint(value))
+				{
+					return false;
+				}
+
+				record.values[0] = static_cast<std::int64_t>(value);
+				return true;
+
+			case MonitorTraceCall::kGetCapabilitiesString:
+				return !is_ok || reader.ReadSequence(record.text);
+
+			case MonitorTraceCall::kGetEdid:
+				return !is_ok || reader.ReadSequence(record.bytes);
+
+			default:
+				return true;
+			}
+		}
+
+		MonitorStatus GetUnrecordedStatus(const MonitorTraceCall call)
+		{
+			switch (call)
+			{
+			case MonitorTraceCall::kGetScreenBrightness:
+				return MonitorStatus::kGetBrightnessFailed;
+
+			case MonitorTraceCall::kSetScreenBrightness:
+				return MonitorStatus::kSetBrightnessFailed;
+
+			case MonitorTraceCall::kGetVcpFeature:
+				return MonitorStatus::kGetVcpFeatureFailed;
+
+			case MonitorTraceCall::kSetVcpFeature:
+				return MonitorStatus::kSetVcpFeatureFailed;
+
+			case MonitorTraceCall::kGetCapabilitiesString:
+				return MonitorStatus::kGetCapabilitiesFailed;
+
+			case MonitorTraceCall::kGetEdid:
+				return MonitorStatus::kGetEdidFailed;
+
+			default:
+				return MonitorStatus::kEnumerateMonitorsFailed;
+			}
+		}
+	}
+
+	MonitorStatus LoadMonitorTrace(const std::string& path, std::vector<MonitorTraceRecord>& records)
+	{
+		std::FILE* file = std::fopen(path.c_str(), "rb");
+		if (file == nullptr)
+		{
+			return MonitorStatus::kTraceFailed;
+		}
+
+		std::vector<std::uint8_t> trace;
+		std::uint8_t chunk[4096];
+		size_t size = 0;
+		while ((size = std::fread(chunk, 1, sizeof(chunk), file)) > 0)
+		{
+			trace.insert(trace.end(), chunk, chunk + size);
+		}
+
+		const bool is_failed = std::ferror(file) != 0;
+		std::fclose(file);
+		return is_failed ? MonitorStatus::kTraceFailed : DecodeMonitorTrace(trace, records);
+	}
+
+	MonitorStatus DecodeMonitorTrace(const std::vector<std::uint8_t>& trace, std::vector<MonitorTraceRecord>& records)
+	{
+		records.clear();
+		if (trace.size() < sizeof(kTraceHeader) || !std::equal(std::begin(kTraceHeader), std::end(kTraceHeader), trace.begin()))
+		{
+			return MonitorStatus::kTraceFailed;
+		}
+
+		TraceReader reader(trace.data() + sizeof(kTraceHeader), trace.size() - sizeof(kTraceHeader));
+		Clock::duration previous_start{};
+		while (!reader.is_at_end())
+		{
+			MonitorTraceRecord record;
+			if (!DecodeRecord(reader, previous_start, record))
+			{
+				// a recording which crashed ends in part of a record
+				return reader.is_truncated() ? MonitorStatus::kOk : MonitorStatus::kTraceFailed;
+			}
+
+			records.push_back(std::move(record));
+		}
+
+		return MonitorStatus::kOk;
+	}
+
+	RecordingMonitorBackend::RecordingMonitorBackend(MonitorBackend& backend, Clock& clock) : backend_(backend), clock_(clock)
+	{
+	}
+
+	RecordingMonitorBackend::~RecordingMonitorBackend()
+	{
+		Close();
+	}
+
+	MonitorStatus RecordingMonitorBackend::Open(const std::string& path)
+	{
+		Close();
+		std::lock_guard<std::mutex> lock(mutex_);
+		file_ = std::fopen(path.c_str(), "wb");
+		if (file_ == nullptr)
+		{
+			return MonitorStatus::kTraceFailed;
+		}
+
+		// room for a full buffer and the record which fills it, so that brightness records never allocate
+		buffer_.clear();
+		buffer_.reserve(2 * kBufferSize);
+		buffer_.insert(buffer_.end(), std::begin(kTraceHeader), std::end(kTraceHeader));
+		start_time_ = clock_.Now();
+		previous_start_ = Clock::duration::zero();
+		record_count_ = 0;
+		return WriteBuffer() ? MonitorStatus::kOk : MonitorStatus::kTraceFailed;
+	}
+
+	MonitorStatus RecordingMonitorBackend::Flush()
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+		return WriteBuffer() ? MonitorStatus::kOk : MonitorStatus::kTraceFailed;
+	}
+
+	void RecordingMonitorBackend::Close()
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+		if (file_ != nullptr)
+		{
+			(void)WriteBuffer();
+			std::fclose(file_);
+			file_ = nullptr;
+		}
+	}
+
+	size_t RecordingMonitorBackend::record_count() const
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+		return record_count_;
+	}
+
+	MonitorStatus RecordingMonitorBackend::EnumerateDisplays(std::vector<DisplayInfo>& displays)
+	{
+		MonitorTraceRecord record;
+		record.call = MonitorTraceCall::kEnumerateDisplays;
+		const Clock::time_point start = clock_.Now();
+		record.status = backend_.EnumerateDisplays(displays);
+		record.displays = displays;
+		Append(record, start);
+		return record.status;
+	}
+
+	DisplayHandle RecordingMonitorBackend::GetPrimaryDisplay()
+	{
+		MonitorTraceRecord record;
+		record.call = MonitorTraceCall::kGetPrimaryDisplay;
+		const Clock::time_point start = clock_.Now();
+		record.display = backend_.GetPrimaryDisplay();
+		Append(record, start);
+		return record.display;
+	}
+
+	MonitorStatus RecordingMonitorBackend::GetScreenBrightness(const DisplayHandle display, long& minimum_screen_brightness, long& screen_brightness, long& maximum_screen_brightness)
+	{
+		MonitorTraceRecord record;
+		record.call = MonitorTraceCall::kGetScreenBrightness;
+		record.display = display;
+		const Clock::time_point start = clock_.Now();
+		record.status = backend_.GetScreenBrightness(display, minimum_screen_brightness, screen_brightness, maximum_screen_brightness);
+		record.values[0] = minimum_screen_brightness;
+		record.values[1] = screen_brightness;
+		record.values[2] = maximum_screen_brightness;
+		Append(record, start);
+		return record.status;
+	}
+
+	MonitorStatus RecordingMonitorBackend::SetScreenBrightness(const DisplayHandle display, const long screen_brightness)
+	{
+		MonitorTraceRecord record;
+		record.call = MonitorTraceCall::kSetScreenBrightness;
+		record.display = display;
+		record.values[0] = screen_brightness;
+		const Clock::time_point start = clock_.Now();
+		record.status = backend_.SetScreenBrightness(display, screen_brightness);
+		Append(record, start);
+		return record.status;
+	}
+
+	MonitorStatus RecordingMonitorBackend::GetVcpFeature(const DisplayHandle display, const VcpCode code, unsigned long& current_value, unsigned long& maximum_value)
+	{
+		MonitorTraceRecord record;
+		record.call = MonitorTraceCall::kGetVcpFeature;
+		record.display = display;
+		record.code = code;
+		const Clock::time_point start = clock_.Now();
+		record.status = backend_.GetVcpFeature(display, code, current_value, maximum_value);
+		record.values[0] = static_cast<std::int64_t>(current_value);
+		record.values[1] = static_cast<std::int64_t>(maximum_value);
+		Append(record, start);
+		return record.status;
+	}
+
+	MonitorStatus RecordingMonitorBackend::SetVcpFeature(const DisplayHandle display, const VcpCode code, const unsigned long value)
+	{
+		MonitorTraceRecord record;
+		record.call = MonitorTraceCall::kSetVcpFeature;
+		record.display = display;
+		record.code = code;
+		record.values[0] = static_cast<std::int64_t>(value);
+		const Clock::time_point start = clock_.Now();
+		record.status = backend_.SetVcpFeature(display, code, value);
+		Append(record, start);
+		return record.status;
+	}
+
+	MonitorStatus RecordingMonitorBackend::GetCapabilitiesString(const DisplayHandle display, std::string& capabilities)
+	{
+		MonitorTraceRecord record;
+		record.call = MonitorTraceCall::kGetCapabilitiesString;
+		record.display = display;
+		const Clock::time_point start = clock_.Now();
+		record.status = backend_.GetCapabilitiesString(display, capabilities);
+		record.text = capabilities;
+		Append(record, start);
+		return record.status;
+	}
+
+	MonitorStatus RecordingMonitorBackend::GetEdid(const DisplayHandle display, std::vector<std::uint8_t>& edid)
+	{
+		MonitorTraceRecord record;
+		record.call = MonitorTraceCall::kGetEdid;
+		record.display = display;
+		const Clock::time_point start = clock_.Now();
+		record.status = backend_.GetEdid(display, edid);
+		record.bytes = edid;
+		Append(record, start);
+		return record.status;
+	}
+
+	void RecordingMonitorBackend::Append(MonitorTraceRecord& record, const Clock::time_point start)
+	{
+		const Clock::time_point end = clock_.Now();
+		std::lock_guard<std::mutex> lock(mutex_);
+		if (file_ == nullptr)
+		{
+			return;
+		}
+
+		record.start = start - start_time_;
+		record.duration = end - start;
+		EncodeRecord(record, previous_start_, buffer_);
+		previous_start_ = record.start;
+		++record_count_;
+		if (buffer_.size() >= kBufferSize && !WriteBuffer())
+		{
+			// a trace with a hole would replay wrong, so stop it where it is
+			std::fclose(file_);
+			file_ = nullptr;
+		}
+	}
+
+	bool RecordingMonitorBackend::WriteBuffer()
+	{
+		if (file_ == nullptr)
+		{
+			return false;
+		}
+
+		const bool is_written = std::fwrite(buffer_.data(), 1, buffer_.size(), file_) == buffer_.size() && std::fflush(file_) == 0;
+		buffer_.clear();
+		return is_written;
+	}
+
+	bool ReplayMonitorBackend::Key::operator<(const Key& other) const
+	{
+		return std::tie(call, display, code) < std::tie(other.call, other.display, other.code);
+	}
+
+	ReplayMonitorBackend::ReplayMonitorBackend(std::vector<MonitorTraceRecord> records, Clock& clock) : records_(std::move(records)), clock_(clock)
+	{
+		for (size_t index = 0; index < records_.size(); ++index)
+		{
+			const MonitorTraceRecord& record = records_[index];
+			const bool is_display_call = record.call != MonitorTraceCall::kEnumerateDisplays && record.call != MonitorTraceCall::kGetPrimaryDisplay;
+			queues_[Key{ record.call, is_display_call ? record.display : 0, record.code }].records.push_back(index);
+		}
+	}
+
+	size_t ReplayMonitorBackend::unmatched_count() const
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+		return unmatched_count_;
+	}
+
+	MonitorStatus ReplayMonitorBackend::EnumerateDisplays(std::vector<DisplayInfo>& displays)
+	{
+		const MonitorTraceRecord* record = Replay(MonitorTraceCall::kEnumerateDisplays, 0, 0);
+		if (record == nullptr)
+		{
+			return GetUnrecordedStatus(MonitorTraceCall::kEnumerateDisplays);
+		}
+
+		displays = record->displays;
+		return record->status;
+	}
+
+	DisplayHandle ReplayMonitorBackend::GetPrimaryDisplay()
+	{
+		const MonitorTraceRecord* record = Replay(MonitorTraceCall::kGetPrimaryDisplay, 0, 0);
+		return record == nullptr ? 0 : record->display;
+	}
+
+	MonitorStatus ReplayMonitorBackend::GetScreenBrightness(const DisplayHandle display, long& minimum_screen_brightness, long& screen_brightness, long& maximum_screen_brightness)
+	{
+		const MonitorTraceRecord* record = Replay(MonitorTraceCall::kGetScreenBrightness, display, 0);
+		if (record == nullptr)
+		{
+			return GetUnrecordedStatus(MonitorTraceCall::kGetScreenBrightness);
+		}
+
+		if (record->status == MonitorStatus::kOk)
+		{
+			minimum_screen_brightness = static_cast<long>(record->values[0]);
+			screen_brightness = static_cast<long>(record->values[1]);
+			maximum_screen_brightness = static_cast<long>(record->values[2]);
+		}
+
+		return record->status;
+	}
+
+	MonitorStatus ReplayMonitorBackend::SetScreenBrightness(const DisplayHandle display, long)
+	{
+		const MonitorTraceRecord* record = Replay(MonitorTraceCall::kSetScreenBrightness, display, 0);
+		return record == nullptr ? GetUnrecordedStatus(MonitorTraceCall::kSetScreenBrightness) : record->status;
+	}
+
+	MonitorStatus ReplayMonitorBackend::GetVcpFeature(const DisplayHandle display, const VcpCode code, unsigned long& current_value, unsigned long& maximum_value)
+	{
+		const MonitorTraceRecord* record = Replay(MonitorTraceCall::kGetVcpFeature, display, code);
+		if (record == nullptr)
+		{
+			return GetUnrecordedStatus(MonitorTraceCall::kGetVcpFeature);
+		}
+
+		if (record->status == MonitorStatus::kOk)
+		{
+			current_value = static_cast<unsigned long>(record->values[0]);
+			maximum_value = static_cast<unsigned long>(record->values[1]);
+		}
+
+		return record->status;
+	}
+
+	MonitorStatus ReplayMonitorBackend::SetVcpFeature(const DisplayHandle display, const VcpCode code, unsigned long)
+	{
+		const MonitorTraceRecord* record = Replay(MonitorTraceCall::kSetVcpFeature, display, code);
+		return record == nullptr ? GetUnrecordedStatus(MonitorTraceCall::kSetVcpFeature) : record->status;
+	}
+
+	MonitorStatus ReplayMonitorBackend::GetCapabilitiesString(const DisplayHandle display, std::string& capabilities)
+	{
+		const MonitorTraceRecord* record = Replay(MonitorTraceCall::kGetCapabilitiesString, display, 0);
+		if (record == nullptr)
+		{
+			return GetUnrecordedStatus(MonitorTraceCall::kGetCapabilitiesString);
+		}
+
+		if (record->status == MonitorStatus::kOk)
+		{
+			capabilities = record->text;
+		}
+
+		return record->status;
+	}
+
+	MonitorStatus ReplayMonitorBackend::GetEdid(const DisplayHandle display, std::vector<std::uint8_t>& edid)
+	{
+		const MonitorTraceRecord* record = Replay(MonitorTraceCall::kGetEdid, display, 0);
+		if (record == nullptr)
+		{
+			return GetUnrecordedStatus(MonitorTraceCall::kGetEdid);
+		}
+
+		if (record->status == MonitorStatus::kOk)
+		{
+			edid = record->bytes;
+		}
+
+		return record->status;
+	}
+
+	const MonitorTraceRecord* ReplayMonitorBackend::Replay(const MonitorTraceCall call, const DisplayHandle display, const VcpCode code)
+	{
+		const MonitorTraceRecord* record = nullptr;
+		{
+			std::lock_guard<std::mutex> lock(mutex_);
+			const auto iterator = queues_.find(Key{ call, display, code });
+			if (iterator == queues_.end())
+			{
+				++unmatched_count_;
+				return nullptr;
+			}
+
+			Queue& queue = iterator->second;
+			if (queue.next < queue.records.size())
+			{
+				record = &records_[queue.records[queue.next++]];
+			}
+			else
+			{
+				++unmatched_count_;
+				record = &records_[queue.records.back()];
+			}
+		}
+
+		clock_.SleepUntil(clock_.Now() + record->duration);
+		return record;
+	}
+}
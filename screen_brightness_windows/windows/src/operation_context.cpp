@@ -0,0 +1,91 @@
+#include "../include/screen_brightness_windows/operation_context.h"
+
+#include <chrono>
+#include <utility>
+
+namespace screen_brightness
+{
+	namespace
+	{
+		thread_local OperationContext* current_context = nullptr;
+	}
+
+	OperationContext::Scope::Scope(OperationContext& context) : previous_(current_context)
+	{
+		current_context = &context;
+	}
+
+	OperationContext::Scope::~Scope()
+	{
+		current_context = previous_;
+	}
+
+	OperationContext::OperationContext(const std::int64_t id, const Clock::time_point deadline) : id_(id), deadline_(deadline)
+	{
+	}
+
+	OperationContext* OperationContext::Current()
+	{
+		return current_context;
+	}
+
+	void OperationContext::Cancel()
+	{
+		is_cancelled_.store(true, std::memory_order_release);
+		std::lock_guard<std::mutex> lock(mutex_);
+		if (cancel_callback_)
+		{
+			cancel_callback_();
+		}
+	}
+
+	MonitorStatus OperationContext::GetStatus() const
+	{
+		if (is_cancelled())
+		{
+			return MonitorStatus::kCancelled;
+		}
+
+		return deadline_ != kNoDeadline && std::chrono::steady_clock::now() >= deadline_ ? MonitorStatus::kTimedOut : MonitorStatus::kOk;
+	}
+
+	void OperationContext::SetCancelCallback(std::function<void()> callback)
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+		cancel_callback_ = std::move(callback);
+	}
+
+	std::shared_ptr<OperationContext> OperationRegistry::Begin(const std::int64_t id, const Clock::time_point deadline)
+	{
+		auto context = std::make_shared<OperationContext>(id, deadline);
+		std::lock_guard<std::mutex> lock(mutex_);
+		operations_.emplace(id, context);
+		return context;
+	}
+
+	void OperationRegistry::End(const OperationContext& context)
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+		const auto [begin, end] = operations_.equal_range(context.id());
+		for (auto operation = begin; operation != end; ++operation)
+		{
+			if (operation->second.get() == &context)
+			{
+				operations_.erase(operation);
+				return;
+			}
+		}
+	}
+
+	bool OperationRegistry::Cancel(const std::int64_t id)
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+		const auto [begin, end] = operations_.equal_range(id);
+		for (auto operation = begin; operation != end; ++operation)
+		{
+			operation->second->Cancel();
+		}
+
+		return begin != end;
+	}
+}
@@ -0,0 +1,153 @@
+#include "../include/screen_brightness_windows/process_liveness.h"
+
+#ifdef _WIN32
+#include <Windows.h>
+#else
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <signal.h>
+#include <unistd.h>
+#endif
+
+namespace screen_brightness
+{
+	namespace
+	{
+		// FNV-1a
+		std::uint32_t Hash(std::uint32_t hash, const void* data, const size_t size)
+		{
+			const unsigned char* bytes = static_cast<const unsigned char*>(data);
+			for (size_t index = 0; index < size; ++index)
+			{
+				hash = (hash ^ bytes[index]) * 16777619u;
+			}
+
+			return hash;
+		}
+
+		std::uint32_t ToStartToken(const std::uint32_t hash)
+		{
+			// the lease table keeps the low 16 bits, and 0 means there is no token
+			return (hash & 0xffff) == 0 ? hash | 1 : hash;
+		}
+
+#ifndef _WIN32
+		// Reads a small procfs file into a stack buffer, as these are read for every liveness check.
+		size_t ReadProcFile(const char* path, char* buffer, const size_t capacity)
+		{
+			const int file = open(path, O_RDONLY | O_CLOEXEC);
+			if (file < 0)
+			{
+				return 0;
+			}
+
+			const ssize_t size = read(file, buffer, capacity - 1);
+			close(file);
+			buffer[size > 0 ? size : 0] = '\0';
+			return size > 0 ? static_cast<size_t>(size) : 0;
+		}
+
+		// The boot id, as the start time of a process only counts from the boot.
+		std::uint32_t GetBootHash()
+		{
+			static const std::uint32_t boot_hash = []
+				{
+					char boot_id[64];
+					const size_t size = ReadProcFile("/proc/sys/kernel/random/boot_id", boot_id, sizeof(boot_id));
+					return Hash(2166136261u, boot_id, size);
+				}();
+			return boot_hash;
+		}
+#endif
+
+		// 0 when the start time cannot be read, e.g. for a process of another user or one which has exited.
+		std::uint32_t GetStartToken(const std::uint32_t process_id)
+		{
+#ifdef _WIN32
+			const HANDLE process = OpenProcess(PROCESS_QUERY_LIMITED_INFORMATION, FALSE, process_id);
+			if (process == nullptr)
+			{
+				return 0;
+			}
+
+			FILETIME creation_time, exit_time, kernel_time, user_time;
+			const bool has_times = GetProcessTimes(process, &creation_time, &exit_time, &kernel_time, &user_time);
+			CloseHandle(process);
+			return has_times ? ToStartToken(Hash(2166136261u, &creation_time, sizeof(creation_time))) : 0;
+#else
+			char path[32];
+			std::snprintf(path, sizeof(path), "/proc/%u/stat", process_id);
+			char stat[512];
+			if (ReadProcFile(path, stat, sizeof(stat)) == 0)
+			{
+				return 0;
+			}
+
+			// the start time is the 22nd field, counted from the state after the command name, which may have spaces
+			const char* field = std::strrchr(stat, ')');
+			for (int index = 3; field != nullptr && index <= 22; ++index)
+			{
+				field = std::strchr(field + 1, ' ');
+			}
+
+			if (field == nullptr)
+			{
+				return 0;
+			}
+
+			const unsigned long long start_time = std::strtoull(field + 1, nullptr, 10);
+			return ToStartToken(Hash(GetBootHash(), &start_time, sizeof(start_time)));
+#endif
+		}
+	}
+
+	std::uint32_t GetOwnProcessId()
+	{
+#ifdef _WIN32
+		return static_cast<std::uint32_t>(::GetCurrentProcessId());
+#else
+		return static_cast<std::uint32_t>(getpid());
+#endif
+	}
+
+	ProcessIdentity GetOwnProcessIdentity()
+	{
+		const std::uint32_t process_id = GetOwnProcessId();
+		return ProcessIdentity{ process_id, GetStartToken(process_id) };
+	}
+
+	bool IsProcessAlive(const ProcessIdentity process, const std::uint32_t start_token_mask)
+	{
+#ifdef _WIN32
+		const HANDLE handle = OpenProcess(SYNCHRONIZE, FALSE, process.id);
+		if (handle == nullptr)
+		{
+			// a process which exists but may not be opened is alive
+			return GetLastError() == ERROR_ACCESS_DENIED;
+		}
+
+		const bool is_alive = WaitForSingleObject(handle, 0) == WAIT_TIMEOUT;
+		CloseHandle(handle);
+		if (!is_alive)
+		{
+			return false;
+		}
+#else
+		if (kill(static_cast<pid_t>(process.id), 0) != 0 && errno != EPERM)
+		{
+			return false;
+		}
+#endif
+
+		if ((process.start_token & start_token_mask) == 0)
+		{
+			return true;
+		}
+
+		const std::uint32_t start_token = GetStartToken(process.id);
+		return start_token == 0 || (start_token & start_token_mask) == (process.start_token & start_token_mask);
+	}
+}
@@ -0,0 +1,388 @@
+#include "../include/screen_brightness_windows/restore_journal.h"
+
+#include <atomic>
+#include <cstdlib>
+#include <thread>
+
+#include "../include/screen_brightness_windows/process_liveness.h"
+#include "../include/screen_brightness_windows/shared_slots.h"
+
+#ifdef _WIN32
+#include <Windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace screen_brightness
+{
+	struct RestoreJournal::Slot
+	{
+		// identity key of the display, 0 while the slot is free; written under the sequence when the slot is reclaimed
+		std::atomic<std::uint64_t> key;
+
+		// odd while the slot is being written
+		std::atomic<std::uint64_t> sequence;
+
+		// identity word of the owner, 0 when there is nothing to restore
+		std::atomic<std::uint64_t> owner;
+
+		// identity word of the process writing the slot, 0 when none is
+		std::atomic<std::uint64_t> writer;
+
+		std::atomic<std::int64_t> value;
+
+		std::atomic<std::int64_t> system_value;
+	};
+
+	struct RestoreJournal::Journal
+	{
+		std::atomic<std::uint32_t> layout_version;
+
+		std::uint32_t reserved;
+
+		// identity word of the process reclaiming a slot, 0 when none is
+		std::atomic<std::uint64_t> reclaim_lock;
+
+		Slot slots[kSlotCount];
+	};
+
+	namespace
+	{
+		constexpr std::uint32_t kLayoutVersion = 3;
+
+		// Runs write with the slot's sequence odd, as writer. Writers of one slot take turns, and one which has died half
+		// way through leaves the slot to the next. Returns false, writing nothing, when a live writer holds the slot for
+		// too long, e.g. one which is stopped.
+		template <typename Slot, typename Write>
+		bool WriteSlot(Slot& slot, const std::uint64_t writer, Write write)
+		{
+			if (!LockSharedWord(slot.writer, writer))
+			{
+				return false;
+			}
+
+			WriteSharedSlot(slot, write);
+			slot.writer.store(0, std::memory_order_release);
+			return true;
+		}
+	}
+
+	std::string RestoreJournal::GetDefaultPath()
+	{
+#ifdef _WIN32
+		const char* directory = std::getenv("LOCALAPPDATA");
+		if (directory != nullptr && *directory != '\0')
+		{
+			return std::string(directory) + "\\screen_brightness_restore.journal";
+		}
+
+		char temporary_directory[MAX_PATH + 1] = {};
+		GetTempPathA(MAX_PATH + 1, temporary_directory);
+		return std::string(temporary_directory) + "screen_brightness_restore.journal";
+#else
+		// not XDG_RUNTIME_DIR, which is emptied on logout
+		if (const char* directory = std::getenv("XDG_STATE_HOME"); directory != nullptr && *directory != '\0')
+		{
+			return std::string(directory) + "/screen_brightness_restore.journal";
+		}
+
+		if (const char* home = std::getenv("HOME"); home != nullptr && *home != '\0')
+		{
+			return std::string(home) + "/.cache/screen_brightness_restore.journal";
+		}
+
+		return "/tmp/screen_brightness_restore-" + std::to_string(getuid()) + ".journal";
+#endif
+	}
+
+	RestoreJournal::~RestoreJournal()
+	{
+		Close();
+	}
+
+	MonitorStatus RestoreJournal::Open(const std::string& path, const ProcessIdentity process)
+	{
+		Close();
+
+#ifdef _WIN32
+		const HANDLE file = CreateFileA(path.c_str(), GENERIC_READ | GENERIC_WRITE, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+			nullptr, OPEN_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr);
+		if (file == INVALID_HANDLE_VALUE)
+		{
+			return MonitorStatus::kJournalFailed;
+		}
+
+		// a mapping larger than the file grows it, zero filled; the mapping keeps the file open
+		const HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READWRITE, 0, sizeof(Journal), nullptr);
+		CloseHandle(file);
+		if (mapping == nullptr)
+		{
+			return MonitorStatus::kJournalFailed;
+		}
+
+		void* view = MapViewOfFile(mapping, FILE_MAP_ALL_ACCESS, 0, 0, sizeof(Journal));
+		if (view == nullptr)
+		{
+			CloseHandle(mapping);
+			return MonitorStatus::kJournalFailed;
+		}
+
+		mapping_ = mapping;
+#else
+		const int file = open(path.c_str(), O_CREAT | O_RDWR | O_CLOEXEC, 0600);
+		if (file == -1)
+		{
+			return MonitorStatus::kJournalFailed;
+		}
+
+		// growing zero fills; a file which is large enough already is left alone, as other processes have it mapped
+		struct stat status = {};
+		const bool is_sized = fstat(file, &status) == 0 &&
+			(status.st_size >= static_cast<off_t>(sizeof(Journal)) || ftruncate(file, sizeof(Journal)) == 0);
+		void* view = is_sized ? mmap(nullptr, sizeof(Journal), PROT_READ | PROT_WRITE, MAP_SHARED, file, 0) : MAP_FAILED;
+		close(file);
+		if (view == MAP_FAILED)
+		{
+			return MonitorStatus::kJournalFailed;
+		}
+#endif
+
+		process_ = process;
+
+		journal_ = static_cast<Journal*>(view);
+		std::uint32_t layout_version = 0;
+		if (!journal_->layout_version.compare_exchange_strong(layout_version, kLayoutVersion) && layout_version != kLayoutVersion)
+		{
+			// written by an incompatible version of the plugin
+			Close();
+			return MonitorStatus::kJournalFailed;
+		}
+
+		return MonitorStatus::kOk;
+	}
+
+	void RestoreJournal::Close()
+	{
+		if (journal_ == nullptr)
+		{
+			return;
+		}
+
+#ifdef _WIN32
+		UnmapViewOfFile(journal_);
+		CloseHandle(mapping_);
+		mapping_ = nullptr;
+#else
+		munmap(journal_, sizeof(Journal));
+#endif
+		journal_ = nullptr;
+	}
+
+	bool RestoreJournal::Record(const DisplayIdentity identity, const long value, const long system_value)
+	{
+		const std::uint64_t key = GetSharedSlotKey(identity);
+		const std::uint64_t owner = process_.ToWord();
+
+		// the slot found may be reclaimed for another display before it is written, which then finds another one
+		for (int attempt = 0; attempt < kSharedSlotAttemptCount; ++attempt)
+		{
+			Slot* slot = FindSlot(identity, true);
+			bool is_recorded = false;
+			if (slot == nullptr || !WriteSlot(*slot, owner, [key, owner, value, system_value, &is_recorded](Slot& written_slot)
+				{
+					is_recorded = written_slot.key.load(std::memory_order_relaxed) == key;
+					if (is_recorded)
+					{
+						written_slot.value.store(value, std::memory_order_relaxed);
+						written_slot.system_value.store(system_value, std::memory_order_relaxed);
+						written_slot.owner.store(owner, std::memory_order_relaxed);
+					}
+				}))
+			{
+				return false;
+			}
+
+			if (is_recorded)
+			{
+				return true;
+			}
+		}
+
+		return false;
+	}
+
+	void RestoreJournal::Clear(const DisplayIdentity identity)
+	{
+		const std::uint64_t owner = process_.ToWord();
+		Slot* slot = FindSlot(identity, false);
+		if (slot == nullptr || slot->owner.load(std::memory_order_relaxed) != owner)
+		{
+			return;
+		}
+
+		// left for the next recovery if a live writer holds on to the slot
+		(void)WriteSlot(*slot, owner, [key = GetSharedSlotKey(identity), owner](Slot& written_slot)
+			{
+				if (written_slot.key.load(std::memory_order_relaxed) == key && written_slot.owner.load(std::memory_order_relaxed) == owner)
+				{
+					written_slot.owner.store(0, std::memory_order_relaxed);
+				}
+			});
+	}
+
+	bool RestoreJournal::Read(const DisplayIdentity identity, RestoreJournalEntry& entry) const
+	{
+		const Slot* slot = FindSlot(identity, false);
+		return slot != nullptr && ReadSlot(*slot, entry) && entry.identity.value == GetSharedSlotKey(identity);
+	}
+
+	size_t RestoreJournal::Recover(const RestoreCallback& restore)
+	{
+		if (journal_ == nullptr)
+		{
+			return 0;
+		}
+
+		const std::uint64_t own_owner = process_.ToWord();
+		size_t cleared_count = 0;
+		for (Slot& slot : journal_->slots)
+		{
+			RestoreJournalEntry entry;
+			if (!ReadSlot(slot, entry))
+			{
+				continue;
+			}
+
+			const ProcessIdentity entry_owner{ entry.owner, entry.owner_start_token };
+			if (entry.owner == 0 || entry_owner == process_ || IsProcessAlive(entry_owner))
+			{
+				continue;
+			}
+
+			// another process recovering at the same time, or the owner of a new override, may have been first
+			const std::uint64_t entry_owner_word = entry_owner.ToWord();
+			bool is_claimed = false;
+			if (!WriteSlot(slot, own_owner, [own_owner, entry_owner_word, &is_claimed](Slot& written_slot)
+				{
+					is_claimed = written_slot.owner.load(std::memory_order_relaxed) == entry_owner_word;
+					if (is_claimed)
+					{
+						written_slot.owner.store(own_owner, std::memory_order_relaxed);
+					}
+				}) || !is_claimed)
+			{
+				continue;
+			}
+
+			// Left to the next recovery when the display could not be restored, e.g. while unplugged. If the slot
+			// cannot be written back, it stays claimed by this process, and is recovered again once it has exited.
+			const bool is_restored = restore(entry);
+			(void)WriteSlot(slot, own_owner, [own_owner, entry_owner_word, is_restored](Slot& written_slot)
+				{
+					if (written_slot.owner.load(std::memory_order_relaxed) == own_owner)
+					{
+						written_slot.owner.store(is_restored ? 0 : entry_owner_word, std::memory_order_relaxed);
+					}
+				});
+			cleared_count += is_restored ? 1 : 0;
+		}
+
+		return cleared_count;
+	}
+
+	RestoreJournal::Slot* RestoreJournal::FindSlot(const DisplayIdentity identity, const bool is_claiming) const
+	{
+		if (journal_ == nullptr)
+		{
+			return nullptr;
+		}
+
+		const std::uint64_t key = GetSharedSlotKey(identity);
+		Slot* slot = FindSharedSlot(journal_->slots, key, is_claiming);
+		return slot == nullptr && is_claiming ? ReclaimSlot(key) : slot;
+	}
+
+	RestoreJournal::Slot* RestoreJournal::ReclaimSlot(const std::uint64_t key) const
+	{
+		// Every slot has a display, so the slot of one with nothing to restore is given to this one. Two processes
+		// reclaiming different slots for one display would both get one, which the lock prevents.
+		const std::uint64_t own_word = process_.ToWord();
+		if (!LockSharedWord(journal_->reclaim_lock, own_word))
+		{
+			return nullptr;
+		}
+
+		Slot* reclaimed_slot = nullptr;
+		for (std::size_t probe = 0; probe < kSlotCount && reclaimed_slot == nullptr; ++probe)
+		{
+			Slot& slot = journal_->slots[(key + probe) % kSlotCount];
+			if (slot.key.load(std::memory_order_acquire) == key)
+			{
+				// reclaimed by another process meanwhile
+				reclaimed_slot = &slot;
+			}
+		}
+
+		for (std::size_t probe = 0; probe < kSlotCount && reclaimed_slot == nullptr; ++probe)
+		{
+			// the owner is checked again under the slot's writer, as an override may be recorded meanwhile
+			Slot& slot = journal_->slots[(key + probe) % kSlotCount];
+			bool is_reclaimed = false;
+			if (slot.owner.load(std::memory_order_relaxed) != 0 || !WriteSlot(slot, own_word, [key, &is_reclaimed](Slot& written_slot)
+				{
+					is_reclaimed = written_slot.owner.load(std::memory_order_relaxed) == 0;
+					if (is_reclaimed)
+					{
+						written_slot.key.store(key, std::memory_order_relaxed);
+						written_slot.value.store(-1, std::memory_order_relaxed);
+						written_slot.system_value.store(-1, std::memory_order_relaxed);
+					}
+				}))
+			{
+				continue;
+			}
+
+			reclaimed_slot = is_reclaimed ? &slot : nullptr;
+		}
+
+		journal_->reclaim_lock.store(0, std::memory_order_release);
+		return reclaimed_slot;
+	}
+
+	bool RestoreJournal::ReadSlot(const Slot& slot, RestoreJournalEntry& entry)
+	{
+		if (slot.key.load(std::memory_order_acquire) == 0)
+		{
+			return false;
+		}
+
+		// a writer which died half way through is not coming back, so after the attempts its values are taken as they are
+		for (int attempt = 0; attempt <= kSharedSlotAttemptCount; ++attempt)
+		{
+			const std::uint64_t sequence = slot.sequence.load(std::memory_order_acquire);
+			if ((sequence & 1) != 0 && attempt < kSharedSlotAttemptCount)
+			{
+				std::this_thread::yield();
+				continue;
+			}
+
+			// read with the values, as a reclaimed slot changes display
+			entry.identity = DisplayIdentity{ slot.key.load(std::memory_order_relaxed) };
+			const ProcessIdentity owner = ProcessIdentity::FromWord(slot.owner.load(std::memory_order_relaxed));
+			entry.owner = owner.id;
+			entry.owner_start_token = owner.start_token;
+			entry.value = static_cast<long>(slot.value.load(std::memory_order_relaxed));
+			entry.system_value = static_cast<long>(slot.system_value.load(std::memory_order_relaxed));
+			std::atomic_thread_fence(std::memory_order_acquire);
+			if (slot.sequence.load(std::memory_order_relaxed) == sequence)
+			{
+				return true;
+			}
+		}
+
+		return true;
+	}
+}
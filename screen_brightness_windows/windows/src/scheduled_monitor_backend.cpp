@@ -0,0 +1,214 @@
+#include "../include/screen_brightness_windows/scheduled_monitor_backend.h"
+
+#include <memory>
+#include <utility>
+
+namespace screen_brightness
+{
+	namespace
+	{
+		// The operations below run in place in a scheduler slot, so that a call does not allocate. They copy their
+		// arguments and carry their results back once they complete.
+		struct ReadBrightness
+		{
+			MonitorBackend* backend;
+
+			DisplayHandle display;
+
+			long minimum = 0;
+
+			long current = 0;
+
+			long maximum = 0;
+
+			MonitorStatus operator()()
+			{
+				return backend->GetScreenBrightness(display, minimum, current, maximum);
+			}
+		};
+
+		struct WriteBrightness
+		{
+			MonitorBackend* backend;
+
+			DisplayHandle display;
+
+			long value;
+
+			MonitorStatus operator()() const
+			{
+				return backend->SetScreenBrightness(display, value);
+			}
+		};
+
+		struct ReadVcpFeature
+		{
+			MonitorBackend* backend;
+
+			DisplayHandle display;
+
+			VcpCode code;
+
+			unsigned long current = 0;
+
+			unsigned long maximum = 0;
+
+			MonitorStatus operator()()
+			{
+				return backend->GetVcpFeature(display, code, current, maximum);
+			}
+		};
+
+		struct WriteVcpFeature
+		{
+			MonitorBackend* backend;
+
+			DisplayHandle display;
+
+			VcpCode code;
+
+			unsigned long value;
+
+			MonitorStatus operator()() const
+			{
+				return backend->SetVcpFeature(display, code, value);
+			}
+		};
+	}
+
+	ScheduledMonitorBackend::ScheduledMonitorBackend(MonitorBackend& backend, Clock& clock, const Clock::duration minimum_command_interval, const bool is_threaded) :
+		backend_(backend), clock_(clock), minimum_command_interval_(minimum_command_interval), is_threaded_(is_threaded)
+	{
+	}
+
+	DdcScheduler& ScheduledMonitorBackend::GetScheduler(const DisplayHandle display)
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+		std::unique_ptr<DdcScheduler>& scheduler = schedulers_[display];
+		if (scheduler == nullptr)
+		{
+			scheduler = std::make_unique<DdcScheduler>(clock_, minimum_command_interval_);
+			if (is_threaded_)
+			{
+				scheduler->Start();
+			}
+		}
+
+		return *scheduler;
+	}
+
+	bool ScheduledMonitorBackend::Withdraw(const DisplayHandle display, const std::uint64_t sequence)
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+		const auto scheduler = schedulers_.find(display);
+		return scheduler != schedulers_.end() && scheduler->second->Withdraw(sequence);
+	}
+
+	void ScheduledMonitorBackend::RemoveScheduler(const DisplayHandle display)
+	{
+		std::unique_ptr<DdcScheduler> scheduler;
+		{
+			std::lock_guard<std::mutex> lock(mutex_);
+			const auto iterator = schedulers_.find(display);
+			if (iterator == schedulers_.end())
+			{
+				return;
+			}
+
+			scheduler = std::move(iterator->second);
+			schedulers_.erase(iterator);
+		}
+
+		scheduler->Stop();
+		scheduler->RunUntilIdle();
+	}
+
+	void ScheduledMonitorBackend::RemoveSchedulers()
+	{
+		std::map<DisplayHandle, std::unique_ptr<DdcScheduler>> schedulers;
+		{
+			std::lock_guard<std::mutex> lock(mutex_);
+			schedulers.swap(schedulers_);
+		}
+
+		for (const auto& [display, scheduler] : schedulers)
+		{
+			scheduler->Stop();
+			scheduler->RunUntilIdle();
+		}
+	}
+
+	MonitorStatus ScheduledMonitorBackend::EnumerateDisplays(std::vector<DisplayInfo>& displays)
+	{
+		return backend_.EnumerateDisplays(displays);
+	}
+
+	DisplayHandle ScheduledMonitorBackend::GetPrimaryDisplay()
+	{
+		return backend_.GetPrimaryDisplay();
+	}
+
+	// The operations are detachable, so that a caller whose OperationContext times out is not held up by a hung
+	// monitor.
+	MonitorStatus ScheduledMonitorBackend::GetScreenBrightness(const DisplayHandle display, long& minimum_screen_brightness, long& screen_brightness, long& maximum_screen_brightness)
+	{
+		// a read is not coalesced, its caller needs the value
+		ReadBrightness read{ &backend_, display };
+		const MonitorStatus status = GetScheduler(display).RunInPlace(DdcPriority::kUserWrite, kDdcNoCoalescing, read);
+		if (status == MonitorStatus::kOk)
+		{
+			minimum_screen_brightness = read.minimum;
+			screen_brightness = read.current;
+			maximum_screen_brightness = read.maximum;
+		}
+
+		return status;
+	}
+
+	MonitorStatus ScheduledMonitorBackend::SetScreenBrightness(const DisplayHandle display, const long screen_brightness)
+	{
+		WriteBrightness write{ &backend_, display, screen_brightness };
+		return GetScheduler(display).RunInPlace(DdcPriority::kUserWrite, kDdcBrightnessWrite, write);
+	}
+
+	MonitorStatus ScheduledMonitorBackend::GetVcpFeature(const DisplayHandle display, const VcpCode code, unsigned long& current_value, unsigned long& maximum_value)
+	{
+		ReadVcpFeature read{ &backend_, display, code };
+		const MonitorStatus status = GetScheduler(display).RunInPlace(DdcPriority::kUserWrite, kDdcNoCoalescing, read);
+		if (status == MonitorStatus::kOk)
+		{
+			current_value = read.current;
+			maximum_value = read.maximum;
+		}
+
+		return status;
+	}
+
+	MonitorStatus ScheduledMonitorBackend::SetVcpFeature(const DisplayHandle display, const VcpCode code, const unsigned long value)
+	{
+		WriteVcpFeature write{ &backend_, display, code, value };
+		return GetScheduler(display).RunInPlace(DdcPriority::kUserWrite, GetVcpWriteCoalescingKey(code), write);
+	}
+
+	MonitorStatus ScheduledMonitorBackend::GetCapabilitiesString(const DisplayHandle display, std::string& capabilities)
+	{
+		// the monitor takes seconds to answer, so queued brightness changes go first
+		const auto result = std::make_shared<std::string>();
+		const MonitorStatus status = GetScheduler(display).RunDetachable(DdcPriority::kBackgroundPoll, kDdcNoCoalescing, [&backend = backend_, display, result]
+			{
+				return backend.GetCapabilitiesString(display, *result);
+			});
+		if (status == MonitorStatus::kOk)
+		{
+			capabilities = std::move(*result);
+		}
+
+		return status;
+	}
+
+	MonitorStatus ScheduledMonitorBackend::GetEdid(const DisplayHandle display, std::vector<std::uint8_t>& edid)
+	{
+		// the EDID is read from the operating system's copy, not over the DDC/CI bus
+		return backend_.GetEdid(display, edid);
+	}
+}
@@ -0,0 +1,202 @@
+#include "../include/screen_brightness_windows/screen_brightness_ffi.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <memory>
+
+#include "../include/screen_brightness_windows/brightness_bridge.h"
+
+using screen_brightness::BrightnessBridge;
+using screen_brightness::Clock;
+using screen_brightness::ContentAdaptiveDimmingConfig;
+using screen_brightness::DisplayStateTable;
+using screen_brightness::FrameView;
+using screen_brightness::MonitorStatus;
+using screen_brightness::PixelFormat;
+using screen_brightness::PublishedDisplayState;
+
+static_assert(static_cast<int32_t>(MonitorStatus::kOk) == SCREEN_BRIGHTNESS_FFI_OK, "statuses are passed as MonitorStatus values");
+
+static_assert(static_cast<int32_t>(MonitorStatus::kPreempted) == SCREEN_BRIGHTNESS_FFI_PREEMPTED, "statuses are passed as MonitorStatus values");
+
+static_assert(static_cast<int32_t>(MonitorStatus::kTimedOut) == SCREEN_BRIGHTNESS_FFI_TIMED_OUT, "statuses are passed as MonitorStatus values");
+
+static_assert(static_cast<int32_t>(MonitorStatus::kCancelled) == SCREEN_BRIGHTNESS_FFI_CANCELLED, "statuses are passed as MonitorStatus values");
+
+static_assert(BrightnessBridge::kInvalidFrame == SCREEN_BRIGHTNESS_FFI_INVALID_FRAME, "SubmitFrame returns the bridge's result");
+
+static_assert(DisplayStateTable::kSlotCount == SCREEN_BRIGHTNESS_FFI_STATE_TABLE_SLOT_COUNT, "the state table is read in place");
+
+static_assert(sizeof(DisplayStateTable::Slot) == sizeof(ScreenBrightnessFfiDisplayState), "the state table is read in place");
+
+static_assert(sizeof(DisplayStateTable::Layout) == sizeof(ScreenBrightnessFfiStateTable), "the state table is read in place");
+
+static_assert(offsetof(DisplayStateTable::Layout, slots) == offsetof(ScreenBrightnessFfiStateTable, slots), "the state table is read in place");
+
+static_assert(offsetof(DisplayStateTable::Slot, owner) == offsetof(ScreenBrightnessFfiDisplayState, owner), "the state table is read in place");
+
+int32_t ScreenBrightnessFfiGetVersion(void)
+{
+	return SCREEN_BRIGHTNESS_FFI_VERSION;
+}
+
+const char* ScreenBrightnessFfiGetStatusMessage(const int32_t status)
+{
+	if (status == SCREEN_BRIGHTNESS_FFI_UNAVAILABLE)
+	{
+		return "No engine has registered the screen brightness plugin";
+	}
+
+	if (status == SCREEN_BRIGHTNESS_FFI_INVALID_FRAME)
+	{
+		return "The frame cannot be analysed";
+	}
+
+	return screen_brightness::GetMonitorStatusMessage(static_cast<MonitorStatus>(status));
+}
+
+double ScreenBrightnessFfiGetCachedBrightness(void)
+{
+	return BrightnessBridge::GetInstalledCachedBrightness();
+}
+
+namespace
+{
+	BrightnessBridge::CompletionCallback MakeCompletion(const ScreenBrightnessFfiCompletionCallback callback, void* user_data)
+	{
+		return [callback, user_data](const std::int64_t request_id, const MonitorStatus status)
+			{
+				if (callback != nullptr)
+				{
+					callback(request_id, static_cast<int32_t>(status), user_data);
+				}
+			};
+	}
+}
+
+int64_t ScreenBrightnessFfiSetBrightnessAsync(const double brightness, const ScreenBrightnessFfiCompletionCallback callback, void* user_data)
+{
+	const std::shared_ptr<BrightnessBridge> bridge = BrightnessBridge::GetInstalled();
+	if (bridge == nullptr)
+	{
+		return SCREEN_BRIGHTNESS_FFI_UNAVAILABLE;
+	}
+
+	return bridge->SetApplicationScreenBrightnessAsync(brightness, MakeCompletion(callback, user_data));
+}
+
+int64_t ScreenBrightnessFfiSetBrightnessWithTimeoutAsync(const double brightness, const int64_t timeout_ms,
+	const ScreenBrightnessFfiCompletionCallback callback, void* user_data)
+{
+	const std::shared_ptr<BrightnessBridge> bridge = BrightnessBridge::GetInstalled();
+	if (bridge == nullptr)
+	{
+		return SCREEN_BRIGHTNESS_FFI_UNAVAILABLE;
+	}
+
+	const Clock::time_point deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(std::max<int64_t>(0, timeout_ms));
+	return bridge->SetApplicationScreenBrightnessAsync(brightness, deadline, MakeCompletion(callback, user_data));
+}
+
+int32_t ScreenBrightnessFfiCancel(const int64_t request_id)
+{
+	const std::shared_ptr<BrightnessBridge> bridge = BrightnessBridge::GetInstalled();
+	if (bridge == nullptr)
+	{
+		return SCREEN_BRIGHTNESS_FFI_UNAVAILABLE;
+	}
+
+	return bridge->Cancel(request_id) ? 1 : 0;
+}
+
+int64_t ScreenBrightnessFfiSubscribe(const ScreenBrightnessFfiBrightnessCallback callback, void* user_data)
+{
+	const std::shared_ptr<BrightnessBridge> bridge = BrightnessBridge::GetInstalled();
+	if (bridge == nullptr || callback == nullptr)
+	{
+		return SCREEN_BRIGHTNESS_FFI_UNAVAILABLE;
+	}
+
+	return bridge->Subscribe([callback, user_data](const double brightness) { callback(brightness, user_data); });
+}
+
+void ScreenBrightnessFfiUnsubscribe(const int64_t subscription_id)
+{
+	if (const std::shared_ptr<BrightnessBridge> bridge = BrightnessBridge::GetInstalled())
+	{
+		bridge->Unsubscribe(subscription_id);
+	}
+}
+
+const ScreenBrightnessFfiStateTable* ScreenBrightnessFfiGetStateTable(void)
+{
+	const std::shared_ptr<BrightnessBridge> bridge = BrightnessBridge::GetInstalled();
+	return bridge != nullptr ? reinterpret_cast<const ScreenBrightnessFfiStateTable*>(&bridge->display_state_table().layout()) : nullptr;
+}
+
+int32_t ScreenBrightnessFfiReadDisplayState(const uint32_t slot_index, ScreenBrightnessFfiDisplayState* state)
+{
+	const std::shared_ptr<BrightnessBridge> bridge = BrightnessBridge::GetInstalled();
+	if (bridge == nullptr || slot_index >= DisplayStateTable::kSlotCount || state == nullptr)
+	{
+		return SCREEN_BRIGHTNESS_FFI_UNAVAILABLE;
+	}
+
+	PublishedDisplayState published_state;
+	DisplayStateTable::ReadSlot(bridge->display_state_table().layout().slots[slot_index], published_state);
+	if (published_state.display == 0)
+	{
+		return SCREEN_BRIGHTNESS_FFI_UNAVAILABLE;
+	}
+
+	state->sequence = published_state.generation * 2;
+	state->display = static_cast<uint64_t>(published_state.display);
+	state->current = published_state.current;
+	state->target = published_state.target;
+	state->minimum = published_state.minimum;
+	state->maximum = published_state.maximum;
+	state->system = published_state.system;
+	state->owner = published_state.owner;
+	return SCREEN_BRIGHTNESS_FFI_OK;
+}
+
+int32_t ScreenBrightnessFfiConfigureContentAdaptiveDimming(const ScreenBrightnessFfiContentAdaptiveDimmingConfig* config)
+{
+	const std::shared_ptr<BrightnessBridge> bridge = BrightnessBridge::GetInstalled();
+	if (bridge == nullptr || config == nullptr)
+	{
+		return SCREEN_BRIGHTNESS_FFI_UNAVAILABLE;
+	}
+
+	ContentAdaptiveDimmingConfig dimming_config;
+	dimming_config.maximum_brightness = config->maximum_brightness;
+	dimming_config.minimum_brightness = config->minimum_brightness;
+	dimming_config.knee = config->knee;
+	dimming_config.maximum_luma = config->maximum_luma;
+	dimming_config.time_constant = std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double, std::milli>(config->time_constant_ms));
+	dimming_config.deadband = config->deadband;
+	dimming_config.row_step = config->row_step;
+	bridge->SetContentAdaptiveDimming(dimming_config);
+	return SCREEN_BRIGHTNESS_FFI_OK;
+}
+
+int64_t ScreenBrightnessFfiSubmitFrame(const uint8_t* pixels, const uint32_t width, const uint32_t height, const uint32_t stride,
+	const int32_t pixel_format, const int64_t timestamp_us, const ScreenBrightnessFfiCompletionCallback callback, void* user_data)
+{
+	const std::shared_ptr<BrightnessBridge> bridge = BrightnessBridge::GetInstalled();
+	if (bridge == nullptr)
+	{
+		return SCREEN_BRIGHTNESS_FFI_UNAVAILABLE;
+	}
+
+	if (pixel_format != SCREEN_BRIGHTNESS_FFI_PIXEL_FORMAT_RGBA8 && pixel_format != SCREEN_BRIGHTNESS_FFI_PIXEL_FORMAT_BGRA8)
+	{
+		return SCREEN_BRIGHTNESS_FFI_INVALID_FRAME;
+	}
+
+	const FrameView frame{ pixels, width, height, stride,
+		pixel_format == SCREEN_BRIGHTNESS_FFI_PIXEL_FORMAT_BGRA8 ? PixelFormat::kBgra8 : PixelFormat::kRgba8 };
+	const Clock::time_point time(std::chrono::duration_cast<Clock::duration>(std::chrono::microseconds(timestamp_us)));
+	return bridge->SubmitFrame(frame, time, MakeCompletion(callback, user_data));
+}
@@ -1,9 +1,164 @@
 #include "../include/screen_brightness_windows/screen_brightness_windows_plugin.h"
 
-#pragma comment(lib, "Dxva2.lib")
-
 namespace screen_brightness
 {
+	namespace
+	{
+		// The messages HandleWindowProc acts on, by name for stall reports.
+		std::string_view GetWindowMessageName(const UINT message)
+		{
+			switch (message)
+			{
+			case WM_SIZE:
+				return "WM_SIZE";
+			case WM_DISPLAYCHANGE:
+				return "WM_DISPLAYCHANGE";
+			case WM_MOVE:
+				return "WM_MOVE";
+			case WM_DPICHANGED:
+				return "WM_DPICHANGED";
+			case WM_DESTROY:
+				return "WM_DESTROY";
+			case WM_CLOSE:
+				return "WM_CLOSE";
+			case WM_ACTIVATEAPP:
+				return "WM_ACTIVATEAPP";
+			case WM_TIMER:
+				return "WM_TIMER";
+			default:
+				return "window message";
+			}
+		}
+
+		// Dart passes an int as a 32-bit value when it fits, otherwise as a 64-bit one.
+		std::optional<std::int64_t> GetInteger(const flutter::EncodableMap& args, const char* name)
+		{
+			const auto value = args.find(flutter::EncodableValue(name));
+			if (value == args.end())
+			{
+				return std::nullopt;
+			}
+
+			if (const auto* integer = std::get_if<std::int32_t>(&value->second))
+			{
+				return *integer;
+			}
+
+			if (const auto* integer = std::get_if<std::int64_t>(&value->second))
+			{
+				return *integer;
+			}
+
+			return std::nullopt;
+		}
+
+		// A number Dart sends as an int or a double.
+		std::optional<double> GetNumber(const flutter::EncodableMap& args, const char* name)
+		{
+			const auto value = args.find(flutter::EncodableValue(name));
+			if (value == args.end())
+			{
+				return std::nullopt;
+			}
+
+			if (const auto* number = std::get_if<double>(&value->second))
+			{
+				return *number;
+			}
+
+			if (const auto* integer = std::get_if<std::int32_t>(&value->second))
+			{
+				return static_cast<double>(*integer);
+			}
+
+			if (const auto* integer = std::get_if<std::int64_t>(&value->second))
+			{
+				return static_cast<double>(*integer);
+			}
+
+			return std::nullopt;
+		}
+
+		// Converts a number of milliseconds, failing on NaN, a negative or infinite one, or one Clock::duration cannot hold.
+		bool ToDuration(const std::optional<double>& milliseconds, Clock::duration& duration)
+		{
+			const std::chrono::duration<double, std::milli> maximum_duration = Clock::duration::max();
+			if (!milliseconds.has_value() || !(*milliseconds >= 0 && *milliseconds < maximum_duration.count()))
+			{
+				return false;
+			}
+
+			duration = std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double, std::milli>(*milliseconds));
+			return true;
+		}
+
+		// Reports a status of an operation which has timed out or been cancelled. Returns false for any other status.
+		bool ReportOperationStatus(flutter::MethodResult<flutter::EncodableValue>& result, const MonitorStatus status)
+		{
+			if (status == MonitorStatus::kTimedOut)
+			{
+				result.Error("-12", "Operation did not complete before its deadline", GetMonitorStatusMessage(status));
+				return true;
+			}
+
+			if (status == MonitorStatus::kCancelled)
+			{
+				result.Error("-13", "Operation was cancelled", GetMonitorStatusMessage(status));
+				return true;
+			}
+
+			return false;
+		}
+
+		// Reports any failure of an operation which has timed out or been cancelled as such, whichever way the handler
+		// saw it fail.
+		class OperationMethodResult final : public flutter::MethodResult<flutter::EncodableValue>
+		{
+		public:
+			OperationMethodResult(std::unique_ptr<flutter::MethodResult<flutter::EncodableValue>> result, std::shared_ptr<OperationContext> context) :
+				result_(std::move(result)), context_(std::move(context))
+			{
+			}
+
+		protected:
+			void SuccessInternal(const flutter::EncodableValue* result) override
+			{
+				if (result == nullptr)
+				{
+					result_->Success();
+					return;
+				}
+
+				result_->Success(*result);
+			}
+
+			void ErrorInternal(const std::string& error_code, const std::string& error_message, const flutter::EncodableValue* error_details) override
+			{
+				if (ReportOperationStatus(*result_, context_->GetStatus()))
+				{
+					return;
+				}
+
+				if (error_details == nullptr)
+				{
+					result_->Error(error_code, error_message);
+					return;
+				}
+
+				result_->Error(error_code, error_message, *error_details);
+			}
+
+			void NotImplementedInternal() override
+			{
+				result_->NotImplemented();
+			}
+
+		private:
+			std::unique_ptr<flutter::MethodResult<flutter::EncodableValue>> result_;
+
+			std::shared_ptr<OperationContext> context_;
+		};
+	}
 
 	// static
 	void ScreenBrightnessWindowsPlugin::RegisterWithRegistrar(
@@ -18,6 +173,8 @@ namespace screen_brightness
 		method_channel->SetMethodCallHandler
 		([plugin_pointer = plugin.get()](const auto& call, auto result)
 			{
+				const StallDetector::Scope scope = plugin_pointer->stall_detector_.Measure(call.method_name(), plugin_pointer->client_.display(),
+					"ScreenBrightnessWindowsPlugin::HandleMethodCall");
 				plugin_pointer->HandleMethodCall(call, std::move(result));
 			});
 
@@ -47,37 +204,140 @@ namespace screen_brightness
 		};
 		application_screen_brightness_changed_event_channel->SetStreamHandler(std::move(application_screen_brightness_changed_stream_handler_unique_pointer));
 
+		const auto display_topology_changed_event_channel =
+			std::make_unique<flutter::EventChannel<flutter::EncodableValue>>(
+				registrar->messenger(), "github.com/aaassseee/screen_brightness/display_topology_changed",
+				&flutter::StandardMethodCodec::GetInstance());
+
+		plugin->display_topology_changed_stream_handler_ = new DisplayTopologyChangedStreamHandler();
+		std::unique_ptr<flutter::StreamHandler<flutter::EncodableValue>>
+			display_topology_changed_stream_handler_unique_pointer
+		{
+			static_cast<flutter::StreamHandler<flutter::EncodableValue>*>(plugin->display_topology_changed_stream_handler_)
+		};
+		display_topology_changed_event_channel->SetStreamHandler(std::move(display_topology_changed_stream_handler_unique_pointer));
+
+		const auto stall_warning_event_channel =
+			std::make_unique<flutter::EventChannel<flutter::EncodableValue>>(
+				registrar->messenger(), "github.com/aaassseee/screen_brightness/stall_warning",
+				&flutter::StandardMethodCodec::GetInstance());
+
+		plugin->stall_warning_stream_handler_ = new StallWarningStreamHandler();
+		std::unique_ptr<flutter::StreamHandler<flutter::EncodableValue>>
+			stall_warning_stream_handler_unique_pointer
+		{
+			static_cast<flutter::StreamHandler<flutter::EncodableValue>*>(plugin->stall_warning_stream_handler_)
+		};
+		stall_warning_event_channel->SetStreamHandler(std::move(stall_warning_stream_handler_unique_pointer));
+
 		registrar->AddPlugin(std::move(plugin));
 	}
 
 	ScreenBrightnessWindowsPlugin::ScreenBrightnessWindowsPlugin(
-		flutter::PluginRegistrarWindows* registrar) : registrar_(registrar)
+		flutter::PluginRegistrarWindows* registrar) : registrar_(registrar), client_(AcquireBrightnessService()),
+		stall_detector_(Clock::Steady()), input_activity_source_(Clock::Steady()), idle_dimmer_(client_, input_activity_source_, Clock::Steady())
 	{
 		window_handler_ = registrar->GetView()->GetNativeWindow();
-		try
-		{
-			GetScreenBrightness(minimum_screen_brightness_, system_screen_brightness_, maximum_screen_brightness_);
-		}
-		catch (const std::exception& exception)
-		{
-			std::cout << exception.what() << std::endl;
-		}
+		client_.SetDisplay(Dxva2MonitorBackend::ToDisplayHandle(MonitorFromWindow(window_handler_, MONITOR_DEFAULTTOPRIMARY)));
+		client_.Initialize();
+
+		// the method channel stays the fallback for callers which do not bind the C ABI
+		bridge_message_ = RegisterWindowMessageA("screen_brightness_bridge");
+		bridge_ = std::make_shared<BrightnessBridge>(client_, [this]
+			{
+				PostMessage(GetAncestor(window_handler_, GA_ROOT), bridge_message_, 0, 0);
+			});
+		client_.SetSystemScreenBrightnessChangedCallback([this](double brightness)
+			{
+				if (system_screen_brightness_changed_stream_handler_ == nullptr)
+				{
+					return;
+				}
+
+				system_screen_brightness_changed_stream_handler_->AddScreenBrightnessToEventSink(brightness);
+			});
+		client_.SetApplicationScreenBrightnessChangedCallback([this](double brightness)
+			{
+				bridge_->OnBrightnessChanged(brightness);
+				if (application_screen_brightness_changed_stream_handler_ == nullptr)
+				{
+					return;
+				}
+
+				application_screen_brightness_changed_stream_handler_->AddScreenBrightnessToEventSink(brightness);
+			});
+		client_.SetDisplayTopologyChangedCallback([this](const DisplayTopologyDelta& delta)
+			{
+				if (display_topology_changed_stream_handler_ == nullptr)
+				{
+					return;
+				}
+
+				display_topology_changed_stream_handler_->AddDisplayTopologyDeltaToEventSink(delta);
+			});
+
+		stall_detector_.SetStallCallback([this](const StallRecord& stall) { HandleStall(stall); });
 
 		window_proc_id_ = registrar->RegisterTopLevelWindowProcDelegate
 		([this](HWND hWnd, UINT message, WPARAM wParam, LPARAM lParam)
 			{
+				const StallDetector::Scope scope = stall_detector_.Measure(GetWindowMessageName(message), client_.display(),
+					"ScreenBrightnessWindowsPlugin::HandleWindowProc");
 				return HandleWindowProc(hWnd, message, wParam, lParam);
 			});
+		BrightnessBridge::Install(bridge_);
 	}
 
 	ScreenBrightnessWindowsPlugin::~ScreenBrightnessWindowsPlugin()
 	{
 		registrar_->UnregisterTopLevelWindowProcDelegate(window_proc_id_);
+		KillTimer(GetAncestor(window_handler_, GA_ROOT), kIdleDimmingTimerId);
+		BrightnessBridge::Uninstall(bridge_.get());
+		bridge_->Close();
 	}
 
 	void ScreenBrightnessWindowsPlugin::HandleMethodCall(
 		const flutter::MethodCall<flutter::EncodableValue>& method_call,
 		std::unique_ptr<flutter::MethodResult<flutter::EncodableValue>> result)
+	{
+		// cancel names the operation it cancels, rather than being one
+		const auto* args = std::get_if<flutter::EncodableMap>(method_call.arguments());
+		if (method_call.method_name() == "cancel" || args == nullptr)
+		{
+			DispatchMethodCall(method_call, std::move(result));
+			return;
+		}
+
+		const std::optional<std::int64_t> operation_id = GetInteger(*args, "operationId");
+		const std::optional<std::int64_t> deadline_ms = GetInteger(*args, "deadlineMs");
+		if (!operation_id.has_value() && !deadline_ms.has_value())
+		{
+			DispatchMethodCall(method_call, std::move(result));
+			return;
+		}
+
+		// a call without an id can time out, but not be cancelled
+		const Clock::time_point deadline = deadline_ms.has_value() ? std::chrono::steady_clock::now() + std::chrono::milliseconds(*deadline_ms) :
+			OperationContext::kNoDeadline;
+		if (method_call.method_name() == "setApplicationScreenBrightness")
+		{
+			QueueSetApplicationScreenBrightnessMethodCall(method_call, operation_id.value_or(0), deadline, std::move(result));
+			return;
+		}
+
+		OperationRegistry& operation_registry = client_.service().operation_registry();
+		const std::shared_ptr<OperationContext> context = operation_registry.Begin(operation_id.value_or(0), deadline);
+		{
+			const OperationContext::Scope scope(*context);
+			DispatchMethodCall(method_call, std::make_unique<OperationMethodResult>(std::move(result), context));
+		}
+
+		operation_registry.End(*context);
+	}
+
+	void ScreenBrightnessWindowsPlugin::DispatchMethodCall(
+		const flutter::MethodCall<flutter::EncodableValue>& method_call,
+		std::unique_ptr<flutter::MethodResult<flutter::EncodableValue>> result)
 	{
 		if (method_call.method_name() == "getSystemScreenBrightness")
 		{
@@ -145,18 +405,66 @@ namespace screen_brightness
         	return;
         }
 
+		if (method_call.method_name() == "getVcpFeature")
+		{
+			HandleGetVcpFeatureMethodCall(method_call, std::move(result));
+			return;
+		}
+
+		if (method_call.method_name() == "setVcpFeature")
+		{
+			HandleSetVcpFeatureMethodCall(method_call, std::move(result));
+			return;
+		}
+
+		if (method_call.method_name() == "getCapabilitiesString")
+		{
+			HandleGetCapabilitiesStringMethodCall(std::move(result));
+			return;
+		}
+
+		if (method_call.method_name() == "getSupportedVcpFeatures")
+		{
+			HandleGetSupportedVcpFeaturesMethodCall(std::move(result));
+			return;
+		}
+
+		if (method_call.method_name() == "getDiagnostics")
+		{
+			HandleGetDiagnosticsMethodCall(std::move(result));
+			return;
+		}
+
+		if (method_call.method_name() == "setStallBudget")
+		{
+			HandleSetStallBudgetMethodCall(method_call, std::move(result));
+			return;
+		}
+
+		if (method_call.method_name() == "setIdleDimming")
+		{
+			HandleSetIdleDimmingMethodCall(method_call, std::move(result));
+			return;
+		}
+
+		if (method_call.method_name() == "cancel")
+		{
+			HandleCancelMethodCall(method_call, std::move(result));
+			return;
+		}
+
 		result->NotImplemented();
 	}
 
 	void ScreenBrightnessWindowsPlugin::HandleGetSystemScreenBrightnessMethodCall(const std::unique_ptr<flutter::MethodResult<flutter::EncodableValue>> result) const
 	{
-		if (system_screen_brightness_ == -1)
+		if (!client_.HasSystemScreenBrightness())
 		{
 			result->Error("-11", "Could not found system screen brightness value");
 			return;
 		}
 
-		result->Success(GetScreenBrightnessPercentage(system_screen_brightness_));
+		result->Success(client_.GetSystemScreenBrightness());
 	}
 
 	void ScreenBrightnessWindowsPlugin::HandleSetSystemScreenBrightnessMethodCall(const flutter::MethodCall<flutter::EncodableValue>& call, std::unique_ptr<flutter::MethodResult<flutter::EncodableValue>> result)
@@ -175,40 +483,13 @@ namespace screen_brightness
 			return;
 		}
 
-		const long brightness_value = GetScreenBrightnessValueByPercentage(brightness);
-		try
-		{
-			system_screen_brightness_ = brightness_value;
-			HandleSystemScreenBrightnessChanged(brightness_value);
-			if (application_screen_brightness_ == -1)
-			{
-				SetScreenBrightness(brightness_value);
-				HandleApplicationScreenBrightnessChanged(brightness_value);
-			}
-			result->Success(nullptr);
-		}
-		catch (const std::exception& exception)
-		{
-			result->Error("-1", "Unable to change system screen brightness", exception.what());
-		}
-	}
-
-	void ScreenBrightnessWindowsPlugin::HandleSystemScreenBrightnessChanged(const long brightness)
-	{
-		if (system_screen_brightness_changed_stream_handler_ == nullptr || brightness == -1)
+		if (const MonitorStatus status = client_.SetSystemScreenBrightness(brightness); status != MonitorStatus::kOk)
 		{
+			result->Error("-1", "Unable to change system screen brightness", GetMonitorStatusMessage(status));
 			return;
 		}
 
-		try
-		{
-			const double brightness_percentage = GetScreenBrightnessPercentage(brightness);
-			system_screen_brightness_changed_stream_handler_->AddScreenBrightnessToEventSink(brightness_percentage);
-		}
-		catch (const std::exception& exception)
-		{
-			std::cout << exception.what() << std::endl;
-		}
+		result->Success(nullptr);
 	}
 
 	void ScreenBrightnessWindowsPlugin::HandleGetApplicationScreenBrightnessMethodCall(const std::unique_ptr<flutter::MethodResult<flutter::EncodableValue>> result)
@@ -219,16 +500,14 @@ namespace screen_brightness
 			return;
 		}
 
-		try
+		double brightness = 0;
+		if (const MonitorStatus status = client_.GetApplicationScreenBrightness(brightness); status != MonitorStatus::kOk)
 		{
-			long application_screen_brightness = -1;
-			GetScreenBrightness(minimum_screen_brightness_, application_screen_brightness, maximum_screen_brightness_);
-			result->Success(GetScreenBrightnessPercentage(application_screen_brightness));
-		}
-		catch (const std::exception& exception)
-		{
-			result->Error("-11", "Could not found application screen brightness", exception.what());
+			result->Error("-11", "Could not found application screen brightness", GetMonitorStatusMessage(status));
+			return;
 		}
+
+		result->Success(brightness);
 	}
 
 	void ScreenBrightnessWindowsPlugin::HandleSetApplicationScreenBrightnessMethodCall(const flutter::MethodCall<flutter::EncodableValue>& call, const std::unique_ptr<flutter::MethodResult<flutter::EncodableValue>> result)
@@ -247,22 +526,17 @@ namespace screen_brightness
 			return;
 		}
 
-		const long brightness_value = GetScreenBrightnessValueByPercentage(brightness);
-		try
+		if (const MonitorStatus status = client_.SetApplicationScreenBrightness(brightness); status != MonitorStatus::kOk)
 		{
-			SetScreenBrightness(brightness_value);
-
-			application_screen_brightness_ = brightness_value;
-			HandleApplicationScreenBrightnessChanged(brightness_value);
-			result->Success(nullptr);
-		}
-		catch (const std::exception& exception)
-		{
-			result->Error("-1", "Unable to change application screen brightness", exception.what());
+			result->Error("-1", "Unable to change application screen brightness", GetMonitorStatusMessage(status));
+			return;
 		}
+
+		result->Success(nullptr);
 	}
 
-	void ScreenBrightnessWindowsPlugin::HandleResetApplicationScreenBrightnessMethodCall(std::unique_ptr<flutter::MethodResult<flutter::EncodableValue>> result)
+	void ScreenBrightnessWindowsPlugin::QueueSetApplicationScreenBrightnessMethodCall(const flutter::MethodCall<flutter::EncodableValue>& call,
+		const std::int64_t operation_id, const Clock::time_point deadline, std::unique_ptr<flutter::MethodResult<flutter::EncodableValue>> result)
 	{
 		if (window_handler_ == nullptr)
 		{
@@ -270,46 +544,56 @@ namespace screen_brightness
 			return;
 		}
 
-		try
-		{
-			SetScreenBrightness(system_screen_brightness_);
-
-			application_screen_brightness_ = -1;
-			HandleApplicationScreenBrightnessChanged(system_screen_brightness_);
-			result->Success(nullptr);
-		}
-		catch (const std::exception& exception)
+		const flutter::EncodableMap& args = std::get<flutter::EncodableMap>(*call.arguments());
+		const double brightness = std::get<double>(args.at(flutter::EncodableValue("brightness")));
+		if (std::isnan(brightness))
 		{
-			result->Error("-1", "Unable reset screen brightness", exception.what());
+			result->Error("-2", "Unexpected error on null brightness");
+			return;
 		}
+
+		// the bridge completes writes on the platform thread, after this returns
+		(void)bridge_->SetApplicationScreenBrightnessAsync(brightness, deadline, operation_id,
+			[result = std::shared_ptr<flutter::MethodResult<flutter::EncodableValue>>(std::move(result))](std::int64_t, const MonitorStatus status)
+			{
+				if (status == MonitorStatus::kOk)
+				{
+					result->Success(nullptr);
+					return;
+				}
+
+				if (!ReportOperationStatus(*result, status))
+				{
+					result->Error("-1", "Unable to change application screen brightness", GetMonitorStatusMessage(status));
+				}
+			});
 	}
 
-	void ScreenBrightnessWindowsPlugin::HandleApplicationScreenBrightnessChanged(const long brightness)
+	void ScreenBrightnessWindowsPlugin::HandleResetApplicationScreenBrightnessMethodCall(std::unique_ptr<flutter::MethodResult<flutter::EncodableValue>> result)
 	{
-		if (application_screen_brightness_changed_stream_handler_ == nullptr)
+		if (window_handler_ == nullptr)
 		{
+			result->Error("-10", "Unexpected error on window handler");
 			return;
 		}
 
-		try
-		{
-			const double brightness_percentage = GetScreenBrightnessPercentage(brightness);
-			application_screen_brightness_changed_stream_handler_->AddScreenBrightnessToEventSink(brightness_percentage);
-		}
-		catch (const std::exception& exception)
+		if (const MonitorStatus status = client_.ResetApplicationScreenBrightness(); status != MonitorStatus::kOk)
 		{
-			std::cout << exception.what() << std::endl;
+			result->Error("-1", "Unable reset screen brightness", GetMonitorStatusMessage(status));
+			return;
 		}
+
+		result->Success(nullptr);
 	}
 
 	void ScreenBrightnessWindowsPlugin::HandleHasApplicationScreenBrightnessChangedMethodCall(const std::unique_ptr<flutter::MethodResult<flutter::EncodableValue>> result) const
 	{
-		result->Success(application_screen_brightness_ != -1);
+		result->Success(client_.HasApplicationScreenBrightnessChanged());
 	}
 
 	void ScreenBrightnessWindowsPlugin::HandleIsAutoResetMethodCall(const std::unique_ptr<flutter::MethodResult<flutter::EncodableValue>> result)
 	{
-		result->Success(is_auto_reset_);
+		result->Success(client_.is_auto_reset());
 	}
 
 	void ScreenBrightnessWindowsPlugin::HandleSetAutoResetMethodCall(const flutter::MethodCall<flutter::EncodableValue>& call, const std::unique_ptr<flutter::MethodResult<flutter::EncodableValue>> result)
@@ -317,13 +601,13 @@ namespace screen_brightness
 		const flutter::EncodableMap& args = std::get<flutter::EncodableMap>(*call.arguments());
 		const bool is_auto_reset = std::get<bool>(args.at(flutter::EncodableValue("isAutoReset")));
 
-		is_auto_reset_ = is_auto_reset;
+		client_.SetAutoReset(is_auto_reset);
 		result->Success(nullptr);
 	}
 
 	void ScreenBrightnessWindowsPlugin::HandleIsAnimateMethodCall(const std::unique_ptr<flutter::MethodResult<flutter::EncodableValue>> result)
 	{
-		result->Success(is_animate_);
+		result->Success(client_.is_animate());
 	}
 
 	void ScreenBrightnessWindowsPlugin::HandleSetAnimateMethodCall(const flutter::MethodCall<flutter::EncodableValue>& call, const std::unique_ptr<flutter::MethodResult<flutter::EncodableValue>> result)
@@ -331,7 +615,7 @@ namespace screen_brightness
 		const flutter::EncodableMap& args = std::get<flutter::EncodableMap>(*call.arguments());
 		const bool is_animate = std::get<bool>(args.at(flutter::EncodableValue("isAnimate")));
 
-		is_animate_ = is_animate;
+		client_.SetAnimate(is_animate);
 		result->Success(nullptr);
 	}
 
@@ -340,182 +624,385 @@ namespace screen_brightness
 		result->Success(true);
 	}
 
-	std::optional<LRESULT> ScreenBrightnessWindowsPlugin::HandleWindowProc(HWND hWnd, UINT message, WPARAM wParam, LPARAM lParam)
+	void ScreenBrightnessWindowsPlugin::HandleGetVcpFeatureMethodCall(const flutter::MethodCall<flutter::EncodableValue>& call, const std::unique_ptr<flutter::MethodResult<flutter::EncodableValue>> result)
 	{
-		switch (message)
+		const flutter::EncodableMap& args = std::get<flutter::EncodableMap>(*call.arguments());
+		const flutter::EncodableList& code_values = std::get<flutter::EncodableList>(args.at(flutter::EncodableValue("codes")));
+		std::vector<VcpCode> codes;
+		codes.reserve(code_values.size());
+		for (const flutter::EncodableValue& code_value : code_values)
 		{
-		case WM_SIZE:
-			switch (wParam)
+			const int64_t code = code_value.LongValue();
+			if (code < 0 || code > 0xff)
 			{
-			case SIZE_MINIMIZED:
-				if (!is_auto_reset_)
-				{
-					return std::nullopt;
-				}
-
-				OnApplicationPause();
-				break;
-
-			case SIZE_MAXIMIZED:
-			case SIZE_RESTORED:
-				if (!is_auto_reset_)
-				{
-					return std::nullopt;
-				}
-
-				OnApplicationResume();
-				break;
+				result->Error("-2", "Unexpected error on invalid VCP code");
+				return;
 			}
-			break;
 
-		case WM_DESTROY:
-		case WM_CLOSE:
-			OnApplicationPause();
-			break;
+			codes.push_back(static_cast<VcpCode>(code));
+		}
 
-		case WM_ACTIVATEAPP:
-			if (!is_auto_reset_)
-			{
-				return std::nullopt;
-			}
+		std::vector<VcpFeatureValue> features;
+		if (const MonitorStatus status = client_.service().vcp_feature_controller().GetVcpFeatures(client_.display(), codes, features); status != MonitorStatus::kOk)
+		{
+			result->Error("-1", "Unable to get VCP feature", GetMonitorStatusMessage(status));
+			return;
+		}
 
-			bool is_activate = bool(wParam);
-			if (is_activate)
+		// a code the monitor rejects is reported in its own entry, the others are still returned
+		flutter::EncodableList values;
+		values.reserve(features.size());
+		for (const VcpFeatureValue& feature : features)
+		{
+			flutter::EncodableMap value{ { flutter::EncodableValue("code"), flutter::EncodableValue(static_cast<int32_t>(feature.code)) } };
+			if (feature.status == MonitorStatus::kOk)
 			{
-				OnApplicationResume();
-				break;
+				value.emplace(flutter::EncodableValue("current"), flutter::EncodableValue(static_cast<int64_t>(feature.current_value)));
+				value.emplace(flutter::EncodableValue("maximum"), flutter::EncodableValue(static_cast<int64_t>(feature.maximum_value)));
 			}
 			else
 			{
-				OnApplicationPause();
+				value.emplace(flutter::EncodableValue("error"), flutter::EncodableValue(GetMonitorStatusMessage(feature.status)));
 			}
-			break;
+
+			values.emplace_back(std::move(value));
 		}
 
-		// allow another plugin to process message
-		return std::nullopt;
+		result->Success(flutter::EncodableValue(std::move(values)));
 	}
 
-	void ScreenBrightnessWindowsPlugin::GetScreenBrightness(long& minimum_screen_brightness, long& screen_brightness, long& maximum_screen_brightness)
+	void ScreenBrightnessWindowsPlugin::HandleSetVcpFeatureMethodCall(const flutter::MethodCall<flutter::EncodableValue>& call, const std::unique_ptr<flutter::MethodResult<flutter::EncodableValue>> result)
 	{
-		DWORD physical_monitor_array_size = 0;
-		HMONITOR monitor_handler = MonitorFromWindow(window_handler_, MONITOR_DEFAULTTOPRIMARY);
-		DWORD minimum_brightness_ = 0, brightness_ = 0, maximum_brightness_ = 0;
+		const flutter::EncodableMap& args = std::get<flutter::EncodableMap>(*call.arguments());
+		const int64_t code = args.at(flutter::EncodableValue("code")).LongValue();
+		const int64_t value = args.at(flutter::EncodableValue("value")).LongValue();
+		if (code < 0 || code > 0xff || value < 0 || value > 0xffff)
+		{
+			result->Error("-2", "Unexpected error on invalid VCP code or value");
+			return;
+		}
 
-		if (!GetNumberOfPhysicalMonitorsFromHMONITOR(monitor_handler, &physical_monitor_array_size))
+		if (const MonitorStatus status = client_.service().vcp_feature_controller().SetVcpFeature(client_.display(), static_cast<VcpCode>(code), static_cast<unsigned long>(value));
+			status != MonitorStatus::kOk)
 		{
-			throw std::exception("Problem getting numbers of monitor");
+			result->Error("-1", "Unable to set VCP feature", GetMonitorStatusMessage(status));
+			return;
 		}
 
-		LPPHYSICAL_MONITOR physical_monitor = (LPPHYSICAL_MONITOR)malloc(physical_monitor_array_size * sizeof(PHYSICAL_MONITOR));
+		result->Success(nullptr);
+	}
 
-		if (physical_monitor == NULL)
+	void ScreenBrightnessWindowsPlugin::HandleGetCapabilitiesStringMethodCall(const std::unique_ptr<flutter::MethodResult<flutter::EncodableValue>> result)
+	{
+		std::string capabilities;
+		if (const MonitorStatus status = client_.service().vcp_feature_controller().GetCapabilitiesString(client_.display(), capabilities); status != MonitorStatus::kOk)
 		{
-			throw std::exception("No monitors");
+			result->Error("-1", "Unable to get monitor capabilities", GetMonitorStatusMessage(status));
+			return;
 		}
 
-		if (!GetPhysicalMonitorsFromHMONITOR(monitor_handler, physical_monitor_array_size, physical_monitor))
+		result->Success(capabilities);
+	}
+
+	void ScreenBrightnessWindowsPlugin::HandleGetSupportedVcpFeaturesMethodCall(const std::unique_ptr<flutter::MethodResult<flutter::EncodableValue>> result)
+	{
+		const MccsCapabilities* capabilities = nullptr;
+		if (const MonitorStatus status = client_.service().vcp_feature_controller().GetCapabilities(client_.display(), capabilities); status != MonitorStatus::kOk)
 		{
-			throw std::exception("Problem getting physical monitors");
+			result->Error("-1", "Unable to get monitor capabilities", GetMonitorStatusMessage(status));
+			return;
 		}
 
-		if (!GetMonitorBrightness(physical_monitor->hPhysicalMonitor, &minimum_brightness_, &brightness_, &maximum_brightness_))
+		// code to allowed values, an empty list for a continuous feature
+		flutter::EncodableMap features;
+		for (int code = 0; code < 256; ++code)
 		{
-			throw std::exception("Problem getting monitor brightness");
+			if (!capabilities->IsSupported(static_cast<VcpCode>(code)))
+			{
+				continue;
+			}
+
+			flutter::EncodableList values;
+			for (const std::uint8_t value : capabilities->GetAllowedValues(static_cast<VcpCode>(code)))
+			{
+				values.emplace_back(static_cast<int32_t>(value));
+			}
+
+			features.emplace(flutter::EncodableValue(code), flutter::EncodableValue(std::move(values)));
 		}
 
-		minimum_screen_brightness = minimum_brightness_;
-		screen_brightness = brightness_;
-		maximum_screen_brightness = maximum_brightness_;
+		result->Success(flutter::EncodableValue(std::move(features)));
+	}
 
-		DestroyPhysicalMonitors(physical_monitor_array_size, physical_monitor);
+	void ScreenBrightnessWindowsPlugin::HandleGetDiagnosticsMethodCall(const std::unique_ptr<flutter::MethodResult<flutter::EncodableValue>> result)
+	{
+		const auto to_milliseconds = [](const Clock::duration duration)
+			{
+				return flutter::EncodableValue(std::chrono::duration<double, std::milli>(duration).count());
+			};
+
+		flutter::EncodableList displays;
+		BrightnessService& service = client_.service();
+		for (const DisplayTopology::Display& display : service.display_topology().displays())
+		{
+			DdcScheduler& scheduler = service.scheduled_backend().GetScheduler(display.info.handle);
+			const DdcSchedulerMetrics metrics = scheduler.metrics();
+			const DdcPacing pacing = scheduler.pacing();
+			const StallStatistics stall_statistics = stall_detector_.GetStatistics(display.info.handle);
+			displays.emplace_back(flutter::EncodableMap{
+				{ flutter::EncodableValue("id"), flutter::EncodableValue(display.info.id) },
+				{ flutter::EncodableValue("queueDepth"), flutter::EncodableValue(static_cast<int64_t>(metrics.queue_depth)) },
+				{ flutter::EncodableValue("executedCount"), flutter::EncodableValue(static_cast<int64_t>(metrics.executed_count)) },
+				{ flutter::EncodableValue("preemptedCount"), flutter::EncodableValue(static_cast<int64_t>(metrics.preempted_count)) },
+				{ flutter::EncodableValue("shedCount"), flutter::EncodableValue(static_cast<int64_t>(metrics.shed_count)) },
+				{ flutter::EncodableValue("latencySampleCount"), flutter::EncodableValue(static_cast<int64_t>(metrics.latency.sample_count)) },
+				{ flutter::EncodableValue("latencySmoothedMs"), to_milliseconds(metrics.latency.smoothed) },
+				{ flutter::EncodableValue("latencyDeviationMs"), to_milliseconds(metrics.latency.deviation) },
+				{ flutter::EncodableValue("latencyP50Ms"), to_milliseconds(metrics.latency.p50) },
+				{ flutter::EncodableValue("latencyP90Ms"), to_milliseconds(metrics.latency.p90) },
+				{ flutter::EncodableValue("latencyP99Ms"), to_milliseconds(metrics.latency.p99) },
+				{ flutter::EncodableValue("commandPeriodMs"), to_milliseconds(pacing.command_period) },
+				{ flutter::EncodableValue("pollIntervalMs"), to_milliseconds(pacing.poll_interval) },
+				{ flutter::EncodableValue("stallCount"), flutter::EncodableValue(static_cast<int64_t>(stall_statistics.stall_count)) },
+				{ flutter::EncodableValue("longestOperationMs"), to_milliseconds(stall_statistics.longest_duration) },
+				{ flutter::EncodableValue("idleState"), flutter::EncodableValue(display.info.handle == client_.display() ?
+					GetIdleStateName(idle_dimmer_.state()) : GetIdleStateName(IdleState::kActive)) },
+			});
+		}
 
-		free(physical_monitor);
+		result->Success(flutter::EncodableValue(std::move(displays)));
 	}
 
-	void ScreenBrightnessWindowsPlugin::SetScreenBrightness(const long screen_brightness)
+	void ScreenBrightnessWindowsPlugin::HandleSetStallBudgetMethodCall(const flutter::MethodCall<flutter::EncodableValue>& call, const std::unique_ptr<flutter::MethodResult<flutter::EncodableValue>> result)
 	{
-		if (screen_brightness < 0)
+		const flutter::EncodableMap& args = std::get<flutter::EncodableMap>(*call.arguments());
+		Clock::duration budget{};
+		if (!ToDuration(GetNumber(args, "budgetMs"), budget))
 		{
+			result->Error("-2", "Unexpected error on invalid stall budget");
 			return;
 		}
 
-		DWORD physical_monitor_array_size = 0;
-		HMONITOR monitor_handler = MonitorFromWindow(window_handler_, MONITOR_DEFAULTTOPRIMARY);
+		stall_detector_.SetBudget(budget);
+		result->Success(nullptr);
+	}
 
-		if (!GetNumberOfPhysicalMonitorsFromHMONITOR(monitor_handler, &physical_monitor_array_size))
+	void ScreenBrightnessWindowsPlugin::HandleSetIdleDimmingMethodCall(const flutter::MethodCall<flutter::EncodableValue>& call, const std::unique_ptr<flutter::MethodResult<flutter::EncodableValue>> result)
+	{
+		if (window_handler_ == nullptr)
 		{
-			throw std::exception("Problem getting numbers of monitor");
+			result->Error("-10", "Unexpected error on window handler");
+			return;
 		}
 
-		LPPHYSICAL_MONITOR physical_monitor = (LPPHYSICAL_MONITOR)malloc(physical_monitor_array_size * sizeof(PHYSICAL_MONITOR));
+		const flutter::EncodableMap& args = std::get<flutter::EncodableMap>(*call.arguments());
+		const bool is_enabled = std::get<bool>(args.at(flutter::EncodableValue("isEnabled")));
+		if (is_enabled)
+		{
+			IdleDimmingConfig config = idle_dimmer_.config();
+			const std::optional<double> dimmed_brightness = GetNumber(args, "dimmedBrightness");
+			const bool has_dim_duration = args.find(flutter::EncodableValue("dimDurationMs")) != args.end();
+			const bool has_restore_duration = args.find(flutter::EncodableValue("restoreDurationMs")) != args.end();
+			if (!ToDuration(GetNumber(args, "idleTimeoutMs"), config.idle_timeout)
+				|| !dimmed_brightness.has_value() || !(*dimmed_brightness >= 0 && *dimmed_brightness <= 1)
+				|| (has_dim_duration && !ToDuration(GetNumber(args, "dimDurationMs"), config.dim_duration))
+				|| (has_restore_duration && !ToDuration(GetNumber(args, "restoreDurationMs"), config.restore_duration)))
+			{
+				result->Error("-2", "Unexpected error on invalid idle dimming");
+				return;
+			}
 
-		if (physical_monitor == NULL)
-		{
-			throw std::exception("No monitors");
+			config.dimmed_brightness = *dimmed_brightness;
+			idle_dimmer_.SetConfig(config);
 		}
 
-		if (!GetPhysicalMonitorsFromHMONITOR(monitor_handler, physical_monitor_array_size, physical_monitor))
+		idle_dimmer_.SetEnabled(is_enabled);
+		PollIdleDimmer();
+		result->Success(nullptr);
+	}
+
+	void ScreenBrightnessWindowsPlugin::HandleCancelMethodCall(const flutter::MethodCall<flutter::EncodableValue>& call, const std::unique_ptr<flutter::MethodResult<flutter::EncodableValue>> result)
+	{
+		const flutter::EncodableMap& args = std::get<flutter::EncodableMap>(*call.arguments());
+		const std::optional<std::int64_t> operation_id = GetInteger(args, "operationId");
+		if (!operation_id.has_value())
 		{
-			throw std::exception("Problem getting physical monitors");
+			result->Error("-2", "Unexpected error on null operation id");
+			return;
 		}
 
-		if (!SetMonitorBrightness(physical_monitor->hPhysicalMonitor, screen_brightness))
+		// a method call still running was queued with the bridge, as were writes through the C ABI
+		result->Success(bridge_->Cancel(*operation_id));
+	}
+
+	void ScreenBrightnessWindowsPlugin::PollIdleDimmer()
+	{
+		const HWND root_window = GetAncestor(window_handler_, GA_ROOT);
+		const Clock::time_point next_poll_time = idle_dimmer_.Poll();
+
+		// parenthesised, as Windows.h defines a max macro
+		if (next_poll_time == (Clock::time_point::max)())
 		{
-			throw std::exception("Problem setting monitor brightness");
+			KillTimer(root_window, kIdleDimmingTimerId);
+			return;
 		}
 
-		DestroyPhysicalMonitors(physical_monitor_array_size, physical_monitor);
-
-		free(physical_monitor);
+		// setting the timer again replaces it
+		const auto delay = std::chrono::ceil<std::chrono::milliseconds>(next_poll_time - Clock::Steady().Now()).count();
+		SetTimer(root_window, kIdleDimmingTimerId, static_cast<UINT>(std::clamp<long long>(delay, USER_TIMER_MINIMUM, USER_TIMER_MAXIMUM)), nullptr);
 	}
 
-	double ScreenBrightnessWindowsPlugin::GetScreenBrightnessPercentage(const long screen_brightness) const
+	void ScreenBrightnessWindowsPlugin::HandleStall(const StallRecord& stall)
 	{
-		if (screen_brightness < 0)
+		const DisplayTopology::Display* display = client_.service().display_topology().FindByHandle(stall.display);
+		const std::string display_id = display != nullptr ? display->info.id : std::string();
+		// not logged: a slow monitor stalls every call, which would flood the application's output
+		if (stall_warning_stream_handler_ == nullptr)
 		{
-			return 0;
+			return;
 		}
 
-		return static_cast<double>(screen_brightness - minimum_screen_brightness_) / (maximum_screen_brightness_ - minimum_screen_brightness_);
+		stall_warning_stream_handler_->AddStallToEventSink(stall, display_id, stall_detector_.budget());
 	}
 
-	long ScreenBrightnessWindowsPlugin::GetScreenBrightnessValueByPercentage(const double percentage) const
+	std::optional<LRESULT> ScreenBrightnessWindowsPlugin::HandleWindowProc(HWND hWnd, UINT message, WPARAM wParam, LPARAM lParam)
 	{
-		return static_cast<long>((percentage * (maximum_screen_brightness_ - minimum_screen_brightness_)) + minimum_screen_brightness_);
+		if (message == bridge_message_)
+		{
+			bridge_->RunPendingTasks();
+			return 0;
+		}
+
+		switch (message)
+		{
+		case WM_SIZE:
+			switch (wParam)
+			{
+			case SIZE_MINIMIZED:
+				if (!client_.is_auto_reset())
+				{
+					return std::nullopt;
+				}
+
+				client_.OnApplicationPause();
+				break;
+
+			case SIZE_MAXIMIZED:
+			case SIZE_RESTORED:
+				if (!client_.is_auto_reset())
+				{
+					return std::nullopt;
+				}
+
+				client_.OnApplicationResume();
+				break;
+			}
+			break;
+
+		case WM_DISPLAYCHANGE:
+			UpdateDisplayTopology();
+			UpdateDisplay();
+			break;
+
+		case WM_MOVE:
+		case WM_DPICHANGED:
+			UpdateDisplay();
+			break;
+
+		case WM_DESTROY:
+		case WM_CLOSE:
+			RestoreOnClose();
+			break;
+
+		case WM_TIMER:
+			if (wParam != kIdleDimmingTimerId)
+			{
+				return std::nullopt;
+			}
+
+			PollIdleDimmer();
+			return 0;
+
+		case WM_ACTIVATEAPP:
+			if (!client_.is_auto_reset())
+			{
+				return std::nullopt;
+			}
+
+			bool is_activate = bool(wParam);
+			if (is_activate)
+			{
+				client_.OnApplicationResume();
+				break;
+			}
+			else
+			{
+				client_.OnApplicationPause();
+			}
+			break;
+		}
+
+		// allow another plugin to process message
+		return std::nullopt;
 	}
 
-	void ScreenBrightnessWindowsPlugin::OnApplicationPause() {
-		if (system_screen_brightness_ == -1)
+	void ScreenBrightnessWindowsPlugin::UpdateDisplay()
+	{
+		const DisplayHandle display = Dxva2MonitorBackend::ToDisplayHandle(MonitorFromWindow(window_handler_, MONITOR_DEFAULTTOPRIMARY));
+		if (display == client_.display())
 		{
 			return;
 		}
 
-		try {
-			SetScreenBrightness(system_screen_brightness_);
+		if (const MonitorStatus status = client_.MigrateDisplay(display); status != MonitorStatus::kOk)
+		{
+			std::cout << GetMonitorStatusMessage(status) << std::endl;
 		}
-		catch (const std::exception& exception)
+	}
+
+	void ScreenBrightnessWindowsPlugin::UpdateDisplayTopology()
+	{
+		// every engine gets the delta through its topology callback
+		if (const MonitorStatus status = client_.service().UpdateDisplayTopology(); status != MonitorStatus::kOk)
 		{
-			std::cout << exception.what() << std::endl;
+			std::cout << GetMonitorStatusMessage(status) << std::endl;
 		}
 	}
 
-	void ScreenBrightnessWindowsPlugin::OnApplicationResume() {
-		try
+	void ScreenBrightnessWindowsPlugin::RestoreOnClose()
+	{
+		for (const DisplayRestoreResult& result : client_.OnApplicationClose(kCloseRestoreTimeout))
 		{
-			GetScreenBrightness(minimum_screen_brightness_, system_screen_brightness_, maximum_screen_brightness_);
-			HandleSystemScreenBrightnessChanged(system_screen_brightness_);
-			if (application_screen_brightness_ == -1)
+			if (result.status != MonitorStatus::kOk)
 			{
-				HandleApplicationScreenBrightnessChanged(system_screen_brightness_);
-				return;
+				std::cout << "Restoring display " << result.display << ": " << GetMonitorStatusMessage(result.status) << std::endl;
 			}
-
-			SetScreenBrightness(application_screen_brightness_);
-		}
-		catch (const std::exception& exception)
-		{
-			std::cout << exception.what() << std::endl;
 		}
 	}
+
+	std::shared_ptr<BrightnessService> ScreenBrightnessWindowsPlugin::AcquireBrightnessService()
+	{
+		return BrightnessService::Acquire([]
+			{
+				auto service = std::make_unique<BrightnessService>(std::make_unique<Dxva2MonitorBackend>(), Clock::Steady(),
+					DdcScheduler::kMccsMinimumCommandInterval, true);
+				// without the table the process only coordinates its own engines
+				(void)service->OpenLeaseTable(SharedLeaseTable::kDefaultName);
+
+				// an override which the last run of this or another application crashed with is undone before anything
+				// takes it for the system brightness
+				if (service->OpenRestoreJournal(RestoreJournal::GetDefaultPath()) == MonitorStatus::kOk)
+				{
+					for (const DisplayRestoreResult& result : service->RecoverRestoreJournal())
+					{
+						if (result.status != MonitorStatus::kOk)
+						{
+							std::cout << "Restoring display " << result.display << ": " << GetMonitorStatusMessage(result.status) << std::endl;
+						}
+					}
+				}
+
+				return service;
+			});
+	}
 }
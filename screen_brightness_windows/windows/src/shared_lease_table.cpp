@@ -0,0 +1,436 @@
+#include "../include/screen_brightness_windows/shared_lease_table.h"
+
+#include <atomic>
+#include <thread>
+
+#include "../include/screen_brightness_windows/process_liveness.h"
+#include "../include/screen_brightness_windows/shared_slots.h"
+
+#ifdef _WIN32
+#include <Windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+namespace screen_brightness
+{
+	struct SharedLeaseTable::Slot
+	{
+		// identity key of the display, 0 while the slot is free
+		std::atomic<std::uint64_t> key;
+
+		// Owner process id in the high half, then the low 16 bits of its start token, a count of lease changes against
+		// ABA, and the busy bit. The owner is 0 when nobody holds the lease.
+		std::atomic<std::uint64_t> lease;
+
+		// odd while a value is being published
+		std::atomic<std::uint64_t> sequence;
+
+		std::atomic<std::int64_t> value;
+
+		std::atomic<std::int64_t> system_value;
+	};
+
+	struct SharedLeaseTable::Segment
+	{
+		std::atomic<std::uint32_t> layout_version;
+
+		std::uint32_t reserved;
+
+		// identity word of the process reclaiming a slot, 0 when none is
+		std::atomic<std::uint64_t> reclaim_lock;
+
+		Slot slots[kSlotCount];
+	};
+
+	namespace
+	{
+		constexpr std::uint32_t kLayoutVersion = 2;
+
+		// set by the holder while it publishes or reclaims the slot, which nobody takes from a live holder meanwhile
+		constexpr std::uint64_t kBusy = 1;
+
+		constexpr std::uint32_t kStartTokenMask = 0xffff;
+
+		static_assert(std::atomic<std::uint64_t>::is_always_lock_free, "the lease table needs lock-free 64 bit atomics");
+
+		std::uint32_t GetOwner(const std::uint64_t lease)
+		{
+			return static_cast<std::uint32_t>(lease >> 32);
+		}
+
+		ProcessIdentity GetOwnerIdentity(const std::uint64_t lease)
+		{
+			return ProcessIdentity{ GetOwner(lease), static_cast<std::uint32_t>(lease >> 16) & kStartTokenMask };
+		}
+
+		// An owner of 0 releases the lease.
+		std::uint64_t MakeLease(const ProcessIdentity& owner, const std::uint64_t previous_lease)
+		{
+			const std::uint64_t count = ((previous_lease >> 1) + 1) & 0x7fff;
+			const std::uint64_t start_token = owner.id == 0 ? 0 : owner.start_token & kStartTokenMask;
+			return (static_cast<std::uint64_t>(owner.id) << 32) | (start_token << 16) | (count << 1);
+		}
+
+#ifdef _WIN32
+		std::string GetMappingName(const std::string& name)
+		{
+			return "Local\\" + name;
+		}
+#else
+		std::string GetMappingName(const std::string& name)
+		{
+			return "/" + name;
+		}
+#endif
+	}
+
+	SharedLeaseTable::~SharedLeaseTable()
+	{
+		Close();
+	}
+
+	MonitorStatus SharedLeaseTable::Open(const std::string& name, const ProcessIdentity process)
+	{
+		Close();
+
+#ifdef _WIN32
+		const HANDLE mapping = CreateFileMappingA(INVALID_HANDLE_VALUE, nullptr, PAGE_READWRITE, 0, sizeof(Segment), GetMappingName(name).c_str());
+		if (mapping == nullptr)
+		{
+			return MonitorStatus::kSharedMemoryFailed;
+		}
+
+		void* view = MapViewOfFile(mapping, FILE_MAP_ALL_ACCESS, 0, 0, sizeof(Segment));
+		if (view == nullptr)
+		{
+			CloseHandle(mapping);
+			return MonitorStatus::kSharedMemoryFailed;
+		}
+
+		mapping_ = mapping;
+#else
+		const int file = shm_open(GetMappingName(name).c_str(), O_CREAT | O_RDWR, 0600);
+		if (file == -1)
+		{
+			return MonitorStatus::kSharedMemoryFailed;
+		}
+
+		// growing zero fills, and every process sizes it the same
+		void* view = ftruncate(file, sizeof(Segment)) == 0 ?
+			mmap(nullptr, sizeof(Segment), PROT_READ | PROT_WRITE, MAP_SHARED, file, 0) : MAP_FAILED;
+		close(file);
+		if (view == MAP_FAILED)
+		{
+			return MonitorStatus::kSharedMemoryFailed;
+		}
+#endif
+
+		process_ = process;
+
+		// the zero filled memory is a valid empty table, so the atomics are only given a type here
+		segment_ = static_cast<Segment*>(view);
+		std::uint32_t layout_version = 0;
+		if (!segment_->layout_version.compare_exchange_strong(layout_version, kLayoutVersion) && layout_version != kLayoutVersion)
+		{
+			// made by an incompatible version of the plugin
+			Close();
+			return MonitorStatus::kSharedMemoryFailed;
+		}
+
+		return MonitorStatus::kOk;
+	}
+
+	void SharedLeaseTable::Close()
+	{
+		if (segment_ == nullptr)
+		{
+			return;
+		}
+
+#ifdef _WIN32
+		UnmapViewOfFile(segment_);
+		CloseHandle(mapping_);
+		mapping_ = nullptr;
+#else
+		munmap(segment_, sizeof(Segment));
+#endif
+		segment_ = nullptr;
+	}
+
+	void SharedLeaseTable::Remove(const std::string& name)
+	{
+#ifndef _WIN32
+		shm_unlink(GetMappingName(name).c_str());
+#else
+		(void)name;
+#endif
+	}
+
+	bool SharedLeaseTable::Acquire(const DisplayIdentity identity)
+	{
+		const std::uint64_t key = GetSharedSlotKey(identity);
+		Slot* slot = FindSlot(identity, true);
+		for (int attempt = 0; slot != nullptr;)
+		{
+			// the key is checked after the lease, as a slot changes display only while its lease is busy
+			std::uint64_t lease = slot->lease.load(std::memory_order_acquire);
+			if (slot->key.load(std::memory_order_acquire) != key)
+			{
+				slot = FindSlot(identity, true);
+				continue;
+			}
+
+			if (IsOwnLease(lease))
+			{
+				return true;
+			}
+
+			if ((lease & kBusy) != 0 && IsOwnerAlive(lease))
+			{
+				if (++attempt >= kSharedSlotAttemptCount)
+				{
+					return false;
+				}
+
+				std::this_thread::yield();
+				continue;
+			}
+
+			if (slot->lease.compare_exchange_weak(lease, MakeLease(process_, lease), std::memory_order_acq_rel))
+			{
+				return true;
+			}
+		}
+
+		return false;
+	}
+
+	bool SharedLeaseTable::TryAcquire(const DisplayIdentity identity)
+	{
+		const std::uint64_t key = GetSharedSlotKey(identity);
+		Slot* slot = FindSlot(identity, true);
+		while (slot != nullptr)
+		{
+			std::uint64_t lease = slot->lease.load(std::memory_order_acquire);
+			if (slot->key.load(std::memory_order_acquire) != key)
+			{
+				slot = FindSlot(identity, true);
+				continue;
+			}
+
+			if (IsOwnLease(lease))
+			{
+				return true;
+			}
+
+			if (IsOwnerAlive(lease))
+			{
+				return false;
+			}
+
+			if (slot->lease.compare_exchange_weak(lease, MakeLease(process_, lease), std::memory_order_acq_rel))
+			{
+				return true;
+			}
+		}
+
+		return false;
+	}
+
+	void SharedLeaseTable::Release(const DisplayIdentity identity)
+	{
+		Slot* slot = FindSlot(identity, false);
+		if (slot == nullptr)
+		{
+			return;
+		}
+
+		// stops when another process has taken the lease meanwhile, which is then theirs to keep
+		std::uint64_t lease = slot->lease.load(std::memory_order_acquire);
+		while (IsOwnLease(lease) && slot->key.load(std::memory_order_acquire) == GetSharedSlotKey(identity))
+		{
+			// another thread of this process is publishing
+			if ((lease & kBusy) != 0)
+			{
+				std::this_thread::yield();
+				lease = slot->lease.load(std::memory_order_acquire);
+				continue;
+			}
+
+			if (slot->lease.compare_exchange_weak(lease, MakeLease(ProcessIdentity{}, lease), std::memory_order_acq_rel))
+			{
+				return;
+			}
+		}
+	}
+
+	bool SharedLeaseTable::IsHeld(const DisplayIdentity identity) const
+	{
+		const Slot* slot = FindSlot(identity, false);
+		return slot != nullptr && IsOwnLease(slot->lease.load(std::memory_order_acquire)) &&
+			slot->key.load(std::memory_order_acquire) == GetSharedSlotKey(identity);
+	}
+
+	bool SharedLeaseTable::Publish(const DisplayIdentity identity, const long value, const long system_value)
+	{
+		Slot* slot = FindSlot(identity, false);
+		if (slot == nullptr)
+		{
+			return false;
+		}
+
+		// the busy bit makes this the only writer: the lease is not taken from a live holder while it is set
+		std::uint64_t lease = slot->lease.load(std::memory_order_acquire);
+		for (int attempt = 0;;)
+		{
+			if (!IsOwnLease(lease) || slot->key.load(std::memory_order_acquire) != GetSharedSlotKey(identity))
+			{
+				return false;
+			}
+
+			if ((lease & kBusy) != 0)
+			{
+				// another thread of this process is publishing
+				if (++attempt >= kSharedSlotAttemptCount)
+				{
+					return false;
+				}
+
+				std::this_thread::yield();
+				lease = slot->lease.load(std::memory_order_acquire);
+				continue;
+			}
+
+			if (slot->lease.compare_exchange_weak(lease, lease | kBusy, std::memory_order_acquire))
+			{
+				break;
+			}
+		}
+
+		// an odd sequence is left by a holder which died publishing, as the lease was only taken from it once it had
+		WriteSharedSlot(*slot, [value, system_value](Slot& written_slot)
+			{
+				written_slot.value.store(value, std::memory_order_relaxed);
+				written_slot.system_value.store(system_value, std::memory_order_relaxed);
+			});
+		slot->lease.fetch_and(~kBusy, std::memory_order_release);
+		return true;
+	}
+
+	bool SharedLeaseTable::Read(const DisplayIdentity identity, SharedLeaseEntry& entry) const
+	{
+		const Slot* slot = FindSlot(identity, false);
+		if (slot == nullptr)
+		{
+			return false;
+		}
+
+		for (int attempt = 0; attempt < kSharedSlotAttemptCount; ++attempt)
+		{
+			const std::uint64_t sequence = slot->sequence.load(std::memory_order_acquire);
+			if ((sequence & 1) != 0)
+			{
+				std::this_thread::yield();
+				continue;
+			}
+
+			const std::int64_t value = slot->value.load(std::memory_order_relaxed);
+			const std::int64_t system_value = slot->system_value.load(std::memory_order_relaxed);
+			std::atomic_thread_fence(std::memory_order_acquire);
+			if (slot->sequence.load(std::memory_order_relaxed) != sequence)
+			{
+				continue;
+			}
+
+			// the slot may have been given to another display since it was found
+			const std::uint64_t lease = slot->lease.load(std::memory_order_acquire);
+			if (slot->key.load(std::memory_order_acquire) != GetSharedSlotKey(identity))
+			{
+				return false;
+			}
+
+			entry.owner = GetOwner(lease);
+			entry.is_owner_alive = IsOwnerAlive(lease);
+			entry.generation = sequence / 2;
+			entry.value = entry.generation == 0 ? -1 : static_cast<long>(value);
+			entry.system_value = entry.generation == 0 ? -1 : static_cast<long>(system_value);
+			return true;
+		}
+
+		// a holder which died half way through publishing leaves the sequence odd until the next Publish
+		return false;
+	}
+
+	SharedLeaseTable::Slot* SharedLeaseTable::FindSlot(const DisplayIdentity identity, const bool is_claiming) const
+	{
+		if (segment_ == nullptr)
+		{
+			return nullptr;
+		}
+
+		const std::uint64_t key = GetSharedSlotKey(identity);
+		Slot* slot = FindSharedSlot(segment_->slots, key, is_claiming);
+		return slot == nullptr && is_claiming ? ReclaimSlot(key) : slot;
+	}
+
+	SharedLeaseTable::Slot* SharedLeaseTable::ReclaimSlot(const std::uint64_t key) const
+	{
+		// Every slot has a display, so none is claimed by compare and swap any more. Two processes reclaiming
+		// different slots for one display would both get one, which the lock prevents.
+		if (!LockSharedWord(segment_->reclaim_lock, process_.ToWord()))
+		{
+			return nullptr;
+		}
+
+		Slot* reclaimed_slot = nullptr;
+		for (std::size_t probe = 0; probe < kSlotCount && reclaimed_slot == nullptr; ++probe)
+		{
+			Slot& slot = segment_->slots[(key + probe) % kSlotCount];
+			if (slot.key.load(std::memory_order_acquire) == key)
+			{
+				// reclaimed by another process meanwhile
+				reclaimed_slot = &slot;
+			}
+		}
+
+		for (std::size_t probe = 0; probe < kSlotCount && reclaimed_slot == nullptr; ++probe)
+		{
+			Slot& slot = segment_->slots[(key + probe) % kSlotCount];
+			std::uint64_t lease = slot.lease.load(std::memory_order_acquire);
+			if (IsOwnerAlive(lease))
+			{
+				continue;
+			}
+
+			const std::uint64_t own_lease = MakeLease(process_, lease);
+			if (!slot.lease.compare_exchange_strong(lease, own_lease | kBusy, std::memory_order_acq_rel))
+			{
+				continue;
+			}
+
+			// the values are the previous display's, so the new one starts without any
+			slot.sequence.store(0, std::memory_order_relaxed);
+			slot.value.store(-1, std::memory_order_relaxed);
+			slot.system_value.store(-1, std::memory_order_relaxed);
+			slot.key.store(key, std::memory_order_release);
+			slot.lease.store(own_lease, std::memory_order_release);
+			reclaimed_slot = &slot;
+		}
+
+		segment_->reclaim_lock.store(0, std::memory_order_release);
+		return reclaimed_slot;
+	}
+
+	bool SharedLeaseTable::IsOwnLease(const std::uint64_t lease) const
+	{
+		return GetOwnerIdentity(lease) == ProcessIdentity{ process_.id, process_.start_token & kStartTokenMask };
+	}
+
+	bool SharedLeaseTable::IsOwnerAlive(const std::uint64_t lease) const
+	{
+		return GetOwner(lease) != 0 && (IsOwnLease(lease) || IsProcessAlive(GetOwnerIdentity(lease), kStartTokenMask));
+	}
+}
@@ -0,0 +1,75 @@
+#include "../include/screen_brightness_windows/stall_detector.h"
+
+#include <algorithm>
+#include <utility>
+
+namespace screen_brightness
+{
+	namespace
+	{
+		void Count(StallStatistics& statistics, const Clock::duration duration, const bool is_stall)
+		{
+			++statistics.operation_count;
+			if (is_stall)
+			{
+				++statistics.stall_count;
+			}
+
+			statistics.longest_duration = std::max(statistics.longest_duration, duration);
+		}
+	}
+
+	StallDetector::Scope::Scope(StallDetector& detector, const std::string_view operation, const DisplayHandle display, const char* call_site) :
+		detector_(detector), operation_(operation), display_(display), call_site_(call_site), start_(detector.clock_.Now())
+	{
+	}
+
+	StallDetector::Scope::~Scope()
+	{
+		detector_.Finish(operation_, display_, call_site_, start_);
+	}
+
+	StallDetector::StallDetector(Clock& clock, const Clock::duration budget) : clock_(clock), budget_(budget)
+	{
+	}
+
+	void StallDetector::SetStallCallback(StallCallback callback)
+	{
+		stall_callback_ = std::move(callback);
+	}
+
+	StallDetector::Scope StallDetector::Measure(const std::string_view operation, const DisplayHandle display, const char* call_site)
+	{
+		return Scope(*this, operation, display, call_site);
+	}
+
+	StallStatistics StallDetector::GetStatistics(const DisplayHandle display) const
+	{
+		const auto statistics = display_statistics_.find(display);
+		return statistics == display_statistics_.end() ? StallStatistics{} : statistics->second;
+	}
+
+	void StallDetector::Finish(const std::string_view operation, const DisplayHandle display, const char* call_site, const Clock::time_point start)
+	{
+		const Clock::time_point end = clock_.Now();
+		const Clock::duration duration = end - start;
+		const bool is_stall = duration > budget_;
+		Count(statistics_, duration, is_stall);
+		Count(display_statistics_[display], duration, is_stall);
+		if (!is_stall)
+		{
+			return;
+		}
+
+		if (recent_stalls_.size() == kRecentStallCount)
+		{
+			recent_stalls_.pop_front();
+		}
+
+		recent_stalls_.push_back(StallRecord{ std::string(operation), display, call_site, duration, end });
+		if (stall_callback_)
+		{
+			stall_callback_(recent_stalls_.back());
+		}
+	}
+}
@@ -0,0 +1,19 @@
+#include "../include/screen_brightness_windows/stall_warning_stream_handler.h"
+
+namespace screen_brightness
+{
+	void StallWarningStreamHandler::AddStallToEventSink(const StallRecord& stall, const std::string& display_id, const Clock::duration budget) const
+	{
+		if (sink_ == nullptr) {
+			return;
+		}
+
+		sink_->Success(flutter::EncodableMap{
+			{ flutter::EncodableValue("operation"), flutter::EncodableValue(stall.operation) },
+			{ flutter::EncodableValue("displayId"), flutter::EncodableValue(display_id) },
+			{ flutter::EncodableValue("callSite"), flutter::EncodableValue(stall.call_site) },
+			{ flutter::EncodableValue("durationMs"), flutter::EncodableValue(std::chrono::duration<double, std::milli>(stall.duration).count()) },
+			{ flutter::EncodableValue("budgetMs"), flutter::EncodableValue(std::chrono::duration<double, std::milli>(budget).count()) },
+		});
+	}
+}
@@ -0,0 +1,219 @@
+#include "../include/screen_brightness_windows/sysfs_monitor_backend.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <utility>
+
+#include <dirent.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+namespace screen_brightness
+{
+	namespace
+	{
+		// Reads a decimal sysfs attribute into a stack buffer; sysfs attributes are read in one go.
+		bool ReadValue(const std::string& path, long& value)
+		{
+			const int file = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+			if (file < 0)
+			{
+				return false;
+			}
+
+			char buffer[32];
+			const ssize_t size = read(file, buffer, sizeof(buffer) - 1);
+			close(file);
+			if (size <= 0)
+			{
+				return false;
+			}
+
+			buffer[size] = '\0';
+			char* end = nullptr;
+			value = std::strtol(buffer, &end, 10);
+			return end != buffer;
+		}
+
+		bool WriteValue(const std::string& path, const long value)
+		{
+			const int file = open(path.c_str(), O_WRONLY | O_CLOEXEC);
+			if (file < 0)
+			{
+				return false;
+			}
+
+			char buffer[32];
+			const int size = std::snprintf(buffer, sizeof(buffer), "%ld", value);
+			const bool is_written = write(file, buffer, size) == size;
+			close(file);
+			return is_written;
+		}
+	}
+
+	SysfsMonitorBackend::SysfsMonitorBackend(std::string root) : root_(std::move(root))
+	{
+		DIR* directory = opendir(root_.c_str());
+		if (directory == nullptr)
+		{
+			return;
+		}
+
+		while (const dirent* entry = readdir(directory))
+		{
+			Device device;
+			device.name = entry->d_name;
+			const std::string device_path = root_ + "/" + device.name;
+			device.brightness_path = device_path + "/brightness";
+			device.actual_brightness_path = device_path + "/actual_brightness";
+			device.maximum_brightness_path = device_path + "/max_brightness";
+			device.edid_path = device_path + "/device/edid";
+
+			long maximum_brightness = 0;
+			if (device.name.front() == '.' || !ReadValue(device.maximum_brightness_path, maximum_brightness))
+			{
+				continue;
+			}
+
+			devices_.push_back(std::move(device));
+		}
+
+		closedir(directory);
+		std::sort(devices_.begin(), devices_.end(), [](const Device& a, const Device& b) { return a.name < b.name; });
+	}
+
+	MonitorStatus SysfsMonitorBackend::EnumerateDisplays(std::vector<DisplayInfo>& displays)
+	{
+		displays.clear();
+		for (size_t index = 0; index < devices_.size(); ++index)
+		{
+			displays.push_back(DisplayInfo{ index + 1, devices_[index].name, devices_[index].name });
+		}
+
+		return MonitorStatus::kOk;
+	}
+
+	DisplayHandle SysfsMonitorBackend::GetPrimaryDisplay()
+	{
+		return devices_.empty() ? 0 : 1;
+	}
+
+	MonitorStatus SysfsMonitorBackend::GetScreenBrightness(const DisplayHandle display, long& minimum_screen_brightness, long& screen_brightness, long& maximum_screen_brightness)
+	{
+		const Device* device = FindDevice(display);
+		if (device == nullptr)
+		{
+			return MonitorStatus::kNoMonitors;
+		}
+
+		long brightness = 0, maximum_brightness = 0;
+		if (!ReadValue(device->maximum_brightness_path, maximum_brightness))
+		{
+			return MonitorStatus::kGetBrightnessFailed;
+		}
+
+		// actual_brightness reflects the hardware, brightness only the last requested value
+		if (!ReadValue(device->actual_brightness_path, brightness) && !ReadValue(device->brightness_path, brightness))
+		{
+			return MonitorStatus::kGetBrightnessFailed;
+		}
+
+		minimum_screen_brightness = 0;
+		screen_brightness = brightness;
+		maximum_screen_brightness = maximum_brightness;
+		return MonitorStatus::kOk;
+	}
+
+	MonitorStatus SysfsMonitorBackend::SetScreenBrightness(const DisplayHandle display, const long screen_brightness)
+	{
+		const Device* device = FindDevice(display);
+		if (device == nullptr)
+		{
+			return MonitorStatus::kNoMonitors;
+		}
+
+		if (!WriteValue(device->brightness_path, screen_brightness))
+		{
+			return MonitorStatus::kSetBrightnessFailed;
+		}
+
+		return MonitorStatus::kOk;
+	}
+
+	MonitorStatus SysfsMonitorBackend::GetVcpFeature(const DisplayHandle display, const VcpCode code, unsigned long& current_value, unsigned long& maximum_value)
+	{
+		// a backlight only has a luminance control
+		if (code != kVcpLuminance)
+		{
+			return FindDevice(display) == nullptr ? MonitorStatus::kNoMonitors : MonitorStatus::kUnsupported;
+		}
+
+		long minimum_brightness = 0, brightness = 0, maximum_brightness = 0;
+		if (const MonitorStatus status = GetScreenBrightness(display, minimum_brightness, brightness, maximum_brightness); status != MonitorStatus::kOk)
+		{
+			return status;
+		}
+
+		current_value = static_cast<unsigned long>(brightness);
+		maximum_value = static_cast<unsigned long>(maximum_brightness);
+		return MonitorStatus::kOk;
+	}
+
+	MonitorStatus SysfsMonitorBackend::SetVcpFeature(const DisplayHandle display, const VcpCode code, const unsigned long value)
+	{
+		if (code != kVcpLuminance)
+		{
+			return FindDevice(display) == nullptr ? MonitorStatus::kNoMonitors : MonitorStatus::kUnsupported;
+		}
+
+		return SetScreenBrightness(display, static_cast<long>(value));
+	}
+
+	MonitorStatus SysfsMonitorBackend::GetCapabilitiesString(const DisplayHandle display, std::string&)
+	{
+		return FindDevice(display) == nullptr ? MonitorStatus::kNoMonitors : MonitorStatus::kUnsupported;
+	}
+
+	MonitorStatus SysfsMonitorBackend::GetEdid(const DisplayHandle display, std::vector<std::uint8_t>& edid)
+	{
+		const Device* device = FindDevice(display);
+		if (device == nullptr)
+		{
+			return MonitorStatus::kNoMonitors;
+		}
+
+		// firmware backlights such as acpi_video0 have no connector
+		const int file = open(device->edid_path.c_str(), O_RDONLY | O_CLOEXEC);
+		if (file < 0)
+		{
+			return MonitorStatus::kUnsupported;
+		}
+
+		edid.clear();
+		std::uint8_t buffer[256];
+		ssize_t size = 0;
+		while ((size = read(file, buffer, sizeof(buffer))) > 0)
+		{
+			edid.insert(edid.end(), buffer, buffer + size);
+		}
+
+		close(file);
+		if (size < 0 || edid.empty())
+		{
+			return MonitorStatus::kGetEdidFailed;
+		}
+
+		return MonitorStatus::kOk;
+	}
+
+	const SysfsMonitorBackend::Device* SysfsMonitorBackend::FindDevice(const DisplayHandle display) const
+	{
+		if (display == 0 || display > devices_.size())
+		{
+			return nullptr;
+		}
+
+		return &devices_[display - 1];
+	}
+}
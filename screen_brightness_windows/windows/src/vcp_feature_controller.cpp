@@ -0,0 +1,123 @@
+#include "../include/screen_brightness_windows/vcp_feature_controller.h"
+
+#include <memory>
+#include <utility>
+
+namespace screen_brightness
+{
+	VcpFeatureController::VcpFeatureController(ScheduledMonitorBackend& backend, const DisplayTopology& topology) :
+		backend_(backend), topology_(topology)
+	{
+	}
+
+	MonitorStatus VcpFeatureController::GetVcpFeatures(const DisplayHandle display, const std::vector<VcpCode>& codes, std::vector<VcpFeatureValue>& features)
+	{
+		features.assign(codes.size(), VcpFeatureValue{});
+		for (size_t index = 0; index < codes.size(); ++index)
+		{
+			features[index].code = codes[index];
+		}
+
+		if (codes.empty())
+		{
+			return MonitorStatus::kOk;
+		}
+
+		// detachable, so a deadline or cancellation also ends the wait for a batch the monitor is already working on; the
+		// batch then owns its results
+		DdcScheduler& scheduler = backend_.GetScheduler(display);
+		auto batch = std::make_shared<std::vector<VcpFeatureValue>>(features);
+		const MonitorStatus status = scheduler.RunDetachable(DdcPriority::kUserWrite, kDdcNoCoalescing,
+			[&backend = backend_.backend(), &clock = backend_.clock(), &scheduler, display, batch]
+			{
+				const Clock::duration minimum_command_interval = scheduler.minimum_command_interval();
+				for (size_t index = 0; index < batch->size(); ++index)
+				{
+					// the scheduler spaces the slot from the previous command, the batch spaces its own reads
+					if (index > 0)
+					{
+						clock.SleepUntil(clock.Now() + minimum_command_interval);
+					}
+
+					VcpFeatureValue& feature = (*batch)[index];
+					feature.status = backend.GetVcpFeature(display, feature.code, feature.current_value, feature.maximum_value);
+					if (feature.status == MonitorStatus::kNoMonitors)
+					{
+						// the display is gone, the remaining reads would fail the same way
+						return MonitorStatus::kNoMonitors;
+					}
+				}
+
+				return MonitorStatus::kOk;
+			});
+		if (status == MonitorStatus::kOk || status == MonitorStatus::kNoMonitors)
+		{
+			features = *batch;
+		}
+
+		return status;
+	}
+
+	MonitorStatus VcpFeatureController::SetVcpFeature(const DisplayHandle display, const VcpCode code, const unsigned long value)
+	{
+		return backend_.SetVcpFeature(display, code, value);
+	}
+
+	MonitorStatus VcpFeatureController::GetCapabilitiesString(const DisplayHandle display, std::string& capabilities)
+	{
+		const CachedCapabilities* cached_capabilities = nullptr;
+		if (const MonitorStatus status = FindCapabilities(display, cached_capabilities); status != MonitorStatus::kOk)
+		{
+			return status;
+		}
+
+		capabilities = cached_capabilities->text;
+		return MonitorStatus::kOk;
+	}
+
+	MonitorStatus VcpFeatureController::GetCapabilities(const DisplayHandle display, const MccsCapabilities*& capabilities)
+	{
+		const CachedCapabilities* cached_capabilities = nullptr;
+		if (const MonitorStatus status = FindCapabilities(display, cached_capabilities); status != MonitorStatus::kOk)
+		{
+			return status;
+		}
+
+		capabilities = &cached_capabilities->table;
+		return MonitorStatus::kOk;
+	}
+
+	DisplayIdentity VcpFeatureController::GetIdentity(const DisplayHandle display) const
+	{
+		if (const DisplayTopology::Display* known_display = topology_.FindByHandle(display); known_display != nullptr)
+		{
+			return known_display->info.identity;
+		}
+
+		// a display the topology has not seen yet is cached under its handle until then
+		return DisplayIdentity{ display };
+	}
+
+	MonitorStatus VcpFeatureController::FindCapabilities(const DisplayHandle display, const CachedCapabilities*& capabilities)
+	{
+		const DisplayIdentity identity = GetIdentity(display);
+		if (const auto iterator = capabilities_.find(identity); iterator != capabilities_.end())
+		{
+			capabilities = &iterator->second;
+			return MonitorStatus::kOk;
+		}
+
+		std::string text;
+		if (const MonitorStatus status = backend_.GetCapabilitiesString(display, text); status != MonitorStatus::kOk)
+		{
+			return status;
+		}
+
+		CachedCapabilities& cached_capabilities = capabilities_[identity];
+		cached_capabilities.text = std::move(text);
+		// a string without a vcp section still answers the text fields, so it is kept
+		cached_capabilities.table.Parse(cached_capabilities.text);
+		capabilities = &cached_capabilities;
+		return MonitorStatus::kOk;
+	}
+}
@@ -0,0 +1,198 @@
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <memory>
+#include <new>
+#include <string_view>
+
+#include "screen_brightness_windows/brightness_service.h"
+#include "screen_brightness_windows/fake_monitor_backend.h"
+#include "screen_brightness_windows/mccs_capabilities.h"
+#include "screen_brightness_windows/small_buffer.h"
+
+// Counts every allocation of the test binary so the brightness path can be shown to be allocation free. Leaks are
+// reported by LeakSanitizer when the tests are built with SCREEN_BRIGHTNESS_WINDOWS_SANITIZERS=address.
+namespace
+{
+	std::atomic<long> allocation_count{ 0 };
+
+	void* Allocate(const std::size_t size)
+	{
+		++allocation_count;
+		return std::malloc(size == 0 ? 1 : size);
+	}
+}
+
+void* operator new(const std::size_t size)
+{
+	if (void* pointer = Allocate(size))
+	{
+		return pointer;
+	}
+
+	throw std::bad_alloc();
+}
+
+void* operator new[](const std::size_t size)
+{
+	return operator new(size);
+}
+
+void* operator new(const std::size_t size, const std::nothrow_t&) noexcept
+{
+	return Allocate(size);
+}
+
+void* operator new[](const std::size_t size, const std::nothrow_t&) noexcept
+{
+	return Allocate(size);
+}
+
+void operator delete(void* pointer) noexcept
+{
+	std::free(pointer);
+}
+
+void operator delete[](void* pointer) noexcept
+{
+	std::free(pointer);
+}
+
+void operator delete(void* pointer, std::size_t) noexcept
+{
+	std::free(pointer);
+}
+
+void operator delete[](void* pointer, std::size_t) noexcept
+{
+	std::free(pointer);
+}
+
+namespace screen_brightness
+{
+	namespace test
+	{
+		namespace
+		{
+			constexpr int kSoakIterations = 100000;
+
+			struct Trivial
+			{
+				int value;
+			};
+		}
+
+		TEST(SmallBufferTest, KeepsSmallSizesInline)
+		{
+			SmallBuffer<Trivial, 4> buffer;
+			const long allocations = allocation_count;
+
+			ASSERT_NE(buffer.Resize(4), nullptr);
+			EXPECT_TRUE(buffer.is_inline());
+			EXPECT_EQ(buffer.size(), 4u);
+			EXPECT_EQ(allocation_count, allocations);
+		}
+
+		TEST(SmallBufferTest, SpillsLargeSizesToHeap)
+		{
+			SmallBuffer<Trivial, 4> buffer;
+			const long allocations = allocation_count;
+
+			ASSERT_NE(buffer.Resize(5), nullptr);
+			EXPECT_FALSE(buffer.is_inline());
+			buffer.data()[4].value = 1;
+			EXPECT_EQ(allocation_count, allocations + 1);
+
+			ASSERT_NE(buffer.Resize(1), nullptr);
+			EXPECT_TRUE(buffer.is_inline());
+		}
+
+		// The plugin's path: a client of the shared service, whose commands go through the display's bus scheduler.
+		void SoakBrightnessClient(const bool is_threaded)
+		{
+			auto owned_backend = std::make_unique<FakeMonitorBackend>();
+			FakeMonitorBackend& backend = *owned_backend;
+			const DisplayHandle display = backend.AddDisplay({ "fake", 0, 40, 100 });
+			const auto service = std::make_shared<BrightnessService>(std::move(owned_backend), Clock::Steady(), std::chrono::milliseconds(0), is_threaded);
+			BrightnessClient client(service);
+			double last_change = 0;
+			client.SetApplicationScreenBrightnessChangedCallback([&last_change](double brightness) { last_change = brightness; });
+			client.SetDisplay(display);
+			client.Initialize();
+
+			// the first round sizes the override list and the scheduler's queue and run slots
+			ASSERT_EQ(client.SetApplicationScreenBrightness(0.5), MonitorStatus::kOk);
+			client.OnApplicationPause();
+			client.OnApplicationResume();
+			ASSERT_EQ(client.ResetApplicationScreenBrightness(), MonitorStatus::kOk);
+
+			const long allocations = allocation_count;
+			for (int iteration = 0; iteration < kSoakIterations / 10; ++iteration)
+			{
+				double brightness = 0;
+				ASSERT_EQ(client.SetApplicationScreenBrightness((iteration % 100) / 100.0), MonitorStatus::kOk);
+				ASSERT_EQ(client.GetApplicationScreenBrightness(brightness), MonitorStatus::kOk);
+				ASSERT_EQ(client.SetSystemScreenBrightness(0.4), MonitorStatus::kOk);
+				client.OnApplicationPause();
+				client.OnApplicationResume();
+				ASSERT_EQ(client.ResetApplicationScreenBrightness(), MonitorStatus::kOk);
+			}
+
+			EXPECT_EQ(allocation_count, allocations);
+			EXPECT_EQ(backend.GetDisplay(display).brightness, 40);
+		}
+
+		TEST(AllocationSoakTest, ClientPathDoesNotAllocate)
+		{
+			SoakBrightnessClient(false);
+		}
+
+		TEST(AllocationSoakTest, ThreadedClientPathDoesNotAllocate)
+		{
+			SoakBrightnessClient(true);
+		}
+
+		TEST(AllocationSoakTest, FailingClientPathDoesNotAllocate)
+		{
+			auto owned_backend = std::make_unique<FakeMonitorBackend>();
+			FakeMonitorBackend& backend = *owned_backend;
+			const DisplayHandle display = backend.AddDisplay({ "flaky", 0, 40, 100 });
+			const auto service = std::make_shared<BrightnessService>(std::move(owned_backend), Clock::Steady(), std::chrono::milliseconds(0), false);
+			BrightnessClient client(service);
+			client.SetDisplay(display);
+			client.Initialize();
+			backend.GetDisplay(display).is_failing = true;
+			ASSERT_EQ(client.SetApplicationScreenBrightness(0.5), MonitorStatus::kSetBrightnessFailed);
+
+			const long allocations = allocation_count;
+			for (int iteration = 0; iteration < kSoakIterations / 10; ++iteration)
+			{
+				double brightness = 0;
+				ASSERT_EQ(client.SetApplicationScreenBrightness(0.5), MonitorStatus::kSetBrightnessFailed);
+				ASSERT_EQ(client.GetApplicationScreenBrightness(brightness), MonitorStatus::kGetBrightnessFailed);
+			}
+
+			EXPECT_EQ(allocation_count, allocations);
+			EXPECT_FALSE(client.HasApplicationScreenBrightnessChanged());
+		}
+
+		TEST(AllocationSoakTest, CapabilitiesReparseDoesNotAllocate)
+		{
+			const std::string_view capabilities_string =
+				"(prot(monitor)type(lcd)model(soak)vcp(02 04 10 12 14(05 08 0B) 60(0F 11 12) DC(00 03 05))mccs_ver(2.2))";
+			MccsCapabilities capabilities;
+			ASSERT_TRUE(capabilities.Parse(capabilities_string));
+
+			const long allocations = allocation_count;
+			for (int iteration = 0; iteration < kSoakIterations; ++iteration)
+			{
+				ASSERT_TRUE(capabilities.Parse(capabilities_string));
+			}
+
+			EXPECT_EQ(allocation_count, allocations);
+			EXPECT_TRUE(capabilities.IsAllowed(kVcpInputSource, 0x12));
+		}
+	}
+}
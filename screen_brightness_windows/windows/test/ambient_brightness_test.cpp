@@ -0,0 +1,213 @@
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <memory>
+#include <vector>
+
+#include "screen_brightness_windows/ambient_brightness.h"
+#include "screen_brightness_windows/brightness_service.h"
+#include "screen_brightness_windows/fake_monitor_backend.h"
+
+namespace screen_brightness
+{
+	namespace test
+	{
+		using std::chrono::milliseconds;
+		using std::chrono::seconds;
+
+		class ManualAmbientLightSource final : public AmbientLightSource
+		{
+		public:
+			double lux = 0;
+
+			bool has_reading = true;
+
+			bool ReadIlluminance(double& illuminance) override
+			{
+				if (!has_reading)
+				{
+					return false;
+				}
+
+				illuminance = lux;
+				++sample_count_;
+				return true;
+			}
+
+			std::uint64_t sample_count() const override { return sample_count_; }
+
+		private:
+			std::uint64_t sample_count_ = 0;
+		};
+
+		class AmbientBrightnessTest : public ::testing::Test
+		{
+		protected:
+			ManualClock clock_;
+
+			ManualAmbientLightSource source_;
+
+			FakeMonitorBackend* backend_ = nullptr;
+
+			DisplayHandle display_ = 0;
+
+			std::unique_ptr<BrightnessClient> client_;
+
+			std::unique_ptr<AmbientBrightnessController> controller_;
+
+			void SetUp() override
+			{
+				auto backend = std::make_unique<FakeMonitorBackend>();
+				backend_ = backend.get();
+				display_ = backend->AddDisplay({ "ambient", 0, 80, 100 });
+				client_ = std::make_unique<BrightnessClient>(std::make_shared<BrightnessService>(std::move(backend), clock_, milliseconds(0), false));
+				client_->SetDisplay(display_);
+				client_->Initialize();
+
+				AmbientBrightnessConfig config;
+				config.curve = { { 1, 0.1 }, { 1000, 1.0 } };
+				controller_ = std::make_unique<AmbientBrightnessController>(*client_, source_, clock_);
+				controller_->SetConfig(config);
+				controller_->SetEnabled(true);
+			}
+
+			void PollAt(const Clock::time_point time)
+			{
+				clock_.SleepUntil(time);
+				(void)controller_->Poll();
+			}
+
+			long brightness()
+			{
+				return backend_->GetDisplay(display_).brightness;
+			}
+		};
+
+		TEST_F(AmbientBrightnessTest, MapsIlluminanceInLogLux)
+		{
+			const std::vector<AmbientBrightnessPoint> curve = { { 10, 0.2 }, { 1000, 0.8 } };
+			EXPECT_DOUBLE_EQ(AmbientBrightnessController::MapIlluminance(curve, 0), 0.2);
+			EXPECT_DOUBLE_EQ(AmbientBrightnessController::MapIlluminance(curve, 10), 0.2);
+			EXPECT_DOUBLE_EQ(AmbientBrightnessController::MapIlluminance(curve, 100), 0.5);
+			EXPECT_DOUBLE_EQ(AmbientBrightnessController::MapIlluminance(curve, 1000), 0.8);
+			EXPECT_DOUBLE_EQ(AmbientBrightnessController::MapIlluminance(curve, 100000), 0.8);
+		}
+
+		TEST_F(AmbientBrightnessTest, AppliesTheFirstReading)
+		{
+			source_.lux = 1000;
+			const Clock::time_point start = clock_.Now();
+			EXPECT_EQ(controller_->Poll(), start + milliseconds(250));
+			EXPECT_EQ(brightness(), 100);
+			EXPECT_DOUBLE_EQ(controller_->smoothed_lux(), 1000);
+
+			const AmbientBrightnessCounters& counters = controller_->counters();
+			EXPECT_EQ(counters.poll_count, 1u);
+			EXPECT_EQ(counters.reading_count, 1u);
+			EXPECT_EQ(counters.sample_count, 1u);
+			EXPECT_EQ(counters.write_count, 1u);
+			EXPECT_EQ(counters.failed_write_count, 0u);
+		}
+
+		TEST_F(AmbientBrightnessTest, SmoothsSteps)
+		{
+			source_.lux = 1000;
+			Clock::time_point next_poll_time = controller_->Poll();
+
+			// after one time constant the smoothed illuminance covers 63% of the step
+			source_.lux = 0;
+			const Clock::time_point step_time = clock_.Now();
+			while (clock_.Now() < step_time + seconds(2))
+			{
+				PollAt(next_poll_time);
+				next_poll_time = clock_.Now() + milliseconds(250);
+			}
+
+			EXPECT_NEAR(controller_->smoothed_lux(), 1000 * 0.3679, 1);
+			EXPECT_LT(brightness(), 100);
+			EXPECT_GT(brightness(), 10);
+		}
+
+		TEST_F(AmbientBrightnessTest, IgnoresChangesWithinTheThresholds)
+		{
+			AmbientBrightnessConfig config = controller_->config();
+			config.time_constant = Clock::duration::zero();
+			controller_->SetConfig(config);
+			source_.lux = 100;
+			(void)controller_->Poll();
+			const long write_count = backend_->set_count();
+
+			// 8% brighter and 15% darker stay below the thresholds of 10% and 20%
+			source_.lux = 108;
+			PollAt(clock_.Now() + milliseconds(250));
+			source_.lux = 85;
+			PollAt(clock_.Now() + milliseconds(250));
+			EXPECT_EQ(backend_->set_count(), write_count);
+
+			source_.lux = 75;
+			PollAt(clock_.Now() + milliseconds(250));
+			EXPECT_EQ(backend_->set_count(), write_count + 1);
+		}
+
+		TEST_F(AmbientBrightnessTest, SkipsWritesWithinTheDeadband)
+		{
+			AmbientBrightnessConfig config = controller_->config();
+			config.time_constant = Clock::duration::zero();
+			config.deadband = 0.2;
+			controller_->SetConfig(config);
+			source_.lux = 100;
+			(void)controller_->Poll();
+			const long write_count = backend_->set_count();
+
+			// 50% brighter, but only 0.05 of brightness
+			source_.lux = 150;
+			PollAt(clock_.Now() + milliseconds(250));
+			EXPECT_EQ(backend_->set_count(), write_count);
+		}
+
+		TEST_F(AmbientBrightnessTest, CountsFailedWritesAndRetries)
+		{
+			source_.lux = 1000;
+			backend_->GetDisplay(display_).is_failing = true;
+			(void)controller_->Poll();
+			EXPECT_EQ(controller_->counters().failed_write_count, 1u);
+			EXPECT_EQ(controller_->counters().write_count, 0u);
+
+			backend_->GetDisplay(display_).is_failing = false;
+			PollAt(clock_.Now() + milliseconds(250));
+			EXPECT_EQ(controller_->counters().write_count, 1u);
+			EXPECT_EQ(brightness(), 100);
+		}
+
+		TEST_F(AmbientBrightnessTest, DoesNothingWithoutReadings)
+		{
+			source_.has_reading = false;
+			(void)controller_->Poll();
+			EXPECT_EQ(controller_->counters().poll_count, 1u);
+			EXPECT_EQ(controller_->counters().reading_count, 0u);
+			EXPECT_EQ(backend_->set_count(), 0);
+			EXPECT_DOUBLE_EQ(controller_->smoothed_lux(), -1);
+		}
+
+		TEST_F(AmbientBrightnessTest, ResetsItsOverrideWhenDisabled)
+		{
+			source_.lux = 1000;
+			(void)controller_->Poll();
+			ASSERT_EQ(brightness(), 100);
+
+			controller_->SetEnabled(false);
+			EXPECT_EQ(brightness(), 80);
+			EXPECT_EQ(controller_->Poll(), Clock::time_point::max());
+		}
+
+		TEST_F(AmbientBrightnessTest, KeepsAnOverrideSetByOthersWhenDisabled)
+		{
+			source_.lux = 1000;
+			(void)controller_->Poll();
+			ASSERT_EQ(client_->SetApplicationScreenBrightness(0.3), MonitorStatus::kOk);
+
+			controller_->SetEnabled(false);
+			EXPECT_EQ(brightness(), 30);
+		}
+	}
+}
@@ -0,0 +1,167 @@
+#include <gtest/gtest.h>
+
+#include <cstdint>
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include "screen_brightness_windows/brightness_bridge.h"
+#include "screen_brightness_windows/fake_monitor_backend.h"
+
+namespace screen_brightness
+{
+	namespace test
+	{
+		// The platform thread is the test thread; wakes are counted and the test runs the pending tasks.
+		class BrightnessBridgeTest : public ::testing::Test
+		{
+		protected:
+			FakeMonitorBackend* backend_ = nullptr;
+
+			DisplayHandle display_ = 0;
+
+			std::unique_ptr<BrightnessClient> client_;
+
+			int wake_count_ = 0;
+
+			std::shared_ptr<BrightnessBridge> bridge_;
+
+			std::vector<std::pair<std::int64_t, MonitorStatus>> completions_;
+
+			void SetUp() override
+			{
+				auto backend = std::make_unique<FakeMonitorBackend>();
+				backend_ = backend.get();
+				display_ = backend->AddDisplay({ "bridge", 0, 40, 100 });
+				client_ = std::make_unique<BrightnessClient>(
+					std::make_shared<BrightnessService>(std::move(backend), Clock::Steady(), std::chrono::milliseconds(0), false));
+				client_->SetDisplay(display_);
+				client_->Initialize();
+				bridge_ = std::make_shared<BrightnessBridge>(*client_, [this] { ++wake_count_; });
+				client_->SetApplicationScreenBrightnessChangedCallback([this](const double brightness) { bridge_->OnBrightnessChanged(brightness); });
+			}
+
+			void TearDown() override
+			{
+				BrightnessBridge::Uninstall(bridge_.get());
+			}
+
+			BrightnessBridge::CompletionCallback Record()
+			{
+				return [this](const std::int64_t request_id, const MonitorStatus status) { completions_.emplace_back(request_id, status); };
+			}
+		};
+
+		TEST_F(BrightnessBridgeTest, CachesTheSystemBrightnessUntilOverridden)
+		{
+			EXPECT_DOUBLE_EQ(bridge_->cached_brightness(), 0.4);
+			EXPECT_EQ(BrightnessBridge::GetInstalled(), nullptr);
+			EXPECT_EQ(BrightnessBridge::GetInstalledCachedBrightness(), -1);
+
+			BrightnessBridge::Install(bridge_);
+			EXPECT_EQ(BrightnessBridge::GetInstalled(), bridge_);
+			EXPECT_DOUBLE_EQ(BrightnessBridge::GetInstalledCachedBrightness(), 0.4);
+
+			const std::int64_t request_id = bridge_->SetApplicationScreenBrightnessAsync(0.7, Record());
+			EXPECT_EQ(wake_count_, 1);
+			EXPECT_TRUE(completions_.empty());
+			bridge_->RunPendingTasks();
+
+			ASSERT_EQ(completions_.size(), 1u);
+			EXPECT_EQ(completions_[0].first, request_id);
+			EXPECT_EQ(completions_[0].second, MonitorStatus::kOk);
+			EXPECT_EQ(backend_->GetDisplay(display_).brightness, 70);
+			EXPECT_DOUBLE_EQ(bridge_->cached_brightness(), 0.7);
+			EXPECT_DOUBLE_EQ(BrightnessBridge::GetInstalledCachedBrightness(), 0.7);
+		}
+
+		TEST_F(BrightnessBridgeTest, AppliesOnlyTheLatestQueuedWrite)
+		{
+			std::vector<double> notified;
+			const std::int64_t subscription_id = bridge_->Subscribe([&notified](const double brightness) { notified.push_back(brightness); });
+			const std::int64_t first_id = bridge_->SetApplicationScreenBrightnessAsync(0.5, Record());
+			const std::int64_t second_id = bridge_->SetApplicationScreenBrightnessAsync(0.6, Record());
+			const std::int64_t third_id = bridge_->SetApplicationScreenBrightnessAsync(0.8, Record());
+
+			// the replaced writes complete at once, and the platform thread is woken once
+			EXPECT_EQ(wake_count_, 1);
+			ASSERT_EQ(completions_.size(), 2u);
+			EXPECT_EQ(completions_[0], std::make_pair(first_id, MonitorStatus::kPreempted));
+			EXPECT_EQ(completions_[1], std::make_pair(second_id, MonitorStatus::kPreempted));
+
+			bridge_->RunPendingTasks();
+			bridge_->RunPendingTasks();
+			ASSERT_EQ(completions_.size(), 3u);
+			EXPECT_EQ(completions_[2], std::make_pair(third_id, MonitorStatus::kOk));
+			EXPECT_EQ(backend_->set_count(), 1);
+			EXPECT_EQ(notified, std::vector<double>({ 0.8 }));
+
+			bridge_->Unsubscribe(subscription_id);
+			(void)bridge_->SetApplicationScreenBrightnessAsync(0.3, nullptr);
+			bridge_->RunPendingTasks();
+			EXPECT_EQ(notified.size(), 1u);
+		}
+
+		TEST_F(BrightnessBridgeTest, EarliestInstalledBridgeWins)
+		{
+			auto other_bridge = std::make_shared<BrightnessBridge>(*client_, [] {});
+			BrightnessBridge::Install(bridge_);
+			BrightnessBridge::Install(other_bridge);
+			EXPECT_EQ(BrightnessBridge::GetInstalled(), bridge_);
+
+			BrightnessBridge::Uninstall(bridge_.get());
+			EXPECT_EQ(BrightnessBridge::GetInstalled(), other_bridge);
+			BrightnessBridge::Uninstall(other_bridge.get());
+			EXPECT_EQ(BrightnessBridge::GetInstalled(), nullptr);
+			EXPECT_EQ(BrightnessBridge::GetInstalledCachedBrightness(), -1);
+		}
+
+		TEST_F(BrightnessBridgeTest, CloseCompletesQueuedAndLaterWrites)
+		{
+			const std::int64_t queued_id = bridge_->SetApplicationScreenBrightnessAsync(0.9, Record());
+			bridge_->Close();
+			const std::int64_t later_id = bridge_->SetApplicationScreenBrightnessAsync(0.1, Record());
+			bridge_->RunPendingTasks();
+
+			ASSERT_EQ(completions_.size(), 2u);
+			EXPECT_EQ(completions_[0], std::make_pair(queued_id, MonitorStatus::kPreempted));
+			EXPECT_EQ(completions_[1], std::make_pair(later_id, MonitorStatus::kPreempted));
+			EXPECT_EQ(backend_->set_count(), 0);
+		}
+
+		TEST_F(BrightnessBridgeTest, OutlivesTheClientOnceClosed)
+		{
+			BrightnessBridge::Install(bridge_);
+			bridge_->Close();
+			client_.reset();
+			const int wake_count = wake_count_;
+
+			// as the C ABI may still call it, without waking the platform thread
+			(void)bridge_->SetApplicationScreenBrightnessAsync(0.9, Record());
+			EXPECT_FALSE(bridge_->Cancel(1234));
+			PublishedDisplayState state;
+			EXPECT_TRUE(bridge_->display_state_table().Read(display_, state));
+			EXPECT_EQ(wake_count_, wake_count);
+			ASSERT_EQ(completions_.size(), 1u);
+			EXPECT_EQ(completions_[0].second, MonitorStatus::kPreempted);
+		}
+	
+		TEST_F(BrightnessBridgeTest, CancelsQueuedWritesAndTimesOutLateOnes)
+		{
+			const std::int64_t cancelled_id = bridge_->SetApplicationScreenBrightnessAsync(0.9, Record());
+			EXPECT_TRUE(bridge_->Cancel(cancelled_id));
+			ASSERT_EQ(completions_.size(), 1u);
+			EXPECT_EQ(completions_[0], std::make_pair(cancelled_id, MonitorStatus::kCancelled));
+			EXPECT_FALSE(bridge_->Cancel(cancelled_id));
+
+			// the platform thread only gets to the write after its deadline
+			const std::int64_t late_id = bridge_->SetApplicationScreenBrightnessAsync(0.1, std::chrono::steady_clock::now() - std::chrono::milliseconds(1), Record());
+			bridge_->RunPendingTasks();
+			ASSERT_EQ(completions_.size(), 2u);
+			EXPECT_EQ(completions_[1], std::make_pair(late_id, MonitorStatus::kTimedOut));
+			EXPECT_EQ(backend_->set_count(), 0);
+			EXPECT_DOUBLE_EQ(bridge_->cached_brightness(), 0.4);
+			EXPECT_FALSE(bridge_->Cancel(late_id));
+		}
+	}
+}
@@ -0,0 +1,230 @@
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <memory>
+#include <vector>
+
+#include "screen_brightness_windows/brightness_service.h"
+#include "screen_brightness_windows/fake_monitor_backend.h"
+
+namespace screen_brightness
+{
+	namespace test
+	{
+		// One client alone on a service, as sbctl and a single engine use it.
+		class BrightnessClientTest : public ::testing::Test
+		{
+		protected:
+			FakeMonitorBackend* backend_ = nullptr;
+
+			std::shared_ptr<BrightnessService> service_ = CreateService(backend_);
+
+			DisplayHandle display_ = backend_->AddDisplay({ "fake", 0, 40, 100 });
+
+			BrightnessClient client_{ service_ };
+
+			std::vector<double> system_changes_;
+
+			std::vector<double> application_changes_;
+
+			// A service of its own with a fake backend, which the service owns.
+			static std::shared_ptr<BrightnessService> CreateService(FakeMonitorBackend*& backend)
+			{
+				auto owned_backend = std::make_unique<FakeMonitorBackend>();
+				backend = owned_backend.get();
+				return std::make_shared<BrightnessService>(std::move(owned_backend), Clock::Steady(), std::chrono::milliseconds(0), false);
+			}
+
+			void SetUp() override
+			{
+				client_.SetDisplay(display_);
+				client_.Initialize();
+				client_.SetSystemScreenBrightnessChangedCallback([this](double brightness) { system_changes_.push_back(brightness); });
+				client_.SetApplicationScreenBrightnessChangedCallback([this](double brightness) { application_changes_.push_back(brightness); });
+			}
+		};
+
+		TEST_F(BrightnessClientTest, InitializeReadsSystemBrightness)
+		{
+			EXPECT_TRUE(client_.HasSystemScreenBrightness());
+			EXPECT_DOUBLE_EQ(client_.GetSystemScreenBrightness(), 0.4);
+			EXPECT_FALSE(client_.HasApplicationScreenBrightnessChanged());
+		}
+
+		TEST_F(BrightnessClientTest, InitializeFailureLeavesSystemBrightnessUnknown)
+		{
+			FakeMonitorBackend* backend = nullptr;
+			BrightnessClient client(CreateService(backend));
+			const DisplayHandle display = backend->AddDisplay({ "failing", 0, 40, 100 });
+			backend->GetDisplay(display).is_failing = true;
+			client.SetDisplay(display);
+			client.Initialize();
+
+			EXPECT_FALSE(client.HasSystemScreenBrightness());
+		}
+
+		TEST_F(BrightnessClientTest, SetApplicationBrightnessWritesDisplay)
+		{
+			ASSERT_EQ(client_.SetApplicationScreenBrightness(0.75), MonitorStatus::kOk);
+
+			EXPECT_EQ(backend_->GetDisplay(display_).brightness, 75);
+			EXPECT_TRUE(client_.HasApplicationScreenBrightnessChanged());
+			double brightness = 0;
+			ASSERT_EQ(client_.GetApplicationScreenBrightness(brightness), MonitorStatus::kOk);
+			EXPECT_DOUBLE_EQ(brightness, 0.75);
+			EXPECT_EQ(application_changes_, std::vector<double>{ 0.75 });
+			EXPECT_TRUE(system_changes_.empty());
+		}
+
+		TEST_F(BrightnessClientTest, SetSystemBrightnessWithoutOverrideWritesDisplay)
+		{
+			ASSERT_EQ(client_.SetSystemScreenBrightness(0.2), MonitorStatus::kOk);
+
+			EXPECT_EQ(backend_->GetDisplay(display_).brightness, 20);
+			EXPECT_EQ(system_changes_, std::vector<double>{ 0.2 });
+			EXPECT_EQ(application_changes_, std::vector<double>{ 0.2 });
+		}
+
+		TEST_F(BrightnessClientTest, SetSystemBrightnessWithOverrideKeepsApplicationBrightness)
+		{
+			ASSERT_EQ(client_.SetApplicationScreenBrightness(0.9), MonitorStatus::kOk);
+			ASSERT_EQ(client_.SetSystemScreenBrightness(0.2), MonitorStatus::kOk);
+
+			EXPECT_EQ(backend_->GetDisplay(display_).brightness, 90);
+			EXPECT_DOUBLE_EQ(client_.GetSystemScreenBrightness(), 0.2);
+		}
+
+		TEST_F(BrightnessClientTest, ResetRestoresSystemBrightness)
+		{
+			ASSERT_EQ(client_.SetApplicationScreenBrightness(0.9), MonitorStatus::kOk);
+			ASSERT_EQ(client_.ResetApplicationScreenBrightness(), MonitorStatus::kOk);
+
+			EXPECT_EQ(backend_->GetDisplay(display_).brightness, 40);
+			EXPECT_FALSE(client_.HasApplicationScreenBrightnessChanged());
+			EXPECT_EQ(application_changes_.back(), 0.4);
+		}
+
+		TEST_F(BrightnessClientTest, PauseRestoresSystemAndResumeReappliesApplication)
+		{
+			ASSERT_EQ(client_.SetApplicationScreenBrightness(0.9), MonitorStatus::kOk);
+			client_.OnApplicationPause();
+			EXPECT_EQ(backend_->GetDisplay(display_).brightness, 40);
+
+			// the user changes the brightness while the application is in background
+			backend_->GetDisplay(display_).brightness = 30;
+			client_.OnApplicationResume();
+
+			EXPECT_EQ(backend_->GetDisplay(display_).brightness, 90);
+			EXPECT_DOUBLE_EQ(client_.GetSystemScreenBrightness(), 0.3);
+			EXPECT_EQ(system_changes_.back(), 0.3);
+		}
+
+		TEST_F(BrightnessClientTest, ResumeWithoutOverrideReportsSystemBrightness)
+		{
+			backend_->GetDisplay(display_).brightness = 60;
+			client_.OnApplicationResume();
+
+			EXPECT_EQ(system_changes_, std::vector<double>{ 0.6 });
+			EXPECT_EQ(application_changes_, std::vector<double>{ 0.6 });
+			EXPECT_EQ(backend_->set_count(), 0);
+		}
+
+		TEST_F(BrightnessClientTest, BrightnessIsScaledToDisplayRange)
+		{
+			FakeMonitorBackend* backend = nullptr;
+			BrightnessClient client(CreateService(backend));
+			const DisplayHandle display = backend->AddDisplay({ "ranged", 20, 60, 220 });
+			client.SetDisplay(display);
+			client.Initialize();
+
+			EXPECT_DOUBLE_EQ(client.GetSystemScreenBrightness(), 0.2);
+			ASSERT_EQ(client.SetApplicationScreenBrightness(0.5), MonitorStatus::kOk);
+			EXPECT_EQ(backend->GetDisplay(display).brightness, 120);
+		}
+
+		TEST_F(BrightnessClientTest, BackendFailureIsReported)
+		{
+			backend_->GetDisplay(display_).is_failing = true;
+
+			EXPECT_EQ(client_.SetApplicationScreenBrightness(0.5), MonitorStatus::kSetBrightnessFailed);
+			EXPECT_FALSE(client_.HasApplicationScreenBrightnessChanged());
+			double brightness = -1;
+			EXPECT_EQ(client_.GetApplicationScreenBrightness(brightness), MonitorStatus::kGetBrightnessFailed);
+			EXPECT_EQ(brightness, -1);
+			client_.OnApplicationPause();
+			client_.OnApplicationResume();
+			EXPECT_TRUE(application_changes_.empty());
+		}
+
+		TEST_F(BrightnessClientTest, RemovedDisplayIsReported)
+		{
+			backend_->RemoveDisplay(display_);
+
+			EXPECT_EQ(client_.SetApplicationScreenBrightness(0.5), MonitorStatus::kNoMonitors);
+			double brightness = -1;
+			EXPECT_EQ(client_.GetApplicationScreenBrightness(brightness), MonitorStatus::kNoMonitors);
+		}
+
+		TEST_F(BrightnessClientTest, MigrateToSameDisplayDoesNothing)
+		{
+			ASSERT_EQ(client_.MigrateDisplay(display_), MonitorStatus::kOk);
+
+			EXPECT_EQ(backend_->get_count(), 1);
+			EXPECT_EQ(backend_->set_count(), 0);
+			EXPECT_TRUE(system_changes_.empty());
+		}
+
+		TEST_F(BrightnessClientTest, MigrateMovesApplicationBrightnessToNewDisplay)
+		{
+			const DisplayHandle other_display = backend_->AddDisplay({ "other", 0, 30, 200 });
+			ASSERT_EQ(client_.SetApplicationScreenBrightness(0.9), MonitorStatus::kOk);
+
+			ASSERT_EQ(client_.MigrateDisplay(other_display), MonitorStatus::kOk);
+
+			EXPECT_EQ(client_.display(), other_display);
+			EXPECT_EQ(backend_->GetDisplay(display_).brightness, 40);
+			EXPECT_EQ(backend_->GetDisplay(other_display).brightness, 180);
+			EXPECT_DOUBLE_EQ(client_.GetSystemScreenBrightness(), 0.15);
+			EXPECT_EQ(system_changes_, std::vector<double>{ 0.15 });
+
+			ASSERT_EQ(client_.ResetApplicationScreenBrightness(), MonitorStatus::kOk);
+			EXPECT_EQ(backend_->GetDisplay(other_display).brightness, 30);
+		}
+
+		TEST_F(BrightnessClientTest, MigrateWithoutOverrideOnlyReadsNewDisplay)
+		{
+			const DisplayHandle other_display = backend_->AddDisplay({ "other", 0, 70, 100 });
+
+			ASSERT_EQ(client_.MigrateDisplay(other_display), MonitorStatus::kOk);
+
+			EXPECT_EQ(backend_->set_count(), 0);
+			EXPECT_EQ(system_changes_, std::vector<double>{ 0.7 });
+			EXPECT_EQ(application_changes_, std::vector<double>{ 0.7 });
+		}
+
+		TEST_F(BrightnessClientTest, MigrateWhilePausedKeepsNewDisplayUntilResume)
+		{
+			const DisplayHandle other_display = backend_->AddDisplay({ "other", 0, 70, 100 });
+			ASSERT_EQ(client_.SetApplicationScreenBrightness(0.9), MonitorStatus::kOk);
+			client_.OnApplicationPause();
+
+			ASSERT_EQ(client_.MigrateDisplay(other_display), MonitorStatus::kOk);
+			EXPECT_EQ(backend_->GetDisplay(other_display).brightness, 70);
+
+			client_.OnApplicationResume();
+			EXPECT_EQ(backend_->GetDisplay(other_display).brightness, 90);
+			EXPECT_EQ(backend_->GetDisplay(display_).brightness, 40);
+		}
+
+		TEST_F(BrightnessClientTest, MigrateAwayFromRemovedDisplay)
+		{
+			const DisplayHandle other_display = backend_->AddDisplay({ "other", 0, 70, 100 });
+			ASSERT_EQ(client_.SetApplicationScreenBrightness(0.9), MonitorStatus::kOk);
+			backend_->RemoveDisplay(display_);
+
+			ASSERT_EQ(client_.MigrateDisplay(other_display), MonitorStatus::kOk);
+
+			EXPECT_EQ(backend_->GetDisplay(other_display).brightness, 90);
+		}
+	}
+}
@@ -0,0 +1,457 @@
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <condition_variable>
+#include <future>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <thread>
+#include <vector>
+
+#include "screen_brightness_windows/brightness_service.h"
+#include "screen_brightness_windows/fake_monitor_backend.h"
+
+namespace screen_brightness
+{
+	namespace test
+	{
+		// What one engine's plugin registers: a client and the events its stream handlers would send.
+		struct FakeEngine
+		{
+			BrightnessClient client;
+
+			std::vector<double> system_changes;
+
+			std::vector<double> application_changes;
+
+			std::vector<DisplayTopologyDelta> topology_changes;
+
+			FakeEngine(std::shared_ptr<BrightnessService> service, const DisplayHandle display) : client(std::move(service))
+			{
+				client.SetDisplay(display);
+				client.Initialize();
+				client.SetSystemScreenBrightnessChangedCallback([this](double brightness) { system_changes.push_back(brightness); });
+				client.SetApplicationScreenBrightnessChangedCallback([this](double brightness) { application_changes.push_back(brightness); });
+				client.SetDisplayTopologyChangedCallback([this](const DisplayTopologyDelta& delta) { topology_changes.push_back(delta); });
+			}
+		};
+
+		class BrightnessServiceTest : public ::testing::Test
+		{
+		protected:
+			FakeMonitorBackend* backend_ = nullptr;
+
+			int created_count_ = 0;
+
+			DisplayHandle first_display_ = 0;
+
+			DisplayHandle second_display_ = 0;
+
+			std::shared_ptr<BrightnessService> Acquire()
+			{
+				return BrightnessService::Acquire([this]
+					{
+						auto backend = std::make_unique<FakeMonitorBackend>();
+						backend_ = backend.get();
+						first_display_ = backend->AddDisplay({ "first", 0, 40, 100 });
+						second_display_ = backend->AddDisplay({ "second", 0, 60, 200 });
+						++created_count_;
+						return std::make_unique<BrightnessService>(std::move(backend), Clock::Steady(), std::chrono::milliseconds(0), false);
+					});
+			}
+
+			std::unique_ptr<FakeEngine> StartEngine()
+			{
+				std::shared_ptr<BrightnessService> service = Acquire();
+				return std::make_unique<FakeEngine>(std::move(service), first_display_);
+			}
+
+			long brightness(const DisplayHandle display) const
+			{
+				return backend_->GetDisplay(display).brightness;
+			}
+		};
+
+		TEST_F(BrightnessServiceTest, EnginesShareOneService)
+		{
+			auto first = StartEngine();
+			auto second = StartEngine();
+
+			EXPECT_EQ(created_count_, 1);
+			EXPECT_EQ(&first->client.service(), &second->client.service());
+			EXPECT_EQ(first->client.service().client_count(), 2u);
+
+			// the service goes with its last client
+			first.reset();
+			second.reset();
+			auto third = StartEngine();
+			EXPECT_EQ(created_count_, 2);
+		}
+
+		TEST_F(BrightnessServiceTest, LaterEngineKeepsSystemBrightness)
+		{
+			auto first = StartEngine();
+			ASSERT_EQ(first->client.SetApplicationScreenBrightness(0.9), MonitorStatus::kOk);
+			const long get_count = backend_->get_count();
+
+			auto second = StartEngine();
+
+			// not the first engine's override
+			EXPECT_DOUBLE_EQ(second->client.GetSystemScreenBrightness(), 0.4);
+			EXPECT_EQ(backend_->get_count(), get_count);
+		}
+
+		TEST_F(BrightnessServiceTest, PausingHiddenEngineKeepsShownOverride)
+		{
+			auto first = StartEngine();
+			auto second = StartEngine();
+			ASSERT_EQ(first->client.SetApplicationScreenBrightness(0.7), MonitorStatus::kOk);
+			ASSERT_EQ(second->client.SetApplicationScreenBrightness(0.9), MonitorStatus::kOk);
+			const long set_count = backend_->set_count();
+
+			first->client.OnApplicationPause();
+
+			EXPECT_EQ(brightness(first_display_), 90);
+			EXPECT_EQ(backend_->set_count(), set_count);
+		}
+
+		TEST_F(BrightnessServiceTest, PausingShownEngineRevealsNextOverride)
+		{
+			auto first = StartEngine();
+			auto second = StartEngine();
+			ASSERT_EQ(first->client.SetApplicationScreenBrightness(0.7), MonitorStatus::kOk);
+			ASSERT_EQ(second->client.SetApplicationScreenBrightness(0.9), MonitorStatus::kOk);
+
+			second->client.OnApplicationPause();
+			EXPECT_EQ(brightness(first_display_), 70);
+
+			first->client.OnApplicationPause();
+			EXPECT_EQ(brightness(first_display_), 40);
+
+			// the resumed engine is shown again, the other one keeps its override for later
+			second->client.OnApplicationResume();
+			EXPECT_EQ(brightness(first_display_), 90);
+			EXPECT_TRUE(first->client.HasApplicationScreenBrightnessChanged());
+		}
+
+		TEST_F(BrightnessServiceTest, ResetRevealsNextOverride)
+		{
+			auto first = StartEngine();
+			auto second = StartEngine();
+			ASSERT_EQ(first->client.SetApplicationScreenBrightness(0.7), MonitorStatus::kOk);
+			ASSERT_EQ(second->client.SetApplicationScreenBrightness(0.9), MonitorStatus::kOk);
+
+			ASSERT_EQ(second->client.ResetApplicationScreenBrightness(), MonitorStatus::kOk);
+
+			EXPECT_EQ(brightness(first_display_), 70);
+			EXPECT_EQ(second->application_changes.back(), 0.4);
+		}
+
+		TEST_F(BrightnessServiceTest, ClosingEngineDropsItsOverride)
+		{
+			auto first = StartEngine();
+			auto second = StartEngine();
+			ASSERT_EQ(second->client.SetApplicationScreenBrightness(0.9), MonitorStatus::kOk);
+
+			second.reset();
+
+			EXPECT_EQ(brightness(first_display_), 40);
+			EXPECT_EQ(first->client.service().client_count(), 1u);
+		}
+
+		TEST_F(BrightnessServiceTest, SystemBrightnessIsBroadcastToEnginesOnDisplay)
+		{
+			auto first = StartEngine();
+			auto second = StartEngine();
+			auto other = StartEngine();
+			ASSERT_EQ(other->client.MigrateDisplay(second_display_), MonitorStatus::kOk);
+			other->system_changes.clear();
+			other->application_changes.clear();
+			ASSERT_EQ(first->client.SetApplicationScreenBrightness(0.9), MonitorStatus::kOk);
+			first->application_changes.clear();
+
+			ASSERT_EQ(second->client.SetSystemScreenBrightness(0.2), MonitorStatus::kOk);
+
+			EXPECT_EQ(first->system_changes, std::vector<double>{ 0.2 });
+			EXPECT_EQ(second->system_changes, std::vector<double>{ 0.2 });
+			EXPECT_TRUE(other->system_changes.empty());
+			// the first engine still shows its override
+			EXPECT_TRUE(first->application_changes.empty());
+			EXPECT_EQ(second->application_changes, std::vector<double>{ 0.2 });
+			EXPECT_EQ(brightness(first_display_), 90);
+
+			first->client.OnApplicationPause();
+			EXPECT_EQ(brightness(first_display_), 20);
+		}
+
+		TEST_F(BrightnessServiceTest, MigrationCarriesOverrideAndRestoresPreviousDisplay)
+		{
+			auto first = StartEngine();
+			auto second = StartEngine();
+			ASSERT_EQ(first->client.SetApplicationScreenBrightness(0.7), MonitorStatus::kOk);
+			ASSERT_EQ(second->client.SetApplicationScreenBrightness(0.5), MonitorStatus::kOk);
+
+			ASSERT_EQ(second->client.MigrateDisplay(second_display_), MonitorStatus::kOk);
+
+			EXPECT_EQ(brightness(first_display_), 70);
+			EXPECT_EQ(brightness(second_display_), 100);
+			EXPECT_DOUBLE_EQ(second->client.GetSystemScreenBrightness(), 0.3);
+		}
+
+		TEST_F(BrightnessServiceTest, TopologyChangeIsBroadcastOnce)
+		{
+			auto first = StartEngine();
+			auto second = StartEngine();
+			backend_->AddDisplay({ "third", 0, 50, 100 });
+
+			// every engine's window sees the change
+			ASSERT_EQ(first->client.service().UpdateDisplayTopology(), MonitorStatus::kOk);
+			ASSERT_EQ(second->client.service().UpdateDisplayTopology(), MonitorStatus::kOk);
+
+			ASSERT_EQ(first->topology_changes.size(), 1u);
+			ASSERT_EQ(second->topology_changes.size(), 1u);
+			ASSERT_EQ(second->topology_changes[0].added.size(), 1u);
+			EXPECT_EQ(second->topology_changes[0].added[0].id, "third");
+		}
+
+		TEST_F(BrightnessServiceTest, RemovedDisplayIsForgotten)
+		{
+			auto first = StartEngine();
+			ASSERT_EQ(first->client.MigrateDisplay(second_display_), MonitorStatus::kOk);
+			const long get_count = backend_->get_count();
+
+			backend_->RemoveDisplay(second_display_);
+			ASSERT_EQ(first->client.service().UpdateDisplayTopology(), MonitorStatus::kOk);
+
+			EXPECT_FALSE(first->client.HasSystemScreenBrightness());
+			ASSERT_EQ(first->topology_changes.size(), 1u);
+			EXPECT_EQ(first->topology_changes[0].removed.size(), 1u);
+			EXPECT_EQ(backend_->get_count(), get_count);
+		}
+
+		TEST_F(BrightnessServiceTest, DisplayWithANewHandleKeepsItsState)
+		{
+			auto first = StartEngine();
+			auto second = StartEngine();
+			ASSERT_EQ(first->client.SetApplicationScreenBrightness(0.7), MonitorStatus::kOk);
+			const long get_count = backend_->get_count();
+
+			// the monitor comes back with another handle after a mode change, showing the override still
+			backend_->RemoveDisplay(first_display_);
+			const DisplayHandle display = backend_->AddDisplay({ "first", 0, 70, 100 });
+			ASSERT_EQ(first->client.service().UpdateDisplayTopology(), MonitorStatus::kOk);
+
+			EXPECT_TRUE(first->topology_changes.empty());
+			EXPECT_EQ(first->client.display(), display);
+			EXPECT_EQ(second->client.display(), display);
+			EXPECT_TRUE(first->client.HasApplicationScreenBrightnessChanged());
+			EXPECT_DOUBLE_EQ(second->client.GetSystemScreenBrightness(), 0.4);
+			EXPECT_EQ(backend_->get_count(), get_count);
+
+			// the system brightness comes back on the new handle
+			first->client.OnApplicationPause();
+			EXPECT_EQ(brightness(display), 40);
+		}
+	
+		// A fake whose monitors take a while to write, or hang until released, as DDC/CI monitors do.
+		class HangingMonitorBackend final : public MonitorBackend
+		{
+		public:
+			FakeMonitorBackend fake;
+
+			std::map<DisplayHandle, std::chrono::milliseconds> write_delays;
+
+			std::set<DisplayHandle> hung_displays;
+
+			// set once the service has let go of the backend
+			std::shared_ptr<std::promise<void>> destroyed;
+
+			~HangingMonitorBackend() override
+			{
+				if (destroyed != nullptr)
+				{
+					destroyed->set_value();
+				}
+			}
+
+			void Release()
+			{
+				std::lock_guard<std::mutex> lock(mutex_);
+				is_released_ = true;
+				condition_.notify_all();
+			}
+
+			long brightness(const DisplayHandle display)
+			{
+				std::lock_guard<std::mutex> lock(mutex_);
+				return fake.GetDisplay(display).brightness;
+			}
+
+			MonitorStatus EnumerateDisplays(std::vector<DisplayInfo>& displays) override
+			{
+				std::lock_guard<std::mutex> lock(mutex_);
+				return fake.EnumerateDisplays(displays);
+			}
+
+			DisplayHandle GetPrimaryDisplay() override
+			{
+				std::lock_guard<std::mutex> lock(mutex_);
+				return fake.GetPrimaryDisplay();
+			}
+
+			MonitorStatus GetScreenBrightness(const DisplayHandle display, long& minimum_screen_brightness, long& screen_brightness, long& maximum_screen_brightness) override
+			{
+				std::lock_guard<std::mutex> lock(mutex_);
+				return fake.GetScreenBrightness(display, minimum_screen_brightness, screen_brightness, maximum_screen_brightness);
+			}
+
+			MonitorStatus SetScreenBrightness(const DisplayHandle display, const long screen_brightness) override
+			{
+				std::unique_lock<std::mutex> lock(mutex_);
+				if (const auto delay = write_delays.find(display); delay != write_delays.end())
+				{
+					lock.unlock();
+					std::this_thread::sleep_for(delay->second);
+					lock.lock();
+				}
+
+				if (hung_displays.count(display) != 0)
+				{
+					condition_.wait(lock, [this] { return is_released_; });
+				}
+
+				return fake.SetScreenBrightness(display, screen_brightness);
+			}
+
+			MonitorStatus GetVcpFeature(DisplayHandle, VcpCode, unsigned long&, unsigned long&) override
+			{
+				return MonitorStatus::kUnsupported;
+			}
+
+			MonitorStatus SetVcpFeature(DisplayHandle, VcpCode, unsigned long) override
+			{
+				return MonitorStatus::kUnsupported;
+			}
+
+			MonitorStatus GetCapabilitiesString(DisplayHandle, std::string&) override
+			{
+				return MonitorStatus::kUnsupported;
+			}
+
+			MonitorStatus GetEdid(DisplayHandle, std::vector<std::uint8_t>&) override
+			{
+				return MonitorStatus::kUnsupported;
+			}
+
+		private:
+			std::mutex mutex_;
+
+			std::condition_variable condition_;
+
+			bool is_released_ = false;
+		};
+
+		class BrightnessServiceCloseTest : public ::testing::Test
+		{
+		protected:
+			using SteadyClock = std::chrono::steady_clock;
+
+			HangingMonitorBackend* backend_ = nullptr;
+
+			DisplayHandle first_display_ = 0;
+
+			DisplayHandle second_display_ = 0;
+
+			std::weak_ptr<BrightnessService> service_;
+
+			std::shared_ptr<std::promise<void>> backend_destroyed_ = std::make_shared<std::promise<void>>();
+
+			// An engine which has overridden both displays, the first one's restore lost to a failing write.
+			std::unique_ptr<FakeEngine> StartEngine()
+			{
+				std::shared_ptr<BrightnessService> service = BrightnessService::Acquire([this]
+					{
+						auto backend = std::make_unique<HangingMonitorBackend>();
+						backend_ = backend.get();
+						backend->destroyed = backend_destroyed_;
+						first_display_ = backend->fake.AddDisplay({ "first", 0, 40, 100 });
+						second_display_ = backend->fake.AddDisplay({ "second", 0, 60, 100 });
+						return std::make_unique<BrightnessService>(std::move(backend), Clock::Steady(), std::chrono::milliseconds(0), true);
+					});
+				service_ = service;
+				auto engine = std::make_unique<FakeEngine>(std::move(service), first_display_);
+				EXPECT_EQ(engine->client.SetApplicationScreenBrightness(0.9), MonitorStatus::kOk);
+				backend_->fake.GetDisplay(first_display_).is_failing = true;
+				EXPECT_EQ(engine->client.MigrateDisplay(second_display_), MonitorStatus::kOk);
+				backend_->fake.GetDisplay(first_display_).is_failing = false;
+				EXPECT_EQ(backend_->brightness(first_display_), 90);
+				EXPECT_EQ(backend_->brightness(second_display_), 90);
+				return engine;
+			}
+		};
+
+		TEST_F(BrightnessServiceCloseTest, RestoresTouchedDisplaysInParallel)
+		{
+			auto engine = StartEngine();
+			backend_->write_delays[first_display_] = std::chrono::milliseconds(150);
+			backend_->write_delays[second_display_] = std::chrono::milliseconds(150);
+
+			const auto start = SteadyClock::now();
+			const std::vector<DisplayRestoreResult> results = engine->client.OnApplicationClose(std::chrono::seconds(5));
+			const auto elapsed = SteadyClock::now() - start;
+
+			ASSERT_EQ(results.size(), 2u);
+			for (const DisplayRestoreResult& result : results)
+			{
+				EXPECT_TRUE(result.is_completed);
+				EXPECT_EQ(result.status, MonitorStatus::kOk);
+			}
+
+			EXPECT_LT(elapsed, std::chrono::milliseconds(290));
+			EXPECT_EQ(backend_->brightness(first_display_), 40);
+			EXPECT_EQ(backend_->brightness(second_display_), 60);
+
+			// nothing is left to restore, and a cancelled close gives the override back
+			EXPECT_TRUE(engine->client.OnApplicationClose(std::chrono::seconds(5)).empty());
+			engine->client.OnApplicationResume();
+			EXPECT_EQ(backend_->brightness(second_display_), 90);
+			EXPECT_EQ(engine->client.OnApplicationClose(std::chrono::seconds(5)).size(), 1u);
+		}
+
+		TEST_F(BrightnessServiceCloseTest, HungDisplayDoesNotHoldUpClose)
+		{
+			auto engine = StartEngine();
+			backend_->write_delays[first_display_] = std::chrono::milliseconds(20);
+			backend_->hung_displays.insert(second_display_);
+
+			const auto start = SteadyClock::now();
+			const std::vector<DisplayRestoreResult> results = engine->client.OnApplicationClose(std::chrono::milliseconds(200));
+			const auto elapsed = SteadyClock::now() - start;
+
+			ASSERT_EQ(results.size(), 2u);
+			EXPECT_EQ(results[0].display, first_display_);
+			EXPECT_TRUE(results[0].is_completed);
+			EXPECT_EQ(results[0].status, MonitorStatus::kOk);
+			EXPECT_EQ(results[1].display, second_display_);
+			EXPECT_FALSE(results[1].is_completed);
+			EXPECT_EQ(results[1].status, MonitorStatus::kTimedOut);
+			EXPECT_GE(elapsed, std::chrono::milliseconds(200));
+			EXPECT_LT(elapsed, std::chrono::milliseconds(400));
+			EXPECT_TRUE(engine->client.OnApplicationClose(std::chrono::milliseconds(200)).empty());
+
+			// releasing the service waits for the hung write, which still lands once the monitor answers
+			HangingMonitorBackend* backend = backend_;
+			std::thread monitor([backend]
+				{
+					std::this_thread::sleep_for(std::chrono::milliseconds(50));
+					backend->Release();
+				});
+			engine.reset();
+			EXPECT_TRUE(service_.expired());
+			EXPECT_EQ(backend_destroyed_->get_future().wait_for(std::chrono::seconds(0)), std::future_status::ready);
+			monitor.join();
+		}
+	}
+}
@@ -0,0 +1,298 @@
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include "screen_brightness_windows/broker_monitor_backend.h"
+#include "screen_brightness_windows/broker_server.h"
+#include "screen_brightness_windows/fake_monitor_backend.h"
+
+namespace screen_brightness
+{
+	namespace test
+	{
+		// Waits for something another thread or process does.
+		bool WaitUntil(const std::function<bool()>& predicate)
+		{
+			for (int attempt = 0; attempt < 1000; ++attempt)
+			{
+				if (predicate())
+				{
+					return true;
+				}
+
+				std::this_thread::sleep_for(std::chrono::milliseconds(5));
+			}
+
+			return predicate();
+		}
+
+		// Statuses of pipelined calls, which complete on the reader thread.
+		class CompletionLog
+		{
+		public:
+			void Add(const MonitorStatus status, const long brightness = 0)
+			{
+				std::lock_guard<std::mutex> lock(mutex_);
+				statuses_.push_back(status);
+				brightnesses_.push_back(brightness);
+			}
+
+			[[nodiscard]] bool WaitForCount(const size_t count)
+			{
+				return WaitUntil([this, count]
+					{
+						std::lock_guard<std::mutex> lock(mutex_);
+						return statuses_.size() >= count;
+					});
+			}
+
+			[[nodiscard]] size_t Count(const MonitorStatus status)
+			{
+				std::lock_guard<std::mutex> lock(mutex_);
+				return static_cast<size_t>(std::count(statuses_.begin(), statuses_.end(), status));
+			}
+
+			[[nodiscard]] std::vector<long> brightnesses()
+			{
+				std::lock_guard<std::mutex> lock(mutex_);
+				return brightnesses_;
+			}
+
+		private:
+			std::mutex mutex_;
+
+			std::vector<MonitorStatus> statuses_;
+
+			std::vector<long> brightnesses_;
+		};
+
+		class BrokerTest : public ::testing::Test
+		{
+		protected:
+			const std::string path_ = "/tmp/screen_brightness_broker_test_" + std::to_string(getpid()) + ".sock";
+
+			FakeMonitorBackend backend_;
+
+			DisplayHandle first_display_ = 0;
+
+			DisplayHandle second_display_ = 0;
+
+			ManualClock clock_;
+
+			std::unique_ptr<BrokerServer> server_;
+
+			void SetUp() override
+			{
+				FakeMonitorBackend::Display first{ "first", 0, 40, 100 };
+				first.vcp_features[kVcpContrast] = { 50, 100 };
+				first.capabilities = "(vcp(10 12))";
+				first.edid = { 0x00, 0xff, 0xff, 0xff };
+				first_display_ = backend_.AddDisplay(first);
+				second_display_ = backend_.AddDisplay({ "second", 0, 60, 200 });
+				server_ = std::make_unique<BrokerServer>(backend_, clock_, std::chrono::milliseconds(0), false);
+				ASSERT_EQ(server_->Listen(path_), MonitorStatus::kOk);
+			}
+
+			void TearDown() override
+			{
+				server_.reset();
+			}
+
+			std::unique_ptr<MonitorBackend> CreateFallback() const
+			{
+				auto fallback = std::make_unique<FakeMonitorBackend>();
+				fallback->AddDisplay({ "first", 0, 55, 100 });
+				return fallback;
+			}
+
+			// Lets the broker accept a connection it has not seen yet.
+			void AcceptClient(BrokerMonitorBackend& client)
+			{
+				ASSERT_EQ(client.Connect(), MonitorStatus::kOk);
+				server_->RunOnce(std::chrono::seconds(1));
+			}
+		};
+
+		TEST_F(BrokerTest, ForwardsEveryOperation)
+		{
+			server_->Start();
+			BrokerMonitorBackend client(path_, clock_);
+
+			std::vector<DisplayInfo> displays;
+			ASSERT_EQ(client.EnumerateDisplays(displays), MonitorStatus::kOk);
+			ASSERT_EQ(displays.size(), 2u);
+			EXPECT_EQ(displays[1].handle, second_display_);
+			EXPECT_EQ(displays[1].id, "second");
+			EXPECT_EQ(client.GetPrimaryDisplay(), first_display_);
+
+			long minimum = 0, brightness = 0, maximum = 0;
+			ASSERT_EQ(client.GetScreenBrightness(second_display_, minimum, brightness, maximum), MonitorStatus::kOk);
+			EXPECT_EQ(brightness, 60);
+			EXPECT_EQ(maximum, 200);
+			ASSERT_EQ(client.SetScreenBrightness(first_display_, 70), MonitorStatus::kOk);
+			EXPECT_EQ(backend_.GetDisplay(first_display_).brightness, 70);
+
+			unsigned long current_value = 0, maximum_value = 0;
+			ASSERT_EQ(client.SetVcpFeature(first_display_, kVcpContrast, 80), MonitorStatus::kOk);
+			ASSERT_EQ(client.GetVcpFeature(first_display_, kVcpContrast, current_value, maximum_value), MonitorStatus::kOk);
+			EXPECT_EQ(current_value, 80u);
+			EXPECT_EQ(maximum_value, 100u);
+
+			std::string capabilities;
+			ASSERT_EQ(client.GetCapabilitiesString(first_display_, capabilities), MonitorStatus::kOk);
+			EXPECT_EQ(capabilities, "(vcp(10 12))");
+			std::vector<std::uint8_t> edid;
+			ASSERT_EQ(client.GetEdid(first_display_, edid), MonitorStatus::kOk);
+			EXPECT_EQ(edid, backend_.GetDisplay(first_display_).edid);
+
+			// a made up handle gets no scheduler
+			EXPECT_EQ(client.GetScreenBrightness(1234, minimum, brightness, maximum), MonitorStatus::kGetBrightnessFailed);
+			EXPECT_FALSE(client.is_using_fallback());
+		}
+
+		TEST_F(BrokerTest, CoalescesPipelinedWrites)
+		{
+			BrokerMonitorBackend client(path_, clock_);
+			AcceptClient(client);
+			CompletionLog log;
+			for (long brightness = 10; brightness <= 100; brightness += 10)
+			{
+				client.SetScreenBrightnessAsync(first_display_, brightness, [&log](const MonitorStatus status) { log.Add(status); });
+			}
+
+			// every write is queued before the bus runs, so only the last one reaches it
+			server_->RunOnce(std::chrono::seconds(1));
+
+			ASSERT_TRUE(log.WaitForCount(10));
+			EXPECT_EQ(log.Count(MonitorStatus::kOk), 1u);
+			EXPECT_EQ(log.Count(MonitorStatus::kPreempted), 9u);
+			EXPECT_EQ(backend_.set_count(), 1);
+			EXPECT_EQ(backend_.GetDisplay(first_display_).brightness, 100);
+			EXPECT_EQ(server_->metrics().coalesced_write_count, 9u);
+		}
+
+		TEST_F(BrokerTest, ClientsShareQueuedRead)
+		{
+			BrokerMonitorBackend first_client(path_, clock_);
+			BrokerMonitorBackend second_client(path_, clock_);
+			AcceptClient(first_client);
+			AcceptClient(second_client);
+			CompletionLog log;
+			const auto completion = [&log](const MonitorStatus status, long, const long brightness, long) { log.Add(status, brightness); };
+			first_client.GetScreenBrightnessAsync(first_display_, completion);
+			second_client.GetScreenBrightnessAsync(first_display_, completion);
+			const long get_count = backend_.get_count();
+
+			while (server_->metrics().request_count < 2)
+			{
+				server_->RunOnce(std::chrono::seconds(1));
+			}
+
+			ASSERT_TRUE(log.WaitForCount(2));
+			EXPECT_EQ(log.Count(MonitorStatus::kOk), 2u);
+			EXPECT_EQ(log.brightnesses(), (std::vector<long>{ 40, 40 }));
+			EXPECT_EQ(backend_.get_count(), get_count + 1);
+			EXPECT_EQ(server_->metrics().shared_read_count, 1u);
+		}
+
+		TEST_F(BrokerTest, NotifiesOtherSubscribers)
+		{
+			server_->Start();
+			BrokerMonitorBackend watcher(path_, clock_);
+			BrokerMonitorBackend writer(path_, clock_);
+			CompletionLog watcher_log;
+			CompletionLog writer_log;
+			ASSERT_EQ(watcher.SetBrightnessChangedCallback([&](const DisplayHandle display, const long brightness)
+				{
+					watcher_log.Add(display == first_display_ ? MonitorStatus::kOk : MonitorStatus::kNoMonitors, brightness);
+				}), MonitorStatus::kOk);
+			ASSERT_EQ(writer.SetBrightnessChangedCallback([&](DisplayHandle, const long brightness) { writer_log.Add(MonitorStatus::kOk, brightness); }),
+				MonitorStatus::kOk);
+
+			ASSERT_EQ(writer.SetScreenBrightness(first_display_, 80), MonitorStatus::kOk);
+
+			ASSERT_TRUE(watcher_log.WaitForCount(1));
+			EXPECT_EQ(watcher_log.Count(MonitorStatus::kOk), 1u);
+			EXPECT_EQ(watcher_log.brightnesses(), std::vector<long>{ 80 });
+			// the writer knows its own write
+			EXPECT_TRUE(writer_log.brightnesses().empty());
+		}
+
+		TEST_F(BrokerTest, FallsBackWithoutBroker)
+		{
+			server_.reset();
+			BrokerMonitorBackend client(path_, clock_, [this] { return CreateFallback(); });
+			BrokerMonitorBackend client_without_fallback(path_, clock_);
+
+			long minimum = 0, brightness = 0, maximum = 0;
+			ASSERT_EQ(client.GetScreenBrightness(1, minimum, brightness, maximum), MonitorStatus::kOk);
+			EXPECT_EQ(brightness, 55);
+			EXPECT_TRUE(client.is_using_fallback());
+			EXPECT_EQ(client_without_fallback.GetScreenBrightness(1, minimum, brightness, maximum), MonitorStatus::kBrokerFailed);
+
+			CompletionLog log;
+			client.SetScreenBrightnessAsync(1, 30, [&log](const MonitorStatus status) { log.Add(status); });
+			EXPECT_EQ(log.Count(MonitorStatus::kOk), 1u);
+		}
+
+		TEST_F(BrokerTest, FallsBackWhileBrokerIsGoneAndReconnects)
+		{
+			server_->Start();
+			BrokerMonitorBackend client(path_, clock_, [this] { return CreateFallback(); });
+			long minimum = 0, brightness = 0, maximum = 0;
+			ASSERT_EQ(client.GetScreenBrightness(first_display_, minimum, brightness, maximum), MonitorStatus::kOk);
+			EXPECT_EQ(brightness, 40);
+
+			server_.reset();
+			ASSERT_TRUE(WaitUntil([&client] { return !client.is_connected(); }));
+			ASSERT_EQ(client.GetScreenBrightness(first_display_, minimum, brightness, maximum), MonitorStatus::kOk);
+			EXPECT_EQ(brightness, 55);
+
+			// the restarted broker is only tried again after the reconnect interval
+			server_ = std::make_unique<BrokerServer>(backend_, clock_, std::chrono::milliseconds(0), false);
+			ASSERT_EQ(server_->Listen(path_), MonitorStatus::kOk);
+			server_->Start();
+			ASSERT_EQ(client.GetScreenBrightness(first_display_, minimum, brightness, maximum), MonitorStatus::kOk);
+			EXPECT_EQ(brightness, 55);
+
+			clock_.Advance(BrokerMonitorBackend::kReconnectInterval);
+			ASSERT_EQ(client.GetScreenBrightness(first_display_, minimum, brightness, maximum), MonitorStatus::kOk);
+			EXPECT_EQ(brightness, 40);
+			EXPECT_TRUE(client.is_connected());
+		}
+
+		TEST_F(BrokerTest, RefusesSecondBrokerAndDropsForeignClient)
+		{
+			BrokerServer second_server(backend_, clock_, std::chrono::milliseconds(0), false);
+			EXPECT_EQ(second_server.Listen(path_), MonitorStatus::kBrokerFailed);
+
+			server_->Start();
+			const int socket = ::socket(AF_UNIX, SOCK_STREAM, 0);
+			sockaddr_un address{};
+			address.sun_family = AF_UNIX;
+			path_.copy(address.sun_path, path_.size());
+			ASSERT_EQ(connect(socket, reinterpret_cast<const sockaddr*>(&address), sizeof(address)), 0);
+
+			// a frame of the wrong size
+			BrokerFrameHeader header;
+			header.size = 5;
+			ASSERT_EQ(send(socket, &header, sizeof(header), 0), static_cast<ssize_t>(sizeof(header)));
+			char buffer[16];
+			EXPECT_EQ(recv(socket, buffer, sizeof(buffer), 0), 0);
+			close(socket);
+			EXPECT_TRUE(WaitUntil([this] { return server_->metrics().connection_count == 0; }));
+		}
+	}
+}
@@ -0,0 +1,135 @@
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <random>
+
+#include "screen_brightness_windows/ddc_latency_estimator.h"
+
+namespace screen_brightness
+{
+	namespace test
+	{
+		using std::chrono::milliseconds;
+
+		constexpr int kSampleCount = 2000;
+
+		double ToMilliseconds(const Clock::duration duration)
+		{
+			return std::chrono::duration<double, std::milli>(duration).count();
+		}
+
+		TEST(DdcLatencyEstimatorTest, ExpectsInitialLatencyWithoutSamples)
+		{
+			const DdcLatencyEstimate estimate = DdcLatencyEstimator().GetEstimate();
+
+			EXPECT_EQ(estimate.sample_count, 0u);
+			EXPECT_EQ(estimate.expected, DdcLatencyEstimator::kInitialLatency);
+		}
+
+		TEST(DdcLatencyEstimatorTest, ConvergesOnConstantLatency)
+		{
+			DdcLatencyEstimator estimator;
+			for (int index = 0; index < 100; ++index)
+			{
+				estimator.AddSample(milliseconds(40));
+			}
+
+			const DdcLatencyEstimate estimate = estimator.GetEstimate();
+			EXPECT_EQ(estimate.smoothed, milliseconds(40));
+			EXPECT_LT(estimate.deviation, milliseconds(1));
+			EXPECT_EQ(estimate.p50, milliseconds(40));
+			EXPECT_EQ(estimate.p99, milliseconds(40));
+			EXPECT_EQ(estimate.expected, milliseconds(40));
+		}
+
+		TEST(DdcLatencyEstimatorTest, ConvergesOnUniformLatency)
+		{
+			// the range monitors are seen to answer in
+			std::mt19937 random(20261019);
+			std::uniform_int_distribution<int> latency(30, 200);
+			DdcLatencyEstimator estimator;
+			for (int index = 0; index < kSampleCount; ++index)
+			{
+				estimator.AddSample(milliseconds(latency(random)));
+			}
+
+			const DdcLatencyEstimate estimate = estimator.GetEstimate();
+			EXPECT_NEAR(ToMilliseconds(estimate.smoothed), 115, 40);
+			EXPECT_NEAR(ToMilliseconds(estimate.p50), 115, 30);
+			EXPECT_NEAR(ToMilliseconds(estimate.p90), 183, 20);
+			EXPECT_GE(estimate.p99, milliseconds(180));
+			EXPECT_LE(estimate.p99, milliseconds(200));
+			EXPECT_GT(estimate.deviation, milliseconds(10));
+			EXPECT_GE(estimate.expected, estimate.p90);
+		}
+
+		TEST(DdcLatencyEstimatorTest, CoversSlowTailOfBimodalLatency)
+		{
+			// a monitor which mostly answers quickly, but every fifth command while its scaler is busy
+			std::mt19937 random(20261019);
+			std::bernoulli_distribution is_slow(0.2);
+			DdcLatencyEstimator estimator;
+			for (int index = 0; index < kSampleCount; ++index)
+			{
+				estimator.AddSample(is_slow(random) ? milliseconds(220) : milliseconds(35));
+			}
+
+			const DdcLatencyEstimate estimate = estimator.GetEstimate();
+			EXPECT_EQ(estimate.p50, milliseconds(35));
+			EXPECT_EQ(estimate.p99, milliseconds(220));
+			// the average alone would pace commands faster than the slow ones complete
+			EXPECT_LT(estimate.smoothed, milliseconds(150));
+			EXPECT_EQ(estimate.expected, milliseconds(220));
+		}
+
+		TEST(DdcLatencyEstimatorTest, FollowsStepChange)
+		{
+			DdcLatencyEstimator estimator;
+			for (int index = 0; index < 200; ++index)
+			{
+				estimator.AddSample(milliseconds(40));
+			}
+
+			// slows down, e.g. while switching input
+			for (int index = 0; index < 8; ++index)
+			{
+				estimator.AddSample(milliseconds(200));
+			}
+
+			EXPECT_EQ(estimator.GetEstimate().expected, milliseconds(200));
+
+			for (int index = 0; index < 32; ++index)
+			{
+				estimator.AddSample(milliseconds(200));
+			}
+
+			EXPECT_NEAR(ToMilliseconds(estimator.GetEstimate().smoothed), 200, 5);
+
+			// speeds up again: the average follows quickly, the percentiles once the window has turned over
+			for (int index = 0; index < 32; ++index)
+			{
+				estimator.AddSample(milliseconds(40));
+			}
+
+			EXPECT_LT(estimator.GetEstimate().smoothed, milliseconds(45));
+			EXPECT_EQ(estimator.GetEstimate().expected, milliseconds(200));
+
+			for (size_t index = 32; index < DdcLatencyEstimator::kWindowSize; ++index)
+			{
+				estimator.AddSample(milliseconds(40));
+			}
+
+			EXPECT_NEAR(ToMilliseconds(estimator.GetEstimate().expected), 40, 1);
+		}
+
+		TEST(DdcLatencyEstimatorTest, ClampsTimedOutCommands)
+		{
+			DdcLatencyEstimator estimator;
+			estimator.AddSample(std::chrono::seconds(5));
+
+			const DdcLatencyEstimate estimate = estimator.GetEstimate();
+			EXPECT_EQ(estimate.smoothed, DdcLatencyEstimator::kMaximumSample);
+			EXPECT_EQ(estimate.p99, DdcLatencyEstimator::kMaximumSample);
+		}
+	}
+}
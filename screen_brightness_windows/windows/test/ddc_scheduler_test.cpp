@@ -0,0 +1,303 @@
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "screen_brightness_windows/brightness_service.h"
+#include "screen_brightness_windows/clock.h"
+#include "screen_brightness_windows/ddc_scheduler.h"
+#include "screen_brightness_windows/fake_monitor_backend.h"
+#include "screen_brightness_windows/scheduled_monitor_backend.h"
+
+namespace screen_brightness
+{
+	namespace test
+	{
+		using std::chrono::milliseconds;
+
+		class DdcSchedulerTest : public ::testing::Test
+		{
+		protected:
+			ManualClock clock_;
+
+			DdcScheduler scheduler_{ clock_, DdcScheduler::kMccsMinimumCommandInterval };
+
+			std::vector<std::string> executed_;
+
+			std::vector<Clock::time_point> start_times_;
+
+			std::vector<MonitorStatus> completions_;
+
+			void Submit(const DdcPriority priority, const std::uint32_t coalescing_key, const std::string& name)
+			{
+				scheduler_.Submit(priority, coalescing_key, [this, name]
+					{
+						executed_.push_back(name);
+						start_times_.push_back(clock_.Now());
+						clock_.Advance(milliseconds(30));
+						return MonitorStatus::kOk;
+					}, [this](const MonitorStatus status) { completions_.push_back(status); });
+			}
+		};
+
+		TEST_F(DdcSchedulerTest, SpacesConsecutiveCommands)
+		{
+			Submit(DdcPriority::kUserWrite, kDdcNoCoalescing, "first");
+			Submit(DdcPriority::kUserWrite, kDdcNoCoalescing, "second");
+			Submit(DdcPriority::kUserWrite, kDdcNoCoalescing, "third");
+
+			scheduler_.RunUntilIdle();
+
+			ASSERT_EQ(start_times_.size(), 3u);
+			// each command takes 30 ms and must be followed by 50 ms of silence on the bus
+			EXPECT_EQ(start_times_[1] - start_times_[0], milliseconds(80));
+			EXPECT_EQ(start_times_[2] - start_times_[1], milliseconds(80));
+		}
+
+		TEST_F(DdcSchedulerTest, IdleBusDoesNotWait)
+		{
+			Submit(DdcPriority::kUserWrite, kDdcNoCoalescing, "first");
+			scheduler_.RunUntilIdle();
+			clock_.Advance(milliseconds(500));
+			const Clock::time_point submit_time = clock_.Now();
+
+			Submit(DdcPriority::kUserWrite, kDdcNoCoalescing, "second");
+			scheduler_.RunUntilIdle();
+
+			EXPECT_EQ(start_times_.back(), submit_time);
+		}
+
+		TEST_F(DdcSchedulerTest, RunsByPriorityThenSubmissionOrder)
+		{
+			Submit(DdcPriority::kBackgroundPoll, kDdcNoCoalescing, "poll");
+			Submit(DdcPriority::kAnimationStep, kDdcNoCoalescing, "step 1");
+			Submit(DdcPriority::kUserWrite, kDdcNoCoalescing, "user");
+			Submit(DdcPriority::kAnimationStep, kDdcNoCoalescing, "step 2");
+
+			scheduler_.RunUntilIdle();
+
+			EXPECT_EQ(executed_, (std::vector<std::string>{ "user", "step 1", "step 2", "poll" }));
+		}
+
+		TEST_F(DdcSchedulerTest, UserWritePreemptsQueuedAnimationSteps)
+		{
+			Submit(DdcPriority::kAnimationStep, kDdcBrightnessWrite, "step 1");
+			Submit(DdcPriority::kAnimationStep, kDdcBrightnessWrite, "step 2");
+			Submit(DdcPriority::kBackgroundPoll, kDdcBrightnessRead, "poll");
+			Submit(DdcPriority::kUserWrite, kDdcBrightnessWrite, "user");
+
+			scheduler_.RunUntilIdle();
+
+			EXPECT_EQ(executed_, (std::vector<std::string>{ "user", "poll" }));
+			EXPECT_EQ(completions_, (std::vector<MonitorStatus>{ MonitorStatus::kPreempted, MonitorStatus::kPreempted, MonitorStatus::kOk, MonitorStatus::kOk }));
+			EXPECT_EQ(scheduler_.metrics().preempted_count, 2u);
+		}
+
+		TEST_F(DdcSchedulerTest, LowerPriorityDoesNotPreemptQueuedUserWrite)
+		{
+			Submit(DdcPriority::kUserWrite, kDdcBrightnessWrite, "user");
+			Submit(DdcPriority::kAnimationStep, kDdcBrightnessWrite, "step");
+
+			scheduler_.RunUntilIdle();
+
+			EXPECT_EQ(executed_, (std::vector<std::string>{ "user", "step" }));
+		}
+
+		TEST_F(DdcSchedulerTest, NewerUserWriteSupersedesQueuedOne)
+		{
+			Submit(DdcPriority::kUserWrite, kDdcBrightnessWrite, "first");
+			Submit(DdcPriority::kUserWrite, kDdcBrightnessWrite, "second");
+
+			scheduler_.RunUntilIdle();
+
+			EXPECT_EQ(executed_, std::vector<std::string>{ "second" });
+		}
+
+		TEST_F(DdcSchedulerTest, ReportsQueueDepthAndWaitTime)
+		{
+			Submit(DdcPriority::kUserWrite, kDdcNoCoalescing, "first");
+			Submit(DdcPriority::kUserWrite, kDdcNoCoalescing, "second");
+			Submit(DdcPriority::kUserWrite, kDdcNoCoalescing, "third");
+			EXPECT_EQ(scheduler_.metrics().queue_depth, 3u);
+
+			scheduler_.RunUntilIdle();
+
+			const DdcSchedulerMetrics metrics = scheduler_.metrics();
+			EXPECT_EQ(metrics.queue_depth, 0u);
+			EXPECT_EQ(metrics.maximum_queue_depth, 3u);
+			EXPECT_EQ(metrics.executed_count, 3u);
+			EXPECT_EQ(metrics.total_wait_time, milliseconds(0 + 80 + 160));
+			EXPECT_EQ(metrics.maximum_wait_time, milliseconds(160));
+		}
+
+		TEST_F(DdcSchedulerTest, RunWithoutWorkerDrainsInline)
+		{
+			Submit(DdcPriority::kBackgroundPoll, kDdcNoCoalescing, "poll");
+
+			const MonitorStatus status = scheduler_.Run(DdcPriority::kUserWrite, kDdcNoCoalescing, [this]
+				{
+					executed_.push_back("user");
+					return MonitorStatus::kSetBrightnessFailed;
+				});
+
+			EXPECT_EQ(status, MonitorStatus::kSetBrightnessFailed);
+			EXPECT_EQ(executed_, std::vector<std::string>{ "user" });
+			EXPECT_EQ(scheduler_.metrics().queue_depth, 1u);
+		}
+
+		TEST_F(DdcSchedulerTest, EstimatesLatencyAndPacing)
+		{
+			EXPECT_EQ(scheduler_.pacing().command_period, DdcLatencyEstimator::kInitialLatency + milliseconds(50));
+
+			for (int index = 0; index < 10; ++index)
+			{
+				Submit(DdcPriority::kUserWrite, kDdcNoCoalescing, "write");
+			}
+
+			scheduler_.RunUntilIdle();
+
+			const DdcSchedulerMetrics metrics = scheduler_.metrics();
+			EXPECT_EQ(metrics.latency.sample_count, 10u);
+			EXPECT_EQ(metrics.latency.smoothed, milliseconds(30));
+			EXPECT_EQ(metrics.latency.p99, milliseconds(30));
+
+			// each command holds the bus for its 30 ms plus 50 ms of silence
+			const DdcPacing pacing = scheduler_.pacing();
+			EXPECT_EQ(pacing.command_period, milliseconds(80));
+			EXPECT_EQ(pacing.poll_interval, milliseconds(80 * DdcScheduler::kPollBusShare));
+		}
+
+		TEST_F(DdcSchedulerTest, ShedsLowPriorityBacklog)
+		{
+			Submit(DdcPriority::kUserWrite, kDdcNoCoalescing, "write");
+			scheduler_.RunUntilIdle();
+			completions_.clear();
+
+			// 80 ms per command, so one second of bus time holds twelve
+			for (int index = 0; index < 20; ++index)
+			{
+				Submit(DdcPriority::kAnimationStep, kDdcNoCoalescing, "step");
+			}
+
+			Submit(DdcPriority::kUserWrite, kDdcNoCoalescing, "user");
+
+			EXPECT_EQ(scheduler_.metrics().queue_depth, 13u);
+			EXPECT_EQ(scheduler_.metrics().shed_count, 8u);
+			EXPECT_EQ(completions_, std::vector<MonitorStatus>(8, MonitorStatus::kPreempted));
+		}
+
+		TEST_F(DdcSchedulerTest, CoalescedStepIsNotShed)
+		{
+			// 100 ms per command before the first one is timed, so the queue is full at ten
+			for (int index = 0; index < 9; ++index)
+			{
+				Submit(DdcPriority::kBackgroundPoll, kDdcNoCoalescing, "poll");
+			}
+
+			Submit(DdcPriority::kAnimationStep, kDdcBrightnessWrite, "step 1");
+			Submit(DdcPriority::kAnimationStep, kDdcBrightnessWrite, "step 2");
+
+			const DdcSchedulerMetrics metrics = scheduler_.metrics();
+			EXPECT_EQ(metrics.queue_depth, 10u);
+			EXPECT_EQ(metrics.preempted_count, 1u);
+			EXPECT_EQ(metrics.shed_count, 0u);
+		}
+
+		TEST(DdcSchedulerLatencyTest, SlowMonitorGetsShorterQueue)
+		{
+			ManualClock clock;
+			DdcScheduler scheduler(clock, DdcScheduler::kMccsMinimumCommandInterval);
+			std::mt19937 random(20261019);
+			std::uniform_int_distribution<int> latency(150, 250);
+			for (int index = 0; index < 100; ++index)
+			{
+				scheduler.Submit(DdcPriority::kUserWrite, kDdcNoCoalescing, [&]
+					{
+						clock.Advance(milliseconds(latency(random)));
+						return MonitorStatus::kOk;
+					});
+				scheduler.RunUntilIdle();
+			}
+
+			const DdcPacing pacing = scheduler.pacing();
+			EXPECT_GE(pacing.command_period, milliseconds(200 + 50));
+			EXPECT_LE(pacing.command_period, milliseconds(250 + 50));
+
+			size_t admitted_count = 0;
+			for (int index = 0; index < 20; ++index)
+			{
+				scheduler.Submit(DdcPriority::kBackgroundPoll, kDdcNoCoalescing, [] { return MonitorStatus::kOk; },
+					[&admitted_count](const MonitorStatus status) { admitted_count += status == MonitorStatus::kOk; });
+			}
+
+			scheduler.RunUntilIdle();
+			EXPECT_EQ(admitted_count, static_cast<size_t>(DdcScheduler::kMaximumBacklog / pacing.command_period));
+		}
+
+		TEST(DdcSchedulerThreadTest, RunWaitsForWorker)
+		{
+			DdcScheduler scheduler(Clock::Steady(), milliseconds(1));
+			scheduler.Start();
+			int executed_count = 0;
+
+			for (int iteration = 0; iteration < 5; ++iteration)
+			{
+				EXPECT_EQ(scheduler.Run(DdcPriority::kUserWrite, kDdcNoCoalescing, [&executed_count]
+					{
+						++executed_count;
+						return MonitorStatus::kOk;
+					}), MonitorStatus::kOk);
+			}
+
+			scheduler.Submit(DdcPriority::kBackgroundPoll, kDdcNoCoalescing, [&executed_count]
+				{
+					++executed_count;
+					return MonitorStatus::kOk;
+				});
+			scheduler.Stop();
+
+			EXPECT_EQ(executed_count, 6);
+		}
+
+		TEST(ScheduledMonitorBackendTest, SpacesCommandsPerDisplay)
+		{
+			ManualClock clock;
+			FakeMonitorBackend fake_backend;
+			const DisplayHandle first_display = fake_backend.AddDisplay({ "first", 0, 40, 100 });
+			const DisplayHandle second_display = fake_backend.AddDisplay({ "second", 0, 40, 100 });
+			ScheduledMonitorBackend backend(fake_backend, clock, milliseconds(50), false);
+			const Clock::time_point start_time = clock.Now();
+
+			ASSERT_EQ(backend.SetScreenBrightness(first_display, 10), MonitorStatus::kOk);
+			ASSERT_EQ(backend.SetScreenBrightness(second_display, 20), MonitorStatus::kOk);
+			EXPECT_EQ(clock.Now(), start_time);
+
+			ASSERT_EQ(backend.SetScreenBrightness(first_display, 30), MonitorStatus::kOk);
+			EXPECT_EQ(clock.Now(), start_time + milliseconds(50));
+			EXPECT_EQ(fake_backend.GetDisplay(first_display).brightness, 30);
+			EXPECT_EQ(backend.GetScheduler(first_display).metrics().executed_count, 2u);
+		}
+
+		TEST(ScheduledMonitorBackendTest, ClientRunsThroughScheduler)
+		{
+			auto owned_backend = std::make_unique<FakeMonitorBackend>();
+			FakeMonitorBackend& fake_backend = *owned_backend;
+			const DisplayHandle display = fake_backend.AddDisplay({ "fake", 0, 40, 100 });
+			const auto service = std::make_shared<BrightnessService>(std::move(owned_backend), Clock::Steady(), milliseconds(0), true);
+			BrightnessClient client(service);
+			client.SetDisplay(display);
+			client.Initialize();
+			DdcScheduler& scheduler = service->scheduled_backend().GetScheduler(display);
+			const std::uint64_t executed_count = scheduler.metrics().executed_count;
+
+			ASSERT_EQ(client.SetApplicationScreenBrightness(0.8), MonitorStatus::kOk);
+			client.OnApplicationPause();
+
+			EXPECT_EQ(fake_backend.GetDisplay(display).brightness, 40);
+			EXPECT_EQ(scheduler.metrics().executed_count, executed_count + 2);
+		}
+	}
+}
@@ -0,0 +1,244 @@
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include "screen_brightness_windows/brightness_service.h"
+#include "screen_brightness_windows/display_state_table.h"
+#include "screen_brightness_windows/fake_monitor_backend.h"
+#include "screen_brightness_windows/process_liveness.h"
+
+namespace screen_brightness
+{
+	namespace test
+	{
+		namespace
+		{
+			// A state whose values all derive from value, so a torn read shows as a mismatch.
+			PublishedDisplayState MakeConsistentState(const DisplayHandle display, const long value)
+			{
+				PublishedDisplayState state;
+				state.display = display;
+				state.current = value;
+				state.target = value + 1;
+				state.minimum = -value;
+				state.maximum = value * 2;
+				state.system = value + 3;
+				state.owner = static_cast<std::uint32_t>(value);
+				return state;
+			}
+
+			bool IsConsistent(const PublishedDisplayState& state)
+			{
+				const long value = state.current;
+				return state.target == value + 1 && state.minimum == -value && state.maximum == value * 2 && state.system == value + 3 &&
+					state.owner == static_cast<std::uint32_t>(value);
+			}
+		}
+
+		TEST(DisplayStateTableTest, PublishesAndReadsBack)
+		{
+			DisplayStateTable table;
+			PublishedDisplayState state;
+			EXPECT_FALSE(table.Read(7, state));
+			EXPECT_EQ(table.generation(), 0u);
+
+			EXPECT_TRUE(table.Publish(MakeConsistentState(7, 40)));
+			EXPECT_TRUE(table.Publish(MakeConsistentState(9, 60)));
+			EXPECT_TRUE(table.Publish(MakeConsistentState(7, 50)));
+			ASSERT_TRUE(table.Read(7, state));
+			EXPECT_EQ(state.display, 7u);
+			EXPECT_EQ(state.current, 50);
+			EXPECT_TRUE(IsConsistent(state));
+			EXPECT_EQ(state.generation, 2u);
+			ASSERT_TRUE(table.Read(9, state));
+			EXPECT_EQ(state.current, 60);
+			EXPECT_EQ(state.generation, 1u);
+			EXPECT_EQ(table.generation(), 3u);
+
+			// the slot of a removed display is reused
+			table.Remove(7);
+			EXPECT_FALSE(table.Read(7, state));
+			EXPECT_TRUE(table.Publish(MakeConsistentState(11, 70)));
+			EXPECT_EQ(table.layout().slots[0].display.load(), 11u);
+		}
+
+		TEST(DisplayStateTableTest, RejectsDisplaysBeyondCapacity)
+		{
+			DisplayStateTable table;
+			for (DisplayHandle display = 1; display <= DisplayStateTable::kSlotCount; ++display)
+			{
+				EXPECT_TRUE(table.Publish(MakeConsistentState(display, 1)));
+			}
+
+			EXPECT_FALSE(table.Publish(MakeConsistentState(DisplayStateTable::kSlotCount + 1, 1)));
+			EXPECT_TRUE(table.Publish(MakeConsistentState(1, 2)));
+		}
+
+		TEST(DisplayStateTableTest, ReadersNeverSeeTornStates)
+		{
+			constexpr int kReaderCount = 4;
+			constexpr long kWriteCount = 200000;
+			DisplayStateTable table;
+			table.Publish(MakeConsistentState(1, 0));
+			table.Publish(MakeConsistentState(2, 0));
+
+			std::atomic<bool> is_writing{ true };
+			std::atomic<long> torn_count{ 0 };
+			std::atomic<long> read_count{ 0 };
+			std::vector<std::thread> readers;
+			for (int reader = 0; reader < kReaderCount; ++reader)
+			{
+				readers.emplace_back([&table, &is_writing, &torn_count, &read_count, reader]
+					{
+						const DisplayHandle display = reader % 2 + 1;
+						std::uint64_t last_generation = 0;
+						long reads = 0;
+						while (is_writing.load(std::memory_order_relaxed))
+						{
+							PublishedDisplayState state;
+							if (!table.Read(display, state) || !IsConsistent(state) || state.generation < last_generation)
+							{
+								torn_count.fetch_add(1, std::memory_order_relaxed);
+							}
+
+							last_generation = state.generation;
+							++reads;
+						}
+
+						read_count.fetch_add(reads, std::memory_order_relaxed);
+					});
+			}
+
+			for (long value = 1; value <= kWriteCount; ++value)
+			{
+				table.Publish(MakeConsistentState(value % 2 + 1, value));
+			}
+
+			is_writing.store(false, std::memory_order_relaxed);
+			for (std::thread& reader : readers)
+			{
+				reader.join();
+			}
+
+			EXPECT_EQ(torn_count.load(), 0);
+			EXPECT_GT(read_count.load(), 0);
+			EXPECT_EQ(table.generation(), static_cast<std::uint64_t>(kWriteCount + 2));
+		}
+
+		TEST(DisplayStateTableTest, ReadersFollowDisplaysMovingBetweenSlots)
+		{
+			DisplayStateTable table;
+			std::atomic<bool> is_writing{ true };
+			std::atomic<long> wrong_count{ 0 };
+			std::thread reader([&table, &is_writing, &wrong_count]
+				{
+					while (is_writing.load(std::memory_order_relaxed))
+					{
+						PublishedDisplayState state;
+						if (table.Read(5, state) && (state.display != 5 || !IsConsistent(state)))
+						{
+							wrong_count.fetch_add(1, std::memory_order_relaxed);
+						}
+					}
+				});
+
+			// removing display 5 and adding another one before it moves 5 to another slot
+			for (long value = 1; value <= 50000; ++value)
+			{
+				table.Publish(MakeConsistentState(value % 2 == 0 ? 5 : 6, value));
+				table.Remove(value % 2 == 0 ? 5 : 6);
+			}
+
+			is_writing.store(false, std::memory_order_relaxed);
+			reader.join();
+			EXPECT_EQ(wrong_count.load(), 0);
+		}
+
+		class DisplayStateTableServiceTest : public ::testing::Test
+		{
+		protected:
+			FakeMonitorBackend* backend_ = nullptr;
+
+			DisplayHandle display_ = 0;
+
+			std::shared_ptr<BrightnessService> service_;
+
+			void SetUp() override
+			{
+				auto backend = std::make_unique<FakeMonitorBackend>();
+				backend_ = backend.get();
+				display_ = backend->AddDisplay({ "published", 0, 40, 200 });
+				service_ = std::make_shared<BrightnessService>(std::move(backend), Clock::Steady(), std::chrono::milliseconds(0), false);
+			}
+
+			PublishedDisplayState Read() const
+			{
+				PublishedDisplayState state;
+				EXPECT_TRUE(service_->display_state_table().Read(display_, state));
+				return state;
+			}
+		};
+
+		TEST_F(DisplayStateTableServiceTest, FollowsTheClients)
+		{
+			PublishedDisplayState state;
+			EXPECT_FALSE(service_->display_state_table().Read(display_, state));
+
+			BrightnessClient first(service_);
+			first.SetDisplay(display_);
+			first.Initialize();
+			state = Read();
+			EXPECT_EQ(state.current, 40);
+			EXPECT_EQ(state.target, 40);
+			EXPECT_EQ(state.system, 40);
+			EXPECT_EQ(state.minimum, 0);
+			EXPECT_EQ(state.maximum, 200);
+			EXPECT_EQ(state.owner, 0u);
+
+			ASSERT_EQ(first.SetApplicationScreenBrightness(0.5), MonitorStatus::kOk);
+			state = Read();
+			EXPECT_EQ(state.current, 100);
+			EXPECT_EQ(state.target, 100);
+			EXPECT_EQ(state.system, 40);
+			EXPECT_EQ(state.owner, GetOwnProcessId());
+
+			// a paused client's override stays with it, and the display is restored
+			const std::uint64_t generation = state.generation;
+			first.OnApplicationPause();
+			state = Read();
+			EXPECT_GT(state.generation, generation);
+			EXPECT_EQ(state.current, 40);
+			EXPECT_EQ(state.target, 40);
+			EXPECT_EQ(state.owner, 0u);
+
+			first.OnApplicationResume();
+			ASSERT_EQ(first.SetSystemScreenBrightness(0.25), MonitorStatus::kOk);
+			state = Read();
+			EXPECT_EQ(state.current, 100);
+			EXPECT_EQ(state.system, 50);
+
+			ASSERT_EQ(first.ResetApplicationScreenBrightness(), MonitorStatus::kOk);
+			state = Read();
+			EXPECT_EQ(state.current, 50);
+			EXPECT_EQ(state.target, 50);
+			EXPECT_EQ(state.owner, 0u);
+		}
+
+		TEST_F(DisplayStateTableServiceTest, ForgetsRemovedDisplays)
+		{
+			BrightnessClient client(service_);
+			client.SetDisplay(display_);
+			client.Initialize();
+			(void)Read();
+
+			backend_->RemoveDisplay(display_);
+			ASSERT_EQ(service_->UpdateDisplayTopology(), MonitorStatus::kOk);
+			PublishedDisplayState state;
+			EXPECT_FALSE(service_->display_state_table().Read(display_, state));
+		}
+	}
+}
@@ -0,0 +1,191 @@
+#include <gtest/gtest.h>
+
+#include <string>
+#include <vector>
+
+#include "screen_brightness_windows/display_topology.h"
+#include "screen_brightness_windows/fake_monitor_backend.h"
+#include "test_edid.h"
+
+namespace screen_brightness
+{
+	namespace test
+	{
+		namespace
+		{
+			std::vector<std::string> Ids(const std::vector<DisplayInfo>& displays)
+			{
+				std::vector<std::string> ids;
+				for (const DisplayInfo& display : displays)
+				{
+					ids.push_back(display.id);
+				}
+
+				return ids;
+			}
+		}
+
+		class DisplayTopologyTest : public ::testing::Test
+		{
+		protected:
+			FakeMonitorBackend backend_;
+
+			DisplayTopology topology_{ backend_ };
+
+			DisplayTopologyDelta delta_;
+		};
+
+		TEST_F(DisplayTopologyTest, FirstUpdateAddsAllDisplaysWithoutReadingThem)
+		{
+			backend_.AddDisplay({ "laptop", 0, 40, 100 });
+			backend_.AddDisplay({ "dock", 0, 70, 100 });
+
+			ASSERT_EQ(topology_.Update(delta_), MonitorStatus::kOk);
+
+			EXPECT_EQ(Ids(delta_.added), (std::vector<std::string>{ "dock", "laptop" }));
+			EXPECT_TRUE(delta_.removed.empty());
+			EXPECT_EQ(backend_.get_count(), 0);
+			ASSERT_NE(topology_.Find("dock"), nullptr);
+			EXPECT_EQ(topology_.Find("dock")->info.id, "dock");
+		}
+
+		TEST_F(DisplayTopologyTest, UnchangedTopologyHasNoDelta)
+		{
+			backend_.AddDisplay({ "laptop", 0, 40, 100 });
+			ASSERT_EQ(topology_.Update(delta_), MonitorStatus::kOk);
+
+			ASSERT_EQ(topology_.Update(delta_), MonitorStatus::kOk);
+
+			EXPECT_TRUE(delta_.empty());
+			EXPECT_EQ(topology_.displays().size(), 1u);
+		}
+
+		TEST_F(DisplayTopologyTest, DockAndUndockOnlyProcessesDelta)
+		{
+			backend_.AddDisplay({ "laptop", 0, 40, 100 });
+			ASSERT_EQ(topology_.Update(delta_), MonitorStatus::kOk);
+
+			// dock: two external displays appear
+			const DisplayHandle left = backend_.AddDisplay({ "left", 0, 10, 100 });
+			const DisplayHandle right = backend_.AddDisplay({ "right", 0, 20, 100 });
+			ASSERT_EQ(topology_.Update(delta_), MonitorStatus::kOk);
+			EXPECT_EQ(Ids(delta_.added), (std::vector<std::string>{ "left", "right" }));
+			EXPECT_TRUE(delta_.removed.empty());
+			EXPECT_EQ(topology_.displays().size(), 3u);
+
+			// undock
+			backend_.RemoveDisplay(left);
+			backend_.RemoveDisplay(right);
+			ASSERT_EQ(topology_.Update(delta_), MonitorStatus::kOk);
+			EXPECT_TRUE(delta_.added.empty());
+			EXPECT_EQ(Ids(delta_.removed), (std::vector<std::string>{ "left", "right" }));
+			EXPECT_EQ(topology_.displays().size(), 1u);
+		}
+
+		TEST_F(DisplayTopologyTest, RetainedDisplayFollowsNewHandle)
+		{
+			const DisplayHandle handle = backend_.AddDisplay({ "external", 0, 40, 100 });
+			ASSERT_EQ(topology_.Update(delta_), MonitorStatus::kOk);
+
+			// the same monitor comes back with a new handle, e.g. after a port swap
+			backend_.RemoveDisplay(handle);
+			const DisplayHandle new_handle = backend_.AddDisplay({ "external", 0, 40, 100 });
+			ASSERT_EQ(topology_.Update(delta_), MonitorStatus::kOk);
+
+			EXPECT_TRUE(delta_.empty());
+			ASSERT_EQ(delta_.handle_changes.size(), 1u);
+			EXPECT_EQ(delta_.handle_changes[0].previous, handle);
+			EXPECT_EQ(delta_.handle_changes[0].current, new_handle);
+			EXPECT_EQ(topology_.Find("external")->info.handle, new_handle);
+			EXPECT_EQ(topology_.FindByHandle(handle), nullptr);
+			EXPECT_NE(topology_.FindByHandle(new_handle), nullptr);
+		}
+
+		TEST_F(DisplayTopologyTest, FailingDisplayIsAdded)
+		{
+			const DisplayHandle handle = backend_.AddDisplay({ "flaky", 0, 40, 100 });
+			backend_.GetDisplay(handle).is_failing = true;
+
+			ASSERT_EQ(topology_.Update(delta_), MonitorStatus::kOk);
+
+			EXPECT_EQ(Ids(delta_.added), std::vector<std::string>{ "flaky" });
+			EXPECT_NE(topology_.Find("flaky"), nullptr);
+		}
+
+		TEST_F(DisplayTopologyTest, InterleavedHotplugSequence)
+		{
+			std::vector<DisplayHandle> handles;
+			for (const char* name : { "a", "c", "e" })
+			{
+				handles.push_back(backend_.AddDisplay({ name }));
+			}
+			ASSERT_EQ(topology_.Update(delta_), MonitorStatus::kOk);
+
+			backend_.RemoveDisplay(handles[1]);
+			backend_.AddDisplay({ "b" });
+			backend_.AddDisplay({ "f" });
+			ASSERT_EQ(topology_.Update(delta_), MonitorStatus::kOk);
+
+			EXPECT_EQ(Ids(delta_.added), (std::vector<std::string>{ "b", "f" }));
+			EXPECT_EQ(Ids(delta_.removed), std::vector<std::string>{ "c" });
+			std::vector<std::string> ids;
+			for (const auto& display : topology_.displays())
+			{
+				ids.push_back(display.info.id);
+			}
+			EXPECT_EQ(ids, (std::vector<std::string>{ "a", "b", "e", "f" }));
+		}
+
+		TEST_F(DisplayTopologyTest, IndexesDisplaysByEdidIdentity)
+		{
+			FakeMonitorBackend::Display monitor{ "port1", 0, 40, 100 };
+			monitor.edid = CreateEdid(TestEdid());
+			backend_.AddDisplay(monitor);
+			backend_.AddDisplay({ "laptop", 0, 70, 100 });
+			ASSERT_EQ(topology_.Update(delta_), MonitorStatus::kOk);
+			const DisplayIdentity identity = topology_.Find("port1")->info.identity;
+			ASSERT_EQ(delta_.added.size(), 2u);
+			EXPECT_EQ(delta_.added[1].identity, identity);
+
+			// the monitor is moved to another port and gets another handle and device id
+			backend_.RemoveDisplay(topology_.Find("port1")->info.handle);
+			monitor.name = "port2";
+			const DisplayHandle handle = backend_.AddDisplay(monitor);
+			ASSERT_EQ(topology_.Update(delta_), MonitorStatus::kOk);
+
+			const DisplayTopology::Display* display = topology_.FindByIdentity(identity);
+			ASSERT_NE(display, nullptr);
+			EXPECT_EQ(display->info.handle, handle);
+			EXPECT_EQ(display->info.id, "port2");
+			EXPECT_EQ(display->edid, monitor.edid);
+		}
+
+		TEST_F(DisplayTopologyTest, IdentifiesDisplayWithoutEdidByDeviceId)
+		{
+			backend_.AddDisplay({ "laptop", 0, 70, 100 });
+
+			ASSERT_EQ(topology_.Update(delta_), MonitorStatus::kOk);
+
+			EXPECT_EQ(topology_.Find("laptop")->info.identity, GetDisplayIdentity("laptop"));
+			EXPECT_EQ(topology_.FindByIdentity(GetDisplayIdentity("laptop")), topology_.Find("laptop"));
+			EXPECT_EQ(topology_.FindByIdentity(GetDisplayIdentity("dock")), nullptr);
+		}
+
+		TEST_F(DisplayTopologyTest, SeparatesClonedEdids)
+		{
+			FakeMonitorBackend::Display monitor{ "left", 0, 40, 100 };
+			monitor.edid = CreateEdid(TestEdid());
+			backend_.AddDisplay(monitor);
+			monitor.name = "right";
+			backend_.AddDisplay(monitor);
+
+			ASSERT_EQ(topology_.Update(delta_), MonitorStatus::kOk);
+
+			const DisplayIdentity left = topology_.Find("left")->info.identity;
+			const DisplayIdentity right = topology_.Find("right")->info.identity;
+			EXPECT_NE(left, right);
+			EXPECT_EQ(topology_.FindByIdentity(left)->info.id, "left");
+			EXPECT_EQ(topology_.FindByIdentity(right)->info.id, "right");
+		}
+	}
+}
@@ -0,0 +1,248 @@
+#include <gtest/gtest.h>
+
+#include <cstdint>
+#include <random>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "screen_brightness_windows/display_identity.h"
+#include "screen_brightness_windows/edid.h"
+#include "test_edid.h"
+
+namespace screen_brightness
+{
+	namespace test
+	{
+		namespace
+		{
+			TestEdid CreateLaptopPanel()
+			{
+				TestEdid panel;
+				panel.manufacturer_id = "LGD";
+				panel.product_code = 0x05e5;
+				panel.serial_number = 0;
+				panel.monitor_name.clear();
+				panel.serial_string.clear();
+				panel.text = "LP140WF9-SPE2";
+				panel.width_centimeters = 31;
+				panel.height_centimeters = 17;
+				panel.width_millimeters = 0;
+				panel.height_millimeters = 0;
+				return panel;
+			}
+
+			Edid Parse(const std::vector<std::uint8_t>& blob)
+			{
+				Edid edid;
+				EXPECT_TRUE(edid.Parse(blob.data(), blob.size()));
+				return edid;
+			}
+		}
+
+		TEST(EdidTest, ParsesIdentificationFields)
+		{
+			const std::vector<std::uint8_t> blob = CreateEdid(TestEdid());
+
+			const Edid edid = Parse(blob);
+
+			EXPECT_EQ(edid.manufacturer_id(), "DEL");
+			EXPECT_EQ(edid.product_code(), 0xa0f5);
+			EXPECT_EQ(edid.serial_number(), 0x4c4d3153u);
+			EXPECT_EQ(edid.manufacture_week(), 12);
+			EXPECT_EQ(edid.manufacture_year(), 2020);
+			EXPECT_EQ(edid.monitor_name(), "DELL U2720Q");
+			EXPECT_EQ(edid.serial_string(), "8ZJNZ13");
+			EXPECT_TRUE(edid.text().empty());
+			EXPECT_EQ(edid.width_millimeters(), 597);
+			EXPECT_EQ(edid.height_millimeters(), 336);
+			EXPECT_TRUE(edid.is_checksum_valid());
+		}
+
+		TEST(EdidTest, ParsesLaptopPanel)
+		{
+			const std::vector<std::uint8_t> blob = CreateEdid(CreateLaptopPanel());
+
+			const Edid edid = Parse(blob);
+
+			EXPECT_EQ(edid.manufacturer_id(), "LGD");
+			EXPECT_EQ(edid.serial_number(), 0u);
+			EXPECT_TRUE(edid.monitor_name().empty());
+			EXPECT_EQ(edid.text(), "LP140WF9-SPE2");
+			// no size in the detailed timing, so the centimetre sizes are used
+			EXPECT_EQ(edid.width_millimeters(), 310);
+			EXPECT_EQ(edid.height_millimeters(), 170);
+		}
+
+		TEST(EdidTest, ParsesPublishedEdids)
+		{
+			struct Expected
+			{
+				const std::vector<std::uint8_t>* blob;
+
+				const char* monitor_name;
+
+				int width_millimeters;
+
+				int height_millimeters;
+			};
+
+			for (const Expected& expected : { Expected{ &kLinuxXgaEdid, "Linux XGA", 355, 266 }, Expected{ &kLinuxSxgaEdid, "Linux SXGA", 444, 355 },
+				Expected{ &kLinuxFhdEdid, "Linux FHD", 500, 281 } })
+			{
+				const Edid edid = Parse(*expected.blob);
+
+				EXPECT_EQ(edid.manufacturer_id(), "LNX");
+				EXPECT_EQ(edid.product_code(), 0);
+				EXPECT_EQ(edid.serial_number(), 0u);
+				EXPECT_EQ(edid.manufacture_week(), 5);
+				EXPECT_EQ(edid.manufacture_year(), 2012);
+				EXPECT_EQ(edid.monitor_name(), expected.monitor_name);
+				EXPECT_EQ(edid.serial_string(), "Linux #0");
+				EXPECT_TRUE(edid.text().empty());
+				EXPECT_EQ(edid.width_millimeters(), expected.width_millimeters);
+				EXPECT_EQ(edid.height_millimeters(), expected.height_millimeters);
+				EXPECT_EQ(edid.extension_count(), 0);
+				EXPECT_TRUE(edid.is_checksum_valid());
+			}
+		}
+
+		TEST(EdidTest, ParsesModelYear)
+		{
+			TestEdid fields;
+			fields.week = 0xff;
+			fields.year = 33;
+
+			const Edid edid = Parse(CreateEdid(fields));
+
+			EXPECT_EQ(edid.manufacture_week(), 0);
+			EXPECT_EQ(edid.manufacture_year(), 2023);
+		}
+
+		TEST(EdidTest, KeepsDescriptorTextWithoutTerminator)
+		{
+			TestEdid fields;
+			fields.monitor_name = "ABCDEFGHIJKLMNOP";
+
+			const std::vector<std::uint8_t> blob = CreateEdid(fields);
+
+			EXPECT_EQ(Parse(blob).monitor_name(), "ABCDEFGHIJKLM");
+		}
+
+		TEST(EdidTest, AcceptsStaleChecksum)
+		{
+			std::vector<std::uint8_t> blob = CreateEdid(TestEdid());
+			blob[127] ^= 0x01;
+
+			const Edid edid = Parse(blob);
+
+			EXPECT_FALSE(edid.is_checksum_valid());
+			EXPECT_EQ(edid.manufacturer_id(), "DEL");
+		}
+
+		TEST(EdidTest, CountsExtensionBlocks)
+		{
+			TestEdid fields;
+			fields.extension_count = 1;
+			const std::vector<std::uint8_t> blob = CreateEdid(fields);
+
+			const Edid edid = Parse(blob);
+
+			EXPECT_EQ(blob.size(), 256u);
+			EXPECT_EQ(edid.extension_count(), 1);
+			EXPECT_TRUE(edid.is_checksum_valid());
+		}
+
+		TEST(EdidTest, RejectsTruncatedOrForeignData)
+		{
+			std::vector<std::uint8_t> blob = CreateEdid(TestEdid());
+			Edid edid;
+
+			EXPECT_FALSE(edid.Parse(blob.data(), 127));
+			EXPECT_FALSE(edid.Parse(nullptr, 0));
+			blob[0] = 0xff;
+			EXPECT_FALSE(edid.Parse(blob.data(), blob.size()));
+			EXPECT_EQ(edid.manufacturer_id(), "???");
+		}
+
+		// Flips random bytes of the corpus and checks that the strings never leave the blob.
+		TEST(EdidTest, SurvivesCorruptedCorpus)
+		{
+			TestEdid extended;
+			extended.extension_count = 2;
+			const std::vector<std::vector<std::uint8_t>> corpus = { CreateEdid(TestEdid()), CreateEdid(CreateLaptopPanel()), CreateEdid(extended),
+				kLinuxXgaEdid, kLinuxFhdEdid };
+
+			std::mt19937 random(20261019);
+			Edid edid;
+			for (int iteration = 0; iteration < 20000; ++iteration)
+			{
+				std::vector<std::uint8_t> blob = corpus[random() % corpus.size()];
+				for (int mutation = 1 + static_cast<int>(random() % 16); mutation > 0; --mutation)
+				{
+					// keep the header most of the time, so the descriptors get exercised
+					blob[8 + random() % (blob.size() - 8)] = static_cast<std::uint8_t>(random());
+				}
+
+				if (!edid.Parse(blob.data(), blob.size()))
+				{
+					continue;
+				}
+
+				const char* begin = reinterpret_cast<const char*>(blob.data());
+				for (const std::string_view text : { edid.monitor_name(), edid.serial_string(), edid.text() })
+				{
+					ASSERT_LE(text.size(), 13u);
+					ASSERT_TRUE(text.empty() || (text.data() >= begin && text.data() + text.size() <= begin + Edid::kBlockSize));
+				}
+
+				ASSERT_LE(edid.width_millimeters(), 4095);
+			}
+		}
+
+		TEST(DisplayIdentityTest, FollowsMonitorAcrossPorts)
+		{
+			const std::vector<std::uint8_t> blob = CreateEdid(TestEdid());
+			const Edid edid = Parse(blob);
+
+			EXPECT_EQ(GetDisplayIdentity(edid, "DISPLAY#DEL4123#UID4353"), GetDisplayIdentity(edid, "DISPLAY#DEL4123#UID4354"));
+		}
+
+		TEST(DisplayIdentityTest, SeparatesPublishedEdids)
+		{
+			EXPECT_NE(GetDisplayIdentity(Parse(kLinuxXgaEdid), "port"), GetDisplayIdentity(Parse(kLinuxSxgaEdid), "port"));
+			EXPECT_NE(GetDisplayIdentity(Parse(kLinuxSxgaEdid), "port"), GetDisplayIdentity(Parse(kLinuxFhdEdid), "port"));
+			EXPECT_EQ(GetDisplayIdentity(Parse(kLinuxFhdEdid), "left"), GetDisplayIdentity(Parse(kLinuxFhdEdid), "right"));
+		}
+
+		TEST(DisplayIdentityTest, SeparatesMonitorsBySerial)
+		{
+			TestEdid other;
+			other.serial_number = 0x4c4d3154;
+			other.serial_string = "8ZJNZ14";
+			const std::vector<std::uint8_t> first_blob = CreateEdid(TestEdid());
+			const std::vector<std::uint8_t> second_blob = CreateEdid(other);
+
+			EXPECT_NE(GetDisplayIdentity(Parse(first_blob), "port"), GetDisplayIdentity(Parse(second_blob), "port"));
+		}
+
+		TEST(DisplayIdentityTest, UsesDeviceIdWithoutSerial)
+		{
+			TestEdid placeholder;
+			placeholder.serial_number = 0x01010101;
+			placeholder.serial_string.clear();
+			const std::vector<std::uint8_t> panel_blob = CreateEdid(CreateLaptopPanel());
+			const std::vector<std::uint8_t> placeholder_blob = CreateEdid(placeholder);
+
+			EXPECT_NE(GetDisplayIdentity(Parse(panel_blob), "left"), GetDisplayIdentity(Parse(panel_blob), "right"));
+			EXPECT_NE(GetDisplayIdentity(Parse(placeholder_blob), "left"), GetDisplayIdentity(Parse(placeholder_blob), "right"));
+		}
+
+		TEST(DisplayIdentityTest, FormatsAsHex)
+		{
+			EXPECT_EQ(ToString(DisplayIdentity{ 0x0123456789abcdefULL }), "0123456789abcdef");
+			EXPECT_EQ(GetDisplayIdentity("laptop"), GetDisplayIdentity("laptop"));
+			EXPECT_NE(GetDisplayIdentity("laptop"), GetDisplayIdentity("dock"));
+		}
+	}
+}
@@ -0,0 +1,122 @@
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <cstdlib>
+#include <ctime>
+#include <filesystem>
+#include <fstream>
+#include <string>
+
+#include <linux/input.h>
+
+#include "screen_brightness_windows/evdev_activity_source.h"
+
+namespace screen_brightness
+{
+	namespace test
+	{
+		using std::chrono::milliseconds;
+		using std::chrono::seconds;
+
+		// A fake /dev/input. Event devices are regular files of input_event records, stamped on CLOCK_MONOTONIC.
+		class EvdevActivitySourceTest : public ::testing::Test
+		{
+		protected:
+			std::filesystem::path root_;
+
+			ManualClock clock_;
+
+			void SetUp() override
+			{
+				std::string pattern = (std::filesystem::temp_directory_path() / "evdev_XXXXXX").string();
+				root_ = mkdtemp(pattern.data());
+				clock_.Advance(seconds(100));
+			}
+
+			void TearDown() override
+			{
+				std::filesystem::remove_all(root_);
+			}
+
+			// Appends an event which happened age ago, or at the given CLOCK_REALTIME time.
+			void AddEvent(const std::string& device, const unsigned short type, const std::chrono::nanoseconds age, const bool is_realtime = false)
+			{
+				timespec now{};
+				clock_gettime(is_realtime ? CLOCK_REALTIME : CLOCK_MONOTONIC, &now);
+				const auto time = seconds(now.tv_sec) + std::chrono::nanoseconds(now.tv_nsec) - age;
+				input_event event{};
+				event.input_event_sec = static_cast<decltype(event.input_event_sec)>(std::chrono::duration_cast<seconds>(time).count());
+				event.input_event_usec = static_cast<decltype(event.input_event_usec)>(
+					std::chrono::duration_cast<std::chrono::microseconds>(time % seconds(1)).count());
+				event.type = type;
+				std::ofstream stream(root_ / device, std::ios::binary | std::ios::app);
+				stream.write(reinterpret_cast<const char*>(&event), sizeof(event));
+			}
+
+			std::chrono::milliseconds GetIdleTime(EvdevActivitySource& source)
+			{
+				return std::chrono::duration_cast<milliseconds>(clock_.Now() - source.GetLastInputTime());
+			}
+		};
+
+		TEST_F(EvdevActivitySourceTest, ReportsInputWithoutDevices)
+		{
+			EvdevActivitySource source(clock_, root_.string());
+			EXPECT_FALSE(source.is_open());
+			clock_.Advance(seconds(60));
+			EXPECT_EQ(source.GetLastInputTime(), clock_.Now());
+		}
+
+		TEST_F(EvdevActivitySourceTest, TakesTheNewestEventOfAnyDevice)
+		{
+			std::ofstream(root_ / "mouse0").put('x');
+			AddEvent("event0", EV_KEY, seconds(8));
+			AddEvent("event1", EV_REL, seconds(3));
+			AddEvent("event1", EV_SYN, seconds(0));
+			EvdevActivitySource source(clock_, root_.string());
+			EXPECT_EQ(source.device_count(), 2u);
+
+			clock_.Advance(seconds(10));
+			EXPECT_NEAR(static_cast<double>(GetIdleTime(source).count()), 3000, 500);
+		}
+
+		TEST_F(EvdevActivitySourceTest, KeepsTheLastInputWhileIdle)
+		{
+			AddEvent("event0", EV_KEY, seconds(0));
+			EvdevActivitySource source(clock_, root_.string());
+			clock_.Advance(seconds(1));
+			const Clock::time_point last_input_time = source.GetLastInputTime();
+
+			clock_.Advance(seconds(30));
+			EXPECT_EQ(source.GetLastInputTime(), last_input_time);
+
+			AddEvent("event0", EV_ABS, seconds(0));
+			EXPECT_NEAR(static_cast<double>(GetIdleTime(source).count()), 0, 500);
+		}
+
+		TEST_F(EvdevActivitySourceTest, TakesRealtimeTimestampsAsNow)
+		{
+			AddEvent("event0", EV_KEY, seconds(0), true);
+			EvdevActivitySource source(clock_, root_.string());
+			clock_.Advance(seconds(20));
+			EXPECT_EQ(source.GetLastInputTime(), clock_.Now());
+		}
+
+		TEST_F(EvdevActivitySourceTest, FindsDevicesPluggedInLater)
+		{
+			AddEvent("event0", EV_KEY, seconds(0));
+			EvdevActivitySource source(clock_, root_.string());
+			clock_.Advance(seconds(1));
+			const Clock::time_point last_input_time = source.GetLastInputTime();
+
+			AddEvent("event5", EV_KEY, seconds(0));
+			clock_.Advance(milliseconds(500));
+			EXPECT_EQ(source.GetLastInputTime(), last_input_time);
+
+			clock_.Advance(EvdevActivitySource::kRescanInterval);
+			EXPECT_EQ(source.device_count(), 1u);
+			EXPECT_GT(source.GetLastInputTime(), last_input_time);
+			EXPECT_EQ(source.device_count(), 2u);
+		}
+	}
+}
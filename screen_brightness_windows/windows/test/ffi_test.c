@@ -0,0 +1,267 @@
+/* Exercises the C ABI from C, as dart:ffi sees it, against the test host. Returns the number of failed checks. */
+
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "ffi_test_host.h"
+
+static int failure_count = 0;
+
+#define CHECK(condition) \
+	do \
+	{ \
+		if (!(condition)) \
+		{ \
+			fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #condition); \
+			++failure_count; \
+		} \
+	} while (0)
+
+#define CHECK_NEAR(value, expected) CHECK(fabs((value) - (expected)) < 1e-9)
+
+typedef struct
+{
+	int count;
+
+	int preempted_count;
+
+	int64_t last_request_id;
+
+	int32_t last_status;
+} Completions;
+
+typedef struct
+{
+	int count;
+
+	double last_brightness;
+} Changes;
+
+static void OnCompleted(int64_t request_id, int32_t status, void* user_data)
+{
+	Completions* completions = (Completions*)user_data;
+	++completions->count;
+	completions->preempted_count += status == SCREEN_BRIGHTNESS_FFI_PREEMPTED ? 1 : 0;
+	completions->last_request_id = request_id;
+	completions->last_status = status;
+}
+
+static void OnChanged(double brightness, void* user_data)
+{
+	Changes* changes = (Changes*)user_data;
+	++changes->count;
+	changes->last_brightness = brightness;
+}
+
+static void TestWithoutEngine(void)
+{
+	Completions completions;
+	memset(&completions, 0, sizeof(completions));
+	CHECK(ScreenBrightnessFfiGetVersion() == SCREEN_BRIGHTNESS_FFI_VERSION);
+	CHECK(ScreenBrightnessFfiGetCachedBrightness() == -1);
+	CHECK(ScreenBrightnessFfiSetBrightnessAsync(0.5, OnCompleted, &completions) == SCREEN_BRIGHTNESS_FFI_UNAVAILABLE);
+	CHECK(ScreenBrightnessFfiSubscribe(OnChanged, NULL) == SCREEN_BRIGHTNESS_FFI_UNAVAILABLE);
+	CHECK(ScreenBrightnessFfiGetStateTable() == NULL);
+	CHECK(completions.count == 0);
+	CHECK(strlen(ScreenBrightnessFfiGetStatusMessage(SCREEN_BRIGHTNESS_FFI_UNAVAILABLE)) > 0);
+	CHECK(strlen(ScreenBrightnessFfiGetStatusMessage(SCREEN_BRIGHTNESS_FFI_PREEMPTED)) > 0);
+}
+
+static void TestSetAndSubscribe(void)
+{
+	Completions completions;
+	Changes changes;
+	memset(&completions, 0, sizeof(completions));
+	memset(&changes, 0, sizeof(changes));
+	CHECK(ScreenBrightnessFfiTestHostStart(0.5, 0) == SCREEN_BRIGHTNESS_FFI_OK);
+	CHECK_NEAR(ScreenBrightnessFfiGetCachedBrightness(), 0.5);
+
+	const int64_t subscription_id = ScreenBrightnessFfiSubscribe(OnChanged, &changes);
+	CHECK(subscription_id > 0);
+	const int64_t request_id = ScreenBrightnessFfiSetBrightnessAsync(0.8, OnCompleted, &completions);
+	CHECK(request_id > 0);
+	ScreenBrightnessFfiTestHostWaitUntilIdle();
+
+	CHECK(completions.count == 1);
+	CHECK(completions.last_request_id == request_id);
+	CHECK(completions.last_status == SCREEN_BRIGHTNESS_FFI_OK);
+	CHECK_NEAR(ScreenBrightnessFfiGetCachedBrightness(), 0.8);
+	CHECK_NEAR(ScreenBrightnessFfiTestHostGetDisplayBrightness(), 0.8);
+	CHECK(changes.count == 1);
+	CHECK_NEAR(changes.last_brightness, 0.8);
+
+	/* no callback once unsubscribed */
+	ScreenBrightnessFfiUnsubscribe(subscription_id);
+	CHECK(ScreenBrightnessFfiSetBrightnessAsync(0.2, NULL, NULL) > 0);
+	ScreenBrightnessFfiTestHostWaitUntilIdle();
+	CHECK(changes.count == 1);
+	CHECK_NEAR(ScreenBrightnessFfiGetCachedBrightness(), 0.2);
+
+	ScreenBrightnessFfiTestHostStop();
+	CHECK(ScreenBrightnessFfiGetCachedBrightness() == -1);
+	CHECK(ScreenBrightnessFfiSetBrightnessAsync(0.5, OnCompleted, &completions) == SCREEN_BRIGHTNESS_FFI_UNAVAILABLE);
+}
+
+static void TestSystemChangeIsReported(void)
+{
+	Changes changes;
+	memset(&changes, 0, sizeof(changes));
+	CHECK(ScreenBrightnessFfiTestHostStart(0.5, 0) == SCREEN_BRIGHTNESS_FFI_OK);
+	CHECK(ScreenBrightnessFfiSubscribe(OnChanged, &changes) > 0);
+
+	/* without an override the application brightness follows the system brightness */
+	ScreenBrightnessFfiTestHostSetSystemBrightness(0.3);
+	ScreenBrightnessFfiTestHostWaitUntilIdle();
+
+	CHECK(changes.count == 1);
+	CHECK_NEAR(changes.last_brightness, 0.3);
+	CHECK_NEAR(ScreenBrightnessFfiGetCachedBrightness(), 0.3);
+	ScreenBrightnessFfiTestHostStop();
+}
+
+static void TestStateTableIsReadable(void)
+{
+	ScreenBrightnessFfiDisplayState state;
+	CHECK(ScreenBrightnessFfiTestHostStart(0.5, 0) == SCREEN_BRIGHTNESS_FFI_OK);
+	const ScreenBrightnessFfiStateTable* table = ScreenBrightnessFfiGetStateTable();
+	CHECK(table != NULL);
+	if (table == NULL)
+	{
+		ScreenBrightnessFfiTestHostStop();
+		return;
+	}
+
+	CHECK(table->layout_version == 1);
+	CHECK(table->slot_count == SCREEN_BRIGHTNESS_FFI_STATE_TABLE_SLOT_COUNT);
+	CHECK(ScreenBrightnessFfiReadDisplayState(0, &state) == SCREEN_BRIGHTNESS_FFI_OK);
+	CHECK(state.display != 0);
+	CHECK(state.system == 50 && state.current == 50 && state.target == 50);
+	CHECK(state.minimum == 0 && state.maximum == 100);
+	CHECK(state.owner == 0);
+	CHECK(ScreenBrightnessFfiReadDisplayState(1, &state) == SCREEN_BRIGHTNESS_FFI_UNAVAILABLE);
+	CHECK(ScreenBrightnessFfiReadDisplayState(SCREEN_BRIGHTNESS_FFI_STATE_TABLE_SLOT_COUNT, &state) == SCREEN_BRIGHTNESS_FFI_UNAVAILABLE);
+
+	const uint64_t generation = table->generation;
+	CHECK(ScreenBrightnessFfiSetBrightnessAsync(0.7, NULL, NULL) > 0);
+	ScreenBrightnessFfiTestHostWaitUntilIdle();
+
+	/* read in place, as Dart does through a Pointer, once the writer is idle */
+	CHECK(table->generation > generation);
+	CHECK(table->slots[0].sequence % 2 == 0);
+	CHECK(table->slots[0].current == 70 && table->slots[0].target == 70 && table->slots[0].system == 50);
+	CHECK(table->slots[0].owner != 0);
+	ScreenBrightnessFfiTestHostStop();
+}
+
+static void TestQueuedWritesAreCoalesced(void)
+{
+	/* one record per write, as the preempted ones complete on this thread while another runs on the platform thread */
+	Completions completions[6];
+	int64_t request_ids[6];
+	memset(completions, 0, sizeof(completions));
+
+	/* the first write keeps the platform thread busy while the others queue up */
+	CHECK(ScreenBrightnessFfiTestHostStart(0.5, 20000) == SCREEN_BRIGHTNESS_FFI_OK);
+	const int64_t write_count = ScreenBrightnessFfiTestHostGetWriteCount();
+	for (int index = 0; index < 6; ++index)
+	{
+		request_ids[index] = ScreenBrightnessFfiSetBrightnessAsync((index + 1) / 10.0, OnCompleted, &completions[index]);
+	}
+
+	ScreenBrightnessFfiTestHostWaitUntilIdle();
+
+	int preempted_count = 0;
+	for (int index = 0; index < 6; ++index)
+	{
+		CHECK(completions[index].count == 1);
+		CHECK(completions[index].last_request_id == request_ids[index]);
+		preempted_count += completions[index].preempted_count;
+	}
+
+	CHECK(preempted_count >= 4);
+	CHECK(completions[5].last_status == SCREEN_BRIGHTNESS_FFI_OK);
+	CHECK(ScreenBrightnessFfiTestHostGetWriteCount() - write_count <= 2);
+	CHECK_NEAR(ScreenBrightnessFfiTestHostGetDisplayBrightness(), 0.6);
+	ScreenBrightnessFfiTestHostStop();
+}
+
+static void TestSubmittedFramesDimTheDisplay(void)
+{
+	/* a white 4x2 frame, with 8 bytes of padding after each row */
+	uint8_t pixels[2 * 24];
+	memset(pixels, 0xff, sizeof(pixels));
+	Completions completions;
+	memset(&completions, 0, sizeof(completions));
+	ScreenBrightnessFfiContentAdaptiveDimmingConfig config;
+	memset(&config, 0, sizeof(config));
+	config.maximum_brightness = 1.0;
+	config.minimum_brightness = 0.6;
+	config.knee = 0.5;
+	config.maximum_luma = 0.9;
+	config.time_constant_ms = 500;
+	config.deadband = 0.01;
+	config.row_step = 1;
+
+	CHECK(ScreenBrightnessFfiSubmitFrame(pixels, 4, 2, 24, SCREEN_BRIGHTNESS_FFI_PIXEL_FORMAT_RGBA8, 0, OnCompleted, &completions) ==
+		SCREEN_BRIGHTNESS_FFI_UNAVAILABLE);
+	CHECK(ScreenBrightnessFfiTestHostStart(0.5, 0) == SCREEN_BRIGHTNESS_FFI_OK);
+	CHECK(ScreenBrightnessFfiConfigureContentAdaptiveDimming(&config) == SCREEN_BRIGHTNESS_FFI_OK);
+	CHECK(ScreenBrightnessFfiSubmitFrame(pixels, 4, 2, 8, SCREEN_BRIGHTNESS_FFI_PIXEL_FORMAT_RGBA8, 0, OnCompleted, &completions) ==
+		SCREEN_BRIGHTNESS_FFI_INVALID_FRAME);
+	CHECK(ScreenBrightnessFfiSubmitFrame(pixels, 4, 2, 24, 5, 0, OnCompleted, &completions) == SCREEN_BRIGHTNESS_FFI_INVALID_FRAME);
+
+	const int64_t request_id = ScreenBrightnessFfiSubmitFrame(pixels, 4, 2, 24, SCREEN_BRIGHTNESS_FFI_PIXEL_FORMAT_BGRA8, 0, OnCompleted, &completions);
+	CHECK(request_id > 0);
+	ScreenBrightnessFfiTestHostWaitUntilIdle();
+	CHECK(completions.count == 1 && completions.last_request_id == request_id && completions.last_status == SCREEN_BRIGHTNESS_FFI_OK);
+	CHECK_NEAR(ScreenBrightnessFfiTestHostGetDisplayBrightness(), 0.6);
+	CHECK(ScreenBrightnessFfiSubmitFrame(pixels, 4, 2, 24, SCREEN_BRIGHTNESS_FFI_PIXEL_FORMAT_BGRA8, 16000, OnCompleted, &completions) == 0);
+	ScreenBrightnessFfiTestHostStop();
+}
+
+static void TestWritesCanBeCancelledAndTimeOut(void)
+{
+	Completions running;
+	Completions cancelled;
+	Completions timed_out;
+	memset(&running, 0, sizeof(running));
+	memset(&cancelled, 0, sizeof(cancelled));
+	memset(&timed_out, 0, sizeof(timed_out));
+	CHECK(ScreenBrightnessFfiCancel(1) == SCREEN_BRIGHTNESS_FFI_UNAVAILABLE);
+
+	/* the first write keeps the platform thread busy, so the second one is still queued when it is cancelled */
+	CHECK(ScreenBrightnessFfiTestHostStart(0.5, 20000) == SCREEN_BRIGHTNESS_FFI_OK);
+	const int64_t running_id = ScreenBrightnessFfiSetBrightnessAsync(0.2, OnCompleted, &running);
+	const int64_t cancelled_id = ScreenBrightnessFfiSetBrightnessAsync(0.3, OnCompleted, &cancelled);
+	CHECK(ScreenBrightnessFfiCancel(cancelled_id) == 1);
+	ScreenBrightnessFfiTestHostWaitUntilIdle();
+	CHECK(cancelled.count == 1 && cancelled.last_request_id == cancelled_id);
+	CHECK(cancelled.last_status == SCREEN_BRIGHTNESS_FFI_CANCELLED || cancelled.last_status == SCREEN_BRIGHTNESS_FFI_OK);
+	CHECK(running.count == 1 && running.last_request_id == running_id);
+	CHECK(ScreenBrightnessFfiCancel(running_id) == 0);
+
+	/* applied after its deadline at the earliest */
+	const int64_t timed_out_id = ScreenBrightnessFfiSetBrightnessWithTimeoutAsync(0.9, 0, OnCompleted, &timed_out);
+	ScreenBrightnessFfiTestHostWaitUntilIdle();
+	CHECK(timed_out.count == 1 && timed_out.last_request_id == timed_out_id && timed_out.last_status == SCREEN_BRIGHTNESS_FFI_TIMED_OUT);
+	CHECK(ScreenBrightnessFfiTestHostGetDisplayBrightness() < 0.9);
+	ScreenBrightnessFfiTestHostStop();
+}
+
+int main(void)
+{
+	TestWithoutEngine();
+	TestSetAndSubscribe();
+	TestSystemChangeIsReported();
+	TestStateTableIsReadable();
+	TestQueuedWritesAreCoalesced();
+	TestSubmittedFramesDimTheDisplay();
+	TestWritesCanBeCancelledAndTimeOut();
+	if (failure_count == 0)
+	{
+		printf("ffi_test: all checks passed\n");
+	}
+
+	return failure_count;
+}
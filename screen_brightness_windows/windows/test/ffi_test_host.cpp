@@ -0,0 +1,249 @@
+#include "ffi_test_host.h"
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "screen_brightness_windows/brightness_bridge.h"
+#include "screen_brightness_windows/fake_monitor_backend.h"
+
+namespace
+{
+	using screen_brightness::BrightnessBridge;
+	using screen_brightness::BrightnessClient;
+	using screen_brightness::BrightnessService;
+	using screen_brightness::DisplayHandle;
+	using screen_brightness::DisplayInfo;
+	using screen_brightness::FakeMonitorBackend;
+	using screen_brightness::MonitorBackend;
+	using screen_brightness::MonitorStatus;
+	using screen_brightness::VcpCode;
+
+	// A fake display whose brightness writes take a while, like a DDC/CI monitor.
+	class FfiHostMonitorBackend final : public MonitorBackend
+	{
+	public:
+		FakeMonitorBackend fake;
+
+		std::chrono::microseconds latency{ 0 };
+
+		MonitorStatus EnumerateDisplays(std::vector<DisplayInfo>& displays) override
+		{
+			return fake.EnumerateDisplays(displays);
+		}
+
+		DisplayHandle GetPrimaryDisplay() override
+		{
+			return fake.GetPrimaryDisplay();
+		}
+
+		MonitorStatus GetScreenBrightness(const DisplayHandle display, long& minimum_screen_brightness, long& screen_brightness, long& maximum_screen_brightness) override
+		{
+			return fake.GetScreenBrightness(display, minimum_screen_brightness, screen_brightness, maximum_screen_brightness);
+		}
+
+		MonitorStatus SetScreenBrightness(const DisplayHandle display, const long screen_brightness) override
+		{
+			std::this_thread::sleep_for(latency);
+			return fake.SetScreenBrightness(display, screen_brightness);
+		}
+
+		MonitorStatus GetVcpFeature(const DisplayHandle display, const VcpCode code, unsigned long& current_value, unsigned long& maximum_value) override
+		{
+			return fake.GetVcpFeature(display, code, current_value, maximum_value);
+		}
+
+		MonitorStatus SetVcpFeature(const DisplayHandle display, const VcpCode code, const unsigned long value) override
+		{
+			return fake.SetVcpFeature(display, code, value);
+		}
+
+		MonitorStatus GetCapabilitiesString(const DisplayHandle display, std::string& capabilities) override
+		{
+			return fake.GetCapabilitiesString(display, capabilities);
+		}
+
+		MonitorStatus GetEdid(const DisplayHandle display, std::vector<std::uint8_t>& edid) override
+		{
+			return fake.GetEdid(display, edid);
+		}
+	};
+
+	// The platform thread: runs posted tasks in order, and owns the client and its bridge.
+	class FfiTestHost final
+	{
+	public:
+		FfiTestHost(const double system_brightness, const std::chrono::microseconds latency)
+		{
+			thread_ = std::thread([this, system_brightness, latency] { Run(system_brightness, latency); });
+			Call([] {});
+		}
+
+		~FfiTestHost()
+		{
+			Call([this]
+				{
+					BrightnessBridge::Uninstall(bridge_.get());
+					bridge_->Close();
+				});
+			{
+				std::lock_guard<std::mutex> lock(mutex_);
+				is_stopping_ = true;
+			}
+
+			condition_.notify_all();
+			thread_.join();
+		}
+
+		void Post(std::function<void()> task)
+		{
+			{
+				std::lock_guard<std::mutex> lock(mutex_);
+				tasks_.push_back(std::move(task));
+			}
+
+			condition_.notify_all();
+		}
+
+		// Runs the task on the platform thread and waits for it.
+		void Call(const std::function<void()>& task)
+		{
+			bool is_done = false;
+			Post([this, &task, &is_done]
+				{
+					task();
+					std::lock_guard<std::mutex> lock(mutex_);
+					is_done = true;
+					condition_.notify_all();
+				});
+			std::unique_lock<std::mutex> lock(mutex_);
+			condition_.wait(lock, [&is_done] { return is_done; });
+		}
+
+		void WaitUntilIdle()
+		{
+			std::unique_lock<std::mutex> lock(mutex_);
+			condition_.wait(lock, [this] { return tasks_.empty() && !is_running_task_; });
+		}
+
+		[[nodiscard]] BrightnessClient& client() { return *client_; }
+
+		[[nodiscard]] FakeMonitorBackend::Display& display() { return backend_->fake.GetDisplay(display_); }
+
+		[[nodiscard]] long write_count() const { return backend_->fake.set_count(); }
+
+	private:
+		std::thread thread_;
+
+		std::mutex mutex_;
+
+		std::condition_variable condition_;
+
+		std::deque<std::function<void()>> tasks_;
+
+		bool is_running_task_ = false;
+
+		bool is_stopping_ = false;
+
+		FfiHostMonitorBackend* backend_ = nullptr;
+
+		DisplayHandle display_ = 0;
+
+		std::unique_ptr<BrightnessClient> client_;
+
+		std::shared_ptr<BrightnessBridge> bridge_;
+
+		void Run(const double system_brightness, const std::chrono::microseconds latency)
+		{
+			auto backend = std::make_unique<FfiHostMonitorBackend>();
+			backend_ = backend.get();
+			backend->latency = latency;
+			display_ = backend->fake.AddDisplay({ "ffi", 0, static_cast<long>(system_brightness * 100), 100 });
+			auto service = std::make_shared<BrightnessService>(std::move(backend), screen_brightness::Clock::Steady(), std::chrono::milliseconds(0), false);
+			client_ = std::make_unique<BrightnessClient>(std::move(service));
+			client_->SetDisplay(display_);
+			client_->Initialize();
+
+			// what the plugin does with a window message
+			bridge_ = std::make_shared<BrightnessBridge>(*client_, [this] { Post([this] { bridge_->RunPendingTasks(); }); });
+			client_->SetApplicationScreenBrightnessChangedCallback([this](const double brightness) { bridge_->OnBrightnessChanged(brightness); });
+			BrightnessBridge::Install(bridge_);
+
+			std::unique_lock<std::mutex> lock(mutex_);
+			while (true)
+			{
+				condition_.wait(lock, [this] { return is_stopping_ || !tasks_.empty(); });
+				if (tasks_.empty())
+				{
+					break;
+				}
+
+				std::function<void()> task = std::move(tasks_.front());
+				tasks_.pop_front();
+				is_running_task_ = true;
+				lock.unlock();
+				task();
+				lock.lock();
+				is_running_task_ = false;
+				condition_.notify_all();
+			}
+
+			lock.unlock();
+			client_.reset();
+		}
+	};
+
+	std::unique_ptr<FfiTestHost> host;
+}
+
+int32_t ScreenBrightnessFfiTestHostStart(const double system_brightness, const int64_t latency_microseconds)
+{
+	if (host != nullptr)
+	{
+		return SCREEN_BRIGHTNESS_FFI_UNAVAILABLE;
+	}
+
+	host = std::make_unique<FfiTestHost>(system_brightness, std::chrono::microseconds(latency_microseconds));
+	return SCREEN_BRIGHTNESS_FFI_OK;
+}
+
+void ScreenBrightnessFfiTestHostStop(void)
+{
+	host.reset();
+}
+
+void ScreenBrightnessFfiTestHostWaitUntilIdle(void)
+{
+	host->WaitUntilIdle();
+}
+
+void ScreenBrightnessFfiTestHostSetSystemBrightness(const double brightness)
+{
+	host->Post([brightness] { (void)host->client().SetSystemScreenBrightness(brightness); });
+}
+
+double ScreenBrightnessFfiTestHostGetDisplayBrightness(void)
+{
+	double brightness = 0;
+	host->Call([&brightness]
+		{
+			const FakeMonitorBackend::Display& display = host->display();
+			brightness = static_cast<double>(display.brightness - display.minimum_brightness) / (display.maximum_brightness - display.minimum_brightness);
+		});
+	return brightness;
+}
+
+int64_t ScreenBrightnessFfiTestHostGetWriteCount(void)
+{
+	int64_t write_count = 0;
+	host->Call([&write_count] { write_count = host->write_count(); });
+	return write_count;
+}
@@ -0,0 +1,36 @@
+#ifndef FLUTTER_PLUGIN_SCREEN_BRIGHTNESS_WINDOWS_PLUGIN_FFI_TEST_HOST_H_
+#define FLUTTER_PLUGIN_SCREEN_BRIGHTNESS_WINDOWS_PLUGIN_FFI_TEST_HOST_H_
+
+/*
+ * Stands in for the plugin where there is no Flutter engine: a fake display whose client lives on a thread which
+ * plays the platform thread, with its bridge installed for the C ABI.
+ */
+
+#include "screen_brightness_windows/screen_brightness_ffi.h"
+
+#if defined(__cplusplus)
+extern "C" {
+#endif
+
+	/* The display starts at the system brightness; each write to it takes latency_microseconds. */
+	SCREEN_BRIGHTNESS_FFI_EXPORT int32_t ScreenBrightnessFfiTestHostStart(double system_brightness, int64_t latency_microseconds);
+
+	SCREEN_BRIGHTNESS_FFI_EXPORT void ScreenBrightnessFfiTestHostStop(void);
+
+	/* Returns once the platform thread has nothing left to do. */
+	SCREEN_BRIGHTNESS_FFI_EXPORT void ScreenBrightnessFfiTestHostWaitUntilIdle(void);
+
+	/* Changes the system brightness on the platform thread, as the user would. */
+	SCREEN_BRIGHTNESS_FFI_EXPORT void ScreenBrightnessFfiTestHostSetSystemBrightness(double brightness);
+
+	/* The brightness the display shows, 0.0 to 1.0. */
+	SCREEN_BRIGHTNESS_FFI_EXPORT double ScreenBrightnessFfiTestHostGetDisplayBrightness(void);
+
+	/* Number of brightness writes which reached the display. */
+	SCREEN_BRIGHTNESS_FFI_EXPORT int64_t ScreenBrightnessFfiTestHostGetWriteCount(void);
+
+#if defined(__cplusplus)
+}  // extern "C"
+#endif
+
+#endif  // FLUTTER_PLUGIN_SCREEN_BRIGHTNESS_WINDOWS_PLUGIN_FFI_TEST_HOST_H_
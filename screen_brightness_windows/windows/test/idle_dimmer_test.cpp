@@ -0,0 +1,247 @@
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "screen_brightness_windows/brightness_service.h"
+#include "screen_brightness_windows/fake_monitor_backend.h"
+#include "screen_brightness_windows/idle_dimmer.h"
+#include "screen_brightness_windows/input_activity.h"
+
+namespace screen_brightness
+{
+	namespace test
+	{
+		using std::chrono::milliseconds;
+		using std::chrono::seconds;
+
+		// Brightness writes take time of the test's clock, like a DDC/CI monitor does of real time.
+		class IdleTestMonitorBackend final : public MonitorBackend
+		{
+		public:
+			IdleTestMonitorBackend(ManualClock& clock, const Clock::duration latency) : clock_(clock), latency_(latency)
+			{
+			}
+
+			FakeMonitorBackend fake;
+
+			MonitorStatus EnumerateDisplays(std::vector<DisplayInfo>& displays) override
+			{
+				return fake.EnumerateDisplays(displays);
+			}
+
+			DisplayHandle GetPrimaryDisplay() override
+			{
+				return fake.GetPrimaryDisplay();
+			}
+
+			MonitorStatus GetScreenBrightness(const DisplayHandle display, long& minimum_screen_brightness, long& screen_brightness, long& maximum_screen_brightness) override
+			{
+				return fake.GetScreenBrightness(display, minimum_screen_brightness, screen_brightness, maximum_screen_brightness);
+			}
+
+			MonitorStatus SetScreenBrightness(const DisplayHandle display, const long screen_brightness) override
+			{
+				clock_.Advance(latency_);
+				return fake.SetScreenBrightness(display, screen_brightness);
+			}
+
+			MonitorStatus GetVcpFeature(const DisplayHandle display, const VcpCode code, unsigned long& current_value, unsigned long& maximum_value) override
+			{
+				return fake.GetVcpFeature(display, code, current_value, maximum_value);
+			}
+
+			MonitorStatus SetVcpFeature(const DisplayHandle display, const VcpCode code, const unsigned long value) override
+			{
+				return fake.SetVcpFeature(display, code, value);
+			}
+
+			MonitorStatus GetCapabilitiesString(const DisplayHandle display, std::string& capabilities) override
+			{
+				return fake.GetCapabilitiesString(display, capabilities);
+			}
+
+			MonitorStatus GetEdid(const DisplayHandle display, std::vector<std::uint8_t>& edid) override
+			{
+				return fake.GetEdid(display, edid);
+			}
+
+		private:
+			ManualClock& clock_;
+
+			Clock::duration latency_;
+		};
+
+		// The plugin's timer: sleeps until the time Poll returns, and polls again.
+		class IdleDimmerTest : public ::testing::Test
+		{
+		protected:
+			ManualClock clock_;
+
+			ManualInputActivitySource input_;
+
+			IdleTestMonitorBackend* backend_ = nullptr;
+
+			DisplayHandle display_ = 0;
+
+			std::unique_ptr<BrightnessClient> client_;
+
+			std::unique_ptr<IdleDimmer> dimmer_;
+
+			Clock::time_point next_poll_time_{};
+
+			void Start(const Clock::duration write_latency)
+			{
+				auto backend = std::make_unique<IdleTestMonitorBackend>(clock_, write_latency);
+				backend_ = backend.get();
+				display_ = backend->fake.AddDisplay({ "idle", 0, 80, 100 });
+				client_ = std::make_unique<BrightnessClient>(std::make_shared<BrightnessService>(std::move(backend), clock_, milliseconds(0), false));
+				client_->SetDisplay(display_);
+				client_->Initialize();
+
+				IdleDimmingConfig config;
+				config.idle_timeout = seconds(60);
+				config.dimmed_brightness = 0.2;
+				config.dim_duration = seconds(1);
+				config.restore_duration = milliseconds(250);
+				dimmer_ = std::make_unique<IdleDimmer>(*client_, input_, clock_);
+				dimmer_->SetConfig(config);
+				input_.OnInput(clock_.Now());
+				dimmer_->SetEnabled(true);
+				next_poll_time_ = dimmer_->Poll();
+			}
+
+			// Polls at the requested times until the state changes, returning the brightness after every poll.
+			std::vector<long> RunUntilStateChanges()
+			{
+				const IdleState state = dimmer_->state();
+				std::vector<long> brightness;
+				while (dimmer_->state() == state)
+				{
+					clock_.SleepUntil(next_poll_time_);
+					next_poll_time_ = dimmer_->Poll();
+					brightness.push_back(backend_->fake.GetDisplay(display_).brightness);
+				}
+
+				return brightness;
+			}
+
+			long brightness()
+			{
+				return backend_->fake.GetDisplay(display_).brightness;
+			}
+		};
+
+		TEST_F(IdleDimmerTest, DimsAfterTheTimeoutAndRestoresOnInput)
+		{
+			Start(milliseconds(0));
+			const Clock::time_point start = clock_.Now();
+			EXPECT_EQ(next_poll_time_, start + seconds(60));
+
+			// input in between only moves the deadline when it is reached
+			clock_.Advance(seconds(30));
+			input_.OnInput(clock_.Now());
+			const long write_count = backend_->fake.set_count();
+			clock_.SleepUntil(next_poll_time_);
+			next_poll_time_ = dimmer_->Poll();
+			EXPECT_EQ(next_poll_time_, start + seconds(90));
+			EXPECT_EQ(dimmer_->state(), IdleState::kActive);
+			EXPECT_EQ(backend_->fake.set_count(), write_count);
+
+			clock_.SleepUntil(next_poll_time_);
+			next_poll_time_ = dimmer_->Poll();
+			EXPECT_EQ(dimmer_->state(), IdleState::kDimming);
+			const std::vector<long> dimming = RunUntilStateChanges();
+			EXPECT_EQ(dimmer_->state(), IdleState::kDimmed);
+			EXPECT_EQ(brightness(), 20);
+			EXPECT_LE(clock_.Now() - (start + seconds(90)), seconds(1));
+			for (size_t index = 1; index < dimming.size(); ++index)
+			{
+				EXPECT_LE(dimming[index], dimming[index - 1]);
+			}
+
+			// dimmed, the display is left alone
+			const long dimmed_write_count = backend_->fake.set_count();
+			EXPECT_LE(dimmed_write_count - write_count, 1000 / 16 + 1);
+			for (int poll = 0; poll < 10; ++poll)
+			{
+				clock_.SleepUntil(next_poll_time_);
+				next_poll_time_ = dimmer_->Poll();
+			}
+
+			EXPECT_EQ(dimmer_->state(), IdleState::kDimmed);
+			EXPECT_EQ(backend_->fake.set_count(), dimmed_write_count);
+
+			input_.OnInput(clock_.Now());
+			clock_.SleepUntil(next_poll_time_);
+			next_poll_time_ = dimmer_->Poll();
+			EXPECT_EQ(dimmer_->state(), IdleState::kRestoring);
+			(void)RunUntilStateChanges();
+			EXPECT_EQ(dimmer_->state(), IdleState::kActive);
+			EXPECT_EQ(brightness(), 80);
+			EXPECT_FALSE(client_->HasApplicationScreenBrightnessChanged());
+			EXPECT_EQ(next_poll_time_, clock_.Now() + seconds(60));
+		}
+
+		TEST_F(IdleDimmerTest, RestoresTheOverrideWhenDisabled)
+		{
+			Start(milliseconds(0));
+			ASSERT_EQ(client_->SetApplicationScreenBrightness(0.7), MonitorStatus::kOk);
+			clock_.SleepUntil(next_poll_time_);
+			next_poll_time_ = dimmer_->Poll();
+			(void)RunUntilStateChanges();
+			ASSERT_EQ(dimmer_->state(), IdleState::kDimmed);
+			EXPECT_EQ(brightness(), 20);
+
+			dimmer_->SetEnabled(false);
+			EXPECT_EQ(dimmer_->state(), IdleState::kActive);
+			EXPECT_EQ(brightness(), 70);
+			EXPECT_DOUBLE_EQ(client_->GetApplicationScreenBrightnessOverride(), 0.7);
+			EXPECT_EQ(dimmer_->Poll(), Clock::time_point::max());
+		}
+
+		TEST_F(IdleDimmerTest, GivesWayToABrightnessSetWhileDimmed)
+		{
+			Start(milliseconds(0));
+			clock_.SleepUntil(next_poll_time_);
+			next_poll_time_ = dimmer_->Poll();
+			(void)RunUntilStateChanges();
+			ASSERT_EQ(dimmer_->state(), IdleState::kDimmed);
+
+			// e.g. setApplicationScreenBrightness from Dart
+			ASSERT_EQ(client_->SetApplicationScreenBrightness(0.5), MonitorStatus::kOk);
+			clock_.SleepUntil(next_poll_time_);
+			next_poll_time_ = dimmer_->Poll();
+			EXPECT_EQ(dimmer_->state(), IdleState::kActive);
+			EXPECT_EQ(brightness(), 50);
+
+			// without input it dims again after another timeout, and restores the new value
+			EXPECT_EQ(next_poll_time_, clock_.Now() + seconds(60));
+			clock_.SleepUntil(next_poll_time_);
+			next_poll_time_ = dimmer_->Poll();
+			(void)RunUntilStateChanges();
+			EXPECT_EQ(brightness(), 20);
+			input_.OnInput(clock_.Now());
+			clock_.SleepUntil(next_poll_time_);
+			next_poll_time_ = dimmer_->Poll();
+			(void)RunUntilStateChanges();
+			EXPECT_EQ(brightness(), 50);
+		}
+
+		TEST_F(IdleDimmerTest, StepsAtTheCommandPeriodOfASlowMonitor)
+		{
+			Start(milliseconds(100));
+			clock_.SleepUntil(next_poll_time_);
+			const long write_count = backend_->fake.set_count();
+			next_poll_time_ = dimmer_->Poll();
+			(void)RunUntilStateChanges();
+			EXPECT_EQ(brightness(), 20);
+
+			// a 100 ms write leaves room for about 10 steps in a second
+			EXPECT_LE(backend_->fake.set_count() - write_count, 12);
+			EXPECT_GE(backend_->fake.set_count() - write_count, 5);
+		}
+	}
+}
@@ -0,0 +1,205 @@
+#include <gtest/gtest.h>
+
+#include <cstdint>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include "screen_brightness_windows/iio_ambient_light_source.h"
+
+namespace screen_brightness
+{
+	namespace test
+	{
+		namespace
+		{
+			void WriteFile(const std::filesystem::path& path, const std::string& content)
+			{
+				std::ofstream stream(path);
+				stream << content;
+			}
+
+			std::string ReadFile(const std::filesystem::path& path)
+			{
+				std::ifstream stream(path);
+				std::string content;
+				stream >> content;
+				return content;
+			}
+		}
+
+		// A fake /sys/bus/iio/devices and /dev. The character device of a buffered sensor is a regular file of records.
+		class IioAmbientLightSourceTest : public ::testing::Test
+		{
+		protected:
+			std::filesystem::path root_;
+
+			std::filesystem::path devices_;
+
+			std::filesystem::path device_root_;
+
+			void SetUp() override
+			{
+				std::string pattern = (std::filesystem::temp_directory_path() / "iio_XXXXXX").string();
+				root_ = mkdtemp(pattern.data());
+				devices_ = root_ / "devices";
+				device_root_ = root_ / "dev";
+				std::filesystem::create_directory(devices_);
+				std::filesystem::create_directory(device_root_);
+
+				// an accelerometer sorts first and is skipped
+				const auto accelerometer = devices_ / "iio:device0";
+				std::filesystem::create_directory(accelerometer);
+				WriteFile(accelerometer / "in_accel_x_raw", "12");
+			}
+
+			void TearDown() override
+			{
+				std::filesystem::remove_all(root_);
+			}
+
+			std::filesystem::path AddLightSensor(const std::string& raw, const std::string& scale)
+			{
+				const auto device = devices_ / "iio:device1";
+				std::filesystem::create_directory(device);
+				WriteFile(device / "in_illuminance_raw", raw);
+				WriteFile(device / "in_illuminance_scale", scale);
+				return device;
+			}
+
+			// Illuminance as le:u16/16>>0 at index 0 and a timestamp as le:s64/64>>0 at index 1, 16 byte records.
+			std::filesystem::path AddBufferedLightSensor(const std::vector<std::uint16_t>& samples)
+			{
+				const auto device = AddLightSensor("0", "0.5");
+				const auto scan_elements = device / "scan_elements";
+				std::filesystem::create_directory(scan_elements);
+				std::filesystem::create_directory(device / "buffer");
+				WriteFile(device / "buffer" / "enable", "0");
+				WriteFile(scan_elements / "in_illuminance_en", "0");
+				WriteFile(scan_elements / "in_illuminance_index", "0");
+				WriteFile(scan_elements / "in_illuminance_type", "le:u16/16>>0\n");
+				WriteFile(scan_elements / "in_timestamp_en", "1");
+				WriteFile(scan_elements / "in_timestamp_index", "1");
+				WriteFile(scan_elements / "in_timestamp_type", "le:s64/64>>0\n");
+
+				std::ofstream stream(device_root_ / "iio:device1", std::ios::binary);
+				for (const std::uint16_t sample : samples)
+				{
+					unsigned char record[16] = {};
+					record[0] = static_cast<unsigned char>(sample & 0xFF);
+					record[1] = static_cast<unsigned char>(sample >> 8);
+					record[8] = 0xFF;
+					stream.write(reinterpret_cast<const char*>(record), sizeof(record));
+				}
+
+				return device;
+			}
+		};
+
+		TEST_F(IioAmbientLightSourceTest, ScalesRawReadings)
+		{
+			(void)AddLightSensor("240", "0.25");
+			IioAmbientLightSource source(devices_.string(), device_root_.string());
+			ASSERT_TRUE(source.is_open());
+			EXPECT_EQ(source.device_name(), "iio:device1");
+			EXPECT_FALSE(source.is_buffered());
+
+			double lux = 0;
+			ASSERT_TRUE(source.ReadIlluminance(lux));
+			EXPECT_DOUBLE_EQ(lux, 60);
+
+			WriteFile(devices_ / "iio:device1" / "in_illuminance_raw", "400");
+			ASSERT_TRUE(source.ReadIlluminance(lux));
+			EXPECT_DOUBLE_EQ(lux, 100);
+			EXPECT_EQ(source.sample_count(), 2u);
+		}
+
+		TEST_F(IioAmbientLightSourceTest, PrefersProcessedReadings)
+		{
+			const auto device = AddLightSensor("240", "0.25");
+			WriteFile(device / "in_illuminance_input", "321.5");
+			IioAmbientLightSource source(devices_.string(), device_root_.string());
+			double lux = 0;
+			ASSERT_TRUE(source.ReadIlluminance(lux));
+			EXPECT_DOUBLE_EQ(lux, 321.5);
+		}
+
+		TEST_F(IioAmbientLightSourceTest, FindsIndexedChannels)
+		{
+			const auto device = devices_ / "iio:device2";
+			std::filesystem::create_directory(device);
+			WriteFile(device / "in_illuminance0_input", "12");
+			IioAmbientLightSource source(devices_.string(), device_root_.string());
+			EXPECT_EQ(source.device_name(), "iio:device2");
+			double lux = 0;
+			ASSERT_TRUE(source.ReadIlluminance(lux));
+			EXPECT_DOUBLE_EQ(lux, 12);
+		}
+
+		TEST_F(IioAmbientLightSourceTest, HasNoReadingsWithoutASensor)
+		{
+			IioAmbientLightSource source(devices_.string(), device_root_.string());
+			EXPECT_FALSE(source.is_open());
+			double lux = 0;
+			EXPECT_FALSE(source.ReadIlluminance(lux));
+			EXPECT_EQ(source.sample_count(), 0u);
+		}
+
+		TEST_F(IioAmbientLightSourceTest, DrainsTheBuffer)
+		{
+			const auto device = AddBufferedLightSensor({ 100, 200, 300 });
+			{
+				IioAmbientLightSource source(devices_.string(), device_root_.string());
+				ASSERT_TRUE(source.is_buffered());
+				EXPECT_EQ(ReadFile(device / "buffer" / "enable"), "1");
+				EXPECT_EQ(ReadFile(device / "scan_elements" / "in_illuminance_en"), "1");
+
+				// the mean of the samples since the last read, scaled
+				double lux = 0;
+				ASSERT_TRUE(source.ReadIlluminance(lux));
+				EXPECT_DOUBLE_EQ(lux, 100);
+				EXPECT_EQ(source.sample_count(), 3u);
+				EXPECT_FALSE(source.ReadIlluminance(lux));
+			}
+
+			EXPECT_EQ(ReadFile(device / "buffer" / "enable"), "0");
+			EXPECT_EQ(ReadFile(device / "scan_elements" / "in_illuminance_en"), "0");
+		}
+
+		TEST_F(IioAmbientLightSourceTest, DrainsBuffersLargerThanOneRead)
+		{
+			(void)AddBufferedLightSensor(std::vector<std::uint16_t>(100, 64));
+			IioAmbientLightSource source(devices_.string(), device_root_.string());
+			double lux = 0;
+			ASSERT_TRUE(source.ReadIlluminance(lux));
+			EXPECT_DOUBLE_EQ(lux, 32);
+			EXPECT_EQ(source.sample_count(), 100u);
+		}
+
+		TEST_F(IioAmbientLightSourceTest, LeavesABufferInUseAlone)
+		{
+			const auto device = AddBufferedLightSensor({ 100 });
+			WriteFile(device / "buffer" / "enable", "1");
+			WriteFile(device / "in_illuminance_raw", "8");
+			IioAmbientLightSource source(devices_.string(), device_root_.string());
+			EXPECT_FALSE(source.is_buffered());
+			EXPECT_EQ(ReadFile(device / "scan_elements" / "in_illuminance_en"), "0");
+
+			double lux = 0;
+			ASSERT_TRUE(source.ReadIlluminance(lux));
+			EXPECT_DOUBLE_EQ(lux, 4);
+		}
+
+		TEST_F(IioAmbientLightSourceTest, PollsWhenTheCharacterDeviceIsMissing)
+		{
+			const auto device = AddBufferedLightSensor({});
+			std::filesystem::remove(device_root_ / "iio:device1");
+			IioAmbientLightSource source(devices_.string(), device_root_.string());
+			EXPECT_FALSE(source.is_buffered());
+			EXPECT_EQ(ReadFile(device / "buffer" / "enable"), "0");
+			EXPECT_EQ(ReadFile(device / "scan_elements" / "in_illuminance_en"), "0");
+		}
+	}
+}
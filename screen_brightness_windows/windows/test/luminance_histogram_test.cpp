@@ -0,0 +1,214 @@
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <random>
+#include <utility>
+#include <vector>
+
+#include "screen_brightness_windows/brightness_bridge.h"
+#include "screen_brightness_windows/content_adaptive_dimmer.h"
+#include "screen_brightness_windows/fake_monitor_backend.h"
+#include "screen_brightness_windows/luminance_histogram.h"
+
+namespace screen_brightness
+{
+	namespace test
+	{
+		using std::chrono::milliseconds;
+
+		constexpr LuminanceKernel kKernels[] = { LuminanceKernel::kScalar, LuminanceKernel::kSse2, LuminanceKernel::kAvx2, LuminanceKernel::kNeon };
+
+		// A frame of one colour, with padding after each row.
+		std::vector<std::uint8_t> MakeSolidFrame(const std::size_t width, const std::size_t height, const std::size_t stride,
+			const std::uint8_t first, const std::uint8_t second, const std::uint8_t third)
+		{
+			std::vector<std::uint8_t> pixels(stride * height, 0xcd);
+			for (std::size_t row = 0; row < height; ++row)
+			{
+				for (std::size_t column = 0; column < width; ++column)
+				{
+					std::uint8_t* pixel = &pixels[row * stride + column * 4];
+					pixel[0] = first;
+					pixel[1] = second;
+					pixel[2] = third;
+					pixel[3] = 0xff;
+				}
+			}
+
+			return pixels;
+		}
+
+		TEST(LuminanceHistogramTest, EverySupportedKernelMatchesTheScalarOne)
+		{
+			std::mt19937 random(46);
+			std::uniform_int_distribution<int> byte(0, 255);
+
+			// widths around the vector widths of the kernels, and more than a chunk
+			for (const std::size_t width : { 1u, 15u, 16u, 17u, 31u, 33u, 63u, 1027u, 3840u })
+			{
+				const std::size_t height = 9;
+				const std::size_t stride = width * 4 + 12;
+				std::vector<std::uint8_t> pixels(stride * height);
+				for (std::uint8_t& value : pixels)
+				{
+					value = static_cast<std::uint8_t>(byte(random));
+				}
+
+				for (const PixelFormat format : { PixelFormat::kRgba8, PixelFormat::kBgra8 })
+				{
+					const FrameView frame{ pixels.data(), width, height, stride, format };
+					LuminanceHistogram expected;
+					ASSERT_TRUE(ComputeLuminanceHistogram(frame, 1, expected, LuminanceKernel::kScalar));
+					EXPECT_EQ(expected.sample_count, width * height);
+					for (const LuminanceKernel kernel : kKernels)
+					{
+						if (!IsLuminanceKernelSupported(kernel))
+						{
+							continue;
+						}
+
+						LuminanceHistogram histogram;
+						ASSERT_TRUE(ComputeLuminanceHistogram(frame, 1, histogram, kernel));
+						EXPECT_EQ(histogram.sample_count, expected.sample_count);
+						for (std::size_t bin = 0; bin < LuminanceHistogram::kBinCount; ++bin)
+						{
+							ASSERT_EQ(histogram.bins[bin], expected.bins[bin]) << GetLuminanceKernelName(kernel) << " width " << width << " bin " << bin;
+						}
+					}
+				}
+			}
+
+			EXPECT_TRUE(IsLuminanceKernelSupported(GetBestLuminanceKernel()));
+		}
+
+		TEST(LuminanceHistogramTest, WeighsTheChannelsOfTheFormat)
+		{
+			const std::vector<std::uint8_t> white = MakeSolidFrame(20, 4, 80, 255, 255, 255);
+			const std::vector<std::uint8_t> black = MakeSolidFrame(20, 4, 80, 0, 0, 0);
+			const std::vector<std::uint8_t> red_first = MakeSolidFrame(20, 4, 80, 255, 0, 0);
+			LuminanceHistogram histogram;
+
+			ASSERT_TRUE(ComputeLuminanceHistogram({ white.data(), 20, 4, 80, PixelFormat::kRgba8 }, 1, histogram));
+			EXPECT_EQ(histogram.bins[255], 80u);
+			EXPECT_DOUBLE_EQ(histogram.GetMean(), 1.0);
+			ASSERT_TRUE(ComputeLuminanceHistogram({ black.data(), 20, 4, 80, PixelFormat::kBgra8 }, 1, histogram));
+			EXPECT_EQ(histogram.bins[0], 80u);
+			EXPECT_DOUBLE_EQ(histogram.GetMean(), 0.0);
+
+			// red in RGBA, and blue in BGRA
+			ASSERT_TRUE(ComputeLuminanceHistogram({ red_first.data(), 20, 4, 80, PixelFormat::kRgba8 }, 1, histogram));
+			EXPECT_EQ(histogram.bins[53], 80u);
+			ASSERT_TRUE(ComputeLuminanceHistogram({ red_first.data(), 20, 4, 80, PixelFormat::kBgra8 }, 1, histogram));
+			EXPECT_EQ(histogram.bins[18], 80u);
+		}
+
+		TEST(LuminanceHistogramTest, SamplesEveryRowStepthRow)
+		{
+			// the top half is white, the bottom half black
+			std::vector<std::uint8_t> pixels = MakeSolidFrame(10, 10, 40, 0, 0, 0);
+			const std::vector<std::uint8_t> white = MakeSolidFrame(10, 5, 40, 255, 255, 255);
+			std::copy(white.begin(), white.end(), pixels.begin());
+			const FrameView frame{ pixels.data(), 10, 10, 40, PixelFormat::kRgba8 };
+			LuminanceHistogram histogram;
+
+			ASSERT_TRUE(ComputeLuminanceHistogram(frame, 3, histogram));
+			EXPECT_EQ(histogram.sample_count, 40u);
+			EXPECT_EQ(histogram.bins[255], 20u);
+			EXPECT_DOUBLE_EQ(histogram.GetPercentile(0.5), 0.0);
+			EXPECT_DOUBLE_EQ(histogram.GetPercentile(0.9), 1.0);
+
+			EXPECT_FALSE(ComputeLuminanceHistogram(frame, 0, histogram));
+			EXPECT_FALSE(ComputeLuminanceHistogram({ pixels.data(), 10, 10, 39, PixelFormat::kRgba8 }, 1, histogram));
+			EXPECT_FALSE(ComputeLuminanceHistogram({ nullptr, 10, 10, 40, PixelFormat::kRgba8 }, 1, histogram));
+			EXPECT_EQ(histogram.sample_count, 0u);
+		}
+
+		LuminanceHistogram MakeUniformHistogram(const std::uint8_t luma)
+		{
+			LuminanceHistogram histogram;
+			histogram.bins[luma] = 100;
+			histogram.sample_count = 100;
+			return histogram;
+		}
+
+		TEST(ContentAdaptiveDimmerTest, SmoothsTheTargetOverTime)
+		{
+			ContentAdaptiveDimmingConfig config;
+			config.maximum_brightness = 1.0;
+			config.minimum_brightness = 0.5;
+			config.knee = 0.5;
+			config.maximum_luma = 1.0;
+			config.time_constant = milliseconds(100);
+			config.deadband = 0.02;
+			ContentAdaptiveDimmer dimmer(config);
+			const LuminanceHistogram dark = MakeUniformHistogram(0);
+			const LuminanceHistogram white = MakeUniformHistogram(255);
+			EXPECT_DOUBLE_EQ(dimmer.GetFrameTarget(dark), 1.0);
+			EXPECT_DOUBLE_EQ(dimmer.GetFrameTarget(white), 0.5);
+			EXPECT_NEAR(dimmer.GetFrameTarget(MakeUniformHistogram(191)), 0.75, 0.01);
+
+			Clock::time_point time{};
+			double brightness = 0;
+			ASSERT_TRUE(dimmer.Update(dark, time, brightness));
+			EXPECT_DOUBLE_EQ(brightness, 1.0);
+
+			// one time constant covers 63% of the step
+			time += milliseconds(100);
+			ASSERT_TRUE(dimmer.Update(white, time, brightness));
+			EXPECT_NEAR(brightness, 1.0 - 0.5 * 0.632, 0.001);
+
+			// 1 ms later the brightness has moved by less than the deadband
+			time += milliseconds(1);
+			EXPECT_FALSE(dimmer.Update(white, time, brightness));
+
+			// the same time in many frames gets as far as in one
+			ContentAdaptiveDimmer frame_by_frame(config);
+			ASSERT_TRUE(frame_by_frame.Update(dark, Clock::time_point{}, brightness));
+			for (int frame = 1; frame <= 10; ++frame)
+			{
+				(void)frame_by_frame.Update(white, Clock::time_point{} + milliseconds(10 * frame), brightness);
+			}
+
+			EXPECT_NEAR(frame_by_frame.smoothed_brightness(), 1.0 - 0.5 * 0.632, 0.001);
+		}
+
+		TEST(ContentAdaptiveDimmerTest, AppliesTheDimmedBrightnessThroughTheBridge)
+		{
+			auto backend = std::make_unique<FakeMonitorBackend>();
+			FakeMonitorBackend& fake = *backend;
+			const DisplayHandle display = backend->AddDisplay({ "dimmed", 0, 100, 100 });
+			BrightnessClient client(std::make_shared<BrightnessService>(std::move(backend), Clock::Steady(), milliseconds(0), false));
+			client.SetDisplay(display);
+			client.Initialize();
+			int wake_count = 0;
+			const auto bridge = std::make_shared<BrightnessBridge>(client, [&wake_count] { ++wake_count; });
+
+			ContentAdaptiveDimmingConfig config;
+			config.minimum_brightness = 0.6;
+			config.knee = 0.5;
+			config.maximum_luma = 0.9;
+			config.row_step = 2;
+			bridge->SetContentAdaptiveDimming(config);
+
+			const std::vector<std::uint8_t> white = MakeSolidFrame(64, 8, 256, 255, 255, 255);
+			std::vector<std::pair<std::int64_t, MonitorStatus>> completions;
+			const std::int64_t request_id = bridge->SubmitFrame({ white.data(), 64, 8, 256, PixelFormat::kBgra8 }, Clock::time_point{},
+				[&completions](const std::int64_t id, const MonitorStatus status) { completions.emplace_back(id, status); });
+			ASSERT_GT(request_id, 0);
+			EXPECT_EQ(wake_count, 1);
+			bridge->RunPendingTasks();
+			ASSERT_EQ(completions.size(), 1u);
+			EXPECT_EQ(completions[0].first, request_id);
+			EXPECT_EQ(completions[0].second, MonitorStatus::kOk);
+			EXPECT_EQ(fake.GetDisplay(display).brightness, 60);
+
+			// the same content does not write again
+			EXPECT_EQ(bridge->SubmitFrame({ white.data(), 64, 8, 256, PixelFormat::kBgra8 }, Clock::time_point{} + milliseconds(16), nullptr), 0);
+			EXPECT_EQ(bridge->SubmitFrame({ white.data(), 64, 8, 100, PixelFormat::kBgra8 }, Clock::time_point{} + milliseconds(32), nullptr),
+				BrightnessBridge::kInvalidFrame);
+			EXPECT_EQ(wake_count, 1);
+		}
+	}
+}
@@ -0,0 +1,281 @@
+#include <gtest/gtest.h>
+
+#include <random>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "screen_brightness_windows/mccs_capabilities.h"
+
+namespace screen_brightness
+{
+	namespace test
+	{
+		namespace
+		{
+			std::vector<VcpCode> GetCodes(const MccsCapabilities& capabilities)
+			{
+				std::vector<VcpCode> codes;
+				for (int code = 0; code < 256; ++code)
+				{
+					if (capabilities.IsSupported(static_cast<VcpCode>(code)))
+					{
+						codes.push_back(static_cast<VcpCode>(code));
+					}
+				}
+
+				return codes;
+			}
+
+			std::vector<int> GetValues(const MccsCapabilities& capabilities, const VcpCode code)
+			{
+				const VcpValueList values = capabilities.GetAllowedValues(code);
+				return std::vector<int>(values.begin(), values.end());
+			}
+
+			// Capability strings in the shapes monitors return them, including the malformed ones.
+			const std::vector<std::string> kCorpus = {
+				"(prot(monitor)type(lcd)vcp(02 04 10 12 14(05 08 0B) 60(0F 11)))",
+				"(prot(monitor)type(LCD)model(U2720Q)cmds(01 02 03 07 0C E3 F3)vcp(02 04 05 08 10 12 14(05 08 0B 0C) 16 18 1A 52 60( 0F 10 11 12) AA(01 02 04) AC AE B2 B6 C6 C8 C9 CC(02 03 04 05 06 09 0A 0D 0E) D6(01 04 05) DC(00 03 05) DF E0 E1 E2(00 1D 02 04 0E 12 14) F0(0C) F1 F2 FD)mswhql(1)asset_eep(40)mccs_ver(2.1))",
+				"prot(monitor)type(lcd)vcp(10 12 60(01 03 0F))mccs_ver(2.2)",
+				"(prot(monitor)type(lcd)model(truncated)vcp(10 12 14(05 08",
+				"(prot(monitor)type(lcd)vcp(02041012166062(01 02)))",
+				"(PROT(monitor)TYPE(lcd)VCP(10 12 14(05 08 0b) 60(0f 11)))",
+				"(prot(monitor)vcpname(10(Brightness) 14(Color Preset))vcp(10 12))",
+				std::string("(prot(monitor)type(lcd)vcp(10 12))\0\0\0garbage)))", 45),
+				"(prot(monitor)type(lcd)vcp(10 14(05 06(01 02) 08) DC(1 2 3)))",
+				"(prot (monitor) type (lcd) vcp (10 12 60 (0F 11)))",
+				"(prot(monitor)vcp(10 12)vcp(14(05 08) 60(0F)))",
+				"(prot(monitor)type(lcd)vcp(0x10 0x12 60(0x0F 11)))",
+				"",
+				")))(((",
+				"(prot(monitor)type(lcd)model(no vcp section)mccs_ver(2.0))",
+			};
+		}
+
+		TEST(MccsCapabilitiesTest, ParsesWellFormedString)
+		{
+			MccsCapabilities capabilities;
+
+			ASSERT_TRUE(capabilities.Parse(kCorpus[0]));
+
+			EXPECT_EQ(GetCodes(capabilities), (std::vector<VcpCode>{ 0x02, 0x04, 0x10, 0x12, 0x14, 0x60 }));
+			EXPECT_EQ(GetValues(capabilities, 0x14), (std::vector<int>{ 0x05, 0x08, 0x0b }));
+			EXPECT_EQ(GetValues(capabilities, 0x60), (std::vector<int>{ 0x0f, 0x11 }));
+			EXPECT_TRUE(capabilities.GetAllowedValues(0x10).empty());
+			EXPECT_EQ(capabilities.protocol(), "monitor");
+			EXPECT_EQ(capabilities.type(), "lcd");
+		}
+
+		TEST(MccsCapabilitiesTest, ParsesRealWorldString)
+		{
+			MccsCapabilities capabilities;
+
+			ASSERT_TRUE(capabilities.Parse(kCorpus[1]));
+
+			EXPECT_EQ(capabilities.code_count(), 31u);
+			EXPECT_EQ(GetValues(capabilities, 0x60), (std::vector<int>{ 0x0f, 0x10, 0x11, 0x12 }));
+			EXPECT_EQ(GetValues(capabilities, 0xe2), (std::vector<int>{ 0x00, 0x1d, 0x02, 0x04, 0x0e, 0x12, 0x14 }));
+			// cmds lists commands, not VCP codes
+			EXPECT_FALSE(capabilities.IsSupported(0x01));
+			EXPECT_EQ(capabilities.model(), "U2720Q");
+			EXPECT_EQ(capabilities.mccs_version(), "2.1");
+		}
+
+		TEST(MccsCapabilitiesTest, ChecksAllowedValues)
+		{
+			MccsCapabilities capabilities;
+			ASSERT_TRUE(capabilities.Parse(kCorpus[0]));
+
+			EXPECT_TRUE(capabilities.IsAllowed(0x60, 0x11));
+			EXPECT_FALSE(capabilities.IsAllowed(0x60, 0x12));
+			EXPECT_TRUE(capabilities.IsAllowed(0x10, 75));
+			EXPECT_FALSE(capabilities.IsAllowed(0xdc, 0));
+		}
+
+		TEST(MccsCapabilitiesTest, ToleratesMissingOuterParentheses)
+		{
+			MccsCapabilities capabilities;
+
+			ASSERT_TRUE(capabilities.Parse(kCorpus[2]));
+
+			EXPECT_EQ(GetValues(capabilities, 0x60), (std::vector<int>{ 0x01, 0x03, 0x0f }));
+			EXPECT_EQ(capabilities.mccs_version(), "2.2");
+		}
+
+		TEST(MccsCapabilitiesTest, ToleratesTruncatedString)
+		{
+			MccsCapabilities capabilities;
+
+			ASSERT_TRUE(capabilities.Parse(kCorpus[3]));
+
+			EXPECT_EQ(GetCodes(capabilities), (std::vector<VcpCode>{ 0x10, 0x12, 0x14 }));
+			EXPECT_EQ(GetValues(capabilities, 0x14), (std::vector<int>{ 0x05, 0x08 }));
+		}
+
+		TEST(MccsCapabilitiesTest, SplitsCodesWithoutSpaces)
+		{
+			MccsCapabilities capabilities;
+
+			ASSERT_TRUE(capabilities.Parse(kCorpus[4]));
+
+			EXPECT_EQ(GetCodes(capabilities), (std::vector<VcpCode>{ 0x02, 0x04, 0x10, 0x12, 0x16, 0x60, 0x62 }));
+			// the value list belongs to the last code of the run
+			EXPECT_EQ(GetValues(capabilities, 0x62), (std::vector<int>{ 0x01, 0x02 }));
+			EXPECT_TRUE(capabilities.GetAllowedValues(0x60).empty());
+		}
+
+		TEST(MccsCapabilitiesTest, IgnoresCase)
+		{
+			MccsCapabilities capabilities;
+
+			ASSERT_TRUE(capabilities.Parse(kCorpus[5]));
+
+			EXPECT_EQ(GetValues(capabilities, 0x14), (std::vector<int>{ 0x05, 0x08, 0x0b }));
+			EXPECT_EQ(capabilities.protocol(), "monitor");
+		}
+
+		TEST(MccsCapabilitiesTest, SkipsOtherSections)
+		{
+			MccsCapabilities capabilities;
+
+			ASSERT_TRUE(capabilities.Parse(kCorpus[6]));
+
+			EXPECT_EQ(GetCodes(capabilities), (std::vector<VcpCode>{ 0x10, 0x12 }));
+			EXPECT_TRUE(capabilities.GetAllowedValues(0x14).empty());
+		}
+
+		TEST(MccsCapabilitiesTest, IgnoresTrailingGarbage)
+		{
+			MccsCapabilities capabilities;
+
+			ASSERT_TRUE(capabilities.Parse(kCorpus[7]));
+
+			EXPECT_EQ(GetCodes(capabilities), (std::vector<VcpCode>{ 0x10, 0x12 }));
+		}
+
+		TEST(MccsCapabilitiesTest, SkipsNestedValueGroups)
+		{
+			MccsCapabilities capabilities;
+
+			ASSERT_TRUE(capabilities.Parse(kCorpus[8]));
+
+			// the sub-values of 06 are not values of 14
+			EXPECT_EQ(GetValues(capabilities, 0x14), (std::vector<int>{ 0x05, 0x06, 0x08 }));
+			EXPECT_EQ(GetValues(capabilities, 0xdc), (std::vector<int>{ 1, 2, 3 }));
+		}
+
+		TEST(MccsCapabilitiesTest, ToleratesSpacesBeforeGroups)
+		{
+			MccsCapabilities capabilities;
+
+			ASSERT_TRUE(capabilities.Parse(kCorpus[9]));
+
+			EXPECT_EQ(GetValues(capabilities, 0x60), (std::vector<int>{ 0x0f, 0x11 }));
+			EXPECT_EQ(capabilities.type(), "lcd");
+		}
+
+		TEST(MccsCapabilitiesTest, MergesRepeatedVcpSections)
+		{
+			MccsCapabilities capabilities;
+
+			ASSERT_TRUE(capabilities.Parse(kCorpus[10]));
+
+			EXPECT_EQ(GetCodes(capabilities), (std::vector<VcpCode>{ 0x10, 0x12, 0x14, 0x60 }));
+			EXPECT_EQ(GetValues(capabilities, 0x14), (std::vector<int>{ 0x05, 0x08 }));
+		}
+
+		TEST(MccsCapabilitiesTest, SkipsHexPrefixes)
+		{
+			MccsCapabilities capabilities;
+
+			ASSERT_TRUE(capabilities.Parse(kCorpus[11]));
+
+			EXPECT_EQ(GetCodes(capabilities), (std::vector<VcpCode>{ 0x10, 0x12, 0x60 }));
+			EXPECT_EQ(GetValues(capabilities, 0x60), (std::vector<int>{ 0x0f, 0x11 }));
+		}
+
+		TEST(MccsCapabilitiesTest, ReportsMissingVcpSection)
+		{
+			MccsCapabilities capabilities;
+
+			EXPECT_FALSE(capabilities.Parse(kCorpus[12]));
+			EXPECT_FALSE(capabilities.Parse(kCorpus[13]));
+			EXPECT_FALSE(capabilities.Parse(kCorpus[14]));
+			EXPECT_EQ(capabilities.code_count(), 0u);
+			EXPECT_EQ(capabilities.model(), "no vcp section");
+		}
+
+		TEST(MccsCapabilitiesTest, ReparseReplacesTable)
+		{
+			MccsCapabilities capabilities;
+			ASSERT_TRUE(capabilities.Parse(kCorpus[1]));
+
+			ASSERT_TRUE(capabilities.Parse(kCorpus[0]));
+
+			EXPECT_EQ(capabilities.code_count(), 6u);
+			EXPECT_TRUE(capabilities.GetAllowedValues(0xcc).empty());
+			EXPECT_TRUE(capabilities.model().empty());
+		}
+
+		// Mutates the corpus at random and checks that every result stays inside the parsed string and the table.
+		TEST(MccsCapabilitiesTest, SurvivesMutatedCorpus)
+		{
+			constexpr int kIterations = 20000;
+			constexpr char kAlphabet[] = "()0123456789abcdefABCDEF vcpVCP_xyz\t\n\0";
+
+			std::mt19937 random(20261019);
+			MccsCapabilities capabilities;
+			for (int iteration = 0; iteration < kIterations; ++iteration)
+			{
+				std::string text = kCorpus[random() % kCorpus.size()];
+				const int mutation_count = 1 + static_cast<int>(random() % 8);
+				for (int mutation = 0; mutation < mutation_count; ++mutation)
+				{
+					const size_t position = text.empty() ? 0 : random() % (text.size() + 1);
+					const char character = kAlphabet[random() % (sizeof(kAlphabet) - 1)];
+					switch (random() % 4)
+					{
+					case 0:
+						text.insert(text.begin() + position, character);
+						break;
+
+					case 1:
+						if (position < text.size())
+						{
+							text[position] = character;
+						}
+						break;
+
+					case 2:
+						if (position < text.size())
+						{
+							text.erase(position, 1 + random() % 4);
+						}
+						break;
+
+					default:
+						text.resize(position);
+						break;
+					}
+				}
+
+				capabilities.Parse(text);
+
+				size_t value_count = 0;
+				for (int code = 0; code < 256; ++code)
+				{
+					const VcpValueList values = capabilities.GetAllowedValues(static_cast<VcpCode>(code));
+					ASSERT_TRUE(values.empty() || capabilities.IsSupported(static_cast<VcpCode>(code)));
+					value_count += values.size;
+				}
+
+				ASSERT_LE(value_count, text.size());
+				for (const std::string_view field : { capabilities.protocol(), capabilities.type(), capabilities.model(), capabilities.mccs_version() })
+				{
+					ASSERT_TRUE(field.empty() || (field.data() >= text.data() && field.data() + field.size() <= text.data() + text.size()));
+				}
+			}
+		}
+	}
+}
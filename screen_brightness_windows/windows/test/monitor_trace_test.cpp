@@ -0,0 +1,284 @@
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <cstdio>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "screen_brightness_windows/brightness_service.h"
+#include "screen_brightness_windows/fake_monitor_backend.h"
+#include "screen_brightness_windows/monitor_trace.h"
+#include "screen_brightness_windows/process_liveness.h"
+#include "test_edid.h"
+
+namespace screen_brightness
+{
+	namespace test
+	{
+		using std::chrono::milliseconds;
+
+		// A monitor which takes a while to answer, on a simulated clock.
+		class SlowMonitorBackend final : public MonitorBackend
+		{
+		public:
+			SlowMonitorBackend(MonitorBackend& backend, ManualClock& clock) : backend_(backend), clock_(clock)
+			{
+			}
+
+			Clock::duration latency = milliseconds(40);
+
+			MonitorStatus EnumerateDisplays(std::vector<DisplayInfo>& displays) override
+			{
+				Wait();
+				return backend_.EnumerateDisplays(displays);
+			}
+
+			DisplayHandle GetPrimaryDisplay() override
+			{
+				return backend_.GetPrimaryDisplay();
+			}
+
+			MonitorStatus GetScreenBrightness(const DisplayHandle display, long& minimum_screen_brightness, long& screen_brightness, long& maximum_screen_brightness) override
+			{
+				Wait();
+				return backend_.GetScreenBrightness(display, minimum_screen_brightness, screen_brightness, maximum_screen_brightness);
+			}
+
+			MonitorStatus SetScreenBrightness(const DisplayHandle display, const long screen_brightness) override
+			{
+				Wait();
+				return backend_.SetScreenBrightness(display, screen_brightness);
+			}
+
+			MonitorStatus GetVcpFeature(const DisplayHandle display, const VcpCode code, unsigned long& current_value, unsigned long& maximum_value) override
+			{
+				Wait();
+				return backend_.GetVcpFeature(display, code, current_value, maximum_value);
+			}
+
+			MonitorStatus SetVcpFeature(const DisplayHandle display, const VcpCode code, const unsigned long value) override
+			{
+				Wait();
+				return backend_.SetVcpFeature(display, code, value);
+			}
+
+			MonitorStatus GetCapabilitiesString(const DisplayHandle display, std::string& capabilities) override
+			{
+				Wait();
+				return backend_.GetCapabilitiesString(display, capabilities);
+			}
+
+			MonitorStatus GetEdid(const DisplayHandle display, std::vector<std::uint8_t>& edid) override
+			{
+				Wait();
+				return backend_.GetEdid(display, edid);
+			}
+
+		private:
+			MonitorBackend& backend_;
+
+			ManualClock& clock_;
+
+			void Wait()
+			{
+				clock_.Advance(latency);
+			}
+		};
+
+		class MonitorTraceTest : public ::testing::Test
+		{
+		protected:
+			FakeMonitorBackend fake_backend_;
+
+			ManualClock clock_;
+
+			SlowMonitorBackend slow_backend_{ fake_backend_, clock_ };
+
+			// per process, as the tests of this fixture may run in parallel
+			const std::string path_ = ::testing::TempDir() + "screen_brightness_monitor_trace_test_" + std::to_string(GetOwnProcessId()) + ".sbtrace";
+
+			DisplayHandle first_ = 0;
+
+			DisplayHandle second_ = 0;
+
+			void SetUp() override
+			{
+				FakeMonitorBackend::Display first{ "first", 0, 40, 100 };
+				first.vcp_features[kVcpContrast] = { 50, 100 };
+				first.capabilities = "(prot(monitor)vcp(10 12))";
+				first.edid = CreateEdid(TestEdid{});
+				first_ = fake_backend_.AddDisplay(first);
+				second_ = fake_backend_.AddDisplay({ "second", 0, 60, 200 });
+			}
+
+			void TearDown() override
+			{
+				std::remove(path_.c_str());
+			}
+
+			std::vector<MonitorTraceRecord> Load() const
+			{
+				std::vector<MonitorTraceRecord> records;
+				EXPECT_EQ(LoadMonitorTrace(path_, records), MonitorStatus::kOk);
+				return records;
+			}
+
+			std::vector<std::uint8_t> ReadFile() const
+			{
+				std::vector<std::uint8_t> bytes;
+				std::FILE* file = std::fopen(path_.c_str(), "rb");
+				for (int byte = 0; file != nullptr && (byte = std::fgetc(file)) != EOF;)
+				{
+					bytes.push_back(static_cast<std::uint8_t>(byte));
+				}
+
+				if (file != nullptr)
+				{
+					std::fclose(file);
+				}
+
+				return bytes;
+			}
+		};
+
+		TEST_F(MonitorTraceTest, RecordsEveryCall)
+		{
+			RecordingMonitorBackend recorder(slow_backend_, clock_);
+			ASSERT_EQ(recorder.Open(path_), MonitorStatus::kOk);
+
+			std::vector<DisplayInfo> displays;
+			long minimum = 0, brightness = 0, maximum = 0;
+			unsigned long current_value = 0, maximum_value = 0;
+			std::string capabilities;
+			std::vector<std::uint8_t> edid;
+			EXPECT_EQ(recorder.EnumerateDisplays(displays), MonitorStatus::kOk);
+			EXPECT_EQ(recorder.GetPrimaryDisplay(), first_);
+			EXPECT_EQ(recorder.GetScreenBrightness(second_, minimum, brightness, maximum), MonitorStatus::kOk);
+			slow_backend_.latency = milliseconds(120);
+			EXPECT_EQ(recorder.SetScreenBrightness(first_, 70), MonitorStatus::kOk);
+			EXPECT_EQ(recorder.GetVcpFeature(first_, kVcpContrast, current_value, maximum_value), MonitorStatus::kOk);
+			EXPECT_EQ(recorder.SetVcpFeature(first_, kVcpContrast, 80), MonitorStatus::kOk);
+			EXPECT_EQ(recorder.GetCapabilitiesString(first_, capabilities), MonitorStatus::kOk);
+			EXPECT_EQ(recorder.GetEdid(first_, edid), MonitorStatus::kOk);
+			fake_backend_.GetDisplay(second_).is_failing = true;
+			EXPECT_EQ(recorder.GetScreenBrightness(second_, minimum, brightness, maximum), MonitorStatus::kGetBrightnessFailed);
+			EXPECT_EQ(recorder.record_count(), 9u);
+			recorder.Close();
+
+			const std::vector<MonitorTraceRecord> records = Load();
+			ASSERT_EQ(records.size(), 9u);
+			ASSERT_EQ(records[0].displays.size(), 2u);
+			EXPECT_EQ(records[0].displays[1].handle, second_);
+			EXPECT_EQ(records[0].displays[1].name, "second");
+			EXPECT_EQ(records[0].duration, milliseconds(40));
+			EXPECT_EQ(records[1].call, MonitorTraceCall::kGetPrimaryDisplay);
+			EXPECT_EQ(records[1].display, first_);
+			EXPECT_EQ(records[2].start, milliseconds(40));
+			EXPECT_EQ(records[2].display, second_);
+			EXPECT_EQ(records[2].values[1], 60);
+			EXPECT_EQ(records[2].values[2], 200);
+			EXPECT_EQ(records[3].call, MonitorTraceCall::kSetScreenBrightness);
+			EXPECT_EQ(records[3].values[0], 70);
+			EXPECT_EQ(records[3].duration, milliseconds(120));
+			EXPECT_EQ(records[4].code, kVcpContrast);
+			EXPECT_EQ(records[4].values[0], 50);
+			EXPECT_EQ(records[5].values[0], 80);
+			EXPECT_EQ(records[6].text, "(prot(monitor)vcp(10 12))");
+			EXPECT_EQ(records[7].bytes, edid);
+			EXPECT_EQ(records[8].status, MonitorStatus::kGetBrightnessFailed);
+			EXPECT_EQ(records[8].start, milliseconds(40 + 40 + 5 * 120));
+
+			// a brightness call takes a handful of bytes
+			EXPECT_LT(ReadFile().size(), 8 + 2 * 20 + edid.size() + capabilities.size() + 7 * 16);
+		}
+
+		TEST_F(MonitorTraceTest, ReplaysSessionDeterministically)
+		{
+			auto run_session = [this](std::shared_ptr<BrightnessService> service)
+				{
+					BrightnessClient client(std::move(service));
+					client.SetDisplay(first_);
+					client.Initialize();
+					std::vector<double> results;
+					for (int step = 0; step <= 10; ++step)
+					{
+						EXPECT_EQ(client.SetApplicationScreenBrightness(step / 10.0), MonitorStatus::kOk);
+						double brightness = 0;
+						EXPECT_EQ(client.GetApplicationScreenBrightness(brightness), MonitorStatus::kOk);
+						results.push_back(brightness);
+					}
+
+					EXPECT_EQ(client.ResetApplicationScreenBrightness(), MonitorStatus::kOk);
+					return results;
+				};
+
+			// the service owns the recorder, which is closed with it
+			const Clock::time_point recording_start = clock_.Now();
+			auto recorder = std::make_unique<RecordingMonitorBackend>(slow_backend_, clock_);
+			ASSERT_EQ(recorder->Open(path_), MonitorStatus::kOk);
+			const std::vector<double> recorded_results = run_session(std::make_shared<BrightnessService>(std::move(recorder), clock_, milliseconds(50), false));
+
+			const Clock::duration recorded_time = clock_.Now() - recording_start;
+			for (int replay = 0; replay < 2; ++replay)
+			{
+				ManualClock replay_clock;
+				auto replay_backend = std::make_unique<ReplayMonitorBackend>(Load(), replay_clock);
+				const ReplayMonitorBackend& replayed = *replay_backend;
+				const auto service = std::make_shared<BrightnessService>(std::move(replay_backend), replay_clock, milliseconds(50), false);
+				EXPECT_EQ(run_session(service), recorded_results);
+				EXPECT_EQ(replay_clock.Now().time_since_epoch(), recorded_time);
+				EXPECT_EQ(replayed.unmatched_count(), 0u);
+			}
+		}
+
+		TEST_F(MonitorTraceTest, RepeatsLastRecordOnceUsedUp)
+		{
+			{
+				RecordingMonitorBackend recorder(slow_backend_, clock_);
+				ASSERT_EQ(recorder.Open(path_), MonitorStatus::kOk);
+				long minimum = 0, brightness = 0, maximum = 0;
+				EXPECT_EQ(recorder.GetScreenBrightness(first_, minimum, brightness, maximum), MonitorStatus::kOk);
+			}
+
+			ManualClock replay_clock;
+			ReplayMonitorBackend replay_backend(Load(), replay_clock);
+			long minimum = 0, brightness = 0, maximum = 0;
+			EXPECT_EQ(replay_backend.GetScreenBrightness(first_, minimum, brightness, maximum), MonitorStatus::kOk);
+			EXPECT_EQ(replay_backend.unmatched_count(), 0u);
+			brightness = 0;
+			EXPECT_EQ(replay_backend.GetScreenBrightness(first_, minimum, brightness, maximum), MonitorStatus::kOk);
+			EXPECT_EQ(brightness, 40);
+			EXPECT_EQ(replay_clock.Now().time_since_epoch(), milliseconds(80));
+
+			// never recorded
+			EXPECT_EQ(replay_backend.GetScreenBrightness(second_, minimum, brightness, maximum), MonitorStatus::kGetBrightnessFailed);
+			EXPECT_EQ(replay_backend.SetScreenBrightness(first_, 10), MonitorStatus::kSetBrightnessFailed);
+			EXPECT_EQ(replay_backend.unmatched_count(), 3u);
+		}
+
+		TEST_F(MonitorTraceTest, KeepsRecordsBeforeTruncatedTail)
+		{
+			{
+				RecordingMonitorBackend recorder(slow_backend_, clock_);
+				ASSERT_EQ(recorder.Open(path_), MonitorStatus::kOk);
+				for (long value = 0; value < 3; ++value)
+				{
+					EXPECT_EQ(recorder.SetScreenBrightness(first_, value), MonitorStatus::kOk);
+				}
+			}
+
+			std::vector<std::uint8_t> trace = ReadFile();
+			std::vector<MonitorTraceRecord> records;
+			trace.pop_back();
+			EXPECT_EQ(DecodeMonitorTrace(trace, records), MonitorStatus::kOk);
+			EXPECT_EQ(records.size(), 2u);
+
+			trace[8] = 0xff;
+			EXPECT_EQ(DecodeMonitorTrace(trace, records), MonitorStatus::kTraceFailed);
+			trace[0] = 'X';
+			EXPECT_EQ(DecodeMonitorTrace(trace, records), MonitorStatus::kTraceFailed);
+			EXPECT_EQ(LoadMonitorTrace(path_ + ".missing", records), MonitorStatus::kTraceFailed);
+		}
+	}
+}
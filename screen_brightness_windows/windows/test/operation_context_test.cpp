@@ -0,0 +1,352 @@
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <cstdint>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "screen_brightness_windows/brightness_service.h"
+#include "screen_brightness_windows/fake_monitor_backend.h"
+#include "screen_brightness_windows/operation_context.h"
+
+namespace screen_brightness
+{
+	namespace test
+	{
+		using std::chrono::milliseconds;
+		using std::chrono::seconds;
+
+		// A monitor which stops answering brightness writes and VCP reads while hung, like one whose DDC/CI bus has locked up.
+		class HungTestMonitorBackend final : public MonitorBackend
+		{
+		public:
+			FakeMonitorBackend fake;
+
+			void Hang()
+			{
+				std::lock_guard<std::mutex> lock(mutex_);
+				is_hung_ = true;
+			}
+
+			void Release()
+			{
+				{
+					std::lock_guard<std::mutex> lock(mutex_);
+					is_hung_ = false;
+				}
+
+				condition_.notify_all();
+			}
+
+			// Waits until a write is stuck in the monitor.
+			void WaitForStuckWrite()
+			{
+				std::unique_lock<std::mutex> lock(mutex_);
+				condition_.wait(lock, [this] { return stuck_write_count_ > 0; });
+			}
+
+			[[nodiscard]] std::vector<long> written_values()
+			{
+				std::lock_guard<std::mutex> lock(mutex_);
+				return written_values_;
+			}
+
+			MonitorStatus EnumerateDisplays(std::vector<DisplayInfo>& displays) override
+			{
+				return fake.EnumerateDisplays(displays);
+			}
+
+			DisplayHandle GetPrimaryDisplay() override
+			{
+				return fake.GetPrimaryDisplay();
+			}
+
+			MonitorStatus GetScreenBrightness(const DisplayHandle display, long& minimum_screen_brightness, long& screen_brightness, long& maximum_screen_brightness) override
+			{
+				return fake.GetScreenBrightness(display, minimum_screen_brightness, screen_brightness, maximum_screen_brightness);
+			}
+
+			MonitorStatus SetScreenBrightness(const DisplayHandle display, const long screen_brightness) override
+			{
+				{
+					std::unique_lock<std::mutex> lock(mutex_);
+					++stuck_write_count_;
+					condition_.notify_all();
+					condition_.wait(lock, [this] { return !is_hung_; });
+					--stuck_write_count_;
+					written_values_.push_back(screen_brightness);
+				}
+
+				return fake.SetScreenBrightness(display, screen_brightness);
+			}
+
+			MonitorStatus GetVcpFeature(const DisplayHandle display, const VcpCode code, unsigned long& current_value, unsigned long& maximum_value) override
+			{
+				{
+					std::unique_lock<std::mutex> lock(mutex_);
+					++stuck_write_count_;
+					condition_.notify_all();
+					condition_.wait(lock, [this] { return !is_hung_; });
+					--stuck_write_count_;
+				}
+
+				return fake.GetVcpFeature(display, code, current_value, maximum_value);
+			}
+
+			MonitorStatus SetVcpFeature(const DisplayHandle display, const VcpCode code, const unsigned long value) override
+			{
+				return fake.SetVcpFeature(display, code, value);
+			}
+
+			MonitorStatus GetCapabilitiesString(const DisplayHandle display, std::string& capabilities) override
+			{
+				return fake.GetCapabilitiesString(display, capabilities);
+			}
+
+			MonitorStatus GetEdid(const DisplayHandle display, std::vector<std::uint8_t>& edid) override
+			{
+				return fake.GetEdid(display, edid);
+			}
+
+		private:
+			std::mutex mutex_;
+
+			std::condition_variable condition_;
+
+			bool is_hung_ = false;
+
+			int stuck_write_count_ = 0;
+
+			std::vector<long> written_values_;
+		};
+
+		// Each display bus has its worker thread, as in the plugin, and time is real.
+		class OperationContextTest : public ::testing::Test
+		{
+		protected:
+			HungTestMonitorBackend* backend_ = nullptr;
+
+			DisplayHandle display_ = 0;
+
+			std::unique_ptr<BrightnessClient> client_;
+
+			void SetUp() override
+			{
+				auto backend = std::make_unique<HungTestMonitorBackend>();
+				backend_ = backend.get();
+				display_ = backend->fake.AddDisplay({ "hung", 0, 40, 100 });
+				client_ = std::make_unique<BrightnessClient>(
+					std::make_shared<BrightnessService>(std::move(backend), Clock::Steady(), milliseconds(0), true));
+				client_->SetDisplay(display_);
+				client_->Initialize();
+			}
+
+			void TearDown() override
+			{
+				backend_->Release();
+			}
+
+			DdcScheduler& scheduler()
+			{
+				return client_->service().scheduled_backend().GetScheduler(display_);
+			}
+
+			// Returns once the commands queued before have run.
+			void WaitForIdleBus()
+			{
+				EXPECT_EQ(scheduler().Run(DdcPriority::kBackgroundPoll, kDdcNoCoalescing, [] { return MonitorStatus::kOk; }), MonitorStatus::kOk);
+			}
+
+			// Submits a write which holds the bus until the monitor is released.
+			void HoldTheBus()
+			{
+				backend_->Hang();
+				scheduler().Submit(DdcPriority::kUserWrite, kDdcNoCoalescing, [backend = backend_, display = display_]
+					{
+						return backend->SetScreenBrightness(display, 10);
+					});
+				backend_->WaitForStuckWrite();
+			}
+		};
+
+		TEST_F(OperationContextTest, TimedOutWritesAreWithdrawnFromTheQueue)
+		{
+			HoldTheBus();
+
+			OperationContext context(1, std::chrono::steady_clock::now() + milliseconds(50));
+			{
+				const OperationContext::Scope scope(context);
+				EXPECT_EQ(client_->SetApplicationScreenBrightness(0.8), MonitorStatus::kTimedOut);
+			}
+
+			// the failed write leaves the client as it was
+			EXPECT_EQ(client_->GetApplicationScreenBrightnessOverride(), -1);
+			EXPECT_EQ(scheduler().metrics().queue_depth, 0u);
+
+			backend_->Release();
+			WaitForIdleBus();
+			EXPECT_EQ(backend_->written_values(), std::vector<long>({ 10 }));
+		}
+
+		TEST_F(OperationContextTest, StopsWaitingForAHungMonitor)
+		{
+			backend_->Hang();
+			const auto start = std::chrono::steady_clock::now();
+			OperationContext context(2, start + milliseconds(50));
+			{
+				const OperationContext::Scope scope(context);
+				EXPECT_EQ(client_->SetApplicationScreenBrightness(0.8), MonitorStatus::kTimedOut);
+			}
+
+			EXPECT_LT(std::chrono::steady_clock::now() - start, seconds(5));
+
+			// the monitor had the write already, which completes in the background
+			backend_->Release();
+			WaitForIdleBus();
+			EXPECT_EQ(backend_->written_values(), std::vector<long>({ 80 }));
+			EXPECT_EQ(backend_->fake.GetDisplay(display_).brightness, 80);
+		}
+
+		TEST_F(OperationContextTest, ClosingRestoresATimedOutWriteWhichLanded)
+		{
+			backend_->Hang();
+			OperationContext context(7, std::chrono::steady_clock::now() + milliseconds(50));
+			{
+				const OperationContext::Scope scope(context);
+				EXPECT_EQ(client_->SetApplicationScreenBrightness(0.8), MonitorStatus::kTimedOut);
+			}
+
+			backend_->Release();
+			WaitForIdleBus();
+			ASSERT_EQ(backend_->fake.GetDisplay(display_).brightness, 80);
+
+			const std::vector<DisplayRestoreResult> results = client_->OnApplicationClose(seconds(5));
+			ASSERT_EQ(results.size(), 1u);
+			EXPECT_EQ(results[0].status, MonitorStatus::kOk);
+			EXPECT_EQ(backend_->fake.GetDisplay(display_).brightness, 40);
+		}
+
+		TEST_F(OperationContextTest, PausingRestoresATimedOutWriteWhichLanded)
+		{
+			backend_->Hang();
+			OperationContext context(8, std::chrono::steady_clock::now() + milliseconds(50));
+			{
+				const OperationContext::Scope scope(context);
+				EXPECT_EQ(client_->SetApplicationScreenBrightness(0.8), MonitorStatus::kTimedOut);
+			}
+
+			backend_->Release();
+			WaitForIdleBus();
+			client_->OnApplicationPause();
+			EXPECT_EQ(backend_->fake.GetDisplay(display_).brightness, 40);
+		}
+
+		TEST_F(OperationContextTest, GivenUpStartedWritesWithdrawOnlyWhatHasNotRun)
+		{
+			backend_->Hang();
+			int completed_count = 0;
+			const auto running = client_->StartApplicationScreenBrightnessWrite(0.8, [&completed_count] { ++completed_count; });
+			backend_->WaitForStuckWrite();
+			const auto queued = client_->StartApplicationScreenBrightnessWrite(0.6, nullptr);
+			EXPECT_FALSE(running->is_completed());
+			EXPECT_FALSE(queued->is_completed());
+
+			// the override goes back to the running write's, which is given up as well
+			EXPECT_EQ(client_->FinishApplicationScreenBrightnessWrite(*queued, MonitorStatus::kCancelled), MonitorStatus::kCancelled);
+			EXPECT_DOUBLE_EQ(client_->GetApplicationScreenBrightnessOverride(), 0.8);
+			EXPECT_EQ(client_->FinishApplicationScreenBrightnessWrite(*running, MonitorStatus::kTimedOut), MonitorStatus::kTimedOut);
+			EXPECT_FALSE(client_->HasApplicationScreenBrightnessChanged());
+
+			backend_->Release();
+			WaitForIdleBus();
+			EXPECT_EQ(completed_count, 1);
+			EXPECT_EQ(backend_->written_values(), std::vector<long>({ 80 }));
+
+			// the running write landed, so pausing writes the system brightness again
+			client_->OnApplicationPause();
+			EXPECT_EQ(backend_->fake.GetDisplay(display_).brightness, 40);
+		}
+
+		TEST_F(OperationContextTest, StopsWaitingForAHungVcpBatch)
+		{
+			backend_->Hang();
+			const auto start = std::chrono::steady_clock::now();
+			OperationContext context(6, start + milliseconds(50));
+			std::vector<VcpFeatureValue> features;
+			{
+				const OperationContext::Scope scope(context);
+				EXPECT_EQ(client_->service().vcp_feature_controller().GetVcpFeatures(display_, { kVcpContrast, kVcpInputSource }, features),
+					MonitorStatus::kTimedOut);
+			}
+
+			EXPECT_LT(std::chrono::steady_clock::now() - start, seconds(5));
+			ASSERT_EQ(features.size(), 2u);
+			EXPECT_EQ(features[0].code, kVcpContrast);
+
+			// the batch keeps its own results, and finishes once the monitor answers
+			backend_->Release();
+			WaitForIdleBus();
+			EXPECT_EQ(backend_->fake.vcp_get_count(), 2);
+		}
+
+		TEST_F(OperationContextTest, CancelsFromAnotherThread)
+		{
+			OperationRegistry& registry = client_->service().operation_registry();
+			HoldTheBus();
+
+			const std::shared_ptr<OperationContext> context = registry.Begin(3, OperationContext::kNoDeadline);
+			std::thread canceller([this, &registry]
+				{
+					// the write is queued behind the stuck one
+					while (scheduler().metrics().queue_depth == 0)
+					{
+						std::this_thread::sleep_for(milliseconds(1));
+					}
+
+					EXPECT_TRUE(registry.Cancel(3));
+				});
+			{
+				const OperationContext::Scope scope(*context);
+				EXPECT_EQ(client_->SetApplicationScreenBrightness(0.8), MonitorStatus::kCancelled);
+			}
+
+			canceller.join();
+			registry.End(*context);
+			EXPECT_FALSE(registry.Cancel(3));
+			EXPECT_EQ(client_->GetApplicationScreenBrightnessOverride(), -1);
+
+			backend_->Release();
+			WaitForIdleBus();
+			EXPECT_EQ(backend_->written_values(), std::vector<long>({ 10 }));
+		}
+
+		TEST_F(OperationContextTest, SubmitsNothingOnceTimedOutOrCancelled)
+		{
+			const std::uint64_t executed_count = scheduler().metrics().executed_count;
+			OperationContext expired_context(4, std::chrono::steady_clock::now() - milliseconds(1));
+			{
+				const OperationContext::Scope scope(expired_context);
+				EXPECT_EQ(client_->SetApplicationScreenBrightness(0.8), MonitorStatus::kTimedOut);
+			}
+
+			OperationContext cancelled_context(5, OperationContext::kNoDeadline);
+			cancelled_context.Cancel();
+			{
+				const OperationContext::Scope scope(cancelled_context);
+				EXPECT_EQ(client_->SetApplicationScreenBrightness(0.8), MonitorStatus::kCancelled);
+				EXPECT_EQ(OperationContext::Current(), &cancelled_context);
+			}
+
+			EXPECT_EQ(OperationContext::Current(), nullptr);
+			EXPECT_EQ(scheduler().metrics().executed_count, executed_count);
+
+			// without a context, writes go through
+			EXPECT_EQ(client_->SetApplicationScreenBrightness(0.8), MonitorStatus::kOk);
+			EXPECT_EQ(backend_->written_values(), std::vector<long>({ 80 }));
+		}
+	}
+}
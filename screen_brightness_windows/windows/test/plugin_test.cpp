@@ -0,0 +1,313 @@
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <limits>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <unistd.h>
+
+#include <fake_flutter_engine.h>
+#include <fake_windows.h>
+#include <flutter/plugin_registrar.h>
+
+#include "screen_brightness_windows/ddc_scheduler.h"
+#include "screen_brightness_windows/screen_brightness_ffi.h"
+#include "screen_brightness_windows/screen_brightness_windows_plugin_c_api.h"
+
+namespace screen_brightness
+{
+	namespace test
+	{
+		using flutter::EncodableMap;
+		using flutter::EncodableValue;
+
+		constexpr const char* kPluginMethodChannel = "github.com/aaassseee/screen_brightness";
+
+		constexpr const char* kApplicationBrightnessChannel = "github.com/aaassseee/screen_brightness/application_brightness_changed";
+
+		// A PnP manufacturer id of this process. Displays are leased across processes by their EDID identity, so test
+		// processes running in parallel each have their own.
+		std::string GetProcessManufacturer()
+		{
+			const unsigned process_id = static_cast<unsigned>(getpid());
+			return { static_cast<char>('A' + process_id % 26), static_cast<char>('A' + process_id / 26 % 26), static_cast<char>('A' + process_id / 676 % 26) };
+		}
+
+		// The plugin as built on Linux over test/shim: two displays side by side, a top-level window on the first, and an
+		// engine with the plugin registered.
+		class PluginTest : public ::testing::Test
+		{
+		protected:
+			std::string state_directory_;
+
+			std::vector<HMONITOR> displays_;
+
+			HWND window_ = nullptr;
+
+			std::unique_ptr<fake_flutter::FakeFlutterEngine> engine_;
+
+			void SetUp() override
+			{
+				// the restore journal of the test stays out of the user's
+				char state_directory[] = "/tmp/screen_brightness_plugin_test_XXXXXX";
+				ASSERT_NE(mkdtemp(state_directory), nullptr);
+				state_directory_ = state_directory;
+				setenv("XDG_STATE_HOME", state_directory, 1);
+
+				for (int index = 0; index < 2; ++index)
+				{
+					fake_windows::MonitorConfig config;
+					config.rect = RECT{ index * 1920, 0, (index + 1) * 1920, 1080 };
+					config.manufacturer = GetProcessManufacturer();
+					config.brightness = 50;
+					displays_.push_back(fake_windows::AddMonitor(config));
+				}
+
+				window_ = fake_windows::CreateTopLevelWindow(displays_.front());
+				engine_ = std::make_unique<fake_flutter::FakeFlutterEngine>(window_);
+				ScreenBrightnessWindowsPluginCApiRegisterWithRegistrar(engine_->GetRegistrarForPlugin("ScreenBrightnessWindowsPluginCApi"));
+				(void)fake_windows::DispatchMessages();
+			}
+
+			void TearDown() override
+			{
+				fake_windows::ReleaseHungCalls();
+				engine_.reset();
+				flutter::PluginRegistrarManager::GetInstance()->Reset();
+				EXPECT_EQ(fake_windows::GetOpenPhysicalMonitorCount(), 0u);
+				fake_windows::Reset();
+				const std::string journal = state_directory_ + "/screen_brightness_restore.journal";
+				std::remove(journal.c_str());
+				rmdir(state_directory_.c_str());
+			}
+
+			fake_flutter::Envelope Call(const char* method, const EncodableValue& arguments = EncodableValue())
+			{
+				return engine_->InvokeMethod(kPluginMethodChannel, method, arguments);
+			}
+
+			fake_flutter::Envelope SetApplicationBrightness(const double brightness)
+			{
+				return Call("setApplicationScreenBrightness", EncodableValue(EncodableMap{ { EncodableValue("brightness"), EncodableValue(brightness) } }));
+			}
+
+			// Sends the message to the top-level window, as Windows does, and returns once the runner handled it.
+			void SendWindowMessage(const UINT message, const WPARAM wparam)
+			{
+				fake_windows::PostWindowMessage(window_, message, wparam, 0);
+				(void)fake_windows::DispatchMessages();
+			}
+
+			// Dispatches messages until the condition holds, or a second passed.
+			template <typename Condition>
+			bool DispatchUntil(Condition condition)
+			{
+				const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(1);
+				while (!condition())
+				{
+					if (std::chrono::steady_clock::now() > deadline)
+					{
+						return false;
+					}
+
+					(void)fake_windows::DispatchMessages();
+					std::this_thread::sleep_for(std::chrono::milliseconds(1));
+				}
+
+				return true;
+			}
+		};
+
+		TEST_F(PluginTest, SetsAndResetsApplicationBrightnessThroughMethodChannel)
+		{
+			std::vector<double> events;
+			ASSERT_FALSE(engine_->Listen(kApplicationBrightnessChannel, [&events](const fake_flutter::Envelope& event)
+				{
+					if (const double* brightness = std::get_if<double>(&event.value))
+					{
+						events.push_back(*brightness);
+					}
+				}).is_error);
+
+			const fake_flutter::Envelope set_reply = SetApplicationBrightness(0.8);
+			ASSERT_TRUE(set_reply.is_present);
+			EXPECT_FALSE(set_reply.is_error) << set_reply.error_message;
+			EXPECT_EQ(fake_windows::GetBrightness(displays_[0]), 80u);
+			EXPECT_EQ(fake_windows::GetBrightness(displays_[1]), 50u);
+
+			const fake_flutter::Envelope get_reply = Call("getApplicationScreenBrightness");
+			ASSERT_FALSE(get_reply.is_error);
+			EXPECT_DOUBLE_EQ(std::get<double>(get_reply.value), 0.8);
+
+			EXPECT_FALSE(Call("resetApplicationScreenBrightness").is_error);
+			EXPECT_EQ(fake_windows::GetBrightness(displays_[0]), 50u);
+			(void)fake_windows::DispatchMessages();
+			ASSERT_FALSE(events.empty());
+			EXPECT_DOUBLE_EQ(events.front(), 0.8);
+			(void)engine_->Cancel(kApplicationBrightnessChannel);
+		}
+
+		TEST_F(PluginTest, ReportsScriptedMonitorFailureAsMethodError)
+		{
+			fake_windows::ScriptDdcCalls(displays_[0], fake_windows::DdcFunction::kSetMonitorBrightness, { fake_windows::DdcStep{ {}, true } });
+
+			const fake_flutter::Envelope failed_reply = SetApplicationBrightness(0.3);
+			ASSERT_TRUE(failed_reply.is_error);
+			EXPECT_EQ(failed_reply.error_code, "-1");
+			EXPECT_EQ(fake_windows::GetBrightness(displays_[0]), 50u);
+
+			// the script is used up, and the monitor answers again
+			EXPECT_FALSE(SetApplicationBrightness(0.3).is_error);
+			EXPECT_EQ(fake_windows::GetBrightness(displays_[0]), 30u);
+
+			bool has_failed_write = false;
+			for (const fake_windows::DdcCall& call : fake_windows::GetDdcCallLog())
+			{
+				has_failed_write = has_failed_write || (call.function == fake_windows::DdcFunction::kSetMonitorBrightness && call.result == FALSE);
+			}
+
+			EXPECT_TRUE(has_failed_write);
+		}
+
+		TEST_F(PluginTest, RestoresSystemBrightnessWhileMinimized)
+		{
+			ASSERT_FALSE(SetApplicationBrightness(0.8).is_error);
+
+			SendWindowMessage(WM_SIZE, SIZE_MINIMIZED);
+			EXPECT_EQ(fake_windows::GetBrightness(displays_[0]), 50u);
+
+			SendWindowMessage(WM_SIZE, SIZE_RESTORED);
+			EXPECT_EQ(fake_windows::GetBrightness(displays_[0]), 80u);
+		}
+
+		TEST_F(PluginTest, MovesApplicationBrightnessWithWindow)
+		{
+			ASSERT_FALSE(SetApplicationBrightness(0.8).is_error);
+
+			fake_windows::MoveWindowToMonitor(window_, displays_[1]);
+			(void)fake_windows::DispatchMessages();
+			EXPECT_EQ(fake_windows::GetBrightness(displays_[0]), 50u);
+			EXPECT_EQ(fake_windows::GetBrightness(displays_[1]), 80u);
+		}
+
+		TEST_F(PluginTest, ClosesWithinRestoreTimeoutWhenMonitorHangs)
+		{
+			ASSERT_FALSE(SetApplicationBrightness(0.8).is_error);
+			fake_windows::ScriptDdcCalls(displays_[0], fake_windows::DdcFunction::kSetMonitorBrightness, { fake_windows::DdcStep{ {}, false, true } });
+
+			const auto start = std::chrono::steady_clock::now();
+			SendWindowMessage(WM_CLOSE, 0);
+			EXPECT_LT(std::chrono::steady_clock::now() - start, std::chrono::seconds(2));
+			EXPECT_EQ(fake_windows::GetHungCallCount(), 1u);
+
+			fake_windows::ReleaseHungCalls();
+			EXPECT_TRUE(DispatchUntil([] { return fake_windows::GetHungCallCount() == 0; }));
+		}
+
+		TEST_F(PluginTest, ClosingRestoresAWriteWhichLandedAfterItsDeadline)
+		{
+			// the reads of the setup no longer hold the bus, so that the write starts before its deadline
+			std::this_thread::sleep_for(2 * DdcScheduler::kMccsMinimumCommandInterval);
+			fake_windows::ScriptDdcCalls(displays_[0], fake_windows::DdcFunction::kSetMonitorBrightness, { fake_windows::DdcStep{ std::chrono::milliseconds(200) } });
+			fake_flutter::Envelope reply;
+			engine_->InvokeMethodAsync(kPluginMethodChannel, "setApplicationScreenBrightness", EncodableValue(EncodableMap{
+				{ EncodableValue("brightness"), EncodableValue(0.8) }, { EncodableValue("deadlineMs"), EncodableValue(20) } }),
+				[&reply](const fake_flutter::Envelope& envelope) { reply = envelope; });
+			ASSERT_TRUE(DispatchUntil([&reply] { return reply.is_present; }));
+			EXPECT_TRUE(reply.is_error);
+			EXPECT_EQ(reply.error_code, "-12");
+
+			// the monitor had the write already
+			EXPECT_TRUE(DispatchUntil([this] { return fake_windows::GetBrightness(displays_[0]) == 80; }));
+			SendWindowMessage(WM_CLOSE, 0);
+			EXPECT_EQ(fake_windows::GetBrightness(displays_[0]), 50u);
+		}
+
+		TEST_F(PluginTest, CancelMethodCallReachesARunningWrite)
+		{
+			fake_windows::ScriptDdcCalls(displays_[0], fake_windows::DdcFunction::kSetMonitorBrightness, { fake_windows::DdcStep{ {}, false, true } });
+			fake_flutter::Envelope reply;
+			engine_->InvokeMethodAsync(kPluginMethodChannel, "setApplicationScreenBrightness", EncodableValue(EncodableMap{
+				{ EncodableValue("brightness"), EncodableValue(0.8) }, { EncodableValue("operationId"), EncodableValue(7) } }),
+				[&reply](const fake_flutter::Envelope& envelope) { reply = envelope; });
+			ASSERT_TRUE(DispatchUntil([] { return fake_windows::GetHungCallCount() == 1; }));
+			EXPECT_FALSE(reply.is_present);
+
+			// the platform thread is free while the monitor hangs
+			const fake_flutter::Envelope cancel_reply = Call("cancel", EncodableValue(EncodableMap{ { EncodableValue("operationId"), EncodableValue(7) } }));
+			ASSERT_FALSE(cancel_reply.is_error);
+			EXPECT_TRUE(std::get<bool>(cancel_reply.value));
+			ASSERT_TRUE(DispatchUntil([&reply] { return reply.is_present; }));
+			EXPECT_EQ(reply.error_code, "-13");
+			EXPECT_FALSE(std::get<bool>(Call("hasApplicationScreenBrightnessChanged").value));
+		}
+
+		TEST_F(PluginTest, AcceptsAnIntegerStallBudgetAndRejectsInvalidOnes)
+		{
+			const auto set_stall_budget = [this](const EncodableValue& budget)
+				{
+					return Call("setStallBudget", EncodableValue(EncodableMap{ { EncodableValue("budgetMs"), budget } }));
+				};
+			EXPECT_FALSE(set_stall_budget(EncodableValue(20)).is_error);
+			EXPECT_FALSE(set_stall_budget(EncodableValue(std::int64_t{ 20 })).is_error);
+			EXPECT_FALSE(set_stall_budget(EncodableValue(12.5)).is_error);
+			EXPECT_EQ(set_stall_budget(EncodableValue(std::numeric_limits<double>::infinity())).error_code, "-2");
+			EXPECT_EQ(set_stall_budget(EncodableValue(-1)).error_code, "-2");
+		}
+
+		TEST_F(PluginTest, AcceptsIntegerIdleDimmingValuesAndRejectsInvalidOnes)
+		{
+			const auto set_idle_dimming = [this](const char* name, const EncodableValue& value)
+				{
+					EncodableMap args{
+						{ EncodableValue("isEnabled"), EncodableValue(true) },
+						{ EncodableValue("idleTimeoutMs"), EncodableValue(60000) },
+						{ EncodableValue("dimmedBrightness"), EncodableValue(0) },
+						{ EncodableValue("dimDurationMs"), EncodableValue(500) },
+						{ EncodableValue("restoreDurationMs"), EncodableValue(std::int64_t{ 200 }) },
+					};
+					args[EncodableValue(name)] = value;
+					return Call("setIdleDimming", EncodableValue(std::move(args)));
+				};
+			EXPECT_FALSE(set_idle_dimming("dimmedBrightness", EncodableValue(1)).is_error);
+			EXPECT_EQ(set_idle_dimming("dimmedBrightness", EncodableValue(std::nan(""))).error_code, "-2");
+			EXPECT_EQ(set_idle_dimming("idleTimeoutMs", EncodableValue(std::numeric_limits<double>::infinity())).error_code, "-2");
+			EXPECT_EQ(set_idle_dimming("dimDurationMs", EncodableValue(-1)).error_code, "-2");
+			EXPECT_EQ(set_idle_dimming("restoreDurationMs", EncodableValue(std::nan(""))).error_code, "-2");
+			EXPECT_FALSE(Call("setIdleDimming", EncodableValue(EncodableMap{ { EncodableValue("isEnabled"), EncodableValue(false) } })).is_error);
+		}
+
+		TEST_F(PluginTest, CompletesFfiWriteOnPlatformThread)
+		{
+			struct Completion
+			{
+				std::thread::id thread_id;
+
+				int status = -1;
+
+				bool is_completed = false;
+			} completion;
+
+			const int64_t request_id = ScreenBrightnessFfiSetBrightnessAsync(0.4, [](int64_t, const int32_t status, void* user_data)
+				{
+					auto* const completion = static_cast<Completion*>(user_data);
+					completion->thread_id = std::this_thread::get_id();
+					completion->status = status;
+					completion->is_completed = true;
+				}, &completion);
+			ASSERT_GT(request_id, 0);
+
+			ASSERT_TRUE(DispatchUntil([&completion] { return completion.is_completed; }));
+			EXPECT_EQ(completion.status, SCREEN_BRIGHTNESS_FFI_OK);
+			EXPECT_EQ(completion.thread_id, std::this_thread::get_id());
+			EXPECT_EQ(fake_windows::GetBrightness(displays_[0]), 40u);
+		}
+	}
+}
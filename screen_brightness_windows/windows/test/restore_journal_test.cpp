@@ -0,0 +1,287 @@
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <cstdio>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "screen_brightness_windows/brightness_service.h"
+#include "screen_brightness_windows/display_identity.h"
+#include "screen_brightness_windows/fake_monitor_backend.h"
+#include "screen_brightness_windows/restore_journal.h"
+
+namespace screen_brightness
+{
+	namespace test
+	{
+		constexpr DisplayIdentity kJournalIdentity{ 0x5678 };
+
+		// Recorded like a process which has exited, and whose process id has been given to this one.
+		ProcessIdentity GetRecycledProcessIdentity()
+		{
+			const ProcessIdentity own = GetOwnProcessIdentity();
+			return ProcessIdentity{ own.id, own.start_token ^ 0x5a5a5a5a };
+		}
+
+		class RestoreJournalTest : public ::testing::Test
+		{
+		protected:
+			const std::string path_ = ::testing::TempDir() + "screen_brightness_restore_journal_test_" + std::to_string(getpid()) + ".journal";
+
+			RestoreJournal journal_;
+
+			void SetUp() override
+			{
+				std::remove(path_.c_str());
+				ASSERT_EQ(journal_.Open(path_), MonitorStatus::kOk);
+			}
+
+			void TearDown() override
+			{
+				journal_.Close();
+				std::remove(path_.c_str());
+			}
+
+			// Runs body in a child process which then dies without cleaning up, like a crash. Returns its process id.
+			template <typename Body>
+			pid_t RunCrashingProcess(Body body)
+			{
+				const pid_t process_id = fork();
+				if (process_id == 0)
+				{
+					body();
+					_exit(0);
+				}
+
+				waitpid(process_id, nullptr, 0);
+				return process_id;
+			}
+
+			// Leaves the identity overridden with 90 over a system brightness of 40.
+			pid_t CrashWhileOverriding()
+			{
+				return RunCrashingProcess([this]
+					{
+						RestoreJournal journal;
+						if (journal.Open(path_) != MonitorStatus::kOk || !journal.Record(kJournalIdentity, 90, 40))
+						{
+							_exit(1);
+						}
+					});
+			}
+		};
+
+		TEST_F(RestoreJournalTest, RecordsAndClearsOverride)
+		{
+			RestoreJournalEntry entry;
+			EXPECT_FALSE(journal_.Read(kJournalIdentity, entry));
+
+			ASSERT_TRUE(journal_.Record(kJournalIdentity, 80, 40));
+			ASSERT_TRUE(journal_.Record(kJournalIdentity, 90, 40));
+
+			// what the next process to open the file sees
+			RestoreJournal reopened;
+			ASSERT_EQ(reopened.Open(path_), MonitorStatus::kOk);
+			ASSERT_TRUE(reopened.Read(kJournalIdentity, entry));
+			EXPECT_EQ(entry.owner, journal_.process_id());
+			EXPECT_EQ(entry.value, 90);
+			EXPECT_EQ(entry.system_value, 40);
+
+			journal_.Clear(kJournalIdentity);
+			ASSERT_TRUE(reopened.Read(kJournalIdentity, entry));
+			EXPECT_EQ(entry.owner, 0u);
+		}
+
+		TEST_F(RestoreJournalTest, RecoversOverrideOfCrashedProcess)
+		{
+			const pid_t crashed_process_id = CrashWhileOverriding();
+
+			std::vector<RestoreJournalEntry> restored;
+			EXPECT_EQ(journal_.Recover([&restored](const RestoreJournalEntry& entry) { restored.push_back(entry); return true; }), 1u);
+			ASSERT_EQ(restored.size(), 1u);
+			EXPECT_EQ(restored[0].identity, kJournalIdentity);
+			EXPECT_EQ(restored[0].owner, static_cast<std::uint32_t>(crashed_process_id));
+			EXPECT_EQ(restored[0].value, 90);
+			EXPECT_EQ(restored[0].system_value, 40);
+
+			// restored once only
+			EXPECT_EQ(journal_.Recover([&restored](const RestoreJournalEntry& entry) { restored.push_back(entry); return true; }), 0u);
+			EXPECT_EQ(restored.size(), 1u);
+		}
+
+		TEST_F(RestoreJournalTest, KeepsEntryWhichCouldNotBeRestored)
+		{
+			const pid_t crashed_process_id = CrashWhileOverriding();
+
+			int call_count = 0;
+			EXPECT_EQ(journal_.Recover([&call_count](const RestoreJournalEntry&) { ++call_count; return false; }), 0u);
+			RestoreJournalEntry entry;
+			ASSERT_TRUE(journal_.Read(kJournalIdentity, entry));
+			EXPECT_EQ(entry.owner, static_cast<std::uint32_t>(crashed_process_id));
+
+			EXPECT_EQ(journal_.Recover([&call_count](const RestoreJournalEntry&) { ++call_count; return true; }), 1u);
+			EXPECT_EQ(call_count, 2);
+		}
+
+		TEST_F(RestoreJournalTest, LeavesOverridesOfLiveProcessesAlone)
+		{
+			ASSERT_TRUE(journal_.Record(kJournalIdentity, 90, 40));
+
+			// a newer override by a live process replaces the one of a crashed process
+			CrashWhileOverriding();
+			ASSERT_TRUE(journal_.Record(kJournalIdentity, 70, 40));
+
+			EXPECT_EQ(journal_.Recover([](const RestoreJournalEntry&) { return true; }), 0u);
+			RestoreJournalEntry entry;
+			ASSERT_TRUE(journal_.Read(kJournalIdentity, entry));
+			EXPECT_EQ(entry.owner, journal_.process_id());
+			EXPECT_EQ(entry.value, 70);
+		}
+
+		TEST_F(RestoreJournalTest, RecoversOverrideOfRecycledProcessId)
+		{
+			ASSERT_NE(GetOwnProcessIdentity().start_token, 0u);
+			RestoreJournal exited_journal;
+			ASSERT_EQ(exited_journal.Open(path_, GetRecycledProcessIdentity()), MonitorStatus::kOk);
+			ASSERT_TRUE(exited_journal.Record(kJournalIdentity, 90, 40));
+
+			std::vector<RestoreJournalEntry> restored;
+			EXPECT_EQ(journal_.Recover([&restored](const RestoreJournalEntry& entry) { restored.push_back(entry); return true; }), 1u);
+			ASSERT_EQ(restored.size(), 1u);
+			EXPECT_EQ(restored[0].owner, journal_.process_id());
+			EXPECT_EQ(restored[0].owner_start_token, GetRecycledProcessIdentity().start_token);
+		}
+
+		TEST_F(RestoreJournalTest, TakesSlotOnlyFromExitedWriter)
+		{
+			ASSERT_TRUE(journal_.Record(kJournalIdentity, 90, 40));
+
+			// a writer half way through a write, with the layout of version 3: a header and the reclaim lock, then slots of
+			// key, sequence, owner, writer
+			const off_t slot_offset = 16 + static_cast<off_t>(kJournalIdentity.value % RestoreJournal::kSlotCount) * 48;
+			const int file = open(path_.c_str(), O_RDWR);
+			ASSERT_GE(file, 0);
+			std::uint64_t sequence = 0;
+			ASSERT_EQ(pread(file, &sequence, sizeof(sequence), slot_offset + 8), static_cast<ssize_t>(sizeof(sequence)));
+			const std::uint64_t odd_sequence = sequence + 1;
+			ASSERT_EQ(pwrite(file, &odd_sequence, sizeof(odd_sequence), slot_offset + 8), static_cast<ssize_t>(sizeof(odd_sequence)));
+
+			// a live writer, e.g. one which is stopped, keeps the slot
+			const std::uint64_t live_writer = GetOwnProcessIdentity().ToWord();
+			ASSERT_EQ(pwrite(file, &live_writer, sizeof(live_writer), slot_offset + 24), static_cast<ssize_t>(sizeof(live_writer)));
+			EXPECT_FALSE(journal_.Record(kJournalIdentity, 70, 40));
+
+			const std::uint64_t exited_writer = GetRecycledProcessIdentity().ToWord();
+			ASSERT_EQ(pwrite(file, &exited_writer, sizeof(exited_writer), slot_offset + 24), static_cast<ssize_t>(sizeof(exited_writer)));
+			EXPECT_TRUE(journal_.Record(kJournalIdentity, 60, 40));
+
+			ASSERT_EQ(pread(file, &sequence, sizeof(sequence), slot_offset + 8), static_cast<ssize_t>(sizeof(sequence)));
+			EXPECT_EQ(sequence, odd_sequence + 1);
+			close(file);
+
+			RestoreJournalEntry entry;
+			ASSERT_TRUE(journal_.Read(kJournalIdentity, entry));
+			EXPECT_EQ(entry.value, 60);
+		}
+
+		TEST_F(RestoreJournalTest, ReusesSlotsOfRestoredDisplays)
+		{
+			// more displays over time than there are slots, each restored before the next
+			for (std::uint64_t index = 1; index <= RestoreJournal::kSlotCount * 2; ++index)
+			{
+				const DisplayIdentity identity{ kJournalIdentity.value + index };
+				ASSERT_TRUE(journal_.Record(identity, 90, 40)) << index;
+				journal_.Clear(identity);
+			}
+
+			// a display with an override keeps its slot
+			ASSERT_TRUE(journal_.Record(kJournalIdentity, 90, 40));
+			for (std::uint64_t index = 1; index < RestoreJournal::kSlotCount; ++index)
+			{
+				ASSERT_TRUE(journal_.Record(DisplayIdentity{ kJournalIdentity.value + index }, 80, 40)) << index;
+			}
+
+			EXPECT_FALSE(journal_.Record(DisplayIdentity{ kJournalIdentity.value + RestoreJournal::kSlotCount }, 80, 40));
+			RestoreJournalEntry entry;
+			ASSERT_TRUE(journal_.Read(kJournalIdentity, entry));
+			EXPECT_EQ(entry.value, 90);
+			EXPECT_EQ(entry.owner, journal_.process_id());
+		}
+
+		class BrightnessServiceJournalTest : public RestoreJournalTest
+		{
+		protected:
+			FakeMonitorBackend* backend_ = nullptr;
+
+			DisplayHandle display_ = 0;
+
+			std::shared_ptr<BrightnessService> CreateService()
+			{
+				auto backend = std::make_unique<FakeMonitorBackend>();
+				backend_ = backend.get();
+				display_ = backend->AddDisplay({ "first", 0, 40, 100 });
+				auto service = std::make_shared<BrightnessService>(std::move(backend), Clock::Steady(), std::chrono::milliseconds(0), false);
+				EXPECT_EQ(service->OpenRestoreJournal(path_), MonitorStatus::kOk);
+				return service;
+			}
+		};
+
+		TEST_F(BrightnessServiceJournalTest, JournalsOverrideUntilRestored)
+		{
+			BrightnessClient client(CreateService());
+			client.SetDisplay(display_);
+			client.Initialize();
+			const DisplayIdentity identity = GetDisplayIdentity(std::string_view("first"));
+
+			ASSERT_EQ(client.SetApplicationScreenBrightness(0.7), MonitorStatus::kOk);
+			RestoreJournalEntry entry;
+			ASSERT_TRUE(journal_.Read(identity, entry));
+			EXPECT_EQ(entry.owner, journal_.process_id());
+			EXPECT_EQ(entry.value, 70);
+			EXPECT_EQ(entry.system_value, 40);
+
+			ASSERT_EQ(client.ResetApplicationScreenBrightness(), MonitorStatus::kOk);
+			ASSERT_TRUE(journal_.Read(identity, entry));
+			EXPECT_EQ(entry.owner, 0u);
+		}
+
+		TEST_F(BrightnessServiceJournalTest, NextProcessRestoresAfterCrash)
+		{
+			RunCrashingProcess([this]
+				{
+					BrightnessClient client(CreateService());
+					client.SetDisplay(display_);
+					client.Initialize();
+					if (client.SetApplicationScreenBrightness(0.7) != MonitorStatus::kOk)
+					{
+						_exit(1);
+					}
+
+					// dies with the override applied
+					_exit(0);
+				});
+
+			// the monitor still shows the override
+			std::shared_ptr<BrightnessService> service = CreateService();
+			backend_->GetDisplay(display_).brightness = 70;
+
+			const std::vector<DisplayRestoreResult> results = service->RecoverRestoreJournal();
+
+			ASSERT_EQ(results.size(), 1u);
+			EXPECT_EQ(results[0].display, display_);
+			EXPECT_EQ(results[0].status, MonitorStatus::kOk);
+			EXPECT_EQ(backend_->GetDisplay(display_).brightness, 40);
+			EXPECT_TRUE(service->RecoverRestoreJournal().empty());
+
+			BrightnessClient client(service);
+			client.SetDisplay(display_);
+			client.Initialize();
+			EXPECT_DOUBLE_EQ(client.GetSystemScreenBrightness(), 0.4);
+		}
+	}
+}
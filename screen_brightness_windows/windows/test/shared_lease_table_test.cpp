@@ -0,0 +1,400 @@
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <new>
+#include <string>
+
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "screen_brightness_windows/brightness_service.h"
+#include "screen_brightness_windows/display_identity.h"
+#include "screen_brightness_windows/fake_monitor_backend.h"
+#include "screen_brightness_windows/shared_lease_table.h"
+
+namespace screen_brightness
+{
+	namespace test
+	{
+		constexpr DisplayIdentity kIdentity{ 0x1234 };
+
+		// A process which takes a lease, publishes a value and holds on to the lease until told to exit.
+		class LeaseHolderProcess
+		{
+		public:
+			LeaseHolderProcess(const std::string& name, const DisplayIdentity identity, const long value, const long system_value)
+			{
+				int ready_pipe[2];
+				if (pipe(ready_pipe) != 0 || pipe(exit_pipe_) != 0)
+				{
+					return;
+				}
+
+				process_id_ = fork();
+				if (process_id_ == 0)
+				{
+					SharedLeaseTable table;
+					char byte = table.Open(name) == MonitorStatus::kOk && table.Acquire(identity) &&
+						table.Publish(identity, value, system_value) ? 1 : 0;
+					(void)!write(ready_pipe[1], &byte, 1);
+
+					// returns once the parent closes its end of the pipe
+					close(exit_pipe_[1]);
+					(void)!read(exit_pipe_[0], &byte, 1);
+					_exit(0);
+				}
+
+				char byte = 0;
+				(void)!read(ready_pipe[0], &byte, 1);
+				is_ready_ = byte == 1;
+				close(ready_pipe[0]);
+				close(ready_pipe[1]);
+			}
+
+			~LeaseHolderProcess()
+			{
+				Exit();
+			}
+
+			[[nodiscard]] bool is_ready() const { return is_ready_; }
+
+			[[nodiscard]] pid_t process_id() const { return process_id_; }
+
+			// Exits without releasing the lease.
+			void Exit()
+			{
+				if (process_id_ <= 0)
+				{
+					return;
+				}
+
+				close(exit_pipe_[1]);
+				close(exit_pipe_[0]);
+				waitpid(process_id_, nullptr, 0);
+				process_id_ = -1;
+			}
+
+		private:
+			pid_t process_id_ = -1;
+
+			int exit_pipe_[2] = { -1, -1 };
+
+			bool is_ready_ = false;
+		};
+
+		class SharedLeaseTableTest : public ::testing::Test
+		{
+		protected:
+			const std::string name_ = "screen_brightness_test_" + std::to_string(getpid());
+
+			SharedLeaseTable table_;
+
+			void SetUp() override
+			{
+				SharedLeaseTable::Remove(name_);
+				ASSERT_EQ(table_.Open(name_), MonitorStatus::kOk);
+			}
+
+			void TearDown() override
+			{
+				SharedLeaseTable::Remove(name_);
+			}
+		};
+
+		TEST_F(SharedLeaseTableTest, PublishesUnderLease)
+		{
+			SharedLeaseEntry entry;
+			EXPECT_FALSE(table_.Read(kIdentity, entry));
+			EXPECT_FALSE(table_.Publish(kIdentity, 80, 40));
+
+			ASSERT_TRUE(table_.TryAcquire(kIdentity));
+			EXPECT_TRUE(table_.IsHeld(kIdentity));
+			ASSERT_TRUE(table_.Publish(kIdentity, 80, 40));
+			ASSERT_TRUE(table_.Publish(kIdentity, 90, 40));
+
+			ASSERT_TRUE(table_.Read(kIdentity, entry));
+			EXPECT_EQ(entry.owner, table_.process_id());
+			EXPECT_TRUE(entry.is_owner_alive);
+			EXPECT_EQ(entry.value, 90);
+			EXPECT_EQ(entry.system_value, 40);
+			EXPECT_EQ(entry.generation, 2u);
+
+			table_.Release(kIdentity);
+			EXPECT_FALSE(table_.IsHeld(kIdentity));
+			EXPECT_FALSE(table_.Publish(kIdentity, 100, 40));
+			ASSERT_TRUE(table_.Read(kIdentity, entry));
+			EXPECT_EQ(entry.owner, 0u);
+			EXPECT_EQ(entry.value, 90);
+		}
+
+		TEST_F(SharedLeaseTableTest, SeparateDisplaysHaveSeparateLeases)
+		{
+			for (std::uint64_t value = 1; value <= SharedLeaseTable::kSlotCount; ++value)
+			{
+				ASSERT_TRUE(table_.Acquire(DisplayIdentity{ value * SharedLeaseTable::kSlotCount }));
+				ASSERT_TRUE(table_.Publish(DisplayIdentity{ value * SharedLeaseTable::kSlotCount }, static_cast<long>(value), 0));
+			}
+
+			// all slots are taken
+			EXPECT_FALSE(table_.Acquire(DisplayIdentity{ 7 }));
+
+			SharedLeaseEntry entry;
+			ASSERT_TRUE(table_.Read(DisplayIdentity{ 5 * SharedLeaseTable::kSlotCount }, entry));
+			EXPECT_EQ(entry.value, 5);
+		}
+
+		TEST_F(SharedLeaseTableTest, ReclaimsSlotsOfReleasedLeases)
+		{
+			for (std::uint64_t value = 1; value <= SharedLeaseTable::kSlotCount; ++value)
+			{
+				ASSERT_TRUE(table_.Acquire(DisplayIdentity{ value }));
+				ASSERT_TRUE(table_.Publish(DisplayIdentity{ value }, static_cast<long>(value), 0));
+			}
+
+			EXPECT_FALSE(table_.Acquire(DisplayIdentity{ 100 }));
+			table_.Release(DisplayIdentity{ 5 });
+
+			// the display takes over the released slot, without its values
+			ASSERT_TRUE(table_.TryAcquire(DisplayIdentity{ 100 }));
+			EXPECT_TRUE(table_.IsHeld(DisplayIdentity{ 100 }));
+			SharedLeaseEntry entry;
+			ASSERT_TRUE(table_.Read(DisplayIdentity{ 100 }, entry));
+			EXPECT_EQ(entry.generation, 0u);
+			EXPECT_EQ(entry.value, -1);
+			EXPECT_FALSE(table_.Read(DisplayIdentity{ 5 }, entry));
+			ASSERT_TRUE(table_.Publish(DisplayIdentity{ 100 }, 70, 0));
+			ASSERT_TRUE(table_.Read(DisplayIdentity{ 100 }, entry));
+			EXPECT_EQ(entry.value, 70);
+
+			// the other displays keep theirs
+			ASSERT_TRUE(table_.Read(DisplayIdentity{ 6 }, entry));
+			EXPECT_EQ(entry.value, 6);
+			EXPECT_TRUE(table_.IsHeld(DisplayIdentity{ 6 }));
+			EXPECT_FALSE(table_.Acquire(DisplayIdentity{ 101 }));
+		}
+
+		TEST_F(SharedLeaseTableTest, ReclaimsSlotsOfExitedHolders)
+		{
+			for (std::uint64_t value = 1; value <= SharedLeaseTable::kSlotCount; ++value)
+			{
+				LeaseHolderProcess holder(name_, DisplayIdentity{ value }, static_cast<long>(value), 0);
+				ASSERT_TRUE(holder.is_ready());
+			}
+
+			ASSERT_TRUE(table_.TryAcquire(DisplayIdentity{ 100 }));
+			ASSERT_TRUE(table_.Publish(DisplayIdentity{ 100 }, 70, 0));
+			SharedLeaseEntry entry;
+			ASSERT_TRUE(table_.Read(DisplayIdentity{ 100 }, entry));
+			EXPECT_EQ(entry.value, 70);
+		}
+
+		TEST_F(SharedLeaseTableTest, RecycledProcessIdDoesNotHoldLease)
+		{
+			// a process which has exited, and whose id has been given to this one
+			const ProcessIdentity own = GetOwnProcessIdentity();
+			ASSERT_NE(own.start_token, 0u);
+			SharedLeaseTable exited_table;
+			ASSERT_EQ(exited_table.Open(name_, ProcessIdentity{ own.id, own.start_token ^ 0x5a5a }), MonitorStatus::kOk);
+			ASSERT_TRUE(exited_table.Acquire(kIdentity));
+			ASSERT_TRUE(exited_table.Publish(kIdentity, 90, 40));
+
+			SharedLeaseEntry entry;
+			ASSERT_TRUE(table_.Read(kIdentity, entry));
+			EXPECT_EQ(entry.owner, own.id);
+			EXPECT_FALSE(entry.is_owner_alive);
+			EXPECT_FALSE(table_.IsHeld(kIdentity));
+			EXPECT_TRUE(table_.TryAcquire(kIdentity));
+			EXPECT_FALSE(exited_table.IsHeld(kIdentity));
+		}
+
+		TEST_F(SharedLeaseTableTest, OtherProcessHoldsLeaseUntilItExits)
+		{
+			LeaseHolderProcess holder(name_, kIdentity, 90, 40);
+			ASSERT_TRUE(holder.is_ready());
+
+			EXPECT_FALSE(table_.TryAcquire(kIdentity));
+			SharedLeaseEntry entry;
+			ASSERT_TRUE(table_.Read(kIdentity, entry));
+			EXPECT_EQ(entry.owner, static_cast<std::uint32_t>(holder.process_id()));
+			EXPECT_TRUE(entry.is_owner_alive);
+			EXPECT_EQ(entry.value, 90);
+
+			holder.Exit();
+
+			ASSERT_TRUE(table_.Read(kIdentity, entry));
+			EXPECT_FALSE(entry.is_owner_alive);
+			EXPECT_TRUE(table_.TryAcquire(kIdentity));
+		}
+
+		TEST_F(SharedLeaseTableTest, AcquireTakesOverLiveLease)
+		{
+			LeaseHolderProcess holder(name_, kIdentity, 90, 40);
+			ASSERT_TRUE(holder.is_ready());
+
+			ASSERT_TRUE(table_.Acquire(kIdentity));
+
+			EXPECT_TRUE(table_.IsHeld(kIdentity));
+			EXPECT_TRUE(table_.Publish(kIdentity, 20, 40));
+		}
+
+		TEST_F(SharedLeaseTableTest, ProcessesStressLeases)
+		{
+			constexpr int kProcessCount = 6;
+			constexpr int kIterationCount = 3000;
+
+			struct Shared
+			{
+				std::atomic<int> holder_count;
+
+				std::atomic<int> publish_count;
+
+				std::atomic<int> violation_count;
+			};
+
+			void* memory = mmap(nullptr, sizeof(Shared), PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+			ASSERT_NE(memory, MAP_FAILED);
+			Shared* shared = new (memory) Shared{};
+
+			pid_t children[kProcessCount];
+			for (pid_t& child : children)
+			{
+				child = fork();
+				if (child != 0)
+				{
+					continue;
+				}
+
+				SharedLeaseTable table;
+				if (table.Open(name_) != MonitorStatus::kOk)
+				{
+					_exit(1);
+				}
+
+				for (int iteration = 0; iteration < kIterationCount; ++iteration)
+				{
+					// every value ever published is three times its generation
+					SharedLeaseEntry entry;
+					if (table.Read(kIdentity, entry) && entry.generation != 0 && entry.value != static_cast<long>(entry.generation * 3))
+					{
+						++shared->violation_count;
+					}
+
+					if (!table.TryAcquire(kIdentity))
+					{
+						continue;
+					}
+
+					if (shared->holder_count.fetch_add(1) != 0)
+					{
+						++shared->violation_count;
+					}
+
+					if (table.Read(kIdentity, entry) && table.Publish(kIdentity, static_cast<long>((entry.generation + 1) * 3), 0))
+					{
+						++shared->publish_count;
+					}
+
+					--shared->holder_count;
+					table.Release(kIdentity);
+				}
+
+				_exit(0);
+			}
+
+			for (const pid_t child : children)
+			{
+				int status = 0;
+				ASSERT_EQ(waitpid(child, &status, 0), child);
+				EXPECT_TRUE(WIFEXITED(status) && WEXITSTATUS(status) == 0);
+			}
+
+			SharedLeaseEntry entry;
+			ASSERT_TRUE(table_.Read(kIdentity, entry));
+			EXPECT_EQ(shared->violation_count.load(), 0);
+			EXPECT_GT(shared->publish_count.load(), 0);
+			EXPECT_EQ(entry.generation, static_cast<std::uint64_t>(shared->publish_count.load()));
+			EXPECT_EQ(entry.owner, 0u);
+			munmap(memory, sizeof(Shared));
+		}
+
+		class BrightnessServiceLeaseTest : public SharedLeaseTableTest
+		{
+		protected:
+			FakeMonitorBackend* backend_ = nullptr;
+
+			DisplayHandle display_ = 0;
+
+			// what every process derives for the fake display, which has no EDID
+			const DisplayIdentity identity_ = GetDisplayIdentity(std::string_view("first"));
+
+			std::unique_ptr<BrightnessClient> client_;
+
+			void StartClient()
+			{
+				auto backend = std::make_unique<FakeMonitorBackend>();
+				backend_ = backend.get();
+				display_ = backend->AddDisplay({ "first", 0, 90, 100 });
+				auto service = std::make_shared<BrightnessService>(std::move(backend), Clock::Steady(), std::chrono::milliseconds(0), false);
+				ASSERT_EQ(service->OpenLeaseTable(name_), MonitorStatus::kOk);
+				client_ = std::make_unique<BrightnessClient>(std::move(service));
+				client_->SetDisplay(display_);
+				client_->Initialize();
+			}
+		};
+
+		TEST_F(BrightnessServiceLeaseTest, UsesValuesPublishedByOtherProcess)
+		{
+			// the other process shows 90 over a system brightness of 40
+			LeaseHolderProcess holder(name_, identity_, 90, 40);
+			ASSERT_TRUE(holder.is_ready());
+
+			StartClient();
+			const long get_count = backend_->get_count();
+
+			EXPECT_DOUBLE_EQ(client_->GetSystemScreenBrightness(), 0.4);
+			double brightness = 0;
+			ASSERT_EQ(client_->GetApplicationScreenBrightness(brightness), MonitorStatus::kOk);
+			EXPECT_DOUBLE_EQ(brightness, 0.9);
+			EXPECT_EQ(backend_->get_count(), get_count);
+		}
+
+		TEST_F(BrightnessServiceLeaseTest, RestoreIsSkippedAfterOtherProcessTookOver)
+		{
+			StartClient();
+			ASSERT_EQ(client_->SetApplicationScreenBrightness(0.7), MonitorStatus::kOk);
+			EXPECT_TRUE(table_.IsHeld(identity_));
+
+			// another application is brought to the front and overrides the display
+			LeaseHolderProcess holder(name_, identity_, 20, 90);
+			ASSERT_TRUE(holder.is_ready());
+			backend_->GetDisplay(display_).brightness = 20;
+			const long set_count = backend_->set_count();
+
+			client_->OnApplicationPause();
+
+			EXPECT_EQ(backend_->set_count(), set_count);
+			EXPECT_EQ(backend_->GetDisplay(display_).brightness, 20);
+		}
+
+		TEST_F(BrightnessServiceLeaseTest, RestoreReleasesLease)
+		{
+			StartClient();
+			ASSERT_EQ(client_->SetApplicationScreenBrightness(0.7), MonitorStatus::kOk);
+			SharedLeaseEntry entry;
+			ASSERT_TRUE(table_.Read(identity_, entry));
+			EXPECT_EQ(entry.owner, table_.process_id());
+			EXPECT_EQ(entry.value, 70);
+			EXPECT_EQ(entry.system_value, 90);
+
+			client_->OnApplicationPause();
+
+			EXPECT_EQ(backend_->GetDisplay(display_).brightness, 90);
+			ASSERT_TRUE(table_.Read(identity_, entry));
+			EXPECT_EQ(entry.owner, 0u);
+			EXPECT_EQ(entry.value, 90);
+		}
+	}
+}
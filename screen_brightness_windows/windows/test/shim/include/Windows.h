@@ -0,0 +1,186 @@
+#ifndef SCREEN_BRIGHTNESS_WINDOWS_SHIM_WINDOWS_H
+#define SCREEN_BRIGHTNESS_WINDOWS_SHIM_WINDOWS_H
+
+// Test-only stand-in for the subset of Windows.h the plugin uses, so that it builds with GCC and Clang. The functions
+// are backed by the fake system of fake_windows.h. Unlike the real header, this one defines no min and max macros.
+
+#include <cstddef>
+#include <cstdint>
+
+#ifndef _MSC_VER
+#ifndef __declspec
+#define __declspec(attribute)
+#endif
+#endif
+
+#define CALLBACK
+#define WINAPI
+
+#ifndef TRUE
+#define TRUE 1
+#endif
+
+#ifndef FALSE
+#define FALSE 0
+#endif
+
+#define MAX_PATH 260
+
+#define CCHDEVICENAME 32
+
+typedef int BOOL;
+typedef unsigned char BYTE;
+typedef std::uint16_t WORD;
+typedef std::uint32_t DWORD;
+typedef DWORD* LPDWORD;
+typedef std::int32_t LONG;
+typedef unsigned int UINT;
+typedef std::uintptr_t UINT_PTR;
+typedef std::intptr_t LONG_PTR;
+typedef UINT_PTR WPARAM;
+typedef LONG_PTR LPARAM;
+typedef LONG_PTR LRESULT;
+typedef char* LPSTR;
+typedef const char* LPCSTR;
+typedef void* PVOID;
+typedef void* HANDLE;
+typedef LONG LSTATUS;
+
+typedef struct HWND__* HWND;
+typedef struct HMONITOR__* HMONITOR;
+typedef struct HDC__* HDC;
+typedef struct HKEY__* HKEY;
+
+struct POINT
+{
+	LONG x;
+
+	LONG y;
+};
+
+struct RECT
+{
+	LONG left;
+
+	LONG top;
+
+	LONG right;
+
+	LONG bottom;
+};
+
+typedef RECT* LPRECT;
+
+struct MONITORINFO
+{
+	DWORD cbSize;
+
+	RECT rcMonitor;
+
+	RECT rcWork;
+
+	DWORD dwFlags;
+};
+
+typedef MONITORINFO* LPMONITORINFO;
+
+struct MONITORINFOEXA : MONITORINFO
+{
+	char szDevice[CCHDEVICENAME];
+};
+
+#define MONITORINFOF_PRIMARY 0x00000001
+
+struct DISPLAY_DEVICEA
+{
+	DWORD cb;
+
+	char DeviceName[32];
+
+	char DeviceString[128];
+
+	DWORD StateFlags;
+
+	char DeviceID[128];
+
+	char DeviceKey[128];
+};
+
+typedef DISPLAY_DEVICEA* PDISPLAY_DEVICEA;
+
+struct LASTINPUTINFO
+{
+	UINT cbSize;
+
+	DWORD dwTime;
+};
+
+typedef LASTINPUTINFO* PLASTINPUTINFO;
+
+typedef BOOL (CALLBACK* MONITORENUMPROC)(HMONITOR, HDC, LPRECT, LPARAM);
+
+typedef void (CALLBACK* TIMERPROC)(HWND, UINT, UINT_PTR, DWORD);
+
+#define MONITOR_DEFAULTTONULL 0x00000000
+#define MONITOR_DEFAULTTOPRIMARY 0x00000001
+#define MONITOR_DEFAULTTONEAREST 0x00000002
+
+#define EDD_GET_DEVICE_INTERFACE_NAME 0x00000001
+
+#define GA_PARENT 1
+#define GA_ROOT 2
+
+#define WM_DESTROY 0x0002
+#define WM_MOVE 0x0003
+#define WM_SIZE 0x0005
+#define WM_CLOSE 0x0010
+#define WM_ACTIVATEAPP 0x001C
+#define WM_DISPLAYCHANGE 0x007E
+#define WM_TIMER 0x0113
+#define WM_DPICHANGED 0x02E0
+#define WM_USER 0x0400
+
+#define SIZE_RESTORED 0
+#define SIZE_MINIMIZED 1
+#define SIZE_MAXIMIZED 2
+
+#define USER_TIMER_MINIMUM 0x0000000A
+#define USER_TIMER_MAXIMUM 0x7FFFFFFF
+
+#define HKEY_LOCAL_MACHINE (reinterpret_cast<HKEY>(static_cast<std::uintptr_t>(0x80000002)))
+
+#define RRF_RT_REG_BINARY 0x00000008
+
+#define ERROR_SUCCESS 0L
+#define ERROR_FILE_NOT_FOUND 2L
+#define ERROR_MORE_DATA 234L
+
+HWND GetAncestor(HWND hwnd, UINT flags);
+
+UINT_PTR SetTimer(HWND hwnd, UINT_PTR id, UINT elapse, TIMERPROC timer_function);
+
+BOOL KillTimer(HWND hwnd, UINT_PTR id);
+
+UINT RegisterWindowMessageA(LPCSTR string);
+
+BOOL PostMessageA(HWND hwnd, UINT message, WPARAM wparam, LPARAM lparam);
+
+#define PostMessage PostMessageA
+
+HMONITOR MonitorFromWindow(HWND hwnd, DWORD flags);
+
+HMONITOR MonitorFromPoint(POINT point, DWORD flags);
+
+BOOL GetMonitorInfoA(HMONITOR monitor, LPMONITORINFO monitor_info);
+
+BOOL EnumDisplayMonitors(HDC hdc, LPRECT clip, MONITORENUMPROC callback, LPARAM data);
+
+BOOL EnumDisplayDevicesA(LPCSTR device, DWORD device_index, PDISPLAY_DEVICEA display_device, DWORD flags);
+
+LSTATUS RegGetValueA(HKEY key, LPCSTR sub_key, LPCSTR value, DWORD flags, LPDWORD type, PVOID data, LPDWORD data_size);
+
+BOOL GetLastInputInfo(PLASTINPUTINFO last_input_info);
+
+DWORD GetTickCount();
+
+#endif
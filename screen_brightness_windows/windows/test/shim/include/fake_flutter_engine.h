@@ -0,0 +1,136 @@
+#ifndef SCREEN_BRIGHTNESS_WINDOWS_SHIM_FAKE_FLUTTER_ENGINE_H
+#define SCREEN_BRIGHTNESS_WINDOWS_SHIM_FAKE_FLUTTER_ENGINE_H
+
+#include <Windows.h>
+
+#include <flutter/binary_messenger.h>
+#include <flutter/encodable_value.h>
+#include <flutter_plugin_registrar.h>
+
+#include <atomic>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <thread>
+
+// What the engine keeps of a plugin registrar: its messenger, its view and the top-level window procedure of its
+// PluginRegistrarWindows.
+struct FlutterDesktopPluginRegistrar
+{
+	flutter::BinaryMessenger* messenger = nullptr;
+
+	HWND view_window = nullptr;
+
+	std::function<std::optional<LRESULT>(HWND hwnd, UINT message, WPARAM wparam, LPARAM lparam)> top_level_window_proc;
+
+	FlutterDesktopOnPluginRegistrarDestroyed destruction_handler = nullptr;
+};
+
+namespace fake_flutter
+{
+	// A message from the platform to Dart as Dart decodes it: a method call's reply or an event.
+	struct Envelope
+	{
+		// false for an empty message: a method which is not implemented, or the end of an event stream
+		bool is_present = false;
+
+		bool is_error = false;
+
+		// the result, or the error's details
+		flutter::EncodableValue value;
+
+		std::string error_code;
+
+		std::string error_message;
+	};
+
+	using DartMessageHandler = std::function<void(const std::uint8_t* message, std::size_t message_size)>;
+
+	// Messages between the plugin and a stand-in for Dart. The plugin's handlers run on the calling thread, which is
+	// the platform thread as far as the plugin can tell. Messages to Dart may come from any thread; Flutter only
+	// accepts them from the platform thread, so those sent from elsewhere are counted.
+	class FakeBinaryMessenger final : public flutter::BinaryMessenger
+	{
+	public:
+		FakeBinaryMessenger();
+
+		void Send(const std::string& channel, const std::uint8_t* message, std::size_t message_size, flutter::BinaryReply reply = nullptr) const override;
+
+		void SetMessageHandler(const std::string& channel, flutter::BinaryMessageHandler handler) override;
+
+		// Receives the messages the plugin sends on the channel; null stops receiving them.
+		void SetDartMessageHandler(const std::string& channel, DartMessageHandler handler);
+
+		// Sends a message from Dart to the plugin's handler. A channel without a handler replies with an empty message.
+		void SendToPlatform(const std::string& channel, const std::uint8_t* message, std::size_t message_size, const flutter::BinaryReply& reply);
+
+		[[nodiscard]] bool HasMessageHandler(const std::string& channel) const;
+
+		[[nodiscard]] size_t off_platform_thread_message_count() const { return off_platform_thread_message_count_.load(); }
+
+	private:
+		std::thread::id platform_thread_id_;
+
+		mutable std::mutex mutex_;
+
+		std::map<std::string, flutter::BinaryMessageHandler> message_handlers_;
+
+		std::map<std::string, DartMessageHandler> dart_message_handlers_;
+
+		mutable std::atomic<size_t> off_platform_thread_message_count_{ 0 };
+	};
+
+	// An engine running in a view of a top-level window, created on the platform thread. The runner's window
+	// procedure, installed on the top-level window, gives the plugins' delegates each message first, as
+	// FlutterWindow::MessageHandler does. Destroying the engine destroys its plugins.
+	class FakeFlutterEngine final
+	{
+	public:
+		explicit FakeFlutterEngine(HWND top_level_window);
+
+		~FakeFlutterEngine();
+
+		FakeFlutterEngine(const FakeFlutterEngine&) = delete;
+
+		FakeFlutterEngine& operator=(const FakeFlutterEngine&) = delete;
+
+		[[nodiscard]] FlutterDesktopPluginRegistrarRef GetRegistrarForPlugin(const char* plugin_name);
+
+		[[nodiscard]] FakeBinaryMessenger& messenger() { return messenger_; }
+
+		[[nodiscard]] HWND top_level_window() const { return top_level_window_; }
+
+		[[nodiscard]] HWND view_window() const { return registrar_.view_window; }
+
+		std::optional<LRESULT> HandleTopLevelWindowProc(HWND hwnd, UINT message, WPARAM wparam, LPARAM lparam);
+
+		// Calls the method as a MethodChannel in Dart does, encoded with the standard method codec, and returns the
+		// reply the plugin sent before its handler returned, or an empty one. Null arguments are sent as such.
+		Envelope InvokeMethod(const std::string& channel, const std::string& method, const flutter::EncodableValue& arguments = flutter::EncodableValue());
+
+		// As InvokeMethod, for a plugin which may reply after its handler has returned: on_reply gets the reply when the
+		// plugin sends it.
+		void InvokeMethodAsync(const std::string& channel, const std::string& method, const flutter::EncodableValue& arguments,
+			std::function<void(const Envelope& reply)> on_reply);
+
+		// Listens to the event channel as an EventChannel in Dart does, receiving the decoded events on the thread
+		// which sends them. Returns the reply to the listen call.
+		Envelope Listen(const std::string& channel, std::function<void(const Envelope& event)> on_event);
+
+		Envelope Cancel(const std::string& channel);
+
+		// Decodes a reply or an event.
+		[[nodiscard]] static Envelope DecodeEnvelope(const std::uint8_t* message, std::size_t message_size);
+
+	private:
+		HWND top_level_window_;
+
+		FakeBinaryMessenger messenger_;
+
+		FlutterDesktopPluginRegistrar registrar_;
+	};
+}
+
+#endif
@@ -0,0 +1,146 @@
+#ifndef SCREEN_BRIGHTNESS_WINDOWS_SHIM_FAKE_WINDOWS_H
+#define SCREEN_BRIGHTNESS_WINDOWS_SHIM_FAKE_WINDOWS_H
+
+#include <Windows.h>
+
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+// Controls the fake system behind the shim's Windows.h and DXVA2 functions: monitors with DDC/CI brightness, windows
+// with message queues and timers, and the last input time. The functions may be called from any thread; messages are
+// delivered on the thread calling DispatchMessages, which plays the UI thread.
+//
+// How each DDC/CI call of a monitor behaves can be scripted, and every call is logged.
+namespace fake_windows
+{
+	// The DXVA2 functions which talk to the monitor over DDC/CI.
+	enum class DdcFunction
+	{
+		kGetMonitorBrightness,
+		kSetMonitorBrightness,
+		kGetVcpFeature,
+		kSetVcpFeature,
+		kGetCapabilitiesStringLength,
+		kCapabilitiesRequest,
+	};
+
+	[[nodiscard]] const char* GetDdcFunctionName(DdcFunction function);
+
+	// How one call behaves.
+	struct DdcStep
+	{
+		// instead of the monitor's latency
+		std::chrono::microseconds latency{ 0 };
+
+		// the call returns FALSE after the latency
+		bool is_failure = false;
+
+		// the call blocks until ReleaseHungCalls, then fails, as with a monitor which stopped answering
+		bool is_hang = false;
+	};
+
+	struct DdcCall
+	{
+		HMONITOR monitor = nullptr;
+
+		DdcFunction function = DdcFunction::kGetMonitorBrightness;
+
+		// the value set, 0 for a read
+		DWORD value = 0;
+
+		BOOL result = FALSE;
+
+		std::chrono::steady_clock::time_point start_time{};
+
+		std::chrono::steady_clock::duration duration{};
+	};
+
+	struct MonitorConfig
+	{
+		// the PnP id in the device interface path, e.g. DEL for \\?\DISPLAY#DEL4123#...
+		std::string manufacturer = "FAK";
+
+		RECT rect{ 0, 0, 1920, 1080 };
+
+		DWORD minimum_brightness = 0;
+
+		DWORD brightness = 50;
+
+		DWORD maximum_brightness = 100;
+
+		// of every DDC/CI call, which real monitors answer in 30 to 200 ms
+		std::chrono::microseconds latency{ 0 };
+
+		std::string capabilities = "(prot(monitor)type(lcd)model(FAKE)cmds(01 02 03 07 0C F3)vcp(02 04 10 12 14(05 08 0B) 60(0F 11) 62 D6(01 04))mccs_ver(2.2))";
+
+		// empty for a generated one naming the monitor
+		std::vector<std::uint8_t> edid;
+	};
+
+	using WindowProc = std::function<LRESULT(HWND hwnd, UINT message, WPARAM wparam, LPARAM lparam)>;
+
+	// The first monitor added is the primary one. Posts WM_DISPLAYCHANGE to the top-level windows.
+	HMONITOR AddMonitor(const MonitorConfig& config = {});
+
+	// Moves the windows on the monitor to the primary one. Posts WM_DISPLAYCHANGE to the top-level windows.
+	void RemoveMonitor(HMONITOR monitor);
+
+	// The brightness the monitor was last set to, 0 for an unknown monitor.
+	[[nodiscard]] DWORD GetBrightness(HMONITOR monitor);
+
+	[[nodiscard]] size_t GetSetBrightnessCount(HMONITOR monitor);
+
+	// Scripts the next calls of the function on the monitor, in order, after any scripted before. Calls beyond the
+	// script succeed after the monitor's latency.
+	void ScriptDdcCalls(HMONITOR monitor, DdcFunction function, const std::vector<DdcStep>& steps);
+
+	// Lets the hung calls fail, and those hanging later too until the next Reset.
+	void ReleaseHungCalls();
+
+	// The calls in progress which are hung.
+	[[nodiscard]] size_t GetHungCallCount();
+
+	// The latest calls, oldest first, up to kDdcCallLogSize.
+	[[nodiscard]] std::vector<DdcCall> GetDdcCallLog();
+
+	constexpr size_t kDdcCallLogSize = 65536;
+
+	void ClearDdcCallLog();
+
+	// Physical monitor handles which were not destroyed, which DestroyPhysicalMonitors must get back.
+	[[nodiscard]] size_t GetOpenPhysicalMonitorCount();
+
+	HWND CreateTopLevelWindow(HMONITOR monitor);
+
+	HWND CreateChildWindow(HWND parent);
+
+	// Drops the window's queued messages and timers, and those of its children.
+	void DestroyWindow(HWND hwnd);
+
+	// Posts WM_MOVE to the top-level window.
+	void MoveWindowToMonitor(HWND hwnd, HMONITOR monitor);
+
+	// Receives the messages dispatched to the window; null drops them.
+	void SetWindowProc(HWND hwnd, WindowProc window_proc);
+
+	// Queues the message for the next DispatchMessages; PostMessageA does the same.
+	void PostWindowMessage(HWND hwnd, UINT message, WPARAM wparam = 0, LPARAM lparam = 0);
+
+	// Delivers the posted messages, then WM_TIMER for the timers which are due, to the window procedures on the
+	// calling thread. Returns the number of messages delivered.
+	size_t DispatchMessages();
+
+	// When the next timer is due, or time_point::max() without timers.
+	[[nodiscard]] std::chrono::steady_clock::time_point GetNextTimerTime();
+
+	// Makes now the time of the last input.
+	void SimulateInput();
+
+	// Removes every monitor, window and script, releasing the hung calls, and clears the call log.
+	void Reset();
+}
+
+#endif
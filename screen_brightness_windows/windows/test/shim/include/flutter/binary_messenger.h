@@ -0,0 +1,29 @@
+#ifndef SCREEN_BRIGHTNESS_WINDOWS_SHIM_FLUTTER_BINARY_MESSENGER_H
+#define SCREEN_BRIGHTNESS_WINDOWS_SHIM_FLUTTER_BINARY_MESSENGER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <string>
+
+namespace flutter
+{
+	// Called with the reply to a message, or with null for no reply.
+	using BinaryReply = std::function<void(const std::uint8_t* reply, std::size_t reply_size)>;
+
+	using BinaryMessageHandler = std::function<void(const std::uint8_t* message, std::size_t message_size, BinaryReply reply)>;
+
+	class BinaryMessenger
+	{
+	public:
+		virtual ~BinaryMessenger() = default;
+
+		// Sends a message to Dart.
+		virtual void Send(const std::string& channel, const std::uint8_t* message, std::size_t message_size, BinaryReply reply = nullptr) const = 0;
+
+		// Handles the messages Dart sends on the channel; null removes the handler.
+		virtual void SetMessageHandler(const std::string& channel, BinaryMessageHandler handler) = 0;
+	};
+}
+
+#endif
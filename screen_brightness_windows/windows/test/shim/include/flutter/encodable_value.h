@@ -0,0 +1,66 @@
+#ifndef SCREEN_BRIGHTNESS_WINDOWS_SHIM_FLUTTER_ENCODABLE_VALUE_H
+#define SCREEN_BRIGHTNESS_WINDOWS_SHIM_FLUTTER_ENCODABLE_VALUE_H
+
+// Test-only stand-in for the Flutter client wrapper, with the API subset the plugin uses, so that the plugin builds and
+// runs on Linux. Values are encoded in the StandardMessageCodec format, as the engine does.
+
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <string>
+#include <utility>
+#include <variant>
+#include <vector>
+
+namespace flutter
+{
+	class EncodableValue;
+
+	using EncodableList = std::vector<EncodableValue>;
+
+	using EncodableMap = std::map<EncodableValue, EncodableValue>;
+
+	namespace internal
+	{
+		using EncodableValueVariant = std::variant<std::monostate, bool, std::int32_t, std::int64_t, double, std::string,
+			std::vector<std::uint8_t>, std::vector<std::int32_t>, std::vector<std::int64_t>, std::vector<double>, EncodableList,
+			EncodableMap, std::vector<float>>;
+	}
+
+	class EncodableValue : public internal::EncodableValueVariant
+	{
+	public:
+		using super = internal::EncodableValueVariant;
+
+		using super::super;
+
+		using super::operator=;
+
+		EncodableValue() = default;
+
+		// a string, not a bool
+		EncodableValue(const char* string) : super(std::string(string))
+		{
+		}
+
+		// null, for Success(nullptr)
+		EncodableValue(std::nullptr_t) : super(std::monostate{})
+		{
+		}
+
+		[[nodiscard]] bool IsNull() const { return std::holds_alternative<std::monostate>(*this); }
+
+		// Dart sends an int as int32 when it fits.
+		[[nodiscard]] std::int64_t LongValue() const
+		{
+			if (std::holds_alternative<std::int32_t>(*this))
+			{
+				return std::get<std::int32_t>(*this);
+			}
+
+			return std::get<std::int64_t>(*this);
+		}
+	};
+}
+
+#endif
@@ -0,0 +1,134 @@
+#ifndef SCREEN_BRIGHTNESS_WINDOWS_SHIM_FLUTTER_EVENT_CHANNEL_H
+#define SCREEN_BRIGHTNESS_WINDOWS_SHIM_FLUTTER_EVENT_CHANNEL_H
+
+#include <iostream>
+#include <memory>
+#include <string>
+#include <utility>
+
+#include "binary_messenger.h"
+#include "event_sink.h"
+#include "event_stream_handler.h"
+#include "method_codec.h"
+
+namespace flutter
+{
+	// Streams events to Dart over the listen and cancel protocol of package:flutter's EventChannel. As with
+	// MethodChannel, the channel may be destroyed while its handler stays installed on the messenger.
+	template <typename T = EncodableValue>
+	class EventChannel
+	{
+	public:
+		EventChannel(BinaryMessenger* messenger, const std::string& name, const MethodCodec<T>* codec) : messenger_(messenger), name_(name), codec_(codec)
+		{
+		}
+
+		EventChannel(const EventChannel&) = delete;
+
+		EventChannel& operator=(const EventChannel&) = delete;
+
+		void SetStreamHandler(std::unique_ptr<StreamHandler<T>> handler)
+		{
+			if (handler == nullptr)
+			{
+				messenger_->SetMessageHandler(name_, nullptr);
+				return;
+			}
+
+			// shared with the handler installed on the messenger, which outlives the channel
+			std::shared_ptr<StreamHandler<T>> shared_handler(std::move(handler));
+			messenger_->SetMessageHandler(name_, [messenger = messenger_, name = name_, codec = codec_, shared_handler, is_listening = false]
+				(const std::uint8_t* message, const std::size_t message_size, const BinaryReply& reply) mutable
+				{
+					const std::unique_ptr<MethodCall<T>> method_call = codec->DecodeMethodCall(message, message_size);
+					if (method_call == nullptr)
+					{
+						std::cerr << "Unable to construct method call from message on channel " << name << std::endl;
+						reply(nullptr, 0);
+						return;
+					}
+
+					std::unique_ptr<std::vector<std::uint8_t>> response;
+					if (method_call->method_name() == "listen")
+					{
+						// a new listener replaces the previous one
+						if (is_listening)
+						{
+							(void)shared_handler->OnCancel(nullptr);
+						}
+
+						is_listening = true;
+						auto sink = std::make_unique<EventSinkImplementation>(messenger, name, codec);
+						const std::unique_ptr<StreamHandlerError<T>> error = shared_handler->OnListen(method_call->arguments(), std::move(sink));
+						response = error == nullptr ? codec->EncodeSuccessEnvelope() :
+							codec->EncodeErrorEnvelope(error->error_code, error->error_message, error->error_details.get());
+					}
+					else if (method_call->method_name() == "cancel")
+					{
+						if (!is_listening)
+						{
+							response = codec->EncodeErrorEnvelope("error", "No active stream to cancel");
+						}
+						else
+						{
+							is_listening = false;
+							const std::unique_ptr<StreamHandlerError<T>> error = shared_handler->OnCancel(method_call->arguments());
+							response = error == nullptr ? codec->EncodeSuccessEnvelope() :
+								codec->EncodeErrorEnvelope(error->error_code, error->error_message, error->error_details.get());
+						}
+					}
+					else
+					{
+						reply(nullptr, 0);
+						return;
+					}
+
+					reply(response->data(), response->size());
+				});
+		}
+
+	private:
+		// Sends each event as an envelope on the channel; the end of the stream is an empty message.
+		class EventSinkImplementation final : public EventSink<T>
+		{
+		public:
+			EventSinkImplementation(const BinaryMessenger* messenger, const std::string& name, const MethodCodec<T>* codec) :
+				messenger_(messenger), name_(name), codec_(codec)
+			{
+			}
+
+		protected:
+			void SuccessInternal(const T* event) override
+			{
+				const std::unique_ptr<std::vector<std::uint8_t>> message = codec_->EncodeSuccessEnvelope(event);
+				messenger_->Send(name_, message->data(), message->size());
+			}
+
+			void ErrorInternal(const std::string& error_code, const std::string& error_message, const T* error_details) override
+			{
+				const std::unique_ptr<std::vector<std::uint8_t>> message = codec_->EncodeErrorEnvelope(error_code, error_message, error_details);
+				messenger_->Send(name_, message->data(), message->size());
+			}
+
+			void EndOfStreamInternal() override
+			{
+				messenger_->Send(name_, nullptr, 0);
+			}
+
+		private:
+			const BinaryMessenger* messenger_;
+
+			std::string name_;
+
+			const MethodCodec<T>* codec_;
+		};
+
+		BinaryMessenger* messenger_;
+
+		std::string name_;
+
+		const MethodCodec<T>* codec_;
+	};
+}
+
+#endif
@@ -0,0 +1,34 @@
+#ifndef SCREEN_BRIGHTNESS_WINDOWS_SHIM_FLUTTER_METHOD_CALL_H
+#define SCREEN_BRIGHTNESS_WINDOWS_SHIM_FLUTTER_METHOD_CALL_H
+
+#include <memory>
+#include <string>
+
+#include "encodable_value.h"
+
+namespace flutter
+{
+	template <typename T = EncodableValue>
+	class MethodCall
+	{
+	public:
+		MethodCall(const std::string& method_name, std::unique_ptr<T> arguments) : method_name_(method_name), arguments_(std::move(arguments))
+		{
+		}
+
+		MethodCall(const MethodCall&) = delete;
+
+		MethodCall& operator=(const MethodCall&) = delete;
+
+		[[nodiscard]] const std::string& method_name() const { return method_name_; }
+
+		[[nodiscard]] const T* arguments() const { return arguments_.get(); }
+
+	private:
+		std::string method_name_;
+
+		std::unique_ptr<T> arguments_;
+	};
+}
+
+#endif
@@ -0,0 +1,128 @@
+#ifndef SCREEN_BRIGHTNESS_WINDOWS_SHIM_FLUTTER_METHOD_CHANNEL_H
+#define SCREEN_BRIGHTNESS_WINDOWS_SHIM_FLUTTER_METHOD_CHANNEL_H
+
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <utility>
+
+#include "binary_messenger.h"
+#include "method_call.h"
+#include "method_codec.h"
+#include "method_result.h"
+
+namespace flutter
+{
+	template <typename T = EncodableValue>
+	using MethodCallHandler = std::function<void(const MethodCall<T>& call, std::unique_ptr<MethodResult<T>> result)>;
+
+	namespace internal
+	{
+		// Replies to Dart with the encoded envelope, once; a result dropped without a reply sends an empty one, which
+		// Dart takes for a missing implementation.
+		template <typename T>
+		class EngineMethodResult final : public MethodResult<T>
+		{
+		public:
+			EngineMethodResult(BinaryReply reply, const MethodCodec<T>* codec) : reply_(std::move(reply)), codec_(codec)
+			{
+			}
+
+			~EngineMethodResult() override
+			{
+				if (reply_)
+				{
+					std::cerr << "Warning: a method call was not replied to" << std::endl;
+					SendReply(nullptr);
+				}
+			}
+
+		protected:
+			void SuccessInternal(const T* result) override
+			{
+				SendReply(codec_->EncodeSuccessEnvelope(result));
+			}
+
+			void ErrorInternal(const std::string& error_code, const std::string& error_message, const T* error_details) override
+			{
+				SendReply(codec_->EncodeErrorEnvelope(error_code, error_message, error_details));
+			}
+
+			void NotImplementedInternal() override
+			{
+				SendReply(nullptr);
+			}
+
+		private:
+			BinaryReply reply_;
+
+			const MethodCodec<T>* codec_;
+
+			void SendReply(const std::unique_ptr<std::vector<std::uint8_t>>& message)
+			{
+				if (!reply_)
+				{
+					std::cerr << "Error: a method call was replied to more than once" << std::endl;
+					return;
+				}
+
+				const BinaryReply reply = std::move(reply_);
+				reply_ = nullptr;
+				if (message == nullptr)
+				{
+					reply(nullptr, 0);
+					return;
+				}
+
+				reply(message->data(), message->size());
+			}
+		};
+	}
+
+	// The channel only installs a handler on the messenger, so it may be destroyed while the handler stays.
+	template <typename T = EncodableValue>
+	class MethodChannel
+	{
+	public:
+		MethodChannel(BinaryMessenger* messenger, const std::string& name, const MethodCodec<T>* codec) : messenger_(messenger), name_(name), codec_(codec)
+		{
+		}
+
+		MethodChannel(const MethodChannel&) = delete;
+
+		MethodChannel& operator=(const MethodChannel&) = delete;
+
+		void SetMethodCallHandler(MethodCallHandler<T> handler) const
+		{
+			if (!handler)
+			{
+				messenger_->SetMessageHandler(name_, nullptr);
+				return;
+			}
+
+			messenger_->SetMessageHandler(name_, [handler = std::move(handler), codec = codec_](const std::uint8_t* message, const std::size_t message_size, BinaryReply reply)
+				{
+					auto result = std::make_unique<internal::EngineMethodResult<T>>(std::move(reply), codec);
+					std::unique_ptr<MethodCall<T>> method_call = codec->DecodeMethodCall(message, message_size);
+					if (method_call == nullptr)
+					{
+						std::cerr << "Unable to construct method call from message" << std::endl;
+						result->NotImplemented();
+						return;
+					}
+
+					handler(*method_call, std::move(result));
+				});
+		}
+
+	private:
+		BinaryMessenger* messenger_;
+
+		std::string name_;
+
+		const MethodCodec<T>* codec_;
+	};
+}
+
+#endif
@@ -0,0 +1,75 @@
+#ifndef SCREEN_BRIGHTNESS_WINDOWS_SHIM_FLUTTER_METHOD_CODEC_H
+#define SCREEN_BRIGHTNESS_WINDOWS_SHIM_FLUTTER_METHOD_CODEC_H
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "method_call.h"
+#include "method_result.h"
+
+namespace flutter
+{
+	// Translates method calls and their result envelopes to and from binary messages.
+	template <typename T>
+	class MethodCodec
+	{
+	public:
+		MethodCodec() = default;
+
+		virtual ~MethodCodec() = default;
+
+		MethodCodec(const MethodCodec&) = delete;
+
+		MethodCodec& operator=(const MethodCodec&) = delete;
+
+		// Returns null for a message which is not a method call.
+		[[nodiscard]] std::unique_ptr<MethodCall<T>> DecodeMethodCall(const std::uint8_t* message, const std::size_t message_size) const
+		{
+			return DecodeMethodCallInternal(message, message_size);
+		}
+
+		[[nodiscard]] std::unique_ptr<MethodCall<T>> DecodeMethodCall(const std::vector<std::uint8_t>& message) const
+		{
+			return DecodeMethodCallInternal(message.data(), message.size());
+		}
+
+		[[nodiscard]] std::unique_ptr<std::vector<std::uint8_t>> EncodeMethodCall(const MethodCall<T>& method_call) const
+		{
+			return EncodeMethodCallInternal(method_call);
+		}
+
+		[[nodiscard]] std::unique_ptr<std::vector<std::uint8_t>> EncodeSuccessEnvelope(const T* result = nullptr) const
+		{
+			return EncodeSuccessEnvelopeInternal(result);
+		}
+
+		[[nodiscard]] std::unique_ptr<std::vector<std::uint8_t>> EncodeErrorEnvelope(const std::string& error_code, const std::string& error_message = "",
+			const T* error_details = nullptr) const
+		{
+			return EncodeErrorEnvelopeInternal(error_code, error_message, error_details);
+		}
+
+		// Passes the envelope to the result. Returns false for a message which is not an envelope.
+		bool DecodeAndProcessResponseEnvelope(const std::uint8_t* response, const std::size_t response_size, MethodResult<T>* result) const
+		{
+			return DecodeAndProcessResponseEnvelopeInternal(response, response_size, result);
+		}
+
+	protected:
+		virtual std::unique_ptr<MethodCall<T>> DecodeMethodCallInternal(const std::uint8_t* message, std::size_t message_size) const = 0;
+
+		virtual std::unique_ptr<std::vector<std::uint8_t>> EncodeMethodCallInternal(const MethodCall<T>& method_call) const = 0;
+
+		virtual std::unique_ptr<std::vector<std::uint8_t>> EncodeSuccessEnvelopeInternal(const T* result) const = 0;
+
+		virtual std::unique_ptr<std::vector<std::uint8_t>> EncodeErrorEnvelopeInternal(const std::string& error_code, const std::string& error_message,
+			const T* error_details) const = 0;
+
+		virtual bool DecodeAndProcessResponseEnvelopeInternal(const std::uint8_t* response, std::size_t response_size, MethodResult<T>* result) const = 0;
+	};
+}
+
+#endif
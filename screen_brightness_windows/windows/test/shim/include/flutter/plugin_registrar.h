@@ -0,0 +1,88 @@
+#ifndef SCREEN_BRIGHTNESS_WINDOWS_SHIM_FLUTTER_PLUGIN_REGISTRAR_H
+#define SCREEN_BRIGHTNESS_WINDOWS_SHIM_FLUTTER_PLUGIN_REGISTRAR_H
+
+#include <flutter_plugin_registrar.h>
+
+#include <map>
+#include <memory>
+#include <set>
+
+#include "binary_messenger.h"
+
+namespace flutter
+{
+	class Plugin
+	{
+	public:
+		virtual ~Plugin() = default;
+	};
+
+	// Owns the plugins registered with an engine, which it destroys before the engine's messenger.
+	class PluginRegistrar
+	{
+	public:
+		explicit PluginRegistrar(FlutterDesktopPluginRegistrarRef core_registrar);
+
+		virtual ~PluginRegistrar();
+
+		PluginRegistrar(const PluginRegistrar&) = delete;
+
+		PluginRegistrar& operator=(const PluginRegistrar&) = delete;
+
+		[[nodiscard]] BinaryMessenger* messenger() { return messenger_; }
+
+		void AddPlugin(std::unique_ptr<Plugin> plugin);
+
+	protected:
+		[[nodiscard]] FlutterDesktopPluginRegistrarRef registrar() const { return registrar_; }
+
+		// Destroys the plugins, for a subclass whose state they use in their destructors.
+		void ClearPlugins();
+
+	private:
+		FlutterDesktopPluginRegistrarRef registrar_;
+
+		BinaryMessenger* messenger_;
+
+		std::set<std::unique_ptr<Plugin>> plugins_;
+	};
+
+	// The C++ registrar of each engine's registrar, created on first use and destroyed with the engine.
+	class PluginRegistrarManager
+	{
+	public:
+		static PluginRegistrarManager* GetInstance();
+
+		PluginRegistrarManager(const PluginRegistrarManager&) = delete;
+
+		PluginRegistrarManager& operator=(const PluginRegistrarManager&) = delete;
+
+		template <class T>
+		T* GetRegistrar(FlutterDesktopPluginRegistrarRef registrar_ref)
+		{
+			const auto existing = registrars_.find(registrar_ref);
+			if (existing != registrars_.end())
+			{
+				return static_cast<T*>(existing->second.get());
+			}
+
+			auto registrar = std::make_unique<T>(registrar_ref);
+			T* registrar_pointer = registrar.get();
+			registrars_.emplace(registrar_ref, std::move(registrar));
+			FlutterDesktopPluginRegistrarSetDestructionHandler(registrar_ref, OnRegistrarDestroyed);
+			return registrar_pointer;
+		}
+
+		// Destroys every registrar, for tests which do not destroy their engines.
+		void Reset() { registrars_.clear(); }
+
+	private:
+		PluginRegistrarManager() = default;
+
+		std::map<FlutterDesktopPluginRegistrarRef, std::unique_ptr<PluginRegistrar>> registrars_;
+
+		static void OnRegistrarDestroyed(FlutterDesktopPluginRegistrarRef registrar);
+	};
+}
+
+#endif
@@ -0,0 +1,58 @@
+#ifndef SCREEN_BRIGHTNESS_WINDOWS_SHIM_FLUTTER_PLUGIN_REGISTRAR_WINDOWS_H
+#define SCREEN_BRIGHTNESS_WINDOWS_SHIM_FLUTTER_PLUGIN_REGISTRAR_WINDOWS_H
+
+#include <Windows.h>
+
+#include <functional>
+#include <map>
+#include <optional>
+
+#include "plugin_registrar.h"
+
+namespace flutter
+{
+	// Called with each message of the top-level window before the runner handles it; a value ends the handling.
+	using WindowProcDelegate = std::function<std::optional<LRESULT>(HWND hwnd, UINT message, WPARAM wparam, LPARAM lparam)>;
+
+	class FlutterView
+	{
+	public:
+		explicit FlutterView(HWND window) : window_(window)
+		{
+		}
+
+		[[nodiscard]] HWND GetNativeWindow() const { return window_; }
+
+	private:
+		HWND window_;
+	};
+
+	class PluginRegistrarWindows : public PluginRegistrar
+	{
+	public:
+		explicit PluginRegistrarWindows(FlutterDesktopPluginRegistrarRef core_registrar);
+
+		// The plugins unregister their delegates as they are destroyed.
+		~PluginRegistrarWindows() override;
+
+		// Null for a headless engine.
+		[[nodiscard]] FlutterView* GetView() { return view_.get(); }
+
+		// Returns the id to unregister the delegate with.
+		int RegisterTopLevelWindowProcDelegate(WindowProcDelegate delegate);
+
+		void UnregisterTopLevelWindowProcDelegate(int proc_id);
+
+	private:
+		std::unique_ptr<FlutterView> view_;
+
+		std::map<int, WindowProcDelegate> window_proc_delegates_;
+
+		int next_window_proc_id_ = 1;
+
+		// Calls every delegate, in registration order, and returns the first value.
+		std::optional<LRESULT> OnTopLevelWindowProc(HWND hwnd, UINT message, WPARAM wparam, LPARAM lparam);
+	};
+}
+
+#endif
@@ -0,0 +1,74 @@
+#ifndef SCREEN_BRIGHTNESS_WINDOWS_SHIM_FLUTTER_STANDARD_METHOD_CODEC_H
+#define SCREEN_BRIGHTNESS_WINDOWS_SHIM_FLUTTER_STANDARD_METHOD_CODEC_H
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "encodable_value.h"
+#include "method_codec.h"
+
+namespace flutter
+{
+	// Reads and writes values in the StandardMessageCodec format of package:flutter/services.dart.
+	class StandardCodecSerializer
+	{
+	public:
+		static const StandardCodecSerializer& GetInstance();
+
+		virtual ~StandardCodecSerializer() = default;
+
+		void WriteValue(const EncodableValue& value, std::vector<std::uint8_t>& buffer) const;
+
+		// Returns false for a truncated or malformed value; position is then undefined.
+		bool ReadValue(const std::uint8_t* data, std::size_t size, std::size_t& position, EncodableValue& value) const;
+	};
+
+	// Encodes single values, e.g. the messages of a BasicMessageChannel.
+	class StandardMessageCodec final
+	{
+	public:
+		static const StandardMessageCodec& GetInstance(const StandardCodecSerializer* serializer = nullptr);
+
+		[[nodiscard]] std::unique_ptr<std::vector<std::uint8_t>> EncodeMessage(const EncodableValue& message) const;
+
+		// Returns null for a malformed message.
+		[[nodiscard]] std::unique_ptr<EncodableValue> DecodeMessage(const std::uint8_t* message, std::size_t message_size) const;
+
+	private:
+		explicit StandardMessageCodec(const StandardCodecSerializer& serializer) : serializer_(serializer)
+		{
+		}
+
+		const StandardCodecSerializer& serializer_;
+	};
+
+	class StandardMethodCodec final : public MethodCodec<EncodableValue>
+	{
+	public:
+		static const StandardMethodCodec& GetInstance(const StandardCodecSerializer* serializer = nullptr);
+
+	protected:
+		std::unique_ptr<MethodCall<EncodableValue>> DecodeMethodCallInternal(const std::uint8_t* message, std::size_t message_size) const override;
+
+		std::unique_ptr<std::vector<std::uint8_t>> EncodeMethodCallInternal(const MethodCall<EncodableValue>& method_call) const override;
+
+		std::unique_ptr<std::vector<std::uint8_t>> EncodeSuccessEnvelopeInternal(const EncodableValue* result) const override;
+
+		std::unique_ptr<std::vector<std::uint8_t>> EncodeErrorEnvelopeInternal(const std::string& error_code, const std::string& error_message,
+			const EncodableValue* error_details) const override;
+
+		bool DecodeAndProcessResponseEnvelopeInternal(const std::uint8_t* response, std::size_t response_size, MethodResult<EncodableValue>* result) const override;
+
+	private:
+		explicit StandardMethodCodec(const StandardCodecSerializer& serializer) : serializer_(serializer)
+		{
+		}
+
+		const StandardCodecSerializer& serializer_;
+	};
+}
+
+#endif
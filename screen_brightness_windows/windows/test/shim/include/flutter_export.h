@@ -0,0 +1,14 @@
+#ifndef SCREEN_BRIGHTNESS_WINDOWS_SHIM_FLUTTER_EXPORT_H
+#define SCREEN_BRIGHTNESS_WINDOWS_SHIM_FLUTTER_EXPORT_H
+
+// The shim links statically, so nothing is exported.
+#define FLUTTER_EXPORT
+
+// Plugin headers declare their exports as MSVC does.
+#ifndef _MSC_VER
+#ifndef __declspec
+#define __declspec(attribute)
+#endif
+#endif
+
+#endif
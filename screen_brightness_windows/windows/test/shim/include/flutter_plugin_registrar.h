@@ -0,0 +1,23 @@
+#ifndef SCREEN_BRIGHTNESS_WINDOWS_SHIM_FLUTTER_DESKTOP_PLUGIN_REGISTRAR_H
+#define SCREEN_BRIGHTNESS_WINDOWS_SHIM_FLUTTER_DESKTOP_PLUGIN_REGISTRAR_H
+
+#include "flutter_export.h"
+
+#if defined(__cplusplus)
+extern "C" {
+#endif
+
+	// An engine's registrar, which FakeFlutterEngine owns.
+	typedef struct FlutterDesktopPluginRegistrar* FlutterDesktopPluginRegistrarRef;
+
+	typedef void (*FlutterDesktopOnPluginRegistrarDestroyed)(FlutterDesktopPluginRegistrarRef);
+
+	// Called as the engine destroys the registrar, before its messenger goes.
+	FLUTTER_EXPORT void FlutterDesktopPluginRegistrarSetDestructionHandler(FlutterDesktopPluginRegistrarRef registrar,
+		FlutterDesktopOnPluginRegistrarDestroyed callback);
+
+#if defined(__cplusplus)
+}  // extern "C"
+#endif
+
+#endif
@@ -0,0 +1,12 @@
+#ifndef SCREEN_BRIGHTNESS_WINDOWS_SHIM_HIGHLEVELMONITORCONFIGURATIONAPI_H
+#define SCREEN_BRIGHTNESS_WINDOWS_SHIM_HIGHLEVELMONITORCONFIGURATIONAPI_H
+
+#include <Windows.h>
+
+#include <physicalmonitorenumerationapi.h>
+
+BOOL GetMonitorBrightness(HANDLE monitor, LPDWORD minimum_brightness, LPDWORD current_brightness, LPDWORD maximum_brightness);
+
+BOOL SetMonitorBrightness(HANDLE monitor, DWORD new_brightness);
+
+#endif
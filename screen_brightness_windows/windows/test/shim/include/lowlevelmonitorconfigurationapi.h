@@ -0,0 +1,24 @@
+#ifndef SCREEN_BRIGHTNESS_WINDOWS_SHIM_LOWLEVELMONITORCONFIGURATIONAPI_H
+#define SCREEN_BRIGHTNESS_WINDOWS_SHIM_LOWLEVELMONITORCONFIGURATIONAPI_H
+
+#include <Windows.h>
+
+#include <physicalmonitorenumerationapi.h>
+
+enum MC_VCP_CODE_TYPE
+{
+	MC_MOMENTARY,
+	MC_SET_PARAMETER,
+};
+
+typedef MC_VCP_CODE_TYPE* LPMC_VCP_CODE_TYPE;
+
+BOOL GetVCPFeatureAndVCPFeatureReply(HANDLE monitor, BYTE vcp_code, LPMC_VCP_CODE_TYPE code_type, LPDWORD current_value, LPDWORD maximum_value);
+
+BOOL SetVCPFeature(HANDLE monitor, BYTE vcp_code, DWORD new_value);
+
+BOOL GetCapabilitiesStringLength(HANDLE monitor, LPDWORD capabilities_string_length);
+
+BOOL CapabilitiesRequestAndCapabilitiesReply(HANDLE monitor, LPSTR capabilities_string, DWORD capabilities_string_length);
+
+#endif
@@ -0,0 +1,23 @@
+#ifndef SCREEN_BRIGHTNESS_WINDOWS_SHIM_PHYSICALMONITORENUMERATIONAPI_H
+#define SCREEN_BRIGHTNESS_WINDOWS_SHIM_PHYSICALMONITORENUMERATIONAPI_H
+
+#include <Windows.h>
+
+#define PHYSICAL_MONITOR_DESCRIPTION_SIZE 128
+
+struct PHYSICAL_MONITOR
+{
+	HANDLE hPhysicalMonitor;
+
+	char szPhysicalMonitorDescription[PHYSICAL_MONITOR_DESCRIPTION_SIZE];
+};
+
+typedef PHYSICAL_MONITOR* LPPHYSICAL_MONITOR;
+
+BOOL GetNumberOfPhysicalMonitorsFromHMONITOR(HMONITOR monitor, LPDWORD physical_monitor_count);
+
+BOOL GetPhysicalMonitorsFromHMONITOR(HMONITOR monitor, DWORD physical_monitor_array_size, LPPHYSICAL_MONITOR physical_monitor_array);
+
+BOOL DestroyPhysicalMonitors(DWORD physical_monitor_array_size, LPPHYSICAL_MONITOR physical_monitor_array);
+
+#endif
@@ -0,0 +1,201 @@
+#include <fake_flutter_engine.h>
+
+#include <fake_windows.h>
+#include <flutter/method_call.h>
+#include <flutter/method_result_functions.h>
+#include <flutter/standard_method_codec.h>
+
+#include <memory>
+#include <utility>
+#include <vector>
+
+void FlutterDesktopPluginRegistrarSetDestructionHandler(const FlutterDesktopPluginRegistrarRef registrar, const FlutterDesktopOnPluginRegistrarDestroyed callback)
+{
+	registrar->destruction_handler = callback;
+}
+
+namespace fake_flutter
+{
+	FakeBinaryMessenger::FakeBinaryMessenger() : platform_thread_id_(std::this_thread::get_id())
+	{
+	}
+
+	void FakeBinaryMessenger::Send(const std::string& channel, const std::uint8_t* message, const std::size_t message_size, flutter::BinaryReply reply) const
+	{
+		if (std::this_thread::get_id() != platform_thread_id_)
+		{
+			off_platform_thread_message_count_.fetch_add(1);
+		}
+
+		DartMessageHandler handler;
+		{
+			std::lock_guard<std::mutex> lock(mutex_);
+			const auto found = dart_message_handlers_.find(channel);
+			if (found != dart_message_handlers_.end())
+			{
+				handler = found->second;
+			}
+		}
+
+		if (handler)
+		{
+			handler(message, message_size);
+		}
+
+		// Dart does not reply to the plugin's messages
+		if (reply)
+		{
+			reply(nullptr, 0);
+		}
+	}
+
+	void FakeBinaryMessenger::SetMessageHandler(const std::string& channel, flutter::BinaryMessageHandler handler)
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+		if (!handler)
+		{
+			message_handlers_.erase(channel);
+			return;
+		}
+
+		message_handlers_[channel] = std::move(handler);
+	}
+
+	void FakeBinaryMessenger::SetDartMessageHandler(const std::string& channel, DartMessageHandler handler)
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+		if (!handler)
+		{
+			dart_message_handlers_.erase(channel);
+			return;
+		}
+
+		dart_message_handlers_[channel] = std::move(handler);
+	}
+
+	void FakeBinaryMessenger::SendToPlatform(const std::string& channel, const std::uint8_t* message, const std::size_t message_size, const flutter::BinaryReply& reply)
+	{
+		flutter::BinaryMessageHandler handler;
+		{
+			std::lock_guard<std::mutex> lock(mutex_);
+			const auto found = message_handlers_.find(channel);
+			if (found != message_handlers_.end())
+			{
+				handler = found->second;
+			}
+		}
+
+		if (!handler)
+		{
+			reply(nullptr, 0);
+			return;
+		}
+
+		handler(message, message_size, reply);
+	}
+
+	bool FakeBinaryMessenger::HasMessageHandler(const std::string& channel) const
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+		return message_handlers_.count(channel) != 0;
+	}
+
+	FakeFlutterEngine::FakeFlutterEngine(const HWND top_level_window) : top_level_window_(top_level_window)
+	{
+		registrar_.messenger = &messenger_;
+		registrar_.view_window = fake_windows::CreateChildWindow(top_level_window);
+		fake_windows::SetWindowProc(top_level_window, [this](const HWND hwnd, const UINT message, const WPARAM wparam, const LPARAM lparam)
+			{
+				return HandleTopLevelWindowProc(hwnd, message, wparam, lparam).value_or(0);
+			});
+	}
+
+	FakeFlutterEngine::~FakeFlutterEngine()
+	{
+		// the C++ registrar, and with it the plugins, goes before the messenger
+		if (registrar_.destruction_handler != nullptr)
+		{
+			registrar_.destruction_handler(&registrar_);
+		}
+
+		fake_windows::SetWindowProc(top_level_window_, nullptr);
+		fake_windows::DestroyWindow(registrar_.view_window);
+	}
+
+	FlutterDesktopPluginRegistrarRef FakeFlutterEngine::GetRegistrarForPlugin(const char*)
+	{
+		return &registrar_;
+	}
+
+	std::optional<LRESULT> FakeFlutterEngine::HandleTopLevelWindowProc(const HWND hwnd, const UINT message, const WPARAM wparam, const LPARAM lparam)
+	{
+		if (!registrar_.top_level_window_proc)
+		{
+			return std::nullopt;
+		}
+
+		return registrar_.top_level_window_proc(hwnd, message, wparam, lparam);
+	}
+
+	Envelope FakeFlutterEngine::InvokeMethod(const std::string& channel, const std::string& method, const flutter::EncodableValue& arguments)
+	{
+		// a reply sent after the handler returned is dropped
+		auto reply = std::make_shared<Envelope>();
+		InvokeMethodAsync(channel, method, arguments, [reply](const Envelope& envelope) { *reply = envelope; });
+		return *reply;
+	}
+
+	void FakeFlutterEngine::InvokeMethodAsync(const std::string& channel, const std::string& method, const flutter::EncodableValue& arguments,
+		std::function<void(const Envelope& reply)> on_reply)
+	{
+		const flutter::MethodCall<flutter::EncodableValue> method_call(method, std::make_unique<flutter::EncodableValue>(arguments));
+		const std::unique_ptr<std::vector<std::uint8_t>> message = flutter::StandardMethodCodec::GetInstance().EncodeMethodCall(method_call);
+		messenger_.SendToPlatform(channel, message->data(), message->size(), [on_reply = std::move(on_reply)](const std::uint8_t* reply_message, const std::size_t reply_size)
+			{
+				on_reply(DecodeEnvelope(reply_message, reply_size));
+			});
+	}
+
+	Envelope FakeFlutterEngine::Listen(const std::string& channel, std::function<void(const Envelope& event)> on_event)
+	{
+		messenger_.SetDartMessageHandler(channel, [on_event = std::move(on_event)](const std::uint8_t* message, const std::size_t message_size)
+			{
+				on_event(DecodeEnvelope(message, message_size));
+			});
+		return InvokeMethod(channel, "listen");
+	}
+
+	Envelope FakeFlutterEngine::Cancel(const std::string& channel)
+	{
+		const Envelope reply = InvokeMethod(channel, "cancel");
+		messenger_.SetDartMessageHandler(channel, nullptr);
+		return reply;
+	}
+
+	Envelope FakeFlutterEngine::DecodeEnvelope(const std::uint8_t* message, const std::size_t message_size)
+	{
+		Envelope envelope;
+		if (message == nullptr || message_size == 0)
+		{
+			return envelope;
+		}
+
+		flutter::MethodResultFunctions<flutter::EncodableValue> result(
+			[&envelope](const flutter::EncodableValue* value)
+			{
+				envelope.is_present = true;
+				envelope.value = value == nullptr ? flutter::EncodableValue() : *value;
+			},
+			[&envelope](const std::string& error_code, const std::string& error_message, const flutter::EncodableValue* error_details)
+			{
+				envelope.is_present = true;
+				envelope.is_error = true;
+				envelope.error_code = error_code;
+				envelope.error_message = error_message;
+				envelope.value = error_details == nullptr ? flutter::EncodableValue() : *error_details;
+			},
+			nullptr);
+		(void)flutter::StandardMethodCodec::GetInstance().DecodeAndProcessResponseEnvelope(message, message_size, &result);
+		return envelope;
+	}
+}
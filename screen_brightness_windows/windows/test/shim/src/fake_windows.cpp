@@ -0,0 +1,1028 @@
+#include <fake_windows.h>
+
+#include <highlevelmonitorconfigurationapi.h>
+#include <lowlevelmonitorconfigurationapi.h>
+
+#include <algorithm>
+#include <condition_variable>
+#include <cstdio>
+#include <cstring>
+#include <deque>
+#include <map>
+#include <mutex>
+#include <thread>
+#include <utility>
+
+namespace fake_windows
+{
+	namespace
+	{
+		using SteadyClock = std::chrono::steady_clock;
+
+		constexpr BYTE kBrightnessCode = 0x10;
+
+		constexpr UINT kFirstRegisteredMessage = 0xC000;
+
+		struct Monitor
+		{
+			MonitorConfig config;
+
+			// the n-th monitor added, which names its device
+			int number = 0;
+
+			DWORD brightness = 0;
+
+			size_t set_brightness_count = 0;
+
+			std::map<BYTE, DWORD> vcp_values;
+		};
+
+		struct Window
+		{
+			HWND parent = nullptr;
+
+			HMONITOR monitor = nullptr;
+
+			WindowProc window_proc;
+		};
+
+		struct Timer
+		{
+			HWND hwnd = nullptr;
+
+			UINT_PTR id = 0;
+
+			std::chrono::milliseconds period{};
+
+			SteadyClock::time_point due_time{};
+
+			TIMERPROC timer_function = nullptr;
+		};
+
+		struct Message
+		{
+			HWND hwnd = nullptr;
+
+			UINT message = 0;
+
+			WPARAM wparam = 0;
+
+			LPARAM lparam = 0;
+		};
+
+		struct System
+		{
+			std::mutex mutex;
+
+			std::map<HMONITOR, Monitor> monitors;
+
+			int monitor_count = 0;
+
+			std::map<HWND, Window> windows;
+
+			std::uintptr_t next_window = 1;
+
+			std::deque<Message> messages;
+
+			std::vector<Timer> timers;
+
+			std::map<std::string, UINT> registered_messages;
+
+			// of each open physical monitor handle
+			std::map<HANDLE, HMONITOR> physical_monitors;
+
+			std::uintptr_t next_physical_monitor = 1;
+
+			std::map<std::pair<HMONITOR, DdcFunction>, std::deque<DdcStep>> scripts;
+
+			std::deque<DdcCall> call_log;
+
+			// hung calls wait for the generation to change
+			std::condition_variable hang_condition;
+
+			std::uint64_t hang_generation = 0;
+
+			bool is_releasing_hung_calls = false;
+
+			size_t hung_call_count = 0;
+
+			DWORD last_input_time = GetTickCount();
+		};
+
+		System& GetSystem()
+		{
+			static System system;
+			return system;
+		}
+
+		template <typename Handle>
+		Handle ToHandle(const std::uintptr_t value)
+		{
+			return reinterpret_cast<Handle>(value);
+		}
+
+		std::string GetDeviceName(const Monitor& monitor)
+		{
+			return "\\\\.\\DISPLAY" + std::to_string(monitor.number);
+		}
+
+		std::string GetProductId(const Monitor& monitor)
+		{
+			char product_id[8] = {};
+			std::snprintf(product_id, sizeof(product_id), "%04X", monitor.number & 0xffff);
+			return monitor.config.manufacturer + product_id;
+		}
+
+		// \\?\DISPLAY#FAK0001#5&1&0&UID1#{e6f07b5f-ee97-4a90-b076-33f57bf4eaa7}, as Windows names it
+		std::string GetInterfaceName(const Monitor& monitor)
+		{
+			return "\\\\?\\DISPLAY#" + GetProductId(monitor) + "#5&1&0&UID" + std::to_string(monitor.number) + "#{e6f07b5f-ee97-4a90-b076-33f57bf4eaa7}";
+		}
+
+		std::string GetDeviceParametersKey(const Monitor& monitor)
+		{
+			return "SYSTEM\\CurrentControlSet\\Enum\\DISPLAY\\" + GetProductId(monitor) + "\\5&1&0&UID" + std::to_string(monitor.number) + "\\Device Parameters";
+		}
+
+		// A 128 byte EDID 1.4 block with the manufacturer, the product code and the monitor name.
+		std::vector<std::uint8_t> MakeEdid(const Monitor& monitor)
+		{
+			std::vector<std::uint8_t> edid = { 0x00, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0x00 };
+			edid.resize(128);
+			const std::string& manufacturer = monitor.config.manufacturer;
+			const auto letter = [&manufacturer](const size_t index) { return index < manufacturer.size() ? (manufacturer[index] - 'A' + 1) & 0x1f : 0; };
+			const int packed_manufacturer = (letter(0) << 10) | (letter(1) << 5) | letter(2);
+			edid[8] = static_cast<std::uint8_t>(packed_manufacturer >> 8);
+			edid[9] = static_cast<std::uint8_t>(packed_manufacturer);
+			edid[10] = static_cast<std::uint8_t>(monitor.number);
+			edid[11] = static_cast<std::uint8_t>(monitor.number >> 8);
+			edid[12] = static_cast<std::uint8_t>(monitor.number);
+			edid[16] = 1;
+			edid[17] = 34;
+			edid[18] = 1;
+			edid[19] = 4;
+			edid[21] = 60;
+			edid[22] = 34;
+
+			// the monitor name, then three dummy descriptors
+			std::uint8_t* descriptor = edid.data() + 54;
+			descriptor[3] = 0xfc;
+			const std::string name = "Fake " + std::to_string(monitor.number) + "\n";
+			std::memset(descriptor + 5, ' ', 13);
+			std::memcpy(descriptor + 5, name.data(), std::min<size_t>(name.size(), 13));
+			for (size_t index = 1; index < 4; ++index)
+			{
+				edid[54 + index * 18 + 3] = 0x10;
+			}
+
+			std::uint8_t checksum = 0;
+			for (size_t index = 0; index < 127; ++index)
+			{
+				checksum = static_cast<std::uint8_t>(checksum + edid[index]);
+			}
+
+			edid[127] = static_cast<std::uint8_t>(0x100 - checksum);
+			return edid;
+		}
+
+		HMONITOR GetPrimaryMonitor(System& system)
+		{
+			return system.monitors.empty() ? nullptr : system.monitors.begin()->first;
+		}
+
+		HWND GetRootWindow(System& system, HWND hwnd)
+		{
+			auto window = system.windows.find(hwnd);
+			while (window != system.windows.end() && window->second.parent != nullptr)
+			{
+				hwnd = window->second.parent;
+				window = system.windows.find(hwnd);
+			}
+
+			return window == system.windows.end() ? nullptr : hwnd;
+		}
+
+		void PostToTopLevelWindows(System& system, const UINT message)
+		{
+			for (const auto& [hwnd, window] : system.windows)
+			{
+				if (window.parent == nullptr)
+				{
+					system.messages.push_back(Message{ hwnd, message, 0, 0 });
+				}
+			}
+		}
+
+		// One DDC/CI call: finds the monitor behind an open physical monitor handle, and plays the next step of its
+		// script with the lock released, as a DDC/CI call holds the I2C bus rather than the system. Logs the call as it
+		// finishes.
+		class DdcCallScope final
+		{
+		public:
+			DdcCallScope(std::unique_lock<std::mutex>& lock, System& system, const HANDLE physical_monitor, const DdcFunction function, const DWORD value = 0) :
+				system_(system), start_time_(SteadyClock::now())
+			{
+				call_.function = function;
+				call_.value = value;
+				call_.start_time = start_time_;
+				const auto monitor_handle = system.physical_monitors.find(physical_monitor);
+				if (monitor_handle == system.physical_monitors.end())
+				{
+					return;
+				}
+
+				call_.monitor = monitor_handle->second;
+				auto monitor = system.monitors.find(call_.monitor);
+				if (monitor == system.monitors.end())
+				{
+					return;
+				}
+
+				DdcStep step{ monitor->second.config.latency };
+				if (auto script = system.scripts.find({ call_.monitor, function }); script != system.scripts.end() && !script->second.empty())
+				{
+					step = script->second.front();
+					script->second.pop_front();
+				}
+
+				if (step.is_hang)
+				{
+					++system.hung_call_count;
+					const std::uint64_t generation = system.hang_generation;
+					system.hang_condition.wait(lock, [&system, generation]
+						{
+							return system.is_releasing_hung_calls || system.hang_generation != generation;
+						});
+					--system.hung_call_count;
+					return;
+				}
+
+				if (step.latency.count() > 0)
+				{
+					lock.unlock();
+					std::this_thread::sleep_for(step.latency);
+					lock.lock();
+				}
+
+				// the monitor may have been removed meanwhile
+				monitor = system.monitors.find(call_.monitor);
+				if (!step.is_failure && monitor != system.monitors.end())
+				{
+					monitor_ = &monitor->second;
+				}
+			}
+
+			DdcCallScope(const DdcCallScope&) = delete;
+
+			DdcCallScope& operator=(const DdcCallScope&) = delete;
+
+			// Null when the call fails.
+			[[nodiscard]] Monitor* monitor() const { return monitor_; }
+
+			// Call with the lock held.
+			BOOL Finish(const BOOL result)
+			{
+				call_.result = result;
+				call_.duration = SteadyClock::now() - start_time_;
+				if (system_.call_log.size() == kDdcCallLogSize)
+				{
+					system_.call_log.pop_front();
+				}
+
+				system_.call_log.push_back(call_);
+				return result;
+			}
+
+		private:
+			System& system_;
+
+			SteadyClock::time_point start_time_;
+
+			DdcCall call_;
+
+			Monitor* monitor_ = nullptr;
+		};
+
+		void Deliver(System& system, const Message& message)
+		{
+			WindowProc window_proc;
+			{
+				std::lock_guard<std::mutex> lock(system.mutex);
+				const auto window = system.windows.find(message.hwnd);
+				if (window == system.windows.end() || !window->second.window_proc)
+				{
+					return;
+				}
+
+				window_proc = window->second.window_proc;
+			}
+
+			(void)window_proc(message.hwnd, message.message, message.wparam, message.lparam);
+		}
+	}
+
+	HMONITOR AddMonitor(const MonitorConfig& config)
+	{
+		System& system = GetSystem();
+		std::lock_guard<std::mutex> lock(system.mutex);
+		const int number = ++system.monitor_count;
+		const auto handle = ToHandle<HMONITOR>(0x10000 + static_cast<std::uintptr_t>(number));
+		Monitor& monitor = system.monitors[handle];
+		monitor.config = config;
+		monitor.number = number;
+		monitor.brightness = config.brightness;
+		if (monitor.config.edid.empty())
+		{
+			monitor.config.edid = MakeEdid(monitor);
+		}
+
+		PostToTopLevelWindows(system, WM_DISPLAYCHANGE);
+		return handle;
+	}
+
+	void RemoveMonitor(const HMONITOR monitor)
+	{
+		System& system = GetSystem();
+		std::lock_guard<std::mutex> lock(system.mutex);
+		if (system.monitors.erase(monitor) == 0)
+		{
+			return;
+		}
+
+		const HMONITOR primary_monitor = GetPrimaryMonitor(system);
+		for (auto& [hwnd, window] : system.windows)
+		{
+			if (window.monitor == monitor)
+			{
+				window.monitor = primary_monitor;
+			}
+		}
+
+		PostToTopLevelWindows(system, WM_DISPLAYCHANGE);
+	}
+
+	DWORD GetBrightness(const HMONITOR monitor)
+	{
+		System& system = GetSystem();
+		std::lock_guard<std::mutex> lock(system.mutex);
+		const auto found = system.monitors.find(monitor);
+		return found == system.monitors.end() ? 0 : found->second.brightness;
+	}
+
+	size_t GetSetBrightnessCount(const HMONITOR monitor)
+	{
+		System& system = GetSystem();
+		std::lock_guard<std::mutex> lock(system.mutex);
+		const auto found = system.monitors.find(monitor);
+		return found == system.monitors.end() ? 0 : found->second.set_brightness_count;
+	}
+
+	const char* GetDdcFunctionName(const DdcFunction function)
+	{
+		switch (function)
+		{
+		case DdcFunction::kGetMonitorBrightness:
+			return "GetMonitorBrightness";
+		case DdcFunction::kSetMonitorBrightness:
+			return "SetMonitorBrightness";
+		case DdcFunction::kGetVcpFeature:
+			return "GetVCPFeatureAndVCPFeatureReply";
+		case DdcFunction::kSetVcpFeature:
+			return "SetVCPFeature";
+		case DdcFunction::kGetCapabilitiesStringLength:
+			return "GetCapabilitiesStringLength";
+		case DdcFunction::kCapabilitiesRequest:
+			return "CapabilitiesRequestAndCapabilitiesReply";
+		}
+
+		return "unknown";
+	}
+
+	void ScriptDdcCalls(const HMONITOR monitor, const DdcFunction function, const std::vector<DdcStep>& steps)
+	{
+		System& system = GetSystem();
+		std::lock_guard<std::mutex> lock(system.mutex);
+		std::deque<DdcStep>& script = system.scripts[{ monitor, function }];
+		script.insert(script.end(), steps.begin(), steps.end());
+	}
+
+	void ReleaseHungCalls()
+	{
+		System& system = GetSystem();
+		{
+			std::lock_guard<std::mutex> lock(system.mutex);
+			system.is_releasing_hung_calls = true;
+		}
+
+		system.hang_condition.notify_all();
+	}
+
+	size_t GetHungCallCount()
+	{
+		System& system = GetSystem();
+		std::lock_guard<std::mutex> lock(system.mutex);
+		return system.hung_call_count;
+	}
+
+	std::vector<DdcCall> GetDdcCallLog()
+	{
+		System& system = GetSystem();
+		std::lock_guard<std::mutex> lock(system.mutex);
+		return std::vector<DdcCall>(system.call_log.begin(), system.call_log.end());
+	}
+
+	void ClearDdcCallLog()
+	{
+		System& system = GetSystem();
+		std::lock_guard<std::mutex> lock(system.mutex);
+		system.call_log.clear();
+	}
+
+	size_t GetOpenPhysicalMonitorCount()
+	{
+		System& system = GetSystem();
+		std::lock_guard<std::mutex> lock(system.mutex);
+		return system.physical_monitors.size();
+	}
+
+	HWND CreateTopLevelWindow(const HMONITOR monitor)
+	{
+		System& system = GetSystem();
+		std::lock_guard<std::mutex> lock(system.mutex);
+		const auto hwnd = ToHandle<HWND>(0x20000 + system.next_window++);
+		system.windows[hwnd].monitor = monitor;
+		return hwnd;
+	}
+
+	HWND CreateChildWindow(const HWND parent)
+	{
+		System& system = GetSystem();
+		std::lock_guard<std::mutex> lock(system.mutex);
+		const auto hwnd = ToHandle<HWND>(0x20000 + system.next_window++);
+		system.windows[hwnd].parent = parent;
+		return hwnd;
+	}
+
+	void DestroyWindow(const HWND hwnd)
+	{
+		System& system = GetSystem();
+		std::lock_guard<std::mutex> lock(system.mutex);
+		std::vector<HWND> destroyed = { hwnd };
+		for (size_t index = 0; index < destroyed.size(); ++index)
+		{
+			for (const auto& [child, window] : system.windows)
+			{
+				if (window.parent == destroyed[index])
+				{
+					destroyed.push_back(child);
+				}
+			}
+		}
+
+		for (const HWND window : destroyed)
+		{
+			system.windows.erase(window);
+			system.messages.erase(std::remove_if(system.messages.begin(), system.messages.end(),
+				[window](const Message& message) { return message.hwnd == window; }), system.messages.end());
+			system.timers.erase(std::remove_if(system.timers.begin(), system.timers.end(),
+				[window](const Timer& timer) { return timer.hwnd == window; }), system.timers.end());
+		}
+	}
+
+	void MoveWindowToMonitor(const HWND hwnd, const HMONITOR monitor)
+	{
+		System& system = GetSystem();
+		std::lock_guard<std::mutex> lock(system.mutex);
+		const HWND root_window = GetRootWindow(system, hwnd);
+		if (root_window == nullptr)
+		{
+			return;
+		}
+
+		system.windows[root_window].monitor = monitor;
+		system.messages.push_back(Message{ root_window, WM_MOVE, 0, 0 });
+	}
+
+	void SetWindowProc(const HWND hwnd, WindowProc window_proc)
+	{
+		System& system = GetSystem();
+		std::lock_guard<std::mutex> lock(system.mutex);
+		const auto window = system.windows.find(hwnd);
+		if (window != system.windows.end())
+		{
+			window->second.window_proc = std::move(window_proc);
+		}
+	}
+
+	void PostWindowMessage(const HWND hwnd, const UINT message, const WPARAM wparam, const LPARAM lparam)
+	{
+		System& system = GetSystem();
+		std::lock_guard<std::mutex> lock(system.mutex);
+		system.messages.push_back(Message{ hwnd, message, wparam, lparam });
+	}
+
+	size_t DispatchMessages()
+	{
+		System& system = GetSystem();
+		size_t count = 0;
+
+		// messages posted while dispatching are delivered too, as by a message loop
+		while (true)
+		{
+			Message message;
+			{
+				std::lock_guard<std::mutex> lock(system.mutex);
+				if (system.messages.empty())
+				{
+					break;
+				}
+
+				message = system.messages.front();
+				system.messages.pop_front();
+			}
+
+			Deliver(system, message);
+			++count;
+		}
+
+		std::vector<Timer> due_timers;
+		{
+			std::lock_guard<std::mutex> lock(system.mutex);
+			const SteadyClock::time_point now = SteadyClock::now();
+			for (Timer& timer : system.timers)
+			{
+				if (timer.due_time <= now)
+				{
+					due_timers.push_back(timer);
+					timer.due_time = now + timer.period;
+				}
+			}
+		}
+
+		for (const Timer& timer : due_timers)
+		{
+			if (timer.timer_function != nullptr)
+			{
+				timer.timer_function(timer.hwnd, WM_TIMER, timer.id, GetTickCount());
+			}
+			else
+			{
+				Deliver(system, Message{ timer.hwnd, WM_TIMER, timer.id, 0 });
+			}
+
+			++count;
+		}
+
+		return count;
+	}
+
+	std::chrono::steady_clock::time_point GetNextTimerTime()
+	{
+		System& system = GetSystem();
+		std::lock_guard<std::mutex> lock(system.mutex);
+		SteadyClock::time_point next_time = (SteadyClock::time_point::max)();
+		for (const Timer& timer : system.timers)
+		{
+			next_time = std::min(next_time, timer.due_time);
+		}
+
+		return next_time;
+	}
+
+	void SimulateInput()
+	{
+		System& system = GetSystem();
+		std::lock_guard<std::mutex> lock(system.mutex);
+		system.last_input_time = GetTickCount();
+	}
+
+	void Reset()
+	{
+		System& system = GetSystem();
+		std::lock_guard<std::mutex> lock(system.mutex);
+		system.monitors.clear();
+		system.monitor_count = 0;
+		system.windows.clear();
+		system.messages.clear();
+		system.timers.clear();
+		system.physical_monitors.clear();
+		system.scripts.clear();
+		system.call_log.clear();
+		system.last_input_time = GetTickCount();
+
+		// a new generation, whose calls hang until released again
+		++system.hang_generation;
+		system.is_releasing_hung_calls = false;
+		system.hang_condition.notify_all();
+	}
+}
+
+using fake_windows::GetSystem;
+using fake_windows::System;
+
+HWND GetAncestor(const HWND hwnd, const UINT flags)
+{
+	System& system = GetSystem();
+	std::lock_guard<std::mutex> lock(system.mutex);
+	if (flags == GA_PARENT)
+	{
+		const auto window = system.windows.find(hwnd);
+		return window == system.windows.end() ? nullptr : window->second.parent;
+	}
+
+	return fake_windows::GetRootWindow(system, hwnd);
+}
+
+UINT_PTR SetTimer(const HWND hwnd, const UINT_PTR id, const UINT elapse, const TIMERPROC timer_function)
+{
+	System& system = GetSystem();
+	std::lock_guard<std::mutex> lock(system.mutex);
+	const std::chrono::milliseconds period(std::clamp<UINT>(elapse, USER_TIMER_MINIMUM, USER_TIMER_MAXIMUM));
+	fake_windows::Timer timer{ hwnd, id, period, std::chrono::steady_clock::now() + period, timer_function };
+
+	// setting a timer again replaces it
+	const auto existing = std::find_if(system.timers.begin(), system.timers.end(),
+		[hwnd, id](const fake_windows::Timer& other) { return other.hwnd == hwnd && other.id == id; });
+	if (existing != system.timers.end())
+	{
+		*existing = timer;
+	}
+	else
+	{
+		system.timers.push_back(timer);
+	}
+
+	return id;
+}
+
+BOOL KillTimer(const HWND hwnd, const UINT_PTR id)
+{
+	System& system = GetSystem();
+	std::lock_guard<std::mutex> lock(system.mutex);
+	const auto existing = std::find_if(system.timers.begin(), system.timers.end(),
+		[hwnd, id](const fake_windows::Timer& timer) { return timer.hwnd == hwnd && timer.id == id; });
+	if (existing == system.timers.end())
+	{
+		return FALSE;
+	}
+
+	system.timers.erase(existing);
+	return TRUE;
+}
+
+UINT RegisterWindowMessageA(const LPCSTR string)
+{
+	System& system = GetSystem();
+	std::lock_guard<std::mutex> lock(system.mutex);
+	const auto registered = system.registered_messages.try_emplace(string,
+		fake_windows::kFirstRegisteredMessage + static_cast<UINT>(system.registered_messages.size()));
+	return registered.first->second;
+}
+
+BOOL PostMessageA(const HWND hwnd, const UINT message, const WPARAM wparam, const LPARAM lparam)
+{
+	System& system = GetSystem();
+	std::lock_guard<std::mutex> lock(system.mutex);
+	if (system.windows.count(hwnd) == 0)
+	{
+		return FALSE;
+	}
+
+	system.messages.push_back(fake_windows::Message{ hwnd, message, wparam, lparam });
+	return TRUE;
+}
+
+HMONITOR MonitorFromWindow(const HWND hwnd, const DWORD flags)
+{
+	System& system = GetSystem();
+	std::lock_guard<std::mutex> lock(system.mutex);
+	const auto window = system.windows.find(fake_windows::GetRootWindow(system, hwnd));
+	if (window != system.windows.end() && system.monitors.count(window->second.monitor) != 0)
+	{
+		return window->second.monitor;
+	}
+
+	return flags == MONITOR_DEFAULTTONULL ? nullptr : fake_windows::GetPrimaryMonitor(system);
+}
+
+HMONITOR MonitorFromPoint(const POINT point, const DWORD flags)
+{
+	System& system = GetSystem();
+	std::lock_guard<std::mutex> lock(system.mutex);
+	for (const auto& [handle, monitor] : system.monitors)
+	{
+		const RECT& rect = monitor.config.rect;
+		if (point.x >= rect.left && point.x < rect.right && point.y >= rect.top && point.y < rect.bottom)
+		{
+			return handle;
+		}
+	}
+
+	return flags == MONITOR_DEFAULTTONULL ? nullptr : fake_windows::GetPrimaryMonitor(system);
+}
+
+BOOL GetMonitorInfoA(const HMONITOR monitor, const LPMONITORINFO monitor_info)
+{
+	System& system = GetSystem();
+	std::lock_guard<std::mutex> lock(system.mutex);
+	const auto found = system.monitors.find(monitor);
+	if (found == system.monitors.end() || monitor_info == nullptr || monitor_info->cbSize < sizeof(MONITORINFO))
+	{
+		return FALSE;
+	}
+
+	monitor_info->rcMonitor = found->second.config.rect;
+	monitor_info->rcWork = found->second.config.rect;
+	monitor_info->dwFlags = monitor == fake_windows::GetPrimaryMonitor(system) ? MONITORINFOF_PRIMARY : 0;
+	if (monitor_info->cbSize >= sizeof(MONITORINFOEXA))
+	{
+		const std::string device_name = fake_windows::GetDeviceName(found->second);
+		auto* monitor_info_ex = static_cast<MONITORINFOEXA*>(monitor_info);
+		std::snprintf(monitor_info_ex->szDevice, sizeof(monitor_info_ex->szDevice), "%s", device_name.c_str());
+	}
+
+	return TRUE;
+}
+
+BOOL EnumDisplayMonitors(HDC, LPRECT, const MONITORENUMPROC callback, const LPARAM data)
+{
+	std::vector<std::pair<HMONITOR, RECT>> monitors;
+	{
+		System& system = GetSystem();
+		std::lock_guard<std::mutex> lock(system.mutex);
+		for (const auto& [handle, monitor] : system.monitors)
+		{
+			monitors.emplace_back(handle, monitor.config.rect);
+		}
+	}
+
+	// called without the lock, as the callback queries the monitors
+	for (auto& [handle, rect] : monitors)
+	{
+		if (!callback(handle, nullptr, &rect, data))
+		{
+			break;
+		}
+	}
+
+	return TRUE;
+}
+
+BOOL EnumDisplayDevicesA(const LPCSTR device, const DWORD device_index, const PDISPLAY_DEVICEA display_device, const DWORD flags)
+{
+	System& system = GetSystem();
+	std::lock_guard<std::mutex> lock(system.mutex);
+	if (device == nullptr || device_index != 0 || display_device == nullptr)
+	{
+		return FALSE;
+	}
+
+	for (const auto& [handle, monitor] : system.monitors)
+	{
+		if (fake_windows::GetDeviceName(monitor) != device)
+		{
+			continue;
+		}
+
+		const std::string device_id = (flags & EDD_GET_DEVICE_INTERFACE_NAME) != 0 ? fake_windows::GetInterfaceName(monitor) :
+			"MONITOR\\" + fake_windows::GetProductId(monitor);
+		std::snprintf(display_device->DeviceName, sizeof(display_device->DeviceName), "%s\\Monitor0", device);
+		std::snprintf(display_device->DeviceString, sizeof(display_device->DeviceString), "Generic PnP Monitor");
+		std::snprintf(display_device->DeviceID, sizeof(display_device->DeviceID), "%s", device_id.c_str());
+		display_device->DeviceKey[0] = '\0';
+		display_device->StateFlags = 0;
+		return TRUE;
+	}
+
+	return FALSE;
+}
+
+LSTATUS RegGetValueA(const HKEY key, const LPCSTR sub_key, const LPCSTR value, const DWORD flags, const LPDWORD type, const PVOID data, const LPDWORD data_size)
+{
+	System& system = GetSystem();
+	std::lock_guard<std::mutex> lock(system.mutex);
+	if (key != HKEY_LOCAL_MACHINE || sub_key == nullptr || value == nullptr || std::strcmp(value, "EDID") != 0 || (flags & RRF_RT_REG_BINARY) == 0)
+	{
+		return ERROR_FILE_NOT_FOUND;
+	}
+
+	for (const auto& [handle, monitor] : system.monitors)
+	{
+		if (fake_windows::GetDeviceParametersKey(monitor) != sub_key)
+		{
+			continue;
+		}
+
+		const std::vector<std::uint8_t>& edid = monitor.config.edid;
+		if (type != nullptr)
+		{
+			*type = 3;
+		}
+
+		if (data_size == nullptr)
+		{
+			return ERROR_SUCCESS;
+		}
+
+		const DWORD size = *data_size;
+		*data_size = static_cast<DWORD>(edid.size());
+		if (data == nullptr)
+		{
+			return ERROR_SUCCESS;
+		}
+
+		if (size < edid.size())
+		{
+			return ERROR_MORE_DATA;
+		}
+
+		std::memcpy(data, edid.data(), edid.size());
+		return ERROR_SUCCESS;
+	}
+
+	return ERROR_FILE_NOT_FOUND;
+}
+
+BOOL GetLastInputInfo(const PLASTINPUTINFO last_input_info)
+{
+	System& system = GetSystem();
+	std::lock_guard<std::mutex> lock(system.mutex);
+	if (last_input_info == nullptr || last_input_info->cbSize != sizeof(LASTINPUTINFO))
+	{
+		return FALSE;
+	}
+
+	last_input_info->dwTime = system.last_input_time;
+	return TRUE;
+}
+
+DWORD GetTickCount()
+{
+	// wraps around as the real one does
+	return static_cast<DWORD>(std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now().time_since_epoch()).count());
+}
+
+BOOL GetNumberOfPhysicalMonitorsFromHMONITOR(const HMONITOR monitor, const LPDWORD physical_monitor_count)
+{
+	System& system = GetSystem();
+	std::lock_guard<std::mutex> lock(system.mutex);
+	if (system.monitors.count(monitor) == 0 || physical_monitor_count == nullptr)
+	{
+		return FALSE;
+	}
+
+	*physical_monitor_count = 1;
+	return TRUE;
+}
+
+BOOL GetPhysicalMonitorsFromHMONITOR(const HMONITOR monitor, const DWORD physical_monitor_array_size, const LPPHYSICAL_MONITOR physical_monitor_array)
+{
+	System& system = GetSystem();
+	std::lock_guard<std::mutex> lock(system.mutex);
+	if (system.monitors.count(monitor) == 0 || physical_monitor_array_size != 1 || physical_monitor_array == nullptr)
+	{
+		return FALSE;
+	}
+
+	const auto physical_monitor = fake_windows::ToHandle<HANDLE>(0x30000 + system.next_physical_monitor++);
+	system.physical_monitors.emplace(physical_monitor, monitor);
+	physical_monitor_array[0].hPhysicalMonitor = physical_monitor;
+	std::snprintf(physical_monitor_array[0].szPhysicalMonitorDescription, PHYSICAL_MONITOR_DESCRIPTION_SIZE, "Generic PnP Monitor");
+	return TRUE;
+}
+
+BOOL DestroyPhysicalMonitors(const DWORD physical_monitor_array_size, const LPPHYSICAL_MONITOR physical_monitor_array)
+{
+	System& system = GetSystem();
+	std::lock_guard<std::mutex> lock(system.mutex);
+	BOOL is_destroyed = TRUE;
+	for (DWORD index = 0; index < physical_monitor_array_size; ++index)
+	{
+		if (system.physical_monitors.erase(physical_monitor_array[index].hPhysicalMonitor) == 0)
+		{
+			is_destroyed = FALSE;
+		}
+	}
+
+	return is_destroyed;
+}
+
+BOOL GetMonitorBrightness(const HANDLE monitor, const LPDWORD minimum_brightness, const LPDWORD current_brightness, const LPDWORD maximum_brightness)
+{
+	System& system = GetSystem();
+	std::unique_lock<std::mutex> lock(system.mutex);
+	fake_windows::DdcCallScope call(lock, system, monitor, fake_windows::DdcFunction::kGetMonitorBrightness);
+	const fake_windows::Monitor* physical_monitor = call.monitor();
+	if (physical_monitor == nullptr)
+	{
+		return call.Finish(FALSE);
+	}
+
+	*minimum_brightness = physical_monitor->config.minimum_brightness;
+	*current_brightness = physical_monitor->brightness;
+	*maximum_brightness = physical_monitor->config.maximum_brightness;
+	return call.Finish(TRUE);
+}
+
+BOOL SetMonitorBrightness(const HANDLE monitor, const DWORD new_brightness)
+{
+	System& system = GetSystem();
+	std::unique_lock<std::mutex> lock(system.mutex);
+	fake_windows::DdcCallScope call(lock, system, monitor, fake_windows::DdcFunction::kSetMonitorBrightness, new_brightness);
+	fake_windows::Monitor* physical_monitor = call.monitor();
+	if (physical_monitor == nullptr || new_brightness < physical_monitor->config.minimum_brightness || new_brightness > physical_monitor->config.maximum_brightness)
+	{
+		return call.Finish(FALSE);
+	}
+
+	physical_monitor->brightness = new_brightness;
+	++physical_monitor->set_brightness_count;
+	return call.Finish(TRUE);
+}
+
+BOOL GetVCPFeatureAndVCPFeatureReply(const HANDLE monitor, const BYTE vcp_code, const LPMC_VCP_CODE_TYPE code_type, const LPDWORD current_value, const LPDWORD maximum_value)
+{
+	System& system = GetSystem();
+	std::unique_lock<std::mutex> lock(system.mutex);
+	fake_windows::DdcCallScope call(lock, system, monitor, fake_windows::DdcFunction::kGetVcpFeature);
+	const fake_windows::Monitor* physical_monitor = call.monitor();
+	if (physical_monitor == nullptr)
+	{
+		return call.Finish(FALSE);
+	}
+
+	if (code_type != nullptr)
+	{
+		*code_type = MC_SET_PARAMETER;
+	}
+
+	if (vcp_code == fake_windows::kBrightnessCode)
+	{
+		*current_value = physical_monitor->brightness;
+		*maximum_value = physical_monitor->config.maximum_brightness;
+		return call.Finish(TRUE);
+	}
+
+	const auto value = physical_monitor->vcp_values.find(vcp_code);
+	*current_value = value == physical_monitor->vcp_values.end() ? 50 : value->second;
+	*maximum_value = 100;
+	return call.Finish(TRUE);
+}
+
+BOOL SetVCPFeature(const HANDLE monitor, const BYTE vcp_code, const DWORD new_value)
+{
+	System& system = GetSystem();
+	std::unique_lock<std::mutex> lock(system.mutex);
+	fake_windows::DdcCallScope call(lock, system, monitor, fake_windows::DdcFunction::kSetVcpFeature, new_value);
+	fake_windows::Monitor* physical_monitor = call.monitor();
+	if (physical_monitor == nullptr)
+	{
+		return call.Finish(FALSE);
+	}
+
+	if (vcp_code == fake_windows::kBrightnessCode)
+	{
+		if (new_value > physical_monitor->config.maximum_brightness)
+		{
+			return call.Finish(FALSE);
+		}
+
+		physical_monitor->brightness = new_value;
+		++physical_monitor->set_brightness_count;
+		return call.Finish(TRUE);
+	}
+
+	physical_monitor->vcp_values[vcp_code] = new_value;
+	return call.Finish(TRUE);
+}
+
+BOOL GetCapabilitiesStringLength(const HANDLE monitor, const LPDWORD capabilities_string_length)
+{
+	System& system = GetSystem();
+	std::unique_lock<std::mutex> lock(system.mutex);
+	fake_windows::DdcCallScope call(lock, system, monitor, fake_windows::DdcFunction::kGetCapabilitiesStringLength);
+	const fake_windows::Monitor* physical_monitor = call.monitor();
+	if (physical_monitor == nullptr)
+	{
+		return call.Finish(FALSE);
+	}
+
+	// with the terminating null character
+	*capabilities_string_length = static_cast<DWORD>(physical_monitor->config.capabilities.size() + 1);
+	return call.Finish(TRUE);
+}
+
+BOOL CapabilitiesRequestAndCapabilitiesReply(const HANDLE monitor, const LPSTR capabilities_string, const DWORD capabilities_string_length)
+{
+	System& system = GetSystem();
+	std::unique_lock<std::mutex> lock(system.mutex);
+	fake_windows::DdcCallScope call(lock, system, monitor, fake_windows::DdcFunction::kCapabilitiesRequest);
+	const fake_windows::Monitor* physical_monitor = call.monitor();
+	if (physical_monitor == nullptr || capabilities_string_length < physical_monitor->config.capabilities.size() + 1)
+	{
+		return call.Finish(FALSE);
+	}
+
+	std::memcpy(capabilities_string, physical_monitor->config.capabilities.c_str(), physical_monitor->config.capabilities.size() + 1);
+	return call.Finish(TRUE);
+}
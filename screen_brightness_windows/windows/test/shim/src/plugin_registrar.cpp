@@ -0,0 +1,95 @@
+#include <flutter/plugin_registrar.h>
+#include <flutter/plugin_registrar_windows.h>
+
+#include <fake_flutter_engine.h>
+
+#include <utility>
+
+namespace flutter
+{
+	PluginRegistrar::PluginRegistrar(const FlutterDesktopPluginRegistrarRef core_registrar) : registrar_(core_registrar), messenger_(core_registrar->messenger)
+	{
+	}
+
+	PluginRegistrar::~PluginRegistrar()
+	{
+		ClearPlugins();
+	}
+
+	void PluginRegistrar::AddPlugin(std::unique_ptr<Plugin> plugin)
+	{
+		plugins_.insert(std::move(plugin));
+	}
+
+	void PluginRegistrar::ClearPlugins()
+	{
+		plugins_.clear();
+	}
+
+	PluginRegistrarManager* PluginRegistrarManager::GetInstance()
+	{
+		static PluginRegistrarManager manager;
+		return &manager;
+	}
+
+	void PluginRegistrarManager::OnRegistrarDestroyed(const FlutterDesktopPluginRegistrarRef registrar)
+	{
+		GetInstance()->registrars_.erase(registrar);
+	}
+
+	PluginRegistrarWindows::PluginRegistrarWindows(const FlutterDesktopPluginRegistrarRef core_registrar) : PluginRegistrar(core_registrar)
+	{
+		if (core_registrar->view_window != nullptr)
+		{
+			view_ = std::make_unique<FlutterView>(core_registrar->view_window);
+		}
+	}
+
+	PluginRegistrarWindows::~PluginRegistrarWindows()
+	{
+		ClearPlugins();
+		registrar()->top_level_window_proc = nullptr;
+	}
+
+	int PluginRegistrarWindows::RegisterTopLevelWindowProcDelegate(WindowProcDelegate delegate)
+	{
+		if (window_proc_delegates_.empty())
+		{
+			registrar()->top_level_window_proc = [this](const HWND hwnd, const UINT message, const WPARAM wparam, const LPARAM lparam)
+				{
+					return OnTopLevelWindowProc(hwnd, message, wparam, lparam);
+				};
+		}
+
+		const int proc_id = next_window_proc_id_++;
+		window_proc_delegates_.emplace(proc_id, std::move(delegate));
+		return proc_id;
+	}
+
+	void PluginRegistrarWindows::UnregisterTopLevelWindowProcDelegate(const int proc_id)
+	{
+		window_proc_delegates_.erase(proc_id);
+		if (window_proc_delegates_.empty())
+		{
+			registrar()->top_level_window_proc = nullptr;
+		}
+	}
+
+	std::optional<LRESULT> PluginRegistrarWindows::OnTopLevelWindowProc(const HWND hwnd, const UINT message, const WPARAM wparam, const LPARAM lparam)
+	{
+		std::optional<LRESULT> result;
+
+		// a delegate may unregister itself or others while handling the message
+		const std::map<int, WindowProcDelegate> delegates = window_proc_delegates_;
+		for (const auto& [proc_id, delegate] : delegates)
+		{
+			const std::optional<LRESULT> delegate_result = delegate(hwnd, message, wparam, lparam);
+			if (delegate_result.has_value() && !result.has_value())
+			{
+				result = delegate_result;
+			}
+		}
+
+		return result;
+	}
+}
@@ -0,0 +1,535 @@
+#include <flutter/standard_method_codec.h>
+
+#include <cstring>
+#include <map>
+#include <mutex>
+#include <type_traits>
+
+namespace flutter
+{
+	namespace
+	{
+		enum class EncodedType : std::uint8_t
+		{
+			kNull = 0,
+			kTrue,
+			kFalse,
+			kInt32,
+			kInt64,
+			kLargeInt,
+			kFloat64,
+			kString,
+			kUInt8List,
+			kInt32List,
+			kInt64List,
+			kFloat64List,
+			kList,
+			kMap,
+			kFloat32List,
+		};
+
+		void WriteBytes(std::vector<std::uint8_t>& buffer, const void* data, const std::size_t size)
+		{
+			const auto* bytes = static_cast<const std::uint8_t*>(data);
+			buffer.insert(buffer.end(), bytes, bytes + size);
+		}
+
+		template <typename T>
+		void WriteScalar(std::vector<std::uint8_t>& buffer, const T value)
+		{
+			WriteBytes(buffer, &value, sizeof(value));
+		}
+
+		// Pads to the alignment of the element, relative to the start of the message.
+		void WriteAlignment(std::vector<std::uint8_t>& buffer, const std::size_t alignment)
+		{
+			while (buffer.size() % alignment != 0)
+			{
+				buffer.push_back(0);
+			}
+		}
+
+		// Below 254 in a byte, then 254 and a uint16, then 255 and a uint32.
+		void WriteSize(std::vector<std::uint8_t>& buffer, const std::size_t size)
+		{
+			if (size < 254)
+			{
+				buffer.push_back(static_cast<std::uint8_t>(size));
+			}
+			else if (size <= 0xffff)
+			{
+				buffer.push_back(254);
+				WriteScalar(buffer, static_cast<std::uint16_t>(size));
+			}
+			else
+			{
+				buffer.push_back(255);
+				WriteScalar(buffer, static_cast<std::uint32_t>(size));
+			}
+		}
+
+		template <typename T>
+		void WriteVector(std::vector<std::uint8_t>& buffer, const std::vector<T>& values)
+		{
+			WriteSize(buffer, values.size());
+			if constexpr (sizeof(T) > 1)
+			{
+				WriteAlignment(buffer, sizeof(T));
+			}
+
+			WriteBytes(buffer, values.data(), values.size() * sizeof(T));
+		}
+
+		class Reader final
+		{
+		public:
+			Reader(const std::uint8_t* data, const std::size_t size, std::size_t& position) : data_(data), size_(size), position_(position)
+			{
+			}
+
+			bool ReadBytes(void* destination, const std::size_t size)
+			{
+				if (size > size_ - position_)
+				{
+					return false;
+				}
+
+				if (size > 0)
+				{
+					std::memcpy(destination, data_ + position_, size);
+				}
+
+				position_ += size;
+				return true;
+			}
+
+			template <typename T>
+			bool ReadScalar(T& value)
+			{
+				return ReadBytes(&value, sizeof(value));
+			}
+
+			bool ReadAlignment(const std::size_t alignment)
+			{
+				const std::size_t padding = (alignment - position_ % alignment) % alignment;
+				if (padding > size_ - position_)
+				{
+					return false;
+				}
+
+				position_ += padding;
+				return true;
+			}
+
+			bool ReadSize(std::size_t& size)
+			{
+				std::uint8_t byte = 0;
+				if (!ReadScalar(byte))
+				{
+					return false;
+				}
+
+				if (byte < 254)
+				{
+					size = byte;
+					return true;
+				}
+
+				if (byte == 254)
+				{
+					std::uint16_t value = 0;
+					const bool is_read = ReadScalar(value);
+					size = value;
+					return is_read;
+				}
+
+				std::uint32_t value = 0;
+				const bool is_read = ReadScalar(value);
+				size = value;
+				return is_read;
+			}
+
+			template <typename T>
+			bool ReadVector(std::vector<T>& values)
+			{
+				std::size_t count = 0;
+				if (!ReadSize(count) || count > (size_ - position_) / sizeof(T))
+				{
+					return false;
+				}
+
+				if constexpr (sizeof(T) > 1)
+				{
+					if (!ReadAlignment(sizeof(T)) || count > (size_ - position_) / sizeof(T))
+					{
+						return false;
+					}
+				}
+
+				values.resize(count);
+				return ReadBytes(values.data(), count * sizeof(T));
+			}
+
+			[[nodiscard]] std::size_t remaining() const { return size_ - position_; }
+
+		private:
+			const std::uint8_t* data_;
+
+			std::size_t size_;
+
+			std::size_t& position_;
+		};
+	}
+
+	const StandardCodecSerializer& StandardCodecSerializer::GetInstance()
+	{
+		static const StandardCodecSerializer serializer;
+		return serializer;
+	}
+
+	void StandardCodecSerializer::WriteValue(const EncodableValue& value, std::vector<std::uint8_t>& buffer) const
+	{
+		const auto& variant = static_cast<const EncodableValue::super&>(value);
+		std::visit([this, &buffer](const auto& alternative)
+			{
+				using T = std::decay_t<decltype(alternative)>;
+				if constexpr (std::is_same_v<T, std::monostate>)
+				{
+					buffer.push_back(static_cast<std::uint8_t>(EncodedType::kNull));
+				}
+				else if constexpr (std::is_same_v<T, bool>)
+				{
+					buffer.push_back(static_cast<std::uint8_t>(alternative ? EncodedType::kTrue : EncodedType::kFalse));
+				}
+				else if constexpr (std::is_same_v<T, std::int32_t>)
+				{
+					buffer.push_back(static_cast<std::uint8_t>(EncodedType::kInt32));
+					WriteScalar(buffer, alternative);
+				}
+				else if constexpr (std::is_same_v<T, std::int64_t>)
+				{
+					buffer.push_back(static_cast<std::uint8_t>(EncodedType::kInt64));
+					WriteScalar(buffer, alternative);
+				}
+				else if constexpr (std::is_same_v<T, double>)
+				{
+					buffer.push_back(static_cast<std::uint8_t>(EncodedType::kFloat64));
+					WriteAlignment(buffer, 8);
+					WriteScalar(buffer, alternative);
+				}
+				else if constexpr (std::is_same_v<T, std::string>)
+				{
+					buffer.push_back(static_cast<std::uint8_t>(EncodedType::kString));
+					WriteSize(buffer, alternative.size());
+					WriteBytes(buffer, alternative.data(), alternative.size());
+				}
+				else if constexpr (std::is_same_v<T, std::vector<std::uint8_t>>)
+				{
+					buffer.push_back(static_cast<std::uint8_t>(EncodedType::kUInt8List));
+					WriteVector(buffer, alternative);
+				}
+				else if constexpr (std::is_same_v<T, std::vector<std::int32_t>>)
+				{
+					buffer.push_back(static_cast<std::uint8_t>(EncodedType::kInt32List));
+					WriteVector(buffer, alternative);
+				}
+				else if constexpr (std::is_same_v<T, std::vector<std::int64_t>>)
+				{
+					buffer.push_back(static_cast<std::uint8_t>(EncodedType::kInt64List));
+					WriteVector(buffer, alternative);
+				}
+				else if constexpr (std::is_same_v<T, std::vector<double>>)
+				{
+					buffer.push_back(static_cast<std::uint8_t>(EncodedType::kFloat64List));
+					WriteVector(buffer, alternative);
+				}
+				else if constexpr (std::is_same_v<T, std::vector<float>>)
+				{
+					buffer.push_back(static_cast<std::uint8_t>(EncodedType::kFloat32List));
+					WriteVector(buffer, alternative);
+				}
+				else if constexpr (std::is_same_v<T, EncodableList>)
+				{
+					buffer.push_back(static_cast<std::uint8_t>(EncodedType::kList));
+					WriteSize(buffer, alternative.size());
+					for (const EncodableValue& element : alternative)
+					{
+						WriteValue(element, buffer);
+					}
+				}
+				else if constexpr (std::is_same_v<T, EncodableMap>)
+				{
+					buffer.push_back(static_cast<std::uint8_t>(EncodedType::kMap));
+					WriteSize(buffer, alternative.size());
+					for (const auto& [key, element] : alternative)
+					{
+						WriteValue(key, buffer);
+						WriteValue(element, buffer);
+					}
+				}
+			}, variant);
+	}
+
+	bool StandardCodecSerializer::ReadValue(const std::uint8_t* data, const std::size_t size, std::size_t& position, EncodableValue& value) const
+	{
+		Reader reader(data, size, position);
+		std::uint8_t type = 0;
+		if (!reader.ReadScalar(type))
+		{
+			return false;
+		}
+
+		switch (static_cast<EncodedType>(type))
+		{
+		case EncodedType::kNull:
+			value = EncodableValue();
+			return true;
+		case EncodedType::kTrue:
+			value = EncodableValue(true);
+			return true;
+		case EncodedType::kFalse:
+			value = EncodableValue(false);
+			return true;
+		case EncodedType::kInt32:
+		{
+			std::int32_t integer = 0;
+			value = EncodableValue(integer);
+			return reader.ReadScalar(std::get<std::int32_t>(value));
+		}
+		case EncodedType::kInt64:
+		{
+			std::int64_t integer = 0;
+			value = EncodableValue(integer);
+			return reader.ReadScalar(std::get<std::int64_t>(value));
+		}
+		case EncodedType::kFloat64:
+			value = EncodableValue(0.0);
+			return reader.ReadAlignment(8) && reader.ReadScalar(std::get<double>(value));
+		case EncodedType::kLargeInt:
+		case EncodedType::kString:
+		{
+			std::size_t length = 0;
+			if (!reader.ReadSize(length) || length > reader.remaining())
+			{
+				return false;
+			}
+
+			value = EncodableValue(std::string(length, '\0'));
+			return reader.ReadBytes(std::get<std::string>(value).data(), length);
+		}
+		case EncodedType::kUInt8List:
+			value = EncodableValue(std::vector<std::uint8_t>());
+			return reader.ReadVector(std::get<std::vector<std::uint8_t>>(value));
+		case EncodedType::kInt32List:
+			value = EncodableValue(std::vector<std::int32_t>());
+			return reader.ReadVector(std::get<std::vector<std::int32_t>>(value));
+		case EncodedType::kInt64List:
+			value = EncodableValue(std::vector<std::int64_t>());
+			return reader.ReadVector(std::get<std::vector<std::int64_t>>(value));
+		case EncodedType::kFloat64List:
+			value = EncodableValue(std::vector<double>());
+			return reader.ReadVector(std::get<std::vector<double>>(value));
+		case EncodedType::kFloat32List:
+			value = EncodableValue(std::vector<float>());
+			return reader.ReadVector(std::get<std::vector<float>>(value));
+		case EncodedType::kList:
+		{
+			std::size_t count = 0;
+			if (!reader.ReadSize(count) || count > reader.remaining())
+			{
+				return false;
+			}
+
+			EncodableList list(count);
+			for (EncodableValue& element : list)
+			{
+				if (!ReadValue(data, size, position, element))
+				{
+					return false;
+				}
+			}
+
+			value = EncodableValue(std::move(list));
+			return true;
+		}
+		case EncodedType::kMap:
+		{
+			std::size_t count = 0;
+			if (!reader.ReadSize(count) || count > reader.remaining())
+			{
+				return false;
+			}
+
+			EncodableMap map;
+			for (std::size_t index = 0; index < count; ++index)
+			{
+				EncodableValue key;
+				EncodableValue element;
+				if (!ReadValue(data, size, position, key) || !ReadValue(data, size, position, element))
+				{
+					return false;
+				}
+
+				map.insert_or_assign(std::move(key), std::move(element));
+			}
+
+			value = EncodableValue(std::move(map));
+			return true;
+		}
+		}
+
+		return false;
+	}
+
+	const StandardMessageCodec& StandardMessageCodec::GetInstance(const StandardCodecSerializer* serializer)
+	{
+		// one codec per serializer, which callers compare by address
+		static std::mutex mutex;
+		static std::map<const StandardCodecSerializer*, std::unique_ptr<StandardMessageCodec>> codecs;
+		const StandardCodecSerializer& codec_serializer = serializer == nullptr ? StandardCodecSerializer::GetInstance() : *serializer;
+		std::lock_guard<std::mutex> lock(mutex);
+		std::unique_ptr<StandardMessageCodec>& codec = codecs[&codec_serializer];
+		if (codec == nullptr)
+		{
+			codec.reset(new StandardMessageCodec(codec_serializer));
+		}
+
+		return *codec;
+	}
+
+	std::unique_ptr<std::vector<std::uint8_t>> StandardMessageCodec::EncodeMessage(const EncodableValue& message) const
+	{
+		auto encoded = std::make_unique<std::vector<std::uint8_t>>();
+		serializer_.WriteValue(message, *encoded);
+		return encoded;
+	}
+
+	std::unique_ptr<EncodableValue> StandardMessageCodec::DecodeMessage(const std::uint8_t* message, const std::size_t message_size) const
+	{
+		if (message == nullptr || message_size == 0)
+		{
+			return std::make_unique<EncodableValue>();
+		}
+
+		auto value = std::make_unique<EncodableValue>();
+		std::size_t position = 0;
+		if (!serializer_.ReadValue(message, message_size, position, *value))
+		{
+			return nullptr;
+		}
+
+		return value;
+	}
+
+	const StandardMethodCodec& StandardMethodCodec::GetInstance(const StandardCodecSerializer* serializer)
+	{
+		static std::mutex mutex;
+		static std::map<const StandardCodecSerializer*, std::unique_ptr<StandardMethodCodec>> codecs;
+		const StandardCodecSerializer& codec_serializer = serializer == nullptr ? StandardCodecSerializer::GetInstance() : *serializer;
+		std::lock_guard<std::mutex> lock(mutex);
+		std::unique_ptr<StandardMethodCodec>& codec = codecs[&codec_serializer];
+		if (codec == nullptr)
+		{
+			codec.reset(new StandardMethodCodec(codec_serializer));
+		}
+
+		return *codec;
+	}
+
+	std::unique_ptr<MethodCall<EncodableValue>> StandardMethodCodec::DecodeMethodCallInternal(const std::uint8_t* message, const std::size_t message_size) const
+	{
+		// the method name, then the arguments
+		std::size_t position = 0;
+		EncodableValue method_name;
+		if (message == nullptr || !serializer_.ReadValue(message, message_size, position, method_name) || !std::holds_alternative<std::string>(method_name))
+		{
+			return nullptr;
+		}
+
+		auto arguments = std::make_unique<EncodableValue>();
+		if (position < message_size && !serializer_.ReadValue(message, message_size, position, *arguments))
+		{
+			return nullptr;
+		}
+
+		return std::make_unique<MethodCall<EncodableValue>>(std::get<std::string>(method_name), std::move(arguments));
+	}
+
+	std::unique_ptr<std::vector<std::uint8_t>> StandardMethodCodec::EncodeMethodCallInternal(const MethodCall<EncodableValue>& method_call) const
+	{
+		auto encoded = std::make_unique<std::vector<std::uint8_t>>();
+		serializer_.WriteValue(EncodableValue(method_call.method_name()), *encoded);
+		serializer_.WriteValue(method_call.arguments() == nullptr ? EncodableValue() : *method_call.arguments(), *encoded);
+		return encoded;
+	}
+
+	std::unique_ptr<std::vector<std::uint8_t>> StandardMethodCodec::EncodeSuccessEnvelopeInternal(const EncodableValue* result) const
+	{
+		auto encoded = std::make_unique<std::vector<std::uint8_t>>();
+		encoded->push_back(0);
+		serializer_.WriteValue(result == nullptr ? EncodableValue() : *result, *encoded);
+		return encoded;
+	}
+
+	std::unique_ptr<std::vector<std::uint8_t>> StandardMethodCodec::EncodeErrorEnvelopeInternal(const std::string& error_code, const std::string& error_message,
+		const EncodableValue* error_details) const
+	{
+		auto encoded = std::make_unique<std::vector<std::uint8_t>>();
+		encoded->push_back(1);
+		serializer_.WriteValue(EncodableValue(error_code), *encoded);
+		serializer_.WriteValue(error_message.empty() ? EncodableValue() : EncodableValue(error_message), *encoded);
+		serializer_.WriteValue(error_details == nullptr ? EncodableValue() : *error_details, *encoded);
+		return encoded;
+	}
+
+	bool StandardMethodCodec::DecodeAndProcessResponseEnvelopeInternal(const std::uint8_t* response, const std::size_t response_size,
+		MethodResult<EncodableValue>* result) const
+	{
+		if (response == nullptr || response_size == 0)
+		{
+			return false;
+		}
+
+		std::size_t position = 1;
+		if (response[0] == 0)
+		{
+			EncodableValue value;
+			if (!serializer_.ReadValue(response, response_size, position, value))
+			{
+				return false;
+			}
+
+			if (value.IsNull())
+			{
+				result->Success();
+			}
+			else
+			{
+				result->Success(value);
+			}
+
+			return true;
+		}
+
+		EncodableValue code;
+		EncodableValue message;
+		EncodableValue details;
+		if (response[0] != 1 || !serializer_.ReadValue(response, response_size, position, code) || !std::holds_alternative<std::string>(code) ||
+			!serializer_.ReadValue(response, response_size, position, message) || !serializer_.ReadValue(response, response_size, position, details))
+		{
+			return false;
+		}
+
+		const std::string error_message = std::holds_alternative<std::string>(message) ? std::get<std::string>(message) : std::string();
+		if (details.IsNull())
+		{
+			result->Error(std::get<std::string>(code), error_message);
+		}
+		else
+		{
+			result->Error(std::get<std::string>(code), error_message, details);
+		}
+
+		return true;
+	}
+}
@@ -0,0 +1,175 @@
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "screen_brightness_windows/brightness_service.h"
+#include "screen_brightness_windows/fake_monitor_backend.h"
+#include "screen_brightness_windows/stall_detector.h"
+
+namespace screen_brightness
+{
+	namespace test
+	{
+		using std::chrono::milliseconds;
+
+		constexpr const char* kCallSite = "ScreenBrightnessWindowsPlugin::HandleMethodCall";
+
+		TEST(StallDetectorTest, RecordsOperationsOverBudget)
+		{
+			ManualClock clock;
+			StallDetector detector(clock, milliseconds(16));
+			std::vector<StallRecord> reported;
+			detector.SetStallCallback([&reported](const StallRecord& stall) { reported.push_back(stall); });
+
+			{
+				const StallDetector::Scope scope = detector.Measure("getSystemScreenBrightness", 3, kCallSite);
+				clock.Advance(milliseconds(16));
+			}
+
+			{
+				const StallDetector::Scope scope = detector.Measure("setApplicationScreenBrightness", 3, kCallSite);
+				clock.Advance(milliseconds(45));
+			}
+
+			ASSERT_EQ(reported.size(), 1u);
+			EXPECT_EQ(reported[0].operation, "setApplicationScreenBrightness");
+			EXPECT_EQ(reported[0].display, 3u);
+			EXPECT_EQ(reported[0].call_site, kCallSite);
+			EXPECT_EQ(reported[0].duration, milliseconds(45));
+			EXPECT_EQ(reported[0].time, clock.Now());
+			ASSERT_EQ(detector.recent_stalls().size(), 1u);
+			EXPECT_EQ(detector.statistics().operation_count, 2u);
+			EXPECT_EQ(detector.statistics().stall_count, 1u);
+			EXPECT_EQ(detector.statistics().longest_duration, milliseconds(45));
+			EXPECT_EQ(detector.GetStatistics(3).stall_count, 1u);
+			EXPECT_EQ(detector.GetStatistics(4).operation_count, 0u);
+		}
+
+		TEST(StallDetectorTest, KeepsTheLatestStalls)
+		{
+			ManualClock clock;
+			StallDetector detector(clock, milliseconds(1));
+			for (size_t index = 0; index < StallDetector::kRecentStallCount + 5; ++index)
+			{
+				const std::string operation = "operation " + std::to_string(index);
+				const StallDetector::Scope scope = detector.Measure(operation, 1, kCallSite);
+				clock.Advance(milliseconds(2));
+			}
+
+			ASSERT_EQ(detector.recent_stalls().size(), StallDetector::kRecentStallCount);
+			EXPECT_EQ(detector.recent_stalls().front().operation, "operation 5");
+			EXPECT_EQ(detector.statistics().stall_count, StallDetector::kRecentStallCount + 5);
+
+			// a larger budget applies to later operations
+			detector.SetBudget(milliseconds(10));
+			{
+				const StallDetector::Scope scope = detector.Measure("fast", 1, kCallSite);
+				clock.Advance(milliseconds(2));
+			}
+
+			EXPECT_EQ(detector.statistics().stall_count, StallDetector::kRecentStallCount + 5);
+		}
+
+		// Brightness writes take latency of the detector's clock, like a DDC/CI monitor does of real time.
+		class StallTestMonitorBackend final : public MonitorBackend
+		{
+		public:
+			StallTestMonitorBackend(ManualClock& clock, const Clock::duration latency) : clock_(clock), latency_(latency)
+			{
+			}
+
+			FakeMonitorBackend fake;
+
+			MonitorStatus EnumerateDisplays(std::vector<DisplayInfo>& displays) override
+			{
+				return fake.EnumerateDisplays(displays);
+			}
+
+			DisplayHandle GetPrimaryDisplay() override
+			{
+				return fake.GetPrimaryDisplay();
+			}
+
+			MonitorStatus GetScreenBrightness(const DisplayHandle display, long& minimum_screen_brightness, long& screen_brightness, long& maximum_screen_brightness) override
+			{
+				return fake.GetScreenBrightness(display, minimum_screen_brightness, screen_brightness, maximum_screen_brightness);
+			}
+
+			MonitorStatus SetScreenBrightness(const DisplayHandle display, const long screen_brightness) override
+			{
+				clock_.Advance(latency_);
+				return fake.SetScreenBrightness(display, screen_brightness);
+			}
+
+			MonitorStatus GetVcpFeature(const DisplayHandle display, const VcpCode code, unsigned long& current_value, unsigned long& maximum_value) override
+			{
+				return fake.GetVcpFeature(display, code, current_value, maximum_value);
+			}
+
+			MonitorStatus SetVcpFeature(const DisplayHandle display, const VcpCode code, const unsigned long value) override
+			{
+				return fake.SetVcpFeature(display, code, value);
+			}
+
+			MonitorStatus GetCapabilitiesString(const DisplayHandle display, std::string& capabilities) override
+			{
+				return fake.GetCapabilitiesString(display, capabilities);
+			}
+
+			MonitorStatus GetEdid(const DisplayHandle display, std::vector<std::uint8_t>& edid) override
+			{
+				return fake.GetEdid(display, edid);
+			}
+
+		private:
+			ManualClock& clock_;
+
+			Clock::duration latency_;
+		};
+
+		TEST(StallDetectorTest, FindsTheSlowBrightnessCalls)
+		{
+			ManualClock clock;
+			auto backend = std::make_unique<StallTestMonitorBackend>(clock, milliseconds(60));
+			const DisplayHandle display = backend->fake.AddDisplay({ "slow", 0, 40, 100 });
+			BrightnessClient client(std::make_shared<BrightnessService>(std::move(backend), Clock::Steady(), milliseconds(0), false));
+			client.SetDisplay(display);
+			client.Initialize();
+
+			StallDetector detector(clock);
+			std::vector<std::string> stalled_operations;
+			detector.SetStallCallback([&stalled_operations](const StallRecord& stall) { stalled_operations.push_back(stall.operation); });
+
+			// what the plugin's method call handler does
+			const auto handle_method_call = [&detector, &client](const std::string& method)
+				{
+					const StallDetector::Scope scope = detector.Measure(method, client.display(), kCallSite);
+					if (method == "getSystemScreenBrightness")
+					{
+						(void)client.GetSystemScreenBrightness();
+					}
+					else if (method == "setApplicationScreenBrightness")
+					{
+						(void)client.SetApplicationScreenBrightness(0.8);
+					}
+					else if (method == "resetApplicationScreenBrightness")
+					{
+						(void)client.ResetApplicationScreenBrightness();
+					}
+				};
+			handle_method_call("getSystemScreenBrightness");
+			handle_method_call("setApplicationScreenBrightness");
+			handle_method_call("resetApplicationScreenBrightness");
+			handle_method_call("getSystemScreenBrightness");
+
+			EXPECT_EQ(stalled_operations, std::vector<std::string>({ "setApplicationScreenBrightness", "resetApplicationScreenBrightness" }));
+			const StallStatistics statistics = detector.GetStatistics(display);
+			EXPECT_EQ(statistics.operation_count, 4u);
+			EXPECT_EQ(statistics.stall_count, 2u);
+			EXPECT_EQ(statistics.longest_duration, milliseconds(60));
+		}
+	}
+}
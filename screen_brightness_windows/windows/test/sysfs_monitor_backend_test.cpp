@@ -0,0 +1,148 @@
+#include <gtest/gtest.h>
+
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include "screen_brightness_windows/sysfs_monitor_backend.h"
+
+namespace screen_brightness
+{
+	namespace test
+	{
+		namespace
+		{
+			void WriteFile(const std::filesystem::path& path, const std::string& content)
+			{
+				std::ofstream stream(path);
+				stream << content;
+			}
+
+			std::string ReadFile(const std::filesystem::path& path)
+			{
+				std::ifstream stream(path);
+				std::string content;
+				stream >> content;
+				return content;
+			}
+		}
+
+		class SysfsMonitorBackendTest : public ::testing::Test
+		{
+		protected:
+			std::filesystem::path root_;
+
+			void SetUp() override
+			{
+				std::string pattern = (std::filesystem::temp_directory_path() / "sysfs_backlight_XXXXXX").string();
+				root_ = mkdtemp(pattern.data());
+				AddDevice("intel_backlight", 19200, 9600);
+				AddDevice("acpi_video0", 15, 7);
+				std::filesystem::create_directory(root_ / "not_a_backlight");
+			}
+
+			void TearDown() override
+			{
+				std::filesystem::remove_all(root_);
+			}
+
+			void AddDevice(const std::string& name, const long maximum_brightness, const long brightness)
+			{
+				const auto device = root_ / name;
+				std::filesystem::create_directory(device);
+				WriteFile(device / "max_brightness", std::to_string(maximum_brightness));
+				WriteFile(device / "brightness", std::to_string(brightness));
+				WriteFile(device / "actual_brightness", std::to_string(brightness));
+			}
+		};
+
+		TEST_F(SysfsMonitorBackendTest, EnumeratesBacklightDevicesByName)
+		{
+			SysfsMonitorBackend backend(root_.string());
+			std::vector<DisplayInfo> displays;
+			ASSERT_EQ(backend.EnumerateDisplays(displays), MonitorStatus::kOk);
+
+			ASSERT_EQ(displays.size(), 2u);
+			EXPECT_EQ(displays[0].name, "acpi_video0");
+			EXPECT_EQ(displays[1].name, "intel_backlight");
+			EXPECT_EQ(backend.GetPrimaryDisplay(), displays[0].handle);
+		}
+
+		TEST_F(SysfsMonitorBackendTest, ReadsAndWritesBrightness)
+		{
+			SysfsMonitorBackend backend(root_.string());
+			std::vector<DisplayInfo> displays;
+			ASSERT_EQ(backend.EnumerateDisplays(displays), MonitorStatus::kOk);
+			const DisplayHandle display = displays[1].handle;
+
+			long minimum = -1, brightness = -1, maximum = -1;
+			ASSERT_EQ(backend.GetScreenBrightness(display, minimum, brightness, maximum), MonitorStatus::kOk);
+			EXPECT_EQ(minimum, 0);
+			EXPECT_EQ(brightness, 9600);
+			EXPECT_EQ(maximum, 19200);
+
+			ASSERT_EQ(backend.SetScreenBrightness(display, 4800), MonitorStatus::kOk);
+			EXPECT_EQ(ReadFile(root_ / "intel_backlight" / "brightness"), "4800");
+		}
+
+		TEST_F(SysfsMonitorBackendTest, MapsLuminanceVcpFeatureToBacklight)
+		{
+			SysfsMonitorBackend backend(root_.string());
+			unsigned long current = 0, maximum = 0;
+			ASSERT_EQ(backend.GetVcpFeature(1, kVcpLuminance, current, maximum), MonitorStatus::kOk);
+			EXPECT_EQ(current, 7u);
+			EXPECT_EQ(maximum, 15u);
+
+			ASSERT_EQ(backend.SetVcpFeature(1, kVcpLuminance, 3), MonitorStatus::kOk);
+			EXPECT_EQ(ReadFile(root_ / "acpi_video0" / "brightness"), "3");
+			EXPECT_EQ(backend.GetVcpFeature(1, kVcpContrast, current, maximum), MonitorStatus::kUnsupported);
+			std::string capabilities;
+			EXPECT_EQ(backend.GetCapabilitiesString(1, capabilities), MonitorStatus::kUnsupported);
+		}
+
+		TEST_F(SysfsMonitorBackendTest, ReadsConnectorEdid)
+		{
+			std::filesystem::create_directory(root_ / "intel_backlight" / "device");
+			const std::string edid(256, '\x5a');
+			WriteFile(root_ / "intel_backlight" / "device" / "edid", edid);
+			SysfsMonitorBackend backend(root_.string());
+
+			std::vector<std::uint8_t> blob;
+			ASSERT_EQ(backend.GetEdid(2, blob), MonitorStatus::kOk);
+			EXPECT_EQ(blob, std::vector<std::uint8_t>(edid.begin(), edid.end()));
+			EXPECT_EQ(backend.GetEdid(1, blob), MonitorStatus::kUnsupported);
+		}
+
+		TEST_F(SysfsMonitorBackendTest, UnknownDisplayIsReported)
+		{
+			SysfsMonitorBackend backend(root_.string());
+			long minimum = 0, brightness = 0, maximum = 0;
+
+			EXPECT_EQ(backend.GetScreenBrightness(0, minimum, brightness, maximum), MonitorStatus::kNoMonitors);
+			EXPECT_EQ(backend.SetScreenBrightness(3, 1), MonitorStatus::kNoMonitors);
+		}
+
+		TEST_F(SysfsMonitorBackendTest, UnreadableDeviceIsReported)
+		{
+			SysfsMonitorBackend backend(root_.string());
+			std::filesystem::remove(root_ / "acpi_video0" / "actual_brightness");
+			std::filesystem::remove(root_ / "acpi_video0" / "brightness");
+			long minimum = 0, brightness = 0, maximum = 0;
+
+			EXPECT_EQ(backend.GetScreenBrightness(1, minimum, brightness, maximum), MonitorStatus::kGetBrightnessFailed);
+			EXPECT_EQ(backend.SetScreenBrightness(1, 1), MonitorStatus::kSetBrightnessFailed);
+		}
+
+		TEST_F(SysfsMonitorBackendTest, MissingRootHasNoDisplays)
+		{
+			SysfsMonitorBackend backend((root_ / "missing").string());
+
+			std::vector<DisplayInfo> displays;
+			ASSERT_EQ(backend.EnumerateDisplays(displays), MonitorStatus::kOk);
+			EXPECT_TRUE(displays.empty());
+			EXPECT_EQ(backend.GetPrimaryDisplay(), 0u);
+		}
+	}
+}
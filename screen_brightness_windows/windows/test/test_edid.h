@@ -0,0 +1,164 @@
+#ifndef FLUTTER_PLUGIN_SCREEN_BRIGHTNESS_WINDOWS_PLUGIN_TEST_EDID_H
+#define FLUTTER_PLUGIN_SCREEN_BRIGHTNESS_WINDOWS_PLUGIN_TEST_EDID_H
+
+#include <algorithm>
+#include <cstdint>
+#include <iterator>
+#include <string>
+#include <vector>
+
+namespace screen_brightness
+{
+	namespace test
+	{
+		// Fields of an EDID base block as monitors fill them in.
+		struct TestEdid
+		{
+			std::string manufacturer_id = "DEL";
+
+			std::uint16_t product_code = 0xa0f5;
+
+			std::uint32_t serial_number = 0x4c4d3153;
+
+			std::uint8_t week = 12;
+
+			std::uint8_t year = 30;
+
+			std::string monitor_name = "DELL U2720Q";
+
+			std::string serial_string = "8ZJNZ13";
+
+			// 0xfe descriptor, used by laptop panels for the panel part number
+			std::string text;
+
+			std::uint8_t width_centimeters = 60;
+
+			std::uint8_t height_centimeters = 34;
+
+			// physical size in the preferred detailed timing, 0 for none
+			int width_millimeters = 597;
+
+			int height_millimeters = 336;
+
+			std::uint8_t extension_count = 0;
+		};
+
+		inline void WriteDescriptorText(std::uint8_t* descriptor, const std::uint8_t tag, const std::string& text)
+		{
+			descriptor[3] = tag;
+			size_t index = 0;
+			for (; index < text.size() && index < 13; ++index)
+			{
+				descriptor[5 + index] = static_cast<std::uint8_t>(text[index]);
+			}
+
+			for (bool is_terminated = false; index < 13; ++index, is_terminated = true)
+			{
+				descriptor[5 + index] = is_terminated ? ' ' : '\n';
+			}
+		}
+
+		// Encodes a base block with a valid checksum, followed by empty extension blocks.
+		inline std::vector<std::uint8_t> CreateEdid(const TestEdid& fields)
+		{
+			std::vector<std::uint8_t> edid(128 * (1 + fields.extension_count), 0);
+			const std::uint8_t header[] = { 0x00, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0x00 };
+			std::copy(std::begin(header), std::end(header), edid.begin());
+
+			const int manufacturer = ((fields.manufacturer_id[0] - 'A' + 1) << 10) | ((fields.manufacturer_id[1] - 'A' + 1) << 5) |
+				(fields.manufacturer_id[2] - 'A' + 1);
+			edid[8] = static_cast<std::uint8_t>(manufacturer >> 8);
+			edid[9] = static_cast<std::uint8_t>(manufacturer);
+			edid[10] = static_cast<std::uint8_t>(fields.product_code);
+			edid[11] = static_cast<std::uint8_t>(fields.product_code >> 8);
+			for (int index = 0; index < 4; ++index)
+			{
+				edid[12 + index] = static_cast<std::uint8_t>(fields.serial_number >> (8 * index));
+			}
+
+			edid[16] = fields.week;
+			edid[17] = fields.year;
+			edid[18] = 1;
+			edid[19] = 4;
+			edid[21] = fields.width_centimeters;
+			edid[22] = fields.height_centimeters;
+
+			std::uint8_t* descriptor = edid.data() + 54;
+			if (fields.width_millimeters != 0)
+			{
+				// 3840x2160 at 60 Hz
+				descriptor[0] = 0x08;
+				descriptor[1] = 0xe8;
+				descriptor[12] = static_cast<std::uint8_t>(fields.width_millimeters);
+				descriptor[13] = static_cast<std::uint8_t>(fields.height_millimeters);
+				descriptor[14] = static_cast<std::uint8_t>(((fields.width_millimeters >> 8) << 4) | (fields.height_millimeters >> 8));
+				descriptor += 18;
+			}
+
+			if (!fields.monitor_name.empty())
+			{
+				WriteDescriptorText(descriptor, 0xfc, fields.monitor_name);
+				descriptor += 18;
+			}
+
+			if (!fields.serial_string.empty())
+			{
+				WriteDescriptorText(descriptor, 0xff, fields.serial_string);
+				descriptor += 18;
+			}
+
+			if (!fields.text.empty())
+			{
+				WriteDescriptorText(descriptor, 0xfe, fields.text);
+			}
+
+			edid[126] = fields.extension_count;
+			std::uint8_t sum = 0;
+			for (int index = 0; index < 127; ++index)
+			{
+				sum = static_cast<std::uint8_t>(sum + edid[index]);
+			}
+
+			edid[127] = static_cast<std::uint8_t>(0x100 - sum);
+			return edid;
+		}
+
+		// Published EDIDs, byte for byte, next to the synthetic ones above: the generic 1024x768, 1280x1024 and
+		// 1920x1080 blocks the Linux kernel built in for drm.edid_firmware (drivers/gpu/drm/drm_edid_load.c, generated
+		// from tools/edid). Each has a range limits descriptor, which CreateEdid never writes.
+		inline const std::vector<std::uint8_t> kLinuxXgaEdid = {
+			0x00, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0x00, 0x31, 0xd8, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+			0x05, 0x16, 0x01, 0x03, 0x6d, 0x23, 0x1a, 0x78, 0xea, 0x5e, 0xc0, 0xa4, 0x59, 0x4a, 0x98, 0x25,
+			0x20, 0x50, 0x54, 0x00, 0x08, 0x00, 0x61, 0x40, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01,
+			0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x64, 0x19, 0x00, 0x40, 0x41, 0x00, 0x26, 0x30, 0x08, 0x90,
+			0x36, 0x00, 0x63, 0x0a, 0x11, 0x00, 0x00, 0x18, 0x00, 0x00, 0x00, 0xff, 0x00, 0x4c, 0x69, 0x6e,
+			0x75, 0x78, 0x20, 0x23, 0x30, 0x0a, 0x20, 0x20, 0x20, 0x20, 0x00, 0x00, 0x00, 0xfd, 0x00, 0x3b,
+			0x3d, 0x2f, 0x31, 0x07, 0x00, 0x0a, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x00, 0x00, 0x00, 0xfc,
+			0x00, 0x4c, 0x69, 0x6e, 0x75, 0x78, 0x20, 0x58, 0x47, 0x41, 0x0a, 0x20, 0x20, 0x20, 0x00, 0x55,
+		};
+
+		inline const std::vector<std::uint8_t> kLinuxSxgaEdid = {
+			0x00, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0x00, 0x31, 0xd8, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+			0x05, 0x16, 0x01, 0x03, 0x6d, 0x2c, 0x23, 0x78, 0xea, 0x5e, 0xc0, 0xa4, 0x59, 0x4a, 0x98, 0x25,
+			0x20, 0x50, 0x54, 0x00, 0x00, 0x00, 0x81, 0x80, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01,
+			0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x30, 0x2a, 0x00, 0x98, 0x51, 0x00, 0x2a, 0x40, 0x30, 0x70,
+			0x13, 0x00, 0xbc, 0x63, 0x11, 0x00, 0x00, 0x1e, 0x00, 0x00, 0x00, 0xff, 0x00, 0x4c, 0x69, 0x6e,
+			0x75, 0x78, 0x20, 0x23, 0x30, 0x0a, 0x20, 0x20, 0x20, 0x20, 0x00, 0x00, 0x00, 0xfd, 0x00, 0x3b,
+			0x3d, 0x3e, 0x40, 0x0b, 0x00, 0x0a, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x00, 0x00, 0x00, 0xfc,
+			0x00, 0x4c, 0x69, 0x6e, 0x75, 0x78, 0x20, 0x53, 0x58, 0x47, 0x41, 0x0a, 0x20, 0x20, 0x00, 0xa0,
+		};
+
+		inline const std::vector<std::uint8_t> kLinuxFhdEdid = {
+			0x00, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0x00, 0x31, 0xd8, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+			0x05, 0x16, 0x01, 0x03, 0x6d, 0x32, 0x1c, 0x78, 0xea, 0x5e, 0xc0, 0xa4, 0x59, 0x4a, 0x98, 0x25,
+			0x20, 0x50, 0x54, 0x00, 0x00, 0x00, 0xd1, 0xc0, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01,
+			0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x02, 0x3a, 0x80, 0x18, 0x71, 0x38, 0x2d, 0x40, 0x58, 0x2c,
+			0x45, 0x00, 0xf4, 0x19, 0x11, 0x00, 0x00, 0x1e, 0x00, 0x00, 0x00, 0xff, 0x00, 0x4c, 0x69, 0x6e,
+			0x75, 0x78, 0x20, 0x23, 0x30, 0x0a, 0x20, 0x20, 0x20, 0x20, 0x00, 0x00, 0x00, 0xfd, 0x00, 0x3b,
+			0x3d, 0x42, 0x44, 0x0f, 0x00, 0x0a, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x00, 0x00, 0x00, 0xfc,
+			0x00, 0x4c, 0x69, 0x6e, 0x75, 0x78, 0x20, 0x46, 0x48, 0x44, 0x0a, 0x20, 0x20, 0x20, 0x00, 0x05,
+		};
+	}
+}
+
+#endif
@@ -0,0 +1,185 @@
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <string>
+#include <vector>
+
+#include "screen_brightness_windows/clock.h"
+#include "screen_brightness_windows/ddc_scheduler.h"
+#include "screen_brightness_windows/display_topology.h"
+#include "screen_brightness_windows/fake_monitor_backend.h"
+#include "screen_brightness_windows/scheduled_monitor_backend.h"
+#include "screen_brightness_windows/vcp_feature_controller.h"
+#include "test_edid.h"
+
+namespace screen_brightness
+{
+	namespace test
+	{
+		using std::chrono::milliseconds;
+
+		class VcpFeatureControllerTest : public ::testing::Test
+		{
+		protected:
+			void SetUp() override
+			{
+				FakeMonitorBackend::Display monitor{ "monitor", 0, 40, 100 };
+				monitor.vcp_features[kVcpContrast] = { 50, 100 };
+				monitor.vcp_features[kVcpColorPreset] = { 5, 11 };
+				monitor.vcp_features[kVcpInputSource] = { 0x0f, 0x12 };
+				monitor.capabilities = "(prot(monitor)type(lcd)vcp(10 12 14(05 08 0B) 60(0F 11 12)))";
+				monitor.edid = CreateEdid(TestEdid());
+				display_ = fake_backend_.AddDisplay(monitor);
+				UpdateTopology();
+			}
+
+			void UpdateTopology()
+			{
+				DisplayTopologyDelta delta;
+				ASSERT_EQ(topology_.Update(delta), MonitorStatus::kOk);
+			}
+
+			ManualClock clock_;
+
+			FakeMonitorBackend fake_backend_;
+
+			ScheduledMonitorBackend scheduled_backend_{ fake_backend_, clock_, DdcScheduler::kMccsMinimumCommandInterval, false };
+
+			DisplayTopology topology_{ fake_backend_ };
+
+			VcpFeatureController controller_{ scheduled_backend_, topology_ };
+
+			DisplayHandle display_ = 0;
+		};
+
+		TEST_F(VcpFeatureControllerTest, ReadsCodesInOneSlot)
+		{
+			const Clock::time_point start_time = clock_.Now();
+			std::vector<VcpFeatureValue> features;
+
+			ASSERT_EQ(controller_.GetVcpFeatures(display_, { kVcpLuminance, kVcpContrast, kVcpInputSource }, features), MonitorStatus::kOk);
+
+			ASSERT_EQ(features.size(), 3u);
+			EXPECT_EQ(features[0].code, kVcpLuminance);
+			EXPECT_EQ(features[0].current_value, 40u);
+			EXPECT_EQ(features[1].code, kVcpContrast);
+			EXPECT_EQ(features[1].current_value, 50u);
+			EXPECT_EQ(features[1].maximum_value, 100u);
+			EXPECT_EQ(features[2].current_value, 0x0fu);
+			EXPECT_EQ(fake_backend_.vcp_get_count(), 3);
+			// one scheduling slot, with the reads inside it spaced like any other commands
+			EXPECT_EQ(scheduled_backend_.GetScheduler(display_).metrics().executed_count, 1u);
+			EXPECT_EQ(clock_.Now() - start_time, milliseconds(100));
+		}
+
+		TEST_F(VcpFeatureControllerTest, UnsupportedCodeFailsOnlyItself)
+		{
+			std::vector<VcpFeatureValue> features;
+
+			ASSERT_EQ(controller_.GetVcpFeatures(display_, { 0xdc, kVcpColorPreset }, features), MonitorStatus::kOk);
+
+			EXPECT_EQ(features[0].status, MonitorStatus::kUnsupported);
+			EXPECT_EQ(features[1].status, MonitorStatus::kOk);
+			EXPECT_EQ(features[1].current_value, 5u);
+			EXPECT_EQ(features[1].maximum_value, 11u);
+		}
+
+		TEST_F(VcpFeatureControllerTest, MissingDisplayStopsBatch)
+		{
+			std::vector<VcpFeatureValue> features;
+
+			EXPECT_EQ(controller_.GetVcpFeatures(display_ + 1, { kVcpContrast, kVcpColorPreset }, features), MonitorStatus::kNoMonitors);
+			EXPECT_EQ(fake_backend_.vcp_get_count(), 1);
+		}
+
+		TEST_F(VcpFeatureControllerTest, SetsFeature)
+		{
+			ASSERT_EQ(controller_.SetVcpFeature(display_, kVcpInputSource, 0x11), MonitorStatus::kOk);
+			ASSERT_EQ(controller_.SetVcpFeature(display_, kVcpLuminance, 70), MonitorStatus::kOk);
+
+			EXPECT_EQ(fake_backend_.GetDisplay(display_).vcp_features[kVcpInputSource].current_value, 0x11u);
+			EXPECT_EQ(fake_backend_.GetDisplay(display_).brightness, 70);
+		}
+
+		TEST_F(VcpFeatureControllerTest, LuminanceWriteSupersedesQueuedBrightnessStep)
+		{
+			std::vector<MonitorStatus> completions;
+			scheduled_backend_.GetScheduler(display_).Submit(DdcPriority::kAnimationStep, kDdcBrightnessWrite, [this]
+				{
+					return fake_backend_.SetScreenBrightness(display_, 10);
+				}, [&completions](const MonitorStatus status) { completions.push_back(status); });
+
+			ASSERT_EQ(controller_.SetVcpFeature(display_, kVcpLuminance, 70), MonitorStatus::kOk);
+
+			ASSERT_EQ(completions.size(), 1u);
+			EXPECT_EQ(completions[0], MonitorStatus::kPreempted);
+			EXPECT_EQ(fake_backend_.GetDisplay(display_).brightness, 70);
+		}
+
+		TEST_F(VcpFeatureControllerTest, CachesCapabilitiesPerDisplay)
+		{
+			std::string capabilities;
+
+			ASSERT_EQ(controller_.GetCapabilitiesString(display_, capabilities), MonitorStatus::kOk);
+			ASSERT_EQ(controller_.GetCapabilitiesString(display_, capabilities), MonitorStatus::kOk);
+
+			EXPECT_EQ(capabilities, fake_backend_.GetDisplay(display_).capabilities);
+			EXPECT_EQ(fake_backend_.capabilities_count(), 1);
+		}
+
+		TEST_F(VcpFeatureControllerTest, KeepsCapabilitiesAcrossReplug)
+		{
+			std::string capabilities;
+			ASSERT_EQ(controller_.GetCapabilitiesString(display_, capabilities), MonitorStatus::kOk);
+
+			// the same monitor comes back on another port, with a new handle
+			FakeMonitorBackend::Display monitor = fake_backend_.GetDisplay(display_);
+			monitor.name = "monitor on another port";
+			fake_backend_.RemoveDisplay(display_);
+			display_ = fake_backend_.AddDisplay(monitor);
+			UpdateTopology();
+
+			ASSERT_EQ(controller_.GetCapabilitiesString(display_, capabilities), MonitorStatus::kOk);
+			EXPECT_EQ(fake_backend_.capabilities_count(), 1);
+
+			// another model is asked for its own capabilities
+			FakeMonitorBackend::Display other_monitor{ "other monitor", 0, 40, 100 };
+			TestEdid other_edid;
+			other_edid.product_code = 0xa0f6;
+			other_monitor.edid = CreateEdid(other_edid);
+			other_monitor.capabilities = "(prot(monitor)vcp(10))";
+			const DisplayHandle other_display = fake_backend_.AddDisplay(other_monitor);
+			UpdateTopology();
+			ASSERT_EQ(controller_.GetCapabilitiesString(other_display, capabilities), MonitorStatus::kOk);
+			EXPECT_EQ(capabilities, "(prot(monitor)vcp(10))");
+			EXPECT_EQ(fake_backend_.capabilities_count(), 2);
+		}
+
+		TEST_F(VcpFeatureControllerTest, ParsesCachedCapabilities)
+		{
+			const MccsCapabilities* capabilities = nullptr;
+
+			ASSERT_EQ(controller_.GetCapabilities(display_, capabilities), MonitorStatus::kOk);
+
+			ASSERT_NE(capabilities, nullptr);
+			EXPECT_TRUE(capabilities->IsSupported(kVcpContrast));
+			EXPECT_TRUE(capabilities->IsAllowed(kVcpInputSource, 0x11));
+			EXPECT_FALSE(capabilities->IsAllowed(kVcpInputSource, 0x10));
+			std::string text;
+			ASSERT_EQ(controller_.GetCapabilitiesString(display_, text), MonitorStatus::kOk);
+			EXPECT_EQ(fake_backend_.capabilities_count(), 1);
+		}
+
+		TEST_F(VcpFeatureControllerTest, DoesNotCacheCapabilitiesFailure)
+		{
+			fake_backend_.GetDisplay(display_).is_failing = true;
+			std::string capabilities;
+
+			EXPECT_EQ(controller_.GetCapabilitiesString(display_, capabilities), MonitorStatus::kGetCapabilitiesFailed);
+
+			fake_backend_.GetDisplay(display_).is_failing = false;
+			EXPECT_EQ(controller_.GetCapabilitiesString(display_, capabilities), MonitorStatus::kOk);
+			EXPECT_EQ(fake_backend_.capabilities_count(), 2);
+		}
+	}
+}
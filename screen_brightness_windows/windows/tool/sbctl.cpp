@@ -0,0 +1,530 @@
+// sbctl: command-line access to the screen brightness core, for scripting and benchmarking without Flutter.
+//
+// usage: sbctl [--backend=system|fake] [--interval=<ms>] [--broker[=<socket>]] [--record=<trace>|--replay=<trace>] <command>
+//   list                                 list displays
+//   get [display]                        print brightness (0.0 - 1.0)
+//   set <brightness> [display]           set brightness (0.0 - 1.0)
+//   benchmark [iterations] [display]     time brightness get and set round trips
+//   vcp <code>[,<code>...] [display]     read VCP features in one bus slot, e.g. vcp 0x12,0x60
+//   vcp-set <code> <value> [display]     write a VCP feature
+//   capabilities [display]               print the MCCS capability string
+//   edid [display]                       print the EDID identification and the display identity
+//   serve [socket]                       run a brightness broker for other processes (not on Windows)
+//   restore [journal]                    restore displays left overridden by processes which have exited
+//   watchdog [journal]                   restore them as the processes exit, until killed
+//   ambient [iio-devices] [display]      follow the ambient light sensor until killed (not on Windows)
+//   idle <timeout-ms> [display]          dim the display after a time without input, until killed (not on Windows)
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <exception>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "screen_brightness_windows/ambient_brightness.h"
+#include "screen_brightness_windows/brightness_service.h"
+#include "screen_brightness_windows/display_topology.h"
+#include "screen_brightness_windows/edid.h"
+#include "screen_brightness_windows/fake_monitor_backend.h"
+#include "screen_brightness_windows/idle_dimmer.h"
+#include "screen_brightness_windows/monitor_trace.h"
+#include "screen_brightness_windows/restore_journal.h"
+#include "screen_brightness_windows/vcp_feature_controller.h"
+
+#ifdef _WIN32
+#include "screen_brightness_windows/dxva2_monitor_backend.h"
+#else
+#include "screen_brightness_windows/broker_monitor_backend.h"
+#include "screen_brightness_windows/broker_server.h"
+#include "screen_brightness_windows/evdev_activity_source.h"
+#include "screen_brightness_windows/iio_ambient_light_source.h"
+#include "screen_brightness_windows/sysfs_monitor_backend.h"
+#endif
+
+namespace
+{
+	using screen_brightness::BrightnessClient;
+	using screen_brightness::BrightnessService;
+	using screen_brightness::DdcScheduler;
+	using screen_brightness::DdcSchedulerMetrics;
+	using screen_brightness::DisplayHandle;
+	using screen_brightness::MonitorBackend;
+	using screen_brightness::MonitorStatus;
+	using screen_brightness::VcpCode;
+
+	void Check(const MonitorStatus status)
+	{
+		if (status != MonitorStatus::kOk)
+		{
+			throw std::runtime_error(screen_brightness::GetMonitorStatusMessage(status));
+		}
+	}
+
+	int PrintUsage()
+	{
+		std::fprintf(stderr,
+			"usage: sbctl [--backend=system|fake] [--interval=<ms>] [--broker[=<socket>]] [--record=<trace>|--replay=<trace>] <command>\n"
+			"  list                                 list displays\n"
+			"  get [display]                        print brightness (0.0 - 1.0)\n"
+			"  set <brightness> [display]           set brightness (0.0 - 1.0)\n"
+			"  benchmark [iterations] [display]     time brightness get and set round trips\n"
+			"  vcp <code>[,<code>...] [display]     read VCP features in one bus slot, e.g. vcp 0x12,0x60\n"
+			"  vcp-set <code> <value> [display]     write a VCP feature\n"
+			"  capabilities [display]               print the MCCS capability string\n"
+			"  edid [display]                       print the EDID identification and the display identity\n"
+			"  serve [socket]                       run a brightness broker for other processes (not on Windows)\n"
+			"  restore [journal]                    restore displays left overridden by processes which have exited\n"
+			"  watchdog [journal]                   restore them as the processes exit, until killed\n"
+			"  ambient [iio-devices] [display]      follow the ambient light sensor until killed (not on Windows)\n"
+			"  idle <timeout-ms> [display]          dim the display after a time without input, until killed (not on Windows)\n");
+		return 2;
+	}
+
+	std::unique_ptr<MonitorBackend> CreateBackend(const std::string& name)
+	{
+		if (name == "fake")
+		{
+			auto backend = std::make_unique<screen_brightness::FakeMonitorBackend>();
+			screen_brightness::FakeMonitorBackend::Display display{ "fake0", 0, 50, 100 };
+			display.vcp_features[screen_brightness::kVcpContrast] = { 50, 100 };
+			display.vcp_features[screen_brightness::kVcpInputSource] = { 0x0f, 0x12 };
+			display.capabilities = "(prot(monitor)type(lcd)model(fake)vcp(10 12 60(0F 11 12))mccs_ver(2.2))";
+			backend->AddDisplay(display);
+			backend->AddDisplay({ "fake1", 0, 80, 100 });
+			return backend;
+		}
+
+		if (name != "system")
+		{
+			return nullptr;
+		}
+
+#ifdef _WIN32
+		return std::make_unique<screen_brightness::Dxva2MonitorBackend>();
+#else
+		return std::make_unique<screen_brightness::SysfsMonitorBackend>();
+#endif
+	}
+
+	// Resolves a display index as printed by `list`, or the primary display when no index is given.
+	DisplayHandle ResolveDisplay(MonitorBackend& backend, const std::vector<std::string>& args, const size_t position)
+	{
+		if (args.size() <= position)
+		{
+			return backend.GetPrimaryDisplay();
+		}
+
+		std::vector<screen_brightness::DisplayInfo> displays;
+		Check(backend.EnumerateDisplays(displays));
+		const size_t index = std::strtoul(args[position].c_str(), nullptr, 10);
+		if (index >= displays.size())
+		{
+			throw std::runtime_error("Unknown display " + args[position]);
+		}
+
+		return displays[index].handle;
+	}
+
+	VcpCode ParseVcpCode(const std::string& text)
+	{
+		char* end = nullptr;
+		const unsigned long code = std::strtoul(text.c_str(), &end, 0);
+		if (end == text.c_str() || *end != '\0' || code > 0xff)
+		{
+			throw std::runtime_error("Invalid VCP code " + text);
+		}
+
+		return static_cast<VcpCode>(code);
+	}
+
+	double Percentile(std::vector<double> samples, const double percentile)
+	{
+		std::sort(samples.begin(), samples.end());
+		const size_t index = static_cast<size_t>(percentile * static_cast<double>(samples.size() - 1));
+		return samples[index];
+	}
+
+	void PrintSamples(const char* name, const std::vector<double>& samples)
+	{
+		double total = 0;
+		for (const double sample : samples)
+		{
+			total += sample;
+		}
+
+		std::printf("%-4s n=%zu mean=%.1fus p50=%.1fus p99=%.1fus max=%.1fus\n", name, samples.size(),
+			total / static_cast<double>(samples.size()), Percentile(samples, 0.5), Percentile(samples, 0.99),
+			Percentile(samples, 1.0));
+	}
+
+	void PrintMetrics(const DdcScheduler& scheduler)
+	{
+		using std::chrono::duration;
+
+		const auto to_milliseconds = [](const screen_brightness::Clock::duration time) { return duration<double, std::milli>(time).count(); };
+		const DdcSchedulerMetrics metrics = scheduler.metrics();
+		const double mean_wait = metrics.executed_count == 0 ? 0 :
+			to_milliseconds(metrics.total_wait_time) / static_cast<double>(metrics.executed_count);
+		std::printf("bus  commands=%llu preempted=%llu shed=%llu max_queue_depth=%zu mean_wait=%.1fms max_wait=%.1fms\n",
+			static_cast<unsigned long long>(metrics.executed_count), static_cast<unsigned long long>(metrics.preempted_count),
+			static_cast<unsigned long long>(metrics.shed_count), metrics.maximum_queue_depth, mean_wait, to_milliseconds(metrics.maximum_wait_time));
+
+		const screen_brightness::DdcPacing pacing = scheduler.pacing();
+		std::printf("ddc  smoothed=%.1fms deviation=%.1fms p50=%.1fms p90=%.1fms p99=%.1fms period=%.1fms poll=%.1fms\n",
+			to_milliseconds(metrics.latency.smoothed), to_milliseconds(metrics.latency.deviation), to_milliseconds(metrics.latency.p50),
+			to_milliseconds(metrics.latency.p90), to_milliseconds(metrics.latency.p99), to_milliseconds(pacing.command_period),
+			to_milliseconds(pacing.poll_interval));
+	}
+
+	int RunBenchmark(BrightnessClient& client, const long iterations)
+	{
+		using Clock = std::chrono::steady_clock;
+
+		std::vector<double> get_samples, set_samples;
+		get_samples.reserve(iterations);
+		set_samples.reserve(iterations);
+		for (long iteration = 0; iteration < iterations; ++iteration)
+		{
+			auto start = Clock::now();
+			double brightness = 0;
+			Check(client.GetApplicationScreenBrightness(brightness));
+			get_samples.push_back(std::chrono::duration<double, std::micro>(Clock::now() - start).count());
+
+			// write back the current value so benchmarking does not visibly change the display
+			start = Clock::now();
+			Check(client.SetSystemScreenBrightness(brightness));
+			set_samples.push_back(std::chrono::duration<double, std::micro>(Clock::now() - start).count());
+		}
+
+		PrintSamples("get", get_samples);
+		PrintSamples("set", set_samples);
+		return 0;
+	}
+
+	int Run(std::vector<std::string> args)
+	{
+		std::string backend_name = "system";
+		std::string broker_path;
+		std::string record_path;
+		std::string replay_path;
+		long interval = -1;
+		while (!args.empty() && args.front().rfind("--", 0) == 0)
+		{
+			const std::string& option = args.front();
+			if (option.rfind("--backend=", 0) == 0)
+			{
+				backend_name = option.substr(std::string("--backend=").size());
+			}
+			else if (option.rfind("--record=", 0) == 0)
+			{
+				record_path = option.substr(std::string("--record=").size());
+			}
+			else if (option.rfind("--replay=", 0) == 0)
+			{
+				replay_path = option.substr(std::string("--replay=").size());
+			}
+#ifndef _WIN32
+			else if (option == "--broker")
+			{
+				broker_path = screen_brightness::GetDefaultBrokerSocketPath();
+			}
+			else if (option.rfind("--broker=", 0) == 0)
+			{
+				broker_path = option.substr(std::string("--broker=").size());
+			}
+#endif
+			else if (option.rfind("--interval=", 0) == 0)
+			{
+				interval = std::max(0L, std::strtol(option.c_str() + std::string("--interval=").size(), nullptr, 10));
+			}
+			else
+			{
+				return PrintUsage();
+			}
+
+			args.erase(args.begin());
+		}
+
+		auto system_backend = CreateBackend(backend_name);
+		if (system_backend == nullptr || args.empty())
+		{
+			return PrintUsage();
+		}
+
+		if (!replay_path.empty())
+		{
+			std::vector<screen_brightness::MonitorTraceRecord> records;
+			Check(screen_brightness::LoadMonitorTrace(replay_path, records));
+			system_backend = std::make_unique<screen_brightness::ReplayMonitorBackend>(std::move(records), screen_brightness::Clock::Steady());
+		}
+
+		// DDC/CI needs the MCCS command spacing, a backlight or the fake backend does not
+#ifdef _WIN32
+		const bool is_ddc = backend_name == "system";
+#else
+		const bool is_ddc = false;
+#endif
+		auto minimum_command_interval = interval >= 0 ? std::chrono::milliseconds(interval) :
+			is_ddc ? DdcScheduler::kMccsMinimumCommandInterval : std::chrono::milliseconds(0);
+		const std::string& command = args.front();
+#ifndef _WIN32
+		if (command == "serve")
+		{
+			const std::string path = args.size() >= 2 ? args[1] : screen_brightness::GetDefaultBrokerSocketPath();
+			screen_brightness::BrokerServer server(*system_backend, screen_brightness::Clock::Steady(), minimum_command_interval, true);
+			Check(server.Listen(path));
+			std::printf("listening on %s\n", path.c_str());
+			std::fflush(stdout);
+			server.Run();
+			return 0;
+		}
+
+		if (!broker_path.empty())
+		{
+			// the broker spaces the bus commands of all its clients
+			system_backend = std::make_unique<screen_brightness::BrokerMonitorBackend>(broker_path, screen_brightness::Clock::Steady(),
+				[backend_name] { return CreateBackend(backend_name); });
+			minimum_command_interval = std::chrono::milliseconds(0);
+		}
+#endif
+
+		if (command == "restore" || command == "watchdog")
+		{
+			const std::string path = args.size() >= 2 ? args[1] : screen_brightness::RestoreJournal::GetDefaultPath();
+			BrightnessService service(std::move(system_backend), screen_brightness::Clock::Steady(), minimum_command_interval, false);
+			(void)service.OpenLeaseTable(screen_brightness::SharedLeaseTable::kDefaultName);
+			Check(service.OpenRestoreJournal(path));
+			while (true)
+			{
+				for (const screen_brightness::DisplayRestoreResult& result : service.RecoverRestoreJournal())
+				{
+					std::printf("restored display %llu: %s\n", static_cast<unsigned long long>(result.display),
+						screen_brightness::GetMonitorStatusMessage(result.status));
+				}
+
+				if (command == "restore")
+				{
+					return 0;
+				}
+
+				// exits are polled for, as the processes may belong to any application
+				std::fflush(stdout);
+				std::this_thread::sleep_for(std::chrono::seconds(1));
+				(void)service.UpdateDisplayTopology();
+			}
+		}
+
+		// the recording is of the calls which reach the monitor, after scheduling; the system backend outlives it
+		std::unique_ptr<MonitorBackend> service_backend;
+		if (!record_path.empty())
+		{
+			auto recorder = std::make_unique<screen_brightness::RecordingMonitorBackend>(*system_backend, screen_brightness::Clock::Steady());
+			Check(recorder->Open(record_path));
+			service_backend = std::move(recorder);
+		}
+		else
+		{
+			service_backend = std::move(system_backend);
+		}
+
+		const auto service = std::make_shared<BrightnessService>(std::move(service_backend), screen_brightness::Clock::Steady(), minimum_command_interval, false);
+		MonitorBackend* backend = &service->scheduled_backend();
+
+		if (command == "list")
+		{
+			std::vector<screen_brightness::DisplayInfo> displays;
+			Check(backend->EnumerateDisplays(displays));
+			for (size_t index = 0; index < displays.size(); ++index)
+			{
+				std::printf("%zu\t%s\t%s\n", index, displays[index].name.c_str(), displays[index].id.c_str());
+			}
+
+			return 0;
+		}
+
+		BrightnessClient client(service);
+		if (command == "get")
+		{
+			client.SetDisplay(ResolveDisplay(*backend, args, 1));
+			double brightness = 0;
+			Check(client.GetApplicationScreenBrightness(brightness));
+			std::printf("%.4f\n", brightness);
+			return 0;
+		}
+
+		if (command == "set" && args.size() >= 2)
+		{
+			client.SetDisplay(ResolveDisplay(*backend, args, 2));
+			client.Initialize();
+			Check(client.SetSystemScreenBrightness(std::clamp(std::strtod(args[1].c_str(), nullptr), 0.0, 1.0)));
+			return 0;
+		}
+
+		if (command == "benchmark")
+		{
+			const long iterations = args.size() >= 2 ? std::max(1L, std::strtol(args[1].c_str(), nullptr, 10)) : 100;
+			const DisplayHandle display = ResolveDisplay(*backend, args, 2);
+			client.SetDisplay(display);
+			client.Initialize();
+			const int result = RunBenchmark(client, iterations);
+			PrintMetrics(service->scheduled_backend().GetScheduler(display));
+			return result;
+		}
+
+#ifndef _WIN32
+		if (command == "ambient")
+		{
+			screen_brightness::IioAmbientLightSource source(args.size() >= 2 ? args[1] : "/sys/bus/iio/devices");
+			if (!source.is_open())
+			{
+				throw std::runtime_error("No ambient light sensor");
+			}
+
+			std::printf("sensor %s, %s\n", source.device_name().c_str(), source.is_buffered() ? "buffered" : "polled");
+			client.SetDisplay(ResolveDisplay(*backend, args, 2));
+			client.Initialize();
+			screen_brightness::Clock& clock = screen_brightness::Clock::Steady();
+			screen_brightness::AmbientBrightnessController controller(client, source, clock);
+			controller.SetEnabled(true);
+			std::uint64_t write_count = 0;
+			while (true)
+			{
+				const screen_brightness::Clock::time_point next_poll_time = controller.Poll();
+				const screen_brightness::AmbientBrightnessCounters& counters = controller.counters();
+				if (counters.write_count != write_count)
+				{
+					write_count = counters.write_count;
+					std::printf("%.1f lux\t%.4f\twrites=%llu failed=%llu cpu=%.3fms\n", controller.smoothed_lux(),
+						client.GetApplicationScreenBrightnessOverride(), static_cast<unsigned long long>(counters.write_count),
+						static_cast<unsigned long long>(counters.failed_write_count),
+						std::chrono::duration<double, std::milli>(counters.cpu_time).count());
+					std::fflush(stdout);
+				}
+
+				clock.SleepUntil(next_poll_time);
+			}
+		}
+
+		if (command == "idle" && args.size() >= 2)
+		{
+			screen_brightness::Clock& clock = screen_brightness::Clock::Steady();
+			screen_brightness::EvdevActivitySource source(clock);
+			if (!source.is_open())
+			{
+				throw std::runtime_error("No readable input device");
+			}
+
+			std::printf("%zu input devices\n", source.device_count());
+			client.SetDisplay(ResolveDisplay(*backend, args, 2));
+			client.Initialize();
+			screen_brightness::IdleDimmer dimmer(client, source, clock);
+			screen_brightness::IdleDimmingConfig config;
+			config.idle_timeout = std::chrono::milliseconds(std::max(1L, std::strtol(args[1].c_str(), nullptr, 10)));
+			dimmer.SetConfig(config);
+			dimmer.SetEnabled(true);
+			screen_brightness::IdleState state = dimmer.state();
+			while (true)
+			{
+				const screen_brightness::Clock::time_point next_poll_time = dimmer.Poll();
+				if (dimmer.state() != state)
+				{
+					state = dimmer.state();
+					std::printf("%s\n", screen_brightness::GetIdleStateName(state));
+					std::fflush(stdout);
+				}
+
+				clock.SleepUntil(next_poll_time);
+			}
+		}
+#endif
+
+		const screen_brightness::DisplayTopology& topology = service->display_topology();
+		screen_brightness::VcpFeatureController& vcp_feature_controller = service->vcp_feature_controller();
+		if (command == "vcp" && args.size() >= 2)
+		{
+			std::vector<VcpCode> codes;
+			for (size_t start = 0; start <= args[1].size();)
+			{
+				const size_t end = std::min(args[1].find(',', start), args[1].size());
+				codes.push_back(ParseVcpCode(args[1].substr(start, end - start)));
+				start = end + 1;
+			}
+
+			std::vector<screen_brightness::VcpFeatureValue> features;
+			Check(vcp_feature_controller.GetVcpFeatures(ResolveDisplay(*backend, args, 2), codes, features));
+			for (const screen_brightness::VcpFeatureValue& feature : features)
+			{
+				if (feature.status == MonitorStatus::kOk)
+				{
+					std::printf("0x%02x\t%lu\t%lu\n", feature.code, feature.current_value, feature.maximum_value);
+				}
+				else
+				{
+					std::printf("0x%02x\t%s\n", feature.code, screen_brightness::GetMonitorStatusMessage(feature.status));
+				}
+			}
+
+			return 0;
+		}
+
+		if (command == "vcp-set" && args.size() >= 3)
+		{
+			Check(vcp_feature_controller.SetVcpFeature(ResolveDisplay(*backend, args, 3), ParseVcpCode(args[1]),
+				std::strtoul(args[2].c_str(), nullptr, 0)));
+			return 0;
+		}
+
+		if (command == "capabilities")
+		{
+			std::string capabilities;
+			Check(vcp_feature_controller.GetCapabilitiesString(ResolveDisplay(*backend, args, 1), capabilities));
+			std::printf("%s\n", capabilities.c_str());
+			return 0;
+		}
+
+		if (command == "edid")
+		{
+			const screen_brightness::DisplayTopology::Display* display = topology.FindByHandle(ResolveDisplay(*backend, args, 1));
+			if (display == nullptr)
+			{
+				throw std::runtime_error("Unknown display");
+			}
+
+			std::printf("identity\t%s\n", screen_brightness::ToString(display->info.identity).c_str());
+			screen_brightness::Edid edid;
+			if (!edid.Parse(display->edid.data(), display->edid.size()))
+			{
+				std::printf("edid\tnone\n");
+				return 0;
+			}
+
+			std::printf("manufacturer\t%.3s\nproduct\t0x%04x\nserial\t%u\n", edid.manufacturer_id().data(), edid.product_code(), edid.serial_number());
+			std::printf("name\t%.*s\nserial_string\t%.*s\n", static_cast<int>(edid.monitor_name().size()), edid.monitor_name().data(),
+				static_cast<int>(edid.serial_string().size()), edid.serial_string().data());
+			std::printf("size\t%dx%d mm\nmanufactured\t%d week %d\nchecksum\t%s\n", edid.width_millimeters(), edid.height_millimeters(),
+				edid.manufacture_year(), edid.manufacture_week(), edid.is_checksum_valid() ? "ok" : "invalid");
+			return 0;
+		}
+
+		return PrintUsage();
+	}
+}
+
+int main(int argc, char** argv)
+{
+	try
+	{
+		return Run(std::vector<std::string>(argv + 1, argv + argc));
+	}
+	catch (const std::exception& exception)
+	{
+		std::fprintf(stderr, "sbctl: %s\n", exception.what());
+		return 1;
+	}
+}